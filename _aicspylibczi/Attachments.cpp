@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "Attachments.h"
+#include "exceptions.h"
+
+namespace pylibczi {
+
+namespace {
+// every segment starts with a 32 byte header: a 16 byte id then the allocated and the used size of the data
+constexpr std::uint64_t s_segmentHeaderBytes = 32;
+constexpr std::uint64_t s_fileHeaderBytes = s_segmentHeaderBytes + 512;
+constexpr size_t s_attachmentDirectoryPosition = s_segmentHeaderBytes + 72;
+// the directory has an entry count padded to 256 bytes then the entries, each "A1" entry is 128 bytes
+constexpr std::uint64_t s_directoryHeaderBytes = 256;
+constexpr std::uint64_t s_entryBytes = 128;
+constexpr size_t s_entryFilePosition = 12;
+constexpr size_t s_entryGuid = 24;
+constexpr size_t s_entryContentType = 40;
+constexpr size_t s_entryName = 48;
+constexpr std::int32_t s_maxEntries = 1 << 20;
+
+template<typename T>
+T
+valueAt(const std::vector<std::uint8_t>& bytes_, size_t offset_)
+{
+  T ans;
+  std::memcpy(&ans, bytes_.data() + offset_, sizeof(ans)); // CZI is little-endian like every supported platform
+  return ans;
+}
+
+std::vector<std::uint8_t>
+readBytes(libCZI::IStream& stream_, std::uint64_t offset_, std::uint64_t size_)
+{
+  std::vector<std::uint8_t> ans(static_cast<size_t>(size_));
+  std::uint64_t bytesRead = 0;
+  stream_.Read(offset_, ans.data(), size_, &bytesRead);
+  if (bytesRead != size_)
+    throw std::runtime_error("The file is truncated.");
+  return ans;
+}
+
+// a fixed size field of the directory entry, padded with zeros
+std::string
+fieldAt(const std::vector<std::uint8_t>& bytes_, size_t offset_, size_t size_)
+{
+  auto first = reinterpret_cast<const char*>(bytes_.data() + offset_);
+  return std::string(first, strnlen(first, size_));
+}
+}
+
+AttachmentDirectory::AttachmentDirectory(libCZI::IStream& stream_)
+{
+  auto header = readBytes(stream_, 0, s_fileHeaderBytes);
+  if (std::memcmp(header.data(), "ZISRAWFILE", 10) != 0)
+    throw std::runtime_error("Not a CZI file.");
+  auto position = valueAt<std::int64_t>(header, s_attachmentDirectoryPosition);
+  if (position <= 0)
+    return; // the file has no attachments
+
+  auto directory = readBytes(stream_, static_cast<std::uint64_t>(position), s_segmentHeaderBytes + s_entryBytes);
+  if (std::memcmp(directory.data(), "ZISRAWATTDIR", 12) != 0)
+    throw std::runtime_error("The attachment directory segment is invalid.");
+  auto count = valueAt<std::int32_t>(directory, s_segmentHeaderBytes);
+  if (count < 0 || count > s_maxEntries)
+    throw std::runtime_error("The attachment directory has an invalid number of entries.");
+  auto entries = readBytes(stream_,
+                           static_cast<std::uint64_t>(position) + s_segmentHeaderBytes + s_directoryHeaderBytes,
+                           static_cast<std::uint64_t>(count) * s_entryBytes);
+
+  m_entries.reserve(static_cast<size_t>(count));
+  for (std::int32_t i = 0; i < count; i++) {
+    size_t at = static_cast<size_t>(i) * s_entryBytes;
+    libCZI::GUID guid;
+    guid.Data1 = valueAt<std::uint32_t>(entries, at + s_entryGuid);
+    guid.Data2 = valueAt<std::uint16_t>(entries, at + s_entryGuid + 4);
+    guid.Data3 = valueAt<std::uint16_t>(entries, at + s_entryGuid + 6);
+    std::memcpy(guid.Data4, entries.data() + at + s_entryGuid + 8, sizeof(guid.Data4));
+    AttachmentEntry entry{ i,
+                           fieldAt(entries, at + s_entryName, 80),
+                           fieldAt(entries, at + s_entryContentType, 8),
+                           guidString(guid),
+                           valueAt<std::int64_t>(entries, at + s_entryFilePosition),
+                           -1 };
+    // the data size is the first field of the attachment segment's data
+    if (entry.filePosition > 0) {
+      auto segment = readBytes(stream_, static_cast<std::uint64_t>(entry.filePosition), s_segmentHeaderBytes + 8);
+      if (std::memcmp(segment.data(), "ZISRAWATT", 9) == 0)
+        entry.size = valueAt<std::int64_t>(segment, s_segmentHeaderBytes);
+    }
+    m_entries.push_back(std::move(entry));
+  }
+}
+
+std::string
+AttachmentDirectory::guidString(const libCZI::GUID& guid_)
+{
+  char ans[37];
+  std::snprintf(ans,
+                sizeof(ans),
+                "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                static_cast<unsigned int>(guid_.Data1),
+                static_cast<unsigned int>(guid_.Data2),
+                static_cast<unsigned int>(guid_.Data3),
+                guid_.Data4[0],
+                guid_.Data4[1],
+                guid_.Data4[2],
+                guid_.Data4[3],
+                guid_.Data4[4],
+                guid_.Data4[5],
+                guid_.Data4[6],
+                guid_.Data4[7]);
+  return ans;
+}
+
+std::vector<double>
+AttachmentDirectory::decodeTimeStamps(const void* data_, size_t size_)
+{
+  constexpr size_t headerBytes = 2 * sizeof(std::int32_t);
+  if (data_ == nullptr || size_ < headerBytes)
+    throw AttachmentException("TimeStamps", "it is shorter than its header.");
+  auto bytes = static_cast<const std::uint8_t*>(data_);
+  std::int32_t count = 0;
+  std::memcpy(&count, bytes + sizeof(std::int32_t), sizeof(count));
+  if (count < 0 || static_cast<size_t>(count) > (size_ - headerBytes) / sizeof(double))
+    throw AttachmentException("TimeStamps", "it holds " + std::to_string(count) + " time stamps in " +
+                                              std::to_string(size_) + " bytes.");
+  std::vector<double> ans(static_cast<size_t>(count));
+  if (!ans.empty())
+    std::memcpy(ans.data(), bytes + headerBytes, ans.size() * sizeof(double));
+  return ans;
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef _AICSPYLIBCZI_ATTACHMENTS_H
+#define _AICSPYLIBCZI_ATTACHMENTS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief an entry of the attachment directory of a CZI file, eg the TimeStamps, EventList or Thumbnail of the
+ * acquisition
+ */
+struct AttachmentEntry
+{
+  int index;                 ///< the index libCZI reads the attachment with
+  std::string name;          ///< eg "TimeStamps"
+  std::string contentType;   ///< eg "CZTIMS", "CZEVL" or "JPG"
+  std::string guid;          ///< the content GUID as xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+  std::int64_t filePosition; ///< the position of the attachment segment, -1 if it isn't known
+  std::int64_t size;         ///< the bytes of the attachment's data, -1 if it isn't known
+};
+
+/*!
+ * @brief The attachment directory of a CZI file read straight from the stream, libCZI's enumeration has neither the
+ * file positions nor the sizes of the attachments.
+ *
+ * The directory segment is read once, then the 8 byte data size from the head of each attachment segment, the data
+ * itself isn't read.
+ */
+class AttachmentDirectory
+{
+public:
+  /*!
+   * @brief read the directory, throws std::runtime_error if the file header or the directory isn't laid out as
+   * expected
+   */
+  explicit AttachmentDirectory(libCZI::IStream& stream_);
+
+  const std::vector<AttachmentEntry>& entries() const { return m_entries; }
+
+  /*!
+   * @brief the GUID as the lower case hex groups of its Data1, Data2, Data3 and Data4 fields
+   */
+  static std::string guidString(const libCZI::GUID& guid_);
+
+  /*!
+   * @brief the seconds of each frame stored in a TimeStamps (CZTIMS) attachment: an int32 size, an int32 count
+   * and then the count doubles. Throws AttachmentException if data_ is too short for the count it holds.
+   */
+  static std::vector<double> decodeTimeStamps(const void* data_, size_t size_);
+
+private:
+  std::vector<AttachmentEntry> m_entries;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_ATTACHMENTS_H
@@ -0,0 +1,65 @@
+#include "Cancellation.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "exceptions.h"
+
+namespace pylibczi {
+
+constexpr std::chrono::milliseconds ReadCancellation::s_interruptInterval;
+
+namespace {
+ReadCancellation&
+installed()
+{
+  static thread_local ReadCancellation s_installed;
+  return s_installed;
+}
+}
+
+ReadCancellation::Scope::Scope(std::shared_ptr<CancelToken> token_,
+                               Clock::time_point deadline_,
+                               std::function<bool()> interrupted_)
+  : m_previous(installed())
+{
+  ReadCancellation& cancellation = installed();
+  if (token_ != nullptr)
+    cancellation.m_token = std::move(token_);
+  cancellation.m_deadline = std::min(cancellation.m_deadline, deadline_);
+  if (interrupted_ != nullptr) {
+    cancellation.m_interrupted = std::move(interrupted_);
+    cancellation.m_interruptedThread = std::this_thread::get_id();
+    cancellation.m_nextInterruptCheck = std::make_shared<Clock::time_point>(Clock::time_point::min());
+  }
+}
+
+ReadCancellation::Scope::~Scope()
+{
+  installed() = std::move(m_previous);
+}
+
+ReadCancellation
+ReadCancellation::current()
+{
+  return installed();
+}
+
+void
+ReadCancellation::check() const
+{
+  if (m_token != nullptr && m_token->cancelled())
+    throw ReadCancelledException(ReadCancelledException::Reason::Cancelled);
+  if (m_deadline == Clock::time_point::max() && m_interrupted == nullptr)
+    return;
+  Clock::time_point now = Clock::now();
+  if (now >= m_deadline)
+    throw ReadCancelledException(ReadCancelledException::Reason::Deadline);
+  if (m_interrupted == nullptr || std::this_thread::get_id() != m_interruptedThread || now < *m_nextInterruptCheck)
+    return;
+  *m_nextInterruptCheck = now + s_interruptInterval;
+  if (m_interrupted())
+    throw ReadCancelledException(ReadCancelledException::Reason::Interrupted);
+}
+
+}
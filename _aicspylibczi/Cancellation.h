@@ -0,0 +1,85 @@
+#ifndef _AICSPYLIBCZI_CANCELLATION_H
+#define _AICSPYLIBCZI_CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace pylibczi {
+
+/*!
+ * @brief a flag a caller sets to abandon the reads it started, eg when a viewer has panned away from the region. It
+ * is shared by the reads and the caller, see ReadCancellation.
+ */
+class CancelToken
+{
+  std::atomic<bool> m_cancelled{ false };
+
+public:
+  void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+  void reset() { m_cancelled.store(false, std::memory_order_relaxed); }
+  bool cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+};
+
+/*!
+ * @brief the cancellation of the reads started on a thread: a CancelToken, a deadline and a check for an interrupt
+ * of the thread (eg Ctrl-C in python), installed with a Scope so every read API takes them without a parameter.
+ *
+ * A read takes the current() of the thread it's called on when it starts and checks it before each subblock it
+ * decodes, on whichever thread decodes it. The check throws ReadCancelledException, the subblocks not yet started
+ * are then dropped and the ones being decoded finish, so a read stops within one subblock per thread. The interrupt
+ * check is only made by the thread which installed it, at most every s_interruptInterval.
+ */
+class ReadCancellation
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::chrono::milliseconds s_interruptInterval{ 50 };
+
+  class Scope;
+
+  /*!
+   * @brief the cancellation installed on the calling thread, one which never cancels if there's none
+   */
+  static ReadCancellation current();
+
+  /*!
+   * @brief throw ReadCancelledException if the token is cancelled, the deadline has passed or the thread which
+   * installed the interrupt check is calling and it reports an interrupt
+   */
+  void check() const;
+
+private:
+  std::shared_ptr<CancelToken> m_token;
+  Clock::time_point m_deadline = Clock::time_point::max();
+  std::function<bool()> m_interrupted;
+  std::thread::id m_interruptedThread;
+  // only the thread of m_interruptedThread reads and writes it
+  std::shared_ptr<Clock::time_point> m_nextInterruptCheck;
+};
+
+/*!
+ * @brief install a cancellation on the calling thread until the Scope is destroyed, scopes nest: the token of
+ * the outer scope is kept if token_ is null, the earlier of the deadlines applies and an interrupt check replaces
+ * the outer one. Scopes must be destroyed on the thread that made them, in reverse order.
+ */
+class ReadCancellation::Scope
+{
+  ReadCancellation m_previous;
+
+public:
+  Scope(std::shared_ptr<CancelToken> token_,
+        Clock::time_point deadline_ = Clock::time_point::max(),
+        std::function<bool()> interrupted_ = nullptr);
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+  ~Scope();
+};
+
+}
+
+#endif //_AICSPYLIBCZI_CANCELLATION_H
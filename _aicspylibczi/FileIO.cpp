@@ -0,0 +1,126 @@
+#include <cstdlib>
+
+#include "FileIO.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace pylibczi {
+
+#ifdef _WIN32
+
+std::FILE*
+openFile(const std::wstring& name_, bool write_)
+{
+  return _wfopen(name_.c_str(), write_ ? L"wb" : L"rb");
+}
+
+bool
+replaceFile(const std::wstring& from_, const std::wstring& to_)
+{
+  return MoveFileExW(from_.c_str(), to_.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+void
+removeFile(const std::wstring& name_)
+{
+  _wremove(name_.c_str());
+}
+
+bool
+statFile(const std::wstring& name_, std::uint64_t& size_, std::int64_t& modified_)
+{
+  struct _stat64 st;
+  if (_wstat64(name_.c_str(), &st) != 0)
+    return false;
+  size_ = static_cast<std::uint64_t>(st.st_size);
+  modified_ = static_cast<std::int64_t>(st.st_mtime);
+  return true;
+}
+
+bool
+makeDirectory(const std::wstring& name_)
+{
+  struct _stat64 st;
+  return _wmkdir(name_.c_str()) == 0 || (_wstat64(name_.c_str(), &st) == 0 && (st.st_mode & _S_IFDIR) != 0);
+}
+
+bool
+seekFile(std::FILE* file_, std::uint64_t offset_)
+{
+  return _fseeki64(file_, static_cast<__int64>(offset_), SEEK_SET) == 0;
+}
+
+#else
+
+namespace {
+std::string
+narrow(const std::wstring& name_)
+{
+  // convert the wchar_t to an UTF8-string
+  size_t requiredSize = std::wcstombs(nullptr, name_.c_str(), 0);
+  if (requiredSize == static_cast<size_t>(-1))
+    return std::string();
+  std::string conv(requiredSize, 0);
+  conv.resize(std::wcstombs(&conv[0], name_.c_str(), requiredSize));
+  return conv;
+}
+}
+
+std::FILE*
+openFile(const std::wstring& name_, bool write_)
+{
+  return std::fopen(narrow(name_).c_str(), write_ ? "wb" : "rb");
+}
+
+bool
+replaceFile(const std::wstring& from_, const std::wstring& to_)
+{
+  return std::rename(narrow(from_).c_str(), narrow(to_).c_str()) == 0;
+}
+
+void
+removeFile(const std::wstring& name_)
+{
+  std::remove(narrow(name_).c_str());
+}
+
+bool
+statFile(const std::wstring& name_, std::uint64_t& size_, std::int64_t& modified_)
+{
+  struct stat st;
+  if (stat(narrow(name_).c_str(), &st) != 0)
+    return false;
+  size_ = static_cast<std::uint64_t>(st.st_size);
+#ifdef __linux__
+  modified_ = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#else
+  modified_ = static_cast<std::int64_t>(st.st_mtime);
+#endif
+  return true;
+}
+
+bool
+makeDirectory(const std::wstring& name_)
+{
+  std::string name = narrow(name_);
+  struct stat st;
+  return mkdir(name.c_str(), 0777) == 0 || (stat(name.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+bool
+seekFile(std::FILE* file_, std::uint64_t offset_)
+{
+  return fseeko(file_, static_cast<off_t>(offset_), SEEK_SET) == 0;
+}
+
+#endif
+
+}
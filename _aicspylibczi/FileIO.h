@@ -0,0 +1,85 @@
+#ifndef _AICSPYLIBCZI_FILEIO_H
+#define _AICSPYLIBCZI_FILEIO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace pylibczi {
+
+/*!
+ * @brief open a file for binary reading or writing, the name is a wide string like the Reader's file names
+ * @return the file or nullptr if it can't be opened
+ */
+std::FILE*
+openFile(const std::wstring& name_, bool write_);
+
+/*!
+ * @brief rename from_ to to_, replacing to_ if it exists
+ */
+bool
+replaceFile(const std::wstring& from_, const std::wstring& to_);
+
+void
+removeFile(const std::wstring& name_);
+
+/*!
+ * @brief the size and the modification time of a file, the time has nanoseconds on linux and seconds elsewhere
+ * @return false if the file doesn't exist
+ */
+bool
+statFile(const std::wstring& name_, std::uint64_t& size_, std::int64_t& modified_);
+
+/*!
+ * @brief create a directory, its parent must exist
+ * @return true if the directory exists afterwards
+ */
+bool
+makeDirectory(const std::wstring& name_);
+
+/*!
+ * @brief move the position of an open file, 64 bit on every platform so files over 2GB can be written
+ */
+bool
+seekFile(std::FILE* file_, std::uint64_t offset_);
+
+/*!
+ * @brief a std::FILE closed when it goes out of scope
+ */
+class File
+{
+  std::FILE* m_file;
+
+public:
+  File(const std::wstring& name_, bool write_)
+    : m_file(openFile(name_, write_))
+  {}
+
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+
+  ~File()
+  {
+    if (m_file != nullptr)
+      std::fclose(m_file);
+  }
+
+  bool isOpen() const { return m_file != nullptr; }
+
+  bool read(void* data_, size_t size_) { return std::fread(data_, 1, size_, m_file) == size_; }
+
+  bool write(const void* data_, size_t size_) { return std::fwrite(data_, 1, size_, m_file) == size_; }
+
+  bool seek(std::uint64_t offset_) { return seekFile(m_file, offset_); }
+
+  bool close()
+  {
+    bool ans = std::fclose(m_file) == 0;
+    m_file = nullptr;
+    return ans;
+  }
+};
+
+}
+
+#endif //_AICSPYLIBCZI_FILEIO_H
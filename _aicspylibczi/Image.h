@@ -14,6 +14,7 @@
 #include <utility>
 #include <vector>
 
+#include "PixelTraits.h"
 #include "SubblockSortable.h"
 #include "exceptions.h"
 #include "helper_algorithms.h"
@@ -41,23 +42,43 @@ protected:
    * consistency with the Channel Dimension.
    */
 
-  std::vector<size_t> m_shape; // Y X A order or Y X  ( H, W )  The shape of the data being stored
+  std::array<size_t, 3> m_shape; // Y X A order or Y X  ( H, W )  The shape of the data being stored
+  size_t m_rank;                  // 2 or 3, the extents of m_shape used
   libCZI::PixelType m_pixelType;
   libCZI::IntRect m_xywh; // (x0, y0, w, h) for image bounding box
 
-  static std::map<libCZI::PixelType, std::string> s_pixelToTypeName;
-  static std::map<libCZI::PixelType, libCZI::PixelType> s_pixelSplitMap;
-
 public:
   using ImVec = std::vector<std::shared_ptr<Image>>;
 
-  Image(std::vector<size_t> shape_,
+  Image(const std::vector<size_t>& shape_,
+        libCZI::PixelType pixel_type_,
+        const libCZI::CDimCoordinate* plane_coordinates_,
+        libCZI::IntRect box_,
+        int index_m_)
+    : SubblockSortable(plane_coordinates_, index_m_)
+    , m_shape{ { 0, 0, 0 } }
+    , m_rank(shape_.size())
+    , m_pixelType(pixel_type_)
+    , m_xywh(box_)
+  {
+    if (m_rank < 2 || m_rank > m_shape.size())
+      throw ImageAccessUnderspecifiedException(m_rank, 2, "An image has 2 or 3 dimensions.");
+    std::copy(shape_.begin(), shape_.end(), m_shape.begin());
+  }
+
+  /*!
+   * @brief the image of a subblock without building a shape vector first, the shape is {H, W} or {H, W, A} if
+   * samples_per_pixel_ > 1
+   */
+  Image(libCZI::IntSize size_,
+        size_t samples_per_pixel_,
         libCZI::PixelType pixel_type_,
         const libCZI::CDimCoordinate* plane_coordinates_,
         libCZI::IntRect box_,
         int index_m_)
     : SubblockSortable(plane_coordinates_, index_m_)
-    , m_shape(std::move(shape_))
+    , m_shape{ { size_.h, size_.w, samples_per_pixel_ } }
+    , m_rank(samples_per_pixel_ > 1 ? 3 : 2)
     , m_pixelType(pixel_type_)
     , m_xywh(box_)
   {
@@ -68,11 +89,14 @@ public:
   template<typename T>
   bool isTypeMatch();
 
-  std::vector<size_t> shape() { return m_shape; }
+  std::vector<size_t> shape() const { return std::vector<size_t>(m_shape.begin(), m_shape.begin() + m_rank); }
 
   libCZI::IntRect bBox() const { return m_xywh; }
 
-  size_t length() { return std::accumulate(m_shape.begin(), m_shape.end(), (size_t)1, std::multiplies<>()); }
+  size_t length() const
+  {
+    return std::accumulate(m_shape.begin(), m_shape.begin() + m_rank, (size_t)1, std::multiplies<>());
+  }
 
   libCZI::PixelType pixelType() { return m_pixelType; }
 
@@ -82,6 +106,8 @@ public:
                          libCZI::IntSize size_,
                          size_t channels_) = 0;
 
+  virtual void loadImage(const void* data_ptr_, size_t stride_, libCZI::IntSize size_, size_t channels_) = 0;
+
   ~Image() {}
 };
 
@@ -89,8 +115,7 @@ template<typename T>
 inline bool
 Image::isTypeMatch()
 {
-  auto pt = s_pixelToTypeName[m_pixelType];
-  return (typeid(T).name() == s_pixelToTypeName[m_pixelType]);
+  return isSampleType<T>(m_pixelType);
 }
 
 /*!
@@ -122,9 +147,18 @@ public:
 
   std::vector<std::pair<char, size_t>> getShape()
   {
+    return shapeFrom(getImageDimsList(), front()->shape()); // assumption: images are the same shape, if not 🙃
+  }
 
-    std::vector<std::map<char, size_t>> validIndexes = getImageDimsList();
-
+  /*!
+   * @brief the shape of a stack of images
+   * @param valid_indexes_ the dimension indexes of each image, see Image::getValidIndexes
+   * @param height_by_width_ the shape of one image {H, W} or {H, W, A}
+   * @return the count of distinct values of each dimension followed by Y, X and A in descending DimensionIndex order
+   */
+  static std::vector<std::pair<char, size_t>> shapeFrom(const std::vector<std::map<char, size_t>>& valid_indexes_,
+                                                        const std::vector<size_t>& height_by_width_)
+  {
     // TODO This code assumes the data is a matrix, meaning for example scene's
     // have the same number of Z-slices
     // TODO is there another way to do this that could cope with variable data
@@ -132,7 +166,7 @@ public:
     std::vector<std::pair<char, size_t>> charSizes;
     std::map<char, std::set<size_t>> charSetSize;
     std::map<char, std::set<size_t>>::iterator found;
-    for (const auto& validMap : validIndexes) {
+    for (const auto& validMap : valid_indexes_) {
       for (auto keySet : validMap) {
         found = charSetSize.emplace(keySet.first, std::set<size_t>()).first;
         found->second.insert(keySet.second);
@@ -141,12 +175,24 @@ public:
     for (auto keySet : charSetSize) {
       charSizes.emplace_back(keySet.first, keySet.second.size());
     }
-    auto heightByWidth = front()->shape(); // assumption: images are the same shape, if not 🙃
-    size_t hByWsize = heightByWidth.size();
-    charSizes.emplace_back('Y', heightByWidth[0]); // H: 0
-    charSizes.emplace_back('X', heightByWidth[1]); // W: 1
+    return shapeFromCounts(std::move(charSizes), height_by_width_);
+  }
+
+  /*!
+   * @brief the shape of a stack of images from the count of distinct values of each dimension
+   * @param char_sizes_ the dimensions and their counts in any order
+   * @param height_by_width_ the shape of one image {H, W} or {H, W, A}
+   * @return char_sizes_ followed by Y, X and A in descending DimensionIndex order
+   */
+  static std::vector<std::pair<char, size_t>> shapeFromCounts(std::vector<std::pair<char, size_t>> char_sizes_,
+                                                              const std::vector<size_t>& height_by_width_)
+  {
+    std::vector<std::pair<char, size_t>> charSizes = std::move(char_sizes_);
+    size_t hByWsize = height_by_width_.size();
+    charSizes.emplace_back('Y', height_by_width_[0]); // H: 0
+    charSizes.emplace_back('X', height_by_width_[1]); // W: 1
     if (hByWsize > 2) {
-      charSizes.emplace_back('A', heightByWidth[2]); // A: 3
+      charSizes.emplace_back('A', height_by_width_[2]); // A: 3
     }
     // sort them into decending DimensionIndex Order
     std::sort(charSizes.begin(), charSizes.end(), [&](std::pair<char, size_t> a_, std::pair<char, size_t> b_) {
@@ -1,159 +1,173 @@
 #include "ImageFactory.h"
 
 #include "TypedImage.h"
+#include <complex>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 namespace pylibczi {
 
-ImageFactory::CtorMap ImageFactory::s_pixelToImageConstructor{
-  { PixelType::Gray8,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<uint8_t>();
-      return std::shared_ptr<TypedImage<uint8_t>>(new TypedImage<uint8_t>(
-        std::move(shape_), pixel_type_, plane_coordinate_, box_, typedPtr->getPointerAtIndex(mem_index_), index_m_));
-    } },
-  { PixelType::Bgr24,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<uint8_t>();
-      return std::shared_ptr<TypedImage<uint8_t>>(new TypedImage<uint8_t>(std::move(shape_),
-                                                                          PixelType::Gray8,
-                                                                          plane_coordinate_,
-                                                                          box_,
-                                                                          typedPtr->getPointerAtIndex(mem_index_),
-                                                                          index_m_));
-    } },
-  { PixelType::Gray16,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<uint16_t>();
-      return std::shared_ptr<TypedImage<uint16_t>>(new TypedImage<uint16_t>(
-        std::move(shape_), pixel_type_, plane_coordinate_, box_, typedPtr->getPointerAtIndex(mem_index_), index_m_));
-    } },
-  { PixelType::Gray32,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<uint32_t>();
-      return std::shared_ptr<TypedImage<uint32_t>>(new TypedImage<uint32_t>(
-        std::move(shape_), pixel_type_, plane_coordinate_, box_, typedPtr->getPointerAtIndex(mem_index_), index_m_));
-    } },
-  { PixelType::Gray32,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<uint32_t>();
-      return std::shared_ptr<TypedImage<uint32_t>>(new TypedImage<uint32_t>(
-        std::move(shape_), pixel_type_, plane_coordinate_, box_, typedPtr->getPointerAtIndex(mem_index_), index_m_));
-    } },
-  { PixelType::Bgr48,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<uint16_t>();
-      return std::shared_ptr<TypedImage<uint16_t>>(new TypedImage<uint16_t>(std::move(shape_),
-                                                                            PixelType::Gray16,
-                                                                            plane_coordinate_,
-                                                                            box_,
-                                                                            typedPtr->getPointerAtIndex(mem_index_),
-                                                                            index_m_));
-    } },
-  { PixelType::Gray32Float,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<float>();
-      return std::shared_ptr<TypedImage<float>>(new TypedImage<float>(
-        std::move(shape_), pixel_type_, plane_coordinate_, box_, typedPtr->getPointerAtIndex(mem_index_), index_m_));
-    } },
-  { PixelType::Bgr96Float,
-    [](std::vector<size_t> shape_,
-       PixelType pixel_type_,
-       const libCZI::CDimCoordinate* plane_coordinate_,
-       libCZI::IntRect box_,
-       ImagesContainerBase* bptr,
-       size_t mem_index_,
-       int index_m_) {
-      auto typedPtr = bptr->getBaseAsTyped<float>();
-      return std::shared_ptr<TypedImage<float>>(new TypedImage<float>(std::move(shape_),
-                                                                      PixelType::Gray32Float,
-                                                                      plane_coordinate_,
-                                                                      box_,
-                                                                      typedPtr->getPointerAtIndex(mem_index_),
-                                                                      index_m_));
-    } }
+constexpr size_t ImageFactory::s_noSlot;
+
+/*!
+ * @brief the images of one read constructed side by side in one allocation, see ImageFactory::reserveSlots
+ */
+class ImageArena
+{
+  using Slot = std::aligned_union<0,
+                                  TypedImage<uint8_t>,
+                                  TypedImage<uint16_t>,
+                                  TypedImage<uint32_t>,
+                                  TypedImage<float>,
+                                  TypedImage<double>,
+                                  TypedImage<std::complex<float>>>::type;
+
+  std::unique_ptr<Slot[]> m_slots;
+  std::unique_ptr<Image*[]> m_images; // the image in each slot, nullptr until it's constructed
+  size_t m_size;
+
+public:
+  explicit ImageArena(size_t size_)
+    : m_slots(new Slot[size_])
+    , m_images(new Image*[size_]())
+    , m_size(size_)
+  {}
+
+  ImageArena(const ImageArena&) = delete;
+  ImageArena& operator=(const ImageArena&) = delete;
+
+  ~ImageArena()
+  {
+    for (size_t i = 0; i < m_size; i++) {
+      if (m_images[i] != nullptr)
+        m_images[i]->~Image();
+    }
+  }
+
+  template<typename T, typename... Args>
+  TypedImage<T>* construct(size_t slot_, Args&&... args_)
+  {
+    if (slot_ >= m_size || m_images[slot_] != nullptr)
+      throw std::out_of_range("ImageArena slot " + std::to_string(slot_) + " is out of range or already used.");
+    auto image = new (&m_slots[slot_]) TypedImage<T>(std::forward<Args>(args_)...);
+    m_images[slot_] = image;
+    return image;
+  }
+
+  Image* at(size_t slot_) const { return m_images[slot_]; }
+
+  size_t size() const { return m_size; }
 };
 
+ImageFactory::ImageFactory(libCZI::PixelType pixel_type_,
+                           size_t pixels_in_all_images_,
+                           void* external_memory_,
+                           const PixelMemory::Policy& policy_,
+                           unsigned int cores_,
+                           const PixelConversion& conversion_)
+  : m_imgContainer(ImagesContainerBase::getTypedAsBase(
+      conversion_.outputType(pixel_type_), pixels_in_all_images_, external_memory_, policy_, cores_))
+  , m_pixelType(pixel_type_)
+  , m_construct(dispatchPixelType(m_imgContainer->pixelType(),
+                                  [](auto traits_) -> Constructor {
+                                    return &ImageFactory::constructTyped<decltype(traits_)::s_pixelType>;
+                                  }))
+  , m_converter(conversion_.converterFor(pixel_type_))
+{}
+
 size_t
 ImageFactory::sizeOfPixelType(PixelType pixel_type_)
 {
-  switch (pixel_type_) {
-    case PixelType::Gray8:
-    case PixelType::Bgr24:
-      return sizeof(uint8_t);
-    case PixelType::Gray16:
-    case PixelType::Bgr48:
-      return sizeof(uint16_t);
-    case PixelType::Gray32:
-      return sizeof(uint32_t);
-    case PixelType::Gray32Float:
-    case PixelType::Bgr96Float:
-      return sizeof(float);
-    default:
-      throw PixelTypeException(pixel_type_, "sizeOfPixelType: Pixel Type unsupported by libCZI.");
-  }
+  return dispatchPixelType(pixel_type_, [](auto traits_) { return sizeof(typename decltype(traits_)::Sample); });
 }
 
 size_t
 ImageFactory::numberOfSamples(libCZI::PixelType pixel_type_)
 {
-  switch (pixel_type_) {
-    case PixelType::Gray8:
-    case PixelType::Gray16:
-    case PixelType::Gray32:
-    case PixelType::Gray32Float:
-      return 1;
-    case PixelType::Bgr24:
-    case PixelType::Bgr48:
-    case PixelType::Bgr96Float:
-      return 3;
-    case PixelType::Invalid:
-      return 0;
-    default:
-      throw PixelTypeException(pixel_type_, "numberOfSamples: Pixel Type unsupported by libCZI.");
+  if (pixel_type_ == PixelType::Invalid)
+    return 0;
+  return dispatchPixelType(pixel_type_, [](auto traits_) { return decltype(traits_)::s_samples; });
+}
+
+template<libCZI::PixelType P>
+std::shared_ptr<Image>
+ImageFactory::constructTyped(const void* data_ptr_,
+                             size_t stride_,
+                             libCZI::IntSize size_,
+                             const libCZI::CDimCoordinate* plane_coordinate_,
+                             libCZI::IntRect box_,
+                             size_t mem_index_,
+                             int index_m_,
+                             size_t slot_)
+{
+  using Traits = PixelTraits<P>;
+  using T = typename Traits::Sample;
+  // the container was made for P by the constructor, P is the pixel type after the conversion
+  T* memory = static_cast<ImagesContainer<T>*>(m_imgContainer.get())->getPointerAtIndex(mem_index_);
+  std::shared_ptr<TypedImage<T>> image;
+  if (slot_ != s_noSlot) {
+    if (m_arena == nullptr)
+      throw std::logic_error("ImageFactory::reserveSlots must be called before constructing an image in a slot.");
+    TypedImage<T>* inSlot = m_arena->construct<T>(
+      slot_, size_, Traits::s_samples, Traits::s_planeType, plane_coordinate_, box_, memory, index_m_);
+    image = std::shared_ptr<TypedImage<T>>(m_arena, inSlot); // shares the ownership of the arena, nothing is allocated
+  } else {
+    image = std::make_shared<TypedImage<T>>(
+      size_, Traits::s_samples, Traits::s_planeType, plane_coordinate_, box_, memory, index_m_);
+  }
+  if (data_ptr_ == nullptr)
+    return image;
+  if (m_converter)
+    m_converter.convert(data_ptr_, stride_, size_, memory);
+  else
+    image->TypedImage<T>::loadImage(data_ptr_, stride_, size_, Traits::s_samples); // not virtual, so it's inlined
+  return image;
+}
+
+std::shared_ptr<Image>
+ImageFactory::createImage(libCZI::PixelType pixel_type_,
+                          const void* data_ptr_,
+                          size_t stride_,
+                          libCZI::IntSize size_,
+                          const libCZI::CDimCoordinate* plane_coordinate_,
+                          libCZI::IntRect box_,
+                          size_t mem_index_,
+                          int index_m_,
+                          size_t slot_)
+{
+  if (pixel_type_ != m_pixelType)
+    throw PixelTypeException(pixel_type_, "The image PixelType doesn't match the container's.");
+  return (this->*m_construct)(data_ptr_, stride_, size_, plane_coordinate_, box_, mem_index_, index_m_, slot_);
+}
+
+void
+ImageFactory::addImage(const std::shared_ptr<Image>& image_, size_t slot_)
+{
+  if (slot_ == s_noSlot)
+    m_imgContainer->addImage(image_);
+}
+
+void
+ImageFactory::reserveSlots(size_t count_)
+{
+  m_arena = std::make_shared<ImageArena>(count_);
+}
+
+void
+ImageFactory::collectSlots(void)
+{
+  if (m_arena == nullptr)
+    return;
+  ImageVector& images = m_imgContainer->images();
+  images.reserve(images.size() + m_arena->size());
+  for (size_t i = 0; i < m_arena->size(); i++) {
+    Image* image = m_arena->at(i);
+    if (image != nullptr)
+      images.push_back(std::shared_ptr<Image>(m_arena, image));
   }
+  m_arena.reset();
 }
 
 std::shared_ptr<Image>
@@ -162,28 +176,61 @@ ImageFactory::constructImage(const std::shared_ptr<libCZI::IBitmapData>& bitmap_
                              const libCZI::CDimCoordinate* plane_coordinate_,
                              libCZI::IntRect box_,
                              size_t mem_index_,
-                             int index_m_)
+                             int index_m_,
+                             size_t slot_)
 {
-  PixelType pixelType = bitmap_ptr_->GetPixelType();
-
-  std::vector<size_t> shape;
-  size_t samples_per_pixel = numberOfSamples(pixelType);
+  libCZI::ScopedBitmapLockerP lckScoped{ bitmap_ptr_.get() };
+  return constructImage(lckScoped.ptrDataRoi,
+                        lckScoped.stride,
+                        bitmap_ptr_->GetPixelType(),
+                        size_,
+                        plane_coordinate_,
+                        box_,
+                        mem_index_,
+                        index_m_,
+                        slot_);
+}
 
-  shape.emplace_back(size_.h);
-  shape.emplace_back(size_.w);
-  if (samples_per_pixel > 1)
-    shape.emplace_back(samples_per_pixel);
+std::shared_ptr<Image>
+ImageFactory::constructImage(const void* data_ptr_,
+                             size_t stride_,
+                             libCZI::PixelType pixel_type_,
+                             libCZI::IntSize size_,
+                             const libCZI::CDimCoordinate* plane_coordinate_,
+                             libCZI::IntRect box_,
+                             size_t mem_index_,
+                             int index_m_,
+                             size_t slot_)
+{
+  std::shared_ptr<Image> image =
+    createImage(pixel_type_, data_ptr_, stride_, size_, plane_coordinate_, box_, mem_index_, index_m_, slot_);
+  addImage(image, slot_);
+  return image;
+}
 
-  auto imageFactoryFunction = s_pixelToImageConstructor[pixelType];
+std::shared_ptr<Image>
+ImageFactory::constructImageInPlace(libCZI::PixelType pixel_type_,
+                                    libCZI::IntSize size_,
+                                    const libCZI::CDimCoordinate* plane_coordinate_,
+                                    libCZI::IntRect box_,
+                                    size_t mem_index_,
+                                    int index_m_)
+{
   std::shared_ptr<Image> image =
-    imageFactoryFunction(shape, pixelType, plane_coordinate_, box_, m_imgContainer.get(), mem_index_, index_m_);
-  if (image == nullptr)
-    throw std::bad_alloc();
-  image->loadImage(bitmap_ptr_, size_, samples_per_pixel);
+    createImage(pixel_type_, nullptr, 0, size_, plane_coordinate_, box_, mem_index_, index_m_, s_noSlot);
   m_imgContainer->addImage(image);
   return image;
 }
 
+void*
+ImageFactory::memoryAt(size_t mem_index_)
+{
+  return dispatchPixelType(m_imgContainer->pixelType(), [this, mem_index_](auto traits_) -> void* {
+    using T = typename decltype(traits_)::Sample;
+    return static_cast<ImagesContainer<T>*>(m_imgContainer.get())->getPointerAtIndex(mem_index_);
+  });
+}
+
 std::vector<std::pair<char, size_t>>
 ImageFactory::getFixedShape(void)
 {
@@ -200,10 +247,7 @@ ImageFactory::getFixedShape(void)
    * back with 7 channels for example but the numpy ndarray will have 21
    * channels.
    */
-  auto images = m_imgContainer->images();
-  images.sort();
-  auto charSizes = images.getShape();
-  return charSizes;
+  return m_imgContainer->shape(); // the distinct values don't depend on the order, the images aren't sorted
 }
 
 }
@@ -1,37 +1,90 @@
 #ifndef _PYLIBCZI_IMAGEFACTORY_H
 #define _PYLIBCZI_IMAGEFACTORY_H
 
+#include <limits>
 #include <mutex>
 
 #include "Image.h"
 #include "ImagesContainer.h"
+#include "PixelConversion.h"
+#include "PixelTraits.h"
 #include "TypedImage.h"
 #include "exceptions.h"
 
 namespace pylibczi {
 
+class ImageArena;
+
 class ImageFactory
 {
   using PixelType = libCZI::PixelType;
-  using CtorMap = std::map<libCZI::PixelType,
-                           std::function<std::shared_ptr<Image>(std::vector<size_t>,
-                                                                libCZI::PixelType pixel_type_,
+  using Constructor = std::shared_ptr<Image> (ImageFactory::*)(const void* data_ptr_,
+                                                                size_t stride_,
+                                                                libCZI::IntSize size_,
                                                                 const libCZI::CDimCoordinate* plane_coordinate_,
                                                                 libCZI::IntRect box_,
-                                                                ImagesContainerBase* bptr,
-                                                                size_t img_index_,
-                                                                int mIndex_)>>;
-  using SplitCtorMap =
-    std::map<libCZI::PixelType, std::function<std::shared_ptr<Image>(std::shared_ptr<Image> img_, int channel_)>>;
-
-  static CtorMap s_pixelToImageConstructor;
+                                                                size_t mem_index_,
+                                                                int index_m_,
+                                                                size_t slot_);
 
   ImagesContainerBase::ImagesContainerBasePtr m_imgContainer;
+  PixelType m_pixelType;               // the pixel type of every image constructed before it's converted
+  Constructor m_construct;             // constructTyped for the container's type, chosen once by the constructor
+  PixelConverter m_converter;          // the conversion of the pixels copied, empty if they are copied as they are
+  std::shared_ptr<ImageArena> m_arena; // the slots reserved by reserveSlots until collectSlots
+
+  /*!
+   * @brief construct the image of pixel type P in slot_ or on the heap and copy data_ptr_ into it, converted by
+   * m_converter if it isn't empty. Everything is compiled for P so the copy of each tile is inlined rather than
+   * looked up.
+   * @param data_ptr_ the pixels to copy, nullptr if they are in the container already
+   */
+  template<libCZI::PixelType P>
+  std::shared_ptr<Image> constructTyped(const void* data_ptr_,
+                                        size_t stride_,
+                                        libCZI::IntSize size_,
+                                        const libCZI::CDimCoordinate* plane_coordinate_,
+                                        libCZI::IntRect box_,
+                                        size_t mem_index_,
+                                        int index_m_,
+                                        size_t slot_);
+
+  /*!
+   * @brief check pixel_type_ is the factory's and construct the image with m_construct
+   */
+  std::shared_ptr<Image> createImage(libCZI::PixelType pixel_type_,
+                                     const void* data_ptr_,
+                                     size_t stride_,
+                                     libCZI::IntSize size_,
+                                     const libCZI::CDimCoordinate* plane_coordinate_,
+                                     libCZI::IntRect box_,
+                                     size_t mem_index_,
+                                     int index_m_,
+                                     size_t slot_);
+
+  /*!
+   * @brief add the image to the container unless it's in a slot, collectSlots adds those
+   */
+  void addImage(const std::shared_ptr<Image>& image_, size_t slot_);
 
 public:
-  ImageFactory(libCZI::PixelType pixel_type_, size_t pixels_in_all_images_)
-    : m_imgContainer(ImagesContainerBase::getTypedAsBase(pixel_type_, pixels_in_all_images_))
-  {}
+  static constexpr size_t s_noSlot = std::numeric_limits<size_t>::max();
+
+  /*!
+   * @brief create the factory and the memory container the images are written into
+   * @param external_memory_ (optional) memory owned by the caller to write the images into instead of allocating it,
+   * see ImagesContainerBase::getTypedAsBase
+   * @param policy_ (optional) how the memory is allocated when there's no external_memory_, see PixelMemory
+   * @param cores_ (optional) the threads faulting the memory in if the policy asks for it
+   * @param conversion_ (optional) how the pixels are converted as they are copied, the container and the images
+   * have the pixel type conversion_.outputType(pixel_type_)
+   */
+  ImageFactory(libCZI::PixelType pixel_type_,
+               size_t pixels_in_all_images_,
+               void* external_memory_ = nullptr,
+               const PixelMemory::Policy& policy_ = PixelMemory::Policy(),
+               unsigned int cores_ = 0,
+               const PixelConversion& conversion_ = PixelConversion());
 
   ImagesContainerBase::ImagesContainerBasePtr transferMemoryContainer(void)
   {
@@ -50,20 +103,71 @@ public:
 
   void setMosaic(bool val_) { m_imgContainer->images().setMosaic(val_); }
 
+  /*!
+   * @brief construct the next count_ images in the slots of one allocation rather than each on the heap, the image
+   * made with slot_ i is constructed in slot i. A slot is written by one thread so the threads reading subblocks don't
+   * share a lock, the images handed out share the ownership of the slots.
+   */
+  void reserveSlots(size_t count_);
+
+  /*!
+   * @brief add the images constructed in the slots to the container in slot order, once the threads constructing
+   * them are done
+   */
+  void collectSlots(void);
+
   template<typename T>
   static std::shared_ptr<TypedImage<T>> getDerived(std::shared_ptr<Image> image_ptr_)
   {
     if (!image_ptr_->isTypeMatch<T>())
       throw PixelTypeException(image_ptr_->pixelType(), "TypedImage PixelType doesn't match requested memory type.");
-    return std::dynamic_pointer_cast<TypedImage<T>>(image_ptr_);
+    return std::static_pointer_cast<TypedImage<T>>(image_ptr_); // an image of samples T is a TypedImage<T>
   }
 
+  /*!
+   * @brief construct the image from a libCZI bitmap, its pixels are copied into the container at mem_index_
+   * @param slot_ (optional) the slot from reserveSlots to construct the image in
+   */
   std::shared_ptr<Image> constructImage(const std::shared_ptr<libCZI::IBitmapData>& bitmap_ptr_,
                                         libCZI::IntSize size_,
                                         const libCZI::CDimCoordinate* plane_coordinate_,
                                         libCZI::IntRect box_,
                                         size_t mem_index_,
-                                        int index_m_);
+                                        int index_m_,
+                                        size_t slot_ = s_noSlot);
+
+  /*!
+   * @brief construct the image straight from a pixel buffer with no intermediate libCZI bitmap.
+   * @param data_ptr_ the first pixel of the image, eg the raw data of an uncompressed subblock
+   * @param stride_ the number of bytes between rows in data_ptr_
+   * @param pixel_type_ the pixel type of the data in data_ptr_, the pixel type the factory was created for
+   * @param slot_ (optional) the slot from reserveSlots to construct the image in
+   */
+  std::shared_ptr<Image> constructImage(const void* data_ptr_,
+                                        size_t stride_,
+                                        libCZI::PixelType pixel_type_,
+                                        libCZI::IntSize size_,
+                                        const libCZI::CDimCoordinate* plane_coordinate_,
+                                        libCZI::IntRect box_,
+                                        size_t mem_index_,
+                                        int index_m_,
+                                        size_t slot_ = s_noSlot);
+
+  /*!
+   * @brief construct the image on pixels that have already been written into the container at mem_index_, eg by
+   * MosaicCompositor, nothing is copied.
+   */
+  std::shared_ptr<Image> constructImageInPlace(libCZI::PixelType pixel_type_,
+                                               libCZI::IntSize size_,
+                                               const libCZI::CDimCoordinate* plane_coordinate_,
+                                               libCZI::IntRect box_,
+                                               size_t mem_index_,
+                                               int index_m_);
+
+  /*!
+   * @brief the address of the sample at mem_index_ in the container memory
+   */
+  void* memoryAt(size_t mem_index_);
 
   vector<std::pair<char, size_t>> getFixedShape(void);
 };
@@ -10,6 +10,8 @@
 #include <thread>
 
 #include "Image.h"
+#include "PixelMemory.h"
+#include "PixelTraits.h"
 
 namespace pylibczi {
 
@@ -25,16 +27,31 @@ public:
 private:
   ImageVector m_images;
   Shape m_shape;
-  libCZI::PixelType m_cziPixelType;
+  libCZI::PixelType m_cziPixelType = libCZI::PixelType::Invalid;
   std::mutex m_mutex;
 
 public:
-  static ImagesContainerBasePtr getTypedAsBase(libCZI::PixelType& pixel_type_, size_t pixels_in_all_images_);
-
+  /*!
+   * @brief create the container for the pixel type
+   * @param external_memory_ (optional) memory owned by the caller to write the pixels into, it must hold
+   * pixels_in_all_images_ pixels of PixelTraits::s_samples samples each, the container never frees it. If null the
+   * container allocates its own memory.
+   * @param policy_ (optional) how the container's own memory is allocated, see PixelMemory
+   * @param cores_ (optional) the threads faulting the memory in if the policy asks for it, 0 is every core
+   */
+  static ImagesContainerBasePtr getTypedAsBase(libCZI::PixelType pixel_type_,
+                                               size_t pixels_in_all_images_,
+                                               void* external_memory_ = nullptr,
+                                               const PixelMemory::Policy& policy_ = PixelMemory::Policy(),
+                                               unsigned int cores_ = 0);
+
+  /*!
+   * @return the container as the ImagesContainer of its sample type or nullptr if T isn't that type
+   */
   template<typename T>
   ImagesContainer<T>* getBaseAsTyped(void)
-  { // this has to be static_cast because of the templating and the polymorphism
-    return dynamic_cast<ImagesContainer<T>*>(this);
+  { // the pixel type says what the container is, there's no need for a dynamic_cast
+    return isSampleType<T>(m_cziPixelType) ? static_cast<ImagesContainer<T>*>(this) : nullptr;
   }
 
   virtual ~ImagesContainerBase() {}
@@ -48,6 +65,11 @@ public:
   size_t numberOfImages(void) { return m_images.size(); }
 
   ImageVector& images(void) { return m_images; }
+  /*!
+   * @brief set the shape when it's already known, eg from the subblock directory, rather than from the images
+   */
+  void setShape(Shape shape_) { m_shape = std::move(shape_); }
+
   Shape& shape(void)
   {
     if (m_shape.empty() && m_images.size() != 0)
@@ -64,51 +86,46 @@ template<typename T>
 class ImagesContainer : public ImagesContainerBase
 {
 private:
-  std::unique_ptr<T> m_uniquePtr;
+  std::unique_ptr<PixelMemory> m_pixels;
+  T* m_memory; // either m_pixels or memory owned by the caller
 
 public:
-  ImagesContainer(libCZI::PixelType pixel_type_, size_t pixels_in_all_images_)
-    : m_uniquePtr(new T[pixels_in_all_images_])
-  {}
+  ImagesContainer(libCZI::PixelType pixel_type_,
+                  size_t pixels_in_all_images_,
+                  void* external_memory_ = nullptr,
+                  const PixelMemory::Policy& policy_ = PixelMemory::Policy(),
+                  unsigned int cores_ = 0)
+    : m_pixels(external_memory_ == nullptr
+                 ? std::make_unique<PixelMemory>(pixels_in_all_images_ * sizeof(T), policy_, cores_)
+                 : nullptr)
+    , m_memory(external_memory_ == nullptr ? static_cast<T*>(m_pixels->data()) : static_cast<T*>(external_memory_))
+  {
+    setCziFilePixelType(pixel_type_);
+  }
+
+  T* getPointerAtIndex(size_t position_ = 0) { return m_memory + position_; }
 
-  T* getPointerAtIndex(size_t position_ = 0) { return m_uniquePtr.get() + position_; }
+  /*!
+   * @brief hand the memory over to the caller, it's freed by deleting the PixelMemory
+   * @return the memory or nullptr if the container was created on external memory, that memory was never owned
+   */
+  std::unique_ptr<PixelMemory> releaseMemory(void) { return std::move(m_pixels); }
 
-  T* releaseMemory(void) { return m_uniquePtr.release(); }
+  bool ownsMemory(void) const { return m_pixels != nullptr; }
 };
 
 inline ImagesContainerBase::ImagesContainerBasePtr
-ImagesContainerBase::getTypedAsBase(libCZI::PixelType& pixel_type_, size_t pixels_in_all_images_)
+ImagesContainerBase::getTypedAsBase(libCZI::PixelType pixel_type_,
+                                    size_t pixels_in_all_images_,
+                                    void* external_memory_,
+                                    const PixelMemory::Policy& policy_,
+                                    unsigned int cores_)
 {
-  ImagesContainerBasePtr imageMemory;
-  switch (pixel_type_) {
-    case libCZI::PixelType::Gray8:
-      imageMemory = std::make_unique<ImagesContainer<uint8_t>>(pixel_type_, pixels_in_all_images_);
-      break;
-    case libCZI::PixelType::Gray16:
-      imageMemory = std::make_unique<ImagesContainer<uint16_t>>(pixel_type_, pixels_in_all_images_);
-      break;
-    case libCZI::PixelType::Gray32:
-      imageMemory = std::make_unique<ImagesContainer<uint32_t>>(pixel_type_, pixels_in_all_images_);
-      break;
-    case libCZI::PixelType::Gray32Float:
-      imageMemory = std::make_unique<ImagesContainer<float>>(pixel_type_, pixels_in_all_images_);
-      break;
-    case libCZI::PixelType::Bgr24:
-      imageMemory = std::make_unique<ImagesContainer<uint8_t>>(libCZI::PixelType::Gray8, 3 * pixels_in_all_images_);
-      break;
-    case libCZI::PixelType::Bgr48:
-      imageMemory = std::make_unique<ImagesContainer<uint16_t>>(libCZI::PixelType::Gray16, 3 * pixels_in_all_images_);
-      break;
-    case libCZI::PixelType::Bgr96Float:
-      imageMemory = std::make_unique<ImagesContainer<float>>(libCZI::PixelType::Gray32Float, 3 * pixels_in_all_images_);
-      break;
-    case libCZI::PixelType::Bgra32:
-    case libCZI::PixelType::Gray64Float:
-    case libCZI::PixelType::Gray64ComplexFloat:
-    case libCZI::PixelType::Bgr192ComplexFloat:
-    case libCZI::PixelType::Invalid:
-      throw PixelTypeException(pixel_type_, "unsupported pixel type.");
-  }
+  ImagesContainerBasePtr imageMemory = dispatchPixelType(pixel_type_, [&](auto traits_) -> ImagesContainerBasePtr {
+    using Traits = decltype(traits_);
+    return std::make_unique<ImagesContainer<typename Traits::Sample>>(
+      Traits::s_planeType, Traits::s_samples * pixels_in_all_images_, external_memory_, policy_, cores_);
+  });
   imageMemory->setCziFilePixelType(pixel_type_); // make sure imageMemory has the original pixel type
   return imageMemory;
 }
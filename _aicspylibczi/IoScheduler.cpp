@@ -0,0 +1,69 @@
+#include "IoScheduler.h"
+
+namespace pylibczi {
+
+size_t
+IoScheduler::addFile()
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  return m_nextFile++;
+}
+
+IoScheduler::Turn
+IoScheduler::turn(size_t file_)
+{
+  std::unique_lock<std::mutex> lck(m_mutex);
+  if (m_inFlight < m_slots && m_turns.empty()) {
+    m_inFlight++;
+    return Turn(this);
+  }
+  Waiter waiter;
+  auto& queue = m_waiting[file_];
+  if (queue.empty())
+    m_turns.push_back(file_);
+  queue.push_back(&waiter);
+  m_granted.wait(lck, [&waiter]() { return waiter.granted; });
+  return Turn(this);
+}
+
+size_t
+IoScheduler::waiting() const
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  size_t ans = 0;
+  for (const auto& queue : m_waiting)
+    ans += queue.second.size();
+  return ans;
+}
+
+void
+IoScheduler::release()
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_inFlight--;
+  grant();
+}
+
+void
+IoScheduler::grant()
+{
+  bool granted = false;
+  while (m_inFlight < m_slots && !m_turns.empty()) {
+    size_t file = m_turns.front();
+    m_turns.pop_front();
+    auto found = m_waiting.find(file);
+    found->second.front()->granted = true;
+    found->second.pop_front();
+    m_inFlight++;
+    granted = true;
+    // a file with more reads waiting goes to the back of the line
+    if (found->second.empty())
+      m_waiting.erase(found);
+    else
+      m_turns.push_back(file);
+  }
+  if (granted)
+    m_granted.notify_all();
+}
+
+}
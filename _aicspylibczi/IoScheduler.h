@@ -0,0 +1,96 @@
+#ifndef _AICSPYLIBCZI_IOSCHEDULER_H
+#define _AICSPYLIBCZI_IOSCHEDULER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace pylibczi {
+
+/*!
+ * @brief Bounds the reads in flight across the files of a ReaderPool and hands out the turns round robin by file.
+ *
+ * A shared filesystem serves a few large reads better than hundreds of competing ones, and a file read with many
+ * threads would otherwise starve the files read with one. Each read asks for a Turn on behalf of its file, while the
+ * slots are all taken the waiting reads are queued per file and a freed slot goes to the next file in turn, so every
+ * file with reads waiting gets one read in before any file gets a second.
+ */
+class IoScheduler
+{
+  struct Waiter
+  {
+    bool granted = false;
+  };
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_granted;
+  size_t m_slots;
+  size_t m_inFlight = 0;
+  size_t m_nextFile = 0;
+  std::deque<size_t> m_turns; ///< the files with waiting reads, in the order they are served
+  std::unordered_map<size_t, std::deque<Waiter*>> m_waiting;
+
+  void release();
+
+  void grant(); // call with m_mutex held
+
+public:
+  /*!
+   * @brief a slot for one read, it is given back when the Turn is destroyed
+   */
+  class Turn
+  {
+    IoScheduler* m_scheduler;
+
+  public:
+    explicit Turn(IoScheduler* scheduler_)
+      : m_scheduler(scheduler_)
+    {}
+
+    Turn(Turn&& other_) noexcept
+      : m_scheduler(other_.m_scheduler)
+    {
+      other_.m_scheduler = nullptr;
+    }
+
+    Turn(const Turn&) = delete;
+    Turn& operator=(const Turn&) = delete;
+    Turn& operator=(Turn&&) = delete;
+
+    ~Turn()
+    {
+      if (m_scheduler != nullptr)
+        m_scheduler->release();
+    }
+  };
+
+  /*!
+   * @param slots_ the reads allowed in flight at once, at least 1
+   */
+  explicit IoScheduler(size_t slots_)
+    : m_slots(slots_ == 0 ? 1 : slots_)
+  {}
+
+  /*!
+   * @brief the id of a new file, the reads of a file are queued under its id
+   */
+  size_t addFile();
+
+  /*!
+   * @brief wait for a slot to read from file_, the read is made while the Turn is held
+   */
+  Turn turn(size_t file_);
+
+  size_t slots() const { return m_slots; }
+
+  /*!
+   * @brief the reads waiting for a turn
+   */
+  size_t waiting() const;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_IOSCHEDULER_H
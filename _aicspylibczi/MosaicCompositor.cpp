@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+
+#include "MosaicCompositor.h"
+#include "Threadpool.h"
+#include "exceptions.h"
+
+namespace pylibczi {
+
+namespace {
+// the plane coordinate each of output_length_ output pixels samples when [start_, start_ + length_) is scaled to them
+std::vector<int>
+sampledCoordinates(int start_, int length_, std::uint32_t output_length_)
+{
+  std::vector<int> ans(output_length_);
+  for (std::uint32_t d = 0; d < output_length_; d++) {
+    // the centre of output pixel d, in integers so a scale of 1 maps d to start_ + d exactly
+    std::int64_t offset = (2 * static_cast<std::int64_t>(d) + 1) * length_ / (2 * std::int64_t(output_length_));
+    ans[d] = start_ + static_cast<int>(std::min<std::int64_t>(offset, length_ - 1));
+  }
+  return ans;
+}
+
+// the first output pixel that samples a plane coordinate >= value_
+int
+firstSampling(const std::vector<int>& sampled_, int value_)
+{
+  return static_cast<int>(std::lower_bound(sampled_.begin(), sampled_.end(), value_) - sampled_.begin());
+}
+
+bool
+isMIndexValid(int m_index_)
+{
+  return m_index_ != std::numeric_limits<int>::max() && m_index_ != std::numeric_limits<int>::min();
+}
+
+// remove [x0_, x1_) from the sorted disjoint runs
+void
+subtract(std::vector<std::pair<int, int>>& runs_, int x0_, int x1_, std::vector<std::pair<int, int>>& scratch_)
+{
+  scratch_.clear();
+  for (const auto& run : runs_) {
+    if (x1_ <= run.first || run.second <= x0_) {
+      scratch_.push_back(run);
+      continue;
+    }
+    if (run.first < x0_)
+      scratch_.emplace_back(run.first, x0_);
+    if (x1_ < run.second)
+      scratch_.emplace_back(x1_, run.second);
+  }
+  runs_.swap(scratch_);
+}
+
+template<size_t N>
+void
+gather(std::uint8_t* out_, const std::uint8_t* row_, const size_t* columns_, size_t count_)
+{
+  for (size_t i = 0; i < count_; i++)
+    std::memcpy(out_ + i * N, row_ + columns_[i], N);
+}
+
+void
+gatherPixels(std::uint8_t* out_, const std::uint8_t* row_, const size_t* columns_, size_t count_, size_t bytes_)
+{
+  // fixed size copies for the pixel sizes libCZI has so the compiler inlines them
+  switch (bytes_) {
+    case 1:
+      return gather<1>(out_, row_, columns_, count_);
+    case 2:
+      return gather<2>(out_, row_, columns_, count_);
+    case 3:
+      return gather<3>(out_, row_, columns_, count_);
+    case 4:
+      return gather<4>(out_, row_, columns_, count_);
+    case 6:
+      return gather<6>(out_, row_, columns_, count_);
+    case 12:
+      return gather<12>(out_, row_, columns_, count_);
+    default:
+      for (size_t i = 0; i < count_; i++)
+        std::memcpy(out_ + i * bytes_, row_ + columns_[i], bytes_);
+  }
+}
+
+template<typename T>
+T
+scaledComponent(float component_)
+{
+  if (!std::is_integral<T>::value)
+    return static_cast<T>(component_);
+  float clamped = std::max(0.0f, std::min(1.0f, component_));
+  return static_cast<T>(0.5 + clamped * static_cast<double>(std::numeric_limits<T>::max()));
+}
+
+template<typename T>
+std::vector<std::uint8_t>
+componentsOf(const libCZI::RgbFloatColor& color_, bool bgr_)
+{
+  std::vector<T> samples;
+  if (bgr_)
+    samples = { scaledComponent<T>(color_.b), scaledComponent<T>(color_.g), scaledComponent<T>(color_.r) };
+  else
+    samples = { scaledComponent<T>(color_.r) };
+  std::vector<std::uint8_t> ans(samples.size() * sizeof(T));
+  std::memcpy(ans.data(), samples.data(), ans.size());
+  return ans;
+}
+}
+
+MosaicCompositor::MosaicCompositor(libCZI::IntRect roi_,
+                                   libCZI::IntSize size_,
+                                   libCZI::PixelType pixel_type_,
+                                   const std::vector<Tile>& tiles_)
+  : m_size(size_)
+  , m_pixelType(pixel_type_)
+  , m_bytesPerPixel(libCZI::Utils::GetBytesPerPixel(pixel_type_))
+  , m_sourceX(sampledCoordinates(roi_.x, roi_.w, size_.w))
+  , m_sourceY(sampledCoordinates(roi_.y, roi_.h, size_.h))
+{
+  std::vector<Placed> placed;
+  placed.reserve(tiles_.size());
+  for (const auto& tile : tiles_) {
+    const libCZI::IntRect& rect = tile.logicalRect;
+    if (rect.w <= 0 || rect.h <= 0 || tile.physicalSize.w == 0 || tile.physicalSize.h == 0)
+      continue;
+    Placed candidate{ tile,
+                      firstSampling(m_sourceX, rect.x),
+                      firstSampling(m_sourceY, rect.y),
+                      firstSampling(m_sourceX, rect.x + rect.w),
+                      firstSampling(m_sourceY, rect.y + rect.h),
+                      {} };
+    if (candidate.x0 < candidate.x1 && candidate.y0 < candidate.y1)
+      placed.push_back(std::move(candidate));
+  }
+  // bottom to top, the order libCZI draws them in
+  std::sort(placed.begin(), placed.end(), [](const Placed& a_, const Placed& b_) {
+    auto key = [](const Tile& t_) {
+      bool valid = isMIndexValid(t_.mIndex);
+      return std::make_tuple(valid, valid ? t_.mIndex : 0, t_.subblockIndex);
+    };
+    return key(a_.tile) < key(b_.tile);
+  });
+
+  // find the overlapping pairs sweeping along x, each tile records the tiles above it
+  std::vector<size_t> byX(placed.size());
+  std::iota(byX.begin(), byX.end(), size_t(0));
+  std::sort(byX.begin(), byX.end(), [&placed](size_t a_, size_t b_) { return placed[a_].x0 < placed[b_].x0; });
+  std::vector<bool> hidden(placed.size(), false);
+  for (size_t i = 0; i < byX.size(); i++) {
+    const Placed& a = placed[byX[i]];
+    for (size_t j = i + 1; j < byX.size() && placed[byX[j]].x0 < a.x1; j++) {
+      const Placed& b = placed[byX[j]];
+      if (b.y1 <= a.y0 || a.y1 <= b.y0)
+        continue;
+      size_t lower = std::min(byX[i], byX[j]);
+      size_t upper = std::max(byX[i], byX[j]);
+      Placed& below = placed[lower];
+      const Placed& over = placed[upper];
+      below.above.push_back(upper);
+      if (over.x0 <= below.x0 && below.x1 <= over.x1 && over.y0 <= below.y0 && below.y1 <= over.y1)
+        hidden[lower] = true;
+    }
+  }
+
+  // a tile covered by one tile above it is never decoded, the tile covering it also covers everything it would have
+  // covered of the tiles below
+  std::vector<size_t> newIndex(placed.size());
+  for (size_t i = 0; i < placed.size(); i++) {
+    newIndex[i] = m_placed.size();
+    if (!hidden[i])
+      m_placed.push_back(std::move(placed[i]));
+  }
+  for (auto& tile : m_placed) {
+    std::vector<size_t> above;
+    above.reserve(tile.above.size());
+    for (size_t i : tile.above)
+      if (!hidden[i])
+        above.push_back(newIndex[i]);
+    tile.above.swap(above);
+  }
+}
+
+std::vector<std::uint8_t>
+MosaicCompositor::pixelOf(const libCZI::RgbFloatColor& color_) const
+{
+  if (std::isnan(color_.r) || std::isnan(color_.g) || std::isnan(color_.b))
+    return {};
+  switch (m_pixelType) {
+    case libCZI::PixelType::Gray8:
+    case libCZI::PixelType::Bgr24:
+      return componentsOf<std::uint8_t>(color_, m_pixelType == libCZI::PixelType::Bgr24);
+    case libCZI::PixelType::Gray16:
+    case libCZI::PixelType::Bgr48:
+      return componentsOf<std::uint16_t>(color_, m_pixelType == libCZI::PixelType::Bgr48);
+    case libCZI::PixelType::Gray32:
+      return componentsOf<std::uint32_t>(color_, false);
+    case libCZI::PixelType::Gray32Float:
+    case libCZI::PixelType::Bgr96Float:
+      return componentsOf<float>(color_, m_pixelType == libCZI::PixelType::Bgr96Float);
+    default:
+      throw PixelTypeException(m_pixelType, "MosaicCompositor can't fill the pixel type.");
+  }
+}
+
+void
+MosaicCompositor::fill(void* out_, const libCZI::RgbFloatColor& color_, unsigned int cores_) const
+{
+  std::vector<std::uint8_t> pixel = pixelOf(color_);
+  if (pixel.empty())
+    return;
+
+  // fill the first row a pixel at a time and copy it to the others
+  auto out = static_cast<std::uint8_t*>(out_);
+  const size_t rowBytes = stride();
+  for (size_t x = 0; x < m_size.w; x++)
+    std::memcpy(out + x * m_bytesPerPixel, pixel.data(), m_bytesPerPixel);
+  ThreadPool::instance().parallelFor(m_size.h > 0 ? m_size.h - 1 : 0, cores_, [&](size_t y_) {
+    std::memcpy(out + (y_ + 1) * rowBytes, out, rowBytes);
+  });
+}
+
+void
+MosaicCompositor::fillUncovered(void* out_, const libCZI::RgbFloatColor& color_) const
+{
+  std::vector<std::uint8_t> pixel = pixelOf(color_);
+  if (pixel.empty())
+    return;
+
+  auto out = static_cast<std::uint8_t*>(out_);
+  std::vector<std::pair<int, int>> runs, scratch;
+  for (int y = 0; y < static_cast<int>(m_size.h); y++) {
+    runs.assign(1, std::make_pair(0, static_cast<int>(m_size.w)));
+    for (const auto& placed : m_placed) {
+      if (placed.y0 <= y && y < placed.y1)
+        subtract(runs, placed.x0, placed.x1, scratch);
+    }
+    std::uint8_t* outRow = out + y * stride();
+    for (const auto& run : runs) {
+      for (int x = run.first; x < run.second; x++)
+        std::memcpy(outRow + x * m_bytesPerPixel, pixel.data(), m_bytesPerPixel);
+    }
+  }
+}
+
+void
+MosaicCompositor::draw(size_t i_, const Pixels& pixels_, void* out_) const
+{
+  if (pixels_.pixelType != m_pixelType)
+    throw PixelTypeException(pixels_.pixelType,
+                             "Selected subblocks have inconsistent PixelTypes."
+                             " You must select subblocks with consistent PixelTypes.");
+  const Placed& placed = m_placed[i_];
+  const libCZI::IntRect& rect = placed.tile.logicalRect;
+  const libCZI::IntSize& physical = placed.tile.physicalSize;
+
+  // the byte offset in a source row of every output column the tile covers
+  std::vector<size_t> columns(placed.x1 - placed.x0);
+  bool contiguous = true; // true at a scale of 1, the runs are then copied with one memcpy per row
+  for (int x = placed.x0; x < placed.x1; x++) {
+    std::int64_t column = std::int64_t(m_sourceX[x] - rect.x) * physical.w / rect.w;
+    columns[x - placed.x0] = static_cast<size_t>(std::min<std::int64_t>(column, physical.w - 1)) * m_bytesPerPixel;
+    if (x > placed.x0 && columns[x - placed.x0] != columns[x - placed.x0 - 1] + m_bytesPerPixel)
+      contiguous = false;
+  }
+
+  auto source = static_cast<const std::uint8_t*>(pixels_.data);
+  auto out = static_cast<std::uint8_t*>(out_);
+  std::vector<std::pair<int, int>> runs, scratch;
+  for (int y = placed.y0; y < placed.y1; y++) {
+    runs.assign(1, std::make_pair(placed.x0, placed.x1));
+    for (size_t a : placed.above) {
+      const Placed& over = m_placed[a];
+      if (over.y0 <= y && y < over.y1)
+        subtract(runs, over.x0, over.x1, scratch);
+    }
+    if (runs.empty())
+      continue;
+    std::int64_t sourceRow = std::int64_t(m_sourceY[y] - rect.y) * physical.h / rect.h;
+    const std::uint8_t* row = source + std::min<std::int64_t>(sourceRow, physical.h - 1) * pixels_.stride;
+    std::uint8_t* outRow = out + y * stride();
+    for (const auto& run : runs) {
+      const size_t* first = columns.data() + (run.first - placed.x0);
+      size_t count = run.second - run.first;
+      if (contiguous)
+        std::memcpy(outRow + run.first * m_bytesPerPixel, row + *first, count * m_bytesPerPixel);
+      else
+        gatherPixels(outRow + run.first * m_bytesPerPixel, row, first, count, m_bytesPerPixel);
+    }
+  }
+}
+
+void
+MosaicCompositor::compose(void* out_, unsigned int cores_, const Decoder& decode_) const
+{
+  ThreadPool::instance().parallelFor(
+    m_placed.size(), cores_, [&](size_t i_) { draw(i_, decode_(m_placed[i_].tile), out_); });
+}
+
+}
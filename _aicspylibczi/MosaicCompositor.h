@@ -0,0 +1,118 @@
+#ifndef _AICSPYLIBCZI_MOSAICCOMPOSITOR_H
+#define _AICSPYLIBCZI_MOSAICCOMPOSITOR_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief Composites the subblocks of a mosaic plane into one image, it replaces libCZI's
+ * ISingleChannelScalingTileAccessor::Get which reads, decodes and draws the tiles one after the other on the
+ * calling thread.
+ *
+ * The drawing order is resolved before anything is drawn: every output pixel belongs to the topmost tile covering it,
+ * the tile with the highest M index (tiles without one are at the bottom, ties go to the higher subblock index). Each
+ * tile only writes the pixels no tile above it covers, so the tiles are decoded and drawn in parallel on the shared
+ * ThreadPool in any order and every pixel is written at most once. Scaling is nearest neighbour.
+ */
+class MosaicCompositor
+{
+public:
+  struct Tile
+  {
+    int subblockIndex;
+    libCZI::IntRect logicalRect;  ///< where the tile lies on the plane
+    libCZI::IntSize physicalSize; ///< the size of the stored pixels, smaller than logicalRect for pyramid tiles
+    int mIndex;
+  };
+
+  /*!
+   * @brief the decoded pixels of a tile, holder keeps data alive until the tile is drawn
+   */
+  struct Pixels
+  {
+    std::shared_ptr<const void> holder;
+    const void* data;
+    size_t stride;
+    libCZI::PixelType pixelType;
+  };
+
+  using Decoder = std::function<Pixels(const Tile& tile_)>;
+
+  /*!
+   * @param roi_ the region of the plane to composite
+   * @param size_ the size of the output image, roi_ is scaled to it
+   * @param pixel_type_ the pixel type of the tiles and the output
+   * @param tiles_ the candidate tiles, the ones that don't contribute a pixel to the output are dropped
+   */
+  MosaicCompositor(libCZI::IntRect roi_,
+                   libCZI::IntSize size_,
+                   libCZI::PixelType pixel_type_,
+                   const std::vector<Tile>& tiles_);
+
+  /*!
+   * @brief the tiles that will be decoded, ie the tiles with at least one visible pixel
+   */
+  size_t numberOfTiles() const { return m_placed.size(); }
+
+  const Tile& tile(size_t i_) const { return m_placed[i_].tile; }
+
+  /*!
+   * @brief the bytes between the rows of the output, the output is packed
+   */
+  size_t stride() const { return static_cast<size_t>(m_size.w) * m_bytesPerPixel; }
+
+  /*!
+   * @brief set every pixel of out_ to color_, nothing is written if a component of color_ is NaN (libCZI's convention
+   * for no background). The gray pixel types use the r component. Each component is between 0.0 and 1.0 for the
+   * integer pixel types.
+   */
+  void fill(void* out_, const libCZI::RgbFloatColor& color_, unsigned int cores_) const;
+
+  /*!
+   * @brief set the pixels of out_ no tile covers to color_, as fill, eg to clear what was drawn into out_ before the
+   * tiles are drawn over it
+   */
+  void fillUncovered(void* out_, const libCZI::RgbFloatColor& color_) const;
+
+  /*!
+   * @brief draw the visible pixels of tile(i_) into out_. The tiles write disjoint pixels so any number of tiles can
+   * be drawn at the same time, in any order.
+   */
+  void draw(size_t i_, const Pixels& pixels_, void* out_) const;
+
+  /*!
+   * @brief decode every tile with decode_ and draw it into out_, with at most cores_ threads. decode_ is called from
+   * several threads at once. The first exception thrown is rethrown once all the threads are done.
+   */
+  void compose(void* out_, unsigned int cores_, const Decoder& decode_) const;
+
+private:
+  struct Placed
+  {
+    Tile tile;
+    int x0, y0, x1, y1;         ///< the output pixels that sample the tile, [x0, x1) x [y0, y1)
+    std::vector<size_t> above; ///< the overlapping tiles drawn over this one
+  };
+
+  /*!
+   * @brief color_ as one output pixel, empty if a component is NaN
+   */
+  std::vector<std::uint8_t> pixelOf(const libCZI::RgbFloatColor& color_) const;
+
+  libCZI::IntSize m_size;
+  libCZI::PixelType m_pixelType;
+  size_t m_bytesPerPixel;
+  std::vector<int> m_sourceX; ///< the plane column sampled by each output column
+  std::vector<int> m_sourceY; ///< the plane row sampled by each output row
+  std::vector<Placed> m_placed; ///< bottom to top
+};
+
+}
+
+#endif //_AICSPYLIBCZI_MOSAICCOMPOSITOR_H
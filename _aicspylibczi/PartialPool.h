@@ -0,0 +1,81 @@
+#ifndef _AICSPYLIBCZI_PARTIALPOOL_H
+#define _AICSPYLIBCZI_PARTIALPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pylibczi {
+
+/*!
+ * @brief The partials of an accumulation any number of threads add to at once, see Projection and
+ * StatisticsAccumulator.
+ *
+ * A thread acquires a partial no other thread is accumulating into, or a new one if every partial is taken, and
+ * releases it when it's done. The threads never wait on each other while they accumulate, and there are at most as
+ * many partials as threads accumulating at once.
+ */
+template<typename T>
+class PartialPool
+{
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<T>> m_partials; // the partials acquire made
+  std::vector<T*> m_seeds;                    // the partials owned by the caller
+  std::vector<T*> m_idle;                     // the partials no thread is accumulating into
+
+public:
+  /*!
+   * @brief add a partial owned by the caller, eg the result itself so the first thread accumulates straight into it
+   */
+  void seed(T* partial_)
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_seeds.push_back(partial_);
+    m_idle.push_back(partial_);
+  }
+
+  /*!
+   * @brief an idle partial, or make_() if another thread is accumulating into every partial
+   * @param make_ returns a std::unique_ptr<T> set to what the accumulation starts from, it's called without the lock
+   */
+  template<class Make>
+  T* acquire(Make&& make_)
+  {
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      if (!m_idle.empty()) {
+        T* partial = m_idle.back();
+        m_idle.pop_back();
+        return partial;
+      }
+    }
+    std::unique_ptr<T> partial = make_();
+    T* ans = partial.get();
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_partials.push_back(std::move(partial));
+    return ans;
+  }
+
+  void release(T* partial_)
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_idle.push_back(partial_);
+  }
+
+  /*!
+   * @brief the partials acquire made, to be merged by the caller, the seeds are left idle. No thread may be
+   * accumulating.
+   */
+  std::vector<std::unique_ptr<T>> take()
+  {
+    std::vector<std::unique_ptr<T>> ans;
+    std::lock_guard<std::mutex> lck(m_mutex);
+    ans.swap(m_partials);
+    m_idle = m_seeds;
+    return ans;
+  }
+};
+
+}
+
+#endif //_AICSPYLIBCZI_PARTIALPOOL_H
@@ -0,0 +1,79 @@
+#include "PerfCounters.h"
+
+#include "Threadpool.h"
+
+namespace pylibczi {
+
+PerfCounters::PerfCounters()
+  : m_resetAt(Clock::now().time_since_epoch().count())
+  , m_workerBusyNs(ThreadPool::instance().size() + 1)
+{}
+
+void
+PerfCounters::setEnabled(bool enabled_)
+{
+#ifdef PYLIBCZI_NO_PERF_COUNTERS
+  (void)enabled_;
+#else
+  m_enabled.store(enabled_, std::memory_order_relaxed);
+#endif
+}
+
+void
+PerfCounters::reset()
+{
+  for (auto& timing : m_timings) {
+    timing.m_calls = 0;
+    timing.m_ns = 0;
+  }
+  for (auto& timing : m_decode) {
+    timing.m_calls = 0;
+    timing.m_ns = 0;
+  }
+  m_streamBytes = 0;
+  m_tileCacheHits = 0;
+  m_tileCacheMisses = 0;
+  for (auto& busy : m_workerBusyNs)
+    busy = 0;
+  m_resetAt = Clock::now().time_since_epoch().count();
+}
+
+PerfCounters::Statistics
+PerfCounters::statistics() const
+{
+  auto timingOf = [](const AtomicTiming& timing_) {
+    Timing ans;
+    ans.calls = timing_.m_calls.load(std::memory_order_relaxed);
+    ans.ns = timing_.m_ns.load(std::memory_order_relaxed);
+    return ans;
+  };
+  Statistics ans;
+  ans.enabled = enabled();
+  Clock::time_point resetAt{ Clock::duration(m_resetAt.load(std::memory_order_relaxed)) };
+  ans.elapsedNs = nanoseconds(resetAt, Clock::now());
+  ans.readSelected = timingOf(m_timings[static_cast<size_t>(Timer::ReadSelected)]);
+  ans.readMosaic = timingOf(m_timings[static_cast<size_t>(Timer::ReadMosaic)]);
+  ans.matches = timingOf(m_timings[static_cast<size_t>(Timer::Matches)]);
+  ans.streamRead = timingOf(m_timings[static_cast<size_t>(Timer::StreamRead)]);
+  ans.streamBytes = m_streamBytes.load(std::memory_order_relaxed);
+  ans.copy = timingOf(m_timings[static_cast<size_t>(Timer::Copy)]);
+  ans.queueWait = timingOf(m_timings[static_cast<size_t>(Timer::QueueWait)]);
+  for (int compression = 0; compression <= s_otherCompression; compression++) {
+    Timing timing = timingOf(m_decode[compression]);
+    if (timing.calls > 0)
+      ans.decode.emplace_back(compression == s_otherCompression ? -1 : compression, timing);
+  }
+  ans.tileCacheHits = m_tileCacheHits.load(std::memory_order_relaxed);
+  ans.tileCacheMisses = m_tileCacheMisses.load(std::memory_order_relaxed);
+  for (const auto& busy : m_workerBusyNs)
+    ans.workerBusyNs.push_back(busy.load(std::memory_order_relaxed));
+  return ans;
+}
+
+size_t
+PerfCounters::workerSlot() const
+{
+  return std::min(ThreadPool::instance().workerSlot(), m_workerBusyNs.size() - 1);
+}
+
+}
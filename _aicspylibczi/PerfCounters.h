@@ -0,0 +1,257 @@
+#ifndef _AICSPYLIBCZI_PERFCOUNTERS_H
+#define _AICSPYLIBCZI_PERFCOUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace pylibczi {
+
+/*!
+ * @brief Counters and timers of the hot paths of a Reader: the reads and their directory lookups, the stream reads
+ * and their bytes, the decoding by compression, the copies into the images, the tile cache lookups, the time the
+ * threads of a read wait for their first job and how long every worker of the ThreadPool was busy.
+ *
+ * The counters are off until setEnabled(true), while they're off every method returns after one relaxed atomic load.
+ * Building with PYLIBCZI_NO_PERF_COUNTERS compiles them out, enabled() is then constexpr false and the methods are
+ * empty. The counts are relaxed atomics so the threads of a read never wait for one another, statistics() taken
+ * while reads are running is consistent per counter but not across counters.
+ */
+class PerfCounters
+{
+public:
+  enum class Timer
+  {
+    ReadSelected, ///< readSelected and the reads built on it (statistics, projections, bins)
+    ReadMosaic,   ///< readMosaic and readMosaicPlanes
+    Matches,      ///< the subblock directory lookups of the reads
+    StreamRead,   ///< the reads of the file, the prefetches of the ReadPipeline included
+    Copy,         ///< the copies of decoded pixels into the images, mosaics and projections
+    QueueWait,    ///< from the start of a parallel section to the first job of every thread working on it
+  };
+
+  struct Timing
+  {
+    std::uint64_t calls = 0;
+    std::uint64_t ns = 0;
+  };
+
+  struct Statistics
+  {
+    bool enabled = false;
+    std::uint64_t elapsedNs = 0; ///< since the counters were made or last reset
+    Timing readSelected;
+    Timing readMosaic;
+    Timing matches;
+    Timing streamRead;
+    std::uint64_t streamBytes = 0;
+    Timing copy;
+    Timing queueWait;
+    std::vector<std::pair<int, Timing>> decode; ///< by compression identifier (the raw CompressionMode), -1 other
+    std::uint64_t tileCacheHits = 0;
+    std::uint64_t tileCacheMisses = 0;
+    std::vector<std::uint64_t> workerBusyNs; ///< by ThreadPool worker, the last is the threads calling the Reader
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  /*!
+   * @brief time a scope if the counters are enabled when it starts
+   */
+  class Scope
+  {
+    PerfCounters* m_counters;
+    Timer m_timer;
+    Clock::time_point m_start;
+
+  public:
+    Scope(PerfCounters& counters_, Timer timer_)
+      : m_counters(counters_.enabled() ? &counters_ : nullptr)
+      , m_timer(timer_)
+    {
+      if (m_counters != nullptr)
+        m_start = Clock::now();
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope()
+    {
+      if (m_counters != nullptr)
+        m_counters->add(m_timer, m_start);
+    }
+  };
+
+  /*!
+   * @brief wrap the functor of a parallel section (a parallelFor or ReadPipeline::run) so the time every call takes
+   * is added to the busy time of the worker making it, and the time from the section's start to the first call a
+   * thread makes is added to QueueWait. Make it just before the section starts, copies count as the same section.
+   */
+  template<class F>
+  class ParallelScope
+  {
+    PerfCounters* m_counters;
+    F& m_function;
+    Clock::time_point m_start;
+    std::shared_ptr<std::vector<std::atomic<bool>>> m_started; // by worker slot, copies share it for std::function
+
+  public:
+    ParallelScope(PerfCounters& counters_, F& function_)
+      : m_counters(counters_.enabled() ? &counters_ : nullptr)
+      , m_function(function_)
+    {
+      if (m_counters == nullptr)
+        return;
+      m_started = std::make_shared<std::vector<std::atomic<bool>>>(m_counters->m_workerBusyNs.size());
+      m_start = Clock::now();
+    }
+
+    void operator()(size_t i_)
+    {
+      if (m_counters == nullptr) {
+        m_function(i_);
+        return;
+      }
+      size_t slot = m_counters->workerSlot();
+      Clock::time_point begin = Clock::now();
+      // the threads outside the pool share the last slot, only the first of them to start is counted
+      if (!(*m_started)[slot].exchange(true, std::memory_order_relaxed))
+        m_counters->add(Timer::QueueWait, m_start, begin);
+      try {
+        m_function(i_);
+      } catch (...) {
+        m_counters->addBusy(slot, begin);
+        throw;
+      }
+      m_counters->addBusy(slot, begin);
+    }
+  };
+
+  PerfCounters();
+
+  /*!
+   * @brief wrap function_ for a parallel section, see ParallelScope
+   */
+  template<class F>
+  ParallelScope<F> parallel(F& function_)
+  {
+    return ParallelScope<F>(*this, function_);
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+#ifdef PYLIBCZI_NO_PERF_COUNTERS
+  static constexpr bool enabled() { return false; }
+#else
+  bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+#endif
+
+  /*!
+   * @brief start or stop counting, the counts so far are kept. Has no effect if the counters are compiled out.
+   */
+  void setEnabled(bool enabled_);
+
+  /*!
+   * @brief zero every counter and restart the elapsed time
+   */
+  void reset();
+
+  Statistics statistics() const;
+
+  void add(Timer timer_, Clock::time_point start_) { add(timer_, start_, Clock::now()); }
+
+  void add(Timer timer_, Clock::time_point start_, Clock::time_point end_)
+  {
+    if (!enabled())
+      return;
+    auto& timing = m_timings[static_cast<size_t>(timer_)];
+    timing.m_calls.fetch_add(1, std::memory_order_relaxed);
+    timing.m_ns.fetch_add(nanoseconds(start_, end_), std::memory_order_relaxed);
+  }
+
+  /*!
+   * @brief count a read of the file which returned bytes_ bytes
+   */
+  void addStreamRead(Clock::time_point start_, std::uint64_t bytes_)
+  {
+    if (!enabled())
+      return;
+    add(Timer::StreamRead, start_);
+    m_streamBytes.fetch_add(bytes_, std::memory_order_relaxed);
+  }
+
+  /*!
+   * @brief count the decoding of a subblock, compression_ is the raw CompressionMode of the subblock
+   */
+  void addDecode(int compression_, Clock::time_point start_)
+  {
+    if (!enabled())
+      return;
+    bool known = compression_ >= 0 && compression_ < s_otherCompression;
+    auto& timing = m_decode[known ? compression_ : s_otherCompression];
+    timing.m_calls.fetch_add(1, std::memory_order_relaxed);
+    timing.m_ns.fetch_add(nanoseconds(start_, Clock::now()), std::memory_order_relaxed);
+  }
+
+  void addCacheLookup(bool hit_)
+  {
+    if (!enabled())
+      return;
+    (hit_ ? m_tileCacheHits : m_tileCacheMisses).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void addBusy(size_t worker_slot_, Clock::time_point start_)
+  {
+    if (!enabled())
+      return;
+    m_workerBusyNs[worker_slot_].fetch_add(nanoseconds(start_, Clock::now()), std::memory_order_relaxed);
+  }
+
+  /*!
+   * @brief the slot of workerBusyNs the calling thread's busy time is added to
+   */
+  size_t workerSlot() const;
+
+  /*!
+   * @brief the start of a timing, Clock::now() if the counters are enabled and the epoch if not so the clock isn't
+   * read for nothing.
+   */
+  Clock::time_point start() const { return enabled() ? Clock::now() : Clock::time_point(); }
+
+private:
+  struct AtomicTiming
+  {
+    std::atomic<std::uint64_t> m_calls{ 0 };
+    std::atomic<std::uint64_t> m_ns{ 0 };
+  };
+
+  static constexpr size_t s_numberOfTimers = static_cast<size_t>(Timer::QueueWait) + 1;
+  static constexpr int s_otherCompression = 7; // the raw CompressionModes are 0 to 6
+
+  // a start taken while the counters were disabled is the epoch, the counters were enabled during the timing
+  static std::uint64_t nanoseconds(Clock::time_point start_, Clock::time_point end_)
+  {
+    if (start_ == Clock::time_point())
+      return 0;
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end_ - start_).count());
+  }
+
+  std::atomic<bool> m_enabled{ false };
+  std::atomic<Clock::rep> m_resetAt;
+  std::array<AtomicTiming, s_numberOfTimers> m_timings;
+  std::atomic<std::uint64_t> m_streamBytes{ 0 };
+  std::array<AtomicTiming, s_otherCompression + 1> m_decode;
+  std::atomic<std::uint64_t> m_tileCacheHits{ 0 };
+  std::atomic<std::uint64_t> m_tileCacheMisses{ 0 };
+  std::vector<std::atomic<std::uint64_t>> m_workerBusyNs; // ThreadPool::instance().size() + 1 slots
+};
+
+}
+
+#endif //_AICSPYLIBCZI_PERFCOUNTERS_H
@@ -0,0 +1,247 @@
+#include "PixelConversion.h"
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+
+#include "PixelTraits.h"
+#include "exceptions.h"
+
+// the kernels are built a second time for AVX2 and picked at run time, the rest of the library is built for the
+// baseline x86-64 CPU. MSVC has no per function targets so it only has the baseline (SSE2) kernels.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PYLIBCZI_AVX2_KERNELS
+#define PYLIBCZI_ALWAYS_INLINE __attribute__((always_inline)) inline
+#else
+#define PYLIBCZI_ALWAYS_INLINE inline
+#endif
+
+namespace pylibczi {
+
+namespace {
+using Sample = PixelConversion::Sample;
+using RowKernel = PixelConverter::RowKernel;
+
+template<typename D>
+PYLIBCZI_ALWAYS_INLINE D
+targetSample(float value_, std::true_type /* integer */)
+{
+  // rounded by truncating after adding 0.5, this order and the int32_t in between are what the compilers vectorize.
+  // std::max returns its first argument when the comparison fails, so 0 first turns NaN into 0 before the cast.
+  value_ = std::min(std::max(0.0f, value_ + 0.5f), static_cast<float>(std::numeric_limits<D>::max()));
+  return static_cast<D>(static_cast<std::int32_t>(value_));
+}
+
+template<typename D>
+PYLIBCZI_ALWAYS_INLINE D
+targetSample(float value_, std::false_type /* floating point */)
+{
+  return static_cast<D>(value_);
+}
+
+template<typename D, typename S>
+PYLIBCZI_ALWAYS_INLINE D
+convertSample(S sample_, float scale_, float offset_, std::true_type /* scaled */)
+{
+  return targetSample<D>(static_cast<float>(sample_) * scale_ + offset_, std::is_integral<D>());
+}
+
+template<typename D, typename S>
+PYLIBCZI_ALWAYS_INLINE D
+convertSample(S sample_, float, float, std::false_type /* copied */)
+{
+  return static_cast<D>(sample_);
+}
+
+// the source sample written to sample s_ of a pixel, B and R swap places for RGB order
+template<size_t N, bool Rgb>
+constexpr size_t
+sourceSample(size_t s_)
+{
+  return (Rgb && N >= 3 && s_ < 3) ? 2 - s_ : s_;
+}
+
+template<typename S, typename D, size_t N, bool Rgb, bool Scaled>
+PYLIBCZI_ALWAYS_INLINE void
+convertPixels(const S* source_, D* target_, size_t pixels_, float scale_, float offset_)
+{
+  for (size_t i = 0; i < pixels_; i++) {
+    for (size_t s = 0; s < N; s++) {
+      target_[i * N + s] = convertSample<D>(
+        source_[i * N + sourceSample<N, Rgb>(s)], scale_, offset_, std::integral_constant<bool, Scaled>());
+    }
+  }
+}
+
+template<typename S, typename D, size_t N, bool Rgb, bool Scaled>
+void
+convertRow(const void* source_, void* target_, size_t pixels_, float scale_, float offset_)
+{
+  convertPixels<S, D, N, Rgb, Scaled>(
+    static_cast<const S*>(source_), static_cast<D*>(target_), pixels_, scale_, offset_);
+}
+
+#ifdef PYLIBCZI_AVX2_KERNELS
+template<typename S, typename D, size_t N, bool Rgb, bool Scaled>
+__attribute__((target("avx2"))) void
+convertRowAvx2(const void* source_, void* target_, size_t pixels_, float scale_, float offset_)
+{
+  convertPixels<S, D, N, Rgb, Scaled>(
+    static_cast<const S*>(source_), static_cast<D*>(target_), pixels_, scale_, offset_);
+}
+#endif
+
+bool
+hasAvx2()
+{
+#ifdef PYLIBCZI_AVX2_KERNELS
+  static const bool s_avx2 = __builtin_cpu_supports("avx2");
+  return s_avx2;
+#else
+  return false;
+#endif
+}
+
+template<typename S, typename D, size_t N, bool Rgb, bool Scaled>
+RowKernel
+rowKernel()
+{
+#ifdef PYLIBCZI_AVX2_KERNELS
+  if (hasAvx2())
+    return &convertRowAvx2<S, D, N, Rgb, Scaled>;
+#endif
+  return &convertRow<S, D, N, Rgb, Scaled>;
+}
+
+// the RGB kernels of gray types would be the same as the others, N >= 3 keeps them from being built twice
+template<typename S, typename D, size_t N>
+RowKernel
+rowKernel(bool rgb_, bool scaled_, std::true_type /* S is D */)
+{
+  if (!scaled_) // a plain copy is a memcpy, a copy without scaling is only made to reorder the samples
+    return rowKernel<S, D, N, (N >= 3), false>();
+  return rgb_ ? rowKernel<S, D, N, (N >= 3), true>() : rowKernel<S, D, N, false, true>();
+}
+
+template<typename S, typename D, size_t N>
+RowKernel
+rowKernel(bool rgb_, bool, std::false_type /* S is converted to D */)
+{
+  return rgb_ ? rowKernel<S, D, N, (N >= 3), true>() : rowKernel<S, D, N, false, true>();
+}
+
+template<typename S, typename D, size_t N>
+PixelConverter
+converterTo(const PixelConversion& conversion_, bool rgb_)
+{
+  double low = conversion_.low, high = conversion_.high;
+  if (low == high) {
+    if (std::is_same<S, D>::value) // nothing to scale
+      return rgb_ ? PixelConverter(rowKernel<S, D, N>(true, false, std::is_same<S, D>()),
+                                   1.0f, 0.0f, N * sizeof(S), N * sizeof(D))
+                  : PixelConverter();
+    low = 0.0;
+    high = std::is_integral<S>::value ? static_cast<double>(std::numeric_limits<S>::max()) : 1.0;
+  }
+  double range = std::is_integral<D>::value ? static_cast<double>(std::numeric_limits<D>::max()) : 1.0;
+  double scale = range / (high - low);
+  return PixelConverter(rowKernel<S, D, N>(rgb_, true, std::is_same<S, D>()),
+                        static_cast<float>(scale),
+                        static_cast<float>(-low * scale),
+                        N * sizeof(S),
+                        N * sizeof(D));
+}
+
+template<typename S, size_t N>
+PixelConverter
+converterOf(const PixelConversion& conversion_, std::true_type /* real samples */)
+{
+  bool rgb = conversion_.rgb && N >= 3;
+  switch (conversion_.sample) {
+    case Sample::Uint8:
+      return converterTo<S, std::uint8_t, N>(conversion_, rgb);
+    case Sample::Float32:
+      return converterTo<S, float, N>(conversion_, rgb);
+    default:
+      return converterTo<S, S, N>(conversion_, rgb);
+  }
+}
+
+template<typename S, size_t N>
+PixelConverter
+converterOf(const PixelConversion&, std::false_type /* complex samples */)
+{
+  return PixelConverter(); // outputType has refused any conversion of them
+}
+
+libCZI::PixelType
+withSamples(Sample sample_, size_t samples_, libCZI::PixelType source_)
+{
+  switch (samples_) {
+    case 1:
+      return sample_ == Sample::Uint8 ? libCZI::PixelType::Gray8 : libCZI::PixelType::Gray32Float;
+    case 3:
+      return sample_ == Sample::Uint8 ? libCZI::PixelType::Bgr24 : libCZI::PixelType::Bgr96Float;
+    default:
+      if (sample_ == Sample::Uint8)
+        return libCZI::PixelType::Bgra32;
+      throw PixelTypeException(source_, "there is no float pixel type with 4 samples to convert to.");
+  }
+}
+}
+
+libCZI::PixelType
+PixelConversion::outputType(libCZI::PixelType source_) const
+{
+  return dispatchPixelType(source_, [this, source_](auto traits_) {
+    using Traits = decltype(traits_);
+    if (!std::is_arithmetic<typename Traits::Sample>::value && !isDefault())
+      throw PixelTypeException(source_, "complex samples can't be converted.");
+    return sample == Sample::Source ? source_ : withSamples(sample, Traits::s_samples, source_);
+  });
+}
+
+PixelConverter
+PixelConversion::converterFor(libCZI::PixelType source_) const
+{
+  outputType(source_); // throws if source_ can't be converted
+  return dispatchPixelType(source_, [this](auto traits_) {
+    using Traits = decltype(traits_);
+    using S = typename Traits::Sample;
+    return converterOf<S, Traits::s_samples>(*this, std::is_arithmetic<S>());
+  });
+}
+
+void
+PixelConverter::convert(const void* data_ptr_, size_t stride_, libCZI::IntSize size_, void* target_) const
+{
+  size_t sourceRow = m_sourcePixelBytes * size_.w;
+  if (stride_ < sourceRow) {
+    std::stringstream msg;
+    msg << "Stride < width : " << stride_ << " < " << size_.w << std::endl;
+    throw StrideAssumptionException(msg.str());
+  }
+  if (stride_ == sourceRow) { // the rows are packed, convert them in one go
+    m_kernel(data_ptr_, target_, static_cast<size_t>(size_.w) * size_.h, m_scale, m_offset);
+    return;
+  }
+  size_t targetRow = m_targetPixelBytes * size_.w;
+  for (std::uint32_t j = 0; j < size_.h; j++) {
+    m_kernel(static_cast<const std::uint8_t*>(data_ptr_) + j * stride_,
+             static_cast<std::uint8_t*>(target_) + j * targetRow,
+             size_.w,
+             m_scale,
+             m_offset);
+  }
+}
+
+bool
+PixelConverter::usesAvx2()
+{
+  return hasAvx2();
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef _AICSPYLIBCZI_PIXELCONVERSION_H
+#define _AICSPYLIBCZI_PIXELCONVERSION_H
+
+#include <cstddef>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+class PixelConverter;
+
+/*!
+ * @brief How a read converts the samples it copies out of the subblocks, done by the copy of each tile so the result
+ * doesn't need another pass over the image, eg in numpy, to flip BGR to RGB or to window uint16 down to uint8.
+ *
+ * The samples are mapped linearly from the window [low, high] to 0 - 255 for Uint8, rounded and clamped, and to
+ * 0 - 1 for Float32. Without a window (low == high) an integer source is mapped from its full range, eg 0 - 65535,
+ * a float source to Uint8 from 0 - 1 and a float source to Float32 not at all. The shape of the result is the shape
+ * without the conversion.
+ */
+struct PixelConversion
+{
+  enum class Sample
+  {
+    Source, ///< the samples keep the type they have in the file
+    Uint8,
+    Float32
+  };
+
+  bool rgb = false; ///< write the samples of BGR types in RGB order (BGRA as RGBA), the A axis is then R, G, B
+  Sample sample = Sample::Source;
+  double low = 0.0; ///< the window mapped to the range of sample, see above
+  double high = 0.0;
+
+  bool isDefault() const { return !rgb && sample == Sample::Source && low == high; }
+
+  /*!
+   * @brief the pixel type of the images read from source_, eg Bgr48 converted to Uint8 is Bgr24. The pixel type
+   * names the layout, it is still Bgr24 when rgb is set.
+   * @throw PixelTypeException if source_ can't be converted, eg complex samples or Bgra32 to Float32
+   */
+  libCZI::PixelType outputType(libCZI::PixelType source_) const;
+
+  /*!
+   * @brief the converter copying the pixels of source_, empty if the conversion does nothing to it
+   */
+  PixelConverter converterFor(libCZI::PixelType source_) const;
+};
+
+/*!
+ * @brief The copy of the pixels of one pixel type with a PixelConversion, the kernel is chosen once per read for the
+ * pixel type, the conversion and the instruction set of the CPU, eg the AVX2 build of the kernel on x86-64 if the
+ * CPU has it. The kernels are plain loops the compiler vectorizes, which is NEON on arm64.
+ */
+class PixelConverter
+{
+public:
+  /*!
+   * @brief convert pixels_ pixels from source_ into target_, the samples are scaled by scale_ and offset_ added
+   */
+  using RowKernel = void (*)(const void* source_, void* target_, size_t pixels_, float scale_, float offset_);
+
+private:
+  RowKernel m_kernel = nullptr;
+  float m_scale = 1.0f;
+  float m_offset = 0.0f;
+  size_t m_sourcePixelBytes = 0;
+  size_t m_targetPixelBytes = 0;
+
+public:
+  PixelConverter() = default;
+
+  PixelConverter(RowKernel kernel_, float scale_, float offset_, size_t source_pixel_bytes_, size_t target_pixel_bytes_)
+    : m_kernel(kernel_)
+    , m_scale(scale_)
+    , m_offset(offset_)
+    , m_sourcePixelBytes(source_pixel_bytes_)
+    , m_targetPixelBytes(target_pixel_bytes_)
+  {}
+
+  explicit operator bool() const { return m_kernel != nullptr; }
+
+  /*!
+   * @brief convert an image into target_, where it's stored packed row by row
+   * @param data_ptr_ the first pixel of the first row
+   * @param stride_ the number of bytes between the start of consecutive rows
+   * @param size_ the width and height of the image in pixels
+   */
+  void convert(const void* data_ptr_, size_t stride_, libCZI::IntSize size_, void* target_) const;
+
+  /*!
+   * @brief true if the kernels are the AVX2 builds, false on other CPUs and compilers
+   */
+  static bool usesAvx2();
+};
+
+}
+
+#endif //_AICSPYLIBCZI_PIXELCONVERSION_H
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PixelMemory.h"
+#include "Threadpool.h"
+#include "exceptions.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace pylibczi {
+
+namespace {
+constexpr size_t s_hugePageBytes = size_t(2) << 20;
+constexpr size_t s_touchBytes = size_t(4) << 20; // the memory faulted in by one pool task
+
+size_t
+roundUp(size_t bytes_, size_t to_)
+{
+  return (std::max<size_t>(bytes_, 1) + to_ - 1) / to_ * to_;
+}
+
+size_t
+pageBytes()
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#if defined(__linux__) && defined(SYS_mbind)
+/*!
+ * @brief the mask of the online NUMA nodes, /sys/devices/system/node/online is a list of ranges eg "0-1,4"
+ */
+std::vector<unsigned long>
+onlineNodes()
+{
+  std::vector<unsigned long> mask;
+  std::ifstream online("/sys/devices/system/node/online");
+  std::string range;
+  while (std::getline(online, range, ',')) {
+    unsigned long first = 0, last = 0;
+    char dash = 0;
+    std::istringstream parse(range);
+    if (!(parse >> first))
+      continue;
+    if (!(parse >> dash >> last))
+      last = first;
+    for (unsigned long node = first; node <= last; node++) {
+      size_t word = node / (8 * sizeof(unsigned long));
+      if (word >= mask.size())
+        mask.resize(word + 1, 0);
+      mask[word] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    }
+  }
+  return mask;
+}
+#endif
+}
+
+PixelMemory::PixelMemory(size_t bytes_)
+  : PixelMemory(bytes_, Policy())
+{}
+
+PixelMemory::PixelMemory(size_t bytes_, const Policy& policy_, unsigned int cores_)
+  : m_data(nullptr)
+  , m_bytes(bytes_)
+  , m_mappedBytes(0)
+  , m_hugeTlb(false)
+  , m_pinned(false)
+  , m_fileBacked(false)
+{
+  if (policy_.isDefault()) {
+    m_data = ::operator new(bytes_);
+    return;
+  }
+  if (policy_.fileDirectory.empty())
+    map(policy_);
+  else
+    mapFile(policy_.fileDirectory);
+  try {
+    // mlock would fault every page in on this thread, the pool spreads them first
+    if ((policy_.numa == Numa::FirstTouch && !m_fileBacked) || policy_.pinned)
+      firstTouch(cores_);
+  } catch (...) {
+    release();
+    throw;
+  }
+  if (policy_.pinned) {
+#ifdef _WIN32
+    m_pinned = VirtualLock(m_data, m_mappedBytes) != 0;
+#else
+    m_pinned = mlock(m_data, m_mappedBytes) == 0;
+#endif
+    if (!m_pinned) {
+      release();
+      throw ImageCopyAllocFailed("The pages couldn't be locked in RAM, the locked memory limit may be too low.",
+                                 bytes_);
+    }
+  }
+}
+
+PixelMemory::~PixelMemory()
+{
+  release();
+}
+
+void
+PixelMemory::map(const Policy& policy_)
+{
+#ifdef _WIN32
+  if (policy_.hugePages && GetLargePageMinimum() != 0) {
+    // large pages need the SeLockMemoryPrivilege, without it the allocation fails and normal pages are used
+    m_mappedBytes = roundUp(m_bytes, GetLargePageMinimum());
+    m_data = VirtualAlloc(nullptr, m_mappedBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    m_hugeTlb = m_data != nullptr;
+  }
+  if (m_data == nullptr) {
+    m_mappedBytes = roundUp(m_bytes, pageBytes());
+    m_data = VirtualAlloc(nullptr, m_mappedBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  }
+  if (m_data == nullptr) {
+    m_mappedBytes = 0;
+    throw ImageCopyAllocFailed("VirtualAlloc failed.", m_bytes);
+  }
+#else
+  void* data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (policy_.hugePages) {
+    // only succeeds if huge pages are reserved, vm.nr_hugepages
+    m_mappedBytes = roundUp(m_bytes, s_hugePageBytes);
+    data = mmap(nullptr, m_mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    m_hugeTlb = data != MAP_FAILED;
+  }
+#endif
+  if (data == MAP_FAILED) {
+    // a whole number of huge pages so transparent huge pages can back all of it
+    m_mappedBytes = roundUp(m_bytes, policy_.hugePages ? s_hugePageBytes : pageBytes());
+    data = mmap(nullptr, m_mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+  if (data == MAP_FAILED) {
+    m_mappedBytes = 0;
+    throw ImageCopyAllocFailed("mmap failed.", m_bytes);
+  }
+  m_data = data;
+#ifdef MADV_HUGEPAGE
+  if (policy_.hugePages && !m_hugeTlb)
+    madvise(m_data, m_mappedBytes, MADV_HUGEPAGE);
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+  if (policy_.numa == Numa::Interleave) {
+    // the pages haven't been faulted in yet so they all follow the policy, on a single node it's a no-op
+    std::vector<unsigned long> nodes = onlineNodes();
+    unsigned long maxNode = 8 * sizeof(unsigned long) * nodes.size();
+    if (!nodes.empty())
+      syscall(SYS_mbind, m_data, m_mappedBytes, MPOL_INTERLEAVE, nodes.data(), maxNode, 0);
+  }
+#endif
+#endif
+}
+
+void
+PixelMemory::mapFile(const std::string& directory_)
+{
+  m_mappedBytes = roundUp(m_bytes, pageBytes());
+#ifdef _WIN32
+  char name[MAX_PATH];
+  if (GetTempFileNameA(directory_.c_str(), "czi", 0, name) == 0) {
+    m_mappedBytes = 0;
+    throw ImageCopyAllocFailed("A temporary file couldn't be created in " + directory_ + ".", m_bytes);
+  }
+  // the file is deleted once the view is unmapped, the last reference to it
+  HANDLE file = CreateFileA(name,
+                            GENERIC_READ | GENERIC_WRITE,
+                            0,
+                            nullptr,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                            nullptr);
+  HANDLE mapping = nullptr;
+  if (file != INVALID_HANDLE_VALUE) {
+    auto size = static_cast<std::uint64_t>(m_mappedBytes);
+    mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size & 0xFFFFFFFFu), nullptr);
+    CloseHandle(file);
+  } else {
+    DeleteFileA(name);
+  }
+  if (mapping != nullptr) {
+    m_data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_mappedBytes);
+    CloseHandle(mapping);
+  }
+  if (m_data == nullptr) {
+    m_mappedBytes = 0;
+    throw ImageCopyAllocFailed("A temporary file in " + directory_ + " couldn't be mapped, the disk may be full.",
+                               m_bytes);
+  }
+#else
+  std::string pattern = directory_ + "/pylibczi-XXXXXX";
+  std::vector<char> name(pattern.begin(), pattern.end());
+  name.push_back('\0');
+  int fd = mkstemp(name.data());
+  if (fd < 0) {
+    m_mappedBytes = 0;
+    throw ImageCopyAllocFailed("A temporary file couldn't be created in " + directory_ + ".", m_bytes);
+  }
+  unlink(name.data()); // the mapping keeps the file until it's unmapped
+  // the blocks are allocated up front, a page of a sparse file that can't be written back is a SIGBUS
+#ifdef __linux__
+  bool sized = posix_fallocate(fd, 0, static_cast<off_t>(m_mappedBytes)) == 0;
+#else
+  bool sized = ftruncate(fd, static_cast<off_t>(m_mappedBytes)) == 0;
+#endif
+  void* data = sized ? mmap(nullptr, m_mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED) {
+    m_mappedBytes = 0;
+    throw ImageCopyAllocFailed("A temporary file in " + directory_ + " couldn't be mapped, the disk may be full.",
+                               m_bytes);
+  }
+  m_data = data;
+#endif
+  m_fileBacked = true;
+}
+
+void
+PixelMemory::firstTouch(unsigned int cores_)
+{
+  auto bytes = static_cast<std::uint8_t*>(m_data);
+  size_t mapped = m_mappedBytes;
+  size_t tasks = (mapped + s_touchBytes - 1) / s_touchBytes;
+  ThreadPool::instance().parallelFor(tasks, cores_, [bytes, mapped](size_t i_) {
+    size_t begin = i_ * s_touchBytes;
+    std::memset(bytes + begin, 0, std::min(s_touchBytes, mapped - begin));
+  });
+}
+
+void
+PixelMemory::release()
+{
+  if (m_data == nullptr)
+    return;
+  if (m_mappedBytes == 0) {
+    ::operator delete(m_data);
+  } else {
+#ifdef _WIN32
+    if (m_pinned)
+      VirtualUnlock(m_data, m_mappedBytes);
+    if (m_fileBacked)
+      UnmapViewOfFile(m_data);
+    else
+      VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+    munmap(m_data, m_mappedBytes); // unlocks the pages too
+#endif
+  }
+  m_data = nullptr;
+  m_pinned = false;
+  m_fileBacked = false;
+}
+
+}
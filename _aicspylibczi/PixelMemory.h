@@ -0,0 +1,100 @@
+#ifndef _AICSPYLIBCZI_PIXELMEMORY_H
+#define _AICSPYLIBCZI_PIXELMEMORY_H
+
+#include <cstddef>
+#include <string>
+
+namespace pylibczi {
+
+/*!
+ * @brief The memory an ImagesContainer allocates for the pixels of a read when the caller doesn't give a buffer.
+ *
+ * The default is a plain heap allocation. The policy can ask for huge pages, which cut the TLB misses of multi-GB
+ * reads, for the pages to be spread over the NUMA nodes, so the workers on every socket write to local memory as
+ * often as remote, and for the pages to be locked in RAM so the buffer can be registered for DMA, eg with
+ * cudaHostRegister, without being copied. Huge pages and NUMA placement are best effort and fall back silently,
+ * pinning throws if the pages can't be locked, eg because of RLIMIT_MEMLOCK.
+ *
+ * For results bigger than RAM the memory can be a shared mapping of a temporary file instead, the pages then live in
+ * the page cache and are written back to the file rather than swapped. The file is deleted as soon as it's mapped
+ * so it goes with the memory, huge pages and NUMA placement don't apply to it.
+ */
+class PixelMemory
+{
+public:
+  enum class Numa
+  {
+    Default,    ///< the pages land on the node of the thread writing them first, the decode threads
+    Interleave, ///< the pages are interleaved over every node (mbind MPOL_INTERLEAVE, linux only)
+    FirstTouch  ///< the pages are faulted in before the read by the thread pool, spreading them over its nodes
+  };
+
+  struct Policy
+  {
+    bool hugePages = false; ///< MAP_HUGETLB if huge pages are reserved otherwise transparent huge pages
+    Numa numa = Numa::Default;
+    bool pinned = false; ///< lock the pages in RAM with mlock / VirtualLock
+    std::string fileDirectory; ///< map the memory from a temporary file in this directory, empty for RAM
+
+    bool isDefault() const { return !hugePages && numa == Numa::Default && !pinned && fileDirectory.empty(); }
+  };
+
+  /*!
+   * @brief a heap allocation of bytes_, the contents are uninitialized
+   */
+  explicit PixelMemory(size_t bytes_);
+
+  /*!
+   * @param bytes_ the size of the memory, the contents are uninitialized unless the policy faults the pages in
+   * @param cores_ the threads faulting the pages in for Numa::FirstTouch, 0 is every core
+   */
+  PixelMemory(size_t bytes_, const Policy& policy_, unsigned int cores_ = 0);
+
+  ~PixelMemory();
+
+  PixelMemory(const PixelMemory&) = delete;
+  PixelMemory& operator=(const PixelMemory&) = delete;
+
+  void* data() const { return m_data; }
+
+  size_t bytes() const { return m_bytes; }
+
+  /*!
+   * @brief true if the memory is mapped with MAP_HUGETLB or large pages, transparent huge pages aren't reported
+   */
+  bool hasHugePages() const { return m_hugeTlb; }
+
+  bool isPinned() const { return m_pinned; }
+
+  /*!
+   * @brief true if the memory is a mapping of a temporary file, see Policy::fileDirectory
+   */
+  bool isFileBacked() const { return m_fileBacked; }
+
+private:
+  void* m_data;
+  size_t m_bytes;
+  size_t m_mappedBytes; ///< the size of the mapping, 0 if m_data is a heap allocation
+  bool m_hugeTlb;
+  bool m_pinned;
+  bool m_fileBacked;
+
+  void map(const Policy& policy_);
+
+  /*!
+   * @brief map a temporary file of m_bytes in directory_, throws ImageCopyAllocFailed if it can't be created at
+   * that size
+   */
+  void mapFile(const std::string& directory_);
+
+  /*!
+   * @brief write every page from the thread pool so the workers fault them in on their own nodes
+   */
+  void firstTouch(unsigned int cores_);
+
+  void release();
+};
+
+}
+
+#endif //_AICSPYLIBCZI_PIXELMEMORY_H
@@ -0,0 +1,222 @@
+#include "PixelStatistics.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "PixelTraits.h"
+#include "exceptions.h"
+
+namespace pylibczi {
+
+namespace {
+using HistogramBins = StatisticsAccumulator::HistogramBins;
+
+// uint8 and uint16 samples are summed exactly, and so fast, in 64 bits, the squares of wider ones could overflow it
+template<typename S>
+using SumOf = std::conditional_t<std::is_integral<S>::value && sizeof(S) <= 2, std::uint64_t, double>;
+
+// the samples with few enough values to look their bins up in a table
+template<typename S>
+using IsTabled = std::integral_constant<bool, std::is_integral<S>::value && sizeof(S) <= 2>;
+
+size_t
+binOf(double value_, const HistogramBins& bins_)
+{
+  double position = (value_ - bins_.low) * bins_.scale;
+  if (!(position > 0.0)) // NaN is counted in the first bin
+    return 0;
+  return position < static_cast<double>(bins_.count) ? static_cast<size_t>(position) : bins_.count - 1;
+}
+
+template<typename S>
+void
+countRow(const S* row_, size_t samples_, std::uint64_t* histogram_, const HistogramBins& bins_, std::true_type)
+{
+  for (size_t i = 0; i < samples_; i++)
+    histogram_[bins_.table[row_[i]]]++;
+}
+
+template<typename S>
+void
+countRow(const S* row_, size_t samples_, std::uint64_t* histogram_, const HistogramBins& bins_, std::false_type)
+{
+  for (size_t i = 0; i < samples_; i++)
+    histogram_[binOf(static_cast<double>(row_[i]), bins_)]++;
+}
+
+// the moments loop is written so the compiler vectorizes it, a sample that is NaN never replaces the min or max
+template<typename S>
+void
+accumulateRow(const void* row_,
+              size_t samples_,
+              double* moments_,
+              std::uint64_t* histogram_,
+              const HistogramBins& bins_)
+{
+  using Sum = SumOf<S>;
+  const S* row = static_cast<const S*>(row_);
+  S low = std::numeric_limits<S>::max();
+  S high = std::numeric_limits<S>::lowest();
+  Sum sum = 0;
+  Sum squares = 0;
+  for (size_t i = 0; i < samples_; i++) {
+    S value = row[i];
+    low = value < low ? value : low;
+    high = high < value ? value : high;
+    sum += static_cast<Sum>(value);
+    squares += static_cast<Sum>(value) * static_cast<Sum>(value);
+  }
+  moments_[0] = std::min(moments_[0], static_cast<double>(low));
+  moments_[1] = std::max(moments_[1], static_cast<double>(high));
+  moments_[2] += static_cast<double>(sum);
+  moments_[3] += static_cast<double>(squares);
+  countRow(row, samples_, histogram_, bins_, IsTabled<S>());
+}
+
+using RowKernel = void (*)(const void*, size_t, double*, std::uint64_t*, const HistogramBins&);
+
+template<typename S>
+RowKernel
+kernelOf(std::true_type /* real samples */)
+{
+  return &accumulateRow<S>;
+}
+
+template<typename S>
+RowKernel
+kernelOf(std::false_type /* complex samples */)
+{
+  return nullptr; // the constructor has refused them
+}
+
+template<typename S>
+double
+fullRange(std::true_type /* integer */)
+{
+  return static_cast<double>(std::numeric_limits<S>::max()) + 1.0;
+}
+
+template<typename S>
+double
+fullRange(std::false_type /* floating point */)
+{
+  return 1.0;
+}
+
+template<typename S>
+void
+fillTable(std::vector<std::uint32_t>& table_, const HistogramBins& bins_, std::true_type)
+{
+  table_.resize(static_cast<size_t>(std::numeric_limits<S>::max()) + 1);
+  for (size_t value = 0; value < table_.size(); value++)
+    table_[value] = static_cast<std::uint32_t>(binOf(static_cast<double>(value), bins_));
+}
+
+template<typename S>
+void
+fillTable(std::vector<std::uint32_t>&, const HistogramBins&, std::false_type)
+{
+}
+}
+
+StatisticsAccumulator::StatisticsAccumulator(const StatisticsOptions& options_,
+                                             libCZI::PixelType pixel_type_,
+                                             size_t groups_)
+  : m_options(options_)
+  , m_groups(groups_)
+{
+  if (options_.bins == 0)
+    throw std::invalid_argument("The histogram needs at least 1 bin.");
+  if (options_.high < options_.low)
+    throw std::invalid_argument("The histogram range must be (low, high) with low <= high.");
+  dispatchPixelType(pixel_type_, [this, pixel_type_](auto traits_) {
+    using Traits = decltype(traits_);
+    using S = typename Traits::Sample;
+    if (!std::is_arithmetic<S>::value)
+      throw PixelTypeException(pixel_type_, "there are no statistics of complex samples.");
+    m_samples = Traits::s_samples;
+    m_sampleBytes = sizeof(S);
+    m_kernel = kernelOf<S>(std::is_arithmetic<S>());
+    if (m_options.low == m_options.high) {
+      m_options.low = 0.0;
+      m_options.high = fullRange<S>(std::is_integral<S>());
+    }
+    m_bins.low = m_options.low;
+    m_bins.scale = static_cast<double>(m_options.bins) / (m_options.high - m_options.low);
+    m_bins.count = m_options.bins;
+    m_bins.table = nullptr;
+    fillTable<S>(m_table, m_bins, IsTabled<S>());
+    if (!m_table.empty())
+      m_bins.table = m_table.data();
+  });
+}
+
+void
+StatisticsAccumulator::accumulate(size_t group_, const void* data_ptr_, size_t stride_, libCZI::IntSize size_)
+{
+  size_t rowSamples = static_cast<size_t>(size_.w) * m_samples;
+  if (stride_ < rowSamples * m_sampleBytes) {
+    std::stringstream msg;
+    msg << "Stride < width : " << stride_ << " < " << size_.w << std::endl;
+    throw StrideAssumptionException(msg.str());
+  }
+
+  Partial* partial = m_partials.acquire([this]() {
+    auto ans = std::make_unique<Partial>();
+    ans->moments.resize(m_groups * 4, 0.0);
+    for (size_t g = 0; g < m_groups; g++) {
+      ans->moments[g * 4] = std::numeric_limits<double>::infinity();
+      ans->moments[g * 4 + 1] = -std::numeric_limits<double>::infinity();
+    }
+    ans->count.assign(m_groups, 0);
+    ans->histogram.assign(m_groups * m_options.bins, 0);
+    return ans;
+  });
+  double* moments = &partial->moments[group_ * 4];
+  std::uint64_t* histogram = &partial->histogram[group_ * m_options.bins];
+  auto row = static_cast<const std::uint8_t*>(data_ptr_);
+  if (stride_ == rowSamples * m_sampleBytes) { // the rows are packed, fold them in one go
+    m_kernel(row, rowSamples * size_.h, moments, histogram, m_bins);
+  } else {
+    for (std::uint32_t j = 0; j < size_.h; j++)
+      m_kernel(row + j * stride_, rowSamples, moments, histogram, m_bins);
+  }
+  partial->count[group_] += rowSamples * size_.h;
+  m_partials.release(partial);
+}
+
+void
+StatisticsAccumulator::finish(PixelStatistics& statistics_)
+{
+  // nothing accumulates any more, the partials are merged one after the other
+  statistics_.low = m_options.low;
+  statistics_.high = m_options.high;
+  statistics_.min.assign(m_groups, std::numeric_limits<double>::infinity());
+  statistics_.max.assign(m_groups, -std::numeric_limits<double>::infinity());
+  statistics_.sum.assign(m_groups, 0.0);
+  statistics_.sumOfSquares.assign(m_groups, 0.0);
+  statistics_.count.assign(m_groups, 0);
+  statistics_.histogram.assign(m_groups * m_options.bins, 0);
+  for (const auto& partial : m_partials.take()) {
+    for (size_t g = 0; g < m_groups; g++) {
+      statistics_.min[g] = std::min(statistics_.min[g], partial->moments[g * 4]);
+      statistics_.max[g] = std::max(statistics_.max[g], partial->moments[g * 4 + 1]);
+      statistics_.sum[g] += partial->moments[g * 4 + 2];
+      statistics_.sumOfSquares[g] += partial->moments[g * 4 + 3];
+      statistics_.count[g] += partial->count[g];
+    }
+    for (size_t i = 0; i < statistics_.histogram.size(); i++)
+      statistics_.histogram[i] += partial->histogram[i];
+  }
+  for (size_t g = 0; g < m_groups; g++) {
+    if (statistics_.count[g] == 0) {
+      statistics_.min[g] = std::numeric_limits<double>::quiet_NaN();
+      statistics_.max[g] = std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+}
+
+}
@@ -0,0 +1,124 @@
+#ifndef _AICSPYLIBCZI_PIXELSTATISTICS_H
+#define _AICSPYLIBCZI_PIXELSTATISTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "PartialPool.h"
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief what statistics a read collects, see Reader::readSelected and Reader::readStatistics
+ */
+struct StatisticsOptions
+{
+  enum class Group
+  {
+    Plane,  ///< one set of statistics per plane read, shaped like the dimensions of the planes
+    Channel ///< one set per value of C, a file without C has one
+  };
+
+  Group group = Group::Plane;
+  size_t bins = 256; ///< the bins of the histogram, equally wide between low and high
+  /*!
+   * the range of the histogram, the samples outside it are counted in the first or last bin. low == high is the full
+   * range of an integer pixel type, eg [0, 65536) for gray16 so 256 bins are 256 values wide, or [0, 1) for floats
+   */
+  double low = 0.0;
+  double high = 0.0;
+};
+
+/*!
+ * @brief the statistics of the samples of each group of a read, the groups are in the C order of shape. The samples
+ * of BGR pixels are counted together.
+ */
+struct PixelStatistics
+{
+  StatisticsOptions options;                  ///< the options the statistics were collected with
+  std::vector<std::pair<char, size_t>> shape; ///< the groups, eg [('C', 3)] or [('S', 1), ('C', 3), ('Z', 5)]
+  double low = 0.0;                           ///< the lower edge of the first bin
+  double high = 0.0;                          ///< the upper edge of the last bin
+  std::vector<double> min;                    ///< NaN for a group without samples
+  std::vector<double> max;                    ///< NaN for a group without samples
+  std::vector<double> sum;
+  std::vector<double> sumOfSquares;
+  std::vector<std::uint64_t> count;     ///< the samples of each group
+  std::vector<std::uint64_t> histogram; ///< options.bins counts per group, one group after the other
+
+  size_t numberOfGroups() const { return count.size(); }
+};
+
+/*!
+ * @brief collects PixelStatistics of the subblocks as they are copied or decoded, so the statistics cost no second
+ * pass over the images. Like Projection every thread accumulating takes a partial of its own from a PartialPool,
+ * finish merges them, there are at most as many as threads accumulating at once however many subblocks there are.
+ */
+class StatisticsAccumulator
+{
+public:
+  /*!
+   * @brief how the value of a sample is mapped to the bin it's counted in
+   */
+  struct HistogramBins
+  {
+    double low;
+    double scale; ///< bins per unit of value
+    size_t count;
+    const std::uint32_t* table; ///< the bin of every value of a uint8 or uint16 sample, nullptr for other samples
+  };
+
+  /*!
+   * @param pixel_type_ the pixel type of the accumulated pixels
+   * @param groups_ the number of groups the pixels are accumulated into
+   * @throw PixelTypeException for complex pixel types, std::invalid_argument for 0 bins or a range with high < low
+   */
+  StatisticsAccumulator(const StatisticsOptions& options_, libCZI::PixelType pixel_type_, size_t groups_);
+
+  /*!
+   * @brief add the pixels of a subblock to group_, may be called from any number of threads at once
+   * @param data_ptr_ the first pixel of the first row
+   * @param stride_ the number of bytes between the start of consecutive rows
+   */
+  void accumulate(size_t group_, const void* data_ptr_, size_t stride_, libCZI::IntSize size_);
+
+  /*!
+   * @brief merge the partials into the statistics once all pixels are accumulated, shape is left to the caller
+   */
+  void finish(PixelStatistics& statistics_);
+
+private:
+  /*!
+   * @brief fold samples_ samples of row_ into the min, max, sum and sum of squares at moments_ and the histogram
+   */
+  using RowKernel = void (*)(const void* row_,
+                             size_t samples_,
+                             double* moments_,
+                             std::uint64_t* histogram_,
+                             const HistogramBins& bins_);
+
+  struct Partial
+  {
+    std::vector<double> moments; ///< min, max, sum and sum of squares of each group
+    std::vector<std::uint64_t> count;
+    std::vector<std::uint64_t> histogram;
+  };
+
+  StatisticsOptions m_options;
+  size_t m_groups;
+  size_t m_samples;     ///< the samples of a pixel
+  size_t m_sampleBytes; ///< the bytes of a sample
+  RowKernel m_kernel = nullptr;
+  std::vector<std::uint32_t> m_table;
+  HistogramBins m_bins;
+
+  PartialPool<Partial> m_partials;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_PIXELSTATISTICS_H
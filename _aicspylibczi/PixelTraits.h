@@ -0,0 +1,153 @@
+#ifndef _AICSPYLIBCZI_PIXELTRAITS_H
+#define _AICSPYLIBCZI_PIXELTRAITS_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "exceptions.h"
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief What a pixel type is stored as at compile time: the Sample type of one value, the samples per pixel and the
+ * PixelType of the single sample planes the images are made of, eg Bgr48 is 3 uint16_t samples in Gray16 planes.
+ */
+template<libCZI::PixelType P>
+struct PixelTraits;
+
+template<libCZI::PixelType P, typename S, size_t N, libCZI::PixelType Plane>
+struct PixelTraitsOf
+{
+  using Sample = S;
+  static constexpr libCZI::PixelType s_pixelType = P;
+  static constexpr size_t s_samples = N;
+  static constexpr libCZI::PixelType s_planeType = Plane;
+};
+
+template<libCZI::PixelType P, typename S, size_t N, libCZI::PixelType Plane>
+constexpr libCZI::PixelType PixelTraitsOf<P, S, N, Plane>::s_pixelType;
+
+template<libCZI::PixelType P, typename S, size_t N, libCZI::PixelType Plane>
+constexpr size_t PixelTraitsOf<P, S, N, Plane>::s_samples;
+
+template<libCZI::PixelType P, typename S, size_t N, libCZI::PixelType Plane>
+constexpr libCZI::PixelType PixelTraitsOf<P, S, N, Plane>::s_planeType;
+
+template<>
+struct PixelTraits<libCZI::PixelType::Gray8>
+  : PixelTraitsOf<libCZI::PixelType::Gray8, std::uint8_t, 1, libCZI::PixelType::Gray8>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Gray16>
+  : PixelTraitsOf<libCZI::PixelType::Gray16, std::uint16_t, 1, libCZI::PixelType::Gray16>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Gray32>
+  : PixelTraitsOf<libCZI::PixelType::Gray32, std::uint32_t, 1, libCZI::PixelType::Gray32>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Gray32Float>
+  : PixelTraitsOf<libCZI::PixelType::Gray32Float, float, 1, libCZI::PixelType::Gray32Float>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Gray64Float>
+  : PixelTraitsOf<libCZI::PixelType::Gray64Float, double, 1, libCZI::PixelType::Gray64Float>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Gray64ComplexFloat>
+  : PixelTraitsOf<libCZI::PixelType::Gray64ComplexFloat,
+                  std::complex<float>,
+                  1,
+                  libCZI::PixelType::Gray64ComplexFloat>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Bgr24>
+  : PixelTraitsOf<libCZI::PixelType::Bgr24, std::uint8_t, 3, libCZI::PixelType::Gray8>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Bgra32>
+  : PixelTraitsOf<libCZI::PixelType::Bgra32, std::uint8_t, 4, libCZI::PixelType::Gray8>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Bgr48>
+  : PixelTraitsOf<libCZI::PixelType::Bgr48, std::uint16_t, 3, libCZI::PixelType::Gray16>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Bgr96Float>
+  : PixelTraitsOf<libCZI::PixelType::Bgr96Float, float, 3, libCZI::PixelType::Gray32Float>
+{};
+
+template<>
+struct PixelTraits<libCZI::PixelType::Bgr192ComplexFloat>
+  : PixelTraitsOf<libCZI::PixelType::Bgr192ComplexFloat,
+                  std::complex<float>,
+                  3,
+                  libCZI::PixelType::Gray64ComplexFloat>
+{};
+
+/*!
+ * @brief call f_ with the PixelTraits of pixel_type_, the one switch on the pixel type a read makes. Everything f_
+ * does with the traits is compiled for each pixel type, so the per tile work after it doesn't look the type up again.
+ * @return what f_ returns, it must return the same type for every pixel type
+ */
+template<typename F>
+auto
+dispatchPixelType(libCZI::PixelType pixel_type_, F&& f_) -> decltype(f_(PixelTraits<libCZI::PixelType::Gray8>()))
+{
+  using PT = libCZI::PixelType;
+  switch (pixel_type_) {
+    case PT::Gray8:
+      return f_(PixelTraits<PT::Gray8>());
+    case PT::Gray16:
+      return f_(PixelTraits<PT::Gray16>());
+    case PT::Gray32:
+      return f_(PixelTraits<PT::Gray32>());
+    case PT::Gray32Float:
+      return f_(PixelTraits<PT::Gray32Float>());
+    case PT::Gray64Float:
+      return f_(PixelTraits<PT::Gray64Float>());
+    case PT::Gray64ComplexFloat:
+      return f_(PixelTraits<PT::Gray64ComplexFloat>());
+    case PT::Bgr24:
+      return f_(PixelTraits<PT::Bgr24>());
+    case PT::Bgra32:
+      return f_(PixelTraits<PT::Bgra32>());
+    case PT::Bgr48:
+      return f_(PixelTraits<PT::Bgr48>());
+    case PT::Bgr96Float:
+      return f_(PixelTraits<PT::Bgr96Float>());
+    case PT::Bgr192ComplexFloat:
+      return f_(PixelTraits<PT::Bgr192ComplexFloat>());
+    default:
+      throw PixelTypeException(pixel_type_, "unsupported pixel type.");
+  }
+}
+
+/*!
+ * @brief true if the samples of pixel_type_ are stored as T, false for PixelType::Invalid
+ */
+template<typename T>
+inline bool
+isSampleType(libCZI::PixelType pixel_type_)
+{
+  if (pixel_type_ == libCZI::PixelType::Invalid)
+    return false;
+  return dispatchPixelType(pixel_type_,
+                           [](auto traits_) { return std::is_same<typename decltype(traits_)::Sample, T>::value; });
+}
+
+}
+
+#endif //_AICSPYLIBCZI_PIXELTRAITS_H
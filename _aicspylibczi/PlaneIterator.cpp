@@ -0,0 +1,83 @@
+#include "PlaneIterator.h"
+#include "exceptions.h"
+
+namespace pylibczi {
+
+PlaneIterator::PlaneIterator(size_t number_of_groups_, size_t in_flight_, Read read_)
+  : m_numberOfGroups(number_of_groups_)
+  , m_inFlight(in_flight_)
+  , m_read(std::move(read_))
+{
+  if (m_inFlight > 0 && m_numberOfGroups > 0)
+    m_reader = std::thread([this]() { readAhead(); });
+}
+
+PlaneIterator::~PlaneIterator()
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_stop = true;
+  }
+  m_changed.notify_all();
+  if (m_reader.joinable())
+    m_reader.join();
+}
+
+PlaneIterator::Planes
+PlaneIterator::next()
+{
+  if (!hasNext())
+    throw ImageIteratorException("There are no more planes to iterate over.");
+
+  if (m_inFlight == 0) {
+    size_t group = m_nextGroup;
+    m_nextGroup = m_numberOfGroups; // an exception ends the iteration
+    Planes planes = m_read(group);
+    m_nextGroup = group + 1;
+    return planes;
+  }
+
+  Slot slot;
+  {
+    std::unique_lock<std::mutex> lck(m_mutex);
+    m_changed.wait(lck, [this] { return !m_ready.empty(); });
+    slot = std::move(m_ready.front());
+    m_ready.pop_front();
+  }
+  m_changed.notify_all(); // there is room for another group
+  m_nextGroup++;
+  if (slot.error) {
+    m_nextGroup = m_numberOfGroups;
+    std::rethrow_exception(slot.error);
+  }
+  return std::move(slot.planes);
+}
+
+void
+PlaneIterator::readAhead()
+{
+  for (size_t group = 0; group < m_numberOfGroups; group++) {
+    {
+      std::unique_lock<std::mutex> lck(m_mutex);
+      m_changed.wait(lck, [this] { return m_stop || m_ready.size() < m_inFlight; });
+      if (m_stop)
+        return;
+    }
+    Slot slot;
+    try {
+      slot.planes = m_read(group);
+    } catch (...) {
+      slot.error = std::current_exception();
+    }
+    bool failed = slot.error != nullptr;
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      m_ready.push_back(std::move(slot));
+    }
+    m_changed.notify_all();
+    if (failed)
+      return; // next() ends the iteration when it gets to the error
+  }
+}
+
+}
@@ -0,0 +1,78 @@
+#ifndef _AICSPYLIBCZI_PLANEITERATOR_H
+#define _AICSPYLIBCZI_PLANEITERATOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ImagesContainer.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief Steps through a selection of subblocks a group of planes at a time, see Reader::planeIterator.
+ *
+ * A background thread reads the groups in order and keeps at most inFlight of them ahead of the caller, it waits
+ * while they haven't been taken. However large the selection, the iterator never holds more than inFlight groups
+ * and the caller decides how long it keeps the ones it took. With an inFlight of 0 each group is read in next() on
+ * the calling thread.
+ */
+class PlaneIterator
+{
+public:
+  using Planes = std::pair<ImagesContainerBase::ImagesContainerBasePtr, std::vector<std::pair<char, size_t>>>;
+  using Read = std::function<Planes(size_t group_)>;
+
+  /*!
+   * @param number_of_groups_ the number of groups, next() returns read_(0) to read_(number_of_groups_ - 1)
+   * @param in_flight_ the number of groups read ahead of the caller
+   * @param read_ reads one group, called in group order from one thread at a time
+   */
+  PlaneIterator(size_t number_of_groups_, size_t in_flight_, Read read_);
+
+  PlaneIterator(const PlaneIterator&) = delete;
+  PlaneIterator& operator=(const PlaneIterator&) = delete;
+
+  /*!
+   * @brief stops reading ahead, a group that is being read is finished first
+   */
+  ~PlaneIterator();
+
+  size_t numberOfGroups() const { return m_numberOfGroups; }
+
+  bool hasNext() const { return m_nextGroup < m_numberOfGroups; }
+
+  /*!
+   * @brief the next group, once it has been read. An exception thrown reading the group is rethrown here and ends the
+   * iteration. Throws ImageIteratorException if there are no groups left.
+   */
+  Planes next();
+
+private:
+  struct Slot
+  {
+    Planes planes;
+    std::exception_ptr error;
+  };
+
+  void readAhead();
+
+  const size_t m_numberOfGroups;
+  const size_t m_inFlight;
+  Read m_read;
+  size_t m_nextGroup = 0; ///< the group next() returns, only used by the caller's thread
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  std::deque<Slot> m_ready; ///< the groups read ahead, guarded by m_mutex
+  bool m_stop = false;      ///< guarded by m_mutex
+  std::thread m_reader;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_PLANEITERATOR_H
@@ -0,0 +1,245 @@
+#include "Projection.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+
+#include "PixelTraits.h"
+#include "Threadpool.h"
+#include "exceptions.h"
+
+namespace pylibczi {
+
+namespace {
+using RowKernel = void (*)(const void* source_, void* accumulator_, size_t samples_);
+using FillKernel = void (*)(void* accumulator_, size_t samples_);
+using ColumnKernel = void (*)(const void* row_, void* accumulator_, size_t pixels_, size_t bin_, size_t samples_);
+
+// the loops are written so the compiler vectorizes them, a sample that is NaN never replaces the maximum
+template<typename S>
+void
+maxRow(const void* source_, void* accumulator_, size_t samples_)
+{
+  const S* source = static_cast<const S*>(source_);
+  S* accumulator = static_cast<S*>(accumulator_);
+  for (size_t i = 0; i < samples_; i++)
+    accumulator[i] = accumulator[i] < source[i] ? source[i] : accumulator[i];
+}
+
+template<typename S>
+void
+sumRow(const void* source_, void* accumulator_, size_t samples_)
+{
+  const S* source = static_cast<const S*>(source_);
+  double* accumulator = static_cast<double*>(accumulator_);
+  for (size_t i = 0; i < samples_; i++)
+    accumulator[i] += static_cast<double>(source[i]);
+}
+
+template<typename A>
+void
+maxColumns(const void* row_, void* accumulator_, size_t pixels_, size_t bin_, size_t samples_)
+{
+  const A* row = static_cast<const A*>(row_);
+  A* accumulator = static_cast<A*>(accumulator_);
+  for (size_t p = 0; p < pixels_; p++) {
+    for (size_t s = 0; s < samples_; s++) {
+      A value = accumulator[p * samples_ + s];
+      for (size_t b = 0; b < bin_; b++) {
+        A sample = row[(p * bin_ + b) * samples_ + s];
+        value = value < sample ? sample : value;
+      }
+      accumulator[p * samples_ + s] = value;
+    }
+  }
+}
+
+void
+sumColumns(const void* row_, void* accumulator_, size_t pixels_, size_t bin_, size_t samples_)
+{
+  const double* row = static_cast<const double*>(row_);
+  double* accumulator = static_cast<double*>(accumulator_);
+  for (size_t p = 0; p < pixels_; p++) {
+    for (size_t s = 0; s < samples_; s++) {
+      double value = 0.0;
+      for (size_t b = 0; b < bin_; b++)
+        value += row[(p * bin_ + b) * samples_ + s];
+      accumulator[p * samples_ + s] += value;
+    }
+  }
+}
+
+template<typename A>
+void
+fillLowest(void* accumulator_, size_t samples_)
+{
+  std::fill_n(static_cast<A*>(accumulator_), samples_, std::numeric_limits<A>::lowest());
+}
+
+void
+fillZero(void* accumulator_, size_t samples_)
+{
+  std::fill_n(static_cast<double*>(accumulator_), samples_, 0.0);
+}
+
+struct Kernels
+{
+  RowKernel accumulate;
+  RowKernel merge;
+  FillKernel fill;
+  ColumnKernel foldColumns;
+  size_t sourceSampleBytes;
+  size_t accumulatorBytes;
+};
+
+template<typename S>
+Kernels
+kernelsOf(Projection::Mode mode_, std::true_type /* real samples */)
+{
+  if (mode_ == Projection::Mode::Max)
+    return Kernels{ &maxRow<S>, &maxRow<S>, &fillLowest<S>, &maxColumns<S>, sizeof(S), sizeof(S) };
+  return Kernels{ &sumRow<S>, &sumRow<double>, &fillZero, &sumColumns, sizeof(S), sizeof(double) };
+}
+
+template<typename S>
+Kernels
+kernelsOf(Projection::Mode, std::false_type /* complex samples */)
+{
+  return Kernels{}; // outputType has refused them
+}
+}
+
+libCZI::PixelType
+Projection::outputType(Mode mode_, libCZI::PixelType pixel_type_)
+{
+  return dispatchPixelType(pixel_type_, [mode_, pixel_type_](auto traits_) {
+    if (!std::is_arithmetic<typename decltype(traits_)::Sample>::value)
+      throw PixelTypeException(pixel_type_, "complex samples can't be projected.");
+    return mode_ == Mode::Max ? pixel_type_ : libCZI::PixelType::Gray64Float;
+  });
+}
+
+Projection::Projection(Mode mode_,
+                       libCZI::PixelType pixel_type_,
+                       libCZI::IntSize size_,
+                       std::vector<size_t> depths_,
+                       size_t bin_x_,
+                       size_t bin_y_,
+                       void* external_memory_,
+                       const PixelMemory::Policy& policy_,
+                       unsigned int cores_)
+  : m_mode(mode_)
+  , m_size(size_)
+  , m_binX(std::max<size_t>(bin_x_, 1))
+  , m_binY(std::max<size_t>(bin_y_, 1))
+  , m_binnedSize{ static_cast<std::uint32_t>(size_.w / m_binX), static_cast<std::uint32_t>(size_.h / m_binY) }
+  , m_depths(std::move(depths_))
+  , m_planes(m_depths.size())
+{
+  libCZI::PixelType resultType = outputType(mode_, pixel_type_);
+  size_t samples = 0;
+  Kernels kernels = dispatchPixelType(pixel_type_, [mode_, &samples](auto traits_) {
+    using Traits = decltype(traits_);
+    samples = Traits::s_samples;
+    return kernelsOf<typename Traits::Sample>(mode_, std::is_arithmetic<typename Traits::Sample>());
+  });
+  m_accumulate = kernels.accumulate;
+  m_merge = kernels.merge;
+  m_fill = kernels.fill;
+  m_foldColumns = kernels.foldColumns;
+  m_samples = samples;
+  m_samplesPerRow = static_cast<size_t>(m_binnedSize.w) * samples;
+  m_sourceRowBytes = static_cast<size_t>(m_size.w) * samples * kernels.sourceSampleBytes;
+  m_accumulatorBytes = kernels.accumulatorBytes;
+
+  // the container counts pixels of its own type, Gray64Float has one sample where the source may have three
+  size_t resultSamples = dispatchPixelType(resultType, [](auto traits_) { return decltype(traits_)::s_samples; });
+  m_result = ImagesContainerBase::getTypedAsBase(
+    resultType, numberOfPlanes() * samplesPerPlane() / resultSamples, external_memory_, policy_, cores_);
+  m_resultMemory = dispatchPixelType(resultType, [this](auto traits_) -> void* {
+    return m_result->getBaseAsTyped<typename decltype(traits_)::Sample>()->getPointerAtIndex(0);
+  });
+  m_fill(m_resultMemory, numberOfPlanes() * samplesPerPlane());
+  size_t planeBytes = samplesPerPlane() * m_accumulatorBytes;
+  for (size_t p = 0; p < numberOfPlanes(); p++) {
+    m_planes[p].result.data = static_cast<std::uint8_t*>(m_resultMemory) + p * planeBytes;
+    m_planes[p].partials.seed(&m_planes[p].result);
+  }
+}
+
+void
+Projection::accumulate(size_t plane_, const void* data_ptr_, size_t stride_, libCZI::IntSize size_)
+{
+  if (size_.w != m_size.w || size_.h != m_size.h)
+    throw RegionSelectionException({ 0, 0, static_cast<int>(size_.w), static_cast<int>(size_.h) },
+                                   { 0, 0, static_cast<int>(m_size.w), static_cast<int>(m_size.h) },
+                                   "Every subblock of a projection must have the size of its plane.");
+  if (stride_ < m_sourceRowBytes) {
+    std::stringstream msg;
+    msg << "Stride < width : " << stride_ << " < " << size_.w << std::endl;
+    throw StrideAssumptionException(msg.str());
+  }
+
+  PartialPool<PlanePartial>& partials = m_planes[plane_].partials;
+  PlanePartial* partial = partials.acquire([this]() {
+    std::unique_ptr<PlanePartial> ans(
+      new PlanePartial{ nullptr, std::make_unique<PixelMemory>(samplesPerPlane() * m_accumulatorBytes) });
+    ans->data = ans->memory->data();
+    m_fill(ans->data, samplesPerPlane());
+    return ans;
+  });
+  auto accumulator = static_cast<std::uint8_t*>(partial->data);
+  auto source = static_cast<const std::uint8_t*>(data_ptr_);
+  size_t rowBytes = m_samplesPerRow * m_accumulatorBytes;
+  if (m_binX == 1 && m_binY == 1 && stride_ == m_sourceRowBytes) { // the rows are packed, fold them in one go
+    m_accumulate(source, accumulator, samplesPerPlane());
+  } else if (m_binX == 1) { // the binY rows of a bin are folded straight into its row
+    for (std::uint32_t j = 0; j < m_binnedSize.h; j++) {
+      for (size_t k = 0; k < m_binY; k++)
+        m_accumulate(source + (j * m_binY + k) * stride_, accumulator + j * rowBytes, m_samplesPerRow);
+    }
+  } else {
+    // the binY rows are folded into one full width row first, which is the bulk of the work and runs over
+    // contiguous samples, then binX columns of it at a time into each pixel
+    size_t rowSamples = m_samplesPerRow * m_binX;
+    std::vector<double> row((rowSamples * m_accumulatorBytes + sizeof(double) - 1) / sizeof(double));
+    for (std::uint32_t j = 0; j < m_binnedSize.h; j++) {
+      m_fill(row.data(), rowSamples);
+      for (size_t k = 0; k < m_binY; k++)
+        m_accumulate(source + (j * m_binY + k) * stride_, row.data(), rowSamples);
+      m_foldColumns(row.data(), accumulator + j * rowBytes, m_binnedSize.w, m_binX, m_samples);
+    }
+  }
+  partials.release(partial);
+  // every other thread adding to the plane has released its partial before counting its subblock
+  if (++m_planes[plane_].accumulated == m_depths[plane_])
+    merge(plane_);
+}
+
+ImagesContainerBase::ImagesContainerBasePtr
+Projection::finish(unsigned int cores_)
+{
+  // the planes are merged as their last subblock is added, this is for a plane that got fewer than its depth
+  ThreadPool::instance().parallelFor(numberOfPlanes(), cores_, [this](size_t p_) {
+    merge(p_);
+    if (m_mode == Mode::Mean) {
+      double* mean = static_cast<double*>(m_planes[p_].result.data);
+      double depth = static_cast<double>(m_depths[p_] * m_binX * m_binY);
+      for (size_t i = 0; i < samplesPerPlane(); i++)
+        mean[i] /= depth;
+    }
+  });
+  return std::move(m_result);
+}
+
+void
+Projection::merge(size_t plane_)
+{
+  Plane& plane = m_planes[plane_];
+  for (const auto& partial : plane.partials.take())
+    m_merge(partial->data, plane.result.data, samplesPerPlane());
+}
+
+}
@@ -0,0 +1,155 @@
+#ifndef _AICSPYLIBCZI_PROJECTION_H
+#define _AICSPYLIBCZI_PROJECTION_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "ImagesContainer.h"
+#include "PartialPool.h"
+#include "PixelMemory.h"
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief The maximum, mean or sum of the subblocks of stacks of planes, eg the maximum intensity projection of every
+ * Z-stack of a time-lapse, accumulated as the subblocks are decoded instead of reading the whole stack first. The
+ * blocks of binX by binY pixels of the planes can be folded too, which bins them.
+ *
+ * The result holds one plane per stack. Every thread accumulating into a plane takes a partial of that plane of its
+ * own, the plane of the result itself for the first, so the decode threads never wait on each other. The thread adding
+ * the last subblock of a plane merges the plane's partials into the result. The memory beyond the result is therefore
+ * only the partials of the planes still being accumulated, at most one less than the threads accumulating into each
+ * of them at once, eg cores - 1 planes when the subblocks of one stack are decoded together.
+ */
+class Projection
+{
+public:
+  enum class Mode
+  {
+    Max,  ///< the samples keep the pixel type of the file
+    Mean, ///< the samples are doubles, summed as doubles and divided by the depth of their stack
+    Sum   ///< the samples are doubles
+  };
+
+  /*!
+   * @brief the pixel type of the result, Gray64Float for Mean and Sum, the BGR types keep their samples in an A
+   * dimension of the shape
+   * @throw PixelTypeException for complex pixel types
+   */
+  static libCZI::PixelType outputType(Mode mode_, libCZI::PixelType pixel_type_);
+
+  /*!
+   * @param pixel_type_ the pixel type of the subblocks
+   * @param size_ the size of every plane, the accumulated subblocks must have it
+   * @param depths_ the number of subblocks accumulated into each plane of the result
+   * @param bin_x_ (optional) the columns folded into one, the columns left over at the right are dropped
+   * @param bin_y_ (optional) the rows folded into one, the rows left over at the bottom are dropped
+   * @param external_memory_ (optional) memory owned by the caller for the result, see ImagesContainerBase
+   * @param policy_ (optional) how the memory of the result is allocated, the partials are plain allocations
+   */
+  Projection(Mode mode_,
+             libCZI::PixelType pixel_type_,
+             libCZI::IntSize size_,
+             std::vector<size_t> depths_,
+             size_t bin_x_ = 1,
+             size_t bin_y_ = 1,
+             void* external_memory_ = nullptr,
+             const PixelMemory::Policy& policy_ = PixelMemory::Policy(),
+             unsigned int cores_ = 0);
+
+  size_t numberOfPlanes() const { return m_depths.size(); }
+
+  /*!
+   * @brief the size of the planes of the result, size_ divided by the bins
+   */
+  libCZI::IntSize binnedSize() const { return m_binnedSize; }
+
+  /*!
+   * @brief add a subblock to plane_ of the result, may be called from any number of threads at once
+   * @param data_ptr_ the first pixel of the first row
+   * @param stride_ the number of bytes between the start of consecutive rows
+   * @param size_ the size of the subblock, a RegionSelectionException is thrown if it isn't the size of the planes
+   */
+  void accumulate(size_t plane_, const void* data_ptr_, size_t stride_, libCZI::IntSize size_);
+
+  /*!
+   * @brief merge the partials left into the result, and divide it by the depths and bins for Mean, once all subblocks
+   * are accumulated
+   * @return the result, a container of numberOfPlanes planes without images, its shape is up to the caller
+   */
+  ImagesContainerBase::ImagesContainerBasePtr finish(unsigned int cores_);
+
+private:
+  /*!
+   * @brief fold samples_ samples of source_ into accumulator_, the kernels are chosen once for the pixel type
+   */
+  using RowKernel = void (*)(const void* source_, void* accumulator_, size_t samples_);
+  using FillKernel = void (*)(void* accumulator_, size_t samples_);
+  /*!
+   * @brief fold bin_ pixels of samples_ samples of row_ at a time into each of pixels_ pixels of accumulator_
+   */
+  using ColumnKernel = void (*)(const void* row_, void* accumulator_, size_t pixels_, size_t bin_, size_t samples_);
+
+  Mode m_mode;
+  libCZI::IntSize m_size;
+  size_t m_binX;
+  size_t m_binY;
+  libCZI::IntSize m_binnedSize;
+  std::vector<size_t> m_depths;
+  size_t m_samples;          ///< the samples of a pixel
+  size_t m_samplesPerRow;    ///< the samples of one row of a plane of the result
+  size_t m_sourceRowBytes;   ///< the bytes of the samples of a row of a subblock
+  size_t m_accumulatorBytes; ///< the bytes of one accumulated sample
+  RowKernel m_accumulate = nullptr;
+  RowKernel m_merge = nullptr; ///< m_accumulate for a partial as the source
+  FillKernel m_fill = nullptr; ///< sets the samples to what the accumulation starts from
+  ColumnKernel m_foldColumns = nullptr;
+
+  /*!
+   * @brief the accumulated samples of one plane, the plane of the result or a partial of it
+   */
+  struct PlanePartial
+  {
+    void* data;
+    std::unique_ptr<PixelMemory> memory; ///< nullptr for the plane of the result
+  };
+
+  /*!
+   * @brief the partials of one plane of the result
+   */
+  struct Plane
+  {
+    PlanePartial result;
+    PartialPool<PlanePartial> partials;   ///< seeded with the result
+    std::atomic<size_t> accumulated{ 0 }; ///< the subblocks added to the plane
+  };
+
+  ImagesContainerBase::ImagesContainerBasePtr m_result;
+  void* m_resultMemory;
+  std::vector<Plane> m_planes;
+
+  size_t samplesPerPlane() const { return m_samplesPerRow * m_binnedSize.h; }
+
+  /*!
+   * @brief merge the partials of a plane into the result, no thread may be accumulating into it
+   */
+  void merge(size_t plane_);
+};
+
+/*!
+ * @brief the factors Reader::readBinned bins a selection by, 1 leaves an axis as it is
+ */
+struct Binning
+{
+  Projection::Mode mode = Projection::Mode::Mean;
+  size_t x = 1;
+  size_t y = 1;
+  size_t z = 1; ///< the Z planes folded into one, the last bin of a stack is shallower if z doesn't divide it
+};
+
+}
+
+#endif //_AICSPYLIBCZI_PROJECTION_H
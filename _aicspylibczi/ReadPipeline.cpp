@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <numeric>
+
+#include "ReadPipeline.h"
+#include "Threadpool.h"
+
+namespace pylibczi {
+
+constexpr std::uint64_t ReadPipeline::s_maxGap;
+constexpr std::uint64_t ReadPipeline::s_maxRunBytes;
+constexpr std::uint64_t ReadPipeline::s_maxBufferedBytes;
+
+ReadPipeline::ReadPipeline(StreamImplPrefetch& stream_, const std::vector<Job>& jobs_)
+  : m_stream(stream_)
+{
+  std::vector<size_t> order(jobs_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&jobs_](size_t a_, size_t b_) {
+    return jobs_[a_].filePosition < jobs_[b_].filePosition;
+  });
+
+  for (size_t jobIndex : order) {
+    const Job& job = jobs_[jobIndex];
+    bool sized = job.filePosition >= 0 && job.extent > 0 && static_cast<std::uint64_t>(job.extent) <= s_maxRunBytes;
+    auto offset = static_cast<std::uint64_t>(std::max<std::int64_t>(job.filePosition, 0));
+    auto end = offset + static_cast<std::uint64_t>(std::max<std::int64_t>(job.extent, 0));
+    if (sized && !m_runs.empty() && m_runs.back().prefetch) {
+      Run& last = m_runs.back();
+      std::uint64_t lastEnd = last.offset + last.length;
+      if (offset >= last.offset && offset <= lastEnd + s_maxGap && end - last.offset <= s_maxRunBytes) {
+        last.length = std::max(lastEnd, end) - last.offset;
+        last.jobs.push_back(jobIndex);
+        continue;
+      }
+    }
+    m_runs.push_back(Run{ offset, sized ? end - offset : 0, sized, { jobIndex } });
+  }
+}
+
+std::vector<size_t>
+ReadPipeline::readOrder() const
+{
+  std::vector<size_t> ans;
+  for (const auto& run : m_runs)
+    ans.insert(ans.end(), run.jobs.begin(), run.jobs.end());
+  return ans;
+}
+
+void
+ReadPipeline::run(unsigned int cores_, const std::function<void(size_t)>& decode_)
+{
+  if (m_runs.empty())
+    return;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  size_t nextRun = 0;
+  bool fetching = false;
+  std::uint64_t bufferedBytes = 0;
+  std::deque<std::pair<size_t, size_t>> ready; // (run, job) pairs whose data is in memory
+  std::vector<size_t> remaining(m_runs.size());
+  std::vector<StreamImplPrefetch::Buffer> buffers(m_runs.size());
+  std::exception_ptr error;
+
+  auto release = [&](size_t run_) {
+    // called with the mutex held
+    if (buffers[run_] != nullptr) {
+      m_stream.removeSpan(buffers[run_]);
+      bufferedBytes -= m_runs[run_].length;
+      buffers[run_].reset();
+    }
+  };
+
+  auto worker = [&](size_t) {
+    std::unique_lock<std::mutex> lck(mutex);
+    while (!error) {
+      if (!ready.empty()) {
+        auto item = ready.front();
+        ready.pop_front();
+        lck.unlock();
+        std::exception_ptr failed;
+        try {
+          decode_(item.second);
+        } catch (...) {
+          failed = std::current_exception();
+        }
+        lck.lock();
+        if (failed && !error)
+          error = failed;
+        if (--remaining[item.first] == 0)
+          release(item.first);
+        changed.notify_all();
+        continue;
+      }
+      // fetch the next run when nobody else is and there's room, or when there's nothing left to decode
+      if (nextRun < m_runs.size() && !fetching && (bufferedBytes < s_maxBufferedBytes || ready.empty())) {
+        size_t runIndex = nextRun++;
+        const Run& run = m_runs[runIndex];
+        fetching = true;
+        lck.unlock();
+        StreamImplPrefetch::Buffer buffer;
+        std::exception_ptr failed;
+        try {
+          if (run.prefetch)
+            buffer = m_stream.prefetch(run.offset, run.length);
+        } catch (...) {
+          failed = std::current_exception();
+        }
+        lck.lock();
+        fetching = false;
+        if (failed) {
+          if (!error)
+            error = failed;
+        } else {
+          buffers[runIndex] = buffer;
+          if (buffer != nullptr)
+            bufferedBytes += run.length;
+          remaining[runIndex] = run.jobs.size();
+          for (size_t job : run.jobs)
+            ready.emplace_back(runIndex, job);
+        }
+        changed.notify_all();
+        continue;
+      }
+      if (nextRun >= m_runs.size() && !fetching)
+        return; // everything is fetched and queued, the jobs in flight belong to other threads
+      changed.wait(lck);
+    }
+  };
+
+  ThreadPool::instance().parallelFor(ThreadPool::coresFor(cores_), cores_, worker);
+
+  std::lock_guard<std::mutex> lck(mutex);
+  for (size_t i = 0; i < m_runs.size(); i++)
+    release(i);
+  if (error)
+    std::rethrow_exception(error);
+}
+
+}
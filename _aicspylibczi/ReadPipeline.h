@@ -0,0 +1,69 @@
+#ifndef _AICSPYLIBCZI_READPIPELINE_H
+#define _AICSPYLIBCZI_READPIPELINE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "StreamImplPrefetch.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief Schedules the reads of a set of subblocks in file order and overlaps them with decoding.
+ *
+ * The subblocks are sorted by file position and neighbouring segments are merged into runs, each run is fetched with
+ * a single read into a StreamImplPrefetch span. The threads working on the pipeline take turns at being the IO
+ * stage: a free thread decodes a subblock whose run is already in memory, otherwise it fetches the next run in file
+ * order. Only one run is fetched at a time so the device sees sequential reads, and the bytes held in spans are
+ * bounded so memory doesn't grow with the size of the selection.
+ */
+class ReadPipeline
+{
+public:
+  struct Job
+  {
+    int subblockIndex;
+    std::int64_t filePosition; ///< where the subblock segment starts
+    std::int64_t extent;       ///< upper bound on the segment size, -1 if unknown
+  };
+
+  static constexpr std::uint64_t s_maxGap = 1 << 20;                ///< merge segments at most this far apart
+  static constexpr std::uint64_t s_maxRunBytes = 32 << 20;          ///< the largest single read issued
+  static constexpr std::uint64_t s_maxBufferedBytes = 4 * s_maxRunBytes; ///< fetched but not yet decoded
+
+  /*!
+   * @param stream_ the stream the CCZIReader was opened with, the runs are added to it as spans
+   * @param jobs_ the subblocks to read, the order is the order decode_ is told about them in
+   */
+  ReadPipeline(StreamImplPrefetch& stream_, const std::vector<Job>& jobs_);
+
+  /*!
+   * @brief call decode_(i) for every job i, with at most cores_ threads. The first exception thrown by decode_ is
+   * rethrown once all the threads are done and every span has been released.
+   */
+  void run(unsigned int cores_, const std::function<void(size_t)>& decode_);
+
+  size_t numberOfRuns() const { return m_runs.size(); }
+
+  /*!
+   * @brief the jobs in the order their data is read
+   */
+  std::vector<size_t> readOrder() const;
+
+private:
+  struct Run
+  {
+    std::uint64_t offset;
+    std::uint64_t length;
+    bool prefetch; ///< false if the run is a single subblock read directly by libCZI
+    std::vector<size_t> jobs;
+  };
+
+  StreamImplPrefetch& m_stream;
+  std::vector<Run> m_runs;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_READPIPELINE_H
@@ -1,59 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iterator>
+#include <limits>
+#include <map>
+#include <numeric>
 #include <set>
+#include <stdexcept>
 #include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 
+#include "Cancellation.h"
 #include "ImageFactory.h"
 #include "ImagesContainer.h"
+#include "ReadPipeline.h"
 #include "Reader.h"
-#include "StreamImplLockingRead.h"
+#include "SidecarIndex.h"
+#include "StreamImplMemoryMapped.h"
+#include "StreamImplPositionalRead.h"
 #include "SubblockMetaVec.h"
 #include "Threadpool.h"
+#include "XmlScan.h"
 #include "exceptions.h"
 #include "inc_libCZI.h"
+#include "libCZI/CziParse.h"
 
 namespace pylibczi {
 
-// this ISteam type needs to be threadsafe like StreamImplLockingRead the examples in libCZI are not threadsafe
-Reader::Reader(std::shared_ptr<libCZI::IStream> istream_)
+namespace {
+// grow the [start, end) range of dim_ to hold value_
+void
+widenRange(Reader::DimIndexRangeMap& ranges_, DimIndex dim_, int value_)
+{
+  auto inserted = ranges_.emplace(dim_, std::make_pair(value_, value_ + 1));
+  if (!inserted.second) {
+    inserted.first->second.first = std::min(inserted.first->second.first, value_);
+    inserted.first->second.second = std::max(inserted.first->second.second, value_ + 1);
+  }
+}
+
+// row a_ comes before row b_ in SubblockSortable order
+bool
+sortsBefore(const SubblockDirectory& directory_, SubblockDirectory::Row a_, SubblockDirectory::Row b_, bool is_mosaic_)
+{
+  if (directory_.sortKeyLayout() != 0 && directory_.isLayer0(a_) && directory_.isLayer0(b_))
+    return directory_.sortKey(a_) < directory_.sortKey(b_);
+  for (auto di : Constants::s_sortOrder) {
+    std::int32_t aValue = directory_.dimValue(a_, di), bValue = directory_.dimValue(b_, di);
+    if (aValue != SubblockDirectory::s_unset && bValue != SubblockDirectory::s_unset && aValue != bValue)
+      return aValue < bValue;
+  }
+  int aM = directory_.mIndex(a_), bM = directory_.mIndex(b_);
+  return is_mosaic_ && aM != -1 && bM != -1 && aM < bM;
+}
+
+// a subblock segment is the 32 byte segment header, the subblock header and then the metadata. The subblock header
+// has the metadata, attachment and data sizes followed by the directory entry and is padded to at least 256 bytes.
+constexpr std::uint64_t s_segmentHeaderBytes = 32;
+constexpr std::uint64_t s_subblockSizesBytes = 16;
+constexpr std::uint64_t s_minimumSubblockHeaderBytes = 256;
+constexpr std::uint64_t s_entryFixedBytes = 32; // a "DV" directory entry before its dimension entries
+constexpr std::uint64_t s_dimensionEntryBytes = 20;
+constexpr std::uint64_t s_entryDimensionCount = s_subblockSizesBytes + 28;
+constexpr std::uint64_t s_metadataReadBytes = 4096; // read with the header, most subblock metadata fits
+
+std::atomic<std::uint32_t> s_nextCacheId{ 0 }; // every Reader has its own keys in a shared TileCache
+
+std::shared_ptr<TileCache>
+tileCacheOf(const ReaderResources& resources_)
+{
+  return resources_.tileCache != nullptr ? resources_.tileCache : std::make_shared<TileCache>();
+}
+
+std::int32_t
+int32At(const std::vector<std::uint8_t>& bytes_, std::uint64_t offset_)
+{
+  std::int32_t ans;
+  std::memcpy(&ans, bytes_.data() + offset_, sizeof(ans)); // CZI is little-endian like every supported platform
+  return ans;
+}
+}
+
+constexpr size_t Reader::s_progressiveBatches;
+
+// this ISteam type needs to be threadsafe like StreamImplPositionalRead the examples in libCZI are not threadsafe
+Reader::Reader(std::shared_ptr<libCZI::IStream> istream_, const ReaderResources& resources_)
   : m_czireader(new CCZIReader)
+  , m_stream(std::make_shared<StreamImplPrefetch>(std::move(istream_), resources_.ioScheduler, m_perfCounters))
+  , m_tileCache(tileCacheOf(resources_))
+  , m_cacheId(s_nextCacheId++)
   , m_specifyScene(true)
 {
-  m_czireader->Open(std::move(istream_), nullptr);
+  m_czireader->Open(m_stream, nullptr);
   m_statistics = m_czireader->GetStatistics();
-  m_pixelType = libCZI::PixelType::Invalid; // get the pixeltype of the first readable subblock
-
-  checkSceneShapes();
+  m_directory = SubblockDirectory(*m_czireader);
+  m_directory.buildSortKeys(isMosaic());
+  m_pixelType = getFirstPixelType(); // set once so concurrent reads never write to the Reader
+  // the scene shapes are checked the first time they're needed, see specifyScene
 }
 
-Reader::Reader(const wchar_t* file_name_)
+Reader::Reader(const wchar_t* file_name_,
+               bool memory_map_,
+               const wchar_t* index_file_,
+               const ReaderResources& resources_)
   : m_czireader(new CCZIReader)
+  , m_tileCache(tileCacheOf(resources_))
+  , m_cacheId(s_nextCacheId++)
   , m_specifyScene(true)
-  , m_pixelType(libCZI::PixelType::Invalid)
 {
   std::shared_ptr<libCZI::IStream> sp;
-  sp = std::shared_ptr<libCZI::IStream>(new StreamImplLockingRead(file_name_));
-  m_czireader->Open(sp, nullptr);
+  if (memory_map_)
+    sp = std::shared_ptr<libCZI::IStream>(new StreamImplMemoryMapped(file_name_));
+  else
+    sp = std::shared_ptr<libCZI::IStream>(new StreamImplPositionalRead(file_name_));
+  m_stream = std::make_shared<StreamImplPrefetch>(sp, resources_.ioScheduler, m_perfCounters);
+  std::vector<StreamImplPrefetch::Buffer> indexed;
+  if (index_file_ != nullptr && index_file_[0] != L'\0') {
+    // libCZI parses the directories from the index while the spans are up
+    SidecarIndex index(file_name_, index_file_, *sp);
+    for (const auto& segment : index.segments()) {
+      m_stream->addSpan(segment.offset, segment.data);
+      indexed.push_back(segment.data);
+    }
+  }
+  m_czireader->Open(m_stream, nullptr);
   m_statistics = m_czireader->GetStatistics();
-  // create a reference for finding one or more subblock indices from a CDimCoordinate
-  checkSceneShapes();
+  m_directory = SubblockDirectory(*m_czireader);
+  m_directory.buildSortKeys(isMosaic());
+  m_pixelType = getFirstPixelType();
+  if (!indexed.empty()) {
+    loadFilePositions(); // the directory is parsed again for the positions, do it while it's in memory
+    for (const auto& buffer : indexed)
+      m_stream->removeSpan(buffer);
+  }
+}
+
+Reader::~Reader()
+{
+  *m_closing = true;
+  std::lock_guard<std::mutex> lck(m_prefetchMutex);
+  bool running = std::any_of(m_prefetches.begin(), m_prefetches.end(), [](const std::shared_future<void>& f_) {
+    return f_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+  });
+  // a running prefetch holds its own reference to m_czireader, the file is closed when the last reference goes
+  if (!running)
+    m_czireader->Close();
+}
+
+bool
+Reader::specifyScene()
+{
+  std::call_once(m_shapeChecked, [this]() { checkSceneShapes(); });
+  return m_specifyScene;
 }
 
 void
 Reader::checkSceneShapes()
 {
-  auto dShapes = readDimsRange();
+  auto dShapes = allSceneShapes();
   m_specifyScene = !consistentShape(dShapes);
 }
 
+void
+Reader::summarizeScenes()
+{
+  std::call_once(m_scenesSummarized, [this]() {
+    bool mosaic = isMosaic();
+    auto add = [this, mosaic](SceneSummary& summary_, SubblockDirectory::Row row_) {
+      for (auto di : Constants::s_sortOrder) {
+        std::int32_t value = m_directory.dimValue(row_, di);
+        if (value != SubblockDirectory::s_unset)
+          widenRange(summary_.ranges, dimensionIndexToDimIndex(di), value);
+      }
+      if (mosaic)
+        widenRange(summary_.ranges, DimIndex::M, m_directory.mIndex(row_));
+      if (summary_.firstRow < 0 || sortsBefore(m_directory, row_, SubblockDirectory::Row(summary_.firstRow), mosaic)) {
+        summary_.firstRow = static_cast<int>(row_);
+        summary_.firstRect = m_directory.logicalRect(row_);
+      }
+    };
+    for (auto row : m_directory.layer0Rows()) {
+      std::int32_t scene = m_directory.dimValue(row, libCZI::DimensionIndex::S);
+      add(scene == SubblockDirectory::s_unset ? m_unscenedSummary : m_sceneSummaries[scene], row);
+    }
+    // a subblock without S matches every scene, as it does in getMatches
+    for (auto& scene : m_sceneSummaries) {
+      for (const auto& range : m_unscenedSummary.ranges) {
+        widenRange(scene.second.ranges, range.first, range.second.first);
+        widenRange(scene.second.ranges, range.first, range.second.second - 1);
+      }
+    }
+  });
+}
+
+const Reader::SceneSummary&
+Reader::sceneSummary(int scene_index_)
+{
+  summarizeScenes();
+  auto found = m_sceneSummaries.find(scene_index_);
+  return found == m_sceneSummaries.end() ? m_unscenedSummary : found->second;
+}
+
 std::string
 Reader::readMeta()
 {
-  auto mds = m_czireader->ReadMetadataSegment();
-  auto md = mds->CreateMetaFromMetadataSegment();
-  std::string xml = md->GetXml();
-  return xml;
+  std::call_once(m_metadataSerialized, [this]() {
+    readMetaXml();
+    m_metadataString = m_metadataSegment->CreateMetaFromMetadataSegment()->GetXml();
+  });
+  return m_metadataString;
+}
+
+Reader::RawMetadata
+Reader::readMetaXml()
+{
+  std::call_once(m_metadataLoaded, [this]() {
+    m_metadataSegment = m_czireader->ReadMetadataSegment();
+    size_t size = 0;
+    auto data = m_metadataSegment->GetRawData(libCZI::IMetadataSegment::XmlMetadata, &size);
+    // writers may pad the segment with zeros
+    auto xml = static_cast<const char*>(data.get());
+    while (size > 0 && xml[size - 1] == '\0')
+      size--;
+    m_metadataXml = RawMetadata{ std::move(data), size };
+  });
+  return m_metadataXml;
+}
+
+Reader::MetadataSummary
+Reader::readMetaSummary()
+{
+  std::call_once(m_metadataSummarized, [this]() {
+    constexpr double unknown = std::numeric_limits<double>::quiet_NaN();
+    RawMetadata xml = readMetaXml();
+    m_metadataSummary = MetadataSummary{ unknown, unknown, unknown, {}, {} };
+    auto scaling = m_metadataSegment->CreateMetaFromMetadataSegment()->GetDocumentInfo()->GetScalingInfo();
+    if (scaling.IsScaleXValid())
+      m_metadataSummary.scaleX = scaling.scaleX;
+    if (scaling.IsScaleYValid())
+      m_metadataSummary.scaleY = scaling.scaleY;
+    if (scaling.IsScaleZValid())
+      m_metadataSummary.scaleZ = scaling.scaleZ;
+
+    XmlScan scan(static_cast<const char*>(xml.data.get()), xml.size);
+    const std::string image = "ImageDocument/Metadata/Information/Image/";
+    m_metadataSummary.channelNames = scan.attributes(image + "Dimensions/Channels/Channel", "Name");
+    scan.text(image + "AcquisitionDateAndTime", m_metadataSummary.acquisitionTime);
+  });
+  return m_metadataSummary;
 }
 
 bool
@@ -67,6 +264,17 @@ Reader::isMosaic() const
 /// @return A Python Dictionary as a PyObject*
 Reader::DimsShape
 Reader::readDimsRange()
+{
+  DimsShape ans = allSceneShapes();
+  if (ans.size() > 1 && !specifyScene()) {
+    ans[0][DimIndex::S].second = (*(ans.rbegin()))[DimIndex::S].second;
+    ans.resize(1); // remove the exta channels
+  }
+  return ans;
+}
+
+Reader::DimsShape
+Reader::allSceneShapes()
 {
   DimsShape ans;
   int sceneStart(0), sceneSize(0);
@@ -76,10 +284,6 @@ Reader::readDimsRange()
   }
   for (int i = sceneStart; i < sceneStart + sceneSize; i++)
     ans.push_back(sceneShape(i));
-  if (!m_specifyScene && ans.size() > 1) {
-    ans[0][DimIndex::S].second = (*(ans.rbegin()))[DimIndex::S].second;
-    ans.resize(1); // remove the exta channels
-  }
   return ans;
 }
 
@@ -89,7 +293,7 @@ std::vector<int>
 Reader::dimSizes()
 {
   std::string dString = dimsString();
-  if (m_specifyScene)
+  if (specifyScene())
     return std::vector<int>(dString.size(), -1);
 
   DimIndexRangeMap tbl;
@@ -110,7 +314,6 @@ Reader::dimSizes()
   ans.push_back(sbsize.h);
   ans.push_back(sbsize.w);
 
-  pixelType();
   if (ImageFactory::numberOfSamples(m_pixelType) > 1)
     ans.push_back((int)ImageFactory::numberOfSamples(m_pixelType));
 
@@ -150,7 +353,6 @@ Reader::sceneShape(int scene_index_)
   bool sceneBool(false);
   int sceneStart(0), sceneSize(0);
   tie(sceneBool, sceneStart, sceneSize) = scenesStartSize();
-  pixelType(); // this may look like it isn't used but it's setting m_pixelType
 
   DimIndexRangeMap tbl;
 
@@ -174,24 +376,8 @@ Reader::sceneShape(int scene_index_)
          << "[" << sceneStart << ", " << sceneStart + sceneSize << ")";
       throw CDimCoordinatesOverspecifiedException(ss.str());
     }
-    libCZI::CDimCoordinate cDim{ { libCZI::DimensionIndex::S, scene_index_ } };
-    SubblockSortable sceneToFind(&cDim, -1, false);
-    SubblockIndexVec matches = getMatches(sceneToFind);
-
-    // get the condensed set of values
-    std::map<DimIndex, set<int>> definedDims;
-    for (const auto& x : matches) {
-      x.first.coordinatePtr()->EnumValidDimensions([&definedDims](libCZI::DimensionIndex di_, int val_) -> bool {
-        definedDims[dimensionIndexToDimIndex(di_)].emplace(val_);
-        return true;
-      });
-      if (isMosaic()) {
-        definedDims[DimIndex::M].emplace(x.first.mIndex());
-      }
-    }
-    for (auto x : definedDims) {
-      tbl.emplace(x.first, std::make_pair(*x.second.begin(), *x.second.rbegin() + 1));
-    }
+    // the ranges of the subblocks getMatches would find for the scene
+    tbl = sceneSummary(scene_index_).ranges;
 
     auto xySize = getSceneYXSize(scene_index_);
     tbl.emplace(DimIndex::Y, std::make_pair(0, xySize.h));
@@ -222,10 +408,8 @@ Reader::getAllSceneYXSize(int scene_index_, bool get_all_matches_)
     if (hasScene) {
       x.first.coordinatePtr()->TryGetPosition(libCZI::DimensionIndex::S, &embeddedSceneIndex);
       if (embeddedSceneIndex == scene_index_) {
-        int index = x.second;
-        auto subblk = m_czireader->ReadSubBlock(index);
-        auto sbkInfo = subblk->GetSubBlockInfo();
-        result.emplace_back(sbkInfo.logicalRect);
+        // the directory entry has the rect, reading the subblock would read its pixels too
+        result.emplace_back(m_directory.logicalRect(m_directory.rowOfSubblock(x.second)));
         if (!get_all_matches_)
           return result;
       }
@@ -234,27 +418,52 @@ Reader::getAllSceneYXSize(int scene_index_, bool get_all_matches_)
   if (hasScene && !result.empty())
     return result;
 
-  m_czireader->EnumerateSubBlocks([&result, get_all_matches_](int index, const libCZI::SubBlockInfo& info) -> bool {
-    if (!isPyramid0(info))
-      return true;
-
-    result.emplace_back(info.logicalRect);
-    return get_all_matches_;
-  });
+  for (auto row : m_directory.layer0Rows()) {
+    result.emplace_back(m_directory.logicalRect(row));
+    if (!get_all_matches_)
+      break;
+  }
   return result;
 }
 
+libCZI::IntRect
+Reader::getSceneYXSize(int scene_index_)
+{
+  if (scene_index_ >= 0 && m_statistics.dimBounds.IsValid(libCZI::DimensionIndex::S)) {
+    summarizeScenes();
+    auto found = m_sceneSummaries.find(scene_index_);
+    if (found != m_sceneSummaries.end())
+      return found->second.firstRect;
+  }
+  const auto& layer0 = m_directory.layer0Rows();
+  return layer0.empty() ? libCZI::IntRect{ 0, 0, 0, 0 } : m_directory.logicalRect(layer0.front());
+}
+
+int
+Reader::sceneOf(const SubblockIndexVec& matches_)
+{
+  // the matches of a file with inconsistent scene shapes are all of one scene, see selectedMatches
+  int scene = -1;
+  if (specifyScene() && !matches_.empty())
+    matches_.begin()->first.coordinatePtr()->TryGetPosition(libCZI::DimensionIndex::S, &scene);
+  return scene;
+}
+
+libCZI::IntRect
+Reader::checkRoi(const SubblockIndexVec& matches_, const libCZI::IntRect& roi_)
+{
+  libCZI::IntRect w_by_h = getSceneYXSize(sceneOf(matches_));
+  if (!isRoi(roi_))
+    return w_by_h;
+  isValidRegion(roi_, { 0, 0, w_by_h.w, w_by_h.h }); // if not throws RegionSelectionException
+  return roi_;
+}
+
 libCZI::PixelType
-Reader::getFirstPixelType()
+Reader::getFirstPixelType() const
 {
-  libCZI::PixelType pixelType = libCZI::PixelType::Invalid;
-  m_czireader->EnumerateSubBlocks([&pixelType](int index_, const libCZI::SubBlockInfo& info_) -> bool {
-    if (!isPyramid0(info_))
-      return true;
-    pixelType = info_.pixelType;
-    return false;
-  });
-  return pixelType;
+  const auto& layer0 = m_directory.layer0Rows();
+  return layer0.empty() ? libCZI::PixelType::Invalid : m_directory.pixelType(layer0.front());
 }
 
 /// @brief get the Dimensions in the order they appear in
@@ -277,7 +486,6 @@ Reader::dimsString()
 
   ans += "YX";
 
-  pixelType();
   if (ImageFactory::numberOfSamples(m_pixelType) > 1)
     ans += "A";
 
@@ -285,77 +493,525 @@ Reader::dimsString()
 }
 
 std::pair<ImagesContainerBase::ImagesContainerBasePtr, std::vector<std::pair<char, size_t>>>
-Reader::readSelected(libCZI::CDimCoordinate& plane_coord_, int index_m_, unsigned int cores_)
+Reader::readSelected(libCZI::CDimCoordinate& plane_coord_,
+                     int index_m_,
+                     unsigned int cores_,
+                     libCZI::IntRect roi_,
+                     void* out_memory_,
+                     size_t out_bytes_,
+                     const PixelConversion& conversion_,
+                     PixelStatistics* statistics_)
 {
-  int pos;
-  if (m_specifyScene && !plane_coord_.TryGetPosition(libCZI::DimensionIndex::S, &pos)) {
-    throw ImageAccessUnderspecifiedException(0,
-                                             1,
-                                             "Scenes must be read individually "
-                                             "for this file, scenes have inconsistent YX shapes!");
-  }
-  SubblockSortable subblocksToFind(&plane_coord_, index_m_, isMosaic());
   // SubblockIndexVec is actually a set this is crucial to preserve the image order
-  SubblockIndexVec matches = getMatches(subblocksToFind);
-  m_pixelType = matches.begin()->first.pixelType();
-  size_t bgrScaling = ImageFactory::numberOfSamples(m_pixelType);
+  return readMatches(selectedMatches(plane_coord_, index_m_),
+                     plane_coord_,
+                     cores_,
+                     roi_,
+                     out_memory_,
+                     out_bytes_,
+                     conversion_,
+                     statistics_);
+}
 
-  libCZI::IntRect w_by_h = getSceneYXSize();
-  size_t n_of_pixels = matches.size() * w_by_h.w * w_by_h.h; // bgrScaling is handled internally * bgrScaling;
-  ImageFactory imageFactory(m_pixelType, n_of_pixels);
+std::unique_ptr<PlaneIterator>
+Reader::planeIterator(libCZI::CDimCoordinate plane_coord_,
+                      const std::string& group_dims_,
+                      int index_m_,
+                      size_t in_flight_,
+                      unsigned int cores_,
+                      libCZI::IntRect roi_)
+{
+  SubblockIndexVec matches = selectedMatches(plane_coord_, index_m_);
+  checkRoi(matches, roi_);
+  std::vector<libCZI::DimensionIndex> groupDims;
+  for (char dim : group_dims_) {
+    libCZI::DimensionIndex di = dim == 'M' ? libCZI::DimensionIndex::invalid : libCZI::Utils::CharToDimension(dim);
+    if (dim == 'M' ? !isMosaic() : !m_statistics.dimBounds.IsValid(di))
+      throw CDimCoordinatesOverspecifiedException(std::string(1, dim) + " is not a dimension of the file.");
+    groupDims.push_back(di);
+  }
 
-  imageFactory.setMosaic(isMosaic());
-  size_t memOffset = 0;
+  // the matches are in SubblockSortable order so the groups are too, in the order their first subblock comes in
+  auto groups = std::make_shared<std::vector<SubblockIndexVec>>();
+  std::map<std::vector<int>, size_t> groupOf;
+  for (const auto& match : matches) {
+    std::vector<int> key;
+    for (auto di : groupDims) {
+      int value = std::numeric_limits<int>::min();
+      if (di == libCZI::DimensionIndex::invalid)
+        value = match.first.mIndex();
+      else
+        match.first.coordinatePtr()->TryGetPosition(di, &value);
+      key.push_back(value);
+    }
+    if (groupDims.empty())
+      key.push_back(static_cast<int>(groupOf.size())); // every subblock on its own
+    auto found = groupOf.emplace(key, groups->size());
+    if (found.second)
+      groups->emplace_back();
+    (*groups)[found.first->second].insert(match);
+  }
+
+  return std::make_unique<PlaneIterator>(
+    groups->size(), in_flight_, [this, groups, plane_coord_, cores_, roi_](size_t group_) mutable {
+      return readMatches((*groups)[group_], plane_coord_, cores_, roi_, nullptr, 0, PixelConversion(), nullptr);
+    });
+}
+
+std::pair<ImagesContainerBase::ImagesContainerBasePtr, std::vector<std::pair<char, size_t>>>
+Reader::readMatches(const SubblockIndexVec& matches_,
+                    libCZI::CDimCoordinate& plane_coord_,
+                    unsigned int cores_,
+                    libCZI::IntRect roi_,
+                    void* out_memory_,
+                    size_t out_bytes_,
+                    const PixelConversion& conversion_,
+                    PixelStatistics* statistics_)
+{
+  auto read = readMatchSets({ &matches_ }, cores_, roi_, out_memory_, out_bytes_, conversion_, statistics_);
+  if (read.front().first->numberOfImages() == 0) {
+    throw pylibczi::CdimSelectionZeroImagesException(
+      plane_coord_, m_statistics.dimBounds, "No pyramid0 selectable subblocks.");
+  }
+  return std::move(read.front());
+}
+
+std::vector<std::pair<ImagesContainerBase::ImagesContainerBasePtr, Reader::Shape>>
+Reader::readSelectedBatch(std::vector<libCZI::CDimCoordinate> planes_,
+                          int index_m_,
+                          unsigned int cores_,
+                          libCZI::IntRect roi_,
+                          const PixelConversion& conversion_)
+{
+  // every selection is resolved before anything is read so a bad one throws without wasting the others' reads
+  std::vector<SubblockIndexVec> matches;
+  matches.reserve(planes_.size());
+  for (auto& plane : planes_)
+    matches.push_back(selectedMatches(plane, index_m_));
+  std::vector<const SubblockIndexVec*> sets;
+  sets.reserve(matches.size());
+  for (const auto& planeMatches : matches)
+    sets.push_back(&planeMatches);
+  if (sets.empty())
+    return {};
+  return readMatchSets(sets, cores_, roi_, nullptr, 0, conversion_, nullptr);
+}
+
+std::vector<std::pair<ImagesContainerBase::ImagesContainerBasePtr, Reader::Shape>>
+Reader::readScenes(const libCZI::CDimCoordinate& plane_coord_,
+                   std::vector<int> scenes_,
+                   int index_m_,
+                   unsigned int cores_,
+                   libCZI::IntRect roi_,
+                   const PixelConversion& conversion_)
+{
+  bool scenesDefined(false);
+  int sceneStart(0), sceneSize(0);
+  std::tie(scenesDefined, sceneStart, sceneSize) = scenesStartSize();
+  if (!scenesDefined)
+    throw CDimCoordinatesOverspecifiedException("S Not present in defined file Coordinates!");
+  if (plane_coord_.IsValid(libCZI::DimensionIndex::S))
+    throw CDimCoordinatesOverspecifiedException("S is given by the scenes, leave it out of the constraints.");
+  if (scenes_.empty()) {
+    summarizeScenes(); // the scenes with subblocks, a plate needn't use every index in its range
+    for (const auto& scene : m_sceneSummaries)
+      scenes_.push_back(scene.first);
+  }
+  std::vector<libCZI::CDimCoordinate> planes;
+  planes.reserve(scenes_.size());
+  for (int scene : scenes_) {
+    if (scene < sceneStart || sceneStart + sceneSize <= scene) {
+      std::stringstream ss;
+      ss << "Scene index " << scene << " ∉ [" << sceneStart << ", " << sceneStart + sceneSize << ")";
+      throw CDimCoordinatesOverspecifiedException(ss.str());
+    }
+    planes.push_back(plane_coord_);
+    planes.back().Set(libCZI::DimensionIndex::S, scene);
+  }
+  return readSelectedBatch(std::move(planes), index_m_, cores_, roi_, conversion_);
+}
+
+std::vector<std::pair<ImagesContainerBase::ImagesContainerBasePtr, Reader::Shape>>
+Reader::readMatchSets(const std::vector<const SubblockIndexVec*>& sets_,
+                      unsigned int cores_,
+                      libCZI::IntRect roi_,
+                      void* out_memory_,
+                      size_t out_bytes_,
+                      const PixelConversion& conversion_,
+                      PixelStatistics* statistics_)
+{
+  PerfCounters::Scope timed(*m_perfCounters, PerfCounters::Timer::ReadSelected);
+  const bool hasRoi = isRoi(roi_);
+
+  // every set is read into its own container, a set's images are a scene size apart in SubblockSortable order
+  PixelMemory::Policy policy = allocationPolicy();
+  std::vector<ImageFactory> factories;
+  std::vector<libCZI::PixelType> pixelTypes;
+  std::vector<size_t> pixelsPerImage;
+  factories.reserve(sets_.size());
+  for (const SubblockIndexVec* set : sets_) {
+    libCZI::IntRect w_by_h = checkRoi(*set, roi_);
+    libCZI::PixelType pixelType = set->begin()->first.pixelType();
+    size_t bgrScaling = ImageFactory::numberOfSamples(pixelType);
+    size_t n_of_pixels = set->size() * w_by_h.w * w_by_h.h; // bgrScaling is handled internally * bgrScaling;
+    if (out_memory_ != nullptr) {
+      size_t sampleBytes = ImageFactory::sizeOfPixelType(conversion_.outputType(pixelType));
+      size_t bytesNeeded = n_of_pixels * bgrScaling * sampleBytes;
+      auto shape = shapeOfMatches(*set, roi_);
+      size_t shapePixels = std::accumulate(shape.begin(), shape.end(), size_t(1), [](size_t a_, const auto& b_) {
+        return a_ * b_.second;
+      });
+      // the images are laid out a scene size apart, if the subblocks are smaller the shape doesn't describe the memory
+      if (shapePixels * sampleBytes != bytesNeeded)
+        throw OutputBufferException("the subblocks are smaller than the scene, read them without an output buffer.");
+      if (out_bytes_ < bytesNeeded)
+        throw OutputBufferException(std::to_string(bytesNeeded) + " bytes needed but only " +
+                                    std::to_string(out_bytes_) + " given.");
+    }
+    factories.emplace_back(pixelType, n_of_pixels, out_memory_, policy, cores_, conversion_);
+    factories.back().setMosaic(isMosaic());
+    factories.back().reserveSlots(set->size()); // image i_ is constructed in slot i_, no lock or allocation per tile
+    pixelTypes.push_back(pixelType);
+    pixelsPerImage.push_back(bgrScaling * w_by_h.w * w_by_h.h);
+  }
+
+  // the statistics are of the images as they are written, in the pixel type of the container
+  std::unique_ptr<StatisticsAccumulator> statistics;
+  std::vector<size_t> groupOf;
+  size_t imagePixelBytes = 0;
+  if (statistics_ != nullptr) {
+    groupOf = statisticsGroups(*sets_.front(), statistics_->options.group, roi_, statistics_->shape);
+    const Shape& groups = statistics_->shape;
+    size_t numberOfGroups = std::accumulate(
+      groups.begin(), groups.end(), size_t(1), [](size_t a_, const auto& b_) { return a_ * b_.second; });
+    libCZI::PixelType imageType = conversion_.outputType(pixelTypes.front());
+    imagePixelBytes = ImageFactory::sizeOfPixelType(imageType) * ImageFactory::numberOfSamples(imageType);
+    statistics = std::make_unique<StatisticsAccumulator>(statistics_->options, imageType, numberOfGroups);
+  }
 
   /*
    * On windows the python code says there are far more cores than the C++ code. For that reason we have
    * implemented this in such a way that it rescales to a workable value when necessary.
    */
-  unsigned int min_cores = 1; // for the case when hardware_concurency fails and returns 0
-  unsigned int number_of_cores = std::max(min_cores, std::min(cores_, std::thread::hardware_concurrency() - 1));
-  {
-    std::vector<std::future<bool>> jobs;
-    Tasks tasks;
-    for_each(matches.begin(), matches.end(), [&](const SubblockIndexVec::value_type& match_) {
-      int sb_index = match_.second;
-
-      jobs.push_back(tasks.queue([this, &imageFactory, sb_index, memOffset]() -> bool {
-        auto subblock = m_czireader->ReadSubBlock(sb_index);
-        const libCZI::SubBlockInfo& info = subblock->GetSubBlockInfo();
-        if (m_pixelType != info.pixelType)
-          throw PixelTypeException(info.pixelType,
-                                   "Selected subblocks have inconsistent PixelTypes."
-                                   " You must select subblocks with consistent PixelTypes.");
-        // the throw above covers a possible edge case which the file has multiple pixel types. If this is
-        // the case the exception is intentionally sent back to the user to deal with as they will have to
-        // select subblocks with consistent pixelType. There's no way to know which of the conflicting
-        // types they wanted.
+  unsigned int number_of_cores = ThreadPool::coresFor(cores_);
+  // each subblock is read once, in the order it's first selected, and copied to the (set, slot) of every set
+  // selecting it. The slot follows from the position in the set so the images are written and collected in
+  // SubblockSortable order whichever thread decodes them
+  std::vector<int> subblockIndices;
+  std::vector<std::vector<std::pair<size_t, size_t>>> targets;
+  std::unordered_map<int, size_t> readOf;
+  for (size_t set = 0; set < sets_.size(); set++) {
+    size_t slot = 0;
+    for (const auto& match : *sets_[set]) {
+      auto found = readOf.emplace(match.second, subblockIndices.size());
+      if (found.second) {
+        subblockIndices.push_back(match.second);
+        targets.emplace_back();
+      }
+      targets[found.first->second].emplace_back(set, slot++);
+    }
+  }
 
-        auto bitmap = subblock->CreateBitmap();
-        libCZI::IntSize size = bitmap->GetSize();
-        // constructImage fixes BRG image data now via channels != 3 condition
-        imageFactory.constructImage(bitmap, size, &info.coordinate, info.logicalRect, memOffset, info.mIndex);
-        return true;
-      }));
+  // copy the decoded pixels of a subblock, or only the rows and columns inside the roi, into the container
+  auto copyPixels = [&](const void* data_ptr_,
+                        size_t stride_,
+                        libCZI::PixelType pixel_type_,
+                        libCZI::IntSize size_,
+                        const libCZI::SubBlockInfo& info_,
+                        size_t set_,
+                        size_t slot_) {
+    ImageFactory& imageFactory = factories[set_];
+    size_t memOffset = slot_ * pixelsPerImage[set_];
+    // the image was just written so it's still in the cache, its rows are packed
+    auto collectStatistics = [&](libCZI::IntSize image_size_) {
+      if (statistics != nullptr)
+        statistics->accumulate(
+          groupOf[slot_], imageFactory.memoryAt(memOffset), image_size_.w * imagePixelBytes, image_size_);
+    };
+    if (!hasRoi) {
+      imageFactory.constructImage(
+        data_ptr_, stride_, pixel_type_, size_, &info_.coordinate, info_.logicalRect, memOffset, info_.mIndex, slot_);
+      collectStatistics(size_);
+      return;
+    }
+    if (roi_.x + roi_.w > static_cast<int>(size_.w) || roi_.y + roi_.h > static_cast<int>(size_.h))
+      throw RegionSelectionException(roi_,
+                                     { 0, 0, static_cast<int>(size_.w), static_cast<int>(size_.h) },
+                                     "The region must lie inside every selected subblock.");
+    size_t bytesPerPixel = ImageFactory::sizeOfPixelType(pixel_type_) * ImageFactory::numberOfSamples(pixel_type_);
+    auto first = static_cast<const std::uint8_t*>(data_ptr_) + roi_.y * stride_ + roi_.x * bytesPerPixel;
+    libCZI::IntRect box{ info_.logicalRect.x + roi_.x, info_.logicalRect.y + roi_.y, roi_.w, roi_.h };
+    libCZI::IntSize roiSize{ static_cast<std::uint32_t>(roi_.w), static_cast<std::uint32_t>(roi_.h) };
+    imageFactory.constructImage(
+      first, stride_, pixel_type_, roiSize, &info_.coordinate, box, memOffset, info_.mIndex, slot_);
+    collectStatistics(roiSize);
+  };
 
-      memOffset += bgrScaling * w_by_h.w * w_by_h.h;
-    });
-    tasks.start(number_of_cores);
-    for_each(jobs.begin(), jobs.end(), [](auto& x) { x.get(); });
+  auto copyToTargets = [&](const void* data_ptr_,
+                           size_t stride_,
+                           libCZI::PixelType pixel_type_,
+                           libCZI::IntSize size_,
+                           const libCZI::SubBlockInfo& info_,
+                           size_t i_) {
+    PerfCounters::Scope copying(*m_perfCounters, PerfCounters::Timer::Copy);
+    for (const auto& target : targets[i_])
+      copyPixels(data_ptr_, stride_, pixel_type_, size_, info_, target.first, target.second);
+  };
+
+  // the subblocks not yet started are dropped once the read is cancelled, see ReadCancellation
+  ReadCancellation cancellation = ReadCancellation::current();
+  auto decode = [&](size_t i_) {
+    cancellation.check();
+    int sb_index = subblockIndices[i_];
+    auto tile = m_tileCache->find(cacheKey(sb_index));
+    if (m_tileCache->enabled())
+      m_perfCounters->addCacheLookup(tile != nullptr);
+    std::shared_ptr<libCZI::ISubBlock> subblock;
+    if (tile == nullptr)
+      subblock = m_czireader->ReadSubBlock(sb_index);
+    const libCZI::SubBlockInfo& info = tile != nullptr ? tile->subblockInfo() : subblock->GetSubBlockInfo();
+    for (const auto& target : targets[i_]) {
+      if (pixelTypes[target.first] != info.pixelType)
+        throw PixelTypeException(info.pixelType,
+                                 "Selected subblocks have inconsistent PixelTypes."
+                                 " You must select subblocks with consistent PixelTypes.");
+    }
+    // the throw above covers a possible edge case which the file has multiple pixel types. If this is
+    // the case the exception is intentionally sent back to the user to deal with as they will have to
+    // select subblocks with consistent pixelType. There's no way to know which of the conflicting
+    // types they wanted.
+
+    if (tile != nullptr) {
+      // decoded by an earlier read
+      copyToTargets(tile->data(), tile->stride(), tile->GetPixelType(), tile->GetSize(), info, i_);
+      return;
+    }
+    if (info.GetCompressionMode() == libCZI::CompressionMode::UnCompressed) {
+      // uncompressed pixels are stored packed row by row, copy them straight into the container and skip the
+      // intermediate bitmap CreateBitmap would allocate
+      const void* rawData = nullptr;
+      size_t rawSize = 0;
+      subblock->DangerousGetRawData(libCZI::ISubBlock::MemBlkType::Data, rawData, rawSize);
+      size_t stride = info.physicalSize.w * ImageFactory::sizeOfPixelType(info.pixelType) *
+                      ImageFactory::numberOfSamples(info.pixelType);
+      if (rawData != nullptr && rawSize >= stride * info.physicalSize.h) {
+        copyToTargets(rawData, stride, info.pixelType, info.physicalSize, info, i_);
+        return;
+      }
+    }
+    PerfCounters::Clock::time_point decoding = m_perfCounters->start();
+    auto bitmap = subblock->CreateBitmap();
+    m_perfCounters->addDecode(static_cast<int>(info.GetCompressionMode()), decoding);
+    if (m_tileCache->enabled())
+      m_tileCache->insert(cacheKey(sb_index), std::make_shared<DecodedTile>(info, *bitmap));
+    libCZI::ScopedBitmapLockerSP lckScoped{ bitmap };
+    copyToTargets(lckScoped.ptrDataRoi, lckScoped.stride, bitmap->GetPixelType(), bitmap->GetSize(), info, i_);
+  };
+
+  readSubblocks(subblockIndices, number_of_cores, m_perfCounters->parallel(decode));
+
+  std::vector<std::pair<ImagesContainerBase::ImagesContainerBasePtr, Shape>> ans;
+  ans.reserve(sets_.size());
+  for (size_t set = 0; set < sets_.size(); set++) {
+    factories[set].collectSlots(); // in slot order, which is memory order, so the images don't need sorting
+    Shape shape = shapeOfMatches(*sets_[set], roi_);
+    auto container = factories[set].transferMemoryContainer();
+    container->setShape(shape);
+    ans.emplace_back(std::move(container), std::move(shape));
   }
+  if (statistics != nullptr)
+    statistics->finish(*statistics_);
+  return ans;
+}
 
-  if (imageFactory.numberOfImages() == 0) {
-    throw pylibczi::CdimSelectionZeroImagesException(
-      plane_coord_, m_statistics.dimBounds, "No pyramid0 selectable subblocks.");
+std::pair<libCZI::PixelType, Reader::Shape>
+Reader::selectedShape(libCZI::CDimCoordinate& plane_coord_,
+                      int index_m_,
+                      libCZI::IntRect roi_,
+                      const PixelConversion& conversion_)
+{
+  SubblockIndexVec matches = selectedMatches(plane_coord_, index_m_);
+  checkRoi(matches, roi_);
+  return std::make_pair(conversion_.outputType(matches.begin()->first.pixelType()), shapeOfMatches(matches, roi_));
+}
+
+PixelStatistics
+Reader::readStatistics(libCZI::CDimCoordinate& plane_coord_,
+                       const StatisticsOptions& options_,
+                       int index_m_,
+                       unsigned int cores_,
+                       libCZI::IntRect roi_)
+{
+  PerfCounters::Scope timed(*m_perfCounters, PerfCounters::Timer::ReadSelected);
+  SubblockIndexVec matches = selectedMatches(plane_coord_, index_m_);
+  const bool hasRoi = isRoi(roi_);
+  checkRoi(matches, roi_);
+  PixelStatistics ans;
+  ans.options = options_;
+  std::vector<size_t> groupOf = statisticsGroups(matches, options_.group, roi_, ans.shape);
+  size_t numberOfGroups = std::accumulate(
+    ans.shape.begin(), ans.shape.end(), size_t(1), [](size_t a_, const auto& b_) { return a_ * b_.second; });
+  libCZI::PixelType pixelType = matches.begin()->first.pixelType();
+  StatisticsAccumulator statistics(options_, pixelType, numberOfGroups);
+  size_t bytesPerPixel = ImageFactory::sizeOfPixelType(pixelType) * ImageFactory::numberOfSamples(pixelType);
+
+  // the pixels are only looked at where they were decoded, nothing is copied
+  std::vector<int> subblockIndices;
+  subblockIndices.reserve(matches.size());
+  for (const auto& match : matches)
+    subblockIndices.push_back(match.second);
+  ReadCancellation cancellation = ReadCancellation::current();
+  auto decode = [&](size_t i_) {
+    cancellation.check();
+    int sb_index = subblockIndices[i_];
+    MosaicCompositor::Pixels pixels = mosaicPixels(sb_index, *m_tileCache);
+    if (pixels.pixelType != pixelType)
+      throw PixelTypeException(pixels.pixelType,
+                               "Selected subblocks have inconsistent PixelTypes."
+                               " You must select subblocks with consistent PixelTypes.");
+    libCZI::IntSize tileSize = m_directory.physicalSize(m_directory.rowOfSubblock(sb_index));
+    const void* first = pixels.data;
+    if (hasRoi) {
+      if (roi_.x + roi_.w > static_cast<int>(tileSize.w) || roi_.y + roi_.h > static_cast<int>(tileSize.h))
+        throw RegionSelectionException(roi_,
+                                       { 0, 0, static_cast<int>(tileSize.w), static_cast<int>(tileSize.h) },
+                                       "The region must lie inside every selected subblock.");
+      first = static_cast<const std::uint8_t*>(pixels.data) + roi_.y * pixels.stride + roi_.x * bytesPerPixel;
+      tileSize = libCZI::IntSize{ static_cast<std::uint32_t>(roi_.w), static_cast<std::uint32_t>(roi_.h) };
+    }
+    statistics.accumulate(groupOf[i_], first, pixels.stride, tileSize);
+  };
+
+  unsigned int number_of_cores = ThreadPool::coresFor(cores_);
+  readSubblocks(subblockIndices, number_of_cores, m_perfCounters->parallel(decode));
+
+  statistics.finish(ans);
+  return ans;
+}
+
+std::pair<ImagesContainerBase::ImagesContainerBasePtr, Reader::Shape>
+Reader::readProjected(libCZI::CDimCoordinate& plane_coord_,
+                      char dim_,
+                      Projection::Mode mode_,
+                      int index_m_,
+                      unsigned int cores_,
+                      libCZI::IntRect roi_,
+                      void* out_memory_,
+                      size_t out_bytes_)
+{
+  return readReduced(
+    selectedMatches(plane_coord_, index_m_), { mode_, dim_, 0, 1, 1 }, cores_, roi_, out_memory_, out_bytes_);
+}
+
+std::pair<libCZI::PixelType, Reader::Shape>
+Reader::projectedShape(libCZI::CDimCoordinate& plane_coord_,
+                       char dim_,
+                       Projection::Mode mode_,
+                       int index_m_,
+                       libCZI::IntRect roi_)
+{
+  SubblockIndexVec matches = selectedMatches(plane_coord_, index_m_);
+  checkRoi(matches, roi_);
+  return std::make_pair(Projection::outputType(mode_, matches.begin()->first.pixelType()),
+                        reducedPlanes(matches, { mode_, dim_, 0, 1, 1 }, roi_).shape);
+}
+
+std::pair<ImagesContainerBase::ImagesContainerBasePtr, Reader::Shape>
+Reader::readBinned(libCZI::CDimCoordinate& plane_coord_,
+                   const Binning& binning_,
+                   int index_m_,
+                   unsigned int cores_,
+                   libCZI::IntRect roi_,
+                   void* out_memory_,
+                   size_t out_bytes_)
+{
+  // without a Z factor the planes are binned on their own, a file without Z can then be binned too
+  Reduction reduction{ binning_.mode, binning_.z != 1 ? 'Z' : '\0', binning_.z, binning_.x, binning_.y };
+  return readReduced(selectedMatches(plane_coord_, index_m_), reduction, cores_, roi_, out_memory_, out_bytes_);
+}
+
+std::pair<libCZI::PixelType, Reader::Shape>
+Reader::binnedShape(libCZI::CDimCoordinate& plane_coord_, const Binning& binning_, int index_m_, libCZI::IntRect roi_)
+{
+  SubblockIndexVec matches = selectedMatches(plane_coord_, index_m_);
+  checkRoi(matches, roi_);
+  Reduction reduction{ binning_.mode, binning_.z != 1 ? 'Z' : '\0', binning_.z, binning_.x, binning_.y };
+  return std::make_pair(Projection::outputType(binning_.mode, matches.begin()->first.pixelType()),
+                        reducedPlanes(matches, reduction, roi_).shape);
+}
+
+std::pair<ImagesContainerBase::ImagesContainerBasePtr, Reader::Shape>
+Reader::readReduced(const SubblockIndexVec& matches_,
+                    const Reduction& reduction_,
+                    unsigned int cores_,
+                    libCZI::IntRect roi_,
+                    void* out_memory_,
+                    size_t out_bytes_)
+{
+  PerfCounters::Scope timed(*m_perfCounters, PerfCounters::Timer::ReadSelected);
+  const bool hasRoi = isRoi(roi_);
+  checkRoi(matches_, roi_);
+  ReducedPlanes planes = reducedPlanes(matches_, reduction_, roi_);
+  libCZI::PixelType pixelType = matches_.begin()->first.pixelType();
+  libCZI::IntSize size = m_directory.physicalSize(m_directory.rowOfSubblock(matches_.begin()->second));
+  if (hasRoi)
+    size = libCZI::IntSize{ static_cast<std::uint32_t>(roi_.w), static_cast<std::uint32_t>(roi_.h) };
+  size_t bytesPerPixel = ImageFactory::sizeOfPixelType(pixelType) * ImageFactory::numberOfSamples(pixelType);
+  if (out_memory_ != nullptr) {
+    size_t bytesNeeded = planes.depths.size() * (size.w / reduction_.binX) * (size.h / reduction_.binY) *
+                         ImageFactory::numberOfSamples(pixelType) *
+                         ImageFactory::sizeOfPixelType(Projection::outputType(reduction_.mode, pixelType));
+    if (out_bytes_ < bytesNeeded)
+      throw OutputBufferException(std::to_string(bytesNeeded) + " bytes needed but only " +
+                                  std::to_string(out_bytes_) + " given.");
   }
-  auto charShape = imageFactory.getFixedShape();
-  ImageVector& imageVector = imageFactory.images();
-  imageVector.sort(); // this sort is mostly cosmetic, putting the imgs in memory order.
-  return std::make_pair(imageFactory.transferMemoryContainer(), charShape);
+  Projection projection(reduction_.mode,
+                        pixelType,
+                        size,
+                        planes.depths,
+                        reduction_.binX,
+                        reduction_.binY,
+                        out_memory_,
+                        allocationPolicy(),
+                        cores_);
+
+  std::vector<int> subblockIndices;
+  subblockIndices.reserve(matches_.size());
+  for (const auto& match : matches_)
+    subblockIndices.push_back(match.second);
+  ReadCancellation cancellation = ReadCancellation::current();
+  auto decode = [&](size_t i_) {
+    cancellation.check();
+    int sb_index = subblockIndices[i_];
+    MosaicCompositor::Pixels pixels = mosaicPixels(sb_index, *m_tileCache);
+    if (pixels.pixelType != pixelType)
+      throw PixelTypeException(pixels.pixelType,
+                               "Selected subblocks have inconsistent PixelTypes."
+                               " You must select subblocks with consistent PixelTypes.");
+    libCZI::IntSize tileSize = m_directory.physicalSize(m_directory.rowOfSubblock(sb_index));
+    const void* first = pixels.data;
+    if (hasRoi) {
+      if (roi_.x + roi_.w > static_cast<int>(tileSize.w) || roi_.y + roi_.h > static_cast<int>(tileSize.h))
+        throw RegionSelectionException(roi_,
+                                       { 0, 0, static_cast<int>(tileSize.w), static_cast<int>(tileSize.h) },
+                                       "The region must lie inside every selected subblock.");
+      first = static_cast<const std::uint8_t*>(pixels.data) + roi_.y * pixels.stride + roi_.x * bytesPerPixel;
+      tileSize = size;
+    }
+    PerfCounters::Scope copying(*m_perfCounters, PerfCounters::Timer::Copy);
+    projection.accumulate(planes.planeOf[i_], first, pixels.stride, tileSize);
+  };
+
+  unsigned int number_of_cores = ThreadPool::coresFor(cores_);
+  readSubblocks(subblockIndices, number_of_cores, m_perfCounters->parallel(decode));
+
+  auto container = projection.finish(number_of_cores);
+  container->setShape(planes.shape);
+  return std::make_pair(std::move(container), std::move(planes.shape));
 }
 
 SubblockMetaVec
-Reader::readSubblockMeta(libCZI::CDimCoordinate& plane_coord_, int index_m_)
+Reader::readSubblockMeta(libCZI::CDimCoordinate& plane_coord_, int index_m_, unsigned int cores_)
 {
   SubblockMetaVec metaSubblocks;
   metaSubblocks.setMosaic(isMosaic());
@@ -363,30 +1019,442 @@ Reader::readSubblockMeta(libCZI::CDimCoordinate& plane_coord_, int index_m_)
   SubblockSortable subBlockToFind(&plane_coord_, index_m_, isMosaic());
   SubblockIndexVec matches = getMatches(subBlockToFind);
 
-  for_each(matches.begin(), matches.end(), [&](const SubblockIndexVec::value_type& match_) {
-    size_t metaSize = 0;
-    auto subblock = m_czireader->ReadSubBlock(match_.second);
-    auto sharedPtrString = subblock->GetRawData(libCZI::ISubBlock::Metadata, &metaSize);
-    metaSubblocks.emplace_back(
-      match_.first.coordinatePtr(), match_.first.mIndex(), isMosaic(), (char*)(sharedPtrString.get()), metaSize);
+  // reading the subblocks and cleaning up the xml are done on the shared pool, the results keep the match order
+  std::vector<const SubblockIndexVec::value_type*> ordered;
+  ordered.reserve(matches.size());
+  for (const auto& match : matches)
+    ordered.push_back(&match);
+  std::vector<std::unique_ptr<SubblockString>> strings(ordered.size());
+  ReadCancellation cancellation = ReadCancellation::current();
+  ThreadPool::instance().parallelFor(ordered.size(), ThreadPool::coresFor(cores_), [&](size_t i_) {
+    cancellation.check();
+    const auto& match = *ordered[i_];
+    std::string xml = subblockMetadata(match.second);
+    strings[i_].reset(
+      new SubblockString(match.first.coordinatePtr(), match.first.mIndex(), isMosaic(), &xml[0], xml.size()));
+    strings[i_]->setSortKey(match.first.sortKeyLayout(), match.first.sortKey());
   });
+  metaSubblocks.reserve(strings.size());
+  for (auto& str : strings)
+    metaSubblocks.push_back(std::move(*str));
 
   return metaSubblocks;
 }
 
+std::vector<Reader::RawSubblock>
+Reader::readRawSubblocks(libCZI::CDimCoordinate& plane_coord_, int index_m_, unsigned int cores_)
+{
+  SubblockSortable subBlockToFind(&plane_coord_, index_m_, isMosaic());
+  SubblockIndexVec matches = getMatches(subBlockToFind);
+
+  std::vector<RawSubblock> ans;
+  ans.reserve(matches.size());
+  for (const auto& match : matches)
+    ans.push_back(RawSubblock{ match.second, libCZI::SubBlockInfo(), nullptr, 0 });
+  ReadCancellation cancellation = ReadCancellation::current();
+  auto read = [&](size_t i_) {
+    cancellation.check();
+    auto subblock = m_czireader->ReadSubBlock(ans[i_].subblockIndex);
+    ans[i_].info = subblock->GetSubBlockInfo();
+    ans[i_].data = subblock->GetRawData(libCZI::ISubBlock::MemBlkType::Data, &ans[i_].size);
+  };
+
+  std::vector<int> subblockIndices;
+  subblockIndices.reserve(ans.size());
+  for (const auto& raw : ans)
+    subblockIndices.push_back(raw.subblockIndex);
+  readSubblocks(subblockIndices, ThreadPool::coresFor(cores_), read);
+  return ans;
+}
+
+std::vector<AttachmentEntry>
+Reader::attachments()
+{
+  std::call_once(m_attachmentsLoaded, [this]() {
+    try {
+      m_attachments = AttachmentDirectory(*m_stream).entries();
+    } catch (const std::exception&) {
+      // libCZI parsed the directory on open, it has everything but the positions and sizes
+      m_attachments.clear();
+      m_czireader->EnumerateAttachments([this](int index_, const libCZI::AttachmentInfo& info_) {
+        m_attachments.push_back(AttachmentEntry{
+          index_, info_.name, info_.contentFileType, AttachmentDirectory::guidString(info_.contentGuid), -1, -1 });
+        return true;
+      });
+    }
+  });
+  return m_attachments;
+}
+
+Reader::RawAttachment
+Reader::readAttachment(int index_)
+{
+  const auto& entries = attachments();
+  if (index_ < 0 || static_cast<size_t>(index_) >= entries.size())
+    throw AttachmentException(std::to_string(index_),
+                              "the file has " + std::to_string(entries.size()) + " attachments.");
+  RawAttachment ans{ entries[index_], nullptr, 0 };
+  ans.data = m_czireader->ReadAttachment(index_)->GetRawData(&ans.size);
+  ans.entry.size = static_cast<std::int64_t>(ans.size);
+  return ans;
+}
+
+std::vector<double>
+Reader::readTimeStamps()
+{
+  for (const auto& entry : attachments()) {
+    if (entry.name == "TimeStamps" || entry.contentType == "CZTIMS") {
+      RawAttachment timeStamps = readAttachment(entry.index);
+      return AttachmentDirectory::decodeTimeStamps(timeStamps.data.get(), timeStamps.size);
+    }
+  }
+  throw AttachmentException("TimeStamps", "the file has none.");
+}
+
+SubblockFields
+Reader::readSubblockFields(libCZI::CDimCoordinate& plane_coord_,
+                           int index_m_,
+                           const std::vector<std::string>& fields_,
+                           unsigned int cores_)
+{
+  SubblockSortable subBlockToFind(&plane_coord_, index_m_, isMosaic());
+  SubblockIndexVec matches = getMatches(subBlockToFind);
+
+  SubblockFields ans;
+  ans.names = fields_;
+  for (const auto& match : matches)
+    ans.subblockIndex.push_back(match.second);
+  const size_t columns = fields_.size();
+  ans.values.resize(ans.subblockIndex.size() * columns);
+  std::vector<std::uint8_t> times(ans.values.size(), 0); // not vector<bool>, the rows are written concurrently
+  ReadCancellation cancellation = ReadCancellation::current();
+  ThreadPool::instance().parallelFor(ans.subblockIndex.size(), ThreadPool::coresFor(cores_), [&](size_t i_) {
+    cancellation.check();
+    std::string raw = subblockMetadata(ans.subblockIndex[i_]);
+    std::string xml = SubblockString::cleanXml(raw.data(), raw.size());
+    for (size_t f = 0; f < columns; f++) {
+      bool isTime = false;
+      ans.values[i_ * columns + f] = SubblockString::fieldValue(xml, fields_[f], isTime);
+      times[i_ * columns + f] = isTime ? 1 : 0;
+    }
+  });
+  for (size_t f = 0; f < columns; f++) {
+    bool isTime = false;
+    for (size_t i = f; i < times.size(); i += columns)
+      isTime = isTime || times[i] != 0;
+    ans.isTime.push_back(isTime);
+  }
+  return ans;
+}
+
+std::string
+Reader::subblockMetadata(int subblock_index_)
+{
+  if (loadFilePositions()) {
+    auto row = m_directory.rowOfSubblock(subblock_index_);
+    auto position = static_cast<std::uint64_t>(m_directory.filePosition(row));
+    std::uint64_t size = s_segmentHeaderBytes + s_minimumSubblockHeaderBytes + s_metadataReadBytes;
+    if (m_directory.segmentExtent(row) > 0)
+      size = std::min(size, static_cast<std::uint64_t>(m_directory.segmentExtent(row)));
+    std::vector<std::uint8_t> head(static_cast<size_t>(size));
+    std::uint64_t bytesRead = 0;
+    m_stream->Read(position, head.data(), size, &bytesRead);
+
+    const std::uint64_t entry = s_segmentHeaderBytes + s_subblockSizesBytes;
+    if (bytesRead >= s_segmentHeaderBytes + s_minimumSubblockHeaderBytes &&
+        std::memcmp(head.data(), "ZISRAWSUBBLOCK", 14) == 0 && head[entry] == 'D' && head[entry + 1] == 'V') {
+      std::int32_t metaSize = int32At(head, s_segmentHeaderBytes);
+      std::int32_t dimensions = int32At(head, s_segmentHeaderBytes + s_entryDimensionCount);
+      // the entry has a dimension entry for each of X, Y, M and the other dimensions of the subblock, a count that
+      // doesn't fit in what was read isn't a header this can parse
+      std::uint64_t entryEnd = s_segmentHeaderBytes + s_subblockSizesBytes + s_entryFixedBytes +
+                               static_cast<std::uint64_t>(dimensions) * s_dimensionEntryBytes;
+      if (metaSize >= 0 && dimensions >= 0 && entryEnd <= bytesRead) {
+        std::uint64_t from = std::max(s_segmentHeaderBytes + s_minimumSubblockHeaderBytes, entryEnd);
+        if (from + metaSize <= bytesRead)
+          return std::string(reinterpret_cast<const char*>(head.data()) + from, static_cast<size_t>(metaSize));
+        std::string ans(static_cast<size_t>(metaSize), '\0');
+        m_stream->Read(position + from, &ans[0], ans.size(), &bytesRead);
+        if (bytesRead == ans.size())
+          return ans;
+      }
+    }
+  }
+  // without the positions, or if the segment isn't laid out as expected, read the whole subblock with libCZI
+  size_t metaSize = 0;
+  auto subblock = m_czireader->ReadSubBlock(subblock_index_);
+  auto raw = subblock->GetRawData(libCZI::ISubBlock::Metadata, &metaSize);
+  return std::string(static_cast<const char*>(raw.get()), metaSize);
+}
+
 // private methods
 
 Reader::SubblockIndexVec
-Reader::getMatches(SubblockSortable& match_)
+Reader::selectedMatches(libCZI::CDimCoordinate& plane_coord_, int index_m_)
 {
-  SubblockIndexVec ans;
-  m_czireader->EnumerateSubBlocks([&](int index_, const libCZI::SubBlockInfo& info_) -> bool {
-    SubblockSortable subInfo(&(info_.coordinate), info_.mIndex, isMosaic(), info_.pixelType);
-    if (isPyramid0(info_) && match_ == subInfo) {
-      ans.emplace(std::pair<SubblockSortable, int>(subInfo, index_));
+  int pos;
+  if (specifyScene() && !plane_coord_.TryGetPosition(libCZI::DimensionIndex::S, &pos)) {
+    throw ImageAccessUnderspecifiedException(0,
+                                             1,
+                                             "Scenes must be read individually "
+                                             "for this file, scenes have inconsistent YX shapes!");
+  }
+  SubblockSortable subblocksToFind(&plane_coord_, index_m_, isMosaic());
+  SubblockIndexVec matches = getMatches(subblocksToFind);
+  if (matches.empty()) {
+    throw pylibczi::CdimSelectionZeroImagesException(
+      plane_coord_, m_statistics.dimBounds, "No pyramid0 selectable subblocks.");
+  }
+  return matches;
+}
+
+Reader::Shape
+Reader::shapeOfMatches(const SubblockIndexVec& matches_, const libCZI::IntRect& roi_) const
+{
+  // count the distinct values of one dimension at a time, sorting a reused buffer rather than a map per match
+  Shape charSizes;
+  std::vector<int> values;
+  values.reserve(matches_.size());
+  auto countValues = [&charSizes, &values](char dim_) {
+    if (values.empty())
+      return;
+    std::sort(values.begin(), values.end());
+    charSizes.emplace_back(dim_, static_cast<size_t>(std::unique(values.begin(), values.end()) - values.begin()));
+    values.clear();
+  };
+  for (auto di : Constants::s_sortOrder) {
+    int value;
+    for (const auto& match : matches_) {
+      if (match.first.coordinatePtr()->TryGetPosition(di, &value))
+        values.push_back(value);
+    }
+    countValues(libCZI::Utils::DimensionToChar(di));
+  }
+  if (isMosaic()) {
+    for (const auto& match : matches_)
+      values.push_back(match.first.mIndex());
+    countValues('M');
+  }
+
+  // the images are sorted in the same order as the matches so the first one gives the shape, see ImageVector
+  const auto& first = *matches_.begin();
+  libCZI::IntSize size = m_directory.physicalSize(m_directory.rowOfSubblock(first.second));
+  if (isRoi(roi_))
+    size = libCZI::IntSize{ static_cast<std::uint32_t>(roi_.w), static_cast<std::uint32_t>(roi_.h) };
+  std::vector<size_t> heightByWidth{ size_t(size.h), size_t(size.w) };
+  size_t samples = ImageFactory::numberOfSamples(first.first.pixelType());
+  if (samples > 1)
+    heightByWidth.push_back(samples);
+  return ImageVector::shapeFromCounts(std::move(charSizes), heightByWidth);
+}
+
+Reader::ReducedPlanes
+Reader::reducedPlanes(const SubblockIndexVec& matches_, const Reduction& reduction_, const libCZI::IntRect& roi_) const
+{
+  const char dim = reduction_.dim;
+  libCZI::DimensionIndex folded = libCZI::DimensionIndex::invalid;
+  if (dim != '\0') {
+    folded = libCZI::Utils::CharToDimension(dim);
+    if (folded == libCZI::DimensionIndex::invalid || !m_statistics.dimBounds.IsValid(folded))
+      throw CDimCoordinatesOverspecifiedException(std::string(1, dim) + " is not a dimension of the file to fold.");
+  }
+
+  ReducedPlanes planes;
+  planes.shape = shapeOfMatches(matches_, roi_);
+  if (dim != '\0' && reduction_.depth == 0) {
+    planes.shape.erase(std::remove_if(planes.shape.begin(),
+                                      planes.shape.end(),
+                                      [dim](const std::pair<char, size_t>& size_) { return size_.first == dim; }),
+                       planes.shape.end());
+  }
+  for (auto& size : planes.shape) {
+    size_t factor = 1;
+    if (size.first == dim)
+      factor = reduction_.depth;
+    else if (size.first == 'Y')
+      factor = reduction_.binY;
+    else if (size.first == 'X')
+      factor = reduction_.binX;
+    if (factor == 0 || factor > size.second)
+      throw std::invalid_argument(std::string("The bins of ") + size.first + " must be between 1 and " +
+                                  std::to_string(size.second) + ", not " + std::to_string(factor) + ".");
+    // the last planes of dim are folded into a shallower bin, the pixels left over by X and Y are dropped
+    size.second = size.first == dim ? (size.second + factor - 1) / factor : size.second / factor;
+  }
+
+  // the values of dim in order, a plane is folded into the bin of its rank
+  std::vector<int> foldedValues;
+  int value;
+  if (dim != '\0') {
+    for (const auto& match : matches_) {
+      if (match.first.coordinatePtr()->TryGetPosition(folded, &value))
+        foldedValues.push_back(value);
+    }
+    std::sort(foldedValues.begin(), foldedValues.end());
+    foldedValues.erase(std::unique(foldedValues.begin(), foldedValues.end()), foldedValues.end());
+  }
+
+  // the coordinates of a plane in SubblockSortable order, M last, so the map orders the planes as the shape does
+  std::vector<std::vector<int>> keys;
+  keys.reserve(matches_.size());
+  std::map<std::vector<int>, size_t> planeOfKey;
+  for (const auto& match : matches_) {
+    std::vector<int> key;
+    for (auto di : Constants::s_sortOrder) {
+      if (!match.first.coordinatePtr()->TryGetPosition(di, &value) || (di == folded && reduction_.depth == 0))
+        continue;
+      if (di == folded) {
+        auto rank = std::lower_bound(foldedValues.begin(), foldedValues.end(), value) - foldedValues.begin();
+        value = static_cast<int>(static_cast<size_t>(rank) / reduction_.depth);
+      }
+      key.push_back(value);
+    }
+    if (isMosaic())
+      key.push_back(match.first.mIndex());
+    planeOfKey.emplace(key, 0);
+    keys.push_back(std::move(key));
+  }
+  size_t gridPlanes = 1;
+  for (const auto& size : planes.shape) {
+    if (size.first != 'Y' && size.first != 'X' && size.first != 'A')
+      gridPlanes *= size.second;
+  }
+  if (gridPlanes != planeOfKey.size())
+    throw CDimCoordinatesUnderspecifiedException("The planes to fold don't form a full grid of the other "
+                                                 "dimensions, select fewer of them.");
+
+  size_t plane = 0;
+  for (auto& key : planeOfKey)
+    key.second = plane++;
+  planes.depths.assign(planeOfKey.size(), 0);
+  planes.planeOf.reserve(keys.size());
+  for (const auto& key : keys) {
+    planes.planeOf.push_back(planeOfKey[key]);
+    planes.depths[planes.planeOf.back()]++;
+  }
+  return planes;
+}
+
+std::vector<size_t>
+Reader::statisticsGroups(const SubblockIndexVec& matches_,
+                         StatisticsOptions::Group group_,
+                         const libCZI::IntRect& roi_,
+                         Shape& shape_) const
+{
+  std::vector<size_t> groupOf;
+  groupOf.reserve(matches_.size());
+  if (group_ == StatisticsOptions::Group::Plane) {
+    // the planes are in the order of the matches, which is the C order of their shape without Y, X and A
+    shape_ = shapeOfMatches(matches_, roi_);
+    shape_.erase(std::remove_if(shape_.begin(),
+                                shape_.end(),
+                                [](const std::pair<char, size_t>& size_) {
+                                  return size_.first == 'Y' || size_.first == 'X' || size_.first == 'A';
+                                }),
+                 shape_.end());
+    size_t planes = std::accumulate(
+      shape_.begin(), shape_.end(), size_t(1), [](size_t a_, const auto& b_) { return a_ * b_.second; });
+    if (planes != matches_.size())
+      throw CDimCoordinatesUnderspecifiedException("The planes don't form a full grid of their dimensions, group "
+                                                   "the statistics by channel or select fewer planes.");
+    for (size_t i = 0; i < matches_.size(); i++)
+      groupOf.push_back(i);
+    return groupOf;
+  }
+
+  // a match is counted in the group of the rank of its C, a file without C has one group
+  std::vector<int> channels;
+  int value;
+  for (const auto& match : matches_) {
+    if (match.first.coordinatePtr()->TryGetPosition(libCZI::DimensionIndex::C, &value))
+      channels.push_back(value);
+  }
+  std::sort(channels.begin(), channels.end());
+  channels.erase(std::unique(channels.begin(), channels.end()), channels.end());
+  shape_.clear();
+  if (!channels.empty())
+    shape_.emplace_back('C', channels.size());
+  for (const auto& match : matches_) {
+    size_t group = 0;
+    if (match.first.coordinatePtr()->TryGetPosition(libCZI::DimensionIndex::C, &value))
+      group = static_cast<size_t>(std::lower_bound(channels.begin(), channels.end(), value) - channels.begin());
+    groupOf.push_back(group);
+  }
+  return groupOf;
+}
+
+Reader::SubblockIndexVec
+Reader::mosaicMatches(libCZI::CDimCoordinate& plane_coord_, libCZI::IntRect& im_box_)
+{
+  // handle the case where the function was called with region=None (default to all)
+  if (im_box_.w == -1 && im_box_.h == -1)
+    im_box_ = m_statistics.boundingBox;
+  isValidRegion(im_box_, m_statistics.boundingBox); // if not throws RegionSelectionException
+
+  if (plane_coord_.IsValid(libCZI::DimensionIndex::S)) {
+    throw CDimCoordinatesOverspecifiedException("Do not set S when reading mosaic files!");
+  }
+
+  if (!plane_coord_.IsValid(libCZI::DimensionIndex::C)) {
+    throw CDimCoordinatesUnderspecifiedException("C is not set, to read mosaic files you must specify C.");
+  }
+  SubblockSortable subBlockToFind(&plane_coord_,
+                                  -1); // just check that the dims match something ignore that it's a mosaic file
+  SubblockIndexVec matches = getMatches(subBlockToFind); // this does the checking
+  if (matches.empty()) {
+    throw pylibczi::CdimSelectionZeroImagesException(
+      plane_coord_, m_statistics.dimBounds, "No pyramid0 selectable subblocks.");
+  }
+  return matches;
+}
+
+bool
+Reader::loadFilePositions()
+{
+  std::call_once(m_filePositionsLoaded, [this]() {
+    try {
+      // libCZI keeps the file positions to itself, parse the directory again
+      libCZI::IStream* stream = m_stream.get();
+      auto header = CCZIParse::ReadFileHeaderSegmentData(stream);
+      auto directory = CCZIParse::ReadSubBlockDirectory(stream, header.GetSubBlockDirectoryPosition());
+      std::vector<std::int64_t> positions;
+      directory.EnumSubBlocks([&positions](int index_, const CCziSubBlockDirectory::SubBlkEntry& entry_) -> bool {
+        if (index_ >= 0 && static_cast<size_t>(index_) >= positions.size())
+          positions.resize(index_ + 1, -1);
+        if (index_ >= 0)
+          positions[index_] = entry_.FilePosition;
+        return true;
+      });
+      m_directory.setFilePositions(positions);
+    } catch (const std::exception&) {
+      // without the positions the subblocks are read in directory order, which is still correct
     }
-    return true; // Enumerate through every subblock
   });
+  return m_directory.hasFilePositions();
+}
+
+Reader::SubblockIndexVec
+Reader::getMatches(SubblockSortable& match_)
+{
+  PerfCounters::Scope timed(*m_perfCounters, PerfCounters::Timer::Matches);
+  SubblockIndexVec ans;
+  // the directory only visits the rows that can match, the set then puts them in SubblockSortable order
+  auto rows = m_directory.findRows(*match_.coordinatePtr(), match_.mIndex(), match_.isMosaic());
+  const std::uint32_t layout = m_directory.sortKeyLayout();
+  if (layout != 0) {
+    // sorted by key first, every insert is then at the end of the set and compares two integers. Equal keys keep
+    // the directory order, the order of their subblock indexes in the set.
+    std::stable_sort(rows.begin(), rows.end(), [this](SubblockDirectory::Row a_, SubblockDirectory::Row b_) {
+      return m_directory.sortKey(a_) < m_directory.sortKey(b_);
+    });
+  }
+  for (auto row : rows) {
+    libCZI::CDimCoordinate coordinate = m_directory.coordinate(row);
+    SubblockSortable subInfo(&coordinate, m_directory.mIndex(row), isMosaic(), m_directory.pixelType(row));
+    if (layout != 0)
+      subInfo.setSortKey(layout, m_directory.sortKey(row));
+    ans.emplace_hint(ans.end(), std::pair<SubblockSortable, int>(subInfo, m_directory.subblockIndex(row)));
+  }
 
   if (ans.empty()) {
     // check for invalid Dimension specification
@@ -441,46 +1509,495 @@ ImagesContainerBase::ImagesContainerBasePtr
 Reader::readMosaic(libCZI::CDimCoordinate plane_coord_,
                    float scale_factor_,
                    libCZI::IntRect im_box_,
-                   libCZI::RgbFloatColor backGroundColor_)
+                   libCZI::RgbFloatColor backGroundColor_,
+                   unsigned int cores_,
+                   void* out_memory_,
+                   size_t out_bytes_,
+                   TileCache* tile_cache_)
 {
-  // handle the case where the function was called with region=None (default to all)
-  if (im_box_.w == -1 && im_box_.h == -1)
-    im_box_ = m_statistics.boundingBox;
-  isValidRegion(im_box_, m_statistics.boundingBox); // if not throws RegionSelectionException
-
-  if (plane_coord_.IsValid(libCZI::DimensionIndex::S)) {
-    throw CDimCoordinatesOverspecifiedException("Do not set S when reading mosaic files!");
-  }
+  return readMosaicPlanes(
+    { plane_coord_ }, scale_factor_, im_box_, backGroundColor_, cores_, out_memory_, out_bytes_, tile_cache_);
+}
 
-  if (!plane_coord_.IsValid(libCZI::DimensionIndex::C)) {
-    throw CDimCoordinatesUnderspecifiedException("C is not set, to read mosaic files you must specify C.");
+ImagesContainerBase::ImagesContainerBasePtr
+Reader::readMosaicPlanes(std::vector<libCZI::CDimCoordinate> planes_,
+                         float scale_factor_,
+                         libCZI::IntRect im_box_,
+                         libCZI::RgbFloatColor backGroundColor_,
+                         unsigned int cores_,
+                         void* out_memory_,
+                         size_t out_bytes_,
+                         TileCache* tile_cache_)
+{
+  PerfCounters::Scope timed(*m_perfCounters, PerfCounters::Timer::ReadMosaic);
+  planes_ = sortedPlanes(std::move(planes_));
+  std::vector<SubblockIndexVec> matches;
+  matches.reserve(planes_.size());
+  for (auto& plane : planes_)
+    matches.push_back(mosaicMatches(plane, im_box_));
+  // the pixel type of the planes read, which needn't be the file's first, is kept here not in the Reader
+  libCZI::PixelType pixelType = matches.front().begin()->first.pixelType();
+  for (const auto& planeMatches : matches) {
+    if (planeMatches.begin()->first.pixelType() != pixelType)
+      throw PixelTypeException(planeMatches.begin()->first.pixelType(),
+                               "Selected planes have inconsistent PixelTypes."
+                               " You must select planes with consistent PixelTypes.");
   }
-  SubblockSortable subBlockToFind(&plane_coord_,
-                                  -1); // just check that the dims match something ignore that it's a mosaic file
-  SubblockIndexVec matches = getMatches(subBlockToFind); // this does the checking
-  m_pixelType = matches.begin()->first.pixelType();
-  size_t bgrScaling = ImageFactory::numberOfSamples(m_pixelType);
-  auto accessor = m_czireader->CreateSingleChannelScalingTileAccessor();
+  size_t bgrScaling = ImageFactory::numberOfSamples(pixelType);
 
-  // Use default options except for backGroundColor (default is none)
-  libCZI::ISingleChannelScalingTileAccessor::Options options;
-  options.Clear();
-  options.backGroundColor = backGroundColor_;
-
-  // multiTile accessor is not compatible with S, it composites the Scenes and the mIndexs together
-  auto multiTileComposite = accessor->Get(im_box_, &plane_coord_, scale_factor_, &options);
-
-  libCZI::IntSize size = multiTileComposite->GetSize();
+  // the same size libCZI's accessor composites, so mosaicShape predicts it
+  libCZI::IntSize size = m_czireader->CreateSingleChannelScalingTileAccessor()->CalcSize(im_box_, scale_factor_);
   size_t pixels_in_image = size.h * size.w * bgrScaling;
   // the original pixels_in_image calculation was done using the file statistics container from libCZI but that
   // gives an incorrect size for the image which seems like a bug in libCZI
   // do not use m_statistics.boundingBoxLayer0Only.w*m_statistics.boundingBoxLayer0Only.h*bgrScaling;
-  ImageFactory imageFactory(m_pixelType, pixels_in_image);
-  imageFactory.constructImage(multiTileComposite, size, &plane_coord_, im_box_, 0, -1);
+  size_t bytesNeeded = pixels_in_image * planes_.size() * ImageFactory::sizeOfPixelType(pixelType);
+  if (out_memory_ != nullptr && out_bytes_ < bytesNeeded)
+    throw OutputBufferException(std::to_string(bytesNeeded) + " bytes needed but only " + std::to_string(out_bytes_) +
+                                " given.");
+  ImageFactory imageFactory(pixelType, pixels_in_image * planes_.size(), out_memory_, allocationPolicy(), cores_);
+
+  // all the scenes and m-indexes of a plane are composited together, the compositor drops the tiles hidden under
+  // other tiles
+  unsigned int number_of_cores = ThreadPool::coresFor(cores_);
+  std::vector<MosaicCompositor> compositors;
+  std::vector<void*> planePixels;
+  std::vector<std::pair<size_t, size_t>> tiles; // the (plane, tile) pairs of every plane
+  compositors.reserve(planes_.size());
+  for (size_t p = 0; p < planes_.size(); p++) {
+    compositors.emplace_back(im_box_, size, pixelType, mosaicTiles(planes_[p], im_box_, scale_factor_, matches[p]));
+    planePixels.push_back(imageFactory.memoryAt(p * pixels_in_image));
+    compositors.back().fill(planePixels.back(), backGroundColor_, number_of_cores);
+    for (size_t i = 0; i < compositors.back().numberOfTiles(); i++)
+      tiles.emplace_back(p, i);
+  }
+
+  drawMosaicTiles(
+    compositors, planePixels, tiles, number_of_cores, tile_cache_ != nullptr ? *tile_cache_ : *m_tileCache);
+
+  for (size_t p = 0; p < planes_.size(); p++)
+    imageFactory.constructImageInPlace(pixelType, size, &planes_[p], im_box_, p * pixels_in_image, -1);
   // set is mosaic?
   return imageFactory.transferMemoryContainer();
 }
 
+ImagesContainerBase::ImagesContainerBasePtr
+Reader::readMosaicProgressive(libCZI::CDimCoordinate plane_coord_,
+                              float scale_factor_,
+                              libCZI::IntRect im_box_,
+                              libCZI::RgbFloatColor backGroundColor_,
+                              unsigned int cores_,
+                              const MosaicProgress& progress_,
+                              void* out_memory_,
+                              size_t out_bytes_)
+{
+  PerfCounters::Scope timed(*m_perfCounters, PerfCounters::Timer::ReadMosaic);
+  SubblockIndexVec matches = mosaicMatches(plane_coord_, im_box_);
+  libCZI::PixelType pixelType = matches.begin()->first.pixelType();
+  // the same size and layout as readMosaic
+  libCZI::IntSize size = m_czireader->CreateSingleChannelScalingTileAccessor()->CalcSize(im_box_, scale_factor_);
+  size_t pixels_in_image = size.h * size.w * ImageFactory::numberOfSamples(pixelType);
+  size_t bytesNeeded = pixels_in_image * ImageFactory::sizeOfPixelType(pixelType);
+  if (out_memory_ != nullptr && out_bytes_ < bytesNeeded)
+    throw OutputBufferException(std::to_string(bytesNeeded) + " bytes needed but only " + std::to_string(out_bytes_) +
+                                " given.");
+  ImageFactory imageFactory(pixelType, pixels_in_image, out_memory_, allocationPolicy(), cores_);
+  std::vector<void*> planePixels{ imageFactory.memoryAt(0) };
+
+  unsigned int number_of_cores = ThreadPool::coresFor(cores_);
+  std::vector<MosaicCompositor> refined;
+  refined.emplace_back(im_box_, size, pixelType, mosaicTiles(plane_coord_, im_box_, scale_factor_, matches));
+  refined.front().fill(planePixels.front(), backGroundColor_, number_of_cores);
+  const size_t numberOfTiles = refined.front().numberOfTiles();
+
+  // the preview is the coarsest stored layer scaled up to the output, a scene without it is left to the refinement
+  const auto& layers = m_directory.pyramidLayers();
+  if (layers.size() > 1 && 1.0 / layers.back().minification < scale_factor_) {
+    std::set<int> refinedSubblocks;
+    for (size_t i = 0; i < numberOfTiles; i++)
+      refinedSubblocks.insert(refined.front().tile(i).subblockIndex);
+    std::vector<MosaicCompositor::Tile> coarse;
+    auto coarsestScale = static_cast<float>(1.0 / layers.back().minification);
+    for (const auto& tile : mosaicTiles(plane_coord_, im_box_, coarsestScale, matches)) {
+      if (refinedSubblocks.count(tile.subblockIndex) == 0)
+        coarse.push_back(tile);
+    }
+    if (!coarse.empty()) {
+      std::vector<MosaicCompositor> preview;
+      preview.emplace_back(im_box_, size, pixelType, coarse);
+      std::vector<std::pair<size_t, size_t>> tiles;
+      for (size_t i = 0; i < preview.front().numberOfTiles(); i++)
+        tiles.emplace_back(0, i);
+      drawMosaicTiles(preview, planePixels, tiles, number_of_cores, *m_tileCache);
+      if (progress_)
+        progress_(planePixels.front(), 0, numberOfTiles);
+      // the refinement only draws over the pixels its tiles cover, the rest go back to the background
+      refined.front().fillUncovered(planePixels.front(), backGroundColor_);
+    }
+  }
+
+  // batch b draws every s_progressiveBatches-th tile from b on so each batch is spread over the whole region
+  size_t batches = std::max<size_t>(1, std::min(s_progressiveBatches, numberOfTiles / number_of_cores));
+  size_t drawn = 0;
+  for (size_t batch = 0; batch < batches; batch++) {
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t i = batch; i < numberOfTiles; i += batches)
+      tiles.emplace_back(0, i);
+    drawMosaicTiles(refined, planePixels, tiles, number_of_cores, *m_tileCache);
+    drawn += tiles.size();
+    if (progress_)
+      progress_(planePixels.front(), drawn, numberOfTiles);
+  }
+
+  imageFactory.constructImageInPlace(pixelType, size, &plane_coord_, im_box_, 0, -1);
+  return imageFactory.transferMemoryContainer();
+}
+
+void
+Reader::drawMosaicTiles(const std::vector<MosaicCompositor>& compositors_,
+                        const std::vector<void*>& plane_pixels_,
+                        const std::vector<std::pair<size_t, size_t>>& tiles_,
+                        unsigned int cores_,
+                        TileCache& cache_)
+{
+  ReadCancellation cancellation = ReadCancellation::current();
+  auto decode = [&](size_t i_) {
+    cancellation.check();
+    const MosaicCompositor& compositor = compositors_[tiles_[i_].first];
+    size_t tile = tiles_[i_].second;
+    MosaicCompositor::Pixels pixels = mosaicPixels(compositor.tile(tile).subblockIndex, cache_);
+    PerfCounters::Scope copying(*m_perfCounters, PerfCounters::Timer::Copy);
+    compositor.draw(tile, pixels, plane_pixels_[tiles_[i_].first]);
+  };
+  std::vector<int> subblockIndices;
+  subblockIndices.reserve(tiles_.size());
+  for (const auto& tile : tiles_)
+    subblockIndices.push_back(compositors_[tile.first].tile(tile.second).subblockIndex);
+  readSubblocks(subblockIndices, cores_, m_perfCounters->parallel(decode));
+}
+
+std::vector<ReadPipeline::Job>
+Reader::pipelineJobs(const std::vector<int>& subblock_indices_)
+{
+  std::vector<ReadPipeline::Job> jobs;
+  if (subblock_indices_.size() > 1 && loadFilePositions()) {
+    jobs.reserve(subblock_indices_.size());
+    for (int sb_index : subblock_indices_) {
+      auto row = m_directory.rowOfSubblock(sb_index);
+      jobs.push_back(ReadPipeline::Job{ sb_index, m_directory.filePosition(row), m_directory.segmentExtent(row) });
+    }
+  }
+  return jobs;
+}
+
+void
+Reader::readSubblocks(const std::vector<int>& subblock_indices_,
+                      unsigned int cores_,
+                      const std::function<void(size_t)>& read_)
+{
+  // read the subblocks in file order, merging neighbouring segments into larger reads
+  std::vector<ReadPipeline::Job> jobs = pipelineJobs(subblock_indices_);
+  if (!jobs.empty())
+    ReadPipeline(*m_stream, jobs).run(cores_, read_);
+  else
+    ThreadPool::instance().parallelFor(subblock_indices_.size(), cores_, read_);
+}
+
+std::vector<libCZI::CDimCoordinate>
+Reader::sortedPlanes(std::vector<libCZI::CDimCoordinate> planes_)
+{
+  if (planes_.empty())
+    throw CDimCoordinatesUnderspecifiedException("No planes given to read.");
+  std::sort(planes_.begin(), planes_.end(), [](const libCZI::CDimCoordinate& a_, const libCZI::CDimCoordinate& b_) {
+    return SubblockSortable::aLessThanB(a_, b_);
+  });
+
+  // the images only stack into an array if every combination of the dimension values is there exactly once
+  std::vector<std::map<char, size_t>> indexes;
+  for (const auto& plane : planes_)
+    indexes.push_back(SubblockSortable::getValidIndexes(plane, -1));
+  size_t combinations = 1;
+  for (const auto& dim : ImageVector::shapeFrom(indexes, { 1, 1 }))
+    combinations *= dim.second;
+  bool sameDimensions = std::all_of(indexes.begin(), indexes.end(), [&indexes](const std::map<char, size_t>& a_) {
+    return a_.size() == indexes.front().size() &&
+           std::equal(a_.begin(), a_.end(), indexes.front().begin(), [](const auto& x_, const auto& y_) {
+             return x_.first == y_.first;
+           });
+  });
+  bool repeated = std::adjacent_find(planes_.begin(),
+                                     planes_.end(),
+                                     [](const libCZI::CDimCoordinate& a_, const libCZI::CDimCoordinate& b_) {
+                                       return !SubblockSortable::aLessThanB(a_, b_);
+                                     }) != planes_.end();
+  if (!sameDimensions || repeated || combinations != planes_.size())
+    throw CDimCoordinatesUnderspecifiedException("The planes must set the same dimensions and be a full grid of "
+                                                 "them, eg every C for every Z.");
+  return planes_;
+}
+
+std::vector<MosaicCompositor::Tile>
+Reader::mosaicTiles(const libCZI::CDimCoordinate& plane_coord_,
+                    const libCZI::IntRect& im_box_,
+                    float scale_factor_,
+                    const SubblockIndexVec& matches_) const
+{
+  using Rows = SubblockDirectory::RowVec;
+  // the rows intersecting im_box_ by scene and the part of im_box_ they cover
+  auto byScene = [&](const Rows& rows_) {
+    std::map<std::int32_t, std::pair<Rows, libCZI::IntRect>> ans;
+    for (auto row : rows_) {
+      libCZI::IntRect overlap = libCZI::IntRect::Intersect(m_directory.logicalRect(row), im_box_);
+      if (!overlap.IsValid() || overlap.w <= 0 || overlap.h <= 0)
+        continue;
+      auto& scene = ans[m_directory.dimValue(row, libCZI::DimensionIndex::S)];
+      if (scene.first.empty()) {
+        scene.second = overlap;
+      } else {
+        int x1 = std::max(scene.second.x + scene.second.w, overlap.x + overlap.w);
+        int y1 = std::max(scene.second.y + scene.second.h, overlap.y + overlap.h);
+        scene.second.x = std::min(scene.second.x, overlap.x);
+        scene.second.y = std::min(scene.second.y, overlap.y);
+        scene.second.w = x1 - scene.second.x;
+        scene.second.h = y1 - scene.second.y;
+      }
+      scene.first.push_back(row);
+    }
+    return ans;
+  };
+
+  Rows layer0;
+  layer0.reserve(matches_.size());
+  for (const auto& match : matches_)
+    layer0.push_back(m_directory.rowOfSubblock(match.second));
+  auto scenes = byScene(layer0);
+
+  // the usable layers coarsest first, a layer is usable if its pixels are at least as fine as the output
+  const auto& layers = m_directory.pyramidLayers();
+  for (auto layer = layers.rbegin(); scale_factor_ < 1.0f && layer != layers.rend(); ++layer) {
+    if (layer->layer == 0 || layer->minification * scale_factor_ > 1.0 + 1e-6)
+      continue;
+    auto layerScenes = byScene(m_directory.findLayerRows(plane_coord_, layer->layer));
+    for (auto& scene : scenes) {
+      if (m_directory.pyramidLayer(scene.second.first.front()) != 0)
+        continue; // a coarser layer was already chosen
+      auto found = layerScenes.find(scene.first);
+      if (found == layerScenes.end())
+        continue;
+      // the layer must cover the scene's part of the region, its tiles are rounded to its (coarser) pixels
+      const libCZI::IntRect& need = scene.second.second;
+      const libCZI::IntRect& has = found->second.second;
+      int slack = static_cast<int>(std::ceil(layer->minification));
+      if (has.x <= need.x + slack && has.y <= need.y + slack && need.x + need.w <= has.x + has.w + slack &&
+          need.y + need.h <= has.y + has.h + slack)
+        scene.second = found->second;
+    }
+  }
+
+  std::vector<MosaicCompositor::Tile> tiles;
+  for (const auto& scene : scenes) {
+    for (auto row : scene.second.first)
+      tiles.push_back(MosaicCompositor::Tile{ m_directory.subblockIndex(row),
+                                              m_directory.logicalRect(row),
+                                              m_directory.physicalSize(row),
+                                              m_directory.mIndex(row) });
+  }
+  return tiles;
+}
+
+MosaicCompositor::Pixels
+Reader::mosaicPixels(int subblock_index_, TileCache& cache_)
+{
+  auto tile = cache_.find(cacheKey(subblock_index_));
+  if (cache_.enabled())
+    m_perfCounters->addCacheLookup(tile != nullptr);
+  if (tile != nullptr)
+    return MosaicCompositor::Pixels{ tile, tile->data(), tile->stride(), tile->GetPixelType() };
+
+  std::shared_ptr<libCZI::ISubBlock> subblock = m_czireader->ReadSubBlock(subblock_index_);
+  const libCZI::SubBlockInfo& info = subblock->GetSubBlockInfo();
+  if (info.GetCompressionMode() == libCZI::CompressionMode::UnCompressed) {
+    // draw straight from the raw data, see readSelected
+    const void* rawData = nullptr;
+    size_t rawSize = 0;
+    subblock->DangerousGetRawData(libCZI::ISubBlock::MemBlkType::Data, rawData, rawSize);
+    size_t stride = info.physicalSize.w * ImageFactory::sizeOfPixelType(info.pixelType) *
+                    ImageFactory::numberOfSamples(info.pixelType);
+    if (rawData != nullptr && rawSize >= stride * info.physicalSize.h)
+      return MosaicCompositor::Pixels{ subblock, rawData, stride, info.pixelType };
+  }
+  PerfCounters::Clock::time_point decoding = m_perfCounters->start();
+  auto bitmap = subblock->CreateBitmap();
+  m_perfCounters->addDecode(static_cast<int>(info.GetCompressionMode()), decoding);
+  if (cache_.enabled()) {
+    auto decoded = std::make_shared<const DecodedTile>(info, *bitmap);
+    cache_.insert(cacheKey(subblock_index_), decoded);
+    return MosaicCompositor::Pixels{ decoded, decoded->data(), decoded->stride(), decoded->GetPixelType() };
+  }
+  // the bitmap stays locked until the compositor has drawn it
+  auto locked = std::make_shared<libCZI::ScopedBitmapLockerSP>(bitmap);
+  return MosaicCompositor::Pixels{ locked, locked->ptrDataRoi, locked->stride, bitmap->GetPixelType() };
+}
+
+std::shared_future<void>
+Reader::prefetchSubblocks(const std::vector<int>& subblocks_, bool decode_, unsigned int cores_)
+{
+  const bool decode = decode_ && m_tileCache->enabled();
+  std::vector<int> subblocks;
+  for (int sb_index : subblocks_) {
+    if (!decode || !m_tileCache->contains(cacheKey(sb_index)))
+      subblocks.push_back(sb_index);
+  }
+  std::vector<ReadPipeline::Job> jobs = pipelineJobs(subblocks);
+
+  // the task may outlive the Reader so it holds what it uses by value
+  auto czireader = m_czireader;
+  auto stream = m_stream;
+  auto tileCache = m_tileCache;
+  auto closing = m_closing;
+  std::uint32_t cacheId = m_cacheId;
+  unsigned int cores = ThreadPool::coresFor(cores_);
+  auto task = [czireader, stream, tileCache, cacheId, closing, subblocks, jobs, decode, cores]() {
+    auto read = [&](size_t i_) {
+      if (*closing)
+        return;
+      int sb_index = subblocks[i_];
+      // reading the subblock brings its bytes through the stream's caches even when it isn't decoded
+      std::shared_ptr<libCZI::ISubBlock> subblock = czireader->ReadSubBlock(sb_index);
+      TileCache::Key key = TileCache::keyOf(cacheId, sb_index);
+      if (decode && !tileCache->contains(key)) {
+        auto bitmap = subblock->CreateBitmap();
+        tileCache->insert(key, std::make_shared<DecodedTile>(subblock->GetSubBlockInfo(), *bitmap));
+      }
+    };
+    if (!jobs.empty())
+      ReadPipeline(*stream, jobs).run(cores, read);
+    else
+      ThreadPool::instance().parallelFor(subblocks.size(), cores, read);
+  };
+
+  std::shared_future<void> ans = ThreadPool::instance().submit(std::move(task)).share();
+  std::lock_guard<std::mutex> lck(m_prefetchMutex);
+  m_prefetches.erase(std::remove_if(m_prefetches.begin(),
+                                    m_prefetches.end(),
+                                    [](const std::shared_future<void>& f_) {
+                                      return f_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                    }),
+                     m_prefetches.end());
+  m_prefetches.push_back(ans);
+  return ans;
+}
+
+std::shared_future<void>
+Reader::prefetchSelected(libCZI::CDimCoordinate& plane_coord_, int index_m_, bool decode_, unsigned int cores_)
+{
+  std::vector<int> subblocks;
+  for (const auto& match : selectedMatches(plane_coord_, index_m_))
+    subblocks.push_back(match.second);
+  return prefetchSubblocks(subblocks, decode_, cores_);
+}
+
+std::shared_future<void>
+Reader::prefetchMosaic(libCZI::CDimCoordinate plane_coord_,
+                       float scale_factor_,
+                       libCZI::IntRect im_box_,
+                       bool decode_,
+                       unsigned int cores_)
+{
+  SubblockIndexVec matches = mosaicMatches(plane_coord_, im_box_);
+  std::vector<int> subblocks;
+  for (const auto& tile : mosaicTiles(plane_coord_, im_box_, scale_factor_, matches))
+    subblocks.push_back(tile.subblockIndex);
+  return prefetchSubblocks(subblocks, decode_, cores_);
+}
+
+std::pair<libCZI::PixelType, Reader::Shape>
+Reader::mosaicShape(libCZI::CDimCoordinate plane_coord_, float scale_factor_, libCZI::IntRect im_box_)
+{
+  return mosaicPlanesShape({ plane_coord_ }, scale_factor_, im_box_);
+}
+
+std::pair<libCZI::PixelType, Reader::Shape>
+Reader::mosaicPlanesShape(std::vector<libCZI::CDimCoordinate> planes_, float scale_factor_, libCZI::IntRect im_box_)
+{
+  planes_ = sortedPlanes(std::move(planes_));
+  std::vector<std::map<char, size_t>> indexes;
+  libCZI::PixelType pixelType = libCZI::PixelType::Invalid;
+  for (auto& plane : planes_) {
+    SubblockIndexVec matches = mosaicMatches(plane, im_box_);
+    pixelType = matches.begin()->first.pixelType();
+    // the composites are images without an M index, see readMosaicPlanes
+    indexes.push_back(SubblockSortable::getValidIndexes(plane, -1));
+  }
+  libCZI::IntSize size = m_czireader->CreateSingleChannelScalingTileAccessor()->CalcSize(im_box_, scale_factor_);
+  std::vector<size_t> heightByWidth{ size_t(size.h), size_t(size.w) };
+  size_t samples = ImageFactory::numberOfSamples(pixelType);
+  if (samples > 1)
+    heightByWidth.push_back(samples);
+  return std::make_pair(pixelType, ImageVector::shapeFrom(indexes, heightByWidth));
+}
+
+Reader::MosaicTiles
+Reader::readMosaicTiles(const libCZI::CDimCoordinate& plane_coord_,
+                        std::vector<int> m_indices_,
+                        unsigned int cores_,
+                        const PixelConversion& conversion_)
+{
+  if (!isMosaic())
+    throw IsNotMosaicException("Read the planes with readSelected.");
+
+  // one directory lookup for the plane, the tiles are picked out of its matches
+  libCZI::CDimCoordinate plane = plane_coord_;
+  SubblockIndexVec matches = selectedMatches(plane, -1);
+  std::set<int> wanted(m_indices_.begin(), m_indices_.end());
+  SubblockIndexVec tiles;
+  for (const auto& match : matches) {
+    if (wanted.empty() || wanted.count(match.first.mIndex()) > 0)
+      tiles.insert(tiles.end(), match);
+  }
+
+  std::map<int, size_t> subblocksOf;
+  for (const auto& tile : tiles) {
+    if (++subblocksOf[tile.first.mIndex()] > 1) {
+      throw CDimCoordinatesUnderspecifiedException("More than 1 subblock has M=" +
+                                                   std::to_string(tile.first.mIndex()) + ". Be more specific.");
+    }
+  }
+  for (int m_index : wanted) {
+    if (subblocksOf.count(m_index) == 0)
+      throw CDimCoordinatesOverspecifiedException("M=" + std::to_string(m_index) + " isn't a tile of the plane.");
+  }
+
+  // the images are laid out a scene size apart, see readMatchSets, so every tile has to be that size
+  libCZI::IntRect layout = getSceneYXSize(sceneOf(tiles));
+  MosaicTiles ans;
+  ans.mIndices.reserve(tiles.size());
+  ans.boxes.reserve(tiles.size());
+  for (const auto& tile : tiles) {
+    auto row = m_directory.rowOfSubblock(tile.second);
+    const libCZI::IntSize& size = m_directory.physicalSize(row);
+    if (static_cast<int>(size.w) != layout.w || static_cast<int>(size.h) != layout.h) {
+      std::stringstream ss;
+      ss << "Tile M=" << tile.first.mIndex() << " is " << size.w << "x" << size.h << " but the tiles are "
+         << layout.w << "x" << layout.h << ", read the tiles of one size at a time.";
+      throw CDimCoordinatesUnderspecifiedException(ss.str());
+    }
+    ans.mIndices.push_back(tile.first.mIndex());
+    ans.boxes.push_back(m_directory.logicalRect(row));
+  }
+
+  auto read = readMatchSets({ &tiles }, cores_, { 0, 0, -1, -1 }, nullptr, 0, conversion_, nullptr);
+  ans.images = std::move(read.front().first);
+  // the other dimensions are one value each, the tiles are an image per M index
+  ans.shape.emplace_back('M', tiles.size());
+  for (const auto& size : read.front().second) {
+    if (size.first == 'Y' || size.first == 'X' || size.first == 'A')
+      ans.shape.push_back(size);
+  }
+  ans.images->setShape(ans.shape);
+  return ans;
+}
+
 Reader::TilePair
 Reader::tileBoundingBox(libCZI::CDimCoordinate& plane_coord_)
 {
@@ -510,10 +2027,10 @@ Reader::tileBoundingBoxesWith(SubblockSortable& subblocksToFind_)
   if (matches.size() == 0)
     throw CDimCoordinatesOverspecifiedException("Tile dimensions overspecified, no matching tiles found.");
 
+  // answered from the directory, no subblock is read so listing the tiles of a large mosaic reads nothing but the
+  // directory the Reader already holds
   auto extractor = [&](const SubblockIndexVec::value_type& match_) {
-    auto subblk = m_czireader->ReadSubBlock(match_.second);
-    auto sbkInfo = subblk->GetSubBlockInfo();
-    return TileBBoxMap::value_type(match_.first, sbkInfo.logicalRect);
+    return TileBBoxMap::value_type(match_.first, m_directory.logicalRect(m_directory.rowOfSubblock(match_.second)));
   };
 
   transform(matches.begin(), matches.end(), std::inserter(ans, ans.end()), extractor);
@@ -1,20 +1,35 @@
 #ifndef _PYLIBCZI_READER_H
 #define _PYLIBCZI_READER_H
 
+#include <atomic>
 #include <cstdio>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
 #include <typeinfo>
 #include <vector>
 
 #include "inc_libCZI.h"
 
+#include "Attachments.h"
 #include "DimIndex.h"
 #include "Image.h"
 #include "ImagesContainer.h"
 #include "IndexMap.h"
+#include "IoScheduler.h"
+#include "MosaicCompositor.h"
+#include "PerfCounters.h"
+#include "PixelConversion.h"
+#include "PlaneIterator.h"
+#include "PixelStatistics.h"
+#include "Projection.h"
+#include "ReadPipeline.h"
+#include "StreamImplPrefetch.h"
+#include "SubblockDirectory.h"
 #include "SubblockMetaVec.h"
 #include "SubblockSortable.h"
+#include "TileCache.h"
 
 /*! \mainpage libCZI_c++_extension
  *
@@ -70,6 +85,15 @@ using namespace std;
 
 namespace pylibczi {
 
+/*!
+ * @brief what a Reader can share with the Readers of other files, see ReaderPool. By default it has its own.
+ */
+struct ReaderResources
+{
+  std::shared_ptr<TileCache> tileCache;     ///< the decoded subblock cache, nullptr makes a new one
+  std::shared_ptr<IoScheduler> ioScheduler; ///< the reads of the file wait for a turn, nullptr reads at once
+};
+
 /*!
  * @brief Reader class for ZISRAW / CZI files
  *
@@ -78,14 +102,33 @@ namespace pylibczi {
  * generated by Zeiss systems. If you have a file that causes problems please contact us and share the
  * file if possible and we will do our best to enable support. Ideally make an issue on the github repo
  * https://github.com/elhuhdron/pylibczi
+ *
+ * One Reader can be shared by many threads, eg the request handlers of a tile server. Everything read from the file
+ * header and directory is set on open or, like the file positions and scene summaries, once under a std::call_once,
+ * a read keeps what it works out about its selection on its own stack and the streams the file name constructor
+ * opens read without seeking or locking. The setters (setTileCacheBudget, setAllocationPolicy) may be called while
+ * reads are running, a read allocates with the policy set when it started.
  */
 class Reader
 {
 
   std::shared_ptr<CCZIReader> m_czireader; // required for cast in libCZI
+  std::shared_ptr<PerfCounters> m_perfCounters = std::make_shared<PerfCounters>(); // shared with m_stream
+  std::shared_ptr<StreamImplPrefetch> m_stream; // the stream m_czireader reads through
+  std::once_flag m_filePositionsLoaded;
+  std::once_flag m_attachmentsLoaded;
+  std::vector<AttachmentEntry> m_attachments; // set once under m_attachmentsLoaded, see attachments
+  std::shared_ptr<TileCache> m_tileCache; // decoded subblocks, disabled until it's given a budget
+  std::uint32_t m_cacheId;                // the top half of the keys of the subblocks in m_tileCache
+  mutable std::mutex m_policyMutex;
+  PixelMemory::Policy m_allocationPolicy;  // how the memory of the images read is allocated, guarded by m_policyMutex
   libCZI::SubBlockStatistics m_statistics;
-  libCZI::PixelType m_pixelType;
+  SubblockDirectory m_directory; // built once on open, all subblock queries are answered from it
+  libCZI::PixelType m_pixelType; // the pixel type of the first subblock, set on open
   bool m_specifyScene;
+  std::shared_ptr<std::atomic<bool>> m_closing = std::make_shared<std::atomic<bool>>(false); // stops prefetches
+  std::mutex m_prefetchMutex;
+  std::vector<std::shared_future<void>> m_prefetches; // the prefetches that may still be running
 
 public:
   // was vector
@@ -110,13 +153,21 @@ public:
    *
    * @param f_in_ A C-style FILE pointer to the CZI file
    */
-  explicit Reader(std::shared_ptr<libCZI::IStream> istream_);
+  explicit Reader(std::shared_ptr<libCZI::IStream> istream_, const ReaderResources& resources_ = ReaderResources());
 
   /*!
    * @brief A convenience function for testing or use by C++ developers
    * @param file_name_ a wide character string such as L"my_filename.czi"
+   * @param memory_map_ if true the file is memory mapped (StreamImplMemoryMapped) rather than read with positional
+   * reads (StreamImplPositionalRead), this is intended for repeated random access to files on local storage.
+   * @param index_file_ an optional SidecarIndex file, when it's valid for the file the directories are read from it
+   * instead of the file. A missing or stale index is written for the next open, nullptr or "" means no index.
+   * @param resources_ the tile cache and IO scheduler shared with other Readers, by default the Reader has its own
    */
-  explicit Reader(const wchar_t* file_name_);
+  explicit Reader(const wchar_t* file_name_,
+                  bool memory_map_ = false,
+                  const wchar_t* index_file_ = nullptr,
+                  const ReaderResources& resources_ = ReaderResources());
 
   /*!
    * @brief Check if the file is a mosaic file.
@@ -187,11 +238,45 @@ public:
 
   /*!
    * @brief Get the metadata from the CZI file.
-   * @return A string containing the xml metadata from the file. Y & X are included for completeness despite not being
-   * DimensionIndexes.
+   * @return A string containing the xml metadata from the file as libCZI serializes it. Y & X are included for
+   * completeness despite not being DimensionIndexes. It's serialized on the first call, see readMetaXml for the bytes
+   * as they are stored.
    */
   std::string readMeta();
 
+  /*!
+   * @brief the xml metadata segment as it is stored, see readMetaXml
+   */
+  struct RawMetadata
+  {
+    std::shared_ptr<const void> data; ///< the utf-8 xml, it holds libCZI's memory and isn't null terminated
+    size_t size;
+  };
+
+  /*!
+   * @brief the xml metadata without a copy, the segment is read once and kept by the Reader
+   */
+  RawMetadata readMetaXml();
+
+  /*!
+   * @brief the well known values of the metadata, see readMetaSummary
+   */
+  struct MetadataSummary
+  {
+    double scaleX; ///< the meters per pixel along X, NaN if the file doesn't give it
+    double scaleY;
+    double scaleZ;
+    std::vector<std::string> channelNames; ///< the Name of each Information/Image/Dimensions/Channels/Channel
+    std::string acquisitionTime;           ///< Information/Image/AcquisitionDateAndTime as stored, or empty
+  };
+
+  /*!
+   * @brief the scaling from libCZI's document info and the channel names and acquisition time from an XmlScan of
+   * the cached xml, worked out on the first call. Nothing is serialized and no tree of the document is built but
+   * libCZI's own.
+   */
+  MetadataSummary readMetaSummary();
+
   /*!
    * @brief Given a CDimCoordinate, even an empty one, return the planes that match as a numpy ndarray
    *
@@ -206,18 +291,272 @@ public:
    *
    * @param plane_coord_ A structure containing the Dimension constraints
    * @param index_m_ Is only relevant for mosaic files, if you wish to select one frame.
+   * @param cores_ The number of cores to use to process threads
+   * @param roi_ (optional) The {x0, y0, width, height} of a region relative to the origin of each plane (tile for
+   * mosaic files), only the pixels inside it are copied and the Y and X of the result are its height and width. The
+   * default { 0, 0, -1, -1 } is the whole plane.
+   * @param out_memory_ (optional) caller owned memory the pixels are written into instead of allocating it. It must
+   * be C-contiguous with the type and shape given by selectedShape, the returned container refers to it but doesn't
+   * own it.
+   * @param out_bytes_ the size of out_memory_ in bytes, an OutputBufferException is thrown if it's too small
+   * @param conversion_ (optional) how the pixels are converted as they are copied, eg BGR to RGB or uint16 windowed
+   * down to uint8, the images then have the pixel type conversion_.outputType gives, see PixelConversion
+   * @param statistics_ (optional) filled with the statistics of the images as its options say, they're collected
+   * from each image right after it's copied, while it's in the cache, rather than in a second pass
    */
   std::pair<ImagesContainerBase::ImagesContainerBasePtr, std::vector<std::pair<char, size_t>>>
-  readSelected(libCZI::CDimCoordinate& plane_coord_, int index_m_ = -1, unsigned int cores_ = 3);
+  readSelected(libCZI::CDimCoordinate& plane_coord_,
+               int index_m_ = -1,
+               unsigned int cores_ = 3,
+               libCZI::IntRect roi_ = { 0, 0, -1, -1 },
+               void* out_memory_ = nullptr,
+               size_t out_bytes_ = 0,
+               const PixelConversion& conversion_ = PixelConversion(),
+               PixelStatistics* statistics_ = nullptr);
 
   /*!
-   * @brief provide the subblock metadata in index order consistent with readSelected.
+   * @brief readSelected for several selections at once, eg C=0, Z=5 and C=1, Z=5.
+   *
+   * Every selection is resolved against the subblock directory before anything is read. A subblock selected more
+   * than once is read and decoded once and copied into each of the results, and the subblocks of all the selections
+   * are read in file order on the one thread pool, which is faster than a readSelected per selection.
+   *
+   * @param planes_ the selections, each is a set of constraints like the plane_coord_ of readSelected
+   * @param index_m_ Is only relevant for mosaic files, if you wish to select one frame of every selection.
+   * @param cores_ The number of cores to use to process threads
+   * @param roi_ (optional) the region of each plane, see readSelected
+   * @param conversion_ (optional) the conversion of the pixels of every selection, see readSelected
+   * @return what readSelected returns for each of planes_, in the same order
+   */
+  std::vector<std::pair<ImagesContainerBase::ImagesContainerBasePtr, Shape>> readSelectedBatch(
+    std::vector<libCZI::CDimCoordinate> planes_,
+    int index_m_ = -1,
+    unsigned int cores_ = 3,
+    libCZI::IntRect roi_ = { 0, 0, -1, -1 },
+    const PixelConversion& conversion_ = PixelConversion());
+
+  /*!
+   * @brief readSelected for every scene in scenes_, eg all the wells of a plate. The scenes needn't have the same
+   * shape so a file with inconsistent scene shapes, which readSelected only reads a scene at a time, is read in
+   * one call. The subblocks of all the scenes are read in file order on the one thread pool, see readSelectedBatch.
+   *
+   * @param plane_coord_ the constraints every scene is read with, they mustn't include S
+   * @param scenes_ the scene indexes, empty for every scene of the file
+   * @param index_m_ Is only relevant for mosaic files, if you wish to select one frame of every scene.
+   * @param cores_ The number of cores to use to process threads
+   * @param roi_ (optional) the region of each plane, see readSelected, it must lie inside every scene
+   * @param conversion_ (optional) the conversion of the pixels, see readSelected
+   * @return what readSelected returns for each of scenes_, in the same order, each with its own shape
+   * @throw CDimCoordinatesOverspecifiedException if the file has no scenes, plane_coord_ has S or a scene isn't in
+   * the file
+   */
+  std::vector<std::pair<ImagesContainerBase::ImagesContainerBasePtr, Shape>> readScenes(
+    const libCZI::CDimCoordinate& plane_coord_,
+    std::vector<int> scenes_ = {},
+    int index_m_ = -1,
+    unsigned int cores_ = 3,
+    libCZI::IntRect roi_ = { 0, 0, -1, -1 },
+    const PixelConversion& conversion_ = PixelConversion());
+
+  /*!
+   * @brief the statistics of the planes readSelected would read without keeping any pixels, eg for the contrast of
+   * a large file. Each subblock is accumulated as it's decoded, in file order on the shared pool.
+   * @param plane_coord_ A structure containing the Dimension constraints, as readSelected
+   * @param options_ the grouping and histogram of the statistics
+   * @param index_m_ Is only relevant for mosaic files, as readSelected
+   * @param cores_ The number of cores to use to process threads
+   * @param roi_ (optional) the region of each plane, as readSelected
+   * @return the statistics of the samples of the file's pixel type
+   */
+  PixelStatistics readStatistics(libCZI::CDimCoordinate& plane_coord_,
+                                 const StatisticsOptions& options_,
+                                 int index_m_ = -1,
+                                 unsigned int cores_ = 3,
+                                 libCZI::IntRect roi_ = { 0, 0, -1, -1 });
+
+  /*!
+   * @brief the pixel type and shape readSelected returns for the same selection, found from the subblock directory
+   * without reading any pixels. This is what a caller passing its own memory to readSelected has to allocate.
    * @param plane_coord_ A structure containing the Dimension constraints
    * @param index_m_ Is only relevant for mosaic files, if you wish to select one frame.
+   * @param roi_ (optional) the region to be passed to readSelected
+   * @param conversion_ (optional) the conversion to be passed to readSelected
+   * @return the pixel type of the images and the shape, BGR types have an A dimension of 3
+   */
+  std::pair<libCZI::PixelType, Shape> selectedShape(libCZI::CDimCoordinate& plane_coord_,
+                                                    int index_m_ = -1,
+                                                    libCZI::IntRect roi_ = { 0, 0, -1, -1 },
+                                                    const PixelConversion& conversion_ = PixelConversion());
+
+  /*!
+   * @brief the maximum, mean or sum over one dimension of the planes readSelected would read, eg the maximum
+   * intensity projection of every Z-stack of the selection. The subblocks are accumulated as they are decoded, each
+   * thread into a partial of its own, so only one plane per remaining coordinate is held however deep the stacks
+   * are and the accumulation runs in parallel with the decode. The partials are of one plane and are merged as soon
+   * as the plane is complete, so the peak is the result and about cores_ - 1 planes, see Projection.
+   * @code
+   *    auto dims = CDimCoordinate{ { DimensionIndex::S, 0 } };
+   *    auto projected = czi.readProjected(dims, 'Z', Projection::Mode::Max); // TCYX, as readSelected without Z
+   * @endcode
+   * @param plane_coord_ A structure containing the Dimension constraints, as readSelected
+   * @param dim_ the dimension projected, eg 'Z' or 'T', it's dropped from the shape of the result
+   * @param mode_ see Projection::Mode, the pixel type of the result is Projection::outputType
+   * @param index_m_ Is only relevant for mosaic files, as readSelected, M is never projected
+   * @param cores_ The number of cores to use to process threads
+   * @param roi_ (optional) the region of each plane, as readSelected
+   * @param out_memory_ (optional) caller owned memory for the result with the type and shape projectedShape gives
+   * @param out_bytes_ the size of out_memory_ in bytes, an OutputBufferException is thrown if it's too small
+   */
+  std::pair<ImagesContainerBase::ImagesContainerBasePtr, Shape> readProjected(libCZI::CDimCoordinate& plane_coord_,
+                                                                              char dim_,
+                                                                              Projection::Mode mode_,
+                                                                              int index_m_ = -1,
+                                                                              unsigned int cores_ = 3,
+                                                                              libCZI::IntRect roi_ = { 0, 0, -1, -1 },
+                                                                              void* out_memory_ = nullptr,
+                                                                              size_t out_bytes_ = 0);
+
+  /*!
+   * @brief the pixel type and shape readProjected returns for the same arguments, without reading any pixels
+   */
+  std::pair<libCZI::PixelType, Shape> projectedShape(libCZI::CDimCoordinate& plane_coord_,
+                                                     char dim_,
+                                                     Projection::Mode mode_,
+                                                     int index_m_ = -1,
+                                                     libCZI::IntRect roi_ = { 0, 0, -1, -1 });
+
+  /*!
+   * @brief the planes readSelected would read binned by whole blocks of pixels and Z planes, eg 4 x 4 for a preview
+   * of a time-lapse. Each subblock is binned as it's decoded, like readProjected accumulates them, so the memory and
+   * the copies scale with the size of the result rather than with the selection.
+   * @param plane_coord_ A structure containing the Dimension constraints, as readSelected
+   * @param binning_ the factors of X, Y and Z and whether the bins are their mean or maximum, the pixels and planes
+   * left over by X and Y are dropped, see Projection
+   * @param index_m_ Is only relevant for mosaic files, as readSelected
    * @param cores_ The number of cores to use to process threads
+   * @param roi_ (optional) the region of each plane binned, as readSelected
+   * @param out_memory_ (optional) caller owned memory for the result with the type and shape binnedShape gives
+   * @param out_bytes_ the size of out_memory_ in bytes, an OutputBufferException is thrown if it's too small
+   */
+  std::pair<ImagesContainerBase::ImagesContainerBasePtr, Shape> readBinned(libCZI::CDimCoordinate& plane_coord_,
+                                                                           const Binning& binning_,
+                                                                           int index_m_ = -1,
+                                                                           unsigned int cores_ = 3,
+                                                                           libCZI::IntRect roi_ = { 0, 0, -1, -1 },
+                                                                           void* out_memory_ = nullptr,
+                                                                           size_t out_bytes_ = 0);
+
+  /*!
+   * @brief the pixel type and shape readBinned returns for the same arguments, without reading any pixels
+   */
+  std::pair<libCZI::PixelType, Shape> binnedShape(libCZI::CDimCoordinate& plane_coord_,
+                                                  const Binning& binning_,
+                                                  int index_m_ = -1,
+                                                  libCZI::IntRect roi_ = { 0, 0, -1, -1 });
+
+  /*!
+   * @brief step through the subblocks readSelected would read a group at a time instead of holding all of them in
+   * memory, eg one T at a time of a long time-lapse. The next groups are read ahead on a background thread.
+   *
+   * @code
+   *    auto dims = CDimCoordinate{ { DimensionIndex::C, 0 } };
+   *    auto planes = czi.planeIterator(dims, "T");
+   *    while (planes->hasNext()) {
+   *        auto imagesAndShape = planes->next(); // every selected Z of one T, as readSelected returns them
+   *    }
+   * @endcode
+   *
+   * @param plane_coord_ A structure containing the Dimension constraints, as readSelected
+   * @param group_dims_ the dimensions stepped over, a group is the selected subblocks with one value of each of them,
+   * eg "T" or "TC". M can be used for mosaic files. The default "" makes every subblock a group of its own. The groups
+   * are in SubblockSortable order.
+   * @param index_m_ Is only relevant for mosaic files, as readSelected
+   * @param in_flight_ the number of groups read ahead of the caller, 0 reads each group in PlaneIterator::next
+   * @param cores_ The number of cores each group is decoded on
+   * @param roi_ (optional) the region of each plane to read, as readSelected
+   * @return the iterator, it reads from this Reader which must outlive it
+   */
+  std::unique_ptr<PlaneIterator> planeIterator(libCZI::CDimCoordinate plane_coord_,
+                                               const std::string& group_dims_ = "",
+                                               int index_m_ = -1,
+                                               size_t in_flight_ = 2,
+                                               unsigned int cores_ = 3,
+                                               libCZI::IntRect roi_ = { 0, 0, -1, -1 });
+
+  /*!
+   * @brief provide the subblock metadata in index order consistent with readSelected.
+   * @param plane_coord_ A structure containing the Dimension constraints
+   * @param index_m_ Is only relevant for mosaic files, if you wish to select one frame.
+   * @param cores_ the number of cores the metadata is read and cleaned up on
    * @return a vector of metadata string blocks
    */
-  SubblockMetaVec readSubblockMeta(libCZI::CDimCoordinate& plane_coord_, int index_m_ = -1);
+  SubblockMetaVec readSubblockMeta(libCZI::CDimCoordinate& plane_coord_, int index_m_ = -1, unsigned int cores_ = 3);
+
+  /*!
+   * @brief a subblock as it is stored in the file, see readRawSubblocks
+   */
+  struct RawSubblock
+  {
+    int subblockIndex;
+    libCZI::SubBlockInfo info;        ///< the pixel type, compression, rects, coordinate and m-index
+    std::shared_ptr<const void> data; ///< the payload as stored, eg JPG-XR or zstd, it holds libCZI's memory
+    size_t size;
+  };
+
+  /*!
+   * @brief the payloads of the matching subblocks without decoding them, to copy them into another format or decode
+   * them elsewhere. The subblocks are read in file order on the shared pool like readSelected.
+   * @param plane_coord_ A structure containing the Dimension constraints
+   * @param index_m_ Is only relevant for mosaic files, if you wish to select one frame.
+   * @param cores_ the number of cores the subblocks are read on
+   * @return the subblocks in readSubblockMeta order
+   */
+  std::vector<RawSubblock> readRawSubblocks(libCZI::CDimCoordinate& plane_coord_,
+                                            int index_m_ = -1,
+                                            unsigned int cores_ = 3);
+
+  /*!
+   * @brief chosen fields of the subblock metadata, eg StageXPosition or AcquisitionTime, without building the xml
+   * string of every subblock. Like readSubblockMeta only the metadata of each subblock is read, on the shared pool.
+   * @param plane_coord_ A structure containing the Dimension constraints
+   * @param index_m_ Is only relevant for mosaic files, if you wish to select one frame.
+   * @param fields_ the names of the xml elements to extract, see SubblockString::fieldValue
+   * @param cores_ the number of cores the metadata is read and scanned on
+   * @return a row per subblock in readSubblockMeta order and a value per field
+   */
+  SubblockFields readSubblockFields(libCZI::CDimCoordinate& plane_coord_,
+                                    int index_m_,
+                                    const std::vector<std::string>& fields_,
+                                    unsigned int cores_ = 3);
+
+  /*!
+   * @brief the attachments of the file, eg TimeStamps, EventList and Thumbnail, from the attachment directory
+   * without reading their data. The directory is read once, see AttachmentDirectory, if it can't be parsed the
+   * entries come from libCZI without their file positions and sizes.
+   */
+  std::vector<AttachmentEntry> attachments();
+
+  /*!
+   * @brief an attachment as it is stored in the file, see readAttachment
+   */
+  struct RawAttachment
+  {
+    AttachmentEntry entry;
+    std::shared_ptr<const void> data; ///< the data as stored, it holds libCZI's memory
+    size_t size;
+  };
+
+  /*!
+   * @brief read the data of one attachment, nothing is copied out of the buffer libCZI reads it into
+   * @param index_ the index of the attachment, see attachments. Throws AttachmentException if there's none.
+   */
+  RawAttachment readAttachment(int index_);
+
+  /*!
+   * @brief the seconds of each acquired frame from the TimeStamps attachment, decoded without the xml metadata.
+   * Throws AttachmentException if the file has no TimeStamps attachment.
+   */
+  std::vector<double> readTimeStamps();
 
   /*!
    * @brief If the czi file is a mosaic tiled image this function can be used to reconstruct it into an image.
@@ -227,6 +566,11 @@ public:
    * @param im_box_ (optional) The {x0, y0, width, height} of a sub-region, the default is the whole image.
    * @param backGroundColor_ (optional) {r, g, b} color value used when a pixel is outside of a subblock, the
    * default is black { 0.0, 0.0, 0.0 }. Each color component is a float values between 0.0 and 1.0.
+   * @param cores_ (optional) the number of cores the subblocks are decoded and drawn on, see MosaicCompositor
+   * @param out_memory_ (optional) caller owned memory to write the image into, see readSelected and mosaicShape
+   * @param out_bytes_ the size of out_memory_ in bytes
+   * @param tile_cache_ (optional) decode through this cache instead of the Reader's, eg a private cache of a long
+   * running export that shouldn't change the budget of a cache shared with other Readers
    * @return an ImagesContainerBasePtr containing the raw memory, a list of images, and a list of corresponding
    * dimensions
    *
@@ -248,7 +592,122 @@ public:
   ImagesContainerBase::ImagesContainerBasePtr readMosaic(libCZI::CDimCoordinate plane_coord_,
                                                          float scale_factor_ = 1.0,
                                                          libCZI::IntRect im_box_ = { 0, 0, -1, -1 },
-                                                         libCZI::RgbFloatColor backGroundColor_ = { 0.0, 0.0, 0.0 });
+                                                         libCZI::RgbFloatColor backGroundColor_ = { 0.0, 0.0, 0.0 },
+                                                         unsigned int cores_ = 3,
+                                                         void* out_memory_ = nullptr,
+                                                         size_t out_bytes_ = 0,
+                                                         TileCache* tile_cache_ = nullptr);
+
+  /*!
+   * @brief the pixel type and shape readMosaic returns for the same arguments without compositing the image.
+   * @param plane_coord_ A class constraining the data to an individual plane.
+   * @param scale_factor_ (optional) the scale factor to be passed to readMosaic
+   * @param im_box_ (optional) the region to be passed to readMosaic
+   */
+  std::pair<libCZI::PixelType, Shape> mosaicShape(libCZI::CDimCoordinate plane_coord_,
+                                                  float scale_factor_ = 1.0,
+                                                  libCZI::IntRect im_box_ = { 0, 0, -1, -1 });
+
+  /*!
+   * @brief readMosaic for several planes in one call, eg every channel of a slide scan. The tiles of all the planes
+   * are read in file order and decoded together on the shared ThreadPool, so a plane doesn't wait for the one before
+   * it. The images are written one after the other into one container in SubblockSortable order, the same order
+   * readSelected uses, so the container converts to one N-D array, eg CZYX.
+   * @param planes_ the planes to composite, each sets C and none sets S. They must set the same dimensions and be a
+   * full grid of them, eg every C for every Z. Throws CDimCoordinatesUnderspecifiedException if not.
+   * @param scale_factor_ (optional) as readMosaic, the same for every plane
+   * @param im_box_ (optional) as readMosaic, the same for every plane
+   * @param backGroundColor_ (optional) as readMosaic
+   * @param cores_ (optional) the number of cores the subblocks of all the planes are decoded and drawn on
+   * @param out_memory_ (optional) caller owned memory to write the images into, see mosaicPlanesShape
+   * @param out_bytes_ the size of out_memory_ in bytes
+   * @param tile_cache_ (optional) as readMosaic
+   * @return an ImagesContainerBasePtr with one image per plane
+   */
+  ImagesContainerBase::ImagesContainerBasePtr readMosaicPlanes(
+    std::vector<libCZI::CDimCoordinate> planes_,
+    float scale_factor_ = 1.0,
+    libCZI::IntRect im_box_ = { 0, 0, -1, -1 },
+    libCZI::RgbFloatColor backGroundColor_ = { 0.0, 0.0, 0.0 },
+    unsigned int cores_ = 3,
+    void* out_memory_ = nullptr,
+    size_t out_bytes_ = 0,
+    TileCache* tile_cache_ = nullptr);
+
+  /*!
+   * @brief the pixel type and shape readMosaicPlanes returns for the same arguments without compositing the images.
+   */
+  std::pair<libCZI::PixelType, Shape> mosaicPlanesShape(std::vector<libCZI::CDimCoordinate> planes_,
+                                                        float scale_factor_ = 1.0,
+                                                        libCZI::IntRect im_box_ = { 0, 0, -1, -1 });
+
+  /*!
+   * @brief called by readMosaicProgressive on the calling thread each time more of the mosaic is drawn, no tiles are
+   * decoded while it runs
+   * @param pixels_ the image being refined, laid out as the image readMosaic returns
+   * @param drawn_ the full resolution tiles drawn so far, 0 for the preview
+   * @param tiles_ the full resolution tiles of the region, drawn_ is tiles_ on the last call
+   */
+  using MosaicProgress = std::function<void(const void* pixels_, size_t drawn_, size_t tiles_)>;
+
+  /*!
+   * @brief readMosaic for a viewer, which wants some image of the region before the whole composite is done. When
+   * the file stores a pyramid layer coarser than scale_factor_ needs, the region is first composited from the
+   * coarsest layer, scaled up, and handed to progress_. The tiles of the composite then fill it in, in up to
+   * s_progressiveBatches batches each spread over the whole region, progress_ is called after each. The result is
+   * the image readMosaic returns.
+   * @param plane_coord_ as readMosaic
+   * @param scale_factor_ as readMosaic
+   * @param im_box_ as readMosaic
+   * @param backGroundColor_ as readMosaic
+   * @param cores_ the number of cores the subblocks of each batch are decoded and drawn on
+   * @param progress_ called with the image so far, may be empty
+   * @param out_memory_ (optional) caller owned memory to write the image into, progress_ is then given it
+   * @param out_bytes_ the size of out_memory_ in bytes
+   */
+  ImagesContainerBase::ImagesContainerBasePtr readMosaicProgressive(libCZI::CDimCoordinate plane_coord_,
+                                                                    float scale_factor_,
+                                                                    libCZI::IntRect im_box_,
+                                                                    libCZI::RgbFloatColor backGroundColor_,
+                                                                    unsigned int cores_,
+                                                                    const MosaicProgress& progress_,
+                                                                    void* out_memory_ = nullptr,
+                                                                    size_t out_bytes_ = 0);
+
+  static constexpr size_t s_progressiveBatches = 8;
+
+  /*!
+   * @brief the tiles readMosaicTiles reads, tile i_ is image i_ of images and lies at boxes[i_] in the mosaic
+   */
+  struct MosaicTiles
+  {
+    ImagesContainerBase::ImagesContainerBasePtr images; ///< one image per tile, shaped (M, Y, X[, A])
+    Shape shape;
+    std::vector<int> mIndices;
+    std::vector<libCZI::IntRect> boxes; ///< the logical rect of each tile in the mosaic's coordinates
+  };
+
+  /*!
+   * @brief read a batch of mosaic tiles as they are stored, without compositing them, eg the chunks of a dask array
+   * over a mosaic. The tiles are selected with one directory lookup, read in file order and decoded together on the
+   * shared ThreadPool into one container, so a batch costs one allocation instead of a readSelected per tile.
+   *
+   * @param plane_coord_ the constraints of the plane the tiles are in, every dimension but M has to be given so
+   * each M index is one subblock
+   * @param m_indices_ the M indexes of the tiles, empty for every tile of the plane. The tiles are returned in
+   * SubblockSortable order, ie by ascending M index, and an index given twice is read once.
+   * @param cores_ The number of cores to use to process threads
+   * @param conversion_ (optional) the conversion of the pixels, see readSelected
+   * @return the tiles, their M indexes and their bounding boxes in the same order
+   * @throw IsNotMosaicException if the file isn't a mosaic
+   * @throw CDimCoordinatesUnderspecifiedException if an M index is more than one subblock or the tiles aren't all
+   * the same size, read the tiles of one size at a time
+   * @throw CDimCoordinatesOverspecifiedException if an M index isn't a tile of the plane
+   */
+  MosaicTiles readMosaicTiles(const libCZI::CDimCoordinate& plane_coord_,
+                              std::vector<int> m_indices_ = {},
+                              unsigned int cores_ = 3,
+                              const PixelConversion& conversion_ = PixelConversion());
 
   /*!
    * Convert the libCZI::DimensionIndex to a character
@@ -257,9 +716,12 @@ public:
    */
   static char dimToChar(libCZI::DimensionIndex di_) { return libCZI::Utils::DimensionToChar(di_); }
 
-  bool shapeIsConsistent() const { return !m_specifyScene; }
+  bool shapeIsConsistent() { return !specifyScene(); }
 
-  virtual ~Reader() { m_czireader->Close(); }
+  /*!
+   * @brief close the file, prefetches still running stop at their next subblock and the file is closed once they have
+   */
+  virtual ~Reader();
 
   /*!
    * @brief get the shape of the loaded images
@@ -323,39 +785,351 @@ public:
    */
   SceneBBoxMap allMosaicSceneBoundingBoxes();
 
-  std::string pixelType()
+  /*!
+   * @brief set the number of bytes of decoded subblocks kept for later reads, 0 (the default) disables the cache.
+   *
+   * readSelected and readMosaic then copy the subblocks they have decoded before out of the cache instead of reading
+   * and decoding them again, which makes overlapping region reads much cheaper. Shrinking the budget evicts the least
+   * recently used subblocks.
+   */
+  void setTileCacheBudget(size_t bytes_) { m_tileCache->setByteBudget(bytes_); }
+
+  /*!
+   * @brief the decoded subblock cache, it's shared with the other Readers of a ReaderPool
+   */
+  const std::shared_ptr<TileCache>& tileCache() const { return m_tileCache; }
+
+  /*!
+   * @brief the hit and miss counts and the size of the decoded subblock cache
+   */
+  TileCache::Statistics tileCacheStatistics() const { return m_tileCache->statistics(); }
+
+  /*!
+   * @brief the counters and timers of the reads and the stream under them, see PerfCounters. They're off until
+   * enableStats(true) so the reads pay nothing for them by default.
+   */
+  PerfCounters::Statistics stats() const { return m_perfCounters->statistics(); }
+
+  /*!
+   * @brief zero the counters of stats(), they stay enabled or disabled
+   */
+  void resetStats() { m_perfCounters->reset(); }
+
+  /*!
+   * @brief start or stop counting, has no effect in a build with PYLIBCZI_NO_PERF_COUNTERS
+   */
+  void enableStats(bool enabled_) { m_perfCounters->setEnabled(enabled_); }
+
+  /*!
+   * @brief set how readSelected and readMosaic allocate the memory of the images they return, reads into a buffer
+   * the caller gives aren't affected. See PixelMemory, the default is a plain heap allocation.
+   */
+  void setAllocationPolicy(const PixelMemory::Policy& policy_)
+  {
+    std::lock_guard<std::mutex> lck(m_policyMutex);
+    m_allocationPolicy = policy_;
+  }
+
+  PixelMemory::Policy allocationPolicy() const
+  {
+    std::lock_guard<std::mutex> lck(m_policyMutex);
+    return m_allocationPolicy;
+  }
+
+  /*!
+   * @brief start reading the subblocks readSelected reads for the same plane in the background and return at once.
+   *
+   * The subblocks are read in file order on the shared ThreadPool. With decode_ and a tile cache budget they are also
+   * decoded into the tile cache so the next readSelected is a memcpy, without a budget only the bytes are read so the
+   * stream's caches (the page cache, a StreamImplBlockCache) are warm. A read made before the prefetch is done still
+   * returns the right pixels, it just reads the subblocks the prefetch hasn't reached itself.
+   * @param plane_coord_ as readSelected, the dimensions are checked before the prefetch starts
+   * @param index_m_ as readSelected
+   * @param decode_ (optional) decode the subblocks into the tile cache if it has a budget
+   * @param cores_ (optional) the number of cores the prefetch reads and decodes on
+   * @return a future that is ready when the prefetch is done, get() rethrows the first error it hit
+   */
+  std::shared_future<void> prefetchSelected(libCZI::CDimCoordinate& plane_coord_,
+                                            int index_m_ = -1,
+                                            bool decode_ = true,
+                                            unsigned int cores_ = 1);
+
+  /*!
+   * @brief prefetchSelected for the tiles readMosaic composites for the same arguments, including the pyramid layer
+   * it would choose for the scale
+   */
+  std::shared_future<void> prefetchMosaic(libCZI::CDimCoordinate plane_coord_,
+                                          float scale_factor_ = 1.0,
+                                          libCZI::IntRect im_box_ = { 0, 0, -1, -1 },
+                                          bool decode_ = true,
+                                          unsigned int cores_ = 1);
+
+  /*!
+   * @brief the in-memory subblock directory the queries are answered from
+   */
+  const SubblockDirectory& directory() const { return m_directory; }
+
+  /*!
+   * @brief the pyramid layers stored in the file, finest first. Layer 0 (the acquired data) is always listed.
+   *
+   * readMosaic with a scale_factor_ below 1 composites each scene from the coarsest layer that is still at least as
+   * fine as the requested scale and covers the scene's part of the region, scenes without such a layer are read from
+   * layer 0.
+   */
+  std::vector<SubblockDirectory::PyramidLayer> pyramidLayers() const { return m_directory.pyramidLayers(); }
+
+  /*!
+   * @brief the table of every subblock in the file, pyramid layers included, eg for planning reads. It is the copy of
+   * the directory kept in memory so nothing is read from the subblocks. The file positions are read into it the
+   * first time, if they can't be read SubblockDirectory::hasFilePositions is false.
+   */
+  const SubblockDirectory& subblockDirectory()
   {
-    // each subblock can apparently have a different pixelType 🙄
-    if (m_pixelType == libCZI::PixelType::Invalid)
-      m_pixelType = getFirstPixelType();
-    return libCZI::Utils::PixelTypeToInformalString(m_pixelType);
+    loadFilePositions();
+    return m_directory;
   }
 
+  /*!
+   * @brief the pixel type of the first subblock, each subblock can apparently have a different pixelType 🙄 and a
+   * read checks the ones it selects
+   */
+  std::string pixelType() const { return libCZI::Utils::PixelTypeToInformalString(m_pixelType); }
+
 private:
   Reader::SubblockIndexVec getMatches(SubblockSortable& match_);
 
-  static bool isPyramid0(const libCZI::SubBlockInfo& info_)
+  /*!
+   * @brief the subblocks readSelected reads, throws if the selection is empty or has to specify a scene
+   */
+  SubblockIndexVec selectedMatches(libCZI::CDimCoordinate& plane_coord_, int index_m_);
+
+  /*!
+   * @brief readSelected for the matches selected by plane_coord_
+   */
+  std::pair<ImagesContainerBase::ImagesContainerBasePtr, std::vector<std::pair<char, size_t>>> readMatches(
+    const SubblockIndexVec& matches_,
+    libCZI::CDimCoordinate& plane_coord_,
+    unsigned int cores_,
+    libCZI::IntRect roi_,
+    void* out_memory_,
+    size_t out_bytes_,
+    const PixelConversion& conversion_,
+    PixelStatistics* statistics_);
+
+  /*!
+   * @brief read the matches of each set into a container of its own, a subblock in several sets is decoded once
+   * @param out_memory_ memory for the images of the only set, see readSelected, or nullptr
+   * @param statistics_ the statistics of the images of the only set, see readSelected, or nullptr
+   */
+  std::vector<std::pair<ImagesContainerBase::ImagesContainerBasePtr, Shape>> readMatchSets(
+    const std::vector<const SubblockIndexVec*>& sets_,
+    unsigned int cores_,
+    libCZI::IntRect roi_,
+    void* out_memory_,
+    size_t out_bytes_,
+    const PixelConversion& conversion_,
+    PixelStatistics* statistics_);
+
+  /*!
+   * @brief the group of the statistics each match is accumulated into, in the order of the matches, and the shape
+   * of the groups. Throws CDimCoordinatesUnderspecifiedException if the planes grouped by plane aren't a full grid.
+   */
+  std::vector<size_t> statisticsGroups(const SubblockIndexVec& matches_,
+                                       StatisticsOptions::Group group_,
+                                       const libCZI::IntRect& roi_,
+                                       Shape& shape_) const;
+
+  /*!
+   * @brief the shape of the images made from the matches, this is what ImageFactory::getFixedShape gives once they
+   * are read
+   */
+  Shape shapeOfMatches(const SubblockIndexVec& matches_, const libCZI::IntRect& roi_) const;
+
+  /*!
+   * @brief what readProjected and readBinned fold together
+   */
+  struct Reduction
+  {
+    Projection::Mode mode;
+    char dim;     ///< the dimension whose planes are folded, 0 for none
+    size_t depth; ///< the planes of dim folded into one, 0 for all of them, which drops dim from the shape
+    size_t binX;
+    size_t binY;
+  };
+
+  /*!
+   * @brief the planes the matches are folded into, numbered in the C order of shape
+   */
+  struct ReducedPlanes
   {
-    return (info_.logicalRect.w == info_.physicalSize.w && info_.logicalRect.h == info_.physicalSize.h);
-  }
+    Shape shape;                 ///< the shape of the result
+    std::vector<size_t> planeOf; ///< the plane each match is accumulated into, in the order of the matches
+    std::vector<size_t> depths;  ///< the matches accumulated into each plane
+  };
+
+  /*!
+   * @brief throws CDimCoordinatesOverspecifiedException if the reduction's dim isn't a dimension of the file,
+   * CDimCoordinatesUnderspecifiedException if the planes aren't a full grid of the other dimensions and
+   * std::invalid_argument if a factor is 0 or the bins don't fit in a plane
+   */
+  ReducedPlanes reducedPlanes(const SubblockIndexVec& matches_,
+                              const Reduction& reduction_,
+                              const libCZI::IntRect& roi_) const;
+
+  /*!
+   * @brief readProjected and readBinned for the matches they select
+   */
+  std::pair<ImagesContainerBase::ImagesContainerBasePtr, Shape> readReduced(const SubblockIndexVec& matches_,
+                                                                            const Reduction& reduction_,
+                                                                            unsigned int cores_,
+                                                                            libCZI::IntRect roi_,
+                                                                            void* out_memory_,
+                                                                            size_t out_bytes_);
+
+  TileCache::Key cacheKey(int subblock_index_) const { return TileCache::keyOf(m_cacheId, subblock_index_); }
+
+  /*!
+   * @brief false for the { 0, 0, -1, -1 } region which means the whole plane
+   */
+  static bool isRoi(const libCZI::IntRect& roi_) { return !(roi_.w == -1 && roi_.h == -1); }
+
+  /*!
+   * @brief check the readMosaic arguments, a region of { 0, 0, -1, -1 } is replaced by the whole mosaic
+   * @return the subblocks matching the plane
+   */
+  SubblockIndexVec mosaicMatches(libCZI::CDimCoordinate& plane_coord_, libCZI::IntRect& im_box_);
+
+  /*!
+   * @brief the planes in SubblockSortable order, throws CDimCoordinatesUnderspecifiedException if they aren't a full
+   * grid of the dimensions they set, see readMosaicPlanes
+   */
+  static std::vector<libCZI::CDimCoordinate> sortedPlanes(std::vector<libCZI::CDimCoordinate> planes_);
+
+  /*!
+   * @brief the tiles readMosaic composites, the layer-0 matches of each scene are swapped for a pyramid layer when
+   * the scale allows it, see pyramidLayers
+   */
+  std::vector<MosaicCompositor::Tile> mosaicTiles(const libCZI::CDimCoordinate& plane_coord_,
+                                                  const libCZI::IntRect& im_box_,
+                                                  float scale_factor_,
+                                                  const SubblockIndexVec& matches_) const;
+
+  /*!
+   * @brief decode and draw tiles_, pairs of (compositor, tile), into plane_pixels_ of their compositor on the shared
+   * ThreadPool, in file order when the file positions are known. The tiles are decoded through cache_.
+   */
+  void drawMosaicTiles(const std::vector<MosaicCompositor>& compositors_,
+                       const std::vector<void*>& plane_pixels_,
+                       const std::vector<std::pair<size_t, size_t>>& tiles_,
+                       unsigned int cores_,
+                       TileCache& cache_);
+
+  /*!
+   * @brief the ReadPipeline jobs of subblock_indices_ in their order, empty if there's only one subblock or the file
+   * positions aren't known
+   */
+  std::vector<ReadPipeline::Job> pipelineJobs(const std::vector<int>& subblock_indices_);
+
+  /*!
+   * @brief call read_(i) for each i of subblock_indices_ with at most cores_ threads, through a ReadPipeline when
+   * the file positions are known and on the shared ThreadPool otherwise
+   */
+  void readSubblocks(const std::vector<int>& subblock_indices_,
+                     unsigned int cores_,
+                     const std::function<void(size_t)>& read_);
+
+  /*!
+   * @brief the decoded pixels of a subblock for MosaicCompositor and Projection, from cache_ when it holds them. The
+   * Reader's own cache is *m_tileCache.
+   */
+  MosaicCompositor::Pixels mosaicPixels(int subblock_index_, TileCache& cache_);
+
+  /*!
+   * @brief queue the background read of subblocks_ for prefetchSelected and prefetchMosaic, the task only holds
+   * shared state so it doesn't need the Reader
+   */
+  std::shared_future<void> prefetchSubblocks(const std::vector<int>& subblocks_, bool decode_, unsigned int cores_);
+
+  /*!
+   * @brief the raw metadata xml of a subblock. With the file positions only the metadata is read from the subblock
+   * segment, not the pixels, otherwise libCZI reads the whole subblock.
+   */
+  std::string subblockMetadata(int subblock_index_);
+
+  /*!
+   * @brief read the subblock file positions into the directory the first time they are needed
+   * @return true if the positions are available
+   */
+  bool loadFilePositions();
 
   static bool isValidRegion(const libCZI::IntRect& in_box_, const libCZI::IntRect& czi_box_);
 
   TileBBoxMap tileBoundingBoxesWith(SubblockSortable& subblocksToFind_);
 
+  /*!
+   * @brief what sceneShape needs to know about a scene, collected for every scene in one pass over the directory
+   */
+  struct SceneSummary
+  {
+    DimIndexRangeMap ranges;                 ///< [min, max + 1) of each dimension set by the scene's subblocks
+    libCZI::IntRect firstRect{ 0, 0, 0, 0 }; ///< the rect of the scene's first subblock in SubblockSortable order
+    int firstRow = -1;                       ///< the directory row of that subblock, -1 if the scene has none
+  };
+
+  std::once_flag m_metadataLoaded;
+  std::shared_ptr<libCZI::IMetadataSegment> m_metadataSegment; // set once under m_metadataLoaded, see readMetaXml
+  RawMetadata m_metadataXml{ nullptr, 0 };
+  std::once_flag m_metadataSerialized;
+  std::string m_metadataString; // set once under m_metadataSerialized, see readMeta
+  std::once_flag m_metadataSummarized;
+  MetadataSummary m_metadataSummary; // set once under m_metadataSummarized, see readMetaSummary
+  std::once_flag m_scenesSummarized;
+  std::once_flag m_shapeChecked;
+  std::map<int, SceneSummary> m_sceneSummaries; ///< by scene index, subblocks without S are in every scene
+  SceneSummary m_unscenedSummary;               ///< the subblocks that don't set S
+
+  /*!
+   * @brief build m_sceneSummaries the first time a scene shape is needed, opening the file doesn't
+   */
+  void summarizeScenes();
+
+  /*!
+   * @brief the summary of scene_index_, scenes without subblocks of their own only have the subblocks without S
+   */
+  const SceneSummary& sceneSummary(int scene_index_);
+
+  /*!
+   * @brief true if the scenes have inconsistent shapes and have to be read one at a time, checked the first time
+   * it's asked for
+   */
+  bool specifyScene();
+
   void checkSceneShapes();
 
+  /*!
+   * @brief the shape of every scene, readDimsRange before the scenes are merged
+   */
+  DimsShape allSceneShapes();
+
   /*!
    * @brief get the pyramid 0 (acquired data) shape
    * @param scene_index_ specifies scene but defaults to the first scene,
    * Scenes can have different sizes
    * @return std::vector<libCZI::IntRect> containing (x0, y0, w, h)
    */
-  libCZI::IntRect getSceneYXSize(int scene_index_ = -1)
-  {
-    std::vector<libCZI::IntRect> matches = getAllSceneYXSize(scene_index_);
-    return matches.empty() ? libCZI::IntRect{ 0, 0, 0, 0 } : matches.front();
-  }
+  libCZI::IntRect getSceneYXSize(int scene_index_ = -1);
+
+  /*!
+   * @brief the scene matches_ are laid out with, -1 (the first scene) unless the scenes have inconsistent shapes
+   */
+  int sceneOf(const SubblockIndexVec& matches_);
+
+  /*!
+   * @brief check roi_ lies inside the scene of matches_, see sceneOf
+   * @return roi_, or the scene's YX box if roi_ is { 0, 0, -1, -1 }
+   * @throws RegionSelectionException if it doesn't
+   */
+  libCZI::IntRect checkRoi(const SubblockIndexVec& matches_, const libCZI::IntRect& roi_);
 
   /*!
    * @brief get the pyramid 0 (acquired data) shape
@@ -366,7 +1140,7 @@ private:
    */
   std::vector<libCZI::IntRect> getAllSceneYXSize(int scene_index_ = -1, bool get_all_matches_ = false);
 
-  libCZI::PixelType getFirstPixelType();
+  libCZI::PixelType getFirstPixelType() const;
 };
 
 }
@@ -0,0 +1,87 @@
+#include "ReaderPool.h"
+
+namespace pylibczi {
+
+ReaderPool::ReaderPool(size_t max_open_files_, size_t tile_cache_bytes_, size_t io_slots_, bool memory_map_)
+  : m_maxOpenFiles(max_open_files_ == 0 ? 1 : max_open_files_)
+  , m_memoryMap(memory_map_)
+  , m_open(std::make_shared<std::atomic<size_t>>(0))
+{
+  m_resources.tileCache = std::make_shared<TileCache>(tile_cache_bytes_);
+  m_resources.ioScheduler = std::make_shared<IoScheduler>(io_slots_);
+}
+
+std::shared_ptr<Reader>
+ReaderPool::reader(const std::wstring& file_name_)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    auto found = m_byName.find(file_name_);
+    if (found != m_byName.end()) {
+      m_hits++;
+      m_entries.splice(m_entries.begin(), m_entries, found->second);
+      return found->second->second;
+    }
+  }
+
+  // the open reads the file's directories, the lock isn't held so the other files don't wait for it
+  std::unique_ptr<Reader> opened(new Reader(file_name_.c_str(), m_memoryMap, nullptr, m_resources));
+  auto open = m_open;
+  (*open)++;
+  std::shared_ptr<Reader> ans(opened.release(), [open](Reader* reader_) {
+    delete reader_;
+    (*open)--;
+  });
+
+  std::vector<std::shared_ptr<Reader>> closing;
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    auto found = m_byName.find(file_name_);
+    if (found != m_byName.end()) {
+      // another thread opened the file at the same time, keep the one in the pool and close this one
+      closing.push_back(std::move(ans));
+      m_entries.splice(m_entries.begin(), m_entries, found->second);
+      ans = found->second->second;
+    } else {
+      m_opens++;
+      closing = evictTo(m_maxOpenFiles - 1);
+      m_evictions += closing.size();
+      m_entries.emplace_front(file_name_, ans);
+      m_byName[file_name_] = m_entries.begin();
+    }
+  }
+  return ans; // closing closes the evicted files without the lock held
+}
+
+std::vector<std::shared_ptr<Reader>>
+ReaderPool::evictTo(size_t keep_)
+{
+  std::vector<std::shared_ptr<Reader>> ans;
+  for (auto entry = m_entries.end(); m_entries.size() > keep_ && entry != m_entries.begin();) {
+    --entry;
+    // only the pool holds an idle reader, the count can't go up without m_mutex
+    if (entry->second.use_count() > 1)
+      continue;
+    ans.push_back(std::move(entry->second));
+    m_byName.erase(entry->first);
+    entry = m_entries.erase(entry);
+  }
+  return ans;
+}
+
+void
+ReaderPool::clear()
+{
+  std::vector<std::shared_ptr<Reader>> closing;
+  std::lock_guard<std::mutex> lck(m_mutex);
+  closing = evictTo(0);
+}
+
+ReaderPool::Statistics
+ReaderPool::statistics() const
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  return Statistics{ m_opens, m_hits, m_evictions, *m_open };
+}
+
+}
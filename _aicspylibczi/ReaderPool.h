@@ -0,0 +1,95 @@
+#ifndef _AICSPYLIBCZI_READERPOOL_H
+#define _AICSPYLIBCZI_READERPOOL_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IoScheduler.h"
+#include "Reader.h"
+#include "TileCache.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief The open Readers of a job that works through many files, eg the thousands of wells of a plate screen.
+ *
+ * The pool keeps the most recently used Readers open so going back to a file doesn't read its directories again,
+ * and closes the least recently used idle ones to keep at most maxOpenFiles() open. A Reader the caller still holds
+ * is never closed, so more are open only while more than maxOpenFiles() are held at once. The Readers share one
+ * byte budgeted TileCache and one IoScheduler, which bounds the reads in flight across every file and hands the
+ * turns out round robin by file. They decode on the ThreadPool every Reader uses.
+ */
+class ReaderPool
+{
+public:
+  struct Statistics
+  {
+    size_t opens;     ///< the files opened
+    size_t hits;      ///< the readers asked for that were open already
+    size_t evictions; ///< the idle readers closed to make room
+    size_t open;      ///< the readers open now, those held by callers after their eviction included
+  };
+
+private:
+  using Entry = std::pair<std::wstring, std::shared_ptr<Reader>>;
+
+  size_t m_maxOpenFiles;
+  bool m_memoryMap;
+  ReaderResources m_resources;
+  mutable std::mutex m_mutex;
+  std::list<Entry> m_entries; // the most recently used first
+  std::unordered_map<std::wstring, std::list<Entry>::iterator> m_byName;
+  std::shared_ptr<std::atomic<size_t>> m_open; // decremented when a Reader is destroyed, which may be after the pool
+  size_t m_opens = 0;
+  size_t m_hits = 0;
+  size_t m_evictions = 0;
+
+  /*!
+   * @brief take the least recently used idle readers out until at most keep_ are left, call with m_mutex held
+   * @return the readers taken out, the caller closes them once the lock is released
+   */
+  std::vector<std::shared_ptr<Reader>> evictTo(size_t keep_);
+
+public:
+  /*!
+   * @param max_open_files_ the readers kept open, at least 1
+   * @param tile_cache_bytes_ the budget of the TileCache the readers share, 0 disables it
+   * @param io_slots_ the reads of the files allowed in flight at once
+   * @param memory_map_ open the files memory mapped, see Reader
+   */
+  explicit ReaderPool(size_t max_open_files_ = 64,
+                      size_t tile_cache_bytes_ = 0,
+                      size_t io_slots_ = 4,
+                      bool memory_map_ = false);
+
+  ReaderPool(const ReaderPool&) = delete;
+  ReaderPool& operator=(const ReaderPool&) = delete;
+
+  /*!
+   * @brief the Reader of a file, opened if it isn't open already. Any number of threads can share it, see Reader.
+   * @param file_name_ the path of the file, the same file reached through different paths is opened once per path
+   */
+  std::shared_ptr<Reader> reader(const std::wstring& file_name_);
+
+  /*!
+   * @brief close every reader no caller holds
+   */
+  void clear();
+
+  size_t maxOpenFiles() const { return m_maxOpenFiles; }
+
+  const std::shared_ptr<TileCache>& tileCache() const { return m_resources.tileCache; }
+
+  const std::shared_ptr<IoScheduler>& ioScheduler() const { return m_resources.ioScheduler; }
+
+  Statistics statistics() const;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_READERPOOL_H
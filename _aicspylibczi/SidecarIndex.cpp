@@ -0,0 +1,171 @@
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "FileIO.h"
+#include "SidecarIndex.h"
+
+namespace pylibczi {
+
+constexpr std::uint32_t SidecarIndex::s_version;
+
+namespace {
+const char s_magic[8] = { 'P', 'Y', 'C', 'Z', 'I', 'I', 'D', 'X' };
+
+// every segment starts with a 32 byte header: a 16 byte id then the allocated and the used size of the data
+constexpr std::uint64_t s_segmentHeaderBytes = 32;
+constexpr std::uint64_t s_fileHeaderBytes = s_segmentHeaderBytes + 512;
+constexpr std::uint64_t s_maxSegmentBytes = std::uint64_t(1) << 31;
+constexpr size_t s_maxSegments = 16;
+
+// the file positions in the file header data, CZI is little-endian like every platform the package is built for
+constexpr size_t s_subblockDirectoryPosition = s_segmentHeaderBytes + 52;
+constexpr size_t s_attachmentDirectoryPosition = s_segmentHeaderBytes + 72;
+
+std::int64_t
+int64At(const std::vector<std::uint8_t>& bytes_, size_t offset_)
+{
+  std::int64_t ans;
+  std::memcpy(&ans, bytes_.data() + offset_, sizeof(ans));
+  return ans;
+}
+
+}
+
+SidecarIndex::SidecarIndex(const wchar_t* file_name_, const wchar_t* index_file_, libCZI::IStream& stream_)
+{
+  FileKey key{ 0, 0 };
+  if (!fileKey(file_name_, key))
+    return;
+  try {
+    if (read(index_file_, key) && headerMatches(stream_)) {
+      m_loaded = true;
+      return;
+    }
+    m_segments.clear();
+    readSegments(stream_);
+  } catch (const std::exception&) {
+    // not a CZI file or a failed read, libCZI reports it when the Reader opens the file
+    m_segments.clear();
+    return;
+  }
+  write(index_file_, key);
+}
+
+bool
+SidecarIndex::fileKey(const wchar_t* file_name_, FileKey& key_)
+{
+  return statFile(file_name_, key_.size, key_.modified);
+}
+
+StreamImplPrefetch::Buffer
+SidecarIndex::readSegment(libCZI::IStream& stream_, std::uint64_t offset_, std::uint64_t size_)
+{
+  if (size_ == 0) {
+    // the segment's own header has its size
+    std::vector<std::uint8_t> header(s_segmentHeaderBytes);
+    std::uint64_t bytesRead = 0;
+    stream_.Read(offset_, header.data(), header.size(), &bytesRead);
+    if (bytesRead != header.size())
+      throw std::runtime_error("Segment header is truncated.");
+    std::int64_t allocated = int64At(header, 16);
+    std::int64_t used = int64At(header, 24);
+    std::int64_t dataBytes = used > 0 ? used : allocated;
+    if (dataBytes <= 0 || static_cast<std::uint64_t>(dataBytes) > s_maxSegmentBytes)
+      throw std::runtime_error("Segment has an invalid size.");
+    size_ = s_segmentHeaderBytes + static_cast<std::uint64_t>(dataBytes);
+  }
+  auto buffer = std::make_shared<std::vector<std::uint8_t>>(static_cast<size_t>(size_));
+  std::uint64_t bytesRead = 0;
+  stream_.Read(offset_, buffer->data(), size_, &bytesRead);
+  buffer->resize(static_cast<size_t>(bytesRead));
+  return StreamImplPrefetch::Buffer(std::move(buffer));
+}
+
+void
+SidecarIndex::readSegments(libCZI::IStream& stream_)
+{
+  auto header = readSegment(stream_, 0, s_fileHeaderBytes);
+  if (header->size() != s_fileHeaderBytes || std::memcmp(header->data(), "ZISRAWFILE", 10) != 0)
+    throw std::runtime_error("Not a CZI file.");
+  m_segments.push_back(Segment{ 0, header });
+  for (size_t position : { s_subblockDirectoryPosition, s_attachmentDirectoryPosition }) {
+    std::int64_t offset = int64At(*header, position);
+    if (offset <= 0) // the file doesn't have the directory
+      continue;
+    auto at = static_cast<std::uint64_t>(offset);
+    m_segments.push_back(Segment{ at, readSegment(stream_, at, 0) });
+  }
+}
+
+bool
+SidecarIndex::read(const wchar_t* index_file_, const FileKey& key_)
+{
+  File file(index_file_, false);
+  std::uint64_t remaining = 0;
+  std::int64_t modified = 0;
+  if (!file.isOpen() || !statFile(index_file_, remaining, modified))
+    return false;
+  char magic[sizeof(s_magic)];
+  std::uint32_t version = 0, count = 0;
+  FileKey key{ 0, 0 };
+  if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, s_magic, sizeof(magic)) != 0 ||
+      !file.read(&version, sizeof(version)) || version != s_version || !file.read(&count, sizeof(count)) ||
+      !file.read(&key.size, sizeof(key.size)) || !file.read(&key.modified, sizeof(key.modified)))
+    return false;
+  if (key.size != key_.size || key.modified != key_.modified || count == 0 || count > s_maxSegments)
+    return false;
+
+  // the sizes are only trusted as far as the index has the bytes, a corrupt size mustn't allocate gigabytes
+  std::uint64_t headerBytes = sizeof(magic) + sizeof(version) + sizeof(count) + sizeof(key.size) + sizeof(key.modified);
+  remaining = remaining < headerBytes ? 0 : remaining - headerBytes;
+  for (std::uint32_t i = 0; i < count; i++) {
+    std::uint64_t offset = 0, size = 0;
+    if (!file.read(&offset, sizeof(offset)) || !file.read(&size, sizeof(size)))
+      return false;
+    remaining = remaining < sizeof(offset) + sizeof(size) ? 0 : remaining - sizeof(offset) - sizeof(size);
+    if (size > s_maxSegmentBytes || size > remaining)
+      return false;
+    remaining -= size;
+    auto buffer = std::make_shared<std::vector<std::uint8_t>>(static_cast<size_t>(size));
+    if (!file.read(buffer->data(), buffer->size()))
+      return false;
+    m_segments.push_back(Segment{ offset, StreamImplPrefetch::Buffer(std::move(buffer)) });
+  }
+  return m_segments.front().offset == 0 && m_segments.front().data->size() == s_fileHeaderBytes;
+}
+
+void
+SidecarIndex::write(const wchar_t* index_file_, const FileKey& key_) const
+{
+  std::random_device random;
+  std::wstring temporary = std::wstring(index_file_) + L"." + std::to_wstring(random()) + L".tmp";
+  bool written = false;
+  {
+    File file(temporary, true);
+    if (!file.isOpen())
+      return; // the index is an optimization, a read-only location just means it isn't used
+    std::uint32_t version = s_version, count = static_cast<std::uint32_t>(m_segments.size());
+    written = file.write(s_magic, sizeof(s_magic)) && file.write(&version, sizeof(version)) &&
+              file.write(&count, sizeof(count)) && file.write(&key_.size, sizeof(key_.size)) &&
+              file.write(&key_.modified, sizeof(key_.modified));
+    for (const auto& segment : m_segments) {
+      std::uint64_t size = segment.data->size();
+      written = written && file.write(&segment.offset, sizeof(segment.offset)) && file.write(&size, sizeof(size)) &&
+                file.write(segment.data->data(), segment.data->size());
+    }
+    written = file.close() && written;
+  }
+  if (!written || !replaceFile(temporary, index_file_))
+    removeFile(temporary);
+}
+
+bool
+SidecarIndex::headerMatches(libCZI::IStream& stream_) const
+{
+  auto header = readSegment(stream_, 0, s_fileHeaderBytes);
+  return *header == *m_segments.front().data;
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef _AICSPYLIBCZI_SIDECARINDEX_H
+#define _AICSPYLIBCZI_SIDECARINDEX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "StreamImplPrefetch.h"
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief A sidecar file holding the segments a Reader parses when it opens a CZI: the file header, the subblock
+ * directory and the attachment directory.
+ *
+ * The Reader serves the segments to libCZI as StreamImplPrefetch spans while it opens the file, so an open with a
+ * valid index reads the file header and nothing else from the (remote) file. The index is only used if the size and
+ * modification time of the file match the ones it was written for and the file header still has the same bytes, the
+ * header holds the file's GUID and the positions of the directories so a rewritten file has a different header. A
+ * missing or stale index is rebuilt from the file and written for the next open, the file is written to a temporary
+ * name and renamed so concurrent writers and readers never see a partial index.
+ */
+class SidecarIndex
+{
+public:
+  struct Segment
+  {
+    std::uint64_t offset; ///< the file position of the segment header
+    StreamImplPrefetch::Buffer data;
+  };
+
+  /*!
+   * @brief load the index, or build and write it. Nothing is thrown, if the index can't be used segments() is empty
+   * and the file is simply opened without it.
+   * @param file_name_ the CZI file
+   * @param index_file_ the sidecar, it's created if it doesn't exist
+   * @param stream_ the stream reading file_name_
+   */
+  SidecarIndex(const wchar_t* file_name_, const wchar_t* index_file_, libCZI::IStream& stream_);
+
+  const std::vector<Segment>& segments() const { return m_segments; }
+
+  /*!
+   * @brief true if the segments came from the index file rather than the CZI file
+   */
+  bool loaded() const { return m_loaded; }
+
+private:
+  struct FileKey
+  {
+    std::uint64_t size;
+    std::int64_t modified;
+  };
+
+  static constexpr std::uint32_t s_version = 1;
+
+  static bool fileKey(const wchar_t* file_name_, FileKey& key_);
+
+  static StreamImplPrefetch::Buffer readSegment(libCZI::IStream& stream_, std::uint64_t offset_, std::uint64_t size_);
+
+  void readSegments(libCZI::IStream& stream_);
+
+  bool read(const wchar_t* index_file_, const FileKey& key_);
+
+  void write(const wchar_t* index_file_, const FileKey& key_) const;
+
+  bool headerMatches(libCZI::IStream& stream_) const;
+
+  std::vector<Segment> m_segments;
+  bool m_loaded = false;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_SIDECARINDEX_H
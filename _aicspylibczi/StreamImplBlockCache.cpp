@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstring>
+
+#include "StreamImplBlockCache.h"
+#include "Threadpool.h"
+
+namespace pylibczi {
+
+StreamImplBlockCache::StreamImplBlockCache(std::shared_ptr<libCZI::IStream> stream_,
+                                           std::uint64_t block_bytes_,
+                                           size_t byte_budget_,
+                                           size_t read_ahead_blocks_)
+  : m_state(std::make_shared<State>())
+  , m_readAheadBlocks(read_ahead_blocks_)
+{
+  m_state->stream = std::move(stream_);
+  m_state->blockBytes = std::max<std::uint64_t>(1, block_bytes_);
+  m_state->maxBlocks = std::max<size_t>(1, static_cast<size_t>(byte_budget_ / m_state->blockBytes));
+}
+
+StreamImplBlockCache::Statistics
+StreamImplBlockCache::statistics() const
+{
+  std::lock_guard<std::mutex> lck(m_state->mutex);
+  return m_state->statistics;
+}
+
+void
+StreamImplBlockCache::State::run(Fetch& fetch_)
+{
+  if (fetch_.claimed.exchange(true))
+    return; // another thread has it
+  try {
+    auto buffer = std::make_shared<std::vector<std::uint8_t>>(static_cast<size_t>(fetch_.size));
+    std::uint64_t bytesRead = 0;
+    stream->Read(fetch_.offset, buffer->data(), fetch_.size, &bytesRead);
+    buffer->resize(static_cast<size_t>(bytesRead)); // the last block of the file is short
+    {
+      std::lock_guard<std::mutex> lck(mutex);
+      statistics.streamReads++;
+      statistics.streamBytes += bytesRead;
+    }
+    fetch_.promise.set_value(Buffer(std::move(buffer)));
+  } catch (...) {
+    forget(fetch_); // the next Read of the blocks tries again
+    fetch_.promise.set_exception(std::current_exception());
+  }
+}
+
+void
+StreamImplBlockCache::State::insert(std::uint64_t block_, std::shared_ptr<Fetch> fetch_)
+{
+  recent.push_front(block_);
+  blocks[block_] = Block{ std::move(fetch_), recent.begin() };
+  while (blocks.size() > maxBlocks) {
+    // the Reads using an evicted block hold its Fetch so they still get the data
+    blocks.erase(recent.back());
+    recent.pop_back();
+  }
+}
+
+void
+StreamImplBlockCache::State::forget(const Fetch& fetch_)
+{
+  std::lock_guard<std::mutex> lck(mutex);
+  for (std::uint64_t block = fetch_.offset / blockBytes; block * blockBytes < fetch_.offset + fetch_.size; block++) {
+    auto found = blocks.find(block);
+    if (found != blocks.end() && found->second.fetch.get() == &fetch_) {
+      recent.erase(found->second.recent);
+      blocks.erase(found);
+    }
+  }
+}
+
+void
+StreamImplBlockCache::Read(std::uint64_t offset_,
+                           void* data_ptr_,
+                           std::uint64_t size_,
+                           std::uint64_t* bytes_read_ptr_)
+{
+  if (size_ == 0) {
+    if (bytes_read_ptr_ != nullptr)
+      *bytes_read_ptr_ = 0;
+    return;
+  }
+  State& state = *m_state;
+  const std::uint64_t blockBytes = state.blockBytes;
+  const std::uint64_t first = offset_ / blockBytes;
+  const std::uint64_t last = (offset_ + size_ - 1) / blockBytes;
+
+  std::vector<std::shared_ptr<Fetch>> needed; // the fetch holding each block from first to last
+  std::vector<std::shared_ptr<Fetch>> own, ahead;
+  {
+    std::lock_guard<std::mutex> lck(state.mutex);
+    // read ahead only follows reads that continue from the previous one, random tile reads don't waste bandwidth
+    bool sequential = first == 0 || state.blocks.count(first - 1) > 0;
+    std::shared_ptr<Fetch> run;
+    for (std::uint64_t block = first; block <= last; block++) {
+      auto found = state.blocks.find(block);
+      if (found != state.blocks.end()) {
+        state.statistics.hits++;
+        state.recent.splice(state.recent.begin(), state.recent, found->second.recent);
+        needed.push_back(found->second.fetch);
+        run.reset();
+        continue;
+      }
+      state.statistics.misses++;
+      if (run == nullptr) {
+        run = std::make_shared<Fetch>(block * blockBytes, blockBytes);
+        own.push_back(run);
+      } else {
+        run->size += blockBytes; // nobody sees the fetch until the lock is released
+      }
+      state.insert(block, run);
+      needed.push_back(run);
+    }
+
+    run.reset();
+    for (std::uint64_t block = last + 1; sequential && block <= last + m_readAheadBlocks; block++) {
+      if (state.blocks.count(block) > 0) {
+        run.reset();
+        continue;
+      }
+      state.statistics.readAheads++;
+      if (run == nullptr) {
+        run = std::make_shared<Fetch>(block * blockBytes, blockBytes);
+        ahead.push_back(run);
+      } else {
+        run->size += blockBytes;
+      }
+      state.insert(block, run);
+    }
+  }
+
+  for (const auto& fetch : ahead) {
+    auto shared = m_state;
+    ThreadPool::instance().submit([shared, fetch]() { shared->run(*fetch); });
+  }
+  for (const auto& fetch : own)
+    state.run(*fetch);
+
+  auto out = static_cast<std::uint8_t*>(data_ptr_);
+  const std::uint64_t end = offset_ + size_;
+  std::uint64_t copied = 0;
+  for (std::uint64_t block = first; block <= last; block++) {
+    Fetch& fetch = *needed[block - first];
+    state.run(fetch); // a read ahead block that is still queued is fetched here rather than waited for
+    const Buffer& data = fetch.data.get();
+    std::uint64_t from = std::max(offset_, block * blockBytes);
+    std::uint64_t to = std::min(end, (block + 1) * blockBytes);
+    std::uint64_t available = std::min(to, fetch.offset + data->size());
+    if (available > from) {
+      std::memcpy(out + (from - offset_), data->data() + (from - fetch.offset), static_cast<size_t>(available - from));
+      copied += available - from;
+    }
+    if (available < to)
+      break; // the end of the file
+  }
+  if (bytes_read_ptr_ != nullptr)
+    *bytes_read_ptr_ = copied;
+}
+
+}
@@ -0,0 +1,109 @@
+#ifndef _AICSPYLIBCZI_STREAMIMPLBLOCKCACHE_H
+#define _AICSPYLIBCZI_STREAMIMPLBLOCKCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief An IStream decorator for high latency streams (object stores, Python file objects) which reads the wrapped
+ * stream in aligned blocks and keeps the most recently used blocks.
+ *
+ * A Read is answered from the cached blocks it covers, the missing blocks are fetched with one read per run of
+ * consecutive blocks so the many small reads libCZI makes while parsing the directory and the segment headers become a
+ * few large reads. After each read the blocks following it are fetched ahead on the ThreadPool. Every block is
+ * fetched once, a Read needing a block another thread is fetching waits for it, a Read needing a read ahead block
+ * that hasn't started yet fetches it itself so a Read never waits on queued work. All methods are thread safe.
+ */
+class StreamImplBlockCache : public libCZI::IStream
+{
+public:
+  struct Statistics
+  {
+    size_t hits;          ///< blocks found in the cache
+    size_t misses;        ///< blocks fetched for a Read
+    size_t readAheads;    ///< blocks fetched ahead of a Read
+    size_t streamReads;   ///< Reads made on the wrapped stream
+    std::uint64_t streamBytes;
+  };
+
+private:
+  using Buffer = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+  /*!
+   * @brief one read of the wrapped stream covering a run of blocks, it runs once on whichever thread gets to it first
+   */
+  struct Fetch
+  {
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::atomic<bool> claimed{ false };
+    std::promise<Buffer> promise;
+    std::shared_future<Buffer> data;
+
+    Fetch(std::uint64_t offset_, std::uint64_t size_)
+      : offset(offset_)
+      , size(size_)
+      , data(promise.get_future().share())
+    {}
+  };
+
+  struct Block
+  {
+    std::shared_ptr<Fetch> fetch;
+    std::list<std::uint64_t>::iterator recent;
+  };
+
+  /*!
+   * @brief the state the read ahead tasks share with the stream, so a task finishing after the stream is destroyed
+   * is harmless
+   */
+  struct State
+  {
+    std::shared_ptr<libCZI::IStream> stream;
+    std::uint64_t blockBytes;
+    size_t maxBlocks;
+    std::mutex mutex;
+    std::list<std::uint64_t> recent; ///< block numbers, the most recently used first
+    std::unordered_map<std::uint64_t, Block> blocks;
+    Statistics statistics{ 0, 0, 0, 0, 0 };
+
+    void run(Fetch& fetch_);
+
+    void insert(std::uint64_t block_, std::shared_ptr<Fetch> fetch_);
+
+    void forget(const Fetch& fetch_);
+  };
+
+  std::shared_ptr<State> m_state;
+  size_t m_readAheadBlocks;
+
+public:
+  /*!
+   * @param stream_ the wrapped stream
+   * @param block_bytes_ the size of a block, the reads of the wrapped stream are aligned to it
+   * @param byte_budget_ the bytes of blocks kept, at least one block is kept
+   * @param read_ahead_blocks_ the blocks fetched after the last block of each Read, 0 turns read ahead off
+   */
+  explicit StreamImplBlockCache(std::shared_ptr<libCZI::IStream> stream_,
+                                std::uint64_t block_bytes_ = std::uint64_t(1) << 20,
+                                size_t byte_budget_ = size_t(64) << 20,
+                                size_t read_ahead_blocks_ = 2);
+
+  Statistics statistics() const;
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_STREAMIMPLBLOCKCACHE_H
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "StreamImplMemoryMapped.h"
+#include "exceptions.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pylibczi {
+
+#ifdef _WIN32
+
+StreamImplMemoryMapped::StreamImplMemoryMapped(const wchar_t* file_name_)
+  : m_data(nullptr)
+  , m_size(0)
+  , m_fileHandle(INVALID_HANDLE_VALUE)
+  , m_mappingHandle(nullptr)
+{
+  HANDLE file = CreateFileW(
+    file_name_, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    std::stringstream msg;
+    msg << "Could not open file for memory mapping, error=" << GetLastError() << ".";
+    throw FilePtrException(msg.str());
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    throw FilePtrException("Could not get the size of the file to memory map!");
+  }
+  m_fileHandle = file;
+  m_size = static_cast<std::uint64_t>(fileSize.QuadPart);
+  if (m_size == 0)
+    return; // an empty file can't be mapped, every read returns 0 bytes
+
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    throw FilePtrException("Could not create a file mapping!");
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw FilePtrException("Could not map a view of the file!");
+  }
+  m_mappingHandle = mapping;
+  m_data = static_cast<const std::uint8_t*>(view);
+}
+
+StreamImplMemoryMapped::~StreamImplMemoryMapped()
+{
+  if (m_data != nullptr)
+    UnmapViewOfFile(m_data);
+  if (m_mappingHandle != nullptr)
+    CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+  CloseHandle(static_cast<HANDLE>(m_fileHandle));
+}
+
+#else
+
+StreamImplMemoryMapped::StreamImplMemoryMapped(const wchar_t* file_name_)
+  : m_data(nullptr)
+  , m_size(0)
+{
+  // convert the wchar_t to an UTF8-string
+  size_t requiredSize = std::wcstombs(nullptr, file_name_, 0);
+  std::string conv(requiredSize, 0);
+  conv.resize(std::wcstombs(&conv[0], file_name_, requiredSize));
+  int fileDescriptor = open(conv.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fileDescriptor == -1) {
+    const auto err = errno;
+    std::stringstream msg;
+    msg << "Could not open " << conv << " for memory mapping, errno=" << err << ".";
+    throw FilePtrException(msg.str());
+  }
+  struct stat fileStat;
+  if (fstat(fileDescriptor, &fileStat) != 0) {
+    close(fileDescriptor);
+    throw FilePtrException("Could not get the size of " + conv + " to memory map it!");
+  }
+  m_size = static_cast<std::uint64_t>(fileStat.st_size);
+  if (m_size > 0) {
+    void* mapped = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (mapped == MAP_FAILED) {
+      const auto err = errno;
+      close(fileDescriptor);
+      std::stringstream msg;
+      msg << "Could not memory map " << conv << ", errno=" << err << ".";
+      throw FilePtrException(msg.str());
+    }
+    // subblocks are read in directory order which isn't file order, don't let the kernel read ahead aggressively
+    madvise(mapped, static_cast<size_t>(m_size), MADV_RANDOM);
+    m_data = static_cast<const std::uint8_t*>(mapped);
+  }
+  close(fileDescriptor); // the mapping keeps its own reference to the file
+}
+
+StreamImplMemoryMapped::~StreamImplMemoryMapped()
+{
+  if (m_data != nullptr)
+    munmap(const_cast<std::uint8_t*>(m_data), static_cast<size_t>(m_size));
+}
+
+#endif
+
+void
+StreamImplMemoryMapped::Read(std::uint64_t offset_,
+                             void* data_ptr_,
+                             std::uint64_t size_,
+                             std::uint64_t* bytes_read_ptr_)
+{
+  std::uint64_t bytesRead = 0;
+  if (offset_ < m_size) {
+    bytesRead = (std::min)(size_, m_size - offset_);
+    std::memcpy(data_ptr_, m_data + offset_, static_cast<size_t>(bytesRead));
+  }
+  if (bytes_read_ptr_ != nullptr)
+    *bytes_read_ptr_ = bytesRead;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef _AICSPYLIBCZI_STREAMIMPLMEMORYMAPPED_H
+#define _AICSPYLIBCZI_STREAMIMPLMEMORYMAPPED_H
+
+#include <cstdint>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief A thread-safe stream that maps the whole file into memory read-only. A Read is a bounds check and a
+ * memcpy out of the mapping, there are no syscalls per read and repeated reads are served from the page cache.
+ * Intended for random access to large files on local storage, network file systems are better served by
+ * StreamImplPositionalRead.
+ */
+class StreamImplMemoryMapped : public libCZI::IStream
+{
+private:
+  const std::uint8_t* m_data;
+  std::uint64_t m_size;
+#ifdef _WIN32
+  void* m_fileHandle;    // HANDLE
+  void* m_mappingHandle; // HANDLE
+#endif
+
+public:
+  StreamImplMemoryMapped() = delete;
+  StreamImplMemoryMapped(const StreamImplMemoryMapped&) = delete;
+  StreamImplMemoryMapped& operator=(const StreamImplMemoryMapped&) = delete;
+
+  /*!
+   * @brief open and map the file
+   * @param file_name_ the path to the file
+   */
+  explicit StreamImplMemoryMapped(const wchar_t* file_name_);
+
+  ~StreamImplMemoryMapped() override;
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override;
+
+  /*!
+   * @brief the size of the mapped file in bytes
+   */
+  std::uint64_t size() const { return m_size; }
+
+  /*!
+   * @brief direct read-only access to the mapping, valid for the lifetime of the stream
+   */
+  const std::uint8_t* data() const { return m_data; }
+};
+
+}
+
+#endif //_AICSPYLIBCZI_STREAMIMPLMEMORYMAPPED_H
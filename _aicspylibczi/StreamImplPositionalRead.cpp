@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "StreamImplPositionalRead.h"
+#include "exceptions.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace pylibczi {
+
+#ifdef _WIN32
+
+StreamImplPositionalRead::StreamImplPositionalRead(const wchar_t* file_name_)
+{
+  HANDLE handle = CreateFileW(file_name_,
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+                              nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    std::stringstream msg;
+    msg << "Could not open file for reading, error=" << GetLastError() << ".";
+    throw FilePtrException(msg.str());
+  }
+  m_handle = handle;
+}
+
+StreamImplPositionalRead::StreamImplPositionalRead(int file_descriptor_)
+{
+  HANDLE source = reinterpret_cast<HANDLE>(_get_osfhandle(file_descriptor_));
+  HANDLE handle = INVALID_HANDLE_VALUE;
+  if (source == INVALID_HANDLE_VALUE ||
+      !DuplicateHandle(GetCurrentProcess(), source, GetCurrentProcess(), &handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+    throw FilePtrException("Reader class could not duplicate the file handle!");
+  }
+  m_handle = handle;
+}
+
+StreamImplPositionalRead::~StreamImplPositionalRead()
+{
+  CloseHandle(static_cast<HANDLE>(m_handle));
+}
+
+void
+StreamImplPositionalRead::Read(std::uint64_t offset_,
+                               void* data_ptr_,
+                               std::uint64_t size_,
+                               std::uint64_t* bytes_read_ptr_)
+{
+  std::uint64_t total = 0;
+  auto buffer = static_cast<char*>(data_ptr_);
+  while (total < size_) {
+    // ReadFile takes a DWORD so large requests are split, the offset in the OVERLAPPED struct makes the read
+    // positional and independent of the handle's file pointer
+    DWORD chunk =
+      static_cast<DWORD>((std::min<std::uint64_t>)(size_ - total, (std::numeric_limits<DWORD>::max)()));
+    std::uint64_t position = offset_ + total;
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+    DWORD bytesRead = 0;
+    if (!ReadFile(static_cast<HANDLE>(m_handle), buffer + total, chunk, &bytesRead, &overlapped)) {
+      const auto err = GetLastError();
+      if (err == ERROR_HANDLE_EOF)
+        break;
+      std::stringstream msg;
+      msg << "Read at file-position " << position << " failed, error=" << err << ".";
+      throw std::runtime_error(msg.str());
+    }
+    if (bytesRead == 0)
+      break; // end of file
+    total += bytesRead;
+  }
+  if (bytes_read_ptr_ != nullptr)
+    *bytes_read_ptr_ = total;
+}
+
+#else
+
+StreamImplPositionalRead::StreamImplPositionalRead(const wchar_t* file_name_)
+{
+  // convert the wchar_t to an UTF8-string
+  size_t requiredSize = std::wcstombs(nullptr, file_name_, 0);
+  std::string conv(requiredSize, 0);
+  conv.resize(std::wcstombs(&conv[0], file_name_, requiredSize));
+  m_fileDescriptor = open(conv.c_str(), O_RDONLY | O_CLOEXEC);
+  if (m_fileDescriptor == -1) {
+    const auto err = errno;
+    std::stringstream msg;
+    msg << "Could not open " << conv << " for reading, errno=" << err << ".";
+    throw FilePtrException(msg.str());
+  }
+}
+
+StreamImplPositionalRead::StreamImplPositionalRead(int file_descriptor_)
+{
+  m_fileDescriptor = fcntl(file_descriptor_, F_DUPFD_CLOEXEC, 0);
+  if (m_fileDescriptor == -1) {
+    throw FilePtrException("Reader class could not dup the file descriptor!");
+  }
+}
+
+StreamImplPositionalRead::~StreamImplPositionalRead()
+{
+  close(m_fileDescriptor);
+}
+
+void
+StreamImplPositionalRead::Read(std::uint64_t offset_,
+                               void* data_ptr_,
+                               std::uint64_t size_,
+                               std::uint64_t* bytes_read_ptr_)
+{
+  std::uint64_t total = 0;
+  auto buffer = static_cast<char*>(data_ptr_);
+  while (total < size_) {
+    ssize_t bytesRead = pread(m_fileDescriptor, buffer + total, static_cast<size_t>(size_ - total),
+                              static_cast<off_t>(offset_ + total));
+    if (bytesRead == -1) {
+      if (errno == EINTR)
+        continue;
+      const auto err = errno;
+      std::stringstream msg;
+      msg << "Read at file-position " << (offset_ + total) << " failed, errno=" << err << ".";
+      throw std::runtime_error(msg.str());
+    }
+    if (bytesRead == 0)
+      break; // end of file
+    total += static_cast<std::uint64_t>(bytesRead);
+  }
+  if (bytes_read_ptr_ != nullptr)
+    *bytes_read_ptr_ = total;
+}
+
+#endif
+
+}
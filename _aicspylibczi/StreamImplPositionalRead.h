@@ -0,0 +1,50 @@
+#ifndef _AICSPYLIBCZI_STREAMIMPLPOSITIONALREAD_H
+#define _AICSPYLIBCZI_STREAMIMPLPOSITIONALREAD_H
+
+#include <cstdint>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief A thread-safe stream that reads with positional IO (pread on POSIX, ReadFile with an OVERLAPPED offset on
+ * Windows). There is no shared file cursor so no lock is needed and concurrent subblock reads run in parallel.
+ *
+ * The stream either opens the file itself or works on a duplicate of a file descriptor it is given. In both cases
+ * it owns the descriptor/handle and closes it in the destructor.
+ */
+class StreamImplPositionalRead : public libCZI::IStream
+{
+private:
+#ifdef _WIN32
+  void* m_handle; // HANDLE, kept as void* so windows.h isn't pulled into every translation unit
+#else
+  int m_fileDescriptor;
+#endif
+
+public:
+  StreamImplPositionalRead() = delete;
+  StreamImplPositionalRead(const StreamImplPositionalRead&) = delete;
+  StreamImplPositionalRead& operator=(const StreamImplPositionalRead&) = delete;
+
+  /*!
+   * @brief open the file for reading
+   * @param file_name_ the path to the file
+   */
+  explicit StreamImplPositionalRead(const wchar_t* file_name_);
+
+  /*!
+   * @brief duplicate the file descriptor and read from the duplicate, the caller keeps ownership of file_descriptor_
+   * @param file_descriptor_ an open file descriptor, eg from a python file object
+   */
+  explicit StreamImplPositionalRead(int file_descriptor_);
+
+  ~StreamImplPositionalRead() override;
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_STREAMIMPLPOSITIONALREAD_H
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstring>
+
+#include "StreamImplPrefetch.h"
+
+namespace pylibczi {
+
+StreamImplPrefetch::Buffer
+StreamImplPrefetch::prefetch(std::uint64_t offset_, std::uint64_t size_)
+{
+  auto buffer = std::make_shared<std::vector<std::uint8_t>>(static_cast<size_t>(size_));
+  std::uint64_t bytesRead = 0;
+  readStream(offset_, buffer->data(), size_, &bytesRead);
+  buffer->resize(static_cast<size_t>(bytesRead)); // the span may run past the end of the file
+  Buffer ans(std::move(buffer));
+  addSpan(offset_, ans);
+  return ans;
+}
+
+void
+StreamImplPrefetch::replaceSpans(std::shared_ptr<const Spans> spans_)
+{
+  m_numberOfSpans = spans_->size();
+  std::atomic_store(&m_spans, std::move(spans_));
+}
+
+void
+StreamImplPrefetch::addSpan(std::uint64_t offset_, Buffer data_)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  auto spans = std::make_shared<Spans>(*m_spans);
+  spans->push_back(Span{ offset_, std::move(data_) });
+  replaceSpans(std::move(spans));
+}
+
+void
+StreamImplPrefetch::removeSpan(const Buffer& data_)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  auto spans = std::make_shared<Spans>(*m_spans);
+  spans->erase(
+    std::remove_if(spans->begin(), spans->end(), [&data_](const Span& span_) { return span_.data == data_; }),
+    spans->end());
+  replaceSpans(std::move(spans));
+}
+
+void
+StreamImplPrefetch::Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_)
+{
+  if (m_numberOfSpans > 0) {
+    // the snapshot keeps its buffers alive even if the spans are removed while copying
+    std::shared_ptr<const Spans> spans = std::atomic_load(&m_spans);
+    auto found = std::find_if(spans->begin(), spans->end(), [offset_, size_](const Span& span_) {
+      return offset_ >= span_.offset && offset_ + size_ <= span_.offset + span_.data->size();
+    });
+    if (found != spans->end()) {
+      std::memcpy(data_ptr_, found->data->data() + (offset_ - found->offset), static_cast<size_t>(size_));
+      if (bytes_read_ptr_ != nullptr)
+        *bytes_read_ptr_ = size_;
+      return;
+    }
+  }
+  readStream(offset_, data_ptr_, size_, bytes_read_ptr_);
+}
+
+void
+StreamImplPrefetch::readStream(std::uint64_t offset_,
+                               void* data_ptr_,
+                               std::uint64_t size_,
+                               std::uint64_t* bytes_read_ptr_)
+{
+  auto read = [&]() {
+    if (m_counters == nullptr || !m_counters->enabled()) {
+      m_stream->Read(offset_, data_ptr_, size_, bytes_read_ptr_);
+      return;
+    }
+    std::uint64_t bytesRead = size_;
+    std::uint64_t* bytesReadPtr = bytes_read_ptr_ != nullptr ? bytes_read_ptr_ : &bytesRead;
+    PerfCounters::Clock::time_point start = m_counters->start();
+    m_stream->Read(offset_, data_ptr_, size_, bytesReadPtr);
+    m_counters->addStreamRead(start, *bytesReadPtr);
+  };
+  if (m_scheduler == nullptr) {
+    read();
+    return;
+  }
+  IoScheduler::Turn turn = m_scheduler->turn(m_file);
+  read();
+}
+
+}
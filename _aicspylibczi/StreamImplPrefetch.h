@@ -0,0 +1,91 @@
+#ifndef _AICSPYLIBCZI_STREAMIMPLPREFETCH_H
+#define _AICSPYLIBCZI_STREAMIMPLPREFETCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "IoScheduler.h"
+#include "PerfCounters.h"
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief An IStream decorator that serves reads from byte spans which were fetched ahead of time.
+ *
+ * readSelected reads runs of neighbouring subblocks with one large read and adds each run as a span. When libCZI then
+ * reads a subblock the request falls inside a span and is answered with a memcpy. Reads that aren't covered by a
+ * span are passed through to the wrapped stream. Read never takes a lock of its own, it searches a snapshot of the
+ * spans which addSpan and removeSpan replace rather than modify, so the threads sharing a Reader don't queue behind
+ * one another. While no spans are registered a Read costs one atomic load.
+ *
+ * With an IoScheduler, eg the one shared by the files of a ReaderPool, every read of the wrapped stream waits for a
+ * turn first. Reads answered from a span don't. With PerfCounters the reads of the wrapped stream are counted and
+ * timed as StreamRead, the wait for a turn isn't included.
+ */
+class StreamImplPrefetch : public libCZI::IStream
+{
+public:
+  using Buffer = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+private:
+  struct Span
+  {
+    std::uint64_t offset;
+    Buffer data;
+  };
+
+  using Spans = std::vector<Span>;
+
+  std::shared_ptr<libCZI::IStream> m_stream;
+  std::shared_ptr<IoScheduler> m_scheduler;
+  size_t m_file; ///< the id of the stream in m_scheduler
+  std::shared_ptr<PerfCounters> m_counters;
+  std::mutex m_mutex; // serializes addSpan and removeSpan
+  std::shared_ptr<const Spans> m_spans = std::make_shared<const Spans>(); // read and replaced with std::atomic_load
+  std::atomic<size_t> m_numberOfSpans{ 0 };
+
+  void replaceSpans(std::shared_ptr<const Spans> spans_); // call with m_mutex held
+
+  void readStream(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_);
+
+public:
+  /*!
+   * @param scheduler_ schedules the reads of the wrapped stream with those of other streams, nullptr reads at once
+   * @param counters_ counts the reads of the wrapped stream, or nullptr
+   */
+  explicit StreamImplPrefetch(std::shared_ptr<libCZI::IStream> stream_,
+                              std::shared_ptr<IoScheduler> scheduler_ = nullptr,
+                              std::shared_ptr<PerfCounters> counters_ = nullptr)
+    : m_stream(std::move(stream_))
+    , m_scheduler(std::move(scheduler_))
+    , m_file(m_scheduler != nullptr ? m_scheduler->addFile() : 0)
+    , m_counters(std::move(counters_))
+  {}
+
+  /*!
+   * @brief the wrapped stream, reads issued on it bypass the spans
+   */
+  const std::shared_ptr<libCZI::IStream>& stream() const { return m_stream; }
+
+  /*!
+   * @brief fill a buffer from the wrapped stream and make it available as a span
+   * @param offset_ the file offset of the first byte
+   * @param size_ the number of bytes to read
+   * @return the buffer, pass it to removeSpan when it's no longer needed
+   */
+  Buffer prefetch(std::uint64_t offset_, std::uint64_t size_);
+
+  void addSpan(std::uint64_t offset_, Buffer data_);
+
+  void removeSpan(const Buffer& data_);
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_STREAMIMPLPREFETCH_H
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "StreamImplPython.h"
+
+namespace py = pybind11;
+
+namespace pb_helpers {
+
+bool
+StreamImplPython::isReadable(py::handle object_)
+{
+  return py::hasattr(object_, "pread") ||
+         (py::hasattr(object_, "seek") && (py::hasattr(object_, "readinto") || py::hasattr(object_, "read")));
+}
+
+StreamImplPython::StreamImplPython(py::object object_)
+  : m_object(std::move(object_))
+  , m_hasPread(py::hasattr(m_object, "pread"))
+  , m_hasReadinto(py::hasattr(m_object, "readinto"))
+{}
+
+StreamImplPython::~StreamImplPython()
+{
+  // the last reference may go on a worker thread, the object has to be released with the interpreter lock
+  if (Py_IsInitialized()) {
+    py::gil_scoped_acquire gil;
+    m_object = py::object();
+  } else {
+    m_object.release();
+  }
+}
+
+void
+StreamImplPython::Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_)
+{
+  auto out = static_cast<char*>(data_ptr_);
+  std::uint64_t total = 0;
+  py::gil_scoped_acquire gil;
+  try {
+    if (m_hasPread) {
+      py::buffer chunk = m_object.attr("pread")(size_, offset_);
+      py::buffer_info info = chunk.request();
+      total = std::min<std::uint64_t>(size_, static_cast<std::uint64_t>(info.size * info.itemsize));
+      std::memcpy(out, info.ptr, static_cast<size_t>(total));
+    } else {
+      {
+        // wait for the lock without the interpreter lock, the thread holding it may need the interpreter to finish
+        py::gil_scoped_release release;
+        m_mutex.lock();
+      }
+      std::lock_guard<std::mutex> lck(m_mutex, std::adopt_lock);
+      m_object.attr("seek")(offset_);
+      while (total < size_) {
+        std::uint64_t got = 0;
+        if (m_hasReadinto) {
+          auto view = py::reinterpret_steal<py::object>(
+            PyMemoryView_FromMemory(out + total, static_cast<Py_ssize_t>(size_ - total), PyBUF_WRITE));
+          if (!view)
+            throw py::error_already_set();
+          py::object count = m_object.attr("readinto")(view);
+          got = count.is_none() ? 0 : count.cast<std::uint64_t>();
+        } else {
+          py::buffer chunk = m_object.attr("read")(size_ - total);
+          py::buffer_info info = chunk.request();
+          got = std::min<std::uint64_t>(size_ - total, static_cast<std::uint64_t>(info.size * info.itemsize));
+          std::memcpy(out + total, info.ptr, static_cast<size_t>(got));
+        }
+        if (got == 0)
+          break; // the end of the file
+        total += got;
+      }
+    }
+  } catch (py::error_already_set& e) {
+    // libCZI reports std::exceptions as IO errors, the Python exception must not outlive the interpreter lock
+    throw std::runtime_error(std::string("Reading the Python stream failed: ") + e.what());
+  }
+  if (bytes_read_ptr_ != nullptr)
+    *bytes_read_ptr_ = total;
+}
+
+}
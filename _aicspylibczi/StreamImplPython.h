@@ -0,0 +1,43 @@
+#ifndef _AICSPYLIBCZI_STREAMIMPLPYTHON_H
+#define _AICSPYLIBCZI_STREAMIMPLPYTHON_H
+
+#include <cstdint>
+#include <mutex>
+
+#include <pybind11/pybind11.h>
+
+#include "inc_libCZI.h"
+
+namespace pb_helpers {
+
+/*!
+ * @brief An IStream reading a Python object, for file-like objects without a file descriptor such as io.BytesIO or
+ * the files of fsspec/s3fs.
+ *
+ * The object needs either pread(size, offset) returning bytes, which is called concurrently, or seek(offset) with
+ * readinto(buffer) or read(size), which are called one thread at a time. Every Read takes the interpreter lock so the
+ * IStream caster wraps the stream in a StreamImplBlockCache.
+ */
+class StreamImplPython : public libCZI::IStream
+{
+  pybind11::object m_object;
+  bool m_hasPread;
+  bool m_hasReadinto;
+  std::mutex m_mutex; // seek and read are a pair
+
+public:
+  /*!
+   * @brief true if the object has the methods the stream needs
+   */
+  static bool isReadable(pybind11::handle object_);
+
+  explicit StreamImplPython(pybind11::object object_);
+
+  ~StreamImplPython() override;
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_STREAMIMPLPYTHON_H
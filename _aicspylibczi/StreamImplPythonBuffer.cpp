@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <cstring>
+
+#include "StreamImplPythonBuffer.h"
+
+namespace py = pybind11;
+
+namespace pb_helpers {
+
+bool
+StreamImplPythonBuffer::isBuffer(py::handle object_)
+{
+  return PyObject_CheckBuffer(object_.ptr()) == 1;
+}
+
+StreamImplPythonBuffer::StreamImplPythonBuffer(py::handle object_)
+  : m_view()
+  , m_data(nullptr)
+  , m_size(0)
+{
+  // the bytes of any contiguous buffer, whatever its format and shape
+  if (PyObject_GetBuffer(object_.ptr(), &m_view, PyBUF_ANY_CONTIGUOUS) != 0)
+    throw py::error_already_set();
+  m_data = static_cast<const std::uint8_t*>(m_view.buf);
+  m_size = static_cast<std::uint64_t>(m_view.len);
+}
+
+StreamImplPythonBuffer::~StreamImplPythonBuffer()
+{
+  // as in StreamImplPython the last reference may go on a worker thread, the export is released with the lock
+  if (Py_IsInitialized()) {
+    py::gil_scoped_acquire gil;
+    PyBuffer_Release(&m_view);
+  }
+}
+
+void
+StreamImplPythonBuffer::Read(std::uint64_t offset_,
+                             void* data_ptr_,
+                             std::uint64_t size_,
+                             std::uint64_t* bytes_read_ptr_)
+{
+  std::uint64_t bytesRead = 0;
+  if (offset_ < m_size) {
+    bytesRead = (std::min)(size_, m_size - offset_);
+    std::memcpy(data_ptr_, m_data + offset_, static_cast<size_t>(bytesRead));
+  }
+  if (bytes_read_ptr_ != nullptr)
+    *bytes_read_ptr_ = bytesRead;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef _AICSPYLIBCZI_STREAMIMPLPYTHONBUFFER_H
+#define _AICSPYLIBCZI_STREAMIMPLPYTHONBUFFER_H
+
+#include <cstdint>
+
+#include <pybind11/pybind11.h>
+
+#include "inc_libCZI.h"
+
+namespace pb_helpers {
+
+/*!
+ * @brief An IStream reading a CZI that is already in memory, straight from a Python object exporting a contiguous
+ * buffer: bytes, bytearray, memoryview, mmap.mmap, numpy arrays or the buf of a multiprocessing SharedMemory.
+ *
+ * The buffer is borrowed, not copied: the stream holds the export, and with it a reference to the object, until it
+ * is destroyed. A Read is a bounds check and a memcpy without the interpreter lock, so reads are lock-free and
+ * concurrent like StreamImplMemoryMapped. Writing to the buffer while a Reader reads it is the caller's problem, and
+ * an object with an export can't be resized (eg a bytearray or an mmap.mmap).
+ */
+class StreamImplPythonBuffer : public libCZI::IStream
+{
+  Py_buffer m_view;
+  const std::uint8_t* m_data;
+  std::uint64_t m_size;
+
+public:
+  StreamImplPythonBuffer(const StreamImplPythonBuffer&) = delete;
+  StreamImplPythonBuffer& operator=(const StreamImplPythonBuffer&) = delete;
+
+  /*!
+   * @brief true if the object exports a buffer, the stream still throws if it isn't contiguous
+   */
+  static bool isBuffer(pybind11::handle object_);
+
+  /*!
+   * @brief take a read-only, contiguous export of object_, must be called with the interpreter lock. Throws
+   * pybind11::error_already_set if the object has no such buffer.
+   */
+  explicit StreamImplPythonBuffer(pybind11::handle object_);
+
+  ~StreamImplPythonBuffer() override;
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override;
+
+  /*!
+   * @brief the size of the buffer in bytes
+   */
+  std::uint64_t size() const { return m_size; }
+};
+
+}
+
+#endif //_AICSPYLIBCZI_STREAMIMPLPYTHONBUFFER_H
@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+#include "SubblockDirectory.h"
+#include "constants.h"
+
+namespace pylibczi {
+
+constexpr std::int32_t SubblockDirectory::s_unset;
+
+namespace {
+std::atomic<std::uint32_t> s_nextSortKeyLayout{ 1 };
+
+// the buckets are dense while the range of values is at most this many times the number of rows, plus this many
+constexpr std::uint64_t s_denseSpread = 4;
+
+// the bits needed for the values [0, range_]
+unsigned int
+bitsFor(std::uint64_t range_)
+{
+  unsigned int bits = 0;
+  for (; range_ != 0; range_ >>= 1)
+    bits++;
+  return bits;
+}
+}
+
+SubblockDirectory::SubblockDirectory(libCZI::ISubBlockRepository& repository_)
+{
+  size_t numberOfSubblocks = 0;
+  repository_.EnumerateSubBlocks([&numberOfSubblocks](int index_, const libCZI::SubBlockInfo& info_) -> bool {
+    numberOfSubblocks++;
+    return true;
+  });
+
+  m_subblockIndex.reserve(numberOfSubblocks);
+  m_mIndex.reserve(numberOfSubblocks);
+  m_logicalRect.reserve(numberOfSubblocks);
+  m_physicalSize.reserve(numberOfSubblocks);
+  m_pixelType.reserve(numberOfSubblocks);
+  m_compression.reserve(numberOfSubblocks);
+  m_pyramidType.reserve(numberOfSubblocks);
+  m_isLayer0.reserve(numberOfSubblocks);
+
+  repository_.EnumerateSubBlocks([&](int index_, const libCZI::SubBlockInfo& info_) -> bool {
+    Row row = static_cast<Row>(m_subblockIndex.size());
+    m_subblockIndex.push_back(index_);
+    info_.coordinate.EnumValidDimensions([&](libCZI::DimensionIndex di_, int value_) -> bool {
+      auto& column = m_dims[slot(di_)];
+      if (column.empty())
+        column.assign(numberOfSubblocks, s_unset); // first time the dimension is seen
+      column[row] = value_;
+      return true;
+    });
+    m_mIndex.push_back(info_.mIndex);
+    m_logicalRect.push_back(info_.logicalRect);
+    m_physicalSize.push_back(info_.physicalSize);
+    m_pixelType.push_back(info_.pixelType);
+    m_compression.push_back(info_.GetCompressionMode());
+    m_pyramidType.push_back(info_.pyramidType);
+    bool layer0 = (info_.logicalRect.w == info_.physicalSize.w && info_.logicalRect.h == info_.physicalSize.h);
+    m_isLayer0.push_back(layer0 ? 1 : 0);
+    if (layer0)
+      m_layer0Rows.push_back(row);
+    return true;
+  });
+
+  for (size_t i = 0; i < s_numberOfSlots; i++) {
+    if (!m_dims[i].empty())
+      m_dimBuckets[i].build(m_dims[i], m_layer0Rows);
+  }
+  // -1 and libCZI's int max marker for an invalid m-index match any m-index, treat them like an unset dimension
+  std::vector<std::int32_t> mColumn(m_mIndex);
+  std::replace_if(
+    mColumn.begin(),
+    mColumn.end(),
+    [](std::int32_t m_) { return m_ == -1 || m_ == std::numeric_limits<std::int32_t>::max(); },
+    s_unset);
+  m_mBuckets.build(mColumn, m_layer0Rows);
+  assignPyramidLayers();
+}
+
+void
+SubblockDirectory::buildSortKeys(bool use_m_index_)
+{
+  m_sortKeyLayout = 0;
+  m_sortKey.clear();
+  struct Field
+  {
+    const std::vector<std::int32_t>* column;
+    std::int32_t minimum;
+    unsigned int bits;
+  };
+  std::vector<Field> fields;
+  auto addField = [this, &fields](const std::vector<std::int32_t>& column_, std::int32_t lowest_) {
+    std::int32_t minimum = std::numeric_limits<std::int32_t>::max(), maximum = std::numeric_limits<std::int32_t>::min();
+    for (Row row : m_layer0Rows) {
+      if (column_[row] == s_unset || column_[row] < lowest_)
+        return false;
+      minimum = std::min(minimum, column_[row]);
+      maximum = std::max(maximum, column_[row]);
+    }
+    if (m_layer0Rows.empty())
+      minimum = maximum = 0;
+    fields.push_back(Field{ &column_, minimum, bitsFor(std::uint64_t(std::int64_t(maximum) - minimum)) });
+    return true;
+  };
+  for (auto di : Constants::s_sortOrder) {
+    const auto& column = m_dims[slot(di)];
+    if (!column.empty() && !addField(column, s_unset + 1))
+      return;
+  }
+  if (use_m_index_ && !addField(m_mIndex, 0))
+    return;
+  unsigned int totalBits = 0;
+  for (const auto& field : fields)
+    totalBits += field.bits;
+  if (totalBits > 64)
+    return;
+
+  m_sortKey.assign(size(), 0);
+  for (Row row : m_layer0Rows) {
+    std::uint64_t key = 0;
+    for (const auto& field : fields) {
+      std::uint64_t value = std::uint64_t(std::int64_t((*field.column)[row]) - field.minimum);
+      key = field.bits >= 64 ? value : (key << field.bits) | value; // a shift by 64 is undefined
+    }
+    m_sortKey[row] = key;
+  }
+  m_sortKeyLayout = s_nextSortKeyLayout++;
+}
+
+void
+SubblockDirectory::assignPyramidLayers()
+{
+  auto minification = [this](Row row_) {
+    const auto& logical = m_logicalRect[row_];
+    const auto& physical = m_physicalSize[row_];
+    return std::max(physical.w > 0 ? double(logical.w) / physical.w : 1.0,
+                    physical.h > 0 ? double(logical.h) / physical.h : 1.0);
+  };
+
+  // the smallest minification is the first pyramid layer, every layer above it is minified by the same factor again
+  double factor = 0.0;
+  for (Row row = 0; row < size(); row++) {
+    if (!isLayer0(row) && minification(row) > 1.0 && (factor == 0.0 || minification(row) < factor))
+      factor = minification(row);
+  }
+  factor = std::max(2.0, std::round(factor));
+
+  m_pyramidLayer.assign(size(), 0);
+  m_layerRows.assign(1, RowVec());
+  for (Row row = 0; row < size(); row++) {
+    if (isLayer0(row))
+      continue;
+    // the edge tiles of a layer are rounded to whole pixels so their minification is a little off
+    long layer = std::lround(std::log(minification(row)) / std::log(factor));
+    layer = std::max(1L, std::min(layer, long(std::numeric_limits<std::uint8_t>::max())));
+    m_pyramidLayer[row] = static_cast<std::uint8_t>(layer);
+    if (m_layerRows.size() <= static_cast<size_t>(layer))
+      m_layerRows.resize(layer + 1);
+    m_layerRows[layer].push_back(row);
+  }
+
+  m_pyramidLayers.clear();
+  m_pyramidLayers.push_back(PyramidLayer{ 0, 1.0, m_layer0Rows.size() });
+  for (size_t layer = 1; layer < m_layerRows.size(); layer++) {
+    if (!m_layerRows[layer].empty())
+      m_pyramidLayers.push_back(
+        PyramidLayer{ static_cast<int>(layer), std::pow(factor, double(layer)), m_layerRows[layer].size() });
+  }
+}
+
+libCZI::CDimCoordinate
+SubblockDirectory::coordinate(Row row_) const
+{
+  libCZI::CDimCoordinate ans;
+  for (size_t i = static_cast<size_t>(libCZI::DimensionIndex::MinDim); i < s_numberOfSlots; i++) {
+    if (!m_dims[i].empty() && m_dims[i][row_] != s_unset)
+      ans.Set(static_cast<libCZI::DimensionIndex>(i), m_dims[i][row_]);
+  }
+  return ans;
+}
+
+bool
+SubblockDirectory::Constraint::matches(Row row_) const
+{
+  std::int32_t rowValue = (*column)[row_];
+  if (rowValue == value || rowValue == s_unset)
+    return true;
+  // an m-index of -1 (or libCZI's invalid marker) compares equal to any m-index
+  return isMIndex && (rowValue == -1 || rowValue == std::numeric_limits<std::int32_t>::max());
+}
+
+std::vector<SubblockDirectory::Constraint>
+SubblockDirectory::constraintsFor(const libCZI::IDimCoordinate& plane_coord_) const
+{
+  std::vector<Constraint> constraints;
+  plane_coord_.EnumValidDimensions([&](libCZI::DimensionIndex di_, int value_) -> bool {
+    size_t i = slot(di_);
+    if (!m_dims[i].empty()) // a constraint on a dimension no subblock defines can't exclude anything
+      constraints.push_back(Constraint{ &m_dims[i], &m_dimBuckets[i], value_, false });
+    return true;
+  });
+  return constraints;
+}
+
+SubblockDirectory::RowVec
+SubblockDirectory::findRows(const libCZI::IDimCoordinate& plane_coord_, int index_m_, bool use_m_index_) const
+{
+  std::vector<Constraint> constraints = constraintsFor(plane_coord_);
+  if (use_m_index_ && index_m_ != -1)
+    constraints.push_back(Constraint{ &m_mIndex, &m_mBuckets, index_m_, true });
+
+  if (constraints.empty())
+    return m_layer0Rows;
+
+  // start from the smallest candidate set and check the remaining constraints against the columns
+  auto smallest =
+    std::min_element(constraints.begin(), constraints.end(), [](const Constraint& a_, const Constraint& b_) {
+      return a_.buckets->candidateCount(a_.value) < b_.buckets->candidateCount(b_.value);
+    });
+  RowVec candidates;
+  candidates.reserve(smallest->buckets->candidateCount(smallest->value));
+  const RowVec* found = smallest->buckets->find(smallest->value);
+  if (found != nullptr)
+    candidates.insert(candidates.end(), found->begin(), found->end());
+  if (!smallest->buckets->unset.empty()) {
+    candidates.insert(candidates.end(), smallest->buckets->unset.begin(), smallest->buckets->unset.end());
+    std::sort(candidates.begin(), candidates.end());
+  }
+  constraints.erase(smallest);
+
+  RowVec ans;
+  ans.reserve(candidates.size());
+  std::copy_if(candidates.begin(), candidates.end(), std::back_inserter(ans), [&constraints](Row row_) {
+    return std::all_of(constraints.begin(), constraints.end(), [row_](const Constraint& constraint_) {
+      return constraint_.matches(row_);
+    });
+  });
+  return ans;
+}
+
+SubblockDirectory::RowVec
+SubblockDirectory::findLayerRows(const libCZI::IDimCoordinate& plane_coord_, int layer_) const
+{
+  if (layer_ == 0)
+    return findRows(plane_coord_);
+  RowVec ans;
+  if (layer_ < 0 || static_cast<size_t>(layer_) >= m_layerRows.size())
+    return ans;
+  // the pyramid layers are a fraction of the size of layer 0, they aren't bucketed and are checked row by row
+  std::vector<Constraint> constraints = constraintsFor(plane_coord_);
+  const RowVec& rows = m_layerRows[layer_];
+  std::copy_if(rows.begin(), rows.end(), std::back_inserter(ans), [&constraints](Row row_) {
+    return std::all_of(constraints.begin(), constraints.end(), [row_](const Constraint& constraint_) {
+      return constraint_.matches(row_);
+    });
+  });
+  return ans;
+}
+
+SubblockDirectory::Row
+SubblockDirectory::rowOfSubblock(int subblock_index_) const
+{
+  // libCZI numbers the subblocks in directory order so the index is almost always the row
+  if (subblock_index_ >= 0 && static_cast<size_t>(subblock_index_) < m_subblockIndex.size() &&
+      m_subblockIndex[subblock_index_] == subblock_index_)
+    return static_cast<Row>(subblock_index_);
+  auto found = std::lower_bound(m_subblockIndex.begin(), m_subblockIndex.end(), subblock_index_);
+  if (found == m_subblockIndex.end() || *found != subblock_index_)
+    throw std::out_of_range("subblock index not in the directory");
+  return static_cast<Row>(found - m_subblockIndex.begin());
+}
+
+void
+SubblockDirectory::setFilePositions(const std::vector<std::int64_t>& positions_)
+{
+  std::vector<std::int64_t> filePosition(m_subblockIndex.size(), -1);
+  for (size_t row = 0; row < m_subblockIndex.size(); row++) {
+    auto index = static_cast<size_t>(m_subblockIndex[row]);
+    if (index >= positions_.size())
+      return; // the directories don't agree, leave the positions unset
+    filePosition[row] = positions_[index];
+  }
+
+  std::vector<std::int64_t> sorted(filePosition);
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<std::int64_t> segmentExtent(filePosition.size(), -1);
+  for (size_t row = 0; row < filePosition.size(); row++) {
+    auto next = std::upper_bound(sorted.begin(), sorted.end(), filePosition[row]);
+    if (next != sorted.end())
+      segmentExtent[row] = *next - filePosition[row];
+  }
+  m_filePosition = std::move(filePosition);
+  m_segmentExtent = std::move(segmentExtent);
+}
+
+void
+SubblockDirectory::Buckets::build(const std::vector<std::int32_t>& column_, const RowVec& rows_)
+{
+  values.clear();
+  byValue.clear();
+  unset.clear();
+  std::int32_t minValue = std::numeric_limits<std::int32_t>::max();
+  std::int32_t maxValue = std::numeric_limits<std::int32_t>::min();
+  size_t setRows = 0;
+  for (Row row : rows_) {
+    std::int32_t value = column_[row];
+    if (value == s_unset) {
+      unset.push_back(row);
+      continue;
+    }
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+    setRows++;
+  }
+  start = minValue;
+  if (setRows == 0)
+    return;
+
+  // a bucket per value in the range unless most of them would be empty
+  std::uint64_t spread = static_cast<std::uint64_t>(static_cast<std::int64_t>(maxValue) - minValue) + 1;
+  if (spread <= s_denseSpread * setRows + s_denseSpread) {
+    byValue.resize(static_cast<size_t>(spread));
+    for (Row row : rows_) {
+      std::int32_t value = column_[row];
+      if (value != s_unset)
+        byValue[static_cast<size_t>(static_cast<std::int64_t>(value) - start)].push_back(row);
+    }
+    return;
+  }
+
+  values.reserve(setRows);
+  for (Row row : rows_) {
+    if (column_[row] != s_unset)
+      values.push_back(column_[row]);
+  }
+  std::sort(values.begin(), values.end());
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+  byValue.resize(values.size());
+  for (Row row : rows_) {
+    std::int32_t value = column_[row];
+    if (value == s_unset)
+      continue;
+    auto bucket = std::lower_bound(values.begin(), values.end(), value) - values.begin();
+    byValue[static_cast<size_t>(bucket)].push_back(row);
+  }
+}
+
+}
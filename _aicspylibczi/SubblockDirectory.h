@@ -0,0 +1,252 @@
+#ifndef _AICSPYLIBCZI_SUBBLOCKDIRECTORY_H
+#define _AICSPYLIBCZI_SUBBLOCKDIRECTORY_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief An in-memory, columnar copy of the subblock directory.
+ *
+ * The directory is enumerated once when the Reader is opened and every query afterwards is answered from this
+ * table. Each attribute of a subblock is stored in its own column (struct-of-arrays) and a row is the position of
+ * the subblock in the table. For each dimension present in the file (and for M) the pyramid-0 rows are also
+ * bucketed by value so that a constrained query only visits the rows that can possibly match.
+ */
+class SubblockDirectory
+{
+public:
+  using Row = std::uint32_t;
+  using RowVec = std::vector<Row>;
+
+  /*!
+   * @brief a pyramid layer stored in the file, layer 0 is the acquired data
+   */
+  struct PyramidLayer
+  {
+    int layer;
+    double minification; ///< the size of the plane divided by the size of the layer, eg 4.0 for each axis
+    size_t subblocks;
+  };
+
+  static constexpr std::int32_t s_unset = std::numeric_limits<std::int32_t>::min(); ///< dim not set on the subblock
+
+  SubblockDirectory() = default;
+
+  /*!
+   * @brief enumerate the repository once and build the table
+   * @param repository_ the open libCZI reader
+   */
+  explicit SubblockDirectory(libCZI::ISubBlockRepository& repository_);
+
+  size_t size() const { return m_subblockIndex.size(); }
+
+  bool empty() const { return m_subblockIndex.empty(); }
+
+  /*!
+   * @brief is the dimension defined for any subblock in the file
+   */
+  bool hasDimension(libCZI::DimensionIndex di_) const { return !m_dims[slot(di_)].empty(); }
+
+  int subblockIndex(Row row_) const { return m_subblockIndex[row_]; }
+
+  /*!
+   * @brief the value of dimension di_ for the subblock in row_
+   * @return the value or s_unset if the subblock doesn't define the dimension
+   */
+  std::int32_t dimValue(Row row_, libCZI::DimensionIndex di_) const
+  {
+    const auto& column = m_dims[slot(di_)];
+    return column.empty() ? s_unset : column[row_];
+  }
+
+  int mIndex(Row row_) const { return m_mIndex[row_]; }
+
+  const libCZI::IntRect& logicalRect(Row row_) const { return m_logicalRect[row_]; }
+
+  const libCZI::IntSize& physicalSize(Row row_) const { return m_physicalSize[row_]; }
+
+  libCZI::PixelType pixelType(Row row_) const { return m_pixelType[row_]; }
+
+  libCZI::CompressionMode compressionMode(Row row_) const { return m_compression[row_]; }
+
+  libCZI::SubBlockPyramidType pyramidType(Row row_) const { return m_pyramidType[row_]; }
+
+  /*!
+   * @brief the subblock is acquired data (pyramid 0), ie the logical size is the same as the stored size.
+   */
+  bool isLayer0(Row row_) const { return m_isLayer0[row_] != 0; }
+
+  /*!
+   * @brief the pyramid layer of the subblock, 0 for acquired data
+   */
+  int pyramidLayer(Row row_) const { return m_pyramidLayer[row_]; }
+
+  /*!
+   * @brief the layers present in the file, finest first. Layer n is minified by factor^n where factor is the
+   * minification of the finest stored pyramid layer rounded to a whole number (2 or 3 for files written by ZEN).
+   */
+  const std::vector<PyramidLayer>& pyramidLayers() const { return m_pyramidLayers; }
+
+  /*!
+   * @brief rebuild the libCZI coordinate for a row
+   */
+  libCZI::CDimCoordinate coordinate(Row row_) const;
+
+  /*!
+   * @brief all the pyramid-0 rows in the table in directory order
+   */
+  const RowVec& layer0Rows() const { return m_layer0Rows; }
+
+  /*!
+   * @brief pack the coordinate of each pyramid-0 row into a sort key: the value of each dimension of the file in
+   * Constants::s_sortOrder, then M if use_m_index_ is set, each less its minimum in a field just wide enough for
+   * the values in the file, the first dimension in the top bits. Comparing the keys of two rows orders them as the
+   * SubblockSortable comparison does, so sorting and the ordered containers of matches compare integers.
+   *
+   * There are no keys, sortKeyLayout() is 0, if a pyramid-0 row doesn't set every dimension of the file (or, with
+   * use_m_index_, has no m-index) as the comparison then skips the dimension, or if the fields don't fit 64 bits.
+   */
+  void buildSortKeys(bool use_m_index_);
+
+  /*!
+   * @brief the id of the layout of the sort keys, unique to the directory, 0 if it has none
+   */
+  std::uint32_t sortKeyLayout() const { return m_sortKeyLayout; }
+
+  /*!
+   * @brief the sort key of a pyramid-0 row, only meaningful if sortKeyLayout() isn't 0
+   */
+  std::uint64_t sortKey(Row row_) const { return m_sortKey[row_]; }
+
+  /*!
+   * @brief find the pyramid-0 rows matching the constraints.
+   *
+   * The matching rules are the same as the SubblockSortable comparison: a constraint on a dimension the subblock
+   * doesn't define is ignored and M is only used when use_m_index_ is set and index_m_ is not -1.
+   *
+   * @param plane_coord_ the dimension constraints, an empty coordinate matches every pyramid-0 subblock
+   * @param index_m_ the m-index to match or -1 for any
+   * @param use_m_index_ true if index_m_ should be used as a constraint (mosaic files)
+   * @return the matching rows in ascending order
+   */
+  RowVec findRows(const libCZI::IDimCoordinate& plane_coord_, int index_m_ = -1, bool use_m_index_ = false) const;
+
+  /*!
+   * @brief find the rows of a pyramid layer matching the plane, with the same rules as findRows. Pyramid subblocks
+   * usually have no m-index so there is no M constraint.
+   * @param layer_ the pyramid layer, 0 is the same as findRows(plane_coord_)
+   * @return the matching rows in ascending order
+   */
+  RowVec findLayerRows(const libCZI::IDimCoordinate& plane_coord_, int layer_) const;
+
+  /*!
+   * @brief the row holding the subblock with the given libCZI index
+   */
+  Row rowOfSubblock(int subblock_index_) const;
+
+  /*!
+   * @brief store where each subblock segment starts in the file. The positions aren't part of libCZI's SubBlockInfo
+   * so the Reader reads them separately, and only when a read needs them.
+   * @param positions_ the file position of each subblock indexed by the libCZI subblock index
+   */
+  void setFilePositions(const std::vector<std::int64_t>& positions_);
+
+  bool hasFilePositions() const { return !m_filePosition.empty(); }
+
+  std::int64_t filePosition(Row row_) const { return m_filePosition[row_]; }
+
+  /*!
+   * @brief an upper bound on the size of the subblock segment, the distance to the next subblock segment in the file
+   * @return the bound in bytes or -1 for the last subblock in the file
+   */
+  std::int64_t segmentExtent(Row row_) const { return m_segmentExtent[row_]; }
+
+private:
+  static constexpr size_t s_numberOfSlots = static_cast<size_t>(libCZI::DimensionIndex::MaxDim) + 1;
+
+  static size_t slot(libCZI::DimensionIndex di_) { return static_cast<size_t>(di_); }
+
+  /*!
+   * @brief pyramid-0 rows bucketed by value. Rows which don't define the value at all are kept separately as they
+   * match any constraint.
+   *
+   * When the values are close together bucket i holds the rows with value == start + i. When they are spread out, eg
+   * Z values a billion apart or a large m-index on a few tiles, a bucket per value in the range would be far larger
+   * than the table so there is a bucket per value present, values[i] is the value of bucket i.
+   */
+  struct Buckets
+  {
+    std::int32_t start = 0;
+    std::vector<std::int32_t> values; ///< the sorted value of each bucket, empty if the buckets are dense
+    std::vector<RowVec> byValue;
+    RowVec unset;
+
+    void build(const std::vector<std::int32_t>& column_, const RowVec& rows_);
+
+    const RowVec* find(std::int32_t value_) const
+    {
+      if (!values.empty()) {
+        auto found = std::lower_bound(values.begin(), values.end(), value_);
+        if (found == values.end() || *found != value_)
+          return nullptr;
+        return &byValue[static_cast<size_t>(found - values.begin())];
+      }
+      std::int64_t offset = static_cast<std::int64_t>(value_) - start;
+      if (offset < 0 || offset >= static_cast<std::int64_t>(byValue.size()))
+        return nullptr;
+      return &byValue[static_cast<size_t>(offset)];
+    }
+
+    size_t candidateCount(std::int32_t value_) const
+    {
+      const RowVec* found = find(value_);
+      return (found == nullptr ? 0 : found->size()) + unset.size();
+    }
+  };
+
+  struct Constraint
+  {
+    const std::vector<std::int32_t>* column;
+    const Buckets* buckets;
+    std::int32_t value;
+    bool isMIndex;
+
+    bool matches(Row row_) const;
+  };
+
+  std::vector<Constraint> constraintsFor(const libCZI::IDimCoordinate& plane_coord_) const;
+
+  void assignPyramidLayers();
+
+  std::vector<std::int32_t> m_subblockIndex;
+  std::array<std::vector<std::int32_t>, s_numberOfSlots> m_dims;
+  std::vector<std::int32_t> m_mIndex;
+  std::vector<libCZI::IntRect> m_logicalRect;
+  std::vector<libCZI::IntSize> m_physicalSize;
+  std::vector<libCZI::PixelType> m_pixelType;
+  std::vector<libCZI::CompressionMode> m_compression;
+  std::vector<libCZI::SubBlockPyramidType> m_pyramidType;
+  std::vector<std::uint8_t> m_isLayer0;
+  std::vector<std::uint8_t> m_pyramidLayer;
+  std::vector<std::int64_t> m_filePosition;
+  std::vector<std::int64_t> m_segmentExtent;
+  std::vector<std::uint64_t> m_sortKey;
+  std::uint32_t m_sortKeyLayout = 0;
+
+  RowVec m_layer0Rows;
+  std::vector<RowVec> m_layerRows; ///< the rows of each pyramid layer, m_layerRows[0] is left empty (m_layer0Rows)
+  std::vector<PyramidLayer> m_pyramidLayers;
+  std::array<Buckets, s_numberOfSlots> m_dimBuckets;
+  Buckets m_mBuckets;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_SUBBLOCKDIRECTORY_H
@@ -0,0 +1,173 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+#include "SubblockMetaVec.h"
+
+namespace pylibczi {
+
+namespace {
+// the characters std::regex matches with \s
+bool
+isSpace(char c_)
+{
+  return c_ == ' ' || c_ == '\t' || c_ == '\n' || c_ == '\v' || c_ == '\f' || c_ == '\r';
+}
+
+bool
+endsWith(const std::string& string_, const char* suffix_)
+{
+  size_t size = std::strlen(suffix_);
+  return string_.size() >= size && string_.compare(string_.size() - size, size, suffix_) == 0;
+}
+
+// read count_ digits at position_
+bool
+readDigits(const std::string& text_, size_t& position_, size_t count_, int& value_)
+{
+  if (position_ + count_ > text_.size())
+    return false;
+  value_ = 0;
+  for (size_t i = 0; i < count_; i++) {
+    char c = text_[position_ + i];
+    if (c < '0' || c > '9')
+      return false;
+    value_ = value_ * 10 + (c - '0');
+  }
+  position_ += count_;
+  return true;
+}
+
+bool
+readChar(const std::string& text_, size_t& position_, char c_)
+{
+  if (position_ >= text_.size() || text_[position_] != c_)
+    return false;
+  position_++;
+  return true;
+}
+
+// the days from 1970-01-01 to a date of the proleptic Gregorian calendar
+std::int64_t
+daysFromCivil(int year_, int month_, int day_)
+{
+  year_ -= month_ <= 2 ? 1 : 0;
+  const int era = (year_ >= 0 ? year_ : year_ - 399) / 400;
+  const int yearOfEra = year_ - era * 400;
+  const int dayOfYear = (153 * (month_ > 2 ? month_ - 3 : month_ + 9) + 2) / 5 + day_ - 1;
+  const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return std::int64_t(era) * 146097 + dayOfEra - 719468;
+}
+
+// YYYY-MM-DDThh:mm:ss with optional fractional seconds and a Z or +hh:mm offset, as CZI files write times
+bool
+parseTime(const std::string& text_, double& seconds_)
+{
+  size_t at = 0;
+  int year, month, day, hour, minute, second;
+  if (!readDigits(text_, at, 4, year) || !readChar(text_, at, '-') || !readDigits(text_, at, 2, month) ||
+      !readChar(text_, at, '-') || !readDigits(text_, at, 2, day) || !readChar(text_, at, 'T') ||
+      !readDigits(text_, at, 2, hour) || !readChar(text_, at, ':') || !readDigits(text_, at, 2, minute) ||
+      !readChar(text_, at, ':') || !readDigits(text_, at, 2, second))
+    return false;
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+    return false;
+  double fraction = 0.0;
+  if (readChar(text_, at, '.')) {
+    double scale = 0.1;
+    size_t first = at;
+    for (; at < text_.size() && text_[at] >= '0' && text_[at] <= '9'; at++, scale /= 10)
+      fraction += (text_[at] - '0') * scale;
+    if (at == first)
+      return false;
+  }
+  int offset = 0;
+  if (at < text_.size() && (text_[at] == '+' || text_[at] == '-')) {
+    int sign = text_[at++] == '-' ? -1 : 1, offsetHours, offsetMinutes;
+    if (!readDigits(text_, at, 2, offsetHours) || !readChar(text_, at, ':') ||
+        !readDigits(text_, at, 2, offsetMinutes))
+      return false;
+    offset = sign * (offsetHours * 3600 + offsetMinutes * 60);
+  } else {
+    readChar(text_, at, 'Z');
+  }
+  if (at != text_.size())
+    return false;
+  std::int64_t whole = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+  seconds_ = static_cast<double>(whole) + fraction;
+  return true;
+}
+}
+
+std::string
+SubblockString::cleanXml(const char* str_p_, size_t str_size_)
+{
+  static const char* s_end = "</METADATA>";
+  std::string ans;
+  ans.reserve(str_size_);
+  const char* end = str_p_ + str_size_;
+  for (const char* c = str_p_; c < end;) {
+    if (isSpace(*c)) {
+      const char* run = c;
+      bool lineBreak = false;
+      for (; c < end && isSpace(*c); c++)
+        lineBreak = lineBreak || (*c == '\r' && c + 1 < end && c[1] == '\n');
+      if (!lineBreak)
+        ans.append(run, c);
+      continue;
+    }
+    if (end - c >= 4 && c[0] == '&' && (c[1] == 'l' || c[1] == 'g') && c[2] == 't' && c[3] == ';') {
+      ans.push_back(c[1] == 'l' ? '<' : '>');
+      c += 4;
+    } else {
+      ans.push_back(*c++);
+    }
+    if (ans.back() == '>' && endsWith(ans, s_end))
+      break;
+  }
+  return ans;
+}
+
+double
+SubblockString::fieldValue(const std::string& xml_, const std::string& name_, bool& is_time_)
+{
+  is_time_ = false;
+  const double missing = std::numeric_limits<double>::quiet_NaN();
+  std::string open = "<" + name_;
+  size_t at = xml_.find(open);
+  // skip longer names with the same start, eg <StageXPositionOffset>
+  while (at != std::string::npos && at + open.size() < xml_.size() && xml_[at + open.size()] != '>' &&
+         !isSpace(xml_[at + open.size()]))
+    at = xml_.find(open, at + 1);
+  if (at == std::string::npos)
+    return missing;
+  size_t first = xml_.find('>', at);
+  if (first == std::string::npos || xml_[first - 1] == '/')
+    return missing; // <name/> has no value
+  size_t last = xml_.find('<', ++first);
+  if (last == std::string::npos)
+    return missing;
+  while (first < last && isSpace(xml_[first]))
+    first++;
+  while (last > first && isSpace(xml_[last - 1]))
+    last--;
+  if (first == last)
+    return missing;
+
+  std::string text = xml_.substr(first, last - first);
+  double ans = 0.0;
+  std::istringstream number(text);
+  number.imbue(std::locale::classic()); // the decimal point is always '.'
+  if (number >> ans && number.peek() == std::char_traits<char>::eof())
+    return ans;
+  if (parseTime(text, ans)) {
+    is_time_ = true;
+    return ans;
+  }
+  return missing;
+}
+
+}
@@ -5,7 +5,10 @@
 #ifndef _PYLIBCZI_SUBBLOCKMETAVEC_H
 #define _PYLIBCZI_SUBBLOCKMETAVEC_H
 
-#include <regex>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "Image.h"
@@ -21,19 +24,38 @@ class SubblockString : public SubblockSortable
 public:
   SubblockString(const libCZI::CDimCoordinate* plane_, int index_m_, bool is_mosaic_, char* str_p_, size_t str_size_)
     : SubblockSortable(plane_, index_m_, is_mosaic_)
-    , m_string(str_p_, str_size_)
-  {
-    // clear string from garbage symbols
-    std::regex lthan("&lt;"), gthan("&gt;"), spce("\\s*\\r\\n\\s*");
-    std::regex metatag("</METADATA>.*"), quote("\\\"");
-    m_string = std::regex_replace(m_string, lthan, "<");
-    m_string = std::regex_replace(m_string, gthan, ">");
-    m_string = std::regex_replace(m_string, spce, "");
-    m_string = std::regex_replace(m_string, metatag, "</METADATA>");
-    m_string += "";
-  }
+    , m_string(cleanXml(str_p_, str_size_))
+  {}
 
   std::string getString() const { return m_string; }
+
+  /*!
+   * @brief clear the metadata xml of a subblock from garbage symbols in one pass: &lt; and &gt; are unescaped, runs
+   * of whitespace holding a line break are removed and everything after </METADATA> (the segment padding) dropped
+   */
+  static std::string cleanXml(const char* str_p_, size_t str_size_);
+
+  /*!
+   * @brief the value of the first <name_> element of the metadata xml
+   * @param xml_ the xml, cleaned by cleanXml
+   * @param name_ the element name, eg StageXPosition
+   * @param is_time_ set to true if the value is an ISO 8601 time such as AcquisitionTime
+   * @return the number, or for a time the seconds since 1970-01-01 UTC, NaN if the element is missing or empty or
+   * its text is neither
+   */
+  static double fieldValue(const std::string& xml_, const std::string& name_, bool& is_time_);
+};
+
+/*!
+ * @brief chosen fields of the metadata of the selected subblocks, see Reader::readSubblockFields. It is a table with
+ * a row per subblock in readSubblockMeta order and a column per field.
+ */
+struct SubblockFields
+{
+  std::vector<std::string> names;
+  std::vector<bool> isTime;       ///< per field, its values are times in seconds since 1970-01-01 UTC
+  std::vector<int> subblockIndex; ///< per row
+  std::vector<double> values;     ///< row after row, NaN where a subblock doesn't have the field
 };
 
 class SubblockMetaVec : public std::vector<SubblockString>
@@ -1,6 +1,7 @@
 #ifndef _PYLIBCZI_SUBBLOCKSORTABLE_H
 #define _PYLIBCZI_SUBBLOCKSORTABLE_H
 
+#include <cstdint>
 #include <utility>
 #include <vector>
 
@@ -16,6 +17,8 @@ protected:
   libCZI::PixelType m_pixelType;
   int m_indexM;
   bool m_isMosaic;
+  std::uint64_t m_sortKey = 0;
+  std::uint32_t m_sortKeyLayout = 0; ///< the SubblockDirectory layout of m_sortKey, 0 if it has no key
 
 public:
   SubblockSortable(const libCZI::CDimCoordinate* plane_,
@@ -36,8 +39,24 @@ public:
 
   int mIndex() const { return m_indexM; }
 
+  bool isMosaic() const { return m_isMosaic; }
+
   libCZI::PixelType pixelType(void) const { return m_pixelType; }
 
+  /*!
+   * @brief set the packed coordinate of the subblock, see SubblockDirectory::buildSortKeys. Two SubblockSortables
+   * with keys of the same layout are compared by their keys, anything else by their coordinates.
+   */
+  void setSortKey(std::uint32_t layout_, std::uint64_t key_)
+  {
+    m_sortKeyLayout = layout_;
+    m_sortKey = key_;
+  }
+
+  std::uint32_t sortKeyLayout() const { return m_sortKeyLayout; }
+
+  std::uint64_t sortKey() const { return m_sortKey; }
+
   std::map<char, size_t> getDimsAsChars() const
   {
     return SubblockSortable::getValidIndexes(m_planeCoordinate, m_indexM, m_isMosaic);
@@ -65,6 +84,8 @@ public:
 
   bool operator<(const SubblockSortable& other_) const
   {
+    if (m_sortKeyLayout != 0 && m_sortKeyLayout == other_.m_sortKeyLayout)
+      return m_sortKey < other_.m_sortKey;
     if (!m_isMosaic || m_indexM == -1 || other_.m_indexM == -1)
       return SubblockSortable::aLessThanB(m_planeCoordinate, other_.m_planeCoordinate);
     return SubblockSortable::aLessThanB(m_planeCoordinate, m_indexM, other_.m_planeCoordinate, other_.m_indexM);
@@ -1,112 +1,281 @@
 #ifndef _AICSPYLIBCZI_THREADPOOL_H
 #define _AICSPYLIBCZI_THREADPOOL_H
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <deque>
+#include <exception>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <thread>
-#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace pylibczi {
 
-struct Tasks
+/*!
+ * @brief A persistent work-stealing thread pool.
+ *
+ * Every worker owns a queue, it takes work from the back of its own queue and when that is empty it steals from the
+ * front of the other workers' queues. Work submitted from outside the pool is dealt round-robin to the workers and
+ * work submitted by a worker goes onto its own queue. The process-wide pool returned by instance() is created on
+ * first use and lives until the module is unloaded so calls don't pay the thread startup cost.
+ */
+class ThreadPool
 {
-  // the mutex, condition variable and deque form a single
-  // thread-safe triggered queue of tasks:
-  std::mutex m;
-  std::condition_variable v;
-  // note that a packaged_task<void> can store a packaged_task<R>:
-  std::deque<std::packaged_task<bool()>> work;
-
-  // this holds futures representing the worker threads being done:
-  std::vector<std::future<void>> finished;
-
-  // queue( lambda ) will enqueue the lambda into the tasks for the threads
-  // to use.  A future of the type the lambda returns is given to let you get
-  // the result out.
-  template<class F, class R = std::result_of_t<F&()>>
-  std::future<R> queue(F&& f)
-  {
-    // wrap the function object into a packaged task, splitting
-    // execution from the return value:
-    std::packaged_task<R()> p(std::forward<F>(f));
+  using Task = std::function<void()>;
 
-    auto r = p.get_future(); // get the return value before we hand off the task
-    {
-      std::unique_lock<std::mutex> l(m);
-      work.emplace_back(std::move(p)); // store the task<R()> as a task<void()>
-    }
-    v.notify_one(); // wake a thread to work on the task
+  struct WorkerQueue
+  {
+    std::mutex m_mutex;
+    std::deque<Task> m_tasks;
+  };
 
-    return r; // return the future result of the task
-  }
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+  std::vector<std::thread> m_threads;
+  std::atomic<size_t> m_nextQueue{ 0 };
+  std::atomic<size_t> m_pending{ 0 }; // queued tasks not yet taken by a worker
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeUp;
+  bool m_stop = false;
 
-  // start N threads in the thread pool.
-  void start(std::size_t N = 1)
+  /*!
+   * @brief the index of the worker queue owned by the calling thread
+   * @return a pointer to the index or nullptr if the caller isn't a worker of this pool
+   */
+  const size_t* workerIndex() const
   {
-    for (std::size_t i = 0; i < N; ++i) {
-      // each thread is a std::async running this->thread_task():
-      finished.push_back(std::async(std::launch::async, [this] { thread_task(); }));
-    }
+    const auto& worker = currentWorker();
+    return worker.first == this ? &worker.second : nullptr;
   }
 
-  // abort() cancels all non-started tasks, and tells every working thread
-  // stop running, and waits for them to finish up.
-  void abort()
+  static std::pair<const ThreadPool*, size_t>& currentWorker()
   {
-    cancel_pending();
-    finish();
+    static thread_local std::pair<const ThreadPool*, size_t> s_worker{ nullptr, 0 };
+    return s_worker;
   }
-  // cancel_pending() merely cancels all non-started tasks:
-  void cancel_pending()
+
+  void push(Task task_)
   {
-    std::unique_lock<std::mutex> l(m);
-    work.clear();
+    const size_t* own = workerIndex();
+    size_t index = own != nullptr ? *own : m_nextQueue++ % m_queues.size();
+    {
+      // count the task before it is visible so m_pending never drops below zero, taking the sleep mutex orders the
+      // increment with a worker checking m_pending before it waits
+      std::lock_guard<std::mutex> lck(m_sleepMutex);
+      m_pending++;
+    }
+    {
+      std::lock_guard<std::mutex> lck(m_queues[index]->m_mutex);
+      m_queues[index]->m_tasks.push_back(std::move(task_));
+    }
+    m_wakeUp.notify_one();
   }
-  // finish enques a "stop the thread" message for every thread, then waits for them:
-  void finish()
+
+  bool tryPop(size_t index_, Task& task_)
   {
     {
-      std::unique_lock<std::mutex> l(m);
-      for (auto&& unused : finished) {
-        work.push_back({});
+      auto& own = *m_queues[index_];
+      std::lock_guard<std::mutex> lck(own.m_mutex);
+      if (!own.m_tasks.empty()) {
+        task_ = std::move(own.m_tasks.back());
+        own.m_tasks.pop_back();
+        m_pending--;
+        return true;
+      }
+    }
+    for (size_t i = 1; i < m_queues.size(); i++) {
+      auto& victim = *m_queues[(index_ + i) % m_queues.size()];
+      std::lock_guard<std::mutex> lck(victim.m_mutex);
+      if (!victim.m_tasks.empty()) {
+        task_ = std::move(victim.m_tasks.front());
+        victim.m_tasks.pop_front();
+        m_pending--;
+        return true;
       }
     }
-    v.notify_all();
-    finished.clear();
+    return false;
   }
-  ~Tasks() { finish(); }
 
-private:
-  // the work that a worker thread does:
-  void thread_task()
+  void workerLoop(size_t index_)
   {
+    currentWorker() = std::make_pair(this, index_);
     while (true) {
-      // pop a task off the queue:
-      std::packaged_task<bool()> f;
-      {
-        // usual thread-safe queue code:
-        std::unique_lock<std::mutex> l(m);
-        if (work.empty()) {
-          v.wait(l, [&] { return !work.empty(); });
-        }
-        f = std::move(work.front());
-        work.pop_front();
+      Task task;
+      if (tryPop(index_, task)) {
+        task();
+        continue;
       }
-      // if the task is invalid, it means we are asked to abort:
-      if (!f.valid())
+      std::unique_lock<std::mutex> lck(m_sleepMutex);
+      m_wakeUp.wait(lck, [this] { return m_stop || m_pending > 0; });
+      if (m_stop && m_pending == 0)
         return;
-      // otherwise, run the task:
-      f();
     }
   }
+
+  /*!
+   * @brief the state shared by the threads working on one parallelFor call. It is held by shared_ptr so a helper
+   * task that only starts after the loop has finished can still safely look at it.
+   */
+  struct ForLoop
+  {
+    explicit ForLoop(size_t count_)
+      : m_count(count_)
+    {}
+
+    const size_t m_count;
+    std::atomic<size_t> m_next{ 0 };
+    std::atomic<bool> m_failed{ false };
+    std::exception_ptr m_error;
+    size_t m_done = 0; // guarded by m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+
+    template<class F>
+    void run(F* f_)
+    {
+      size_t done = 0;
+      for (size_t i = m_next++; i < m_count; i = m_next++) {
+        if (!m_failed) {
+          try {
+            (*f_)(i);
+          } catch (...) {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            if (!m_failed.exchange(true))
+              m_error = std::current_exception();
+          }
+        }
+        done++;
+      }
+      if (done > 0) {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_done += done;
+        if (m_done == m_count)
+          m_finished.notify_all();
+      }
+    }
+  };
+
+public:
+  /*!
+   * @brief create a pool with a fixed number of workers
+   * @param number_of_workers_ the number of threads, at least one thread is always created
+   */
+  explicit ThreadPool(size_t number_of_workers_)
+  {
+    number_of_workers_ = std::max<size_t>(1, number_of_workers_);
+    for (size_t i = 0; i < number_of_workers_; i++)
+      m_queues.emplace_back(new WorkerQueue);
+    for (size_t i = 0; i < number_of_workers_; i++)
+      m_threads.emplace_back([this, i] { workerLoop(i); });
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lck(m_sleepMutex);
+      m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& thread : m_threads)
+      thread.join();
+  }
+
+  /*!
+   * @brief the pool shared by all Readers in the process, the calling thread works too so it is sized to leave one
+   * core for it. The pool is intentionally never destroyed, joining threads during static destruction (module
+   * unload) can deadlock on some platforms.
+   */
+  static ThreadPool& instance()
+  {
+    static ThreadPool* s_pool = new ThreadPool(hardwareThreads() > 1 ? hardwareThreads() - 1 : 1);
+    return *s_pool;
+  }
+
+  /*!
+   * @brief std::thread::hardware_concurrency() or 1 if it can't be determined (it returns 0 in that case)
+   */
+  static unsigned int hardwareThreads()
+  {
+    unsigned int threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+  }
+
+  /*!
+   * @brief clamp a requested number of cores to [1, hardwareThreads()]
+   */
+  static unsigned int coresFor(unsigned int requested_)
+  {
+    return std::max(1u, std::min(requested_, hardwareThreads()));
+  }
+
+  size_t size() const { return m_threads.size(); }
+
+  /*!
+   * @brief the index of the worker the calling thread is, in [0, size()), or size() if it isn't a worker of the pool
+   */
+  size_t workerSlot() const
+  {
+    const size_t* own = workerIndex();
+    return own != nullptr ? *own : size();
+  }
+
+  /*!
+   * @brief queue a function on the pool
+   * @return a future holding the result or the exception thrown by f_
+   */
+  template<class F, class R = std::result_of_t<F&()>>
+  std::future<R> submit(F&& f_)
+  {
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f_));
+    auto result = task->get_future();
+    push([task]() { (*task)(); });
+    return result;
+  }
+
+  /*!
+   * @brief call f_(i) for every i in [0, count_) and return when all of them are done.
+   *
+   * At most cores_ threads work on the loop, the calling thread is one of them so a loop limited to one core runs
+   * inline. Indexes are handed out dynamically so uneven work is balanced. The caller only waits for the indexes
+   * to be done, never for queued helpers to start, so a parallelFor issued from inside a pool task can't deadlock.
+   *
+   * @param count_ the number of iterations
+   * @param cores_ the maximum number of threads to use, 0 means all of them
+   * @param f_ a callable taking a size_t index, the first exception thrown is rethrown here once the loop is done
+   */
+  template<class F>
+  void parallelFor(size_t count_, unsigned int cores_, F&& f_)
+  {
+    if (count_ == 0)
+      return;
+    size_t threads = cores_ == 0 ? size() + 1 : std::min<size_t>(coresFor(cores_), size() + 1);
+    threads = std::min(threads, count_);
+    if (threads <= 1) {
+      for (size_t i = 0; i < count_; i++)
+        f_(i);
+      return;
+    }
+
+    auto loop = std::make_shared<ForLoop>(count_);
+    auto* function = &f_;
+    for (size_t i = 1; i < threads; i++)
+      push([loop, function]() { loop->run(function); });
+    loop->run(function);
+
+    std::unique_lock<std::mutex> lck(loop->m_mutex);
+    loop->m_finished.wait(lck, [&loop] { return loop->m_done == loop->m_count; });
+    if (loop->m_error)
+      std::rethrow_exception(loop->m_error);
+  }
 };
 
 }
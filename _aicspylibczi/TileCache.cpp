@@ -0,0 +1,105 @@
+#include <cstring>
+
+#include "TileCache.h"
+
+namespace pylibczi {
+
+DecodedTile::DecodedTile(const libCZI::SubBlockInfo& info_, libCZI::IBitmapData& bitmap_)
+  : m_info(info_)
+  , m_pixelType(bitmap_.GetPixelType())
+  , m_size(bitmap_.GetSize())
+  , m_stride(m_size.w * libCZI::Utils::GetBytesPerPixel(m_pixelType))
+  , m_pixels(static_cast<size_t>(m_stride) * m_size.h)
+{
+  libCZI::ScopedBitmapLockerP lckScoped{ &bitmap_ };
+  auto source = static_cast<const std::uint8_t*>(lckScoped.ptrDataRoi);
+  for (size_t y = 0; y < m_size.h; y++)
+    std::memcpy(m_pixels.data() + y * m_stride, source + y * lckScoped.stride, m_stride);
+}
+
+libCZI::BitmapLockInfo
+DecodedTile::Lock()
+{
+  libCZI::BitmapLockInfo info;
+  info.ptrData = m_pixels.data();
+  info.ptrDataRoi = m_pixels.data();
+  info.stride = m_stride;
+  info.size = m_pixels.size();
+  return info;
+}
+
+void
+TileCache::evictTo(size_t bytes_)
+{
+  while (m_bytes > bytes_ && !m_entries.empty()) {
+    m_bytes -= m_entries.back().second->bytes();
+    m_bySubblock.erase(m_entries.back().first);
+    m_entries.pop_back();
+  }
+}
+
+void
+TileCache::setByteBudget(size_t byte_budget_)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  m_byteBudget = byte_budget_;
+  evictTo(m_byteBudget);
+}
+
+TileCache::Tile
+TileCache::find(Key subblock_index_)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  if (m_byteBudget == 0)
+    return nullptr;
+  auto found = m_bySubblock.find(subblock_index_);
+  if (found == m_bySubblock.end()) {
+    m_misses++;
+    return nullptr;
+  }
+  m_hits++;
+  m_entries.splice(m_entries.begin(), m_entries, found->second);
+  return found->second->second;
+}
+
+bool
+TileCache::contains(Key subblock_index_) const
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  return m_bySubblock.count(subblock_index_) > 0;
+}
+
+void
+TileCache::insert(Key subblock_index_, Tile tile_)
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  if (tile_ == nullptr || tile_->bytes() > m_byteBudget)
+    return;
+  auto found = m_bySubblock.find(subblock_index_);
+  if (found != m_bySubblock.end()) {
+    // another thread decoded the same subblock first
+    m_bytes -= found->second->second->bytes();
+    m_entries.erase(found->second);
+    m_bySubblock.erase(found);
+  }
+  evictTo(m_byteBudget - tile_->bytes());
+  m_bytes += tile_->bytes();
+  m_entries.emplace_front(subblock_index_, std::move(tile_));
+  m_bySubblock[subblock_index_] = m_entries.begin();
+}
+
+void
+TileCache::clear()
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  evictTo(0);
+}
+
+TileCache::Statistics
+TileCache::statistics() const
+{
+  std::lock_guard<std::mutex> lck(m_mutex);
+  return Statistics{ m_hits, m_misses, m_entries.size(), m_bytes, m_byteBudget };
+}
+
+}
@@ -0,0 +1,140 @@
+#ifndef _AICSPYLIBCZI_TILECACHE_H
+#define _AICSPYLIBCZI_TILECACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief The decoded pixels of one subblock, packed row by row. It is an IBitmapData so it can be handed to libCZI in
+ * place of a freshly decoded bitmap. The pixels never change once the tile is made so any number of threads can
+ * lock it at the same time.
+ */
+class DecodedTile : public libCZI::IBitmapData
+{
+  libCZI::SubBlockInfo m_info;
+  libCZI::PixelType m_pixelType;
+  libCZI::IntSize m_size;
+  std::uint32_t m_stride;
+  std::vector<std::uint8_t> m_pixels;
+
+public:
+  /*!
+   * @brief copy a decoded bitmap
+   * @param info_ the subblock the bitmap was decoded from
+   * @param bitmap_ the decoded pixels
+   */
+  DecodedTile(const libCZI::SubBlockInfo& info_, libCZI::IBitmapData& bitmap_);
+
+  const libCZI::SubBlockInfo& subblockInfo() const { return m_info; }
+
+  const std::uint8_t* data() const { return m_pixels.data(); }
+
+  std::uint32_t stride() const { return m_stride; }
+
+  size_t bytes() const { return m_pixels.size(); }
+
+  libCZI::PixelType GetPixelType() const override { return m_pixelType; }
+
+  libCZI::IntSize GetSize() const override { return m_size; }
+
+  libCZI::BitmapLockInfo Lock() override;
+
+  void Unlock() override {}
+};
+
+/*!
+ * @brief A least recently used cache of decoded subblocks keyed by subblock index.
+ *
+ * A cache can be shared by the Readers of several files, see ReaderPool, each Reader then puts its own id in the top
+ * 32 bits of the key with keyOf.
+ *
+ * Reads that overlap, eg a viewer panning over a mosaic, decode the same subblocks again and again, with the cache
+ * the second read of a subblock is a memcpy. The cache holds at most byteBudget() bytes of pixels, a budget of 0
+ * (the default) disables it. All methods are thread safe, the tiles are shared_ptrs so evicting a tile another
+ * thread is copying from is safe.
+ */
+class TileCache
+{
+public:
+  using Tile = std::shared_ptr<const DecodedTile>;
+  using Key = std::uint64_t;
+
+  struct Statistics
+  {
+    size_t hits;
+    size_t misses;
+    size_t tiles;
+    size_t bytes;
+    size_t byteBudget;
+  };
+
+private:
+  using Entry = std::pair<Key, Tile>;
+
+  mutable std::mutex m_mutex;
+  std::list<Entry> m_entries; // the most recently used first
+  std::unordered_map<Key, std::list<Entry>::iterator> m_bySubblock;
+  size_t m_bytes = 0;
+  size_t m_byteBudget;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+
+  void evictTo(size_t bytes_); // call with m_mutex held
+
+public:
+  explicit TileCache(size_t byte_budget_ = 0)
+    : m_byteBudget(byte_budget_)
+  {}
+
+  /*!
+   * @brief the key of a subblock of the file with the given id
+   */
+  static Key keyOf(std::uint32_t file_, int subblock_index_)
+  {
+    return (Key(file_) << 32) | static_cast<std::uint32_t>(subblock_index_);
+  }
+
+  bool enabled() const
+  {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    return m_byteBudget > 0;
+  }
+
+  /*!
+   * @brief change the budget, tiles are evicted until the cache fits it
+   */
+  void setByteBudget(size_t byte_budget_);
+
+  /*!
+   * @brief look up a subblock and mark it as recently used
+   * @return the tile or nullptr if it isn't cached
+   */
+  Tile find(Key subblock_index_);
+
+  /*!
+   * @brief true if the subblock is cached, unlike find it doesn't count as a use
+   */
+  bool contains(Key subblock_index_) const;
+
+  /*!
+   * @brief add a tile, the least recently used tiles are evicted to make room. A tile larger than the whole budget
+   * isn't cached.
+   */
+  void insert(Key subblock_index_, Tile tile_);
+
+  void clear();
+
+  Statistics statistics() const;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_TILECACHE_H
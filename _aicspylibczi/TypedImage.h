@@ -47,6 +47,26 @@ public:
                                "PixelType with inconsitent type.");
   }
 
+  /*!
+   * @brief construct the image of a subblock with the {H, W} or {H, W, A} shape of size_ and samples_per_pixel_,
+   * the other parameters are as above
+   */
+  TypedImage(libCZI::IntSize size_,
+             size_t samples_per_pixel_,
+             libCZI::PixelType pixel_type_,
+             const libCZI::CDimCoordinate* plane_coordantes_,
+             libCZI::IntRect box_,
+             T* mem_ptr_,
+             int m_index_)
+    : Image(size_, samples_per_pixel_, pixel_type_, plane_coordantes_, box_, m_index_)
+    , m_array(mem_ptr_)
+  {
+    if (!isTypeMatch<T>())
+      throw PixelTypeException(m_pixelType,
+                               "TypedImage asked to create a container for "
+                               "PixelType with inconsitent type.");
+  }
+
   /*!
    * @brief the [] accessor, for accessing or changing a pixel value
    * @param idxs_xy_ The X, Y coordinate in the plane (or X, Y, C} order if 3D.
@@ -92,6 +112,15 @@ public:
                  libCZI::IntSize size_,
                  size_t samples_per_pixel_) override;
 
+  /*!
+   * @brief Copy the image from a raw pixel buffer, eg the data of an uncompressed subblock, into this Image object.
+   * @param data_ptr_ the first pixel of the first row
+   * @param stride_ the number of bytes between the start of consecutive rows
+   * @param size_ the width and height of the image in pixels
+   * @param samples_per_pixel_ the number of channels 1 for GrayX, 3 for BgrX etc.
+   */
+  void loadImage(const void* data_ptr_, size_t stride_, libCZI::IntSize size_, size_t samples_per_pixel_) override;
+
   // TODO Implement set_sort_order() and operator()<
 
   char* ptr_address() override { return ((char*)m_array); }
@@ -101,8 +130,8 @@ template<typename T>
 inline T&
 TypedImage<T>::operator[](const std::vector<size_t>& idxs_xy_)
 {
-  if (idxs_xy_.size() != m_shape.size())
-    throw ImageAccessUnderspecifiedException(idxs_xy_.size(), m_shape.size(), "from TypedImage.operator[].");
+  if (idxs_xy_.size() != m_rank)
+    throw ImageAccessUnderspecifiedException(idxs_xy_.size(), m_rank, "from TypedImage.operator[].");
   size_t idx = calculateIdx(idxs_xy_);
   return m_array[idx];
 }
@@ -111,7 +140,7 @@ template<typename T>
 inline T*
 TypedImage<T>::getRawPtr(std::vector<size_t> list_)
 {
-  std::vector<size_t> zeroPadded(0, m_shape.size());
+  std::vector<size_t> zeroPadded(0, m_rank);
   std::copy(list_.rbegin(), list_.rend(), zeroPadded.rbegin());
   return this->operator[](calculateIdx(zeroPadded));
 }
@@ -122,22 +151,28 @@ TypedImage<T>::loadImage(const std::shared_ptr<libCZI::IBitmapData>& bitmap_ptr_
                          size_t samples_per_pixel_)
 {
   libCZI::ScopedBitmapLockerP lckScoped{ bitmap_ptr_.get() };
+  loadImage(lckScoped.ptrDataRoi, lckScoped.stride, size_, samples_per_pixel_);
+}
+
+template<typename T>
+inline void
+TypedImage<T>::loadImage(const void* data_ptr_, size_t stride_, libCZI::IntSize size_, size_t samples_per_pixel_)
+{
   // WARNING do not compute the end of the array by multiplying stride by
   // height, they are both uint32_t and you'll get an overflow for larger images
-  if (lckScoped.stride % size_.w == 0 && lckScoped.stride / size_.w == sizeof(T)) {
+  size_t pixelsPerRow = samples_per_pixel_ * size_.w;
+  size_t bytesPerRow = pixelsPerRow * sizeof(T);
+  if (stride_ == bytesPerRow) {
     // this is the vast majority of cases
-    std::memcpy(m_array, lckScoped.ptrDataRoi, lckScoped.size);
-  } else if (lckScoped.stride > size_.w * sizeof(T)) {
+    std::memcpy(m_array, data_ptr_, bytesPerRow * size_.h);
+  } else if (stride_ > bytesPerRow) {
     // This mostly handles scaled mosaic images
-    size_t pixelsPerRow = samples_per_pixel_ * size_.w;
-    size_t bytesPerRow = pixelsPerRow * sizeof(T);
     for (uint32_t j = 0; j < size_.h; j++) {
-      std::memcpy(
-        m_array + j * pixelsPerRow, (void*)((char*)(lckScoped.ptrDataRoi) + j * lckScoped.stride), bytesPerRow);
+      std::memcpy(m_array + j * pixelsPerRow, (const void*)((const char*)(data_ptr_) + j * stride_), bytesPerRow);
     }
   } else {
     std::stringstream msg;
-    msg << "Stride < width : " << lckScoped.stride << " < " << size_.w << std::endl;
+    msg << "Stride < width : " << stride_ << " < " << size_.w << std::endl;
     throw StrideAssumptionException(msg.str());
   }
 }
@@ -0,0 +1,208 @@
+#include "XmlScan.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace pylibczi {
+
+namespace {
+using Name = std::pair<const char*, size_t>;
+
+bool
+isSpace(char c_)
+{
+  return c_ == ' ' || c_ == '\t' || c_ == '\r' || c_ == '\n';
+}
+
+bool
+startsWith(const char* at_, const char* end_, const char* prefix_)
+{
+  size_t size = std::strlen(prefix_);
+  return static_cast<size_t>(end_ - at_) >= size && std::memcmp(at_, prefix_, size) == 0;
+}
+
+// the position after the first delimiter_ from at_, end_ if there's none
+const char*
+after(const char* at_, const char* end_, const char* delimiter_)
+{
+  size_t size = std::strlen(delimiter_);
+  const char* found = std::search(at_, end_, delimiter_, delimiter_ + size);
+  return found == end_ ? end_ : found + size;
+}
+
+bool
+sameName(const Name& a_, const Name& b_)
+{
+  return a_.second == b_.second && std::memcmp(a_.first, b_.first, a_.second) == 0;
+}
+
+void
+appendUtf8(std::string& out_, unsigned long code_)
+{
+  if (code_ < 0x80) {
+    out_ += static_cast<char>(code_);
+  } else if (code_ < 0x800) {
+    out_ += static_cast<char>(0xC0 | (code_ >> 6));
+    out_ += static_cast<char>(0x80 | (code_ & 0x3F));
+  } else if (code_ < 0x10000) {
+    out_ += static_cast<char>(0xE0 | (code_ >> 12));
+    out_ += static_cast<char>(0x80 | ((code_ >> 6) & 0x3F));
+    out_ += static_cast<char>(0x80 | (code_ & 0x3F));
+  } else {
+    out_ += static_cast<char>(0xF0 | (code_ >> 18));
+    out_ += static_cast<char>(0x80 | ((code_ >> 12) & 0x3F));
+    out_ += static_cast<char>(0x80 | ((code_ >> 6) & 0x3F));
+    out_ += static_cast<char>(0x80 | (code_ & 0x3F));
+  }
+}
+}
+
+template<typename Visit>
+void
+XmlScan::scan(const std::string& path_, Visit visit_) const
+{
+  std::vector<Name> wanted;
+  for (size_t first = 0; first < path_.size();) {
+    size_t last = std::min(path_.find('/', first), path_.size());
+    wanted.emplace_back(path_.data() + first, last - first);
+    first = last + 1;
+  }
+  std::vector<Name> open;
+  const char* end = m_xml + m_size;
+  for (const char* at = m_xml; (at = std::find(at, end, '<')) != end;) {
+    if (startsWith(at, end, "<!--")) {
+      at = after(at + 4, end, "-->");
+    } else if (startsWith(at, end, "<![CDATA[")) {
+      at = after(at + 9, end, "]]>");
+    } else if (startsWith(at, end, "<?")) {
+      at = after(at + 2, end, "?>");
+    } else if (startsWith(at, end, "<!")) {
+      at = after(at + 2, end, ">");
+    } else if (startsWith(at, end, "</")) {
+      if (!open.empty())
+        open.pop_back();
+      at = after(at + 2, end, ">");
+    } else {
+      const char* name = at + 1;
+      const char* nameEnd = name;
+      while (nameEnd < end && !isSpace(*nameEnd) && *nameEnd != '/' && *nameEnd != '>')
+        nameEnd++;
+      // the closing '>' of the tag, attribute values may hold one
+      const char* close = nameEnd;
+      for (char quote = 0; close < end && (quote != 0 || *close != '>'); close++) {
+        if (quote != 0 && *close == quote)
+          quote = 0;
+        else if (quote == 0 && (*close == '"' || *close == '\''))
+          quote = *close;
+      }
+      if (close == end || nameEnd == name)
+        return;
+      bool selfClosing = close[-1] == '/';
+      open.emplace_back(name, nameEnd - name);
+      if (open.size() == wanted.size() && std::equal(open.rbegin(), open.rend(), wanted.rbegin(), sameName)) {
+        Tag tag{
+          name, open.back().second, nameEnd, selfClosing ? close - 1 : close, selfClosing ? nullptr : close + 1
+        };
+        if (!visit_(tag))
+          return;
+      }
+      if (selfClosing)
+        open.pop_back();
+      at = close + 1;
+    }
+  }
+}
+
+bool
+XmlScan::text(const std::string& path_, std::string& text_) const
+{
+  bool found = false;
+  const char* end = m_xml + m_size;
+  scan(path_, [&](const Tag& tag_) {
+    found = true;
+    text_ = tag_.content == nullptr ? std::string() : unescape(tag_.content, std::find(tag_.content, end, '<'));
+    return false;
+  });
+  return found;
+}
+
+std::vector<std::string>
+XmlScan::attributes(const std::string& path_, const std::string& attribute_) const
+{
+  std::vector<std::string> ans;
+  const Name wanted(attribute_.data(), attribute_.size());
+  scan(path_, [&](const Tag& tag_) {
+    ans.emplace_back();
+    const char* at = tag_.attributes;
+    const char* end = tag_.attributesEnd;
+    while (at < end) {
+      while (at < end && isSpace(*at))
+        at++;
+      const char* name = at;
+      while (at < end && *at != '=' && !isSpace(*at))
+        at++;
+      const Name found(name, at - name);
+      at = std::find_if(at, end, [](char c_) { return c_ == '"' || c_ == '\''; });
+      if (at == end)
+        break;
+      const char* value = at + 1;
+      at = std::find(value, end, *at);
+      if (sameName(found, wanted)) {
+        ans.back() = unescape(value, at);
+        break;
+      }
+      if (at < end)
+        at++;
+    }
+    return true;
+  });
+  return ans;
+}
+
+std::string
+XmlScan::unescape(const char* first_, const char* last_)
+{
+  std::string ans;
+  ans.reserve(last_ - first_);
+  static const std::pair<const char*, char> s_entities[] = {
+    { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+  };
+  for (const char* at = first_; at < last_;) {
+    const char* entity = std::find(at, last_, '&');
+    ans.append(at, entity);
+    if (entity == last_)
+      break;
+    const char* semicolon = std::find(entity, last_, ';');
+    at = entity + 1;
+    if (semicolon == last_) {
+      ans += '&';
+      continue;
+    }
+    if (entity[1] == '#') {
+      bool hex = entity + 2 < semicolon && (entity[2] == 'x' || entity[2] == 'X');
+      char* parsed = nullptr;
+      unsigned long code = std::strtoul(entity + (hex ? 3 : 2), &parsed, hex ? 16 : 10);
+      if (parsed == semicolon && code <= 0x10FFFF) {
+        appendUtf8(ans, code);
+        at = semicolon + 1;
+        continue;
+      }
+    }
+    bool replaced = false;
+    for (const auto& known : s_entities) {
+      if (startsWith(entity, last_, known.first)) {
+        ans += known.second;
+        at = entity + std::strlen(known.first);
+        replaced = true;
+        break;
+      }
+    }
+    if (!replaced)
+      ans += '&'; // not an entity we know, kept as written
+  }
+  return ans;
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef _AICSPYLIBCZI_XMLSCAN_H
+#define _AICSPYLIBCZI_XMLSCAN_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pylibczi {
+
+/*!
+ * @brief A forward scan of the elements of an xml document held in memory, no tree is built and nothing is copied
+ * but the values asked for. Reading a few values from a file with tens of MB of metadata this way is a single
+ * pass over the bytes rather than a parse of the whole document.
+ *
+ * Paths are the element names from the root separated by '/', eg "ImageDocument/Metadata/Information/Image/SizeX",
+ * namespace prefixes are part of the name. Comments, processing instructions, CDATA and DOCTYPE are skipped, the
+ * document isn't validated: the scan stops at the first tag it can't read.
+ */
+class XmlScan
+{
+public:
+  /*!
+   * @brief scan the size_ bytes of xml_, the memory must outlive the XmlScan
+   */
+  XmlScan(const char* xml_, size_t size_)
+    : m_xml(xml_)
+    , m_size(size_)
+  {}
+
+  /*!
+   * @brief the text of the first element at path_, with the predefined and numeric entities replaced
+   * @return false if there's no element at path_
+   */
+  bool text(const std::string& path_, std::string& text_) const;
+
+  /*!
+   * @brief the attribute_ of each element at path_ in document order, an element without it gives an empty string
+   */
+  std::vector<std::string> attributes(const std::string& path_, const std::string& attribute_) const;
+
+  /*!
+   * @brief replace the predefined and numeric character entities of an xml text or attribute value
+   */
+  static std::string unescape(const char* first_, const char* last_);
+
+private:
+  struct Tag
+  {
+    const char* name;
+    size_t nameSize;
+    const char* attributes; ///< from after the name to the closing '>' or "/>"
+    const char* attributesEnd;
+    const char* content; ///< after the closing '>'
+  };
+
+  // calls visit_ with each start tag at path_ until it returns false
+  template<typename Visit>
+  void scan(const std::string& path_, Visit visit_) const;
+
+  const char* m_xml;
+  size_t m_size;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_XMLSCAN_H
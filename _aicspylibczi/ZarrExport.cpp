@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <type_traits>
+
+#ifdef PYLIBCZI_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "DimIndex.h"
+#include "FileIO.h"
+#include "ImageFactory.h"
+#include "Threadpool.h"
+#include "ZarrExport.h"
+#include "exceptions.h"
+
+namespace pylibczi {
+
+namespace {
+void
+writeText(const std::wstring& name_, const std::string& text_)
+{
+  File file(name_, true);
+  if (!file.isOpen() || !file.write(text_.data(), text_.size()) || !file.close())
+    throw ExportException("Can't write a metadata file of the store.");
+}
+
+const char*
+zarrType(libCZI::PixelType pixel_type_)
+{
+  switch (pixel_type_) {
+    case libCZI::PixelType::Gray8:
+      return "|u1";
+    case libCZI::PixelType::Gray16:
+      return "<u2";
+    case libCZI::PixelType::Gray32Float:
+      return "<f4";
+    default:
+      throw PixelTypeException(pixel_type_, "Only Gray8, Gray16 and Gray32Float images can be exported to Zarr.");
+  }
+}
+
+template<typename T>
+void
+downsampleTyped(const T* in_, size_t rows_, size_t width_, T* out_)
+{
+  size_t outWidth = (width_ + 1) / 2;
+  for (size_t y = 0; y < rows_; y += 2) {
+    const T* row0 = in_ + y * width_;
+    const T* row1 = y + 1 < rows_ ? row0 + width_ : row0;
+    for (size_t x = 0; x < width_; x += 2) {
+      size_t x1 = x + 1 < width_ ? x + 1 : x;
+      double sum = double(row0[x]) + double(row0[x1]) + double(row1[x]) + double(row1[x1]);
+      out_[x / 2] = std::is_floating_point<T>::value ? T(sum / 4) : T((sum + 2) / 4); // integers are rounded
+    }
+    out_ += outWidth;
+  }
+}
+
+std::uint64_t
+writeChunk(const std::wstring& name_,
+           const std::vector<std::uint8_t>& chunk_,
+           ZarrExport::Compression compression_,
+           int compression_level_)
+{
+  const void* data = chunk_.data();
+  size_t size = chunk_.size();
+#ifdef PYLIBCZI_HAS_ZSTD
+  std::vector<std::uint8_t> compressed;
+  if (compression_ == ZarrExport::Compression::Zstd) {
+    compressed.resize(ZSTD_compressBound(size));
+    size_t bytes = ZSTD_compress(compressed.data(), compressed.size(), data, size, compression_level_);
+    if (ZSTD_isError(bytes))
+      throw ExportException(std::string("zstd failed: ") + ZSTD_getErrorName(bytes));
+    data = compressed.data();
+    size = bytes;
+  }
+#else
+  (void)compression_;
+  (void)compression_level_;
+#endif
+  File file(name_, true);
+  if (!file.isOpen() || !file.write(data, size) || !file.close())
+    throw ExportException("Can't write a chunk file of the store.");
+  return size;
+}
+}
+
+bool
+ZarrExport::hasZstd()
+{
+#ifdef PYLIBCZI_HAS_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+ZarrExport::ZarrExport(Reader& reader_, libCZI::CDimCoordinate plane_coord_, Options options_)
+  : m_reader(reader_)
+  , m_plane(std::move(plane_coord_))
+  , m_options(options_)
+  , m_mosaic(reader_.isMosaic())
+  , m_statistics{ 0, 0, 0 }
+{
+  if (m_options.chunkZ < 1 || m_options.chunkY < 1 || m_options.chunkX < 1 || m_options.levels < 1)
+    throw ExportException("The chunk sizes and the number of levels must be at least 1.");
+  if (m_options.levels > 1 && m_options.chunkY % 2 != 0)
+    throw ExportException("The chunk height must be even to build a pyramid.");
+  if (m_options.compression == Compression::Zstd && !hasZstd())
+    throw ExportException("The module was built without zstd.");
+
+  int scene = -1;
+  bool hasScene = m_plane.TryGetPosition(libCZI::DimensionIndex::S, &scene);
+  Reader::DimIndexRangeMap ranges = hasScene ? m_reader.sceneShape(scene) : m_reader.readDimsRange().front();
+  for (const auto& range : ranges) {
+    switch (range.first) {
+      case DimIndex::T:
+      case DimIndex::C:
+      case DimIndex::Z:
+      case DimIndex::M: // a mosaic plane composites every tile, a non mosaic file has a single M
+      case DimIndex::Y:
+      case DimIndex::X:
+      case DimIndex::A:
+        continue;
+      case DimIndex::S:
+        if (m_mosaic)
+          continue; // the scenes of a mosaic are composited into one image
+        break;
+      default:
+        break;
+    }
+    if (range.second.second - range.second.first > 1 &&
+        !m_plane.IsValid(dimIndexToDimensionIndex(range.first)))
+      throw CDimCoordinatesUnderspecifiedException(std::string(1, dimIndexToChar(range.first)) +
+                                                   " has several values, it must be set to export to Zarr.");
+  }
+
+  auto exported = [&](DimIndex dim_, bool& in_file_) {
+    int position = 0;
+    auto found = ranges.find(dim_);
+    in_file_ = found != ranges.end();
+    if (m_plane.TryGetPosition(dimIndexToDimensionIndex(dim_), &position))
+      return std::make_pair(position, position + 1);
+    return in_file_ ? found->second : std::make_pair(0, 1);
+  };
+  m_t = exported(DimIndex::T, m_hasT);
+  m_c = exported(DimIndex::C, m_hasC);
+  m_z = exported(DimIndex::Z, m_hasZ);
+
+  libCZI::CDimCoordinate first = m_plane;
+  if (m_hasT)
+    first.Set(libCZI::DimensionIndex::T, m_t.first);
+  if (m_hasC)
+    first.Set(libCZI::DimensionIndex::C, m_c.first);
+  if (m_hasZ)
+    first.Set(libCZI::DimensionIndex::Z, m_z.first);
+  if (m_mosaic) {
+    // readMosaic selects a scene by its region, S isn't allowed in the plane
+    m_box = hasScene ? m_reader.mosaicSceneBoundingBox(scene) : m_reader.mosaicBoundingBox();
+    m_plane.Clear(libCZI::DimensionIndex::S);
+    first.Clear(libCZI::DimensionIndex::S);
+    m_pixelType = m_reader.mosaicShape(first, 1.0, m_box).first;
+  } else {
+    m_box = { 0, 0, ranges[DimIndex::X].second, ranges[DimIndex::Y].second };
+    m_pixelType = m_reader.selectedShape(first).first;
+  }
+  zarrType(m_pixelType); // throws for the types Zarr can't hold as a TCZYX array
+  m_pixelBytes = ImageFactory::sizeOfPixelType(m_pixelType);
+
+  size_t height = m_box.h, width = m_box.w;
+  for (int i = 0; i < m_options.levels; i++) {
+    m_levels.push_back(Level{ height, width, 0, 0, std::wstring(), {} });
+    height = (height + 1) / 2;
+    width = (width + 1) / 2;
+  }
+}
+
+std::vector<size_t>
+ZarrExport::shape(int level_) const
+{
+  const Level& level = m_levels.at(level_);
+  return { size_t(m_t.second - m_t.first), size_t(m_c.second - m_c.first), size_t(m_z.second - m_z.first),
+           level.height, level.width };
+}
+
+void
+ZarrExport::writeMetadata(const std::wstring& path_) const
+{
+  writeText(path_ + L"/.zgroup", "{\"zarr_format\": 2}\n");
+
+  std::ostringstream attrs;
+  attrs << "{\"multiscales\": [{\"version\": \"0.4\", \"axes\": ["
+        << "{\"name\": \"t\", \"type\": \"time\"}, {\"name\": \"c\", \"type\": \"channel\"}, "
+        << "{\"name\": \"z\", \"type\": \"space\"}, {\"name\": \"y\", \"type\": \"space\"}, "
+        << "{\"name\": \"x\", \"type\": \"space\"}], \"datasets\": [";
+  for (size_t i = 0; i < m_levels.size(); i++) {
+    attrs << (i > 0 ? ", " : "") << "{\"path\": \"" << i << "\", \"coordinateTransformations\": [{\"type\": "
+          << "\"scale\", \"scale\": [1.0, 1.0, 1.0, " << (1 << i) << ".0, " << (1 << i) << ".0]}]}";
+  }
+  attrs << "]}]}\n";
+  writeText(path_ + L"/.zattrs", attrs.str());
+
+  for (size_t i = 0; i < m_levels.size(); i++) {
+    std::vector<size_t> levelShape = shape(static_cast<int>(i));
+    std::ostringstream array;
+    array << "{\"zarr_format\": 2, \"shape\": [" << levelShape[0] << ", " << levelShape[1] << ", " << levelShape[2]
+          << ", " << levelShape[3] << ", " << levelShape[4] << "], \"chunks\": [1, 1, " << m_options.chunkZ << ", "
+          << m_options.chunkY << ", " << m_options.chunkX << "], \"dtype\": \"" << zarrType(m_pixelType)
+          << "\", \"compressor\": ";
+    if (m_options.compression == Compression::Zstd)
+      array << "{\"id\": \"zstd\", \"level\": " << m_options.compressionLevel << "}";
+    else
+      array << "null";
+    array << ", \"fill_value\": 0, \"order\": \"C\", \"filters\": null, \"dimension_separator\": \".\"}\n";
+    writeText(m_levels[i].path + L"/.zarray", array.str());
+  }
+}
+
+ZarrExport::Statistics
+ZarrExport::write(const std::wstring& path_)
+{
+  if (!makeDirectory(path_))
+    throw ExportException("Can't create the directory of the store.");
+  for (size_t i = 0; i < m_levels.size(); i++) {
+    m_levels[i].path = path_ + L"/" + std::to_wstring(i);
+    if (!makeDirectory(m_levels[i].path))
+      throw ExportException("Can't create the directory of a level of the store.");
+  }
+  writeMetadata(path_);
+
+  // the tiles a band of a mosaic shares with the next band are decoded once into the export's own cache, the cache of
+  // the Reader may be shared with other Readers (see ReaderPool) so its budget is left alone
+  if (m_mosaic) {
+    size_t budget = size_t(m_options.chunkZ) * 2 * size_t(m_options.chunkY) * size_t(m_box.w) * m_pixelBytes;
+    m_tileCache = std::make_unique<TileCache>(budget);
+  }
+  m_statistics = Statistics{ 0, 0, 0 };
+  try {
+    for (m_stackT = m_t.first; m_stackT < m_t.second; m_stackT++) {
+      for (m_stackC = m_c.first; m_stackC < m_c.second; m_stackC++) {
+        for (m_stackZ = m_z.first; m_stackZ < m_z.second; m_stackZ += m_options.chunkZ) {
+          m_stackZCount = std::min(m_options.chunkZ, m_z.second - m_stackZ);
+          exportStack();
+        }
+      }
+    }
+    wait(0);
+  } catch (...) {
+    m_writes.clear(); // the writes own their chunks and file names so they can finish on their own
+    m_tileCache.reset();
+    m_stack = std::vector<std::uint8_t>();
+    throw;
+  }
+  m_tileCache.reset();
+  m_stack = std::vector<std::uint8_t>();
+  return m_statistics;
+}
+
+void
+ZarrExport::exportStack()
+{
+  for (auto& level : m_levels) {
+    level.band = 0;
+    level.rows = 0;
+    level.buffer.resize(size_t(m_stackZCount) * m_options.chunkY * level.width * m_pixelBytes);
+  }
+  if (!m_mosaic)
+    readStack();
+  std::vector<std::uint8_t> band;
+  for (size_t y = 0; y < m_levels.front().height; y += m_options.chunkY) {
+    size_t rows = std::min<size_t>(m_options.chunkY, m_levels.front().height - y);
+    readBand(y, rows, band);
+    addRows(0, band.data(), rows);
+  }
+  // the partial bands at the bottom, each flush adds rows to the next level
+  for (size_t i = 0; i < m_levels.size(); i++) {
+    if (m_levels[i].rows > 0)
+      flush(i);
+  }
+}
+
+libCZI::CDimCoordinate
+ZarrExport::stackPlane(int z_) const
+{
+  libCZI::CDimCoordinate plane = m_plane;
+  if (m_hasT)
+    plane.Set(libCZI::DimensionIndex::T, m_stackT);
+  if (m_hasC)
+    plane.Set(libCZI::DimensionIndex::C, m_stackC);
+  if (m_hasZ)
+    plane.Set(libCZI::DimensionIndex::Z, m_stackZ + z_);
+  return plane;
+}
+
+void
+ZarrExport::readStack()
+{
+  // a plane of a file that isn't a mosaic is one subblock, it's decoded once for all the bands of the stack
+  size_t planeBytes = size_t(m_box.h) * m_box.w * m_pixelBytes;
+  m_stack.resize(m_stackZCount * planeBytes);
+  for (int z = 0; z < m_stackZCount; z++) {
+    libCZI::CDimCoordinate plane = stackPlane(z);
+    m_reader.readSelected(plane, -1, m_options.cores, { 0, 0, -1, -1 }, m_stack.data() + z * planeBytes, planeBytes);
+  }
+}
+
+void
+ZarrExport::readBand(size_t y_, size_t rows_, std::vector<std::uint8_t>& out_)
+{
+  size_t rowBytes = m_box.w * m_pixelBytes;
+  size_t planeBytes = rows_ * rowBytes;
+  out_.resize(m_stackZCount * planeBytes);
+  for (int z = 0; z < m_stackZCount; z++) {
+    void* out = out_.data() + z * planeBytes;
+    if (!m_mosaic) {
+      std::memcpy(out, m_stack.data() + (z * size_t(m_box.h) + y_) * rowBytes, planeBytes);
+      continue;
+    }
+    int y = static_cast<int>(y_), h = static_cast<int>(rows_);
+    m_reader.readMosaic(stackPlane(z),
+                        1.0,
+                        { m_box.x, m_box.y + y, m_box.w, h },
+                        { 0.0, 0.0, 0.0 },
+                        m_options.cores,
+                        out,
+                        planeBytes,
+                        m_tileCache.get());
+  }
+}
+
+void
+ZarrExport::addRows(size_t level_, const std::uint8_t* rows_, size_t count_)
+{
+  Level& level = m_levels[level_];
+  size_t rowBytes = level.width * m_pixelBytes;
+  size_t added = 0;
+  while (added < count_) {
+    size_t rows = std::min(count_ - added, size_t(m_options.chunkY) - level.rows);
+    for (int z = 0; z < m_stackZCount; z++) {
+      std::memcpy(level.buffer.data() + (z * size_t(m_options.chunkY) + level.rows) * rowBytes,
+                  rows_ + (z * count_ + added) * rowBytes,
+                  rows * rowBytes);
+    }
+    level.rows += rows;
+    added += rows;
+    if (level.rows == size_t(m_options.chunkY) || level.band * m_options.chunkY + level.rows == level.height)
+      flush(level_);
+  }
+}
+
+void
+ZarrExport::flush(size_t level_)
+{
+  Level& level = m_levels[level_];
+  writeChunks(level);
+  if (level_ + 1 < m_levels.size()) {
+    size_t rows = (level.rows + 1) / 2, width = m_levels[level_ + 1].width;
+    std::vector<std::uint8_t> smaller(m_stackZCount * rows * width * m_pixelBytes);
+    for (int z = 0; z < m_stackZCount; z++) {
+      downsample(m_pixelType,
+                 level.buffer.data() + z * size_t(m_options.chunkY) * level.width * m_pixelBytes,
+                 level.rows,
+                 level.width,
+                 smaller.data() + z * rows * width * m_pixelBytes);
+    }
+    addRows(level_ + 1, smaller.data(), rows);
+  }
+  level.band++;
+  level.rows = 0;
+}
+
+void
+ZarrExport::writeChunks(const Level& level_)
+{
+  const size_t chunkX = m_options.chunkX, chunkY = m_options.chunkY;
+  const size_t chunkBytes = size_t(m_options.chunkZ) * chunkY * chunkX * m_pixelBytes;
+  const size_t cores = m_options.cores == 0 ? ThreadPool::instance().size() + 1 : ThreadPool::coresFor(m_options.cores);
+  const size_t inFlight = 2 * cores; // enough to keep the cores busy while the next band is read
+  std::wstring key = level_.path + L"/" + std::to_wstring(m_stackT - m_t.first) + L"." +
+                     std::to_wstring(m_stackC - m_c.first) + L"." +
+                     std::to_wstring((m_stackZ - m_z.first) / m_options.chunkZ) + L"." + std::to_wstring(level_.band) +
+                     L".";
+  for (size_t x0 = 0; x0 < level_.width; x0 += chunkX) {
+    // the chunks at the edges are padded with the fill value, Zarr chunks all have the same shape
+    std::vector<std::uint8_t> chunk(chunkBytes, 0);
+    size_t copyBytes = std::min(chunkX, level_.width - x0) * m_pixelBytes;
+    for (int z = 0; z < m_stackZCount; z++) {
+      for (size_t y = 0; y < level_.rows; y++) {
+        std::memcpy(chunk.data() + ((z * chunkY + y) * chunkX) * m_pixelBytes,
+                    level_.buffer.data() + ((z * chunkY + y) * level_.width + x0) * m_pixelBytes,
+                    copyBytes);
+      }
+    }
+    wait(inFlight - 1);
+    std::wstring name = key + std::to_wstring(x0 / chunkX);
+    Compression compression = m_options.compression;
+    int compressionLevel = m_options.compressionLevel;
+    auto shared = std::make_shared<std::vector<std::uint8_t>>(std::move(chunk));
+    m_writes.push_back(ThreadPool::instance().submit(
+      [name, shared, compression, compressionLevel]() {
+        return writeChunk(name, *shared, compression, compressionLevel);
+      }));
+    m_statistics.chunks++;
+    m_statistics.pixelBytes += chunkBytes;
+  }
+}
+
+void
+ZarrExport::wait(size_t in_flight_)
+{
+  while (m_writes.size() > in_flight_) {
+    std::future<std::uint64_t> oldest = std::move(m_writes.front());
+    m_writes.pop_front();
+    m_statistics.bytes += oldest.get();
+  }
+}
+
+void
+ZarrExport::downsample(libCZI::PixelType pixel_type_, const void* in_, size_t rows_, size_t width_, void* out_)
+{
+  switch (pixel_type_) {
+    case libCZI::PixelType::Gray8:
+      downsampleTyped(static_cast<const std::uint8_t*>(in_), rows_, width_, static_cast<std::uint8_t*>(out_));
+      break;
+    case libCZI::PixelType::Gray16:
+      downsampleTyped(static_cast<const std::uint16_t*>(in_), rows_, width_, static_cast<std::uint16_t*>(out_));
+      break;
+    case libCZI::PixelType::Gray32Float:
+      downsampleTyped(static_cast<const float*>(in_), rows_, width_, static_cast<float*>(out_));
+      break;
+    default:
+      throw PixelTypeException(pixel_type_, "Only Gray8, Gray16 and Gray32Float images can be downsampled.");
+  }
+}
+
+}
@@ -0,0 +1,165 @@
+#ifndef _AICSPYLIBCZI_ZARREXPORT_H
+#define _AICSPYLIBCZI_ZARREXPORT_H
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Reader.h"
+#include "TileCache.h"
+#include "inc_libCZI.h"
+
+namespace pylibczi {
+
+/*!
+ * @brief Write a plane selection of a CZI file to an OME-Zarr (NGFF 0.4) directory store with a TCZYX Zarr v2 array
+ * per pyramid level.
+ *
+ * A mosaic is composited a band of chunk rows at a time with readMosaic, so the memory used is a few bands rather
+ * than the image. The tiles crossing a band boundary are kept in a cache of the export's own so they are only decoded
+ * once, the Reader's cache, which a ReaderPool shares with other Readers, isn't changed. A plane of any other file is
+ * one subblock, so each chunk of Z planes is read once with readSelected and cut into bands. Each band is cut into
+ * chunks, the chunks are compressed and written on the ThreadPool while the next band is read, and the band is
+ * downsampled 2x2 into the band of the next level so the whole pyramid is written in one pass over the file.
+ *
+ * @code
+ *    pylibczi::Reader czi(L"slide.czi");
+ *    pylibczi::ZarrExport::Options options;
+ *    options.levels = 4;
+ *    libCZI::CDimCoordinate scene{ { libCZI::DimensionIndex::S, 0 } };
+ *    pylibczi::ZarrExport(czi, scene, options).write(L"slide.zarr");
+ * @endcode
+ */
+class ZarrExport
+{
+public:
+  enum class Compression
+  {
+    None,
+    Zstd
+  };
+
+  struct Options
+  {
+    int chunkZ = 1;
+    int chunkY = 1024; ///< must be even when there is more than one level
+    int chunkX = 1024;
+    int levels = 1; ///< the full resolution and levels - 1 downsampled levels, each half the size of the one before
+    Compression compression = Compression::Zstd;
+    int compressionLevel = 3;
+    unsigned int cores = 0; ///< the cores for reading and for compressing, 0 is every core
+  };
+
+  struct Statistics
+  {
+    size_t chunks;            ///< chunk files written over all levels
+    std::uint64_t bytes;      ///< the bytes of the chunk files
+    std::uint64_t pixelBytes; ///< the uncompressed bytes of the chunks
+  };
+
+  /*!
+   * @brief true if the module was built with zstd so Compression::Zstd can be used
+   */
+  static bool hasZstd();
+
+  /*!
+   * @param reader_ the file, it must outlive the export
+   * @param plane_coord_ the dimensions other than T, C and Z must select a single value. S selects the scene, a
+   * mosaic without S is exported whole. T, C or Z set in plane_coord_ export only that index.
+   * @param options_ the chunk shape, the pyramid levels and the compression
+   */
+  ZarrExport(Reader& reader_, libCZI::CDimCoordinate plane_coord_, Options options_);
+
+  /*!
+   * @brief the TCZYX shape of a level
+   */
+  std::vector<size_t> shape(int level_ = 0) const;
+
+  /*!
+   * @brief write the store, path_ is created if it doesn't exist and its parent must exist. Existing chunk and
+   * metadata files are overwritten.
+   */
+  Statistics write(const std::wstring& path_);
+
+  /*!
+   * @brief the 2x2 mean of rows_ x width_ pixels, the last row and column are repeated when rows_ or width_ is odd
+   * @param in_ the pixels of the rows, contiguous
+   * @param out_ ceil(rows_ / 2) x ceil(width_ / 2) pixels
+   */
+  static void downsample(libCZI::PixelType pixel_type_, const void* in_, size_t rows_, size_t width_, void* out_);
+
+private:
+  /*!
+   * @brief the band of chunk rows of one level being filled, [z][row][x] for the Z of the current chunk
+   */
+  struct Level
+  {
+    size_t height;
+    size_t width;
+    size_t band; ///< the chunk row the buffer holds
+    size_t rows; ///< the rows of the band filled
+    std::wstring path;
+    std::vector<std::uint8_t> buffer;
+  };
+
+  Reader& m_reader;
+  libCZI::CDimCoordinate m_plane;
+  Options m_options;
+  bool m_mosaic;
+  libCZI::IntRect m_box; ///< the region of the mosaic, or the plane of a non mosaic file
+  libCZI::PixelType m_pixelType;
+  size_t m_pixelBytes;
+  std::pair<int, int> m_t, m_c, m_z; ///< [start, end) exported
+  bool m_hasT, m_hasC, m_hasZ;       ///< the file has the dimension so it's set in the planes read
+
+  std::vector<Level> m_levels;
+  int m_stackT, m_stackC, m_stackZ, m_stackZCount; ///< the T, C and Z chunk being exported
+  std::deque<std::future<std::uint64_t>> m_writes;  ///< the chunks being compressed and written
+  Statistics m_statistics;
+  std::unique_ptr<TileCache> m_tileCache;           ///< the tiles of a mosaic shared by two bands, while writing
+  std::vector<std::uint8_t> m_stack;                ///< the Z planes of the chunk of a non mosaic file, [z][y][x]
+
+  void writeMetadata(const std::wstring& path_) const;
+
+  void exportStack();
+
+  /*!
+   * @brief the plane of the z_-th Z of the chunk being exported
+   */
+  libCZI::CDimCoordinate stackPlane(int z_) const;
+
+  /*!
+   * @brief read the Z planes of the chunk of a non mosaic file into m_stack
+   */
+  void readStack();
+
+  /*!
+   * @brief rows_ rows from y_ of each Z of the chunk, [z][row][x], composited for a mosaic and cut out of m_stack
+   * otherwise
+   */
+  void readBand(size_t y_, size_t rows_, std::vector<std::uint8_t>& out_);
+
+  /*!
+   * @brief append count_ rows of each Z, [z][row][x], to the band of the level flushing it when it's full
+   */
+  void addRows(size_t level_, const std::uint8_t* rows_, size_t count_);
+
+  /*!
+   * @brief write the chunks of the band and pass its downsampled rows to the next level
+   */
+  void flush(size_t level_);
+
+  void writeChunks(const Level& level_);
+
+  /*!
+   * @brief wait for the oldest writes until at most in_flight_ are left
+   */
+  void wait(size_t in_flight_);
+};
+
+}
+
+#endif //_AICSPYLIBCZI_ZARREXPORT_H
@@ -159,6 +159,53 @@ public:
   {}
 };
 
+class OutputBufferException : public std::runtime_error
+{
+public:
+  explicit OutputBufferException(const std::string& message_)
+    : std::runtime_error("Output buffer can't hold the image: " + message_)
+  {}
+};
+
+class ExportException : public std::runtime_error
+{
+public:
+  explicit ExportException(const std::string& message_)
+    : std::runtime_error("Export failed: " + message_)
+  {}
+};
+
+class AttachmentException : public std::runtime_error
+{
+public:
+  AttachmentException(const std::string& name_, const std::string& message_)
+    : std::runtime_error("Attachment " + name_ + " can't be read: " + message_)
+  {}
+};
+
+class ReadCancelledException : public std::runtime_error
+{
+public:
+  enum class Reason
+  {
+    Cancelled,  ///< the CancelToken of the read was cancelled
+    Deadline,   ///< the deadline of the read passed
+    Interrupted ///< the thread which started the read was interrupted, eg by Ctrl-C
+  };
+
+  explicit ReadCancelledException(Reason reason_)
+    : std::runtime_error(reason_ == Reason::Cancelled  ? "The read was cancelled."
+                         : reason_ == Reason::Deadline ? "The read passed its deadline."
+                                                       : "The read was interrupted.")
+    , m_reason(reason_)
+  {}
+
+  Reason reason() const { return m_reason; }
+
+private:
+  Reason m_reason;
+};
+
 class SceneIndexException : public std::runtime_error
 {
 public:
@@ -1,10 +1,16 @@
+#include <chrono>
+#include <future>
+
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include "IndexMap.h"
 #include "Reader.h"
+#include "ReaderPool.h"
+#include "ZarrExport.h"
 #include "exceptions.h"
 #include "inc_libCZI.h"
+#include "pb_helpers.h"
 
 // the below headers are crucial otherwise the custom casts aren't recognized
 #include "pb_caster_BytesIO.h"
@@ -35,29 +41,227 @@ PYBIND11_MODULE(_aicspylibczi, m)
     m, "PylibCZI_CDimCoordinatesOverspecifiedException");
   py::register_exception<pylibczi::CDimCoordinatesUnderspecifiedException>(
     m, "PylibCZI_CDimCoordinatesUnderspecifiedException");
+  py::register_exception<pylibczi::OutputBufferException>(m, "PylibCZI_OutputBufferException", PyExc_ValueError);
+  py::register_exception<pylibczi::ExportException>(m, "PylibCZI_ExportException");
+  py::register_exception<pylibczi::AttachmentException>(m, "PylibCZI_AttachmentException");
+  static py::exception<pylibczi::ReadCancelledException> s_readCancelled(m, "PylibCZI_ReadCancelledException");
+  py::register_exception_translator([](std::exception_ptr error_) {
+    try {
+      if (error_)
+        std::rethrow_exception(error_);
+    } catch (const pylibczi::ReadCancelledException& e) {
+      // an interrupted read leaves the KeyboardInterrupt PyErr_CheckSignals raised, python sees that instead
+      if (e.reason() != pylibczi::ReadCancelledException::Reason::Interrupted || !PyErr_Occurred())
+        s_readCancelled(e.what());
+    }
+  });
+
+  // The Reader methods below do their work in C++ (file IO, decompression, copying) so the interpreter lock is
+  // released while they run. The arguments are converted before and the return values (numpy arrays, lists) are
+  // built after the call, both with the lock held again, so nothing inside the guarded region touches Python.
+  auto release_gil = py::call_guard<py::gil_scoped_release>();
+  // read_selected and read_mosaic release it themselves, they have to check the out buffer with the lock held
 
-  py::class_<pylibczi::Reader>(m, "Reader")
-    .def(py::init<std::shared_ptr<libCZI::IStream>>())
+  // a shared_ptr holder so the Readers of a ReaderPool can be handed to python
+  py::class_<pylibczi::Reader, std::shared_ptr<pylibczi::Reader>>(m, "Reader")
+    .def(py::init<const wchar_t*, bool, const wchar_t*>(),
+         py::arg("file_name"),
+         py::arg("memory_map") = false,
+         py::arg("index_file") = nullptr,
+         release_gil)
+    .def(py::init<std::shared_ptr<libCZI::IStream>>(), release_gil)
     .def("is_mosaic", &pylibczi::Reader::isMosaic)
     .def("has_consistent_shape", &pylibczi::Reader::shapeIsConsistent)
-    .def("read_dims", &pylibczi::Reader::readDimsRange)
-    .def("read_dims_string", &pylibczi::Reader::dimsString)
-    .def("read_dims_sizes", &pylibczi::Reader::dimSizes)
-    .def("read_meta", &pylibczi::Reader::readMeta)
-    .def("read_selected", &pylibczi::Reader::readSelected)
-    .def("read_meta_from_subblock", &pylibczi::Reader::readSubblockMeta)
-    .def("read_mosaic", &pylibczi::Reader::readMosaic)
-    .def("read_tile_bounding_box", &pylibczi::Reader::tileBoundingBox)
-    .def("read_scene_bounding_box", &pylibczi::Reader::sceneBoundingBox)
-    .def("read_all_tile_bounding_boxes", &pylibczi::Reader::tileBoundingBoxes)
-    .def("read_all_scene_bounding_boxes", &pylibczi::Reader::allSceneBoundingBoxes)
-    .def("read_mosaic_bounding_box", &pylibczi::Reader::mosaicBoundingBox)
-    .def("read_mosaic_tile_bounding_box", &pylibczi::Reader::mosaicTileBoundingBox)
-    .def("read_mosaic_scene_bounding_box", &pylibczi::Reader::mosaicSceneBoundingBox)
-    .def("read_all_mosaic_tile_bounding_boxes", &pylibczi::Reader::mosaicTileBoundingBoxes)
-    .def("read_all_mosaic_scene_bounding_boxes", &pylibczi::Reader::allMosaicSceneBoundingBoxes)
+    .def("read_dims", &pylibczi::Reader::readDimsRange, release_gil)
+    .def("read_dims_string", &pylibczi::Reader::dimsString, release_gil)
+    .def("read_dims_sizes", &pylibczi::Reader::dimSizes, release_gil)
+    .def("read_meta", &pylibczi::Reader::readMeta, release_gil)
+    .def("read_meta_xml", &pb_helpers::readMetaXml)
+    .def("read_meta_summary", &pb_helpers::readMetaSummary)
+    .def("read_selected",
+         &pb_helpers::readSelected,
+         py::arg("plane_coord"),
+         py::arg("index_m"),
+         py::arg("cores"),
+         py::arg("roi"),
+         py::arg("out") = py::none(),
+         py::arg("rgb") = false,
+         py::arg("dtype") = "",
+         py::arg("window") = std::make_pair(0.0, 0.0),
+         py::arg("statistics") = "",
+         py::arg("bins") = 256,
+         py::arg("histogram_range") = std::make_pair(0.0, 0.0))
+    .def("read_statistics",
+         &pb_helpers::readStatistics,
+         py::arg("plane_coord"),
+         py::arg("index_m"),
+         py::arg("cores"),
+         py::arg("roi"),
+         py::arg("statistics"),
+         py::arg("bins") = 256,
+         py::arg("histogram_range") = std::make_pair(0.0, 0.0))
+    .def("read_selected_batch",
+         &pb_helpers::readSelectedBatch,
+         py::arg("planes"),
+         py::arg("index_m"),
+         py::arg("cores"),
+         py::arg("roi"),
+         py::arg("rgb") = false,
+         py::arg("dtype") = "",
+         py::arg("window") = std::make_pair(0.0, 0.0))
+    .def("read_scenes",
+         &pb_helpers::readScenes,
+         py::arg("plane_coord"),
+         py::arg("scenes"),
+         py::arg("index_m"),
+         py::arg("cores"),
+         py::arg("roi"),
+         py::arg("rgb") = false,
+         py::arg("dtype") = "",
+         py::arg("window") = std::make_pair(0.0, 0.0))
+    .def("read_mosaic_tiles",
+         &pb_helpers::readMosaicTiles,
+         py::arg("plane_coord"),
+         py::arg("m_indices"),
+         py::arg("cores"),
+         py::arg("rgb") = false,
+         py::arg("dtype") = "",
+         py::arg("window") = std::make_pair(0.0, 0.0))
+    .def("read_projected",
+         &pb_helpers::readProjected,
+         py::arg("plane_coord"),
+         py::arg("dim"),
+         py::arg("mode"),
+         py::arg("index_m"),
+         py::arg("cores"),
+         py::arg("roi"),
+         py::arg("out") = py::none())
+    .def("read_binned",
+         &pb_helpers::readBinned,
+         py::arg("plane_coord"),
+         py::arg("bins"),
+         py::arg("mode"),
+         py::arg("index_m"),
+         py::arg("cores"),
+         py::arg("roi"),
+         py::arg("out") = py::none())
+    .def("read_planes",
+         &pylibczi::Reader::planeIterator,
+         py::arg("plane_coord"),
+         py::arg("group_dims"),
+         py::arg("index_m"),
+         py::arg("in_flight"),
+         py::arg("cores"),
+         py::arg("roi"),
+         py::keep_alive<0, 1>(), // the iterator reads from the Reader
+         release_gil)
+    .def("read_meta_from_subblock", &pylibczi::Reader::readSubblockMeta, release_gil)
+    .def("read_subblock_fields", &pb_helpers::subblockFields)
+    .def("read_raw_subblocks", &pb_helpers::rawSubblocks)
+    .def("read_attachments", &pb_helpers::attachmentList)
+    .def("read_attachment", &pb_helpers::readAttachment, py::arg("index"))
+    .def("read_time_stamps", &pb_helpers::readTimeStamps)
+    .def("export_zarr", &pb_helpers::exportZarr)
+    .def_static("has_zstd", &pylibczi::ZarrExport::hasZstd)
+    .def("read_mosaic",
+         &pb_helpers::readMosaic,
+         py::arg("plane_coord"),
+         py::arg("scale_factor"),
+         py::arg("im_box"),
+         py::arg("background_color"),
+         py::arg("cores"),
+         py::arg("out") = py::none())
+    .def("read_mosaic_planes",
+         &pb_helpers::readMosaicPlanes,
+         py::arg("planes"),
+         py::arg("scale_factor"),
+         py::arg("im_box"),
+         py::arg("background_color"),
+         py::arg("cores"),
+         py::arg("out") = py::none())
+    .def("read_mosaic_progressive",
+         &pb_helpers::readMosaicProgressive,
+         py::arg("plane_coord"),
+         py::arg("scale_factor"),
+         py::arg("im_box"),
+         py::arg("background_color"),
+         py::arg("cores"),
+         py::arg("callback") = py::none(),
+         py::arg("out") = py::none())
+    .def("read_tile_bounding_box", &pylibczi::Reader::tileBoundingBox, release_gil)
+    .def("read_scene_bounding_box", &pylibczi::Reader::sceneBoundingBox, release_gil)
+    .def("read_all_tile_bounding_boxes", &pylibczi::Reader::tileBoundingBoxes, release_gil)
+    .def("read_all_scene_bounding_boxes", &pylibczi::Reader::allSceneBoundingBoxes, release_gil)
+    .def("read_mosaic_bounding_box", &pylibczi::Reader::mosaicBoundingBox, release_gil)
+    .def("read_mosaic_tile_bounding_box", &pylibczi::Reader::mosaicTileBoundingBox, release_gil)
+    .def("read_mosaic_scene_bounding_box", &pylibczi::Reader::mosaicSceneBoundingBox, release_gil)
+    .def("read_all_mosaic_tile_bounding_boxes", &pylibczi::Reader::mosaicTileBoundingBoxes, release_gil)
+    .def("read_all_mosaic_scene_bounding_boxes", &pylibczi::Reader::allMosaicSceneBoundingBoxes, release_gil)
+    .def("set_tile_cache_budget", &pylibczi::Reader::setTileCacheBudget)
+    .def("tile_cache_statistics", &pylibczi::Reader::tileCacheStatistics)
+    .def("stats", &pb_helpers::perfCounters)
+    .def("reset_stats", &pylibczi::Reader::resetStats)
+    .def("enable_stats", &pylibczi::Reader::enableStats, py::arg("enabled"))
+    .def("set_allocation_policy",
+         &pb_helpers::setAllocationPolicy,
+         py::arg("huge_pages"),
+         py::arg("numa"),
+         py::arg("pinned"),
+         py::arg("file_directory") = "")
+    .def("prefetch_selected",
+         &pylibczi::Reader::prefetchSelected,
+         py::arg("plane_coord"),
+         py::arg("index_m"),
+         py::arg("decode"),
+         py::arg("cores"),
+         release_gil)
+    .def("prefetch_mosaic",
+         &pylibczi::Reader::prefetchMosaic,
+         py::arg("plane_coord"),
+         py::arg("scale_factor"),
+         py::arg("im_box"),
+         py::arg("decode"),
+         py::arg("cores"),
+         release_gil)
+    .def("read_pyramid_layers", &pylibczi::Reader::pyramidLayers)
+    .def("read_tile_catalog", &pb_helpers::tileCatalog)
     .def_property_readonly("pixel_type", &pylibczi::Reader::pixelType);
 
+  py::class_<pylibczi::ReaderPool>(m, "ReaderPool")
+    .def(py::init<size_t, size_t, size_t, bool>(),
+         py::arg("max_open_files") = 64,
+         py::arg("tile_cache_bytes") = 0,
+         py::arg("io_slots") = 4,
+         py::arg("memory_map") = false)
+    .def("reader", &pylibczi::ReaderPool::reader, py::arg("file_name"), release_gil)
+    .def("clear", &pylibczi::ReaderPool::clear, release_gil)
+    .def("statistics", &pylibczi::ReaderPool::statistics)
+    .def("tile_cache_statistics", [](const pylibczi::ReaderPool& pool_) { return pool_.tileCache()->statistics(); })
+    .def_property_readonly("max_open_files", &pylibczi::ReaderPool::maxOpenFiles);
+
+  py::class_<pylibczi::ReaderPool::Statistics>(m, "ReaderPoolStatistics")
+    .def_readonly("opens", &pylibczi::ReaderPool::Statistics::opens)
+    .def_readonly("hits", &pylibczi::ReaderPool::Statistics::hits)
+    .def_readonly("evictions", &pylibczi::ReaderPool::Statistics::evictions)
+    .def_readonly("open", &pylibczi::ReaderPool::Statistics::open);
+
+  py::class_<std::shared_future<void>>(m, "Prefetch")
+    .def("wait", [](const std::shared_future<void>& f_) { f_.get(); }, release_gil)
+    .def("done", [](const std::shared_future<void>& f_) {
+      return f_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+
+  py::class_<pylibczi::CancelToken, std::shared_ptr<pylibczi::CancelToken>>(m, "CancelToken")
+    .def(py::init<>())
+    .def("cancel", &pylibczi::CancelToken::cancel)
+    .def("reset", &pylibczi::CancelToken::reset)
+    .def_property_readonly("cancelled", &pylibczi::CancelToken::cancelled);
+
+  py::class_<pb_helpers::CancellationContext>(m, "Cancellation")
+    .def(py::init<std::shared_ptr<pylibczi::CancelToken>, double>(), py::arg("token"), py::arg("timeout"))
+    .def("__enter__", &pb_helpers::CancellationContext::enter)
+    .def("__exit__", [](pb_helpers::CancellationContext& context_, py::args) { context_.exit(); });
+
   py::class_<pylibczi::IndexMap>(m, "IndexMap")
     .def(py::init<>())
     .def("is_m_index_valid", &pylibczi::IndexMap::isMIndexValid)
@@ -87,4 +291,24 @@ PYBIND11_MODULE(_aicspylibczi, m)
     //   .def(py::init<pylibczi::SubblockSortable>())
     .def_property_readonly("dimension_coordinates", &pylibczi::SubblockSortable::getDimsAsChars)
     .def_property_readonly("m_index", &pylibczi::SubblockSortable::mIndex);
+
+  py::class_<pylibczi::TileCache::Statistics>(m, "TileCacheStatistics")
+    .def_readonly("hits", &pylibczi::TileCache::Statistics::hits)
+    .def_readonly("misses", &pylibczi::TileCache::Statistics::misses)
+    .def_readonly("tiles", &pylibczi::TileCache::Statistics::tiles)
+    .def_readonly("bytes", &pylibczi::TileCache::Statistics::bytes)
+    .def_readonly("byte_budget", &pylibczi::TileCache::Statistics::byteBudget);
+
+  py::class_<pylibczi::SubblockDirectory::PyramidLayer>(m, "PyramidLayer")
+    .def_readonly("layer", &pylibczi::SubblockDirectory::PyramidLayer::layer)
+    .def_readonly("minification", &pylibczi::SubblockDirectory::PyramidLayer::minification)
+    .def_readonly("subblocks", &pylibczi::SubblockDirectory::PyramidLayer::subblocks);
+
+  py::class_<pylibczi::PlaneIterator>(m, "PlaneIterator")
+    .def(
+      "__iter__",
+      [](pylibczi::PlaneIterator& planes_) -> pylibczi::PlaneIterator& { return planes_; },
+      py::return_value_policy::reference_internal)
+    .def("__next__", &pb_helpers::nextPlanes)
+    .def("__len__", &pylibczi::PlaneIterator::numberOfGroups);
 }
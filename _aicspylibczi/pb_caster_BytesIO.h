@@ -1,7 +1,10 @@
 #ifndef _PYLIBCZI_PB_CASTER_BYTESIO_H
 #define _PYLIBCZI_PB_CASTER_BYTESIO_H
 
-#include "CSimpleStreamImplFromFd.h"
+#include "StreamImplBlockCache.h"
+#include "StreamImplPositionalRead.h"
+#include "StreamImplPython.h"
+#include "StreamImplPythonBuffer.h"
 #include <cstdio>
 #include <iostream>
 #include <pybind11/pybind11.h>
@@ -31,10 +34,28 @@ public:
 
     /* Try converting into a Python integer value */
     int fDesc = PyObject_AsFileDescriptor(source);
-    if (fDesc == -1)
+    if (fDesc != -1) {
+      value = std::shared_ptr<libCZI::IStream>(new pylibczi::StreamImplPositionalRead(fDesc));
+      return (value != nullptr && !PyErr_Occurred());
+    }
+    PyErr_Clear();
+
+    /* A CZI already in memory (bytes, memoryview, mmap, SharedMemory.buf, ...), read the buffer in place */
+    if (pb_helpers::StreamImplPythonBuffer::isBuffer(src_)) {
+      try {
+        value = std::make_shared<pb_helpers::StreamImplPythonBuffer>(src_);
+        return true;
+      } catch (error_already_set&) {
+        return false; // not contiguous
+      }
+    }
+
+    /* No file descriptor (io.BytesIO, fsspec files, ...), read the object through its methods */
+    if (!pb_helpers::StreamImplPython::isReadable(src_))
       return false;
-    value = std::shared_ptr<libCZI::IStream>(new pb_helpers::CSimpleStreamImplFromFd(fDesc));
-    return (value != nullptr && !PyErr_Occurred());
+    value = std::make_shared<pylibczi::StreamImplBlockCache>(
+      std::make_shared<pb_helpers::StreamImplPython>(reinterpret_borrow<object>(src_)));
+    return true;
   }
 
   /**
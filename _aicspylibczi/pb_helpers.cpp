@@ -1,22 +1,60 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include "Reader.h"
+#include "ZarrExport.h"
+#include "constants.h"
 #include "exceptions.h"
 #include "pb_helpers.h"
 
 namespace pb_helpers {
 
+InterruptibleRelease::InterruptibleRelease()
+  : m_interrupt(nullptr, pylibczi::ReadCancellation::Clock::time_point::max(), [] {
+    py::gil_scoped_acquire acquire;
+    return PyErr_CheckSignals() != 0; // the KeyboardInterrupt is set, see the ReadCancelledException translator
+  })
+{}
+
+CancellationContext::CancellationContext(std::shared_ptr<pylibczi::CancelToken> token_, double timeout_)
+  : m_token(std::move(token_))
+  , m_timeout(timeout_)
+{}
+
+void
+CancellationContext::enter()
+{
+  if (m_scope != nullptr)
+    throw std::logic_error("The cancellation is already entered.");
+  auto deadline = pylibczi::ReadCancellation::Clock::time_point::max();
+  if (m_timeout >= 0.0) {
+    deadline = pylibczi::ReadCancellation::Clock::now() +
+               std::chrono::duration_cast<pylibczi::ReadCancellation::Clock::duration>(
+                 std::chrono::duration<double>(m_timeout));
+  }
+  m_scope = std::make_unique<pylibczi::ReadCancellation::Scope>(m_token, deadline);
+}
+
+void
+CancellationContext::exit()
+{
+  m_scope.reset();
+}
+
 std::vector<std::pair<char, size_t>>
 getAndFixShape(pylibczi::ImagesContainerBase* bptr_)
 {
-  auto images = bptr_->images();
-  images.sort();
-  auto charSizes = images.getShape();
-  return charSizes;
+  return bptr_->shape(); // readSelected sets the shape, or it's counted from the images without copying them
 }
 
 py::array
@@ -26,29 +64,9 @@ packArray(pylibczi::ImagesContainerBase::ImagesContainerBasePtr& base_ptr_)
   std::vector<std::pair<char, size_t>> charSizes;
 
   charSizes = getAndFixShape(icBase);
-  py::array* arr;
-
-  switch (icBase->pixelType()) {
-    case libCZI::PixelType::Gray8:
-    case libCZI::PixelType::Bgr24:
-      arr = memoryToNpArray<uint8_t>(icBase, charSizes);
-      break;
-    case libCZI::PixelType::Gray16:
-    case libCZI::PixelType::Bgr48:
-      arr = memoryToNpArray<uint16_t>(icBase, charSizes);
-      break;
-    case libCZI::PixelType::Gray32:
-      arr = memoryToNpArray<uint32_t>(icBase, charSizes);
-      break;
-    case libCZI::PixelType::Gray32Float:
-    case libCZI::PixelType::Bgr96Float:
-      arr = memoryToNpArray<float>(icBase, charSizes);
-      break;
-    default:
-      throw pylibczi::PixelTypeException(icBase->pixelType(), "Unsupported pixel type in helper function.");
-      // It is highly unlikely the this throw would ever be reached but it's here for completeness. If an unsupported
-      // pixel type were encountered it would throw much eariler in the code.
-  }
+  py::array* arr = pylibczi::dispatchPixelType(icBase->pixelType(), [&](auto traits_) {
+    return memoryToNpArray<typename decltype(traits_)::Sample>(icBase, charSizes);
+  });
   return *arr;
 }
 
@@ -68,4 +86,806 @@ packStringArray(pylibczi::SubblockMetaVec& metadata_)
   return mylist;
 }
 
+
+namespace {
+// true if the buffer items are the native unsigned integers, floats, doubles or complex floats the pixel type is
+// stored as
+bool
+formatMatches(const py::buffer_info& info_, libCZI::PixelType pixel_type_)
+{
+  std::string format = info_.format;
+  if (!format.empty() && (format[0] == '@' || format[0] == '='))
+    format.erase(0, 1);
+  if (static_cast<size_t>(info_.itemsize) != pylibczi::ImageFactory::sizeOfPixelType(pixel_type_))
+    return false;
+  switch (pixel_type_) {
+    case libCZI::PixelType::Gray32Float:
+    case libCZI::PixelType::Bgr96Float:
+      return format == "f";
+    case libCZI::PixelType::Gray64Float:
+      return format == "d";
+    case libCZI::PixelType::Gray64ComplexFloat:
+    case libCZI::PixelType::Bgr192ComplexFloat:
+      return format == "Zf";
+    default:
+      return format.size() == 1 && std::string("BHILQN").find(format[0]) != std::string::npos;
+  }
+}
+
+std::string
+shapeString(const std::vector<py::ssize_t>& shape_)
+{
+  std::stringstream ss;
+  ss << "(";
+  for (size_t i = 0; i < shape_.size(); i++)
+    ss << (i == 0 ? "" : ", ") << shape_[i];
+  ss << ")";
+  return ss.str();
+}
+
+// the numpy dtype the pixel type is stored as, the samples of the Bgr types are the last axis
+py::dtype
+dtypeOf(libCZI::PixelType pixel_type_)
+{
+  switch (pixel_type_) {
+    case libCZI::PixelType::Gray8:
+    case libCZI::PixelType::Bgr24:
+    case libCZI::PixelType::Bgra32:
+      return py::dtype::of<std::uint8_t>();
+    case libCZI::PixelType::Gray16:
+    case libCZI::PixelType::Bgr48:
+      return py::dtype::of<std::uint16_t>();
+    case libCZI::PixelType::Gray32:
+      return py::dtype::of<std::uint32_t>();
+    case libCZI::PixelType::Gray32Float:
+    case libCZI::PixelType::Bgr96Float:
+      return py::dtype::of<float>();
+    case libCZI::PixelType::Gray64Float:
+      return py::dtype::of<double>();
+    case libCZI::PixelType::Gray64ComplexFloat:
+    case libCZI::PixelType::Bgr192ComplexFloat:
+      return py::dtype::of<std::complex<float>>();
+    default:
+      throw pylibczi::PixelTypeException(pixel_type_, "The pixel type has no numpy dtype.");
+  }
+}
+}
+
+py::buffer_info
+requestOutputBuffer(py::object& out_,
+                    libCZI::PixelType pixel_type_,
+                    const std::vector<std::pair<char, size_t>>& char_sizes_)
+{
+  if (py::isinstance<py::str>(out_) || py::hasattr(out_, "__fspath__")) {
+    // a path is replaced by a numpy.memmap of the file, created or overwritten, the image is written straight into
+    // the mapping
+    py::tuple shape(char_sizes_.size());
+    for (size_t i = 0; i < char_sizes_.size(); i++)
+      shape[i] = char_sizes_[i].second;
+    out_ = py::module::import("numpy").attr("memmap")(
+      out_, py::arg("dtype") = dtypeOf(pixel_type_), py::arg("mode") = "w+", py::arg("shape") = shape);
+  }
+  if (!PyObject_CheckBuffer(out_.ptr()))
+    throw pylibczi::OutputBufferException("out must be a numpy.ndarray or another object supporting the buffer "
+                                          "protocol.");
+  py::buffer_info info = py::reinterpret_borrow<py::buffer>(out_).request(true); // raises if out is read-only
+
+  if (!formatMatches(info, pixel_type_))
+    throw pylibczi::PixelTypeException(pixel_type_, "out has the buffer format '" + info.format + "'.");
+
+  std::vector<py::ssize_t> shape(char_sizes_.size(), 0);
+  std::transform(char_sizes_.begin(), char_sizes_.end(), shape.begin(), [](const std::pair<char, size_t>& a_) {
+    return static_cast<py::ssize_t>(a_.second);
+  });
+  std::vector<py::ssize_t> outShape(info.shape.begin(), info.shape.end());
+  if (outShape != shape)
+    throw pylibczi::OutputBufferException("out has the shape " + shapeString(outShape) +
+                                          " but the image has the shape " + shapeString(shape) + ".");
+
+  py::ssize_t stride = info.itemsize;
+  for (size_t i = shape.size(); i-- > 0;) {
+    if (shape[i] > 1 && info.strides[i] != stride)
+      throw pylibczi::OutputBufferException("out must be C-contiguous.");
+    stride *= shape[i];
+  }
+  return info;
+}
+
+pylibczi::PixelConversion
+pixelConversion(bool rgb_, const std::string& dtype_, std::pair<double, double> window_)
+{
+  pylibczi::PixelConversion conversion;
+  conversion.rgb = rgb_;
+  if (dtype_.empty())
+    conversion.sample = pylibczi::PixelConversion::Sample::Source;
+  else if (dtype_ == "uint8")
+    conversion.sample = pylibczi::PixelConversion::Sample::Uint8;
+  else if (dtype_ == "float32")
+    conversion.sample = pylibczi::PixelConversion::Sample::Float32;
+  else
+    throw std::invalid_argument("Unsupported dtype " + dtype_ + ", use uint8 or float32.");
+  conversion.low = window_.first;
+  conversion.high = window_.second;
+  return conversion;
+}
+
+pylibczi::StatisticsOptions
+statisticsOptions(const std::string& group_, size_t bins_, std::pair<double, double> range_)
+{
+  pylibczi::StatisticsOptions options;
+  if (group_ == "plane")
+    options.group = pylibczi::StatisticsOptions::Group::Plane;
+  else if (group_ == "channel")
+    options.group = pylibczi::StatisticsOptions::Group::Channel;
+  else
+    throw std::invalid_argument("Unsupported statistics " + group_ + ", use plane or channel.");
+  options.bins = bins_;
+  options.low = range_.first;
+  options.high = range_.second;
+  return options;
+}
+
+py::dict
+statisticsDict(const pylibczi::PixelStatistics& statistics_)
+{
+  std::vector<size_t> groups;
+  for (const auto& size : statistics_.shape)
+    groups.push_back(size.second);
+  std::vector<size_t> histogramShape = groups;
+  histogramShape.push_back(statistics_.options.bins);
+  size_t bins = statistics_.options.bins;
+  std::vector<double> edges(bins + 1);
+  for (size_t i = 0; i <= bins; i++)
+    edges[i] = statistics_.low + (statistics_.high - statistics_.low) * static_cast<double>(i) / bins;
+
+  py::dict ans;
+  ans["dims"] = py::cast(statistics_.shape);
+  ans["min"] = py::array_t<double>(groups, statistics_.min.data());
+  ans["max"] = py::array_t<double>(groups, statistics_.max.data());
+  ans["sum"] = py::array_t<double>(groups, statistics_.sum.data());
+  ans["sum_of_squares"] = py::array_t<double>(groups, statistics_.sumOfSquares.data());
+  ans["count"] = py::array_t<std::uint64_t>(groups, statistics_.count.data());
+  ans["histogram"] = py::array_t<std::uint64_t>(histogramShape, statistics_.histogram.data());
+  ans["bin_edges"] = py::array_t<double>(edges.size(), edges.data());
+  return ans;
+}
+
+py::tuple
+readSelected(pylibczi::Reader& reader_,
+             libCZI::CDimCoordinate& plane_coord_,
+             int index_m_,
+             unsigned int cores_,
+             libCZI::IntRect roi_,
+             py::object out_,
+             bool rgb_,
+             const std::string& dtype_,
+             std::pair<double, double> window_,
+             const std::string& statistics_,
+             size_t bins_,
+             std::pair<double, double> histogram_range_)
+{
+  pylibczi::PixelConversion conversion = pixelConversion(rgb_, dtype_, window_);
+  pylibczi::PixelStatistics statistics;
+  pylibczi::PixelStatistics* collected = nullptr;
+  if (!statistics_.empty()) {
+    statistics.options = statisticsOptions(statistics_, bins_, histogram_range_);
+    collected = &statistics;
+  }
+  auto result = [&](py::object images_, const pylibczi::Reader::Shape& shape_) {
+    return collected == nullptr ? py::make_tuple(images_, shape_)
+                                : py::make_tuple(images_, shape_, statisticsDict(statistics));
+  };
+  if (out_.is_none()) {
+    std::pair<pylibczi::ImagesContainerBase::ImagesContainerBasePtr, std::vector<std::pair<char, size_t>>> selected;
+    {
+      InterruptibleRelease release;
+      selected = reader_.readSelected(plane_coord_, index_m_, cores_, roi_, nullptr, 0, conversion, collected);
+    }
+    return result(packArray(selected.first), selected.second);
+  }
+
+  auto expected = reader_.selectedShape(plane_coord_, index_m_, roi_, conversion);
+  py::buffer_info info = requestOutputBuffer(out_, expected.first, expected.second);
+  {
+    InterruptibleRelease release;
+    // the container returned only refers to the memory of out_, dropping it frees nothing
+    reader_.readSelected(
+      plane_coord_, index_m_, cores_, roi_, info.ptr, info.size * info.itemsize, conversion, collected);
+  }
+  return result(out_, expected.second);
+}
+
+py::dict
+readStatistics(pylibczi::Reader& reader_,
+               libCZI::CDimCoordinate& plane_coord_,
+               int index_m_,
+               unsigned int cores_,
+               libCZI::IntRect roi_,
+               const std::string& statistics_,
+               size_t bins_,
+               std::pair<double, double> histogram_range_)
+{
+  pylibczi::StatisticsOptions options = statisticsOptions(statistics_, bins_, histogram_range_);
+  pylibczi::PixelStatistics statistics;
+  {
+    InterruptibleRelease release;
+    statistics = reader_.readStatistics(plane_coord_, options, index_m_, cores_, roi_);
+  }
+  return statisticsDict(statistics);
+}
+
+py::list
+readSelectedBatch(pylibczi::Reader& reader_,
+                  std::vector<libCZI::CDimCoordinate> planes_,
+                  int index_m_,
+                  unsigned int cores_,
+                  libCZI::IntRect roi_,
+                  bool rgb_,
+                  const std::string& dtype_,
+                  std::pair<double, double> window_)
+{
+  pylibczi::PixelConversion conversion = pixelConversion(rgb_, dtype_, window_);
+  std::vector<std::pair<pylibczi::ImagesContainerBase::ImagesContainerBasePtr, pylibczi::Reader::Shape>> selected;
+  {
+    InterruptibleRelease release;
+    selected = reader_.readSelectedBatch(std::move(planes_), index_m_, cores_, roi_, conversion);
+  }
+  py::list ans;
+  for (auto& images : selected)
+    ans.append(py::make_tuple(packArray(images.first), images.second));
+  return ans;
+}
+
+py::list
+readScenes(pylibczi::Reader& reader_,
+           const libCZI::CDimCoordinate& plane_coord_,
+           std::vector<int> scenes_,
+           int index_m_,
+           unsigned int cores_,
+           libCZI::IntRect roi_,
+           bool rgb_,
+           const std::string& dtype_,
+           std::pair<double, double> window_)
+{
+  pylibczi::PixelConversion conversion = pixelConversion(rgb_, dtype_, window_);
+  std::vector<std::pair<pylibczi::ImagesContainerBase::ImagesContainerBasePtr, pylibczi::Reader::Shape>> selected;
+  {
+    InterruptibleRelease release;
+    selected = reader_.readScenes(plane_coord_, std::move(scenes_), index_m_, cores_, roi_, conversion);
+  }
+  py::list ans;
+  for (auto& images : selected)
+    ans.append(py::make_tuple(packArray(images.first), images.second));
+  return ans;
+}
+
+py::tuple
+readMosaicTiles(pylibczi::Reader& reader_,
+                const libCZI::CDimCoordinate& plane_coord_,
+                std::vector<int> m_indices_,
+                unsigned int cores_,
+                bool rgb_,
+                const std::string& dtype_,
+                std::pair<double, double> window_)
+{
+  pylibczi::PixelConversion conversion = pixelConversion(rgb_, dtype_, window_);
+  pylibczi::Reader::MosaicTiles tiles;
+  {
+    InterruptibleRelease release;
+    tiles = reader_.readMosaicTiles(plane_coord_, std::move(m_indices_), cores_, conversion);
+  }
+  size_t n = tiles.boxes.size();
+  py::array_t<std::int32_t> mIndex(n);
+  py::array_t<std::int32_t> boxes(std::vector<size_t>{ n, 4 });
+  auto mIndexData = mIndex.mutable_data();
+  auto boxesData = boxes.mutable_data();
+  for (size_t i = 0; i < n; i++) {
+    const libCZI::IntRect& box = tiles.boxes[i];
+    mIndexData[i] = tiles.mIndices[i];
+    boxesData[4 * i] = box.x;
+    boxesData[4 * i + 1] = box.y;
+    boxesData[4 * i + 2] = box.w;
+    boxesData[4 * i + 3] = box.h;
+  }
+  return py::make_tuple(packArray(tiles.images), tiles.shape, mIndex, boxes);
+}
+
+pylibczi::Projection::Mode
+projectionMode(const std::string& mode_)
+{
+  if (mode_ == "max")
+    return pylibczi::Projection::Mode::Max;
+  if (mode_ == "mean")
+    return pylibczi::Projection::Mode::Mean;
+  if (mode_ == "sum")
+    return pylibczi::Projection::Mode::Sum;
+  throw std::invalid_argument("Unsupported projection " + mode_ + ", use max, mean or sum.");
+}
+
+py::tuple
+readProjected(pylibczi::Reader& reader_,
+              libCZI::CDimCoordinate& plane_coord_,
+              char dim_,
+              const std::string& mode_,
+              int index_m_,
+              unsigned int cores_,
+              libCZI::IntRect roi_,
+              py::object out_)
+{
+  pylibczi::Projection::Mode mode = projectionMode(mode_);
+  if (out_.is_none()) {
+    std::pair<pylibczi::ImagesContainerBase::ImagesContainerBasePtr, pylibczi::Reader::Shape> projected;
+    {
+      InterruptibleRelease release;
+      projected = reader_.readProjected(plane_coord_, dim_, mode, index_m_, cores_, roi_);
+    }
+    return py::make_tuple(packArray(projected.first), projected.second);
+  }
+
+  auto expected = reader_.projectedShape(plane_coord_, dim_, mode, index_m_, roi_);
+  py::buffer_info info = requestOutputBuffer(out_, expected.first, expected.second);
+  {
+    InterruptibleRelease release;
+    reader_.readProjected(plane_coord_, dim_, mode, index_m_, cores_, roi_, info.ptr, info.size * info.itemsize);
+  }
+  return py::make_tuple(out_, expected.second);
+}
+
+py::tuple
+readBinned(pylibczi::Reader& reader_,
+           libCZI::CDimCoordinate& plane_coord_,
+           std::tuple<size_t, size_t, size_t> bins_,
+           const std::string& mode_,
+           int index_m_,
+           unsigned int cores_,
+           libCZI::IntRect roi_,
+           py::object out_)
+{
+  pylibczi::Binning binning;
+  binning.mode = projectionMode(mode_);
+  std::tie(binning.x, binning.y, binning.z) = bins_;
+  if (out_.is_none()) {
+    std::pair<pylibczi::ImagesContainerBase::ImagesContainerBasePtr, pylibczi::Reader::Shape> binned;
+    {
+      InterruptibleRelease release;
+      binned = reader_.readBinned(plane_coord_, binning, index_m_, cores_, roi_);
+    }
+    return py::make_tuple(packArray(binned.first), binned.second);
+  }
+
+  auto expected = reader_.binnedShape(plane_coord_, binning, index_m_, roi_);
+  py::buffer_info info = requestOutputBuffer(out_, expected.first, expected.second);
+  {
+    InterruptibleRelease release;
+    reader_.readBinned(plane_coord_, binning, index_m_, cores_, roi_, info.ptr, info.size * info.itemsize);
+  }
+  return py::make_tuple(out_, expected.second);
+}
+
+py::dict
+tileCatalog(pylibczi::Reader& reader_)
+{
+  const pylibczi::SubblockDirectory* directory = nullptr;
+  {
+    py::gil_scoped_release release; // the file positions may be read
+    directory = &reader_.subblockDirectory();
+  }
+  const size_t rows = directory->size();
+  const bool hasPositions = directory->hasFilePositions();
+
+  std::vector<std::pair<char, py::array_t<std::int32_t>>> dims;
+  for (auto di : pylibczi::Constants::s_sortOrder) {
+    if (directory->hasDimension(di))
+      dims.emplace_back(libCZI::Utils::DimensionToChar(di), py::array_t<std::int32_t>(rows));
+  }
+  py::array_t<std::int32_t> subblockIndex(rows), mIndex(rows), x(rows), y(rows), w(rows), h(rows);
+  py::array_t<std::uint32_t> physicalW(rows), physicalH(rows);
+  py::array_t<std::uint8_t> pyramidLayer(rows), pixelType(rows), compression(rows);
+  py::array_t<std::int64_t> filePosition(rows), segmentBytes(rows);
+
+  std::vector<std::int32_t*> dimData;
+  for (auto& dim : dims)
+    dimData.push_back(dim.second.mutable_data());
+  auto subblockIndexData = subblockIndex.mutable_data();
+  auto mIndexData = mIndex.mutable_data();
+  auto xData = x.mutable_data();
+  auto yData = y.mutable_data();
+  auto wData = w.mutable_data();
+  auto hData = h.mutable_data();
+  auto physicalWData = physicalW.mutable_data();
+  auto physicalHData = physicalH.mutable_data();
+  auto pyramidLayerData = pyramidLayer.mutable_data();
+  auto pixelTypeData = pixelType.mutable_data();
+  auto compressionData = compression.mutable_data();
+  auto filePositionData = filePosition.mutable_data();
+  auto segmentBytesData = segmentBytes.mutable_data();
+  for (pylibczi::SubblockDirectory::Row row = 0; row < rows; row++) {
+    for (size_t d = 0; d < dims.size(); d++)
+      dimData[d][row] = directory->dimValue(row, libCZI::Utils::CharToDimension(dims[d].first));
+    subblockIndexData[row] = directory->subblockIndex(row);
+    mIndexData[row] = directory->mIndex(row);
+    const libCZI::IntRect& rect = directory->logicalRect(row);
+    xData[row] = rect.x;
+    yData[row] = rect.y;
+    wData[row] = rect.w;
+    hData[row] = rect.h;
+    physicalWData[row] = directory->physicalSize(row).w;
+    physicalHData[row] = directory->physicalSize(row).h;
+    pyramidLayerData[row] = static_cast<std::uint8_t>(directory->pyramidLayer(row));
+    pixelTypeData[row] = static_cast<std::uint8_t>(directory->pixelType(row));
+    compressionData[row] = static_cast<std::uint8_t>(directory->compressionMode(row));
+    filePositionData[row] = hasPositions ? directory->filePosition(row) : -1;
+    segmentBytesData[row] = hasPositions ? directory->segmentExtent(row) : -1;
+  }
+
+  py::dict ans;
+  for (auto& dim : dims)
+    ans[py::str(std::string(1, dim.first))] = dim.second;
+  ans["M"] = mIndex;
+  ans["subblock_index"] = subblockIndex;
+  ans["x"] = x;
+  ans["y"] = y;
+  ans["w"] = w;
+  ans["h"] = h;
+  ans["physical_w"] = physicalW;
+  ans["physical_h"] = physicalH;
+  ans["pyramid_layer"] = pyramidLayer;
+  ans["pixel_type"] = pixelType;
+  ans["compression"] = compression;
+  ans["file_position"] = filePosition;
+  ans["segment_bytes"] = segmentBytes;
+  return ans;
+}
+
+py::list
+rawSubblocks(pylibczi::Reader& reader_, libCZI::CDimCoordinate& plane_coord_, int index_m_, unsigned int cores_)
+{
+  std::vector<pylibczi::Reader::RawSubblock> subblocks;
+  {
+    InterruptibleRelease release;
+    subblocks = reader_.readRawSubblocks(plane_coord_, index_m_, cores_);
+  }
+  py::list ans;
+  for (const auto& raw : subblocks) {
+    // the array shares the payload with libCZI, the capsule holds a reference until python drops it
+    auto owner = new std::shared_ptr<const void>(raw.data);
+    py::capsule keepAlive(owner, [](void* owner_) { delete static_cast<std::shared_ptr<const void>*>(owner_); });
+    auto first = static_cast<const std::uint8_t*>(raw.data.get());
+    py::array_t<std::uint8_t> bytes({ raw.size }, { size_t(1) }, first, keepAlive);
+    bytes.attr("setflags")(py::arg("write") = false);
+
+    const libCZI::SubBlockInfo& info = raw.info;
+    py::dict subblock;
+    subblock["dims"] = pylibczi::SubblockSortable::getValidIndexes(info.coordinate, info.mIndex, reader_.isMosaic());
+    subblock["subblock_index"] = raw.subblockIndex;
+    subblock["pixel_type"] = libCZI::Utils::PixelTypeToInformalString(info.pixelType);
+    subblock["compression"] = info.compressionModeRaw;
+    subblock["logical_rect"] = info.logicalRect;
+    subblock["physical_size"] = py::make_tuple(info.physicalSize.w, info.physicalSize.h);
+    subblock["data"] = py::memoryview(bytes);
+    ans.append(subblock);
+  }
+  return ans;
+}
+
+py::memoryview
+readMetaXml(pylibczi::Reader& reader_)
+{
+  pylibczi::Reader::RawMetadata raw;
+  {
+    InterruptibleRelease release;
+    raw = reader_.readMetaXml();
+  }
+  // the capsule holds the Reader's copy of the segment so the view outlives the Reader
+  auto owner = new std::shared_ptr<const void>(raw.data);
+  py::capsule keepAlive(owner, [](void* owner_) { delete static_cast<std::shared_ptr<const void>*>(owner_); });
+  auto first = static_cast<const std::uint8_t*>(raw.data.get());
+  py::array_t<std::uint8_t> bytes({ raw.size }, { size_t(1) }, first, keepAlive);
+  bytes.attr("setflags")(py::arg("write") = false);
+  return py::memoryview(bytes);
+}
+
+py::dict
+readMetaSummary(pylibczi::Reader& reader_)
+{
+  pylibczi::Reader::MetadataSummary summary;
+  {
+    InterruptibleRelease release;
+    summary = reader_.readMetaSummary();
+  }
+  auto scale = [](double meters_) -> py::object {
+    return std::isnan(meters_) ? py::object(py::none()) : py::object(py::float_(meters_));
+  };
+  py::dict ans;
+  ans["scale"] = py::dict(py::arg("X") = scale(summary.scaleX),
+                          py::arg("Y") = scale(summary.scaleY),
+                          py::arg("Z") = scale(summary.scaleZ));
+  ans["channel_names"] = summary.channelNames;
+  ans["acquisition_time"] = summary.acquisitionTime;
+  return ans;
+}
+
+py::list
+attachmentList(pylibczi::Reader& reader_)
+{
+  std::vector<pylibczi::AttachmentEntry> entries;
+  {
+    InterruptibleRelease release;
+    entries = reader_.attachments();
+  }
+  py::list ans;
+  for (const auto& entry : entries) {
+    py::dict attachment;
+    attachment["index"] = entry.index;
+    attachment["name"] = entry.name;
+    attachment["content_type"] = entry.contentType;
+    attachment["guid"] = entry.guid;
+    attachment["file_position"] = entry.filePosition;
+    attachment["size"] = entry.size;
+    ans.append(attachment);
+  }
+  return ans;
+}
+
+py::memoryview
+readAttachment(pylibczi::Reader& reader_, int index_)
+{
+  pylibczi::Reader::RawAttachment raw;
+  {
+    InterruptibleRelease release;
+    raw = reader_.readAttachment(index_);
+  }
+  // as in rawSubblocks the capsule holds libCZI's buffer until python drops the view
+  auto owner = new std::shared_ptr<const void>(raw.data);
+  py::capsule keepAlive(owner, [](void* owner_) { delete static_cast<std::shared_ptr<const void>*>(owner_); });
+  auto first = static_cast<const std::uint8_t*>(raw.data.get());
+  py::array_t<std::uint8_t> bytes({ raw.size }, { size_t(1) }, first, keepAlive);
+  bytes.attr("setflags")(py::arg("write") = false);
+  return py::memoryview(bytes);
+}
+
+py::array_t<double>
+readTimeStamps(pylibczi::Reader& reader_)
+{
+  std::vector<double> seconds;
+  {
+    InterruptibleRelease release;
+    seconds = reader_.readTimeStamps();
+  }
+  return py::array_t<double>(seconds.size(), seconds.data());
+}
+
+py::dict
+subblockFields(pylibczi::Reader& reader_,
+               libCZI::CDimCoordinate& plane_coord_,
+               int index_m_,
+               const std::vector<std::string>& fields_,
+               unsigned int cores_)
+{
+  pylibczi::SubblockFields fields;
+  {
+    InterruptibleRelease release;
+    fields = reader_.readSubblockFields(plane_coord_, index_m_, fields_, cores_);
+  }
+  const size_t rows = fields.subblockIndex.size(), columns = fields.names.size();
+  py::dict ans;
+  ans["subblock_index"] = py::array_t<std::int32_t>(rows, fields.subblockIndex.data());
+  for (size_t f = 0; f < columns; f++) {
+    if (!fields.isTime[f]) {
+      py::array_t<double> values(rows);
+      auto data = values.mutable_data();
+      for (size_t i = 0; i < rows; i++)
+        data[i] = fields.values[i * columns + f];
+      ans[py::str(fields.names[f])] = values;
+      continue;
+    }
+    // times become datetime64[us], NaN is NaT
+    py::array_t<std::int64_t> values(rows);
+    auto data = values.mutable_data();
+    for (size_t i = 0; i < rows; i++) {
+      double seconds = fields.values[i * columns + f];
+      data[i] = std::isnan(seconds) ? std::numeric_limits<std::int64_t>::min() : std::llround(seconds * 1e6);
+    }
+    ans[py::str(fields.names[f])] = values.attr("view")("datetime64[us]");
+  }
+  return ans;
+}
+
+py::dict
+exportZarr(pylibczi::Reader& reader_,
+           libCZI::CDimCoordinate& plane_coord_,
+           const std::wstring& path_,
+           std::tuple<int, int, int> chunks_,
+           int levels_,
+           const std::string& compression_,
+           int compression_level_,
+           unsigned int cores_)
+{
+  pylibczi::ZarrExport::Options options;
+  std::tie(options.chunkZ, options.chunkY, options.chunkX) = chunks_;
+  options.levels = levels_;
+  if (compression_ == "zstd")
+    options.compression = pylibczi::ZarrExport::Compression::Zstd;
+  else if (compression_ == "none")
+    options.compression = pylibczi::ZarrExport::Compression::None;
+  else
+    throw pylibczi::ExportException("Unknown compression " + compression_ + ", use zstd or None.");
+  options.compressionLevel = compression_level_;
+  options.cores = cores_;
+
+  pylibczi::ZarrExport::Statistics statistics;
+  {
+    InterruptibleRelease release;
+    statistics = pylibczi::ZarrExport(reader_, plane_coord_, options).write(path_);
+  }
+  py::dict ans;
+  ans["chunks"] = statistics.chunks;
+  ans["bytes"] = statistics.bytes;
+  ans["pixel_bytes"] = statistics.pixelBytes;
+  return ans;
+}
+
+py::dict
+perfCounters(const pylibczi::Reader& reader_)
+{
+  pylibczi::PerfCounters::Statistics stats = reader_.stats();
+  auto timing = [](const pylibczi::PerfCounters::Timing& timing_) {
+    py::dict ans;
+    ans["calls"] = timing_.calls;
+    ans["ns"] = timing_.ns;
+    return ans;
+  };
+  py::dict decode;
+  for (const auto& compression : stats.decode)
+    decode[py::int_(compression.first)] = timing(compression.second);
+  py::dict ans;
+  ans["enabled"] = stats.enabled;
+  ans["elapsed_ns"] = stats.elapsedNs;
+  ans["read_selected"] = timing(stats.readSelected);
+  ans["read_mosaic"] = timing(stats.readMosaic);
+  ans["matches"] = timing(stats.matches);
+  ans["stream_read"] = timing(stats.streamRead);
+  ans["stream_bytes"] = stats.streamBytes;
+  ans["copy"] = timing(stats.copy);
+  ans["queue_wait"] = timing(stats.queueWait);
+  ans["decode"] = decode;
+  ans["tile_cache_hits"] = stats.tileCacheHits;
+  ans["tile_cache_misses"] = stats.tileCacheMisses;
+  ans["worker_busy_ns"] = py::cast(stats.workerBusyNs);
+  return ans;
+}
+
+void
+setAllocationPolicy(pylibczi::Reader& reader_,
+                    bool huge_pages_,
+                    const std::string& numa_,
+                    bool pinned_,
+                    const std::string& file_directory_)
+{
+  pylibczi::PixelMemory::Policy policy;
+  policy.hugePages = huge_pages_;
+  if (numa_ == "default")
+    policy.numa = pylibczi::PixelMemory::Numa::Default;
+  else if (numa_ == "interleave")
+    policy.numa = pylibczi::PixelMemory::Numa::Interleave;
+  else if (numa_ == "first_touch")
+    policy.numa = pylibczi::PixelMemory::Numa::FirstTouch;
+  else
+    throw std::invalid_argument("Unknown numa placement " + numa_ + ", use default, interleave or first_touch.");
+  policy.pinned = pinned_;
+  policy.fileDirectory = file_directory_;
+  reader_.setAllocationPolicy(policy);
+}
+
+py::tuple
+nextPlanes(pylibczi::PlaneIterator& planes_)
+{
+  if (!planes_.hasNext())
+    throw py::stop_iteration();
+  pylibczi::PlaneIterator::Planes planes;
+  {
+    InterruptibleRelease release;
+    planes = planes_.next();
+  }
+  return py::make_tuple(packArray(planes.first), planes.second);
+}
+
+py::object
+readMosaic(pylibczi::Reader& reader_,
+           libCZI::CDimCoordinate plane_coord_,
+           float scale_factor_,
+           libCZI::IntRect im_box_,
+           libCZI::RgbFloatColor background_color_,
+           unsigned int cores_,
+           py::object out_)
+{
+  if (out_.is_none()) {
+    pylibczi::ImagesContainerBase::ImagesContainerBasePtr mosaic;
+    {
+      InterruptibleRelease release;
+      mosaic = reader_.readMosaic(plane_coord_, scale_factor_, im_box_, background_color_, cores_);
+    }
+    return packArray(mosaic);
+  }
+
+  auto expected = reader_.mosaicShape(plane_coord_, scale_factor_, im_box_);
+  py::buffer_info info = requestOutputBuffer(out_, expected.first, expected.second);
+  {
+    InterruptibleRelease release;
+    reader_.readMosaic(
+      plane_coord_, scale_factor_, im_box_, background_color_, cores_, info.ptr, info.size * info.itemsize);
+  }
+  return out_;
+}
+
+py::tuple
+readMosaicPlanes(pylibczi::Reader& reader_,
+                 std::vector<libCZI::CDimCoordinate> planes_,
+                 float scale_factor_,
+                 libCZI::IntRect im_box_,
+                 libCZI::RgbFloatColor background_color_,
+                 unsigned int cores_,
+                 py::object out_)
+{
+  if (out_.is_none()) {
+    pylibczi::ImagesContainerBase::ImagesContainerBasePtr mosaics;
+    {
+      InterruptibleRelease release;
+      mosaics = reader_.readMosaicPlanes(std::move(planes_), scale_factor_, im_box_, background_color_, cores_);
+    }
+    auto shape = getAndFixShape(mosaics.get());
+    return py::make_tuple(packArray(mosaics), shape);
+  }
+
+  auto expected = reader_.mosaicPlanesShape(planes_, scale_factor_, im_box_);
+  py::buffer_info info = requestOutputBuffer(out_, expected.first, expected.second);
+  {
+    InterruptibleRelease release;
+    reader_.readMosaicPlanes(
+      std::move(planes_), scale_factor_, im_box_, background_color_, cores_, info.ptr, info.size * info.itemsize);
+  }
+  return py::make_tuple(out_, expected.second);
+}
+
+py::object
+readMosaicProgressive(pylibczi::Reader& reader_,
+                      libCZI::CDimCoordinate plane_coord_,
+                      float scale_factor_,
+                      libCZI::IntRect im_box_,
+                      libCZI::RgbFloatColor background_color_,
+                      unsigned int cores_,
+                      py::object callback_,
+                      py::object out_)
+{
+  auto expected = reader_.mosaicShape(plane_coord_, scale_factor_, im_box_);
+  if (out_.is_none()) {
+    // the callback is given the array being refined so it must exist before the read
+    std::vector<py::ssize_t> shape;
+    for (const auto& dim : expected.second)
+      shape.push_back(static_cast<py::ssize_t>(dim.second));
+    out_ = py::array(dtypeOf(expected.first), shape);
+  }
+  py::buffer_info info = requestOutputBuffer(out_, expected.first, expected.second);
+
+  pylibczi::Reader::MosaicProgress progress;
+  if (!callback_.is_none()) {
+    progress = [&callback_, &out_](const void*, size_t drawn_, size_t tiles_) {
+      py::gil_scoped_acquire acquire;
+      callback_(out_, drawn_, tiles_);
+    };
+  }
+  {
+    InterruptibleRelease release;
+    reader_.readMosaicProgressive(plane_coord_,
+                                  scale_factor_,
+                                  im_box_,
+                                  background_color_,
+                                  cores_,
+                                  progress,
+                                  info.ptr,
+                                  info.size * info.itemsize);
+  }
+  return out_;
+}
+
 }
@@ -3,12 +3,14 @@
 
 #include <iostream>
 #include <memory>
+#include <pybind11/complex.h>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <set>
 #include <vector>
 
+#include "Cancellation.h"
 #include "Image.h"
 #include "ImageFactory.h"
 #include "Reader.h"
@@ -24,6 +26,328 @@ packStringArray(pylibczi::SubblockMetaVec& metadata_);
 std::vector<std::pair<char, size_t>>
 getAndFixShape(pylibczi::ImagesContainerBase* bptr_);
 
+/*!
+ * @brief py::gil_scoped_release for the reads, while the GIL is released the read checks for signals, eg Ctrl-C, at
+ * most every ReadCancellation::s_interruptInterval and stops with the KeyboardInterrupt, see ReadCancellation. The
+ * cancellation of an enclosing ReadCancellation::Scope still applies.
+ */
+class InterruptibleRelease
+{
+  pylibczi::ReadCancellation::Scope m_interrupt;
+  py::gil_scoped_release m_release;
+
+public:
+  InterruptibleRelease();
+};
+
+/*!
+ * @brief a ReadCancellation::Scope for python's with statement, the reads made in the with block on the thread
+ * entering it are cancelled by the token or when timeout_ seconds have passed since it was entered
+ */
+class CancellationContext
+{
+  std::shared_ptr<pylibczi::CancelToken> m_token;
+  double m_timeout;
+  std::unique_ptr<pylibczi::ReadCancellation::Scope> m_scope;
+
+public:
+  /*!
+   * @param token_ the token, or nullptr for only the timeout
+   * @param timeout_ the seconds the reads may take, negative for no deadline
+   */
+  CancellationContext(std::shared_ptr<pylibczi::CancelToken> token_, double timeout_);
+
+  void enter();
+  void exit();
+};
+
+/*!
+ * @brief request the buffer of out_ for writing an image into and check it fits the image exactly, ie it's
+ * C-contiguous with a dtype matching the pixel type and the same shape. Throws OutputBufferException or
+ * PixelTypeException if not. A path (str or os.PathLike) is first replaced by a numpy.memmap of that file with the
+ * shape and dtype of the image.
+ * @return the buffer, it must be kept alive while the image is written into it
+ */
+py::buffer_info
+requestOutputBuffer(py::object& out_,
+                    libCZI::PixelType pixel_type_,
+                    const std::vector<std::pair<char, size_t>>& char_sizes_);
+
+/*!
+ * @brief the PixelConversion of the rgb, dtype and window arguments of the python reads
+ * @param dtype_ "" to keep the type of the file, "uint8" or "float32", throws std::invalid_argument otherwise
+ * @param window_ the (low, high) mapped to the range of dtype_, (0, 0) for the full range of the file's type
+ */
+pylibczi::PixelConversion
+pixelConversion(bool rgb_, const std::string& dtype_, std::pair<double, double> window_);
+
+/*!
+ * @brief the StatisticsOptions of the statistics, bins and histogram_range arguments of the python reads
+ * @param group_ "plane" or "channel", throws std::invalid_argument otherwise
+ * @param range_ the (low, high) of the histogram, (0, 0) for the full range of the pixel type
+ */
+pylibczi::StatisticsOptions
+statisticsOptions(const std::string& group_, size_t bins_, std::pair<double, double> range_);
+
+/*!
+ * @brief PixelStatistics as a dict of numpy arrays shaped like its groups, min, max, sum, sum_of_squares and count,
+ * histogram with the bins as its last axis, bin_edges and dims, the [(Dimension, size)] of the groups
+ */
+py::dict
+statisticsDict(const pylibczi::PixelStatistics& statistics_);
+
+/*!
+ * @brief Reader::readSelected for python, only the roi_ of each plane is read and the pixels are read into out_
+ * when it isn't None, converted as rgb_, dtype_ and window_ say, see pixelConversion
+ * @param statistics_ "" for none, or how the statistics of the images are grouped, see statisticsOptions
+ * @return (numpy.ndarray or out_, [(Dimension, size)]), and the statisticsDict as well with statistics_
+ */
+py::tuple
+readSelected(pylibczi::Reader& reader_,
+             libCZI::CDimCoordinate& plane_coord_,
+             int index_m_,
+             unsigned int cores_,
+             libCZI::IntRect roi_,
+             py::object out_,
+             bool rgb_,
+             const std::string& dtype_,
+             std::pair<double, double> window_,
+             const std::string& statistics_,
+             size_t bins_,
+             std::pair<double, double> histogram_range_);
+
+/*!
+ * @brief Reader::readStatistics for python, the subblocks are read without the interpreter lock
+ * @param statistics_ how the statistics are grouped, see statisticsOptions
+ * @return the statisticsDict
+ */
+py::dict
+readStatistics(pylibczi::Reader& reader_,
+               libCZI::CDimCoordinate& plane_coord_,
+               int index_m_,
+               unsigned int cores_,
+               libCZI::IntRect roi_,
+               const std::string& statistics_,
+               size_t bins_,
+               std::pair<double, double> histogram_range_);
+
+/*!
+ * @brief Reader::readSelectedBatch for python, the subblocks are read without the interpreter lock
+ * @return [(numpy.ndarray, [(Dimension, size)])] one per plane in planes_
+ */
+py::list
+readSelectedBatch(pylibczi::Reader& reader_,
+                  std::vector<libCZI::CDimCoordinate> planes_,
+                  int index_m_,
+                  unsigned int cores_,
+                  libCZI::IntRect roi_,
+                  bool rgb_,
+                  const std::string& dtype_,
+                  std::pair<double, double> window_);
+
+/*!
+ * @brief Reader::readScenes for python, the subblocks are read without the interpreter lock
+ * @return [(numpy.ndarray, [(Dimension, size)])] one per scene in scenes_
+ */
+py::list
+readScenes(pylibczi::Reader& reader_,
+           const libCZI::CDimCoordinate& plane_coord_,
+           std::vector<int> scenes_,
+           int index_m_,
+           unsigned int cores_,
+           libCZI::IntRect roi_,
+           bool rgb_,
+           const std::string& dtype_,
+           std::pair<double, double> window_);
+
+/*!
+ * @brief Reader::readMosaicTiles for python, the tiles are read without the interpreter lock
+ * @return (numpy.ndarray (N, Y, X[, A]), [(Dimension, size)], M indexes numpy.ndarray (N,), boxes numpy.ndarray (N, 4)
+ * of x, y, w, h)
+ */
+py::tuple
+readMosaicTiles(pylibczi::Reader& reader_,
+                const libCZI::CDimCoordinate& plane_coord_,
+                std::vector<int> m_indices_,
+                unsigned int cores_,
+                bool rgb_,
+                const std::string& dtype_,
+                std::pair<double, double> window_);
+
+/*!
+ * @brief the Projection::Mode of "max", "mean" or "sum", throws std::invalid_argument otherwise
+ */
+pylibczi::Projection::Mode
+projectionMode(const std::string& mode_);
+
+/*!
+ * @brief Reader::readProjected for python, read into out_ when it isn't None like readSelected
+ * @param dim_ the dimension projected, eg 'Z'
+ * @param mode_ "max", "mean" or "sum", see projectionMode
+ * @return (numpy.ndarray or out_, [(Dimension, size)])
+ */
+py::tuple
+readProjected(pylibczi::Reader& reader_,
+              libCZI::CDimCoordinate& plane_coord_,
+              char dim_,
+              const std::string& mode_,
+              int index_m_,
+              unsigned int cores_,
+              libCZI::IntRect roi_,
+              py::object out_);
+
+/*!
+ * @brief Reader::readBinned for python, read into out_ when it isn't None like readSelected
+ * @param bins_ the (X, Y, Z) factors
+ * @param mode_ "max", "mean" or "sum", see projectionMode
+ * @return (numpy.ndarray or out_, [(Dimension, size)])
+ */
+py::tuple
+readBinned(pylibczi::Reader& reader_,
+           libCZI::CDimCoordinate& plane_coord_,
+           std::tuple<size_t, size_t, size_t> bins_,
+           const std::string& mode_,
+           int index_m_,
+           unsigned int cores_,
+           libCZI::IntRect roi_,
+           py::object out_);
+
+/*!
+ * @brief every subblock of the file as a dict of equal length numpy arrays, one per attribute, filled from
+ * Reader::subblockDirectory without creating an object per subblock
+ */
+py::dict
+tileCatalog(pylibczi::Reader& reader_);
+
+/*!
+ * @brief Reader::readRawSubblocks as a list of dicts, the payloads are read-only memoryviews of libCZI's memory
+ */
+py::list
+rawSubblocks(pylibczi::Reader& reader_, libCZI::CDimCoordinate& plane_coord_, int index_m_, unsigned int cores_);
+
+/*!
+ * @brief Reader::readMetaXml as a read-only memoryview of the xml bytes held by the Reader
+ */
+py::memoryview
+readMetaXml(pylibczi::Reader& reader_);
+
+/*!
+ * @brief Reader::readMetaSummary as a dict, an unknown scale is None
+ */
+py::dict
+readMetaSummary(pylibczi::Reader& reader_);
+
+/*!
+ * @brief Reader::attachments as a list of dicts, a size or file_position of -1 isn't known
+ */
+py::list
+attachmentList(pylibczi::Reader& reader_);
+
+/*!
+ * @brief Reader::readAttachment as a read-only memoryview of libCZI's memory
+ */
+py::memoryview
+readAttachment(pylibczi::Reader& reader_, int index_);
+
+/*!
+ * @brief Reader::readTimeStamps as a float64 array of seconds
+ */
+py::array_t<double>
+readTimeStamps(pylibczi::Reader& reader_);
+
+/*!
+ * @brief Reader::readSubblockFields as a dict of numpy arrays, subblock_index and one array per field, times are
+ * datetime64[us]
+ */
+py::dict
+subblockFields(pylibczi::Reader& reader_,
+               libCZI::CDimCoordinate& plane_coord_,
+               int index_m_,
+               const std::vector<std::string>& fields_,
+               unsigned int cores_);
+
+/*!
+ * @brief ZarrExport for python, writes the store without the interpreter lock
+ * @param chunks_ the (z, y, x) chunk shape
+ * @param compression_ "zstd" or "none"
+ * @return the ZarrExport::Statistics as a dict with chunks, bytes and pixel_bytes
+ */
+py::dict
+exportZarr(pylibczi::Reader& reader_,
+           libCZI::CDimCoordinate& plane_coord_,
+           const std::wstring& path_,
+           std::tuple<int, int, int> chunks_,
+           int levels_,
+           const std::string& compression_,
+           int compression_level_,
+           unsigned int cores_);
+
+/*!
+ * @brief Reader::stats as a dict, the timers are dicts of calls and ns, decode is keyed by compression identifier
+ */
+py::dict
+perfCounters(const pylibczi::Reader& reader_);
+
+/*!
+ * @brief Reader::setAllocationPolicy for python
+ * @param numa_ "default", "interleave" or "first_touch", see PixelMemory::Numa
+ * @param file_directory_ the directory of the temporary files the memory is mapped from, empty for RAM
+ */
+void
+setAllocationPolicy(pylibczi::Reader& reader_,
+                    bool huge_pages_,
+                    const std::string& numa_,
+                    bool pinned_,
+                    const std::string& file_directory_);
+
+/*!
+ * @brief PlaneIterator::next for python, raises StopIteration when there are no groups left
+ * @return (numpy.ndarray, [(Dimension, size)])
+ */
+py::tuple
+nextPlanes(pylibczi::PlaneIterator& planes_);
+
+/*!
+ * @brief Reader::readMosaic for python, the image is written into out_ when it isn't None
+ * @return a numpy.ndarray or out_
+ */
+py::object
+readMosaic(pylibczi::Reader& reader_,
+           libCZI::CDimCoordinate plane_coord_,
+           float scale_factor_,
+           libCZI::IntRect im_box_,
+           libCZI::RgbFloatColor background_color_,
+           unsigned int cores_,
+           py::object out_);
+
+/*!
+ * @brief Reader::readMosaicPlanes for python, the images are written into out_ when it isn't None
+ * @return (numpy.ndarray or out_, [(Dimension, size)])
+ */
+py::tuple
+readMosaicPlanes(pylibczi::Reader& reader_,
+                 std::vector<libCZI::CDimCoordinate> planes_,
+                 float scale_factor_,
+                 libCZI::IntRect im_box_,
+                 libCZI::RgbFloatColor background_color_,
+                 unsigned int cores_,
+                 py::object out_);
+
+/*!
+ * @brief Reader::readMosaicProgressive for python, callback_(image, drawn, tiles) is called with the array being
+ * refined, the image is written into out_ when it isn't None
+ * @return a numpy.ndarray or out_
+ */
+py::object
+readMosaicProgressive(pylibczi::Reader& reader_,
+                      libCZI::CDimCoordinate plane_coord_,
+                      float scale_factor_,
+                      libCZI::IntRect im_box_,
+                      libCZI::RgbFloatColor background_color_,
+                      unsigned int cores_,
+                      py::object callback_,
+                      py::object out_);
+
 template<typename T>
 py::array*
 memoryToNpArray(pylibczi::ImagesContainerBase* bptr_, std::vector<std::pair<char, size_t>>& charSizes_)
@@ -34,12 +358,11 @@ memoryToNpArray(pylibczi::ImagesContainerBase* bptr_, std::vector<std::pair<char
   std::transform(
     charSizes_.begin(), charSizes_.end(), shape.begin(), [](const std::pair<char, size_t>& a_) { return a_.second; });
 
-  T* mptr = tptr->releaseMemory();
+  // the capsule owns the PixelMemory, which knows how its pages were allocated
+  pylibczi::PixelMemory* memory = tptr->releaseMemory().release();
+  T* mptr = memory != nullptr ? static_cast<T*>(memory->data()) : nullptr;
 
-  py::capsule freeWhenDone(mptr, [](void* f_) {
-    T* ptr = reinterpret_cast<T*>(f_);
-    delete[] ptr;
-  });
+  py::capsule freeWhenDone(memory, [](void* f_) { delete static_cast<pylibczi::PixelMemory*>(f_); });
 
   return new py::array_t<T>(shape, mptr, freeWhenDone);
 }
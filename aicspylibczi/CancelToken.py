@@ -0,0 +1,34 @@
+# A flag to abandon reads that are no longer needed, eg the tiles of a region a viewer has panned away from.
+
+
+class CancelToken(object):
+    """Cancels the reads made with it, see CziFile.cancellable.
+
+    The reads check the token before each subblock they decode, once it's cancelled the subblocks not yet started
+    are dropped, the ones being decoded finish and the read raises PylibCZI_ReadCancelledException. A token can be
+    shared by the reads of many threads and cancelled from any thread.
+
+    **Example:**
+
+        token = CancelToken()
+        future = executor.submit(czi.read_mosaic, region=view, scale_factor=0.25, C=0, cancel=token)
+        # the view moved on
+        token.cancel()
+    """
+
+    def __init__(self):
+        import _aicspylibczi
+
+        self._token = _aicspylibczi.CancelToken()
+
+    def cancel(self):
+        """Cancel the reads made with the token, the ones running stop at their next subblock."""
+        self._token.cancel()
+
+    def reset(self):
+        """Uncancel the token so it can be used for new reads."""
+        self._token.reset()
+
+    @property
+    def cancelled(self) -> bool:
+        return self._token.cancelled
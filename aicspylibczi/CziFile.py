@@ -1,9 +1,15 @@
 # Parent class for python wrapper to libczi file for accessing Zeiss czi image and metadata.
 
+import functools
+import hashlib
 import io
+import itertools
+import mmap
 import multiprocessing
+import numbers
+import os
 from pathlib import Path
-from typing import BinaryIO, Tuple, Union
+from typing import BinaryIO, Dict, List, Tuple, Union
 
 import numpy as np
 import xml.etree.ElementTree as ET
@@ -11,19 +17,58 @@ import xml.etree.ElementTree as ET
 from . import types
 
 
+def _cancellable(read):
+    # run a read in a CziFile.cancellable of its cancel and timeout keywords
+    @functools.wraps(read)
+    def cancellable_read(self, *args, **kwargs):
+        cancel = kwargs.pop("cancel", None)
+        timeout = kwargs.pop("timeout", None)
+        if cancel is None and timeout is None:
+            return read(self, *args, **kwargs)
+        with self.cancellable(cancel, timeout):
+            return read(self, *args, **kwargs)
+
+    return cancellable_read
+
+
 class CziFile(object):
     """Zeiss CZI file object.
 
     Args:
-      |  czi_filename (str): Filename of czifile to access.
+      |  czi_filename (str): Filename of czifile to access. Objects without a file descriptor, eg io.BytesIO or the
+      |      files of fsspec/s3fs, are read through their methods with a block cache and read ahead, so remote
+      |      files don't have to be downloaded first. Any object with pread(size, offset) returning bytes, or with
+      |      seek and readinto, can be read. A CZI already in memory, as bytes, bytearray, memoryview, mmap.mmap, a
+      |      numpy array or the buf of a multiprocessing.shared_memory.SharedMemory, is read in place without a copy
+      |      or the GIL, the CziFile holds a reference to the buffer while it's open.
 
     Kwargs:
       |  verbose (bool): Print information and times during czi file access.
+      |  memory_map (bool): Memory map the file instead of reading it with positional reads. This reduces the
+      |      per-read overhead for repeated random access to large files on local storage. Only supported when
+      |      czi_filename is a path or a file object opened on a local file.
+      |  tile_cache_bytes (int): The number of bytes of decoded subblocks to keep so overlapping reads, eg repeated
+      |      read_mosaic calls while panning, copy them instead of decoding them again. 0 (the default) disables
+      |      the cache, see set_tile_cache_size.
+      |  index_file (str, Path or bool): A sidecar file caching the file header and the directories of the file, so
+      |      opening the file again reads them from the sidecar instead, which makes repeated opens of large files on
+      |      network storage much faster. The sidecar is written the first time and rewritten when the file changes.
+      |      True uses a file in the user cache directory, see default_index_file. Only supported when czi_filename is
+      |      a path or a file object opened on a local file.
+      |  pool (ReaderPool): Open the file through a ReaderPool, which keeps it open for the next CziFile of the same
+      |      path and shares its tile cache and IO scheduling with the other files of the pool. czi_filename must be
+      |      a path, memory_map and tile_cache_bytes are the pool's and index_file isn't used.
 
     .. note::
 
        Utilizes compiled wrapper to libCZI for accessing the CZI file.
 
+    .. note::
+
+       One CziFile can be read from many threads at once, eg by the workers of a tile server, the reads release the
+       GIL and share the open file and its directory. File objects read through their methods are the exception,
+       their reads take the GIL.
+
     """
 
     # xxx - likely this is a Zeiss bug,
@@ -48,22 +93,186 @@ class CziFile(object):
     ####
     ZISRAW_DIMS = {"Z", "C", "T", "R", "S", "I", "H", "V", "B"}
 
+    # the compression identifiers of subblocks, see read_raw_subblocks
+    COMPRESSION = {
+        "uncompressed": 0,
+        "jpg": 1,
+        "lzw": 2,
+        "jpgxr": 4,
+        "zstd0": 5,
+        "zstd1": 6,
+    }
+
     def __init__(
         self,
         czi_filename: types.FileLike,
         verbose: bool = False,
+        memory_map: bool = False,
+        tile_cache_bytes: int = 0,
+        index_file: Union[types.PathLike, bool, None] = None,
+        pool=None,
     ):
-        # Convert to BytesIO (bytestream)
-        self._bytes = self.convert_to_buffer(czi_filename)
         self.czifile_verbose = verbose
 
         import _aicspylibczi
 
         self.czilib = _aicspylibczi
-        self.reader = self.czilib.Reader(self._bytes)
+        if pool is not None:
+            if not isinstance(czi_filename, (str, Path)):
+                raise TypeError(f"A ReaderPool opens files by path, received: {type(czi_filename)}")
+            file_name = Path(czi_filename).expanduser().resolve(strict=True)
+            if file_name.is_dir():
+                raise IsADirectoryError(file_name)
+            # the pool holds the file open, there's no python file object
+            self._bytes = None
+            self.reader = pool.reader(str(file_name))
+            self.meta_root = None
+            return
+
+        # Convert to BytesIO (bytestream)
+        self._bytes = self.convert_to_buffer(czi_filename)
+        if memory_map or index_file:
+            file_name = getattr(self._bytes, "name", None)
+            if not isinstance(file_name, str):
+                raise TypeError(
+                    f"memory_map and index_file require a path or a file object opened on a local file, received: "
+                    f"{type(czi_filename)}"
+                )
+            if index_file is True:
+                index_file = self.default_index_file(file_name)
+            self.reader = self.czilib.Reader(
+                file_name, memory_map=memory_map, index_file=str(index_file) if index_file else None
+            )
+        else:
+            self.reader = self.czilib.Reader(self._bytes)
+        if tile_cache_bytes > 0:
+            self.reader.set_tile_cache_budget(tile_cache_bytes)
 
         self.meta_root = None
 
+    @staticmethod
+    def default_index_file(file_name: types.PathLike):
+        """
+        The sidecar index used for index_file=True, a file in the aicspylibczi folder of the user cache directory
+        ($XDG_CACHE_HOME or ~/.cache) named after the absolute path of the CZI file. The folder is created if needed.
+
+        Parameters
+        ----------
+        file_name
+            The path of the CZI file.
+
+        Returns
+        -------
+        str
+            The path of the sidecar index.
+        """
+        cache = os.environ.get("XDG_CACHE_HOME") or os.path.join(os.path.expanduser("~"), ".cache")
+        folder = os.path.join(cache, "aicspylibczi")
+        os.makedirs(folder, exist_ok=True)
+        key = hashlib.sha1(os.path.abspath(str(file_name)).encode("utf-8")).hexdigest()
+        return os.path.join(folder, key + ".idx")
+
+    def set_tile_cache_size(self, n_bytes: int):
+        """
+        Set the number of bytes of decoded subblocks kept for later reads. Shrinking it evicts the least recently
+        used subblocks, 0 disables the cache.
+
+        Parameters
+        ----------
+        n_bytes
+            The budget in bytes.
+        """
+        self.reader.set_tile_cache_budget(n_bytes)
+
+    @property
+    def tile_cache_statistics(self):
+        """
+        The state of the decoded subblock cache.
+
+        Returns
+        -------
+        TileCacheStatistics
+            An object with the hits, misses, tiles, bytes and byte_budget of the cache.
+        """
+        return self.reader.tile_cache_statistics()
+
+    def enable_perf_counters(self, enabled: bool = True):
+        """
+        Start or stop the counters of perf_counters, they're off by default so the reads pay nothing for them. The
+        counts so far are kept. In a build with PYLIBCZI_NO_PERF_COUNTERS they can't be enabled.
+
+        Parameters
+        ----------
+        enabled
+            True to count the reads from now on, False to stop.
+        """
+        self.reader.enable_stats(enabled)
+
+    def reset_perf_counters(self):
+        """
+        Zero the counters of perf_counters and restart their elapsed time, they stay enabled or disabled.
+        """
+        self.reader.reset_stats()
+
+    @property
+    def perf_counters(self):
+        """
+        Where the time of the reads went since enable_perf_counters or the last reset_perf_counters, to tell whether
+        a slow read is waiting for the file, decoding, copying or looking up subblocks.
+
+        Returns
+        -------
+        dict
+            read_selected, read_mosaic, matches (the subblock lookups), stream_read (the reads of the file), copy
+            (of decoded pixels into the result) and queue_wait (of the threads of a read for their first subblock)
+            are dicts of calls and ns. decode maps the compression names of COMPRESSION ("other" for the rest) to a
+            dict of calls and ns, subblocks read straight from uncompressed data aren't decoded. stream_bytes,
+            tile_cache_hits and tile_cache_misses are counts, the lookups are only counted while the tile cache has a
+            budget. worker_busy_ns is the decode time of every worker of the shared thread pool, the last entry is
+            the threads calling the reads, and worker_utilization is that over the time spent in read_selected and
+            read_mosaic. enabled and elapsed_ns are the state of the counters.
+        """
+        stats = self.reader.stats()
+        names = {identifier: name for name, identifier in self.COMPRESSION.items()}
+        stats["decode"] = {names.get(identifier, "other"): timing for identifier, timing in stats["decode"].items()}
+        read_ns = stats["read_selected"]["ns"] + stats["read_mosaic"]["ns"]
+        stats["worker_utilization"] = [busy / read_ns if read_ns > 0 else 0.0 for busy in stats["worker_busy_ns"]]
+        return stats
+
+    def set_allocation_policy(
+        self,
+        huge_pages: bool = False,
+        numa: str = "default",
+        pinned: bool = False,
+        file_directory: Union[str, Path, None] = None,
+    ):
+        """
+        Set how the memory of the arrays read_image and read_mosaic return is allocated, reads into an out array
+        aren't affected. Huge pages and the NUMA placement are best effort, on systems without them the memory is
+        allocated as usual.
+
+        Parameters
+        ----------
+        huge_pages
+            Back the memory with 2 MiB pages, reserved huge pages if there are any otherwise transparent huge pages.
+            Multi-GB reads have far fewer TLB misses.
+        numa
+            "default" leaves the pages on the node of the thread writing them first, "interleave" spreads them over
+            every NUMA node (linux) and "first_touch" has the worker threads fault them in before the read.
+        pinned
+            Lock the pages in RAM so the array can be registered for GPU uploads without a copy, eg with
+            cudaHostRegister. Raises PylibCZI_ImageCopyAllocFailed if the locked memory limit (ulimit -l) is too
+            low.
+        file_directory
+            Map the memory of each array from a temporary file in this directory, eg tempfile.gettempdir(), for
+            results bigger than RAM. The pages are then held by the page cache and written back to the file instead
+            of swapped, the file is deleted with the array. huge_pages and numa don't apply to it. To keep the
+            result in a file of your own give its path as out instead, see read_image.
+        """
+        self.reader.set_allocation_policy(
+            huge_pages=huge_pages, numa=numa, pinned=pinned, file_directory=str(file_directory or "")
+        )
+
     @property
     def shape_is_consistent(self):
         """
@@ -389,6 +598,55 @@ class CziFile(object):
         """
         return self.reader.read_mosaic_bounding_box()
 
+    def get_pyramid_layers(self):
+        """
+        Get the pyramid layers stored in the file. read_mosaic with a scale_factor below 1.0 reads each scene from
+        the coarsest layer that is at least as fine as the scale_factor, so thumbnails don't decode the full
+        resolution data when the file has a pyramid.
+
+        Returns
+        -------
+        [PyramidLayer]
+            The layers finest first, layer 0 is the acquired data and is always present.
+            layer.layer = The number of the layer.
+            layer.minification = How much smaller the layer is than layer 0 along each axis, eg 2.0 or 4.0.
+            layer.subblocks = The number of subblocks in the layer.
+
+        """
+        return self.reader.read_pyramid_layers()
+
+    def get_tile_catalog(self):
+        """
+        Get every subblock in the file, pyramid layers included, as columns of numpy arrays. The catalog comes from
+        the directory the file was opened with so no pixels are read, this is the way to plan reads over files with
+        many tiles, eg to group neighbouring subblocks of the file into one task.
+
+        **Example:** The tiles of channel 0 in pyramid layer 0
+
+            catalog = czi.get_tile_catalog()
+            tiles = (catalog["C"] == 0) & (catalog["pyramid_layer"] == 0)
+            x, y = catalog["x"][tiles], catalog["y"][tiles]
+
+        Returns
+        -------
+        dict[str, numpy.ndarray]
+            Arrays of the same length, element i of each describes the same subblock.
+            One int32 array for each dimension of the file, eg "C", "Z", "T", "S". The minimum int32 value means
+            the subblock doesn't set the dimension.
+            "M" = The M index, not valid (the maximum or minimum int32 value) for subblocks without one.
+            "subblock_index" = The index libCZI gives the subblock.
+            "x", "y", "w", "h" = The logical rect of the subblock on the plane.
+            "physical_w", "physical_h" = The size of the stored pixels, smaller than w and h for pyramid subblocks.
+            "pyramid_layer" = The pyramid layer, see get_pyramid_layers.
+            "pixel_type" = The libCZI PixelType value, eg 1 for Gray16.
+            "compression" = The libCZI CompressionMode value, eg 0 for uncompressed.
+            "file_position" = Where the subblock segment starts in the file, -1 if it can't be determined.
+            "segment_bytes" = An upper bound on the size of the segment in bytes, the distance to the next segment
+                in the file. -1 for the last segment or if it can't be determined.
+
+        """
+        return self.reader.read_tile_catalog()
+
     @property
     def size(self):
         """
@@ -417,7 +675,7 @@ class CziFile(object):
         return self.reader.is_mosaic()
 
     @staticmethod
-    def convert_to_buffer(file: types.FileLike) -> Union[BinaryIO, np.ndarray]:
+    def convert_to_buffer(file: types.FileLike) -> Union[BinaryIO, types.MemoryLike]:
         if isinstance(file, (str, Path)):
             # This will both fully expand and enforce that the filepath exists
             f = Path(file).expanduser().resolve(strict=True)
@@ -428,18 +686,24 @@ class CziFile(object):
 
             return open(f, "rb")
 
-        # Convert bytes
-        elif isinstance(file, bytes):
-            return io.BytesIO(file)
+        # A CZI in memory, the reader borrows the buffer
+        elif isinstance(file, (bytes, bytearray, memoryview, mmap.mmap, np.ndarray)):
+            return file
 
         # Set bytes
-        elif isinstance(file, (io.BytesIO, io.BufferedReader, io.IOBase, np.ndarray)):
+        elif isinstance(file, (io.BytesIO, io.BufferedReader, io.IOBase)):
+            return file
+
+        # Objects read through their methods, eg remote files with a pread(size, offset)
+        elif hasattr(file, "pread") or (hasattr(file, "seek") and hasattr(file, "readinto")):
             return file
 
         # Raise
         else:
             raise TypeError(
-                f"Reader only accepts types: [str, pathlib.Path, bytes, io.BytesIO, io.IOBase], received: {type(file)}"
+                f"Reader only accepts types: [str, pathlib.Path, bytes, bytearray, memoryview, mmap.mmap, "
+                f"numpy.ndarray, io.BytesIO, io.IOBase] or objects with pread(size, offset) or seek and readinto "
+                f"methods, received: {type(file)}"
             )
 
     @property
@@ -454,11 +718,40 @@ class CziFile(object):
 
         """
         if self.meta_root is None:
-            meta_str = self.reader.read_meta()
-            self.meta_root = ET.fromstring(meta_str)
+            self.meta_root = ET.fromstring(self.reader.read_meta())
 
         return self.meta_root
 
+    @property
+    def meta_xml(self):
+        """
+        The metadata block as it is stored in the file, without decoding it into a str. The reader reads the block
+        once and every access shares it.
+
+        Returns
+        -------
+        memoryview
+            a read-only view of the utf-8 xml, eg for lxml.etree.fromstring(bytes(czi.meta_xml)) or to write it out.
+        """
+        return self.reader.read_meta_xml()
+
+    def get_meta_summary(self):
+        """
+        Get the well known values of the metadata without parsing it in python. The scaling comes from libCZI and
+        the rest from a scan of the xml for the elements, on a file with tens of MB of metadata this is much faster
+        than meta.
+
+        Returns
+        -------
+        dict
+            scale               {"X": float, "Y": float, "Z": float} the meters per pixel, None if the file doesn't
+                                give it,
+            channel_names       [str] the Name of each channel of Information/Image/Dimensions/Channels,
+            acquisition_time    the Information/Image/AcquisitionDateAndTime as stored, "" if there's none.
+        """
+        return self.reader.read_meta_summary()
+
+    @_cancellable
     def read_subblock_metadata(self, unified_xml: bool = False, **kwargs):
         """
         Read the subblock specific metadata, ie time subblock was acquired / position at acquisition time etc.
@@ -480,6 +773,8 @@ class CziFile(object):
                        H = 7   # The H-dimension ("phase").
                        V = 8   # The V-dimension ("view").
                        M = 10  # The M_index, this is only valid for Mosaic files!
+            and cores as for read_image, the number of cores the metadata is read on, and cancel and timeout as for
+            read_image.
 
         Returns
         -------
@@ -491,7 +786,10 @@ class CziFile(object):
         """
         plane_constraints = self._get_coords_from_kwargs(kwargs)
         m_index = self._get_m_index_from_kwargs(kwargs)
-        subblock_meta = self.reader.read_meta_from_subblock(plane_constraints, m_index)
+        cores = self._get_cores_from_kwargs(kwargs)
+        subblock_meta = self.reader.read_meta_from_subblock(
+            plane_constraints, m_index, cores
+        )
         if not unified_xml:
             return subblock_meta
         root = ET.Element("Subblocks")
@@ -505,6 +803,224 @@ class CziFile(object):
             root.append(new_element)
         return root
 
+    @_cancellable
+    def read_subblock_fields(
+        self,
+        fields: Tuple = ("AcquisitionTime", "StageXPosition", "StageYPosition"),
+        **kwargs,
+    ):
+        """
+        Read chosen values of the subblock specific metadata into numpy arrays, one value per subblock, without
+        building the xml of every subblock as read_subblock_metadata does. This is much faster for files with many
+        tiles.
+
+        **Example:** The stage positions of every tile of a mosaic
+
+            czi = CziFile(filename)
+            fields = czi.read_subblock_fields(("StageXPosition", "StageYPosition"), C=0)
+            x, y = fields["StageXPosition"], fields["StageYPosition"]
+
+        Parameters
+        ----------
+        fields
+            The names of the xml elements in the subblock metadata <Tags> to read, eg AcquisitionTime,
+            StageXPosition, StageYPosition or FocusPosition.
+        kwargs
+            The dimension constraints as for read_subblock_metadata and cores, cancel and timeout as for read_image.
+
+        Returns
+        -------
+        dict
+            subblock_index and one array per field, the subblocks are in read_subblock_metadata order. Numbers are
+            float64, NaN where a subblock doesn't have the field. Times are datetime64[us], NaT where missing.
+            subblock_index matches the subblock_index of get_tile_catalog.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        m_index = self._get_m_index_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        return self.reader.read_subblock_fields(
+            plane_constraints, m_index, list(fields), cores
+        )
+
+    @_cancellable
+    def read_raw_subblocks(self, **kwargs):
+        """
+        Read the matching subblocks without decoding them, eg to copy JPG-XR or zstd tiles into a chunked format
+        without transcoding or to decode them in a pipeline of your own.
+
+        **Example:** The compressed tiles of channel 0
+
+            czi = CziFile(filename)
+            for subblock in czi.read_raw_subblocks(C=0):
+                if subblock["compression"] == CziFile.COMPRESSION["jpgxr"]:
+                    store(subblock["dims"], bytes(subblock["data"]))
+
+        Parameters
+        ----------
+        kwargs
+            The dimension constraints as for read_subblock_metadata and cores, cancel and timeout as for read_image.
+
+        Returns
+        -------
+        [dict]
+            one dict per subblock in read_subblock_metadata order with
+                dims            the {Dimension: index} of the subblock,
+                subblock_index  its index in get_tile_catalog,
+                pixel_type      eg "gray16",
+                compression     the compression identifier stored in the file, see CziFile.COMPRESSION,
+                logical_rect    the BBox it covers in the image,
+                physical_size   the (width, height) of the stored pixels,
+                data            a read-only memoryview of the payload as stored, it shares memory with the
+                                reader's copy of the subblock so no bytes are copied.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        m_index = self._get_m_index_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        return self.reader.read_raw_subblocks(plane_constraints, m_index, cores)
+
+    def get_attachments(self):
+        """
+        List the attachments of the file, eg the TimeStamps, EventList or Thumbnail stored with the acquisition.
+        Only the attachment directory and the head of each attachment are read.
+
+        Returns
+        -------
+        [dict]
+            one dict per attachment in file order with
+                index           the index to pass to read_attachment,
+                name            eg "TimeStamps",
+                content_type    eg "CZTIMS", "CZEVL" or "JPG",
+                guid            the content GUID as a string,
+                file_position   the offset of the attachment segment in the file, -1 if it isn't known,
+                size            the bytes of the attachment's data, -1 if it isn't known.
+        """
+        return self.reader.read_attachments()
+
+    def read_attachment(self, attachment: Union[int, str]):
+        """
+        Read the data of an attachment as it is stored, eg the JPG of the Thumbnail.
+
+        **Example:** Save the thumbnail
+
+            czi = CziFile(filename)
+            Path("thumbnail.jpg").write_bytes(czi.read_attachment("Thumbnail"))
+
+        Parameters
+        ----------
+        attachment
+            The index of the attachment in get_attachments or its name, the first attachment with the name is read.
+
+        Returns
+        -------
+        memoryview
+            a read-only view of the data, it shares memory with the reader's copy so no bytes are copied.
+        """
+        if isinstance(attachment, str):
+            matches = [a["index"] for a in self.get_attachments() if a["name"] == attachment]
+            if not matches:
+                raise KeyError(f"The file has no attachment named {attachment}.")
+            attachment = matches[0]
+        return self.reader.read_attachment(attachment)
+
+    def read_time_stamps(self):
+        """
+        Read the time of each acquired frame from the TimeStamps attachment without parsing the xml metadata.
+
+        Returns
+        -------
+        numpy.ndarray
+            the float64 seconds of each frame, relative to the start time of the acquisition software's clock.
+        """
+        return self.reader.read_time_stamps()
+
+    def export_zarr(
+        self,
+        path: Union[str, Path],
+        chunks: Tuple = (1, 1024, 1024),
+        levels: int = 1,
+        compression: str = "zstd",
+        compression_level: int = 3,
+        **kwargs,
+    ):
+        """
+        Write the image to an OME-Zarr (NGFF 0.4) directory store with a TCZYX array per pyramid level, natively and
+        without holding the GIL. The image is read a band of chunks at a time, mosaic tiles are composited into the
+        chunk grid, and the chunks are compressed and written on the thread pool while the next band is read, so the
+        memory used is a few bands rather than the image.
+
+        **Example:** Scene 0 of a slide scan with a 5 level pyramid
+
+            czi = CziFile(filename)
+            czi.export_zarr("scene0.zarr", levels=5, S=0)
+
+        Parameters
+        ----------
+        path
+            The directory of the store, it's created if it doesn't exist, its parent must exist.
+        chunks
+            The (z, y, x) shape of the chunks, the t and c of a chunk are 1. y must be even when levels > 1.
+        levels
+            1 writes the full resolution only, each further level is a 2x2 mean of the level before it.
+        compression
+            "zstd" or None. zstd is only available if the module was built with it, see _aicspylibczi.Reader.has_zstd.
+        compression_level
+            The zstd level.
+        kwargs
+            The dimension constraints selecting the image and cores as for read_image. The dimensions other than T,
+            C and Z must have one value or be given. S selects the scene, a mosaic without S is exported whole.
+            T, C or Z given exports only that index.
+
+        Returns
+        -------
+        dict
+            chunks, the number of chunk files written over all levels, bytes, their size, and pixel_bytes, their
+            uncompressed size.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        return self.reader.export_zarr(
+            plane_constraints,
+            str(path),
+            tuple(chunks),
+            levels,
+            "none" if compression is None else compression,
+            compression_level,
+            cores,
+        )
+
+    def cancellable(self, token=None, timeout: float = None):
+        """
+        A context manager abandoning the reads made in its with block on the calling thread when token is cancelled
+        or once timeout seconds have passed since the block started, eg for the tiles of a viewer which may pan away
+        before they're read. The reads also take them as their cancel and timeout keywords.
+
+        **Example:**
+
+            token = CancelToken()
+            with czi.cancellable(token, timeout=0.5):
+                tiles = czi.read_mosaic(region=view, scale_factor=0.25, C=0)
+
+        The reads check the cancellation before each subblock they decode, the subblocks not yet started are then
+        dropped and the ones being decoded finish, so a read stops within one subblock per core and raises
+        PylibCZI_ReadCancelledException. Independent of this the reads stop with KeyboardInterrupt on Ctrl-C while
+        they run without the GIL.
+
+        Parameters
+        ----------
+        token
+            A CancelToken, or None for only the timeout.
+        timeout
+            The seconds the reads of the block may take, None for no deadline.
+
+        Returns
+        -------
+        A context manager for the with statement.
+        """
+        return self.czilib.Cancellation(
+            None if token is None else token._token, -1.0 if timeout is None else float(timeout)
+        )
+
+    @_cancellable
     def read_image(self, **kwargs):
         """
         Read the subblocks in the CZI file and for any subblocks that match all the constraints in kwargs return
@@ -529,6 +1045,27 @@ class CziFile(object):
                  M = 10  # The M_index, this is only valid for Mosaic files!
             Specify the number of cores to use for multithreading with cores.
                 cores = 3 # use 3 cores for threaded reading of the image.
+            Specify a region of each plane (tile for mosaic files) to read with roi.
+                roi = (x0, y0, w, h) # relative to the plane's origin, Y and X of the result are h and w.
+            Specify a preallocated array to read the image into with out.
+                out = numpy.empty(shape, dtype) # a writable C-contiguous array, see Notes.
+            Convert the pixels as they are copied out of the subblocks, see Notes.
+                rgb = True # the A dimension of BGR images is R, G, B (BGRA is RGBA)
+                dtype = numpy.uint8 # or numpy.float32, the dtype of the result
+                window = (low, high) # the range mapped to 0 - 255 for uint8 or 0 - 1 for float32
+            Project one dimension of the selection while it is read, see Notes.
+                projection = "max" # or "mean" or "sum"
+                projection_dim = "Z" # the dimension projected, "Z" by default
+            Bin the selection while it is read, see Notes.
+                binning = {"X": 4, "Y": 4, "Z": 2} # the factor of each axis, 1 for the ones not given
+                binning_mode = "mean" # or "max" or "sum", "mean" by default
+            Collect statistics of the pixels while they are read, see Notes and read_statistics.
+                statistics = "channel" # or "plane", the groups the statistics are collected for
+                histogram_bins = 256 # the bins of the histogram
+                histogram_range = (low, high) # the range of the histogram, the full range of the dtype by default
+            Abandon the read when a CancelToken is cancelled or after a number of seconds, see cancellable.
+                cancel = token # a CancelToken
+                timeout = 0.5 # seconds
 
         Returns
         -------
@@ -537,6 +1074,7 @@ class CziFile(object):
             sure the numpy.ndarray is interpretable. An example of the list is
             [('S', 1), ('T', 1), ('C', 2), ('Z', 25), ('Y', 1024), ('X', 1024)]
             so if you probed the numpy.ndarray with .shape you would get (1, 1, 2, 25, 1024, 1024).
+            With statistics the tuple has a third element, the dict read_statistics returns.
 
         Notes
         -----
@@ -544,19 +1082,350 @@ class CziFile(object):
         packed for a given selection which causes problems when indexing memory. Consequently the M Dimension may
         not match the m_index that is being used in libCZI or displayed in Zeiss' Zen software.
 
+        When out is given the pixels are written straight into it and it is returned as the first element of the
+        tuple. It must be writable and C-contiguous with exactly the shape and dtype the call would return without
+        it, otherwise a ValueError (or PylibCZI_PixelTypeException for a dtype mismatch) is raised. Reusing one
+        array across calls avoids allocating a new one for every read. out may also be the path of a file (a str or
+        os.PathLike), it is then created or overwritten and returned as a numpy.memmap of it with the shape and dtype
+        of the result, the pixels are written straight into the mapping. read_mosaic and read_mosaic_planes take a
+        path as out too.
+
+        When roi is given only its pixels are copied out of each plane, the result is the same as slicing the full
+        read with [..., y0:y0 + h, x0:x0 + w] without the memory for the full planes. The roi must lie inside
+        every selected plane, otherwise a PylibCZI_RegionSelectionException is raised.
+
+        rgb, dtype and window are applied by the copy of each subblock, which is faster than converting the result
+        with numpy and needs no second array. The samples are mapped linearly from window, by default the full range
+        of an integer pixel type, eg 0 - 65535, or 0 - 1 for float pixels, uint8 samples are rounded and clamped.
+        A float32 result without a window is the float type of the file as it is. The shape doesn't change.
+
+        With projection the result is the maximum, mean or sum over projection_dim, which is dropped from the shape.
+        The subblocks are accumulated as they are decoded so only the projected planes are held in memory, however
+        deep the stack, plus about cores - 1 planes while several threads add to the same plane. max keeps the
+        dtype of the file, mean and sum are float64. It can't be combined with rgb, dtype or window.
+
+        With binning each block of X by Y pixels and Z planes is replaced by its mean, maximum or sum as the
+        subblocks are decoded, so the memory and copies scale with the binned result. The pixels left over at the
+        right and bottom are dropped, the last bin of a Z-stack is shallower if the factor doesn't divide it. The
+        dtypes are those of projection. It can't be combined with projection, rgb, dtype or window.
+
+        With statistics each image is summarized right after it's copied, while it's still in the cache, so the
+        statistics cost no second pass over the array. They are those of the dtype returned, after rgb, dtype and
+        window. They can't be combined with projection or binning.
+
         """
         plane_constraints = self._get_coords_from_kwargs(kwargs)
         m_index = self._get_m_index_from_kwargs(kwargs)
         cores = self._get_cores_from_kwargs(kwargs)
-
-        image, shape = self.reader.read_selected(plane_constraints, m_index, cores)
+        roi = self._get_bbox(kwargs.get("roi"))
+        out = kwargs.get("out")
+        rgb, dtype, window = self._get_conversion_from_kwargs(kwargs)
+        statistics, bins, histogram_range = self._get_statistics_from_kwargs(kwargs)
+        if statistics and (kwargs.get("binning") is not None or kwargs.get("projection") is not None):
+            raise ValueError("statistics can't be combined with projection or binning.")
+
+        binning = kwargs.get("binning")
+        if binning is not None:
+            if kwargs.get("projection") is not None or rgb or dtype or window != (0.0, 0.0):
+                raise ValueError("binning can't be combined with projection, rgb, dtype or window.")
+            unknown = set(binning) - {"X", "Y", "Z"}
+            if unknown:
+                raise ValueError(f"only X, Y and Z can be binned, not {sorted(unknown)}.")
+            bins = tuple(int(binning.get(dim, 1)) for dim in "XYZ")
+            if min(bins) < 1:
+                raise ValueError(f"binning factors must be at least 1, not {binning}.")
+            image, shape = self.reader.read_binned(
+                plane_constraints,
+                bins,
+                kwargs.get("binning_mode", "mean"),
+                m_index,
+                cores,
+                roi,
+                out,
+            )
+            return image, shape
+
+        projection = kwargs.get("projection")
+        if projection is not None:
+            if projection not in ("max", "mean", "sum"):
+                raise ValueError(f"projection must be max, mean or sum, not {projection}.")
+            if rgb or dtype or window != (0.0, 0.0):
+                raise ValueError("projection can't be combined with rgb, dtype or window.")
+            image, shape = self.reader.read_projected(
+                plane_constraints,
+                kwargs.get("projection_dim", "Z"),
+                projection,
+                m_index,
+                cores,
+                roi,
+                out,
+            )
+            return image, shape
+
+        if statistics:
+            return self.reader.read_selected(
+                plane_constraints,
+                m_index,
+                cores,
+                roi,
+                out,
+                rgb,
+                dtype,
+                window,
+                statistics,
+                bins,
+                histogram_range,
+            )
+        image, shape = self.reader.read_selected(
+            plane_constraints, m_index, cores, roi, out, rgb, dtype, window
+        )
         return image, shape
 
+    @_cancellable
+    def read_statistics(
+        self,
+        statistics: str = "channel",
+        histogram_bins: int = 256,
+        histogram_range: Tuple = None,
+        **kwargs,
+    ):
+        """
+        The statistics of the pixels read_image would read, without keeping the pixels, eg to estimate the contrast
+        of a large file. Each subblock is summarized where it's decoded, nothing is copied into an array.
+
+        **Example:** The 1st and 99th percentiles of each channel
+
+            czi = CziFile(filename)
+            stats = czi.read_statistics(S=0)
+            cumulative = np.cumsum(stats["histogram"], axis=-1) / stats["count"][..., np.newaxis]
+            low = stats["bin_edges"][np.argmax(cumulative >= 0.01, axis=-1)]
+            high = stats["bin_edges"][np.argmax(cumulative >= 0.99, axis=-1) + 1]
+
+        Parameters
+        ----------
+        statistics
+            "channel" for one set of statistics per C, or "plane" for one per plane read_image would return.
+        histogram_bins
+            The number of bins of the histogram, equally wide across histogram_range.
+        histogram_range
+            The (low, high) of the histogram, by default the full range of an integer dtype, eg (0, 65536) for
+            uint16, or (0, 1) for floats. Samples outside it are counted in the first or last bin.
+        kwargs
+            The dimension constraints, M, cores, roi, cancel and timeout as for read_image.
+
+        Returns
+        -------
+        dict
+            "dims" the [(Dimension, size)] of the groups, eg [('C', 3)], "min", "max", "sum", "sum_of_squares" and
+            "count" arrays of that shape, "histogram" with the bins as a last axis and the "bin_edges" of the bins.
+            The samples of BGR pixels are counted together.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        m_index = self._get_m_index_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        roi = self._get_bbox(kwargs.get("roi"))
+        statistics, bins, histogram_range = self._get_statistics_from_kwargs(
+            {
+                "statistics": statistics,
+                "histogram_bins": histogram_bins,
+                "histogram_range": histogram_range,
+            }
+        )
+        return self.reader.read_statistics(
+            plane_constraints, m_index, cores, roi, statistics, bins, histogram_range
+        )
+
+    @_cancellable
+    def read_images(self, selections: List[Dict[str, int]], **kwargs):
+        """
+        Read several selections at once, eg for a batch of a dataloader. The result is the same as a read_image call
+        per selection but the subblocks of all of them are read in one pass over the file, a subblock selected more
+        than once is read and decoded once.
+
+        **Example:**
+
+            czi = CziFile(filename)
+            (c0, c0_shape), (c1, c1_shape) = czi.read_images([{"C": 0, "Z": 5}, {"C": 1}], cores=4)
+
+        Parameters
+        ----------
+        selections
+            The selections, each is a dict of the dimension keywords of read_image, eg {"C": 0, "Z": 5}.
+        **kwargs
+            M, cores, roi, rgb, dtype, window, cancel and timeout as in read_image, they apply to every selection.
+
+        Returns
+        -------
+        [(numpy.ndarray, [Dimension, Size])]
+            What read_image returns for each selection, in the order of selections.
+        """
+        planes = [self._get_coords_from_kwargs(selection) for selection in selections]
+        m_index = self._get_m_index_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        roi = self._get_bbox(kwargs.get("roi"))
+        rgb, dtype, window = self._get_conversion_from_kwargs(kwargs)
+        return self.reader.read_selected_batch(
+            planes, m_index, cores, roi, rgb, dtype, window
+        )
+
+    @_cancellable
+    def read_scenes(self, scenes: Union[List[int], None] = None, pad: bool = False, pad_value=0, **kwargs):
+        """
+        Read several scenes at once, eg every well of a plate. The scenes needn't have the same shape, so files
+        read_image only reads a scene at a time (when the scenes have inconsistent shapes) are read in one call, and
+        the subblocks of all the scenes are read in one pass over the file with every core.
+
+        **Example:**
+
+            czi = CziFile(filename)
+            wells = czi.read_scenes(C=0, cores=8)  # [(numpy.ndarray, [Dimension, Size])] one per scene
+            plate, dims, extents = czi.read_scenes(C=0, pad=True)
+
+        Parameters
+        ----------
+        scenes
+            The scene indexes, by default every scene of the file.
+        pad
+            Stack the scenes along S into one array instead of returning an array per scene, see stack_scenes.
+        pad_value
+            The value of the padding of the stacked array.
+        **kwargs
+            The dimension constraints but S, M, cores, roi, rgb, dtype, window, cancel and timeout as in read_image.
+
+        Returns
+        -------
+        [(numpy.ndarray, [Dimension, Size])]
+            What read_image with S returns for each scene, in the order of scenes.
+        (numpy.ndarray, [Dimension, Size], numpy.ndarray)
+            With pad, what stack_scenes returns.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        m_index = self._get_m_index_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        roi = self._get_bbox(kwargs.get("roi"))
+        rgb, dtype, window = self._get_conversion_from_kwargs(kwargs)
+        images = self.reader.read_scenes(
+            plane_constraints, list(scenes or []), m_index, cores, roi, rgb, dtype, window
+        )
+        return self.stack_scenes(images, pad_value) if pad else images
+
+    @staticmethod
+    def stack_scenes(images: List[Tuple[np.ndarray, List[Tuple[str, int]]]], pad_value=0):
+        """
+        Stack the per scene results of read_scenes along S into one array, every dimension is as large as the largest
+        scene's and the smaller scenes are padded at its end.
+
+        Parameters
+        ----------
+        images
+            The (numpy.ndarray, [Dimension, Size]) of every scene, with the same dimensions in the same order.
+        pad_value
+            The value of the padding.
+
+        Returns
+        -------
+        (numpy.ndarray, [Dimension, Size], numpy.ndarray)
+            The stacked array, its dimensions and the extents, an array of shape (scenes, dimensions) with the size
+            of every dimension of each scene, the scene's valid region of the stacked array starts at 0 in every
+            dimension. The S of the extents is 1.
+        """
+        if not images:
+            raise ValueError("There are no scenes to stack.")
+        dims = [dim for dim, _ in images[0][1]]
+        if any([dim for dim, _ in image_dims] != dims for _, image_dims in images):
+            raise ValueError(f"The scenes must have the same dimensions to be stacked, the first has {dims}.")
+        if "S" not in dims:
+            raise ValueError("The scenes have no S dimension to stack them along.")
+        s_axis = dims.index("S")
+        extents = np.array([image.shape for image, _ in images], dtype=np.int64)
+        shape = [int(size) for size in extents.max(axis=0)]
+        shape[s_axis] = len(images)
+        stacked = np.full(shape, pad_value, dtype=images[0][0].dtype)
+        for i, (image, _) in enumerate(images):
+            region = [slice(0, size) for size in image.shape]
+            region[s_axis] = slice(i, i + 1)
+            stacked[tuple(region)] = image
+        return stacked, list(zip(dims, shape)), extents
+
+    def iter_image(self, group_dims: str = "", prefetch: int = 2, **kwargs):
+        """
+        Iterate over the subblocks read_image would read a group at a time instead of reading them all into one
+        array, eg one time-point at a time of a long time-lapse. The next groups are read in the background while
+        the current one is processed, at most prefetch groups are held ahead of the caller.
+
+        **Example:** Process every T of channel 0 with 4 time-points read ahead
+
+            czi = CziFile(filename)
+            for image, shape in czi.iter_image("T", prefetch=4, C=0):
+                process(image)  # shape = [('B', 1), ('T', 1), ('C', 1), ('Z', 5), ('Y', 1024), ('X', 1024)]
+
+        Parameters
+        ----------
+        group_dims
+            The dimensions stepped over, a group is the selected subblocks with one value of each of them, eg "T"
+            or "TZ". M can be used for mosaic files. The default "" yields one subblock at a time. The groups come
+            in the order read_image returns the subblocks in.
+        prefetch
+            The number of groups read ahead in the background, 0 reads each group when it is asked for.
+        kwargs
+            The dimension constraints, cores and roi as for read_image.
+
+        Returns
+        -------
+        iterator of (numpy.ndarray, [Dimension, Size])
+            a (numpy.ndarray, list of (Dimension, size)) tuple for each group, as read_image returns them. len()
+            gives the number of groups.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        m_index = self._get_m_index_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        roi = self._get_bbox(kwargs.get("roi"))
+        return self.reader.read_planes(
+            plane_constraints, group_dims, m_index, prefetch, cores, roi
+        )
+
+    def prefetch_image(self, decode: bool = True, **kwargs):
+        """
+        Start reading the subblocks read_image would read for the same kwargs in the background and return at once,
+        eg the next time-point of a viewer or a training loop while the current one is processed. The next read_image
+        then finds the data already in memory.
+
+        **Example:** Read T=1 while T=0 is processed
+
+            czi = CziFile(filename)
+            czi.set_tile_cache_size(512 * 2**20)
+            image, shape = czi.read_image(T=0, C=0)
+            pending = czi.prefetch_image(T=1, C=0)
+            process(image)
+            image, shape = czi.read_image(T=1, C=0)  # decoded by the prefetch
+
+        Parameters
+        ----------
+        decode
+            Decode the subblocks into the tile cache as well, see set_tile_cache_size. Without a tile cache budget
+            only the file is read, which warms the operating system's and a file object's caches.
+        kwargs
+            The dimension constraints and cores as for read_image, cores defaults to 1 so the prefetch leaves the
+            other cores to the reads in the foreground.
+
+        Returns
+        -------
+        Prefetch
+            wait() blocks until the prefetch is done and raises the first error it hit, done() is True once it is.
+            A read doesn't have to wait for it, the subblocks the prefetch hasn't reached yet are read by the read.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        m_index = self._get_m_index_from_kwargs(kwargs)
+        cores = kwargs.get("cores", 1)
+        return self.reader.prefetch_selected(plane_constraints, m_index, decode, cores)
+
+    @_cancellable
     def read_mosaic(
         self,
         region: Tuple = None,
         scale_factor: float = 1.0,
         background_color: Tuple = None,
+        out=None,
         **kwargs,
     ):
         """
@@ -580,6 +1449,10 @@ class CziFile(object):
         background_color
             Background color used when pixel is outside of a sublock. If omitted, it defaults to black
             (r,g,b)=(0.0,0.0,0.0). Each color component is a float value between 0.0 and 1.0.
+        out
+            A preallocated writable C-contiguous numpy.ndarray to write the image into, it must have exactly the
+            shape and dtype that would be returned without it. If given it is returned. A file path gives a
+            numpy.memmap of that file, see read_image.
         kwargs
             The keywords below allow you to specify the dimension plane that constrains the 2D data. If the
             constraints are underspecified the function will fail. ::
@@ -591,6 +1464,9 @@ class CziFile(object):
                     I = 6   # The I-dimension ("illumination").
                     H = 7   # The H-dimension ("phase").
                     V = 8   # The V-dimension ("view").
+            Specify the number of cores the tiles are decoded and composited on with cores.
+                    cores = 3 # use 3 cores
+            Abandon the read with cancel and timeout, as read_image.
 
         Returns
         -------
@@ -599,38 +1475,242 @@ class CziFile(object):
         """
         plane_constraints = self._get_coords_from_kwargs(kwargs)
 
-        if region is None:
-            region = self.czilib.BBox()
-            region.w = -1
-            region.h = -1
-        else:
-            assert len(region) == 4
-            tmp = self.czilib.BBox()
-            tmp.x = region[0]
-            tmp.y = region[1]
-            tmp.w = region[2]
-            tmp.h = region[3]
-            region = tmp
-
-        if background_color is None:
-            background_color = self.czilib.RgbFloat()
-            background_color.r = 0.0
-            background_color.g = 0.0
-            background_color.b = 0.0
-        else:
-            assert len(background_color) == 3
-            tmp = self.czilib.RgbFloat()
-            tmp.r = background_color[0]
-            tmp.g = background_color[1]
-            tmp.b = background_color[2]
-            background_color = tmp
+        region = self._get_bbox(region)
+        background_color = self._get_background_color(background_color)
 
+        cores = self._get_cores_from_kwargs(kwargs)
         img = self.reader.read_mosaic(
-            plane_constraints, scale_factor, region, background_color
+            plane_constraints, scale_factor, region, background_color, cores, out
         )
 
         return img
 
+    @_cancellable
+    def read_mosaic_progressive(
+        self,
+        region: Tuple = None,
+        scale_factor: float = 1.0,
+        callback=None,
+        background_color: Tuple = None,
+        out=None,
+        **kwargs,
+    ):
+        """
+        Reads a mosaic as read_mosaic but hands the image to callback while it is being drawn, so a viewer can show
+        some of the region long before the whole composite is done. If the file stores a pyramid layer coarser than
+        scale_factor needs the region is first drawn from the coarsest layer, scaled up, then the full resolution
+        tiles replace it in batches spread over the whole region.
+
+        **Example:** Show a region as it's refined
+
+            czi = CziFile(filename)
+            img = czi.read_mosaic_progressive(
+                region=(x, y, w, h), callback=lambda image, drawn, tiles: viewer.show(image), C=0
+            )
+
+        Parameters
+        ----------
+        region
+            The (x0, y0, width, height) bounding box as for read_mosaic.
+        scale_factor
+            The scale factor as for read_mosaic.
+        callback
+            Called as callback(image, drawn, tiles) on the calling thread with the array being refined, after the
+            preview (drawn is 0) and after each batch. drawn is the number of full resolution tiles drawn of the
+            tiles of the region, the last call has drawn == tiles. No tiles are decoded while it runs, copy the image
+            if it's to be kept. An exception it raises stops the read.
+        background_color
+            The background color as for read_mosaic.
+        out
+            A preallocated array to write the image into as for read_mosaic, callback is then given it.
+        kwargs
+            The dimension constraints, cores, cancel and timeout as for read_mosaic.
+
+        Returns
+        -------
+        numpy.ndarray
+            (1, height, width), the image read_mosaic returns
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+
+        region = self._get_bbox(region)
+        background_color = self._get_background_color(background_color)
+
+        cores = self._get_cores_from_kwargs(kwargs)
+        return self.reader.read_mosaic_progressive(
+            plane_constraints, scale_factor, region, background_color, cores, callback, out
+        )
+
+    def prefetch_mosaic(
+        self,
+        region: Tuple = None,
+        scale_factor: float = 1.0,
+        decode: bool = True,
+        **kwargs,
+    ):
+        """
+        Start reading the tiles read_mosaic composites for the same region, scale_factor and kwargs in the
+        background and return at once, eg the neighbouring regions of the one a viewer shows. See prefetch_image.
+
+        Parameters
+        ----------
+        region
+            The (x0, y0, width, height) bounding box as for read_mosaic.
+        scale_factor
+            The scale factor as for read_mosaic, the pyramid layer read_mosaic would use for it is prefetched.
+        decode
+            Decode the tiles into the tile cache as well, see prefetch_image.
+        kwargs
+            The dimension constraints and cores as for prefetch_image.
+
+        Returns
+        -------
+        Prefetch
+            See prefetch_image.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        region = self._get_bbox(region)
+        cores = kwargs.get("cores", 1)
+        return self.reader.prefetch_mosaic(
+            plane_constraints, scale_factor, region, decode, cores
+        )
+
+    @_cancellable
+    def read_mosaic_planes(
+        self,
+        region: Tuple = None,
+        scale_factor: float = 1.0,
+        background_color: Tuple = None,
+        out=None,
+        **kwargs,
+    ):
+        """
+        Reads the mosaic of several planes in one call, eg every channel of a slide scan, and returns them stacked
+        into one array. The tiles of all the planes are read and decoded together so this is faster than calling
+        read_mosaic for each plane.
+
+        **Example:** Read channels 0 and 1 of every Z-slice at 1/10th the size
+
+            czi = CziFile(filename)
+            img, shape = czi.read_mosaic_planes(scale_factor=0.1, C=[0, 1], Z=None)
+            # shape = [('C', 2), ('Z', 5), ('Y', 1024), ('X', 2048)]
+
+        Parameters
+        ----------
+        region
+            A bounding box specifying the extraction box (x0, y0, width, height) specified in pixels, the same for
+            every plane.
+        scale_factor
+            The amount to scale the data by, see read_mosaic.
+        background_color
+            Background color used when pixel is outside of a subblock, see read_mosaic.
+        out
+            A preallocated writable C-contiguous numpy.ndarray to write the images into, it must have exactly the
+            shape and dtype that would be returned without it. If given it is returned. A file path gives a
+            numpy.memmap of that file, see read_image.
+        kwargs
+            The dimensions of the planes, as for read_mosaic but each value can also be a list or range of values
+            or None for every value in the file. The planes read are every combination of the values, C must be
+            given. ::
+                    C = [0, 2]    # channels 0 and 2
+                    Z = range(4)  # the first 4 Z-slices
+                    T = None      # every time-point
+            Specify the number of cores the tiles are decoded and composited on with cores.
+                    cores = 3 # use 3 cores
+            Abandon the read with cancel and timeout, as read_image.
+
+        Returns
+        -------
+        (numpy.ndarray, [Dimension, Size])
+            a tuple of (numpy.ndarray, a list of (Dimension, size)) as read_image returns, the Dimensions are in
+            the same order as read_image would return them and there is no M Dimension.
+        """
+        values = {}
+        for dim, value in kwargs.items():
+            if dim not in CziFile.ZISRAW_DIMS:
+                continue
+            if value is None:
+                start, end = self.get_dims_shape()[0][dim]
+                value = range(start, end)
+            elif isinstance(value, numbers.Integral):
+                value = [value]
+            values[dim] = [int(v) for v in value]
+
+        planes = []
+        for combination in itertools.product(*values.values()):
+            plane = self.czilib.DimCoord()
+            for dim, value in zip(values.keys(), combination):
+                plane.set_dim(dim, value)
+            planes.append(plane)
+
+        region = self._get_bbox(region)
+        background_color = self._get_background_color(background_color)
+        cores = self._get_cores_from_kwargs(kwargs)
+        image, shape = self.reader.read_mosaic_planes(
+            planes, scale_factor, region, background_color, cores, out
+        )
+        return image, shape
+
+    @_cancellable
+    def read_mosaic_tiles(self, m_indices: Union[List[int], None] = None, **kwargs):
+        """
+        Reads a batch of the tiles of a mosaic file as they are stored, without compositing them, eg for the
+        chunks of a dask array over a mosaic. The tiles are found with one lookup of the subblock directory and
+        decoded in parallel into one array, so this is much faster than a read_image(M=i) per tile.
+
+        **Example:**
+
+            czi = CziFile(filename)
+            tiles, shape, m_indices, boxes = czi.read_mosaic_tiles([0, 1, 2, 3], C=0, cores=8)
+            # shape = [('M', 4), ('Y', 256), ('X', 256)], boxes[i] = (x, y, w, h) of tiles[i] in the mosaic
+
+        Parameters
+        ----------
+        m_indices
+            The M indexes of the tiles, by default every tile of the plane. The tiles are returned by ascending M
+            index and an index given twice is read once.
+        **kwargs
+            The dimension constraints of the plane but M, every dimension of the file but M must be given so each M
+            index is one tile. cores, rgb, dtype, window, cancel and timeout as in read_image.
+
+        Returns
+        -------
+        (numpy.ndarray, [Dimension, Size], numpy.ndarray, numpy.ndarray)
+            The tiles shaped (M, Y, X[, A]), their dimensions, their M indexes and their bounding boxes, an array of
+            shape (tiles, 4) of x, y, w, h in the coordinates of get_mosaic_bounding_box. The tiles must all be the
+            same size, read the tiles of each size separately if they aren't.
+        """
+        plane_constraints = self._get_coords_from_kwargs(kwargs)
+        cores = self._get_cores_from_kwargs(kwargs)
+        rgb, dtype, window = self._get_conversion_from_kwargs(kwargs)
+        m_indices = [] if m_indices is None else [int(m_index) for m_index in m_indices]
+        return self.reader.read_mosaic_tiles(plane_constraints, m_indices, cores, rgb, dtype, window)
+
+    def _get_background_color(self, background_color):
+        # (r, g, b) to an RgbFloat, None is black
+        if background_color is None:
+            background_color = (0.0, 0.0, 0.0)
+        assert len(background_color) == 3
+        color = self.czilib.RgbFloat()
+        color.r = background_color[0]
+        color.g = background_color[1]
+        color.b = background_color[2]
+        return color
+
+    def _get_bbox(self, region):
+        # (x0, y0, w, h) to a BBox, None is the { 0, 0, -1, -1 } box libCZI reads as everything
+        bbox = self.czilib.BBox()
+        if region is None:
+            bbox.w = -1
+            bbox.h = -1
+        else:
+            assert len(region) == 4
+            bbox.x = region[0]
+            bbox.y = region[1]
+            bbox.w = region[2]
+            bbox.h = region[3]
+        return bbox
+
     def _get_coords_from_kwargs(self, kwargs):
         plane_constraints = self.czilib.DimCoord()
         [
@@ -650,6 +1730,40 @@ class CziFile(object):
             m_index = kwargs.get("M")
         return m_index
 
+    @staticmethod
+    def _get_conversion_from_kwargs(kwargs):
+        rgb = bool(kwargs.get("rgb", False))
+        dtype = kwargs.get("dtype")
+        dtype = "" if dtype is None else np.dtype(dtype).name
+        if dtype not in ("", "uint8", "float32"):
+            raise ValueError(f"dtype must be numpy.uint8 or numpy.float32, not {dtype}.")
+        window = kwargs.get("window")
+        window = (0.0, 0.0) if window is None else (float(window[0]), float(window[1]))
+        if window[0] > window[1]:
+            raise ValueError(f"window must be (low, high), not {window}.")
+        return rgb, dtype, window
+
+    @staticmethod
+    def _get_statistics_from_kwargs(kwargs):
+        statistics = kwargs.get("statistics")
+        statistics = "" if statistics is None else statistics
+        if statistics not in ("", "plane", "channel"):
+            raise ValueError(f"statistics must be plane or channel, not {statistics}.")
+        bins = int(kwargs.get("histogram_bins", 256))
+        if bins < 1:
+            raise ValueError(f"histogram_bins must be at least 1, not {bins}.")
+        histogram_range = kwargs.get("histogram_range")
+        histogram_range = (
+            (0.0, 0.0)
+            if histogram_range is None
+            else (float(histogram_range[0]), float(histogram_range[1]))
+        )
+        if histogram_range[0] > histogram_range[1]:
+            raise ValueError(
+                f"histogram_range must be (low, high), not {histogram_range}."
+            )
+        return statistics, bins, histogram_range
+
     @staticmethod
     def _get_cores_from_kwargs(kwargs):
         cores = multiprocessing.cpu_count() - 1
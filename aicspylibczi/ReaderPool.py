@@ -0,0 +1,92 @@
+# A pool of open CZI files sharing a tile cache and the IO bandwidth, for jobs that work through many files.
+
+from .CziFile import CziFile
+from . import types
+
+
+class ReaderPool(object):
+    """The open files of a job that works through many CZI files, eg the wells of a plate screen.
+
+    The most recently used files are kept open so opening a file again doesn't read its directories again, and the
+    least recently used are closed to keep at most max_open_files open. A file held by a CziFile is never closed.
+    The files share one decoded subblock cache and one IO scheduler, which bounds the reads in flight across all the
+    files and takes turns between them so a file read with many threads doesn't starve the others.
+
+    **Example:**
+
+        pool = ReaderPool(max_open_files=128, tile_cache_bytes=1 << 30, io_slots=8)
+        for well in wells:
+            image, shape = pool.open(well).read_image(C=0)
+
+    Args:
+      |  max_open_files (int): The files kept open.
+      |  tile_cache_bytes (int): The budget of the decoded subblock cache the files share, 0 disables it.
+      |  io_slots (int): The reads allowed in flight at once over all the files.
+      |  memory_map (bool): Memory map the files instead of reading them with positional reads, see CziFile.
+    """
+
+    def __init__(
+        self, max_open_files: int = 64, tile_cache_bytes: int = 0, io_slots: int = 4, memory_map: bool = False
+    ):
+        import _aicspylibczi
+
+        self._pool = _aicspylibczi.ReaderPool(
+            max_open_files=max_open_files,
+            tile_cache_bytes=tile_cache_bytes,
+            io_slots=io_slots,
+            memory_map=memory_map,
+        )
+
+    def open(self, czi_filename: types.PathLike, verbose: bool = False) -> CziFile:
+        """
+        A CziFile of the file, opened through the pool. Any number of threads can read from it.
+
+        Parameters
+        ----------
+        czi_filename
+            The path of the file.
+        verbose
+            See CziFile.
+
+        Returns
+        -------
+        CziFile
+        """
+        return CziFile(czi_filename, verbose=verbose, pool=self)
+
+    def reader(self, file_name: str):
+        """
+        The compiled Reader of a file, CziFile uses it. file_name must be an absolute path so that each file is
+        opened once.
+        """
+        return self._pool.reader(file_name)
+
+    def clear(self):
+        """
+        Close every file no CziFile holds.
+        """
+        self._pool.clear()
+
+    @property
+    def max_open_files(self) -> int:
+        return self._pool.max_open_files
+
+    @property
+    def statistics(self):
+        """
+        Returns
+        -------
+        ReaderPoolStatistics
+            An object with the opens, hits, evictions and open counts of the pool.
+        """
+        return self._pool.statistics()
+
+    @property
+    def tile_cache_statistics(self):
+        """
+        Returns
+        -------
+        TileCacheStatistics
+            The hits, misses, tiles, bytes and byte_budget of the cache the files share.
+        """
+        return self._pool.tile_cache_statistics()
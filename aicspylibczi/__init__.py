@@ -1,3 +1,5 @@
-__all__ = ["CziFile"]
+__all__ = ["CancelToken", "CziFile", "ReaderPool"]
+from .CancelToken import CancelToken
 from .CziFile import CziFile
+from .ReaderPool import ReaderPool
 from ._version import __version__  # noqa F401
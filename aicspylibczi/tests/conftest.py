@@ -2,10 +2,80 @@
 # -*- coding: utf-8 -*-
 
 from pathlib import Path
+import struct
 
+import numpy as np
 import pytest
 
 
 @pytest.fixture
 def data_dir() -> Path:
     return Path(__file__).parent / "resources"
+
+
+# libCZI's PixelType values and the numpy dtype and samples of each pixel type write_czi can write
+_PIXEL_TYPES = {
+    "Gray16": (1, np.uint16, 1),
+    "Gray64ComplexFloat": (10, np.complex64, 1),
+    "Bgr192ComplexFloat": (11, np.complex64, 3),
+}
+
+
+def _segment(sid, data):
+    # a segment is padded to a multiple of 32 bytes like ZEN pads them
+    allocated = (len(data) + 31) // 32 * 32
+    header = sid.ljust(16, b"\0") + struct.pack("<qq", allocated, len(data))
+    return header + data + b"\0" * (allocated - len(data))
+
+
+def _directory_entry(pixel_type, file_position, dimensions):
+    entry = struct.pack("<2siqiiB5xi", b"DV", pixel_type, file_position, 0, 0, 0, len(dimensions))
+    for name, start, size, stored_size in dimensions:
+        entry += struct.pack("<c3xiifi", name.encode(), start, size, 0.0, stored_size)
+    return entry
+
+
+@pytest.fixture
+def write_czi(tmp_path):
+    """
+    Write a small uncompressed CZI file with a subblock for each C, the pixels are given as an array of C, Y, X and
+    for the Bgr types the samples. The layout is the one c_benchmarks/SyntheticCzi.cpp writes.
+    """
+
+    def write(pixel_type_name, pixels):
+        pixel_type, dtype, _ = _PIXEL_TYPES[pixel_type_name]
+        pixels = np.ascontiguousarray(pixels, dtype=dtype)
+        height, width = pixels.shape[1:3]
+        file_header = _segment(b"ZISRAWFILE", bytes(512))
+        contents = bytearray(file_header)
+        entries = []
+        for c in range(pixels.shape[0]):
+            dimensions = [("X", 0, width, width), ("Y", 0, height, height), ("C", c, 1, 1)]
+            entry = _directory_entry(pixel_type, len(contents), dimensions)
+            data = pixels[c].tobytes()
+            header = struct.pack("<iiq", 0, 0, len(data)) + entry
+            header = header.ljust(max(256, len(header)), b"\0")
+            contents += _segment(b"ZISRAWSUBBLOCK", header + data)
+            entries.append(entry)
+        directory_position = len(contents)
+        directory = struct.pack("<i", len(entries)).ljust(128, b"\0") + b"".join(entries)
+        contents += _segment(b"ZISRAWDIRECTORY", directory)
+        metadata_position = len(contents)
+        xml = (
+            f"<ImageDocument><Metadata><Information><Image><PixelType>{pixel_type_name}</PixelType>"
+            f"<SizeX>{width}</SizeX><SizeY>{height}</SizeY><SizeC>{pixels.shape[0]}</SizeC>"
+            "</Image></Information></Metadata></ImageDocument>"
+        ).encode()
+        contents += _segment(b"ZISRAWMETADATA", struct.pack("<i", len(xml)).ljust(256, b"\0") + xml)
+
+        # version 1.0, the primary file GUID and the file GUID are the same for a single part file
+        guid = bytes(range(1, 17))
+        fields = struct.pack("<ii8x16s16si", 1, 0, guid, guid, 0) + struct.pack(
+            "<qqiq", directory_position, metadata_position, 0, 0
+        )
+        contents[32 : 32 + len(fields)] = fields
+        path = tmp_path / f"{pixel_type_name}.czi"
+        path.write_bytes(bytes(contents))
+        return path
+
+    return write
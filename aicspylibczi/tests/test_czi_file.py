@@ -1,11 +1,20 @@
+from concurrent.futures import ThreadPoolExecutor
+import gc
 import io
+import json
+import mmap
+from multiprocessing import shared_memory
+from pathlib import Path
 import numpy as np
 import pytest
 import xml.etree.ElementTree as ET
 
 
-from aicspylibczi import CziFile
+from aicspylibczi import CancelToken, CziFile, ReaderPool
 from _aicspylibczi import PylibCZI_CDimCoordinatesOverspecifiedException
+from _aicspylibczi import PylibCZI_CDimCoordinatesUnderspecifiedException
+from _aicspylibczi import PylibCZI_ReadCancelledException
+from _aicspylibczi import PylibCZI_RegionSelectionException
 
 
 @pytest.mark.parametrize(
@@ -30,10 +39,8 @@ def test_is_a_directory(data_dir, as_string):
             io.BytesIO(b"thisisatestletsseewhathappens"),
             io.BytesIO(b"thisisatestletsseewhathappens"),
         ),
-        (
-            b"thisisatestletsseewhathappens",
-            io.BytesIO(b"thisisatestletsseewhathappens"),
-        ),
+        (b"thisisatestletsseewhathappens", b""),
+        (memoryview(b"thisisatestletsseewhathappens"), memoryview(b"")),
         (np.zeros(5), np.zeros(5)),
     ],
 )
@@ -87,6 +94,26 @@ def test_metadata(data_dir, fname, xp_query, expected):
     assert int(vs.text) == expected
 
 
+def test_meta_xml(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    xml = czi.meta_xml
+    assert xml.readonly
+    assert bytes(xml[:15]) == b"<ImageDocument>"
+    # read_meta is libCZI's serialization of the same document
+    assert czi.reader.read_meta().startswith('<?xml version="1.0"?>')
+    assert int(ET.fromstring(xml).find(".//SizeC").text) == 3
+
+
+def test_meta_summary(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    summary = czi.get_meta_summary()
+    assert summary["scale"]["X"] == pytest.approx(1.0833333333333333e-06)
+    assert summary["scale"]["Z"] == pytest.approx(1e-06)
+    assert summary["channel_names"] == ["EGFP", "TaRFP", "Bright"]
+    assert summary["acquisition_time"] == "2019-06-27T18:39:25.8078869Z"
+    assert CziFile(str(data_dir / "s_1_t_1_c_1_z_1.czi")).get_meta_summary()["scale"]["Z"] is None
+
+
 @pytest.mark.parametrize(
     "fname, expected_img_shape, expected_img_dims",
     [
@@ -526,3 +553,786 @@ def test_bgr_plane_data_x(data_dir, fname, p_index, ans_file):
         img, dims = czi.read_image()
         assert img[0, :, :, p_index].shape == ans.shape
         np.testing.assert_array_almost_equal(img[0, :, :, p_index], ans)
+
+
+@pytest.mark.parametrize(
+    "fname, n_threads",
+    [("s_3_t_1_c_3_z_5.czi", 4), ("mosaic_test.czi", 4)],
+)
+def test_threaded_reads(data_dir, fname, n_threads):
+    from concurrent.futures import ThreadPoolExecutor
+
+    expected, _ = CziFile(str(data_dir / fname)).read_image()
+
+    def read(_):
+        img, _ = CziFile(str(data_dir / fname)).read_image()
+        return img
+
+    with ThreadPoolExecutor(max_workers=n_threads) as pool:
+        results = list(pool.map(read, range(n_threads)))
+    for img in results:
+        np.testing.assert_array_equal(img, expected)
+
+
+@pytest.mark.parametrize("fname", ["s_3_t_1_c_3_z_5.czi", "mosaic_test.czi"])
+def test_memory_mapped_read(data_dir, fname):
+    expected, expected_dims = CziFile(str(data_dir / fname)).read_image()
+    img, dims = CziFile(data_dir / fname, memory_map=True).read_image()
+    assert dims == expected_dims
+    np.testing.assert_array_equal(img, expected)
+
+
+@pytest.mark.raises(exception=TypeError)
+def test_memory_mapped_bytes(data_dir):
+    with open(data_dir / "s_1_t_1_c_1_z_1.czi", "rb") as fp:
+        CziFile(fp.read(), memory_map=True)
+
+
+class PreadFile:
+    """A file only readable with pread, like the files of an object store client"""
+
+    def __init__(self, path):
+        self.data = path.read_bytes()
+        self.reads = 0
+
+    def pread(self, size, offset):
+        self.reads += 1
+        return self.data[offset : offset + size]
+
+
+@pytest.mark.parametrize("fname", ["s_3_t_1_c_3_z_5.czi", "mosaic_test.czi"])
+def test_read_python_stream(data_dir, fname):
+    expected, expected_dims = CziFile(str(data_dir / fname)).read_image()
+    img, dims = CziFile(io.BytesIO((data_dir / fname).read_bytes())).read_image()
+    assert dims == expected_dims
+    np.testing.assert_array_equal(img, expected)
+
+    source = PreadFile(data_dir / fname)
+    img, dims = CziFile(source).read_image()
+    assert dims == expected_dims
+    np.testing.assert_array_equal(img, expected)
+    assert source.reads <= len(source.data) // (1 << 20) + 8  # block reads, not one per libCZI read
+
+
+@pytest.mark.parametrize("fname", ["s_3_t_1_c_3_z_5.czi", "mosaic_test.czi"])
+def test_read_memory_buffer(data_dir, fname):
+    expected, expected_dims = CziFile(str(data_dir / fname)).read_image()
+    data = (data_dir / fname).read_bytes()
+    shared = shared_memory.SharedMemory(create=True, size=len(data))
+    try:
+        shared.buf[: len(data)] = data
+        sources = [data, bytearray(data), memoryview(data), np.frombuffer(data, dtype=np.uint8), shared.buf]
+        for source in sources:
+            czi = CziFile(source)
+            img, dims = czi.read_image(cores=4)
+            assert dims == expected_dims
+            np.testing.assert_array_equal(img, expected)
+            del czi
+        with open(data_dir / fname, "rb") as fp, mmap.mmap(fp.fileno(), 0, access=mmap.ACCESS_READ) as mapped:
+            czi = CziFile(mapped)
+            img, _ = czi.read_image()
+            np.testing.assert_array_equal(img, expected)
+            del czi  # the mapping can't be closed while it's exported
+    finally:
+        gc.collect()
+        shared.close()
+        shared.unlink()
+
+
+def test_read_memory_buffer_holds_export(data_dir):
+    source = bytearray((data_dir / "s_1_t_1_c_1_z_1.czi").read_bytes())
+    czi = CziFile(source)
+    with pytest.raises(BufferError):
+        source.extend(b"0")  # the reader holds the buffer
+    czi.read_image()
+    del czi
+    gc.collect()
+    source.extend(b"0")
+
+
+@pytest.mark.parametrize("fname", ["s_3_t_1_c_3_z_5.czi", "mosaic_test.czi"])
+def test_index_file(data_dir, tmp_path, fname):
+    expected, expected_dims = CziFile(str(data_dir / fname)).read_image()
+    index_file = tmp_path / "index.idx"
+    for _ in range(2):  # the first open writes the index, the second reads it
+        czi = CziFile(data_dir / fname, index_file=index_file)
+        assert index_file.exists()
+        img, dims = czi.read_image()
+        assert dims == expected_dims
+        np.testing.assert_array_equal(img, expected)
+
+
+def test_default_index_file(tmp_path, monkeypatch):
+    monkeypatch.setenv("XDG_CACHE_HOME", str(tmp_path))
+    index_file = Path(CziFile.default_index_file("a.czi"))
+    assert index_file.parent == tmp_path / "aicspylibczi"
+    assert index_file.parent.is_dir()
+    assert CziFile.default_index_file("b.czi") != str(index_file)
+
+
+@pytest.mark.parametrize(
+    "fname", ["s_3_t_1_c_3_z_5.czi", "mosaic_test.czi", "RGB-8bit.czi"]
+)
+def test_read_image_into_out(data_dir, fname):
+    czi = CziFile(str(data_dir / fname))
+    expected, expected_dims = czi.read_image()
+    out = np.zeros_like(expected)
+    img, dims = czi.read_image(out=out)
+    assert img is out
+    assert dims == expected_dims
+    np.testing.assert_array_equal(out, expected)
+
+
+@pytest.mark.parametrize("pixel_type, samples", [("Gray64ComplexFloat", ()), ("Bgr192ComplexFloat", (3,))])
+def test_read_complex_into_out(write_czi, tmp_path, pixel_type, samples):
+    shape = (2, 3, 4) + samples  # C, Y, X and the samples of the Bgr type
+    pixels = (np.arange(np.prod(shape)) + 1j * -np.arange(np.prod(shape))).reshape(shape).astype(np.complex64)
+    czi = CziFile(str(write_czi(pixel_type, pixels)))
+    expected, expected_dims = czi.read_image()
+    assert expected.dtype == np.complex64
+    np.testing.assert_array_equal(expected.reshape(shape), pixels)
+
+    out = np.zeros_like(expected)
+    img, dims = czi.read_image(out=out)
+    assert img is out
+    assert dims == expected_dims
+    np.testing.assert_array_equal(out, expected)
+
+    img, dims = czi.read_image(out=tmp_path / "image.raw")
+    assert isinstance(img, np.memmap)
+    assert img.dtype == np.complex64
+    np.testing.assert_array_equal(img, expected)
+
+
+@pytest.mark.parametrize(
+    "out",
+    [
+        pytest.param(
+            np.zeros((1, 1, 325, 475), dtype=np.uint8),
+            marks=pytest.mark.raises(exception=Exception),
+        ),
+        pytest.param(
+            np.zeros((1, 1, 475, 325), dtype=np.uint16),
+            marks=pytest.mark.raises(exception=ValueError),
+        ),
+        pytest.param(
+            np.zeros((1, 1, 475, 325), dtype=np.uint16).transpose(0, 1, 3, 2),
+            marks=pytest.mark.raises(exception=ValueError),
+        ),
+    ],
+)
+def test_read_image_bad_out(data_dir, out):
+    czi = CziFile(str(data_dir / "s_1_t_1_c_1_z_1.czi"))
+    czi.read_image(out=out)
+
+
+@pytest.mark.parametrize("fname", ["s_1_t_1_c_1_z_1.czi", "s_3_t_1_c_3_z_5.czi"])
+def test_read_image_roi(data_dir, fname):
+    czi = CziFile(str(data_dir / fname))
+    full, full_dims = czi.read_image()
+    img, dims = czi.read_image(roi=(10, 20, 30, 40))
+    assert dims[:-2] == full_dims[:-2]
+    assert dims[-2:] == [("Y", 40), ("X", 30)]
+    np.testing.assert_array_equal(img, full[..., 20:60, 10:40])
+
+    out = np.zeros_like(img)
+    czi.read_image(roi=(10, 20, 30, 40), out=out)
+    np.testing.assert_array_equal(out, img)
+
+
+@pytest.mark.raises(exception=PylibCZI_RegionSelectionException)
+def test_read_image_bad_roi(data_dir):
+    czi = CziFile(str(data_dir / "s_1_t_1_c_1_z_1.czi"))
+    czi.read_image(roi=(470, 0, 10, 10))
+
+
+def test_read_image_converted(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    source, source_dims = czi.read_image(S=1, C=2)
+    img, dims = czi.read_image(S=1, C=2, dtype=np.uint8, window=(100, 1100))
+    assert img.dtype == np.uint8
+    assert dims == source_dims
+    expected = np.clip((source.astype(np.float64) - 100) * 255 / 1000, 0, 255)
+    assert np.abs(img - expected).max() <= 1
+
+    normalized, _ = czi.read_image(S=1, C=2, dtype=np.float32)
+    np.testing.assert_allclose(normalized, source / 65535.0, rtol=1e-6)
+    out = np.zeros_like(normalized)
+    czi.read_image(S=1, C=2, dtype=np.float32, out=out)
+    np.testing.assert_array_equal(out, normalized)
+
+
+@pytest.mark.parametrize(
+    "kwargs",
+    [
+        pytest.param({"dtype": np.int16}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param({"dtype": np.uint8, "window": (10, 5)}, marks=pytest.mark.raises(exception=ValueError)),
+    ],
+)
+def test_read_image_bad_conversion(data_dir, kwargs):
+    czi = CziFile(str(data_dir / "s_1_t_1_c_1_z_1.czi"))
+    czi.read_image(**kwargs)
+
+
+@pytest.mark.parametrize(
+    "projection, reduce",
+    [("max", np.max), ("mean", np.mean), ("sum", np.sum)],
+)
+def test_read_image_projection(data_dir, projection, reduce):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    stack, dims = czi.read_image(S=1)
+    img, projected_dims = czi.read_image(S=1, projection=projection, cores=4)
+    z = [d for d, _ in dims].index("Z")
+    assert projected_dims == [d for d in dims if d[0] != "Z"]
+    np.testing.assert_allclose(img, reduce(stack, axis=z))
+
+    roi, _ = czi.read_image(S=1, projection=projection, roi=(10, 20, 30, 40))
+    np.testing.assert_array_equal(roi, img[..., 20:60, 10:40])
+    out = np.zeros_like(img)
+    czi.read_image(S=1, projection=projection, out=out)
+    np.testing.assert_array_equal(out, img)
+
+
+@pytest.mark.parametrize(
+    "kwargs",
+    [
+        pytest.param({"projection": "median"}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param({"projection": "max", "dtype": np.uint8}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param(
+            {"projection": "max", "projection_dim": "T"},
+            marks=pytest.mark.raises(exception=PylibCZI_CDimCoordinatesOverspecifiedException),
+        ),
+    ],
+)
+def test_read_image_bad_projection(data_dir, kwargs):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    czi.read_image(S=0, **kwargs)
+
+
+@pytest.mark.parametrize("mode, reduce", [("mean", np.mean), ("max", np.max)])
+def test_read_image_binning(data_dir, mode, reduce):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    stack, dims = czi.read_image(S=0)  # B S C Z Y X, 5 Z of 325 x 475
+    img, binned_dims = czi.read_image(S=0, binning={"X": 4, "Y": 4, "Z": 2}, binning_mode=mode)
+    assert binned_dims == [("B", 1), ("S", 1), ("C", 3), ("Z", 3), ("Y", 81), ("X", 118)]
+
+    cropped = stack[..., : 81 * 4, : 118 * 4].reshape(1, 1, 3, 5, 81, 4, 118, 4)
+    for z in range(3):
+        expected = reduce(cropped[:, :, :, 2 * z : 2 * z + 2], axis=(3, 5, 7))
+        np.testing.assert_allclose(img[:, :, :, z], expected)
+
+    out = np.zeros_like(img)
+    czi.read_image(S=0, binning={"X": 4, "Y": 4, "Z": 2}, binning_mode=mode, out=out)
+    np.testing.assert_array_equal(out, img)
+
+
+@pytest.mark.parametrize(
+    "kwargs",
+    [
+        pytest.param({"binning": {"T": 2}}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param({"binning": {"X": 0}}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param({"binning": {"X": 1000}}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param(
+            {"binning": {"X": 2}, "projection": "max"}, marks=pytest.mark.raises(exception=ValueError)
+        ),
+    ],
+)
+def test_read_image_bad_binning(data_dir, kwargs):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    czi.read_image(S=0, **kwargs)
+
+
+def test_read_image_statistics(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    expected, dims = czi.read_image(S=1)
+    img, stats_dims, stats = czi.read_image(S=1, statistics="plane")
+    np.testing.assert_array_equal(img, expected)
+    assert stats["dims"] == [("B", 1), ("S", 1), ("C", 3), ("Z", 5)]
+    np.testing.assert_array_equal(stats["min"], expected.min(axis=(-2, -1)))
+    np.testing.assert_array_equal(stats["max"], expected.max(axis=(-2, -1)))
+    np.testing.assert_array_equal(stats["sum"], expected.sum(axis=(-2, -1), dtype=np.float64))
+    assert stats["histogram"].shape == (1, 1, 3, 5, 256)
+    assert stats["bin_edges"][-1] == 65536
+    histogram = np.histogram(expected[0, 0, 1, 2], bins=256, range=(0, 65536))[0]
+    np.testing.assert_array_equal(stats["histogram"][0, 0, 1, 2], histogram)
+
+    # the statistics are of the converted images
+    img, _, stats = czi.read_image(S=1, dtype=np.uint8, window=(100, 1100), statistics="channel")
+    assert stats["dims"] == [("C", 3)]
+    np.testing.assert_array_equal(stats["max"], img.max(axis=(0, 1, 3, 4, 5)))
+    np.testing.assert_array_equal(stats["histogram"].sum(axis=-1), stats["count"])
+
+
+def test_read_statistics(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    img, _ = czi.read_image(S=0, roi=(10, 20, 30, 40))
+    stats = czi.read_statistics(S=0, roi=(10, 20, 30, 40), histogram_bins=16, histogram_range=(0, 1600))
+    assert stats["dims"] == [("C", 3)]
+    np.testing.assert_array_equal(stats["count"], [5 * 30 * 40] * 3)
+    np.testing.assert_array_equal(stats["sum"], img.sum(axis=(0, 1, 3, 4, 5), dtype=np.float64))
+    np.testing.assert_allclose(
+        stats["sum_of_squares"], (img.astype(np.float64) ** 2).sum(axis=(0, 1, 3, 4, 5))
+    )
+    for c in range(3):
+        histogram = np.histogram(np.clip(img[0, 0, c], 0, 1599), bins=16, range=(0, 1600))[0]
+        np.testing.assert_array_equal(stats["histogram"][c], histogram)
+
+
+@pytest.mark.parametrize(
+    "kwargs",
+    [
+        pytest.param({"statistics": "tile"}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param({"statistics": "plane", "histogram_bins": 0}, marks=pytest.mark.raises(exception=ValueError)),
+        pytest.param(
+            {"statistics": "plane", "histogram_range": (10, 0)}, marks=pytest.mark.raises(exception=ValueError)
+        ),
+        pytest.param(
+            {"statistics": "plane", "projection": "max"}, marks=pytest.mark.raises(exception=ValueError)
+        ),
+    ],
+)
+def test_read_image_bad_statistics(data_dir, kwargs):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    czi.read_image(S=0, **kwargs)
+
+
+def test_read_mosaic_into_out(data_dir):
+    czi = CziFile(str(data_dir / "mosaic_test.czi"))
+    expected = czi.read_mosaic(scale_factor=0.5, C=0)
+    out = np.zeros_like(expected)
+    img = czi.read_mosaic(scale_factor=0.5, C=0, out=out)
+    assert img is out
+    np.testing.assert_array_equal(out, expected)
+
+
+@pytest.mark.parametrize("scale_factor", [1.0, 0.37])
+def test_read_mosaic_cores(data_dir, scale_factor):
+    czi = CziFile(str(data_dir / "mosaic_test.czi"))
+    serial = czi.read_mosaic(scale_factor=scale_factor, C=0, cores=1)
+    parallel = czi.read_mosaic(scale_factor=scale_factor, C=0, cores=4)
+    np.testing.assert_array_equal(serial, parallel)
+
+
+@pytest.mark.parametrize("prefetch", [0, 2])
+def test_iter_image(data_dir, prefetch):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    expected, _ = czi.read_image(S=0)
+    planes = czi.iter_image("C", prefetch=prefetch, S=0)
+    assert len(planes) == 3
+    images = []
+    for image, shape in planes:
+        assert dict(shape)["C"] == 1
+        assert dict(shape)["Z"] == 5
+        images.append(image)
+    np.testing.assert_array_equal(np.concatenate(images, axis=2), expected)
+
+    one_at_a_time = list(czi.iter_image(prefetch=prefetch, S=0, C=1))
+    assert len(one_at_a_time) == 5
+    np.testing.assert_array_equal(one_at_a_time[3][0][0, 0, 0, 0], expected[0, 0, 1, 3])
+
+
+@pytest.mark.raises(exception=PylibCZI_CDimCoordinatesOverspecifiedException)
+def test_iter_image_bad_dims(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    czi.iter_image("M", S=0)  # not a mosaic file
+
+
+def test_read_images(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    selections = [{"S": 1, "C": 0, "Z": 3}, {"S": 1}, {"S": 2, "C": 1}]
+    images = czi.read_images(selections, cores=2)
+    assert len(images) == 3
+    for (image, shape), selection in zip(images, selections):
+        expected, expected_shape = czi.read_image(**selection)
+        assert shape == expected_shape
+        np.testing.assert_array_equal(image, expected)
+
+    roi = czi.read_images([{"S": 0, "C": 2}], roi=(10, 20, 30, 40))
+    np.testing.assert_array_equal(roi[0][0], czi.read_image(S=0, C=2)[0][..., 20:60, 10:40])
+
+
+def test_read_image_threads(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"), tile_cache_bytes=16 << 20)
+    selections = [{"S": s, "C": c} for s in range(3) for c in range(3)]
+    expected = [czi.read_image(**selection)[0] for selection in selections]
+    with ThreadPoolExecutor(4) as pool:
+        images = list(pool.map(lambda selection: czi.read_image(cores=2, **selection)[0], selections * 4))
+    for i, image in enumerate(images):
+        np.testing.assert_array_equal(image, expected[i % len(selections)])
+
+
+def test_reader_pool(data_dir):
+    pool = ReaderPool(max_open_files=2, tile_cache_bytes=64 << 20)
+    first = pool.open(data_dir / "s_3_t_1_c_3_z_5.czi")
+    image, shape = first.read_image(S=1, C=0)
+    again, again_shape = pool.open(data_dir / "s_3_t_1_c_3_z_5.czi").read_image(S=1, C=0)
+    assert again_shape == shape
+    np.testing.assert_array_equal(again, image)
+    expected, _ = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi")).read_image(S=1, C=0)
+    np.testing.assert_array_equal(image, expected)
+
+    pool.open(data_dir / "s_1_t_1_c_1_z_1.czi")
+    pool.open(data_dir / "mosaic_test.czi").read_mosaic(scale_factor=0.5, C=0)
+    statistics = pool.statistics
+    assert statistics.opens == 3
+    assert statistics.hits == 1
+    assert statistics.evictions == 1  # the s_1 file, first is still held
+    assert statistics.open == 2
+
+
+@pytest.mark.raises(exception=TypeError)
+def test_reader_pool_needs_path(data_dir):
+    with open(data_dir / "s_1_t_1_c_1_z_1.czi", "rb") as fp:
+        ReaderPool().open(fp)
+
+
+@pytest.mark.parametrize("channels", [[0], range(1), None])
+def test_read_mosaic_planes(data_dir, channels):
+    czi = CziFile(str(data_dir / "mosaic_test.czi"))
+    expected = czi.read_mosaic(scale_factor=0.5, C=0)
+    img, shape = czi.read_mosaic_planes(scale_factor=0.5, C=channels)
+    assert shape == [("C", 1), ("Y", expected.shape[1]), ("X", expected.shape[2])]
+    np.testing.assert_array_equal(img, expected)
+
+    out = np.zeros_like(expected)
+    img, _ = czi.read_mosaic_planes(scale_factor=0.5, C=channels, out=out)
+    assert img is out
+    np.testing.assert_array_equal(out, expected)
+
+
+def test_tile_catalog(data_dir):
+    czi = CziFile(str(data_dir / "mosaic_test.czi"))
+    catalog = czi.get_tile_catalog()
+    assert len(catalog["x"]) == 2
+    assert all(len(column) == 2 for column in catalog.values())
+    boxes = czi.get_all_mosaic_tile_bounding_boxes(C=0)
+    for i in range(2):
+        box = boxes[next(tile for tile in boxes if tile.m_index == catalog["M"][i])]
+        assert (catalog["x"][i], catalog["y"][i], catalog["w"][i], catalog["h"][i]) == (box.x, box.y, box.w, box.h)
+    assert list(catalog["pyramid_layer"]) == [0, 0]
+    assert catalog["file_position"].min() > 0
+
+
+def test_read_mosaic_pyramid(data_dir):
+    czi = CziFile(str(data_dir / "Multiscene_CZI_3Scenes.czi"), tile_cache_bytes=64 << 20)
+    layers = czi.get_pyramid_layers()
+    assert [layer.layer for layer in layers] == [0, 1]
+    assert layers[1].minification == pytest.approx(2.0)
+    img = czi.read_mosaic(scale_factor=0.5, C=0)
+    # one pyramid subblock for scenes 0 and 1, scene 2 has no pyramid
+    assert czi.tile_cache_statistics.misses == 3
+    box = czi.get_mosaic_bounding_box()
+    assert img.shape == (1, box.h // 2, box.w // 2)
+
+
+def test_read_mosaic_progressive(data_dir):
+    czi = CziFile(str(data_dir / "Multiscene_CZI_3Scenes.czi"))
+    expected = czi.read_mosaic(C=0)
+    frames = []
+
+    def callback(image, drawn, tiles):
+        frames.append((image.copy(), drawn, tiles))
+
+    img = czi.read_mosaic_progressive(callback=callback, C=0, cores=2)
+    np.testing.assert_array_equal(img, expected)
+    # the preview comes from the pyramid of scenes 0 and 1, then the tiles are drawn over it
+    assert frames[0][1] == 0
+    assert frames[-1][1] == frames[-1][2]
+    assert [drawn for _, drawn, _ in frames] == sorted(drawn for _, drawn, _ in frames)
+    assert frames[0][0].shape == expected.shape
+    np.testing.assert_array_equal(frames[-1][0], expected)
+
+
+def test_read_mosaic_progressive_callback_raises(data_dir):
+    czi = CziFile(str(data_dir / "Multiscene_CZI_3Scenes.czi"))
+
+    def callback(image, drawn, tiles):
+        raise ValueError("seen enough")
+
+    with pytest.raises(ValueError):
+        czi.read_mosaic_progressive(callback=callback, C=0)
+
+
+def test_tile_cache(data_dir):
+    expected = CziFile(str(data_dir / "mosaic_test.czi")).read_mosaic(C=0)
+    czi = CziFile(str(data_dir / "mosaic_test.czi"), tile_cache_bytes=64 << 20)
+    first = czi.read_mosaic(C=0)
+    misses = czi.tile_cache_statistics.misses
+    assert czi.tile_cache_statistics.hits == 0
+    second = czi.read_mosaic(C=0)
+    stats = czi.tile_cache_statistics
+    assert stats.hits > 0
+    assert stats.misses == misses  # everything came from the cache
+    np.testing.assert_array_equal(first, expected)
+    np.testing.assert_array_equal(second, expected)
+
+    image, _ = czi.read_image(C=0)
+    assert czi.tile_cache_statistics.misses == misses
+    czi.set_tile_cache_size(0)
+    assert czi.tile_cache_statistics.bytes == 0
+
+
+def test_read_scenes(data_dir):
+    czi = CziFile(str(data_dir / "Multiscene_CZI_3Scenes.czi"))
+    scenes = czi.read_scenes(C=0, cores=2)
+    assert len(scenes) == 3
+    for s, (image, dims) in enumerate(scenes):
+        expected, expected_dims = czi.read_image(S=s, C=0)
+        assert dims == expected_dims
+        np.testing.assert_array_equal(image, expected)
+
+    stacked, dims, extents = czi.read_scenes(scenes=[2, 0], pad=True, pad_value=7, C=0)
+    assert [dim for dim, _ in dims] == [dim for dim, _ in scenes[0][1]]
+    assert dict(dims)["S"] == 2
+    assert extents.tolist() == [list(scenes[2][0].shape), list(scenes[0][0].shape)]
+    s_axis = [dim for dim, _ in dims].index("S")
+    first = np.take(stacked, [1], axis=s_axis)[tuple(slice(0, size) for size in scenes[0][0].shape)]
+    np.testing.assert_array_equal(first, scenes[0][0])
+
+
+@pytest.mark.raises(exception=PylibCZI_CDimCoordinatesOverspecifiedException)
+def test_read_scenes_bad_scene(data_dir):
+    CziFile(str(data_dir / "Multiscene_CZI_3Scenes.czi")).read_scenes(scenes=[5], C=0)
+
+
+def test_stack_scenes():
+    a = np.ones((1, 2, 3, 4), dtype=np.uint16)
+    b = np.full((1, 1, 5, 2), 2, dtype=np.uint16)
+    stacked, dims, extents = CziFile.stack_scenes(
+        [(a, [("S", 1), ("M", 2), ("Y", 3), ("X", 4)]), (b, [("S", 1), ("M", 1), ("Y", 5), ("X", 2)])]
+    )
+    assert stacked.shape == (2, 2, 5, 4)
+    assert dims == [("S", 2), ("M", 2), ("Y", 5), ("X", 4)]
+    assert extents.tolist() == [[1, 2, 3, 4], [1, 1, 5, 2]]
+    np.testing.assert_array_equal(stacked[0, :2, :3, :4], a[0])
+    assert stacked[0, :, 3:].sum() == 0
+    np.testing.assert_array_equal(stacked[1, :1, :, :2], b[0])
+    assert stacked[1, 1:].sum() == 0
+    with pytest.raises(ValueError):
+        CziFile.stack_scenes([(a, [("S", 1), ("M", 2), ("Y", 3), ("X", 4)]), (b, [("S", 1), ("Z", 1), ("Y", 5)])])
+
+
+def test_read_mosaic_tiles(data_dir):
+    czi = CziFile(str(data_dir / "Multiscene_CZI_3Scenes.czi"))
+    tiles, dims, m_indices, boxes = czi.read_mosaic_tiles(m_indices=[3, 1], S=0, C=0, cores=2)
+    assert tiles.shape == (2, 256, 256)
+    assert dims == [("M", 2), ("Y", 256), ("X", 256)]
+    assert m_indices.tolist() == [1, 3]
+    assert boxes.tolist() == [[495643, 354694, 256, 256], [495412, 354924, 256, 256]]
+    for tile, m_index in zip(tiles, m_indices):
+        expected, _ = czi.read_image(S=0, C=0, M=int(m_index))
+        np.testing.assert_array_equal(tile, expected.reshape(tile.shape))
+
+    tiles, dims, m_indices, boxes = czi.read_mosaic_tiles(S=0, C=0)
+    assert tiles.shape == (4, 256, 256)
+    assert m_indices.tolist() == [0, 1, 2, 3]
+    assert boxes.shape == (4, 4)
+
+
+@pytest.mark.raises(exception=RuntimeError)  # IsNotMosaicException is translated by pybind11
+def test_read_mosaic_tiles_not_mosaic(data_dir):
+    CziFile(str(data_dir / "s_1_t_1_c_1_z_1.czi")).read_mosaic_tiles(C=0)
+
+
+def test_read_cancelled(data_dir):
+    czi = CziFile(str(data_dir / "Multiscene_CZI_3Scenes.czi"))
+    token = CancelToken()
+    expected, _ = czi.read_image(S=0, C=0, cancel=token)
+    token.cancel()
+    assert token.cancelled
+    with pytest.raises(PylibCZI_ReadCancelledException):
+        czi.read_image(S=0, C=0, cancel=token)
+    with pytest.raises(PylibCZI_ReadCancelledException):
+        czi.read_mosaic(scale_factor=0.1, C=0, cancel=token)
+    with pytest.raises(PylibCZI_ReadCancelledException):
+        with czi.cancellable(token):
+            czi.read_mosaic_tiles(S=0, C=0)
+    with pytest.raises(PylibCZI_ReadCancelledException):
+        czi.read_subblock_fields(S=0, C=0, cancel=token)
+    with pytest.raises(PylibCZI_ReadCancelledException):
+        czi.read_image(S=0, C=0, timeout=0)
+    token.reset()
+    with czi.cancellable(token, timeout=60):
+        image, _ = czi.read_image(S=0, C=0)
+    np.testing.assert_array_equal(image, expected)
+
+
+def test_perf_counters(data_dir):
+    czi = CziFile(str(data_dir / "mosaic_test.czi"))
+    czi.read_mosaic(C=0)
+    assert not czi.perf_counters["enabled"]
+    assert czi.perf_counters["read_mosaic"]["calls"] == 0
+
+    czi.enable_perf_counters()
+    czi.read_mosaic(C=0)
+    czi.read_image(C=0)
+    stats = czi.perf_counters
+    assert stats["enabled"]
+    assert stats["read_mosaic"]["calls"] == 1
+    assert stats["read_selected"]["calls"] == 1
+    assert stats["matches"]["calls"] >= 2
+    assert stats["stream_read"]["calls"] > 0
+    assert stats["stream_bytes"] > 0
+    assert stats["copy"]["calls"] > 0
+    assert set(stats["decode"]) <= set(CziFile.COMPRESSION) | {"other"}
+    assert len(stats["worker_utilization"]) == len(stats["worker_busy_ns"])
+    assert sum(stats["worker_busy_ns"]) > 0
+
+    czi.reset_perf_counters()
+    assert czi.perf_counters["stream_bytes"] == 0
+    czi.enable_perf_counters(False)
+    czi.read_image(C=0)
+    assert czi.perf_counters["read_selected"]["calls"] == 0
+
+
+def test_allocation_policy(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    expected, dims = czi.read_image(S=1)
+    expected_mosaic = CziFile(str(data_dir / "mosaic_test.czi")).read_mosaic(C=0)
+    for numa in ["default", "interleave", "first_touch"]:
+        czi.set_allocation_policy(huge_pages=True, numa=numa)
+        image, image_dims = czi.read_image(S=1)
+        assert image_dims == dims
+        np.testing.assert_array_equal(image, expected)
+    mosaic = CziFile(str(data_dir / "mosaic_test.czi"))
+    mosaic.set_allocation_policy(numa="first_touch")
+    np.testing.assert_array_equal(mosaic.read_mosaic(C=0), expected_mosaic)
+
+
+@pytest.mark.raises(exception=ValueError)
+def test_allocation_policy_unknown_numa(data_dir):
+    CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi")).set_allocation_policy(numa="local")
+
+
+def test_allocation_policy_file(data_dir, tmp_path):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    expected, dims = czi.read_image(S=1)
+    czi.set_allocation_policy(file_directory=tmp_path)
+    image, image_dims = czi.read_image(S=1)
+    assert image_dims == dims
+    np.testing.assert_array_equal(image, expected)
+    assert list(tmp_path.iterdir()) == []  # the file was deleted once mapped
+
+
+def test_read_into_memmap(data_dir, tmp_path):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    expected, dims = czi.read_image(S=1)
+    image, image_dims = czi.read_image(S=1, out=tmp_path / "image.raw")
+    assert isinstance(image, np.memmap)
+    assert image_dims == dims
+    np.testing.assert_array_equal(image, expected)
+    del image
+    stored = np.memmap(tmp_path / "image.raw", dtype=expected.dtype, mode="r", shape=expected.shape)
+    np.testing.assert_array_equal(stored, expected)
+
+    mosaic = CziFile(str(data_dir / "mosaic_test.czi"))
+    expected_mosaic = mosaic.read_mosaic(C=0)
+    np.testing.assert_array_equal(mosaic.read_mosaic(C=0, out=str(tmp_path / "mosaic.raw")), expected_mosaic)
+
+
+def test_prefetch(data_dir):
+    expected = CziFile(str(data_dir / "mosaic_test.czi")).read_mosaic(C=0)
+    czi = CziFile(str(data_dir / "mosaic_test.czi"), tile_cache_bytes=64 << 20)
+    pending = czi.prefetch_mosaic(C=0)
+    pending.wait()
+    assert pending.done()
+    assert czi.tile_cache_statistics.misses == 0
+    np.testing.assert_array_equal(czi.read_mosaic(C=0), expected)
+    assert czi.tile_cache_statistics.misses == 0
+
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"), tile_cache_bytes=64 << 20)
+    czi.prefetch_image(S=1, C=2, cores=2).wait()
+    assert czi.tile_cache_statistics.tiles == 5
+    image, _ = czi.read_image(S=1, C=2)
+    assert czi.tile_cache_statistics.misses == 0
+
+
+@pytest.mark.raises(exception=PylibCZI_CDimCoordinatesOverspecifiedException)
+def test_prefetch_bad_dims(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    czi.prefetch_image(C=7)  # checked before the prefetch starts
+
+
+def test_read_subblock_fields(data_dir):
+    czi = CziFile(str(data_dir / "s_1_t_1_c_1_z_1.czi"))
+    fields = czi.read_subblock_fields(
+        ("AcquisitionTime", "StageXPosition", "StageYPosition", "NotATag")
+    )
+    assert fields["subblock_index"].tolist() == [0]
+    assert fields["AcquisitionTime"].dtype == np.dtype("datetime64[us]")
+    assert fields["AcquisitionTime"][0] == np.datetime64("2019-06-27T18:33:41.115421")
+    assert fields["StageXPosition"][0] == pytest.approx(43427.982)
+    assert fields["StageYPosition"][0] == pytest.approx(42720.296)
+    assert np.isnan(fields["NotATag"][0])
+
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    fields = czi.read_subblock_fields(S=0, C=1)
+    assert len(fields["AcquisitionTime"]) == len(czi.read_subblock_metadata(S=0, C=1))
+
+
+def test_read_raw_subblocks(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    subblocks = czi.read_raw_subblocks(S=1, C=2)
+    image, _ = czi.read_image(S=1, C=2)
+    assert len(subblocks) == 5
+    for z, subblock in enumerate(subblocks):
+        assert subblock["dims"]["Z"] == z
+        assert subblock["pixel_type"] == "gray16"
+        assert subblock["compression"] == CziFile.COMPRESSION["uncompressed"]
+        assert subblock["data"].readonly
+        w, h = subblock["physical_size"]
+        pixels = np.frombuffer(subblock["data"], dtype=np.uint16, count=w * h)
+        np.testing.assert_array_equal(pixels.reshape(h, w), image[0, 0, 0, z])
+
+
+def test_read_attachments(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    attachments = czi.get_attachments()
+    assert [a["name"] for a in attachments] == ["EventList", "TimeStamps", "Thumbnail"]
+    assert [a["content_type"] for a in attachments] == ["CZEVL", "CZTIMS", "JPG"]
+    assert [a["size"] for a in attachments] == [8, 16, 1441]
+
+    thumbnail = czi.read_attachment("Thumbnail")
+    assert thumbnail.readonly
+    assert len(thumbnail) == 1441
+    assert bytes(thumbnail[:2]) == b"\xff\xd8"
+    assert bytes(czi.read_attachment(2)) == bytes(thumbnail)
+    with pytest.raises(KeyError):
+        czi.read_attachment("Label")
+
+
+def test_read_time_stamps(data_dir):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    seconds = czi.read_time_stamps()
+    assert seconds.dtype == np.float64
+    np.testing.assert_allclose(seconds, [0.8380838])
+
+
+def test_export_zarr(data_dir, tmp_path):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    store = tmp_path / "export.zarr"
+    written = czi.export_zarr(
+        store, chunks=(5, 128, 256), levels=2, compression=None, S=1
+    )
+    assert written["chunks"] == 3 * (3 * 2 + 2 * 1)
+    assert written["bytes"] == written["pixel_bytes"]
+
+    attrs = json.loads((store / ".zattrs").read_text())
+    datasets = attrs["multiscales"][0]["datasets"]
+    assert [d["path"] for d in datasets] == ["0", "1"]
+    zarray = json.loads((store / "0" / ".zarray").read_text())
+    assert zarray["shape"] == [1, 3, 5, 325, 475]
+    assert zarray["chunks"] == [1, 1, 5, 128, 256]
+    assert zarray["dtype"] == "<u2"
+    assert json.loads((store / "1" / ".zarray").read_text())["shape"][3:] == [163, 238]
+
+    image, _ = czi.read_image(S=1, C=2)
+    chunk = np.fromfile(str(store / "0" / "0.2.0.2.1"), dtype="<u2").reshape(5, 128, 256)
+    np.testing.assert_array_equal(chunk[:, : 325 - 256, : 475 - 256], image[0, 0, 0, :, 256:, 256:])
+    assert not chunk[:, 325 - 256 :].any()  # the edge chunks are padded with the fill value
+
+
+@pytest.mark.raises(exception=PylibCZI_CDimCoordinatesUnderspecifiedException)
+def test_export_zarr_needs_scene(data_dir, tmp_path):
+    czi = CziFile(str(data_dir / "s_3_t_1_c_3_z_5.czi"))
+    czi.export_zarr(tmp_path / "export.zarr", compression=None)
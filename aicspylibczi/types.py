@@ -1,8 +1,13 @@
 from io import BufferedIOBase, BufferedReader
+from mmap import mmap
 from pathlib import Path
 from typing import BinaryIO, Union
 
+import numpy as np
+
 # IO Types
 PathLike = Union[str, Path]
 BufferLike: object = Union[bytes, BinaryIO, BufferedIOBase, BufferedReader]
-FileLike = Union[PathLike, BufferLike]
+# a CZI in memory, read in place
+MemoryLike: object = Union[bytes, bytearray, memoryview, mmap, np.ndarray]
+FileLike = Union[PathLike, BufferLike, MemoryLike]
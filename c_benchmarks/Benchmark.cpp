@@ -0,0 +1,170 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+namespace pylibczi_benchmarks {
+
+namespace {
+std::string
+jsonString(const std::string& value_)
+{
+  std::stringstream out;
+  out << '"';
+  for (char c : value_) {
+    switch (c) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        else
+          out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+// JSON has no NaN or infinity, a result without samples has null statistics
+std::string
+jsonNumber(double value_)
+{
+  if (!std::isfinite(value_))
+    return "null";
+  std::stringstream out;
+  out << std::setprecision(9) << value_;
+  return out.str();
+}
+
+void
+writeObject(std::ostream& out_, const Parameters& values_)
+{
+  out_ << "{";
+  for (size_t i = 0; i < values_.size(); i++)
+    out_ << (i == 0 ? "" : ", ") << jsonString(values_[i].first) << ": " << jsonString(values_[i].second);
+  out_ << "}";
+}
+}
+
+double
+Result::minimum() const
+{
+  return seconds.empty() ? NAN : *std::min_element(seconds.begin(), seconds.end());
+}
+
+double
+Result::median() const
+{
+  if (seconds.empty())
+    return NAN;
+  std::vector<double> sorted = seconds;
+  std::sort(sorted.begin(), sorted.end());
+  size_t middle = sorted.size() / 2;
+  return sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2.0;
+}
+
+double
+Result::mean() const
+{
+  return seconds.empty() ? NAN : std::accumulate(seconds.begin(), seconds.end(), 0.0) / seconds.size();
+}
+
+double
+Result::standardDeviation() const
+{
+  if (seconds.size() < 2)
+    return 0.0;
+  double average = mean();
+  double squares = 0.0;
+  for (double s : seconds)
+    squares += (s - average) * (s - average);
+  return std::sqrt(squares / (seconds.size() - 1));
+}
+
+const Result&
+Benchmarks::run(const std::string& name_, Parameters parameters_, const std::function<Work()>& run_)
+{
+  Result result;
+  result.name = name_;
+  result.parameters = std::move(parameters_);
+  try {
+    for (size_t i = 0; i < m_warmUps; i++)
+      run_();
+    for (size_t i = 0; i < m_samples; i++) {
+      auto start = std::chrono::steady_clock::now();
+      result.work = run_();
+      auto done = std::chrono::steady_clock::now();
+      result.seconds.push_back(std::chrono::duration<double>(done - start).count());
+    }
+  } catch (const std::exception& e) {
+    result.seconds.clear();
+    result.error = e.what();
+  }
+  m_results.push_back(std::move(result));
+  return m_results.back();
+}
+
+void
+Benchmarks::printTable(std::ostream& out_) const
+{
+  out_ << std::left << std::setw(40) << "benchmark" << std::right << std::setw(12) << "median ms" << std::setw(12)
+       << "min ms" << std::setw(12) << "stddev ms" << std::setw(12) << "MB/s" << std::setw(12) << "tiles/s"
+       << std::endl;
+  for (const auto& result : m_results) {
+    std::string label = result.name;
+    for (const auto& parameter : result.parameters)
+      label += " " + parameter.first + "=" + parameter.second;
+    out_ << std::left << std::setw(40) << label << std::right;
+    if (!result.error.empty()) {
+      out_ << "  failed: " << result.error << std::endl;
+      continue;
+    }
+    out_ << std::fixed << std::setprecision(3) << std::setw(12) << result.median() * 1000.0 << std::setw(12)
+         << result.minimum() * 1000.0 << std::setw(12) << result.standardDeviation() * 1000.0 << std::setprecision(1)
+         << std::setw(12) << (result.work.bytes > 0.0 ? result.megabytesPerSecond() : 0.0) << std::setw(12)
+         << (result.work.tiles > 0.0 ? result.tilesPerSecond() : 0.0) << std::endl;
+    out_.unsetf(std::ios_base::floatfield);
+  }
+}
+
+void
+Benchmarks::writeJson(std::ostream& out_, const Parameters& context_) const
+{
+  out_ << "{\n  \"context\": ";
+  writeObject(out_, context_);
+  out_ << ",\n  \"benchmarks\": [";
+  for (size_t r = 0; r < m_results.size(); r++) {
+    const Result& result = m_results[r];
+    out_ << (r == 0 ? "" : ",") << "\n    {\"name\": " << jsonString(result.name) << ", \"parameters\": ";
+    writeObject(out_, result.parameters);
+    if (!result.error.empty()) {
+      out_ << ", \"error\": " << jsonString(result.error) << "}";
+      continue;
+    }
+    out_ << ", \"seconds\": [";
+    for (size_t s = 0; s < result.seconds.size(); s++)
+      out_ << (s == 0 ? "" : ", ") << jsonNumber(result.seconds[s]);
+    out_ << "], \"min_s\": " << jsonNumber(result.minimum()) << ", \"median_s\": " << jsonNumber(result.median())
+         << ", \"mean_s\": " << jsonNumber(result.mean())
+         << ", \"stddev_s\": " << jsonNumber(result.standardDeviation())
+         << ", \"bytes\": " << jsonNumber(result.work.bytes) << ", \"tiles\": " << jsonNumber(result.work.tiles)
+         << ", \"mb_per_s\": " << jsonNumber(result.megabytesPerSecond())
+         << ", \"tiles_per_s\": " << jsonNumber(result.tilesPerSecond()) << "}";
+  }
+  out_ << "\n  ]\n}\n";
+}
+
+}
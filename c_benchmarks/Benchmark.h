@@ -0,0 +1,80 @@
+#ifndef _AICSPYLIBCZI_BENCHMARK_H
+#define _AICSPYLIBCZI_BENCHMARK_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pylibczi_benchmarks {
+
+using Parameters = std::vector<std::pair<std::string, std::string>>;
+
+/*!
+ * @brief what one run of a benchmark produced, the throughputs are worked out from it
+ */
+struct Work
+{
+  double bytes = 0.0; ///< the bytes of pixels or data returned, 0 if the benchmark has no meaningful size
+  double tiles = 0.0; ///< the subblocks the run went through
+};
+
+/*!
+ * @brief the timed samples of one benchmark with the parameters it ran with
+ */
+struct Result
+{
+  std::string name;
+  Parameters parameters;
+  std::vector<double> seconds; ///< one per sample, the warm-up runs aren't kept
+  Work work;                   ///< the work of one run
+  std::string error;           ///< what the benchmark threw, it has no samples then
+
+  double minimum() const;
+  double median() const;
+  double mean() const;
+  double standardDeviation() const;
+  double megabytesPerSecond() const { return work.bytes / 1.0e6 / median(); }
+  double tilesPerSecond() const { return work.tiles / median(); }
+};
+
+/*!
+ * @brief times benchmarks by repeated samples, each one after a few untimed runs that warm the caches, and reports
+ * the results as a table or as JSON for comparing builds and releases
+ */
+class Benchmarks
+{
+public:
+  Benchmarks(size_t samples_, size_t warm_ups_)
+    : m_samples(samples_)
+    , m_warmUps(warm_ups_)
+  {}
+
+  /*!
+   * @brief run_ warm_ups_ times then samples_ times, timing each, a std::exception it throws is recorded in the
+   * result instead of stopping the suite
+   * @param run_ one run of the benchmark, it returns the Work it did
+   */
+  const Result& run(const std::string& name_, Parameters parameters_, const std::function<Work()>& run_);
+
+  const std::vector<Result>& results() const { return m_results; }
+
+  void printTable(std::ostream& out_) const;
+
+  /*!
+   * @brief write { "context": {...}, "benchmarks": [...] }, every sample is written so the spread can be looked at
+   * @param context_ eg the file and the hardware threads, written as strings
+   */
+  void writeJson(std::ostream& out_, const Parameters& context_) const;
+
+private:
+  size_t m_samples;
+  size_t m_warmUps;
+  std::vector<Result> m_results;
+};
+
+}
+
+#endif //_AICSPYLIBCZI_BENCHMARK_H
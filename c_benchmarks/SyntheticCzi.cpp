@@ -0,0 +1,534 @@
+#include "SyntheticCzi.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#ifdef PYLIBCZI_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include "../_aicspylibczi/FileIO.h"
+#include "../_aicspylibczi/PixelTraits.h"
+
+namespace pylibczi_benchmarks {
+
+namespace {
+using Bytes = std::vector<std::uint8_t>;
+
+// the ZISRAW layout, as read by SidecarIndex and Reader::subblockMetadata. Every field is little-endian like every
+// platform the package is built for.
+constexpr size_t s_segmentHeaderBytes = 32;
+constexpr size_t s_segmentAlignment = 32;
+constexpr size_t s_fileHeaderBytes = 512;
+constexpr size_t s_directoryHeaderBytes = 128;
+constexpr size_t s_metadataHeaderBytes = 256;
+constexpr size_t s_subblockSizesBytes = 16;
+constexpr size_t s_minimumSubblockHeaderBytes = 256;
+constexpr size_t s_entryFixedBytes = 32;
+constexpr size_t s_dimensionEntryBytes = 20;
+constexpr std::int32_t s_compressionZstd0 = 5;
+constexpr std::uint8_t s_pyramidMultiSubblock = 2;
+
+// the pixel types that can be generated, named as PixelTypeException names them
+const std::vector<std::pair<libCZI::PixelType, std::string>> s_pixelTypes{
+  { libCZI::PixelType::Gray8, "Gray8" },
+  { libCZI::PixelType::Gray16, "Gray16" },
+  { libCZI::PixelType::Gray32, "Gray32" },
+  { libCZI::PixelType::Gray32Float, "Gray32Float" },
+  { libCZI::PixelType::Gray64Float, "Gray64Float" },
+  { libCZI::PixelType::Bgr24, "Bgr24" },
+  { libCZI::PixelType::Bgr48, "Bgr48" },
+  { libCZI::PixelType::Bgr96Float, "Bgr96Float" },
+  { libCZI::PixelType::Bgra32, "Bgra32" }
+};
+
+std::string
+nameOf(libCZI::PixelType pixel_type_)
+{
+  for (const auto& known : s_pixelTypes) {
+    if (known.first == pixel_type_)
+      return known.second;
+  }
+  return std::string();
+}
+
+template<typename T>
+void
+put(Bytes& bytes_, size_t offset_, T value_)
+{
+  std::memcpy(bytes_.data() + offset_, &value_, sizeof(value_));
+}
+
+template<typename S>
+typename std::enable_if<std::is_integral<S>::value, S>::type
+sampleOf(std::uint16_t value_)
+{
+  return static_cast<S>(sizeof(S) == 1 ? value_ >> 4 : value_);
+}
+
+template<typename S>
+typename std::enable_if<!std::is_integral<S>::value, S>::type
+sampleOf(std::uint16_t value_)
+{
+  return S(float(value_) / 4096.0f); // complex samples are turned away by checkOptions, it only has to compile
+}
+
+struct Dimension
+{
+  char name;
+  std::int32_t start;
+  std::int32_t size;
+  std::int32_t storedSize;
+};
+
+// a "DV" directory entry, the same bytes are in the subblock directory and at the start of the subblock
+Bytes
+directoryEntry(const SyntheticCziOptions& options_,
+               std::uint64_t file_position_,
+               bool pyramid_,
+               const std::vector<Dimension>& dimensions_)
+{
+  Bytes entry(s_entryFixedBytes + dimensions_.size() * s_dimensionEntryBytes, 0);
+  entry[0] = 'D';
+  entry[1] = 'V';
+  put(entry, 2, static_cast<std::int32_t>(options_.pixelType));
+  put(entry, 6, static_cast<std::int64_t>(file_position_));
+  put(entry, 14, std::int32_t(0)); // the file part
+  bool zstd = options_.compression == SyntheticCziOptions::Compression::Zstd;
+  put(entry, 18, zstd ? s_compressionZstd0 : std::int32_t(0));
+  entry[22] = pyramid_ ? s_pyramidMultiSubblock : 0;
+  put(entry, 28, static_cast<std::int32_t>(dimensions_.size()));
+  for (size_t i = 0; i < dimensions_.size(); i++) {
+    size_t at = s_entryFixedBytes + i * s_dimensionEntryBytes;
+    entry[at] = static_cast<std::uint8_t>(dimensions_[i].name);
+    put(entry, at + 4, dimensions_[i].start);
+    put(entry, at + 8, dimensions_[i].size);
+    put(entry, at + 12, 0.0f); // the start coordinate, the files don't have a scaling
+    put(entry, at + 16, dimensions_[i].storedSize);
+  }
+  return entry;
+}
+
+// writes segments one after the other, each is padded to a multiple of 32 bytes like ZEN pads them
+class SegmentWriter
+{
+  pylibczi::File m_file;
+  std::uint64_t m_position = 0;
+
+public:
+  explicit SegmentWriter(const std::wstring& file_name_)
+    : m_file(file_name_, true)
+  {
+    if (!m_file.isOpen())
+      throw std::runtime_error("Can't create the file.");
+  }
+
+  std::uint64_t position() const { return m_position; }
+
+  /*!
+   * @brief write a segment whose data is the parts one after the other
+   * @return where the segment starts
+   */
+  std::uint64_t write(const char* id_, std::initializer_list<std::pair<const void*, size_t>> parts_)
+  {
+    size_t used = 0;
+    for (const auto& part : parts_)
+      used += part.second;
+    size_t allocated = (used + s_segmentAlignment - 1) / s_segmentAlignment * s_segmentAlignment;
+    Bytes header(s_segmentHeaderBytes, 0);
+    std::memcpy(header.data(), id_, std::strlen(id_));
+    put(header, 16, static_cast<std::int64_t>(allocated));
+    put(header, 24, static_cast<std::int64_t>(used));
+    Bytes padding(allocated - used, 0);
+    bool written = m_file.write(header.data(), header.size());
+    for (const auto& part : parts_)
+      written = written && (part.second == 0 || m_file.write(part.first, part.second));
+    written = written && (padding.empty() || m_file.write(padding.data(), padding.size()));
+    if (!written)
+      throw std::runtime_error("Can't write the file.");
+    std::uint64_t at = m_position;
+    m_position += s_segmentHeaderBytes + allocated;
+    return at;
+  }
+
+  // the file header is written first and again with the positions when the rest of the file is written
+  void rewind()
+  {
+    if (!m_file.seek(0))
+      throw std::runtime_error("Can't write the file.");
+    m_position = 0;
+  }
+
+  void close()
+  {
+    if (!m_file.close())
+      throw std::runtime_error("Can't write the file.");
+  }
+};
+
+struct Grid
+{
+  int columns;
+  int rows;
+  int stepX;
+  int stepY;
+};
+
+Grid
+gridOf(const SyntheticCziOptions& options_)
+{
+  Grid grid;
+  grid.columns = static_cast<int>(std::ceil(std::sqrt(double(options_.tiles))));
+  grid.rows = (options_.tiles + grid.columns - 1) / grid.columns;
+  grid.stepX = std::max(1, static_cast<int>(std::lround(options_.tileWidth * (1.0 - options_.overlap))));
+  grid.stepY = std::max(1, static_cast<int>(std::lround(options_.tileHeight * (1.0 - options_.overlap))));
+  return grid;
+}
+
+void
+checkOptions(const SyntheticCziOptions& options_)
+{
+  if (options_.scenes < 1 || options_.timePoints < 1 || options_.channels < 1 || options_.zSlices < 1 ||
+      options_.tiles < 1)
+    throw std::invalid_argument("S, T, C, Z and M must be at least 1.");
+  if (options_.tileWidth < 1 || options_.tileHeight < 1)
+    throw std::invalid_argument("The tiles must be at least 1 x 1.");
+  if (!(options_.overlap >= 0.0 && options_.overlap < 1.0))
+    throw std::invalid_argument("overlap must be in [0, 1).");
+  if (options_.zStride < 1 || options_.mStride < 1)
+    throw std::invalid_argument("zstride and mstride must be at least 1.");
+  if (options_.pyramidLayers < 0 || options_.pyramidFactor < 2)
+    throw std::invalid_argument("pyramid must be at least 0 and factor at least 2.");
+  if (nameOf(options_.pixelType).empty())
+    throw pylibczi::PixelTypeException(options_.pixelType, "can't be generated.");
+#ifndef PYLIBCZI_HAS_ZSTD
+  if (options_.compression == SyntheticCziOptions::Compression::Zstd)
+    throw std::invalid_argument("The generator was built without zstd.");
+#endif
+  // the coordinates and the subblock count are 32 bit in the file, a pyramid layer has at most a tile per grid cell
+  Grid grid = gridOf(options_);
+  double width = double(grid.columns - 1) * grid.stepX + options_.tileWidth;
+  double height = double(grid.rows - 1) * grid.stepY + options_.tileHeight;
+  double right = (options_.scenes - 1) * (width + options_.tileWidth) + width;
+  double layerTile = std::pow(double(options_.pyramidFactor), options_.pyramidLayers) *
+                     std::max(options_.tileWidth, options_.tileHeight);
+  double planes = double(options_.scenes) * options_.timePoints * options_.channels * options_.zSlices;
+  double subblocks = planes * (options_.tiles + double(grid.columns) * grid.rows * options_.pyramidLayers);
+  const double limit = std::numeric_limits<std::int32_t>::max();
+  double lastZ = double(options_.zSlices - 1) * options_.zStride;
+  double lastM = double(options_.tiles - 1) * options_.mStride;
+  if (right > limit || height > limit || layerTile > limit || subblocks > limit || lastZ > limit || lastM > limit)
+    throw std::invalid_argument("The file would be larger than CZI can index.");
+}
+
+// the pixels of a stored_ sized subblock of the logical_ rectangle, it samples every step_ pixel
+void
+fillPixels(const SyntheticCziOptions& options_,
+           const libCZI::IntRect& logical_,
+           libCZI::IntSize stored_,
+           int step_,
+           int plane_,
+           Bytes& pixels_)
+{
+  pylibczi::dispatchPixelType(options_.pixelType, [&](auto traits_) {
+    using Traits = decltype(traits_);
+    using Sample = typename Traits::Sample;
+    const size_t samples = Traits::s_samples;
+    pixels_.resize(size_t(stored_.w) * stored_.h * samples * sizeof(Sample));
+    Sample* out = reinterpret_cast<Sample*>(pixels_.data());
+    for (std::uint32_t j = 0; j < stored_.h; j++) {
+      int y = logical_.y + static_cast<int>(j) * step_;
+      for (std::uint32_t i = 0; i < stored_.w; i++) {
+        int x = logical_.x + static_cast<int>(i) * step_;
+        for (size_t k = 0; k < std::min(samples, size_t(3)); k++)
+          *out++ = sampleOf<Sample>(syntheticValue(x + static_cast<int>(k), y, plane_));
+        if (samples == 4)
+          *out++ = std::numeric_limits<Sample>::max(); // the alpha of Bgra32
+      }
+    }
+  });
+}
+
+std::string
+acquisitionTime(size_t subblock_)
+{
+  // a millisecond apart from midnight, the readers only need distinct, increasing times
+  size_t ms = subblock_ % (24 * 3600 * 1000);
+  std::stringstream time;
+  time << "2020-01-01T" << std::setfill('0') << std::setw(2) << ms / 3600000 << ":" << std::setw(2)
+       << ms / 60000 % 60 << ":" << std::setw(2) << ms / 1000 % 60 << "." << std::setw(3) << ms % 1000 << "0000Z";
+  return time.str();
+}
+
+std::string
+documentMetadata(const SyntheticCziOptions& options_)
+{
+  libCZI::IntRect first = syntheticSceneRect(options_, 0);
+  libCZI::IntRect last = syntheticSceneRect(options_, options_.scenes - 1);
+  std::stringstream xml;
+  xml << "<ImageDocument>\n  <Metadata>\n    <Information>\n      <Document>\n        <Name>"
+      << syntheticCziSpec(options_) << "</Name>\n      </Document>\n      <Image>\n        <PixelType>"
+      << nameOf(options_.pixelType)
+      << "</PixelType>\n        <SizeX>" << last.x + last.w - first.x << "</SizeX>\n        <SizeY>" << first.h
+      << "</SizeY>\n        <SizeS>" << options_.scenes << "</SizeS>\n        <SizeT>" << options_.timePoints
+      << "</SizeT>\n        <SizeC>" << options_.channels << "</SizeC>\n        <SizeZ>" << options_.zSlices
+      << "</SizeZ>\n        <SizeM>" << options_.tiles << "</SizeM>\n      </Image>\n    </Information>\n  "
+      << "</Metadata>\n</ImageDocument>\n";
+  return xml.str();
+}
+
+int
+intValue(const std::string& key_, const std::string& value_)
+{
+  size_t used = 0;
+  int ans = 0;
+  try {
+    ans = std::stoi(value_, &used);
+  } catch (const std::exception&) {
+    used = 0;
+  }
+  if (used == 0 || used != value_.size())
+    throw std::invalid_argument(key_ + " must be an integer, not " + value_ + ".");
+  return ans;
+}
+
+std::string
+lower(std::string value_)
+{
+  std::transform(value_.begin(), value_.end(), value_.begin(), [](unsigned char c_) { return std::tolower(c_); });
+  return value_;
+}
+}
+
+SyntheticCziOptions
+parseSyntheticCziOptions(const std::string& spec_)
+{
+  SyntheticCziOptions options;
+  std::stringstream in(spec_);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (item.empty())
+      continue;
+    size_t equals = item.find('=');
+    if (equals == std::string::npos)
+      throw std::invalid_argument("Expected key=value, not " + item + ".");
+    std::string key = item.substr(0, equals);
+    std::string value = item.substr(equals + 1);
+    if (key == "S")
+      options.scenes = intValue(key, value);
+    else if (key == "T")
+      options.timePoints = intValue(key, value);
+    else if (key == "C")
+      options.channels = intValue(key, value);
+    else if (key == "Z")
+      options.zSlices = intValue(key, value);
+    else if (key == "M")
+      options.tiles = intValue(key, value);
+    else if (key == "tile") {
+      size_t by = value.find('x');
+      options.tileWidth = intValue(key, value.substr(0, by));
+      options.tileHeight = by == std::string::npos ? options.tileWidth : intValue(key, value.substr(by + 1));
+    } else if (key == "overlap") {
+      try {
+        options.overlap = std::stod(value);
+      } catch (const std::exception&) {
+        throw std::invalid_argument("overlap must be a number, not " + value + ".");
+      }
+    } else if (key == "pixel") {
+      auto found = std::find_if(
+        s_pixelTypes.begin(), s_pixelTypes.end(), [&value](const std::pair<libCZI::PixelType, std::string>& p_) {
+          return lower(p_.second) == lower(value);
+        });
+      if (found == s_pixelTypes.end())
+        throw std::invalid_argument("Unknown pixel type " + value + ".");
+      options.pixelType = found->first;
+    } else if (key == "compression") {
+      if (lower(value) == "none")
+        options.compression = SyntheticCziOptions::Compression::None;
+      else if (lower(value) == "zstd")
+        options.compression = SyntheticCziOptions::Compression::Zstd;
+      else
+        throw std::invalid_argument("compression is none or zstd, not " + value + ".");
+    } else if (key == "pyramid")
+      options.pyramidLayers = intValue(key, value);
+    else if (key == "factor")
+      options.pyramidFactor = intValue(key, value);
+    else if (key == "metadata")
+      options.subblockMetadata = intValue(key, value) != 0;
+    else if (key == "zstride")
+      options.zStride = intValue(key, value);
+    else if (key == "mstride")
+      options.mStride = intValue(key, value);
+    else
+      throw std::invalid_argument("Unknown key " + key + ".");
+  }
+  checkOptions(options);
+  return options;
+}
+
+std::string
+syntheticCziSpec(const SyntheticCziOptions& options_)
+{
+  std::stringstream spec;
+  spec << "S=" << options_.scenes << ",T=" << options_.timePoints << ",C=" << options_.channels
+       << ",Z=" << options_.zSlices << ",M=" << options_.tiles << ",tile=" << options_.tileWidth << "x"
+       << options_.tileHeight << ",overlap=" << options_.overlap << ",pixel=" << nameOf(options_.pixelType)
+       << ",compression="
+       << (options_.compression == SyntheticCziOptions::Compression::Zstd ? "zstd" : "none")
+       << ",pyramid=" << options_.pyramidLayers << ",factor=" << options_.pyramidFactor
+       << ",metadata=" << (options_.subblockMetadata ? 1 : 0) << ",zstride=" << options_.zStride
+       << ",mstride=" << options_.mStride;
+  return spec.str();
+}
+
+libCZI::IntRect
+syntheticSceneRect(const SyntheticCziOptions& options_, int s_)
+{
+  Grid grid = gridOf(options_);
+  int width = (grid.columns - 1) * grid.stepX + options_.tileWidth;
+  int height = (grid.rows - 1) * grid.stepY + options_.tileHeight;
+  // a tile's gap between the scenes
+  return libCZI::IntRect{ s_ * (width + options_.tileWidth), 0, width, height };
+}
+
+libCZI::IntRect
+syntheticTileRect(const SyntheticCziOptions& options_, int s_, int m_)
+{
+  Grid grid = gridOf(options_);
+  libCZI::IntRect scene = syntheticSceneRect(options_, s_);
+  return libCZI::IntRect{ scene.x + (m_ % grid.columns) * grid.stepX,
+                          scene.y + (m_ / grid.columns) * grid.stepY,
+                          options_.tileWidth,
+                          options_.tileHeight };
+}
+
+std::uint16_t
+syntheticValue(int x_, int y_, int plane_)
+{
+  // a ramp so neighbouring pixels are alike, with a little noise so the pixels don't compress to nothing
+  auto x = static_cast<std::uint32_t>(x_), y = static_cast<std::uint32_t>(y_);
+  std::uint32_t noise = x * 0x9E3779B1u ^ y * 0x85EBCA77u;
+  noise ^= noise >> 15;
+  std::uint32_t ramp = x + 2 * y + 64 * static_cast<std::uint32_t>(plane_);
+  return static_cast<std::uint16_t>((ramp ^ (noise & 0x7u)) & 0xFFFu);
+}
+
+SyntheticCziSummary
+writeSyntheticCzi(const std::wstring& file_name_, const SyntheticCziOptions& options_)
+{
+  checkOptions(options_);
+  SyntheticCziSummary summary;
+  SegmentWriter writer(file_name_);
+  Bytes fileHeader(s_fileHeaderBytes, 0);
+  writer.write("ZISRAWFILE", { { fileHeader.data(), fileHeader.size() } });
+
+  Bytes directory(s_directoryHeaderBytes, 0);
+  Bytes pixels, compressed, header;
+  auto writeSubblock = [&](libCZI::IntRect logical_, int step_, int plane_, std::vector<Dimension> dimensions_) {
+    libCZI::IntSize stored{ static_cast<std::uint32_t>(logical_.w / step_),
+                            static_cast<std::uint32_t>(logical_.h / step_) };
+    dimensions_.insert(dimensions_.begin(),
+                       { Dimension{ 'X', logical_.x, logical_.w, static_cast<std::int32_t>(stored.w) },
+                         Dimension{ 'Y', logical_.y, logical_.h, static_cast<std::int32_t>(stored.h) } });
+    fillPixels(options_, logical_, stored, step_, plane_, pixels);
+    const Bytes* data = &pixels;
+#ifdef PYLIBCZI_HAS_ZSTD
+    if (options_.compression == SyntheticCziOptions::Compression::Zstd) {
+      compressed.resize(ZSTD_compressBound(pixels.size()));
+      size_t bytes = ZSTD_compress(compressed.data(), compressed.size(), pixels.data(), pixels.size(), 1);
+      if (ZSTD_isError(bytes))
+        throw std::runtime_error(std::string("zstd failed: ") + ZSTD_getErrorName(bytes));
+      compressed.resize(bytes);
+      data = &compressed;
+    }
+#endif
+    std::string metadata;
+    if (options_.subblockMetadata)
+      metadata = "<METADATA><Tags><AcquisitionTime>" + acquisitionTime(summary.subblocks) +
+                 "</AcquisitionTime></Tags></METADATA>";
+
+    Bytes entry = directoryEntry(options_, writer.position(), step_ > 1, dimensions_);
+    header.assign(std::max(s_minimumSubblockHeaderBytes, s_subblockSizesBytes + entry.size()), 0);
+    put(header, 0, static_cast<std::int32_t>(metadata.size()));
+    put(header, 4, std::int32_t(0)); // no attachment
+    put(header, 8, static_cast<std::int64_t>(data->size()));
+    std::copy(entry.begin(), entry.end(), header.begin() + s_subblockSizesBytes);
+    writer.write("ZISRAWSUBBLOCK",
+                 { { header.data(), header.size() },
+                   { metadata.data(), metadata.size() },
+                   { data->data(), data->size() } });
+    directory.insert(directory.end(), entry.begin(), entry.end());
+    summary.subblocks++;
+  };
+
+  const bool mosaic = options_.tiles > 1;
+  for (int s = 0; s < options_.scenes; s++) {
+    libCZI::IntRect scene = syntheticSceneRect(options_, s);
+    for (int t = 0; t < options_.timePoints; t++) {
+      for (int c = 0; c < options_.channels; c++) {
+        for (int z = 0; z < options_.zSlices; z++) {
+          int plane = (t * options_.channels + c) * options_.zSlices + z;
+          std::vector<Dimension> dimensions{
+            { 'C', c, 1, 1 }, { 'Z', z * options_.zStride, 1, 1 }, { 'T', t, 1, 1 }, { 'S', s, 1, 1 }
+          };
+          for (int m = 0; m < options_.tiles; m++) {
+            std::vector<Dimension> tile(dimensions);
+            if (mosaic)
+              tile.push_back(Dimension{ 'M', m * options_.mStride, 1, 1 });
+            writeSubblock(syntheticTileRect(options_, s, m), 1, plane, tile);
+            summary.layer0Subblocks++;
+          }
+          // each layer tiles the scene with tiles the size of the layer 0 tiles when they're minified, the edge
+          // tiles are rounded up to whole minified pixels so every subblock has the layer's exact minification
+          int step = 1;
+          for (int layer = 1; layer <= options_.pyramidLayers; layer++) {
+            step *= options_.pyramidFactor;
+            int width = options_.tileWidth * step, height = options_.tileHeight * step;
+            for (int y = scene.y; y < scene.y + scene.h; y += height) {
+              for (int x = scene.x; x < scene.x + scene.w; x += width) {
+                int w = std::min(width, scene.x + scene.w - x), h = std::min(height, scene.y + scene.h - y);
+                w = (w + step - 1) / step * step;
+                h = (h + step - 1) / step * step;
+                writeSubblock(libCZI::IntRect{ x, y, w, h }, step, plane, dimensions);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  put(directory, 0, static_cast<std::int32_t>(summary.subblocks));
+  std::uint64_t directoryPosition = writer.write("ZISRAWDIRECTORY", { { directory.data(), directory.size() } });
+  std::string xml = documentMetadata(options_);
+  Bytes metadataHeader(s_metadataHeaderBytes, 0);
+  put(metadataHeader, 0, static_cast<std::int32_t>(xml.size()));
+  std::uint64_t metadataPosition =
+    writer.write("ZISRAWMETADATA", { { metadataHeader.data(), metadataHeader.size() }, { xml.data(), xml.size() } });
+  summary.bytes = writer.position();
+
+  std::mt19937 random{ std::random_device()() };
+  put(fileHeader, 0, std::int32_t(1)); // version 1.0
+  put(fileHeader, 4, std::int32_t(0));
+  for (size_t i = 16; i < 32; i++)
+    fileHeader[i] = static_cast<std::uint8_t>(random()); // the primary file GUID, a single part file is its own
+  std::copy(fileHeader.begin() + 16, fileHeader.begin() + 32, fileHeader.begin() + 32);
+  put(fileHeader, 52, static_cast<std::int64_t>(directoryPosition));
+  put(fileHeader, 60, static_cast<std::int64_t>(metadataPosition));
+  put(fileHeader, 72, std::int64_t(0)); // no attachments
+  writer.rewind();
+  writer.write("ZISRAWFILE", { { fileHeader.data(), fileHeader.size() } });
+  writer.close();
+  return summary;
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef _AICSPYLIBCZI_SYNTHETICCZI_H
+#define _AICSPYLIBCZI_SYNTHETICCZI_H
+
+#include <cstdint>
+#include <string>
+
+#include "../_aicspylibczi/inc_libCZI.h"
+
+namespace pylibczi_benchmarks {
+
+/*!
+ * @brief the layout of a generated CZI file. Every scene is a grid of tiles (M) a little over square, they overlap
+ * their neighbours by overlap of the tile size and the scenes are side by side in X. Every S, T, C and Z has the same
+ * tiles so a file has scenes * timePoints * channels * zSlices * tiles subblocks in layer 0, and the pyramid layers
+ * add minified subblocks covering each scene on top of them.
+ */
+struct SyntheticCziOptions
+{
+  enum class Compression
+  {
+    None,
+    Zstd ///< zstd0 subblocks, the generator must be built with zstd and the reader's libCZI must decode them
+  };
+
+  int scenes = 1;
+  int timePoints = 1;
+  int channels = 1;
+  int zSlices = 1;
+  int tiles = 1;   ///< the M index, a single tile writes a file without M, which isn't a mosaic
+  int zStride = 1; ///< slice z is written with Z = z * zStride, a large stride makes the Z values sparse
+  int mStride = 1; ///< tile m is written with M = m * mStride, the tile's place in the scene is still by m
+  int tileWidth = 512;
+  int tileHeight = 512;
+  double overlap = 0.1; ///< the fraction of a tile its neighbours overlap, [0, 1)
+  libCZI::PixelType pixelType = libCZI::PixelType::Gray16;
+  Compression compression = Compression::None;
+  int pyramidLayers = 0; ///< the layers written above layer 0, each minified by pyramidFactor again
+  int pyramidFactor = 2;
+  bool subblockMetadata = true; ///< write each subblock with a small METADATA document with its AcquisitionTime
+};
+
+/*!
+ * @brief parse options written as key=value pairs separated by commas, eg "S=2,T=3,C=2,Z=10,M=100,tile=256x256,
+ * overlap=0.1,pixel=Gray16,compression=zstd,pyramid=2,factor=2,metadata=1,zstride=1,mstride=1", keys that aren't
+ * given keep their default
+ * @throw std::invalid_argument for an unknown key or a value out of range
+ */
+SyntheticCziOptions
+parseSyntheticCziOptions(const std::string& spec_);
+
+/*!
+ * @brief the options as parseSyntheticCziOptions takes them, every key is written
+ */
+std::string
+syntheticCziSpec(const SyntheticCziOptions& options_);
+
+/*!
+ * @brief the logical rectangle of tile m_ of scene s_, the same in every T, C and Z
+ */
+libCZI::IntRect
+syntheticTileRect(const SyntheticCziOptions& options_, int s_, int m_);
+
+/*!
+ * @brief the rectangle the tiles of scene s_ cover, the pyramid layers tile it
+ */
+libCZI::IntRect
+syntheticSceneRect(const SyntheticCziOptions& options_, int s_);
+
+/*!
+ * @brief the generated pattern, a 12 bit value of the pixel at (x_, y_) of the file in the plane
+ * (t * channels + c) * zSlices + z. Gray8 samples are the value >> 4, the float types the value / 4096 and the other
+ * integer types the value. The B, G and R samples of a pixel are the values at x_, x_ + 1 and x_ + 2, and A is opaque.
+ * It depends only on the position so overlapping tiles and pyramid layers agree, and pyramid pixels are the layer 0
+ * pixels they sample (nearest neighbour).
+ */
+std::uint16_t
+syntheticValue(int x_, int y_, int plane_);
+
+/*!
+ * @brief what writeSyntheticCzi wrote
+ */
+struct SyntheticCziSummary
+{
+  size_t subblocks = 0;       ///< pyramid layers included
+  size_t layer0Subblocks = 0; ///< the acquired tiles
+  std::uint64_t bytes = 0;    ///< the size of the file
+};
+
+/*!
+ * @brief write a CZI file, the subblocks are streamed to the file so its size is only limited by the disk
+ * @throw std::invalid_argument if the options can't be written, std::runtime_error if the file can't be
+ */
+SyntheticCziSummary
+writeSyntheticCzi(const std::wstring& file_name_, const SyntheticCziOptions& options_);
+
+}
+
+#endif //_AICSPYLIBCZI_SYNTHETICCZI_H
@@ -0,0 +1,216 @@
+//
+// Benchmarks of the Reader on a file given on the command line, see --help. The CZI files in c_tests/resources are
+// too small to say much, a large file of the kind being tuned for should be used, or one written with --generate.
+//
+
+#include <algorithm>
+#include <codecvt>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <locale>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "SyntheticCzi.h"
+
+#include "../_aicspylibczi/ImageFactory.h"
+#include "../_aicspylibczi/Reader.h"
+
+using pylibczi_benchmarks::Benchmarks;
+using pylibczi_benchmarks::Work;
+
+namespace {
+const char* s_usage =
+  "Usage: benchmark_libczi FILE [--samples N] [--warm-ups N] [--cores 1,2,4] [--scales 1,0.5,0.1] [--json PATH]\n"
+  "                        [--generate SPEC]\n"
+  "  --samples   the timed runs of each benchmark, 5 by default\n"
+  "  --warm-ups  the untimed runs before them, 1 by default\n"
+  "  --cores     the core counts readSelected is timed with, by default 1, 2, 4 and every hardware thread\n"
+  "  --scales    the scale factors readMosaic is timed with on mosaic files, 1, 0.5, 0.25 and 0.1 by default\n"
+  "  --json      write the results to PATH as JSON as well as printing them\n"
+  "  --generate  write FILE as a synthetic CZI file first, SPEC is as generate_czi takes it, eg S=2,M=400,tile=256\n";
+
+template<typename T>
+std::vector<T>
+parseList(const std::string& list_)
+{
+  std::vector<T> values;
+  std::stringstream in(list_);
+  std::string item;
+  while (std::getline(in, item, ','))
+    values.push_back(static_cast<T>(std::stod(item)));
+  return values;
+}
+
+double
+bytesOf(const std::pair<libCZI::PixelType, pylibczi::Reader::Shape>& shape_)
+{
+  size_t samples = std::accumulate(shape_.second.begin(),
+                                   shape_.second.end(),
+                                   size_t(1),
+                                   [](size_t a_, const std::pair<char, size_t>& b_) { return a_ * b_.second; });
+  return static_cast<double>(samples * pylibczi::ImageFactory::sizeOfPixelType(shape_.first));
+}
+
+// the first value of every dimension of the first scene but YX and M, a single plane as readMosaic needs
+libCZI::CDimCoordinate
+firstPlane(pylibczi::Reader& czi_)
+{
+  libCZI::CDimCoordinate plane;
+  for (const auto& range : czi_.readDimsRange().front()) {
+    libCZI::DimensionIndex di = libCZI::Utils::CharToDimension(pylibczi::dimIndexToChar(range.first));
+    if (di != libCZI::DimensionIndex::invalid)
+      plane.Set(di, range.second.first);
+  }
+  return plane;
+}
+
+// the first scene, or everything for a file without scenes
+libCZI::CDimCoordinate
+firstScene(pylibczi::Reader& czi_)
+{
+  libCZI::CDimCoordinate plane;
+  const auto& ranges = czi_.readDimsRange().front();
+  auto scene = ranges.find(pylibczi::DimIndex::S);
+  if (scene != ranges.end())
+    plane.Set(libCZI::DimensionIndex::S, scene->second.first);
+  return plane;
+}
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 2 || std::string(argv[1]) == "--help") {
+    std::cout << s_usage;
+    return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+  std::string file = argv[1];
+  size_t samples = 5;
+  size_t warmUps = 1;
+  unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<unsigned int> cores{ 1, 2, 4, hardwareThreads };
+  std::vector<float> scales{ 1.0f, 0.5f, 0.25f, 0.1f };
+  std::string json;
+  std::string synthetic;
+  bool generate = false;
+  for (int i = 2; i < argc; i++) {
+    std::string option = argv[i];
+    if (i + 1 == argc) {
+      std::cerr << option << " needs a value\n" << s_usage;
+      return EXIT_FAILURE;
+    }
+    std::string value = argv[++i];
+    if (option == "--samples")
+      samples = std::stoul(value);
+    else if (option == "--warm-ups")
+      warmUps = std::stoul(value);
+    else if (option == "--cores")
+      cores = parseList<unsigned int>(value);
+    else if (option == "--scales")
+      scales = parseList<float>(value);
+    else if (option == "--json")
+      json = value;
+    else if (option == "--generate") {
+      synthetic = value;
+      generate = true;
+    }
+    else {
+      std::cerr << "unknown option " << option << "\n" << s_usage;
+      return EXIT_FAILURE;
+    }
+  }
+  std::sort(cores.begin(), cores.end());
+  cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+  std::wstring path = converter.from_bytes(file);
+  if (generate) {
+    try {
+      auto options = pylibczi_benchmarks::parseSyntheticCziOptions(synthetic);
+      synthetic = pylibczi_benchmarks::syntheticCziSpec(options);
+      pylibczi_benchmarks::writeSyntheticCzi(path, options);
+    } catch (const std::exception& e) {
+      std::cerr << "couldn't generate " << file << ": " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  pylibczi::Reader czi(path.c_str());
+  const double subblocks = static_cast<double>(czi.subblockDirectory().size());
+  std::cout << "File: " << file << "\nDims: " << czi.dimsString() << "  pixel type: " << czi.pixelType()
+            << "  subblocks: " << subblocks << (czi.isMosaic() ? "  mosaic" : "") << "\n"
+            << std::endl;
+
+  Benchmarks benchmarks(samples, warmUps);
+  // the file is in the OS cache after the warm-ups so this is the cost of parsing the directory and metadata
+  benchmarks.run("open", {}, [&path, subblocks]() {
+    pylibczi::Reader reader(path.c_str());
+    return Work{ 0.0, subblocks };
+  });
+
+  // getMatches is private, selectedShape is the subblock directory lookup of a read without reading any pixels
+  libCZI::CDimCoordinate scene = firstScene(czi);
+  auto selected = czi.selectedShape(scene);
+  double selectedTiles = static_cast<double>(czi.tileBoundingBoxes(scene).size());
+  benchmarks.run("matches", {}, [&czi, &scene, selectedTiles]() {
+    czi.selectedShape(scene);
+    return Work{ 0.0, selectedTiles };
+  });
+  for (unsigned int c : cores) {
+    benchmarks.run("read_selected", { { "cores", std::to_string(c) } }, [&czi, &scene, &selected, selectedTiles, c]() {
+      czi.readSelected(scene, -1, c);
+      return Work{ bytesOf(selected), selectedTiles };
+    });
+  }
+
+  libCZI::CDimCoordinate plane = firstPlane(czi);
+  if (czi.isMosaic()) {
+    for (float scale : scales) {
+      std::stringstream label;
+      label << scale;
+      auto mosaic = czi.mosaicShape(plane, scale);
+      double planeTiles = static_cast<double>(czi.mosaicTileBoundingBoxes(plane).size());
+      benchmarks.run(
+        "read_mosaic", { { "scale", label.str() } }, [&czi, &plane, &mosaic, planeTiles, scale, hardwareThreads]() {
+          czi.readMosaic(plane, scale, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, hardwareThreads);
+          return Work{ bytesOf(mosaic), planeTiles };
+        });
+    }
+  }
+
+  benchmarks.run("bounding_boxes", {}, [&czi, &scene]() {
+    size_t boxes = czi.isMosaic() ? czi.mosaicTileBoundingBoxes(scene).size() : czi.tileBoundingBoxes(scene).size();
+    return Work{ 0.0, static_cast<double>(boxes) };
+  });
+
+  benchmarks.run("read_subblock_meta", {}, [&czi, &scene]() {
+    auto metadata = czi.readSubblockMeta(scene);
+    double bytes = 0.0;
+    for (const auto& subblock : metadata)
+      bytes += static_cast<double>(subblock.getString().size());
+    return Work{ bytes, static_cast<double>(metadata.size()) };
+  });
+
+  benchmarks.printTable(std::cout);
+  if (!json.empty()) {
+    std::ofstream out(json);
+    benchmarks.writeJson(out,
+                         { { "file", file },
+                           { "dims", czi.dimsString() },
+                           { "pixel_type", czi.pixelType() },
+                           { "subblocks", std::to_string(static_cast<size_t>(subblocks)) },
+                           { "samples", std::to_string(samples) },
+                           { "hardware_threads", std::to_string(hardwareThreads) },
+                           { "synthetic", synthetic } });
+    if (!out) {
+      std::cerr << "couldn't write " << json << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
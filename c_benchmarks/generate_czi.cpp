@@ -0,0 +1,35 @@
+//
+// Writes a synthetic CZI file for the benchmarks and the scalability tests, see SyntheticCzi.h for the layout.
+//
+
+#include <codecvt>
+#include <cstdlib>
+#include <iostream>
+#include <locale>
+#include <string>
+
+#include "SyntheticCzi.h"
+
+int
+main(int argc, char* argv[])
+{
+  if (argc < 2 || argc > 3 || std::string(argv[1]) == "--help") {
+    std::cout << "Usage: generate_czi FILE [SPEC]\n"
+                 "  SPEC is key=value pairs separated by commas, the keys and their defaults are\n  "
+              << pylibczi_benchmarks::syntheticCziSpec(pylibczi_benchmarks::SyntheticCziOptions())
+              << "\n  eg generate_czi big.czi S=4,T=10,C=3,Z=20,M=100,tile=256,pyramid=3 has 240000 tiles in layer 0\n";
+    return argc < 2 || argc > 3 ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+  try {
+    auto options = pylibczi_benchmarks::parseSyntheticCziOptions(argc == 3 ? argv[2] : "");
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    auto summary = pylibczi_benchmarks::writeSyntheticCzi(converter.from_bytes(argv[1]), options);
+    std::cout << argv[1] << ": " << pylibczi_benchmarks::syntheticCziSpec(options) << "\n  " << summary.subblocks
+              << " subblocks, " << summary.layer0Subblocks << " in layer 0, " << summary.bytes << " bytes"
+              << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
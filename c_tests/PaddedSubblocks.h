@@ -0,0 +1,26 @@
+#ifndef _AICSPYLIBCZI_PADDEDSUBBLOCKS_H
+#define _AICSPYLIBCZI_PADDEDSUBBLOCKS_H
+
+#include <cstdint>
+#include <vector>
+
+/*!
+ * @brief count_ 3 x 2 gray16 subblocks in rows padded to 4 samples, the padding is 0xFFFF to catch reads past the
+ * width. Subblock i is i * 10 + the pixel's position, so the subblocks of a test have distinct but predictable values.
+ */
+inline std::vector<std::vector<std::uint16_t>>
+paddedGray16Subblocks(std::uint16_t count_)
+{
+  std::vector<std::vector<std::uint16_t>> ans;
+  for (std::uint16_t i = 0; i < count_; i++) {
+    std::vector<std::uint16_t> pixels(8, 0xFFFF);
+    for (std::uint16_t j = 0; j < 2; j++) {
+      for (std::uint16_t k = 0; k < 3; k++)
+        pixels[j * 4 + k] = static_cast<std::uint16_t>(i * 10 + j * 3 + k);
+    }
+    ans.push_back(pixels);
+  }
+  return ans;
+}
+
+#endif //_AICSPYLIBCZI_PADDEDSUBBLOCKS_H
@@ -0,0 +1,63 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Attachments.h"
+#include "../_aicspylibczi/StreamImplPositionalRead.h"
+#include "../_aicspylibczi/exceptions.h"
+
+using pylibczi::AttachmentDirectory;
+
+namespace {
+std::vector<std::uint8_t>
+timeStamps(std::int32_t count_, const std::vector<double>& values_)
+{
+  std::int32_t size = static_cast<std::int32_t>(8 + values_.size() * sizeof(double));
+  std::vector<std::uint8_t> ans(static_cast<size_t>(size));
+  std::memcpy(ans.data(), &size, sizeof(size));
+  std::memcpy(ans.data() + 4, &count_, sizeof(count_));
+  if (!values_.empty())
+    std::memcpy(ans.data() + 8, values_.data(), values_.size() * sizeof(double));
+  return ans;
+}
+}
+
+TEST_CASE("test_attachments_time_stamps", "[Attachments]")
+{
+  auto data = timeStamps(3, { 360.5, 420.25, 480.125 });
+  std::vector<double> expected{ 360.5, 420.25, 480.125 };
+  REQUIRE(AttachmentDirectory::decodeTimeStamps(data.data(), data.size()) == expected);
+  data = timeStamps(0, {});
+  REQUIRE(AttachmentDirectory::decodeTimeStamps(data.data(), data.size()).empty());
+
+  data = timeStamps(4, { 1.0, 2.0 }); // the count is more than the data holds
+  REQUIRE_THROWS_AS(AttachmentDirectory::decodeTimeStamps(data.data(), data.size()), pylibczi::AttachmentException);
+  REQUIRE_THROWS_AS(AttachmentDirectory::decodeTimeStamps(data.data(), 4), pylibczi::AttachmentException);
+}
+
+TEST_CASE("test_attachments_guid", "[Attachments]")
+{
+  libCZI::GUID guid{ 0x64043e05, 0x9d70, 0x4ed1, { 0xaf, 0xc3, 0x8f, 0x12, 0x5d, 0xc9, 0x47, 0x2a } };
+  REQUIRE(AttachmentDirectory::guidString(guid) == "64043e05-9d70-4ed1-afc3-8f125dc9472a");
+}
+
+TEST_CASE("test_attachments_directory", "[Attachments]")
+{
+  pylibczi::StreamImplPositionalRead stream(L"resources/CD_s_1_t_3_c_2_z_5.czi");
+  AttachmentDirectory directory(stream);
+  const auto& entries = directory.entries();
+  REQUIRE(entries.size() == 3);
+  REQUIRE(entries[0].name == "EventList");
+  REQUIRE(entries[1].name == "TimeStamps");
+  REQUIRE(entries[1].contentType == "CZTIMS");
+  REQUIRE(entries[1].size == 32);
+  REQUIRE(entries[2].contentType == "JPG");
+  REQUIRE(entries[2].size == 7906);
+  for (size_t i = 0; i < entries.size(); i++) {
+    REQUIRE(entries[i].index == static_cast<int>(i));
+    REQUIRE(entries[i].filePosition > 0);
+    REQUIRE(entries[i].guid.size() == 36);
+  }
+}
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <future>
+#include <memory>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Cancellation.h"
+#include "../_aicspylibczi/Threadpool.h"
+#include "../_aicspylibczi/exceptions.h"
+
+using pylibczi::CancelToken;
+using pylibczi::ReadCancellation;
+using pylibczi::ReadCancelledException;
+
+namespace {
+ReadCancelledException::Reason
+reasonOf(const ReadCancellation& cancellation_)
+{
+  try {
+    cancellation_.check();
+  } catch (const ReadCancelledException& e) {
+    return e.reason();
+  }
+  FAIL("check() didn't throw");
+  return ReadCancelledException::Reason::Cancelled;
+}
+}
+
+TEST_CASE("test_cancellation_token", "[Cancellation]")
+{
+  REQUIRE_NOTHROW(ReadCancellation::current().check());
+  auto token = std::make_shared<CancelToken>();
+  {
+    ReadCancellation::Scope scope(token);
+    ReadCancellation cancellation = ReadCancellation::current();
+    REQUIRE_NOTHROW(cancellation.check());
+    token->cancel();
+    REQUIRE(reasonOf(cancellation) == ReadCancelledException::Reason::Cancelled);
+    // a read taken on another thread sees the token too
+    auto other = std::async(std::launch::async, [cancellation] { return reasonOf(cancellation); });
+    REQUIRE(other.get() == ReadCancelledException::Reason::Cancelled);
+    token->reset();
+    REQUIRE_NOTHROW(cancellation.check());
+  }
+  token->cancel();
+  REQUIRE_NOTHROW(ReadCancellation::current().check()); // the scope is gone
+}
+
+TEST_CASE("test_cancellation_deadline", "[Cancellation]")
+{
+  auto now = ReadCancellation::Clock::now();
+  ReadCancellation::Scope outer(nullptr, now + std::chrono::hours(1));
+  REQUIRE_NOTHROW(ReadCancellation::current().check());
+  {
+    ReadCancellation::Scope inner(nullptr, now);
+    REQUIRE(reasonOf(ReadCancellation::current()) == ReadCancelledException::Reason::Deadline);
+    // the earlier deadline applies to a nested scope
+    ReadCancellation::Scope later(nullptr, now + std::chrono::hours(2));
+    REQUIRE(reasonOf(ReadCancellation::current()) == ReadCancelledException::Reason::Deadline);
+  }
+  REQUIRE_NOTHROW(ReadCancellation::current().check());
+}
+
+TEST_CASE("test_cancellation_interrupt", "[Cancellation]")
+{
+  std::atomic<int> checks{ 0 };
+  bool interrupt = false;
+  ReadCancellation::Scope scope(nullptr, ReadCancellation::Clock::time_point::max(), [&checks, &interrupt] {
+    checks++;
+    return interrupt;
+  });
+  ReadCancellation cancellation = ReadCancellation::current();
+  REQUIRE_NOTHROW(cancellation.check());
+  REQUIRE(checks == 1);
+  REQUIRE_NOTHROW(cancellation.check()); // within s_interruptInterval of the last check
+  REQUIRE(checks == 1);
+
+  // only the thread which installed the check calls it
+  std::async(std::launch::async, [cancellation] { cancellation.check(); }).get();
+  REQUIRE(checks == 1);
+
+  interrupt = true;
+  std::this_thread::sleep_for(ReadCancellation::s_interruptInterval + std::chrono::milliseconds(10));
+  REQUIRE(reasonOf(cancellation) == ReadCancelledException::Reason::Interrupted);
+  REQUIRE(checks == 2);
+}
+
+TEST_CASE("test_cancellation_parallel_for", "[Cancellation]")
+{
+  // the loop stops handing out indexes once one is cancelled
+  auto token = std::make_shared<CancelToken>();
+  ReadCancellation::Scope scope(token);
+  ReadCancellation cancellation = ReadCancellation::current();
+  std::atomic<size_t> done{ 0 };
+  auto work = [&](size_t i_) {
+    cancellation.check();
+    if (i_ == 3)
+      token->cancel();
+    done++;
+  };
+  REQUIRE_THROWS_AS(pylibczi::ThreadPool::instance().parallelFor(10000, 0, work), ReadCancelledException);
+  REQUIRE(done < 10000);
+}
@@ -142,3 +142,133 @@ TEST_CASE("test_image_accessors_2d", "[Image_operator[2d]]")
     for (size_t i = 0; i < 5; i++)
       REQUIRE(img[{ i, j }] == *img.getRawPtr(cnt++));
 }
+
+TEST_CASE("test_image_load_raw", "[Image_loadImage_raw]")
+{
+  libCZI::CDimCoordinate cdim{ { libCZI::DimensionIndex::C, 0 } };
+  uint16_t packed[12];
+  for (int i = 0; i < 12; i++)
+    packed[i] = i;
+  std::vector<uint16_t> memory(12, 0);
+  TypedImage<uint16_t> img({ 3, 4 }, libCZI::PixelType::Gray16, &cdim, { 0, 0, 4, 3 }, memory.data(), -1);
+  img.loadImage(packed, 4 * sizeof(uint16_t), libCZI::IntSize{ 4, 3 }, 1);
+  for (int i = 0; i < 12; i++)
+    REQUIRE(memory[i] == i);
+
+  // rows padded to 6 pixels, only the first 4 of each row belong to the image
+  uint16_t padded[18];
+  for (int i = 0; i < 18; i++)
+    padded[i] = (i % 6) < 4 ? (i / 6) * 4 + i % 6 + 100 : 0xFFFF;
+  img.loadImage(padded, 6 * sizeof(uint16_t), libCZI::IntSize{ 4, 3 }, 1);
+  for (int i = 0; i < 12; i++)
+    REQUIRE(memory[i] == i + 100);
+
+  REQUIRE_THROWS_AS(img.loadImage(packed, 2 * sizeof(uint16_t), libCZI::IntSize{ 4, 3 }, 1),
+                    StrideAssumptionException);
+}
+
+TEST_CASE("test_image_external_memory", "[ImageFactory_external_memory]")
+{
+  libCZI::CDimCoordinate cdim{ { libCZI::DimensionIndex::C, 0 } };
+  uint16_t packed[12];
+  for (int i = 0; i < 12; i++)
+    packed[i] = i;
+  std::vector<uint16_t> out(24, 0);
+  ImageFactory imageFactory(libCZI::PixelType::Gray16, 24, out.data());
+  imageFactory.constructImage(
+    packed, 4 * sizeof(uint16_t), libCZI::PixelType::Gray16, libCZI::IntSize{ 4, 3 }, &cdim, { 0, 0, 4, 3 }, 12, -1);
+  for (int i = 0; i < 12; i++) {
+    REQUIRE(out[i] == 0);
+    REQUIRE(out[i + 12] == i);
+  }
+  auto container = imageFactory.transferMemoryContainer();
+  auto typed = container->getBaseAsTyped<uint16_t>();
+  REQUIRE_FALSE(typed->ownsMemory());
+  REQUIRE(typed->releaseMemory() == nullptr);
+  REQUIRE(typed->getPointerAtIndex(12) == out.data() + 12);
+}
+
+TEST_CASE("test_image_vector_shape_from", "[ImageVector_shapeFrom]")
+{
+  std::vector<std::map<char, size_t>> indexes{ { { 'C', 0 }, { 'Z', 0 } }, { { 'C', 0 }, { 'Z', 1 } },
+                                               { { 'C', 1 }, { 'Z', 0 } }, { { 'C', 1 }, { 'Z', 1 } } };
+  auto shape = ImageVector::shapeFrom(indexes, { 3, 4 });
+  std::vector<std::pair<char, size_t>> expected{ { 'C', 2 }, { 'Z', 2 }, { 'Y', 3 }, { 'X', 4 } };
+  REQUIRE(shape == expected);
+}
+
+TEST_CASE("test_image_factory_slots", "[ImageFactory_slots]")
+{
+  uint16_t packed[12];
+  for (int i = 0; i < 12; i++)
+    packed[i] = i;
+  std::vector<libCZI::CDimCoordinate> planes{ { { libCZI::DimensionIndex::Z, 0 } },
+                                              { { libCZI::DimensionIndex::Z, 1 } },
+                                              { { libCZI::DimensionIndex::Z, 2 } } };
+  ImagesContainerBase::ImagesContainerBasePtr container;
+  {
+    ImageFactory imageFactory(libCZI::PixelType::Gray16, 36);
+    imageFactory.reserveSlots(3);
+    for (size_t slot : { 2, 0, 1 }) {
+      imageFactory.constructImage(packed, 4 * sizeof(uint16_t), libCZI::PixelType::Gray16, libCZI::IntSize{ 4, 3 },
+                                  &planes[slot], { 0, 0, 4, 3 }, slot * 12, -1, slot);
+    }
+    REQUIRE(imageFactory.numberOfImages() == 0); // not in the container until they're collected
+    REQUIRE_THROWS_AS(imageFactory.constructImage(packed, 4 * sizeof(uint16_t), libCZI::PixelType::Gray16,
+                                                  libCZI::IntSize{ 4, 3 }, &planes[0], { 0, 0, 4, 3 }, 0, -1, 0),
+                      std::out_of_range);
+    imageFactory.collectSlots();
+    container = imageFactory.transferMemoryContainer();
+  }
+  // the images outlive the factory and are in slot order
+  ImageVector& images = container->images();
+  REQUIRE(images.size() == 3);
+  for (size_t slot = 0; slot < 3; slot++) {
+    REQUIRE(images[slot]->coordinatePtr()->IsValid(libCZI::DimensionIndex::Z));
+    int z = -1;
+    images[slot]->coordinatePtr()->TryGetPosition(libCZI::DimensionIndex::Z, &z);
+    REQUIRE(z == static_cast<int>(slot));
+    REQUIRE(images[slot]->shape() == std::vector<size_t>{ 3, 4 });
+    auto typed = ImageFactory::getDerived<uint16_t>(images[slot]);
+    REQUIRE(typed->getRawPtr() == container->getBaseAsTyped<uint16_t>()->getPointerAtIndex(slot * 12));
+    REQUIRE((*typed)[{ 3, 2 }] == 11);
+  }
+  std::vector<std::pair<char, size_t>> expected{ { 'Z', 3 }, { 'Y', 3 }, { 'X', 4 } };
+  REQUIRE(container->shape() == expected);
+}
+
+TEST_CASE("test_image_factory_pixel_types", "[ImageFactory_pixel_types]")
+{
+  libCZI::CDimCoordinate cdim{ { libCZI::DimensionIndex::C, 0 } };
+  // Gray32 and the types libCZI can't decode are made like any other once their subblocks are read
+  std::uint32_t gray32[6] = { 0, 1, 2, 3, 4, 0xFFFFFFFF };
+  ImageFactory grayFactory(libCZI::PixelType::Gray32, 6);
+  auto grayImage = grayFactory.constructImage(gray32, 3 * sizeof(std::uint32_t), libCZI::PixelType::Gray32,
+                                              libCZI::IntSize{ 3, 2 }, &cdim, { 0, 0, 3, 2 }, 0, -1);
+  REQUIRE(grayImage->isTypeMatch<std::uint32_t>());
+  REQUIRE((*ImageFactory::getDerived<std::uint32_t>(grayImage))[{ 2, 1 }] == 0xFFFFFFFF);
+
+  std::uint8_t bgra[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  ImageFactory bgraFactory(libCZI::PixelType::Bgra32, 2);
+  auto bgraImage = bgraFactory.constructImage(
+    bgra, 2 * 4, libCZI::PixelType::Bgra32, libCZI::IntSize{ 2, 1 }, &cdim, { 0, 0, 2, 1 }, 0, -1);
+  REQUIRE(bgraImage->shape() == std::vector<size_t>{ 1, 2, 4 });
+  REQUIRE(bgraImage->pixelType() == libCZI::PixelType::Gray8);
+  REQUIRE(bgraFactory.numberOfImages() == 1);
+
+  double gray64[2] = { 0.5, -1.25 };
+  ImageFactory doubleFactory(libCZI::PixelType::Gray64Float, 2);
+  doubleFactory.constructImage(
+    gray64, 2 * sizeof(double), libCZI::PixelType::Gray64Float, libCZI::IntSize{ 2, 1 }, &cdim, { 0, 0, 2, 1 }, 0, -1);
+  auto container = doubleFactory.transferMemoryContainer();
+  REQUIRE(container->getBaseAsTyped<float>() == nullptr);
+  REQUIRE(container->getBaseAsTyped<double>()->getPointerAtIndex(0)[1] == -1.25);
+
+  // an image must have the pixel type of the factory it's made by
+  REQUIRE_THROWS_AS(grayFactory.constructImage(gray64, 2 * sizeof(double), libCZI::PixelType::Gray64Float,
+                                               libCZI::IntSize{ 2, 1 }, &cdim, { 0, 0, 2, 1 }, 0, -1),
+                    PixelTypeException);
+  REQUIRE(ImageFactory::sizeOfPixelType(libCZI::PixelType::Gray64ComplexFloat) == 8);
+  REQUIRE(ImageFactory::numberOfSamples(libCZI::PixelType::Bgr192ComplexFloat) == 3);
+  REQUIRE(ImageFactory::numberOfSamples(libCZI::PixelType::Invalid) == 0);
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/MosaicCompositor.h"
+
+using pylibczi::MosaicCompositor;
+
+namespace {
+using Tile = MosaicCompositor::Tile;
+
+// a decoder for Gray8 tiles where pixel (x, y) of the stored bitmap of every tile is value_(tile, x, y)
+MosaicCompositor::Decoder
+gray8Decoder(std::function<std::uint8_t(const Tile&, std::uint32_t, std::uint32_t)> value_,
+             std::atomic<int>* decodes_ = nullptr)
+{
+  return [value_, decodes_](const Tile& tile_) {
+    if (decodes_ != nullptr)
+      (*decodes_)++;
+    size_t stride = tile_.physicalSize.w + 5; // padded to test the stride
+    auto pixels = std::make_shared<std::vector<std::uint8_t>>(stride * tile_.physicalSize.h, 0);
+    for (std::uint32_t y = 0; y < tile_.physicalSize.h; y++)
+      for (std::uint32_t x = 0; x < tile_.physicalSize.w; x++)
+        (*pixels)[y * stride + x] = value_(tile_, x, y);
+    return MosaicCompositor::Pixels{ pixels, pixels->data(), stride, libCZI::PixelType::Gray8 };
+  };
+}
+
+Tile
+tileAt(int index_, int x_, int y_, int w_, int h_, int m_index_)
+{
+  return Tile{ index_, { x_, y_, w_, h_ }, { std::uint32_t(w_), std::uint32_t(h_) }, m_index_ };
+}
+
+std::uint8_t
+subblockValue(const Tile& tile_, std::uint32_t, std::uint32_t)
+{
+  return static_cast<std::uint8_t>(tile_.subblockIndex);
+}
+}
+
+TEST_CASE("test_compositor_overlap_order", "[MosaicCompositor]")
+{
+  libCZI::IntRect roi{ 0, 0, 15, 15 };
+  for (int topM : { 1, -2 }) {
+    std::vector<Tile> tiles{ tileAt(1, 0, 0, 10, 10, 0), tileAt(2, 5, 5, 10, 10, topM) };
+    MosaicCompositor compositor(roi, { 15, 15 }, libCZI::PixelType::Gray8, tiles);
+    std::vector<std::uint8_t> out(15 * 15, 99);
+    compositor.fill(out.data(), { 0.0f, 0.0f, 0.0f }, 1);
+    compositor.compose(out.data(), 2, gray8Decoder(subblockValue));
+    REQUIRE(out[2 * 15 + 2] == 1);
+    REQUIRE(out[2 * 15 + 12] == 0); // background
+    REQUIRE(out[12 * 15 + 12] == 2);
+    REQUIRE(out[7 * 15 + 7] == (topM == 1 ? 2 : 1)); // the higher M index is drawn on top
+  }
+}
+
+TEST_CASE("test_compositor_hidden_and_outside_tiles", "[MosaicCompositor]")
+{
+  std::vector<Tile> tiles{ tileAt(1, 2, 2, 4, 4, 0),
+                           tileAt(2, 0, 0, 10, 10, 1),
+                           tileAt(3, 20, 20, 10, 10, 0),
+                           tileAt(4, 3, 3, 4, 4, std::numeric_limits<int>::max()) }; // no M index, at the bottom
+  MosaicCompositor compositor({ 0, 0, 10, 10 }, { 10, 10 }, libCZI::PixelType::Gray8, tiles);
+  REQUIRE(compositor.numberOfTiles() == 1); // 1 and 4 are covered by 2, 3 is outside
+  std::atomic<int> decodes{ 0 };
+  std::vector<std::uint8_t> out(100, 0);
+  compositor.compose(out.data(), 1, gray8Decoder(subblockValue, &decodes));
+  REQUIRE(decodes == 1);
+  REQUIRE(std::all_of(out.begin(), out.end(), [](std::uint8_t v_) { return v_ == 2; }));
+}
+
+TEST_CASE("test_compositor_scaling", "[MosaicCompositor]")
+{
+  // the pixels are their plane x coordinate
+  auto xValue = [](const Tile& tile_, std::uint32_t x_, std::uint32_t) {
+    return static_cast<std::uint8_t>(tile_.logicalRect.x + x_);
+  };
+  std::vector<Tile> tiles{ tileAt(0, 100, 50, 20, 20, 0) };
+  MosaicCompositor half({ 100, 50, 20, 20 }, { 10, 10 }, libCZI::PixelType::Gray8, tiles);
+  std::vector<std::uint8_t> out(100, 0);
+  half.compose(out.data(), 1, gray8Decoder(xValue));
+  for (int x = 0; x < 10; x++)
+    REQUIRE(out[5 * 10 + x] == 100 + 2 * x + 1); // nearest neighbour at the centre of the output pixel
+
+  // a pyramid tile stores a 20 x 20 region in 10 x 10 pixels
+  std::vector<Tile> pyramid{ Tile{ 0, { 100, 50, 20, 20 }, { 10, 10 }, 0 } };
+  MosaicCompositor full({ 100, 50, 20, 20 }, { 20, 20 }, libCZI::PixelType::Gray8, pyramid);
+  std::vector<std::uint8_t> big(400, 0);
+  full.compose(big.data(), 1, gray8Decoder(xValue));
+  for (int x = 0; x < 20; x++)
+    REQUIRE(big[3 * 20 + x] == 100 + x / 2);
+}
+
+TEST_CASE("test_compositor_matches_painter", "[MosaicCompositor]")
+{
+  // a grid of overlapping tiles with random M indexes, composited in parallel and by drawing them in order
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<int> mIndex(0, 3), jitter(-3, 3);
+  std::vector<Tile> tiles;
+  for (int row = 0; row < 12; row++)
+    for (int column = 0; column < 12; column++)
+      tiles.push_back(tileAt(static_cast<int>(tiles.size()),
+                             column * 18 + jitter(generator),
+                             row * 18 + jitter(generator),
+                             20 + jitter(generator),
+                             20,
+                             mIndex(generator)));
+  libCZI::IntRect roi{ 5, 5, 200, 190 };
+  for (auto size : { libCZI::IntSize{ 200, 190 }, libCZI::IntSize{ 73, 61 } }) {
+    std::vector<Tile> order(tiles);
+    std::stable_sort(
+      order.begin(), order.end(), [](const Tile& a_, const Tile& b_) { return a_.mIndex < b_.mIndex; });
+    std::vector<std::uint8_t> expected(size.w * size.h, 255);
+    for (const auto& tile : order) {
+      for (std::uint32_t y = 0; y < size.h; y++)
+        for (std::uint32_t x = 0; x < size.w; x++) {
+          int planeX = roi.x + static_cast<int>((2 * x + 1) * roi.w / (2 * size.w));
+          int planeY = roi.y + static_cast<int>((2 * y + 1) * roi.h / (2 * size.h));
+          const auto& r = tile.logicalRect;
+          if (r.x <= planeX && planeX < r.x + r.w && r.y <= planeY && planeY < r.y + r.h)
+            expected[y * size.w + x] = static_cast<std::uint8_t>(tile.subblockIndex);
+        }
+    }
+
+    MosaicCompositor compositor(roi, size, libCZI::PixelType::Gray8, tiles);
+    std::vector<std::uint8_t> out(size.w * size.h, 0);
+    compositor.fill(out.data(), { 1.0f, 1.0f, 1.0f }, 0);
+    compositor.compose(out.data(), 0, gray8Decoder(subblockValue));
+    REQUIRE(out == expected);
+  }
+}
+
+TEST_CASE("test_compositor_fill", "[MosaicCompositor]")
+{
+  MosaicCompositor bgr({ 0, 0, 4, 3 }, { 4, 3 }, libCZI::PixelType::Bgr24, {});
+  REQUIRE(bgr.stride() == 12);
+  std::vector<std::uint8_t> out(36, 0);
+  bgr.fill(out.data(), { 1.0f, 0.5f, 0.0f }, 2);
+  for (size_t i = 0; i < 12; i++) {
+    REQUIRE(out[3 * i] == 0);
+    REQUIRE(out[3 * i + 1] == 128);
+    REQUIRE(out[3 * i + 2] == 255);
+  }
+
+  MosaicCompositor gray({ 0, 0, 4, 3 }, { 4, 3 }, libCZI::PixelType::Gray16, {});
+  std::vector<std::uint16_t> pixels(12, 7);
+  gray.fill(pixels.data(), { std::nanf(""), 0.0f, 0.0f }, 1); // NaN means no background
+  REQUIRE(pixels[11] == 7);
+  gray.fill(pixels.data(), { 1.0f, 0.0f, 0.0f }, 1);
+  REQUIRE(pixels[11] == 65535);
+}
+
+TEST_CASE("test_compositor_fill_uncovered", "[MosaicCompositor]")
+{
+  std::vector<Tile> tiles{ tileAt(1, 0, 0, 4, 4, 0), tileAt(2, 6, 6, 4, 4, 1) };
+  MosaicCompositor compositor({ 0, 0, 10, 10 }, { 10, 10 }, libCZI::PixelType::Gray8, tiles);
+  std::vector<std::uint8_t> out(100, 99); // eg a preview drawn before the tiles
+  compositor.fillUncovered(out.data(), { 0.0f, 0.0f, 0.0f });
+  REQUIRE(out[2 * 10 + 2] == 99);
+  REQUIRE(out[7 * 10 + 7] == 99);
+  REQUIRE(out[2 * 10 + 7] == 0);
+  REQUIRE(out[5 * 10 + 5] == 0);
+  REQUIRE(std::count(out.begin(), out.end(), 0) == 100 - 2 * 16);
+
+  compositor.compose(out.data(), 2, gray8Decoder(subblockValue));
+  std::vector<std::uint8_t> expected(100, 7);
+  compositor.fill(expected.data(), { 0.0f, 0.0f, 0.0f }, 1);
+  compositor.compose(expected.data(), 1, gray8Decoder(subblockValue));
+  REQUIRE(out == expected);
+}
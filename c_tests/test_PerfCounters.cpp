@@ -0,0 +1,114 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/PerfCounters.h"
+#include "../_aicspylibczi/Threadpool.h"
+
+using pylibczi::PerfCounters;
+
+TEST_CASE("test_perf_counters_disabled", "[PerfCounters]")
+{
+  PerfCounters counters;
+  REQUIRE_FALSE(counters.enabled());
+  {
+    PerfCounters::Scope timed(counters, PerfCounters::Timer::ReadSelected);
+  }
+  counters.addStreamRead(counters.start(), 100);
+  counters.addDecode(5, counters.start());
+  counters.addCacheLookup(true);
+  auto stats = counters.statistics();
+  REQUIRE_FALSE(stats.enabled);
+  REQUIRE(stats.readSelected.calls == 0);
+  REQUIRE(stats.streamRead.calls == 0);
+  REQUIRE(stats.streamBytes == 0);
+  REQUIRE(stats.decode.empty());
+  REQUIRE(stats.tileCacheHits == 0);
+  REQUIRE(stats.workerBusyNs.size() == pylibczi::ThreadPool::instance().size() + 1);
+}
+
+#ifndef PYLIBCZI_NO_PERF_COUNTERS
+TEST_CASE("test_perf_counters_count", "[PerfCounters]")
+{
+  PerfCounters counters;
+  counters.setEnabled(true);
+  REQUIRE(counters.enabled());
+  for (int i = 0; i < 3; i++) {
+    PerfCounters::Scope timed(counters, PerfCounters::Timer::Matches);
+  }
+  counters.addStreamRead(counters.start(), 100);
+  counters.addStreamRead(counters.start(), 28);
+  counters.addDecode(5, counters.start());
+  counters.addDecode(4, counters.start());
+  counters.addDecode(5, counters.start());
+  counters.addDecode(200, counters.start()); // an unknown compression
+  counters.addCacheLookup(true);
+  counters.addCacheLookup(false);
+  counters.addCacheLookup(false);
+
+  auto stats = counters.statistics();
+  REQUIRE(stats.enabled);
+  REQUIRE(stats.matches.calls == 3);
+  REQUIRE(stats.readMosaic.calls == 0);
+  REQUIRE(stats.streamRead.calls == 2);
+  REQUIRE(stats.streamBytes == 128);
+  REQUIRE(stats.decode.size() == 3);
+  REQUIRE(stats.decode[0].first == 4);
+  REQUIRE(stats.decode[0].second.calls == 1);
+  REQUIRE(stats.decode[1].first == 5);
+  REQUIRE(stats.decode[1].second.calls == 2);
+  REQUIRE(stats.decode[2].first == -1);
+  REQUIRE(stats.tileCacheHits == 1);
+  REQUIRE(stats.tileCacheMisses == 2);
+
+  // a timing started while the counters were disabled adds no time
+  counters.setEnabled(false);
+  PerfCounters::Clock::time_point start = counters.start();
+  counters.setEnabled(true);
+  counters.add(PerfCounters::Timer::Copy, start);
+  REQUIRE(counters.statistics().copy.calls == 1);
+  REQUIRE(counters.statistics().copy.ns == 0);
+
+  counters.reset();
+  stats = counters.statistics();
+  REQUIRE(stats.enabled);
+  REQUIRE(stats.matches.calls == 0);
+  REQUIRE(stats.streamBytes == 0);
+  REQUIRE(stats.decode.empty());
+  REQUIRE(stats.tileCacheMisses == 0);
+}
+
+TEST_CASE("test_perf_counters_parallel", "[PerfCounters]")
+{
+  PerfCounters counters;
+  counters.setEnabled(true);
+  auto& pool = pylibczi::ThreadPool::instance();
+  std::atomic<size_t> calls{ 0 };
+  auto work = [&calls](size_t) {
+    volatile std::uint64_t sum = 0;
+    for (int i = 0; i < 100000; i++)
+      sum = sum + i;
+    calls++;
+  };
+  pool.parallelFor(64, 0, counters.parallel(work));
+  REQUIRE(calls == 64);
+
+  auto stats = counters.statistics();
+  std::uint64_t busy = 0;
+  for (auto ns : stats.workerBusyNs)
+    busy += ns;
+  REQUIRE(busy > 0);
+  REQUIRE(stats.workerBusyNs.back() > 0); // the calling thread works on the loop too
+  // every thread that took part waited once, at least the calling thread did
+  REQUIRE(stats.queueWait.calls >= 1);
+  REQUIRE(stats.queueWait.calls <= pool.size() + 1);
+
+  // an exception still counts the busy time and reaches the caller
+  counters.reset();
+  auto failing = [](size_t) { throw std::runtime_error("failed"); };
+  REQUIRE_THROWS_AS(pool.parallelFor(1, 1, counters.parallel(failing)), std::runtime_error);
+  REQUIRE(counters.statistics().queueWait.calls == 1);
+}
+#endif
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/ImageFactory.h"
+#include "../_aicspylibczi/PixelConversion.h"
+#include "../_aicspylibczi/Reader.h"
+
+using pylibczi::PixelConversion;
+
+TEST_CASE("test_pixel_conversion_output_type", "[PixelConversion]")
+{
+  PixelConversion conversion;
+  REQUIRE(conversion.isDefault());
+  REQUIRE(conversion.outputType(libCZI::PixelType::Bgr48) == libCZI::PixelType::Bgr48);
+  REQUIRE_FALSE(conversion.converterFor(libCZI::PixelType::Bgr48)); // a plain copy
+
+  conversion.sample = PixelConversion::Sample::Uint8;
+  REQUIRE(conversion.outputType(libCZI::PixelType::Bgr48) == libCZI::PixelType::Bgr24);
+  REQUIRE(conversion.outputType(libCZI::PixelType::Gray64Float) == libCZI::PixelType::Gray8);
+  REQUIRE(conversion.outputType(libCZI::PixelType::Bgra32) == libCZI::PixelType::Bgra32);
+  REQUIRE_FALSE(conversion.converterFor(libCZI::PixelType::Gray8)); // uint8 to uint8 without a window
+  REQUIRE_THROWS_AS(conversion.outputType(libCZI::PixelType::Gray64ComplexFloat), pylibczi::PixelTypeException);
+
+  conversion.sample = PixelConversion::Sample::Float32;
+  REQUIRE(conversion.outputType(libCZI::PixelType::Gray16) == libCZI::PixelType::Gray32Float);
+  REQUIRE(conversion.outputType(libCZI::PixelType::Bgr24) == libCZI::PixelType::Bgr96Float);
+  REQUIRE_THROWS_AS(conversion.outputType(libCZI::PixelType::Bgra32), pylibczi::PixelTypeException);
+
+  conversion = PixelConversion();
+  conversion.rgb = true;
+  REQUIRE_FALSE(conversion.converterFor(libCZI::PixelType::Gray16)); // gray pixels have nothing to reorder
+  REQUIRE(conversion.converterFor(libCZI::PixelType::Bgr24));
+}
+
+TEST_CASE("test_pixel_conversion_convert", "[PixelConversion]")
+{
+  // 2 x 2 BGR pixels in rows padded to 8 samples, the padding holds 0xFFFF
+  std::vector<std::uint16_t> bgr{ 1000, 2000, 3000, 0, 65535, 500, 0xFFFF, 0xFFFF,
+                                  1500, 1000, 4000, 2000, 2000, 2000, 0xFFFF, 0xFFFF };
+  PixelConversion conversion;
+  conversion.rgb = true;
+  conversion.sample = PixelConversion::Sample::Uint8;
+  conversion.low = 1000;
+  conversion.high = 3000;
+  auto converter = conversion.converterFor(libCZI::PixelType::Bgr48);
+  std::vector<std::uint8_t> rgb(12, 0);
+  converter.convert(bgr.data(), 8 * sizeof(std::uint16_t), libCZI::IntSize{ 2, 2 }, rgb.data());
+  // R and B swap, the window is mapped to 0 - 255 and the values outside it are clamped
+  std::vector<std::uint8_t> expected{ 255, 128, 0, 0, 255, 0, 255, 0, 64, 128, 128, 128 };
+  REQUIRE(rgb == expected);
+
+  REQUIRE_THROWS_AS(converter.convert(bgr.data(), 4 * sizeof(std::uint16_t), libCZI::IntSize{ 2, 2 }, rgb.data()),
+                    pylibczi::StrideAssumptionException);
+
+  // long enough for the vector loops and their remainders, the rows are packed so it's converted in one go
+  std::vector<std::uint16_t> gray(1000);
+  for (size_t i = 0; i < gray.size(); i++)
+    gray[i] = static_cast<std::uint16_t>(i * 65);
+  PixelConversion normalize;
+  normalize.sample = PixelConversion::Sample::Float32;
+  std::vector<float> normalized(gray.size());
+  normalize.converterFor(libCZI::PixelType::Gray16)
+    .convert(gray.data(), 100 * sizeof(std::uint16_t), libCZI::IntSize{ 100, 10 }, normalized.data());
+  for (size_t i = 0; i < gray.size(); i++)
+    REQUIRE(std::abs(normalized[i] - gray[i] / 65535.0f) < 1e-6f);
+}
+
+TEST_CASE("test_pixel_conversion_float_specials", "[PixelConversion]")
+{
+  // NaN and infinities become 0 and 255 rather than undefined int casts, in the vector loops and their remainder
+  const float specials[] = { std::nanf(""), INFINITY, -INFINITY, 0.5f, 2.0f, -1.0f };
+  std::vector<float> gray(6 * 7);
+  for (size_t i = 0; i < gray.size(); i++)
+    gray[i] = specials[i % 6];
+  PixelConversion conversion;
+  conversion.sample = PixelConversion::Sample::Uint8;
+  std::vector<std::uint8_t> out(gray.size(), 1);
+  conversion.converterFor(libCZI::PixelType::Gray32Float)
+    .convert(gray.data(), 6 * sizeof(float), libCZI::IntSize{ 6, 7 }, out.data());
+  const std::uint8_t expected[] = { 0, 255, 0, 128, 255, 0 };
+  for (size_t i = 0; i < out.size(); i++)
+    REQUIRE(out[i] == expected[i % 6]);
+}
+
+TEST_CASE("test_pixel_conversion_read", "[PixelConversion]")
+{
+  pylibczi::Reader czi(L"resources/s_3_t_1_c_3_z_5.czi");
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 } };
+  auto plain = czi.readSelected(plane, -1, 2);
+  const std::uint16_t* source = plain.first->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+
+  PixelConversion conversion;
+  conversion.sample = PixelConversion::Sample::Uint8;
+  conversion.low = 100;
+  conversion.high = 1100;
+  auto shape = czi.selectedShape(plane, -1, { 0, 0, -1, -1 }, conversion);
+  REQUIRE(shape.first == libCZI::PixelType::Gray8);
+  REQUIRE(shape.second == plain.second);
+
+  auto converted = czi.readSelected(plane, -1, 2, { 0, 0, -1, -1 }, nullptr, 0, conversion);
+  REQUIRE(converted.second == plain.second);
+  REQUIRE(converted.first->pixelType() == libCZI::PixelType::Gray8);
+  REQUIRE(converted.first->getBaseAsTyped<std::uint16_t>() == nullptr);
+  const std::uint8_t* target = converted.first->getBaseAsTyped<std::uint8_t>()->getPointerAtIndex(0);
+  size_t samples = 5 * 325 * 475;
+  for (size_t i = 0; i < samples; i++) {
+    // within 1 of the exact value, the kernels round in float and may contract to fused multiply-adds
+    float value = std::min(std::max((source[i] - 100.0f) * 255.0f / 1000.0f, 0.0f), 255.0f);
+    REQUIRE(std::abs(target[i] - value) <= 1.0f);
+  }
+
+  // the images are converted into a buffer sized for the converted type
+  std::vector<std::uint8_t> out(samples);
+  REQUIRE_THROWS_AS(czi.readSelected(plane, -1, 2, { 0, 0, -1, -1 }, out.data(), samples - 1, conversion),
+                    pylibczi::OutputBufferException);
+  czi.readSelected(plane, -1, 2, { 0, 0, -1, -1 }, out.data(), samples, conversion);
+  REQUIRE(std::equal(out.begin(), out.end(), target));
+}
@@ -0,0 +1,101 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/ImagesContainer.h"
+#include "../_aicspylibczi/PixelMemory.h"
+#include "../_aicspylibczi/exceptions.h"
+
+using pylibczi::PixelMemory;
+
+namespace {
+void
+requireWritable(const PixelMemory& memory_)
+{
+  auto bytes = static_cast<std::uint8_t*>(memory_.data());
+  REQUIRE(bytes != nullptr);
+  std::memset(bytes, 0xAB, memory_.bytes());
+  REQUIRE(bytes[0] == 0xAB);
+  REQUIRE(bytes[memory_.bytes() - 1] == 0xAB);
+}
+}
+
+TEST_CASE("test_pixel_memory_default", "[PixelMemory_default]")
+{
+  PixelMemory memory(1000);
+  REQUIRE(memory.bytes() == 1000);
+  REQUIRE_FALSE(memory.hasHugePages());
+  REQUIRE_FALSE(memory.isPinned());
+  requireWritable(memory);
+}
+
+TEST_CASE("test_pixel_memory_policies", "[PixelMemory_policies]")
+{
+  PixelMemory::Policy huge;
+  huge.hugePages = true; // falls back to normal pages if none are reserved
+  PixelMemory hugeMemory(3 << 20, huge);
+  requireWritable(hugeMemory);
+
+  PixelMemory::Policy interleave;
+  interleave.numa = PixelMemory::Numa::Interleave;
+  PixelMemory interleaved(1 << 20, interleave);
+  requireWritable(interleaved);
+
+  PixelMemory::Policy touch;
+  touch.numa = PixelMemory::Numa::FirstTouch;
+  PixelMemory touched((9 << 20) + 3, touch, 2);
+  // the pool faulted every page in by zeroing it
+  auto bytes = static_cast<const std::uint8_t*>(touched.data());
+  std::vector<std::uint8_t> zeros(touched.bytes(), 0);
+  REQUIRE(std::memcmp(bytes, zeros.data(), zeros.size()) == 0);
+  requireWritable(touched);
+}
+
+TEST_CASE("test_pixel_memory_pinned", "[PixelMemory_pinned]")
+{
+  PixelMemory::Policy pinned;
+  pinned.pinned = true;
+  try {
+    PixelMemory memory(4096, pinned);
+    REQUIRE(memory.isPinned());
+    requireWritable(memory);
+  } catch (const pylibczi::ImageCopyAllocFailed&) {
+    // the locked memory limit is too low on this machine, the failure must be reported rather than ignored
+  }
+}
+
+TEST_CASE("test_pixel_memory_container", "[PixelMemory_container]")
+{
+  PixelMemory::Policy policy;
+  policy.numa = PixelMemory::Numa::FirstTouch;
+  libCZI::PixelType pixelType = libCZI::PixelType::Gray16;
+  auto container = pylibczi::ImagesContainerBase::getTypedAsBase(pixelType, 100, nullptr, policy);
+  auto typed = container->getBaseAsTyped<std::uint16_t>();
+  REQUIRE(typed->ownsMemory());
+  std::uint16_t* pixels = typed->getPointerAtIndex();
+  pixels[99] = 7;
+  auto memory = typed->releaseMemory();
+  REQUIRE_FALSE(typed->ownsMemory());
+  REQUIRE(memory->data() == pixels);
+  REQUIRE(memory->bytes() == 100 * sizeof(std::uint16_t));
+  REQUIRE(static_cast<std::uint16_t*>(memory->data())[99] == 7);
+}
+
+TEST_CASE("test_pixel_memory_file", "[PixelMemory_file]")
+{
+  PixelMemory::Policy file;
+  file.fileDirectory = ".";
+  file.numa = PixelMemory::Numa::FirstTouch; // doesn't apply to a file
+  {
+    PixelMemory memory((5 << 20) + 7, file, 2);
+    REQUIRE(memory.isFileBacked());
+    REQUIRE(memory.bytes() == (5 << 20) + 7);
+    requireWritable(memory);
+  }
+
+  file.fileDirectory = "./no/such/directory";
+  REQUIRE_THROWS_AS(PixelMemory(4096, file), pylibczi::ImageCopyAllocFailed);
+  REQUIRE_FALSE(PixelMemory(4096).isFileBacked());
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/PixelStatistics.h"
+#include "../_aicspylibczi/Reader.h"
+#include "PaddedSubblocks.h"
+
+using pylibczi::PixelStatistics;
+using pylibczi::StatisticsAccumulator;
+using pylibczi::StatisticsOptions;
+
+TEST_CASE("test_statistics_accumulate", "[PixelStatistics]")
+{
+  std::vector<std::vector<std::uint16_t>> subblocks = paddedGray16Subblocks(6);
+
+  // subblocks 0 - 3 are counted in group 0 and 4 - 5 in group 1, from 3 threads so there are partials
+  StatisticsOptions options;
+  options.bins = 4;
+  options.low = 0;
+  options.high = 40;
+  StatisticsAccumulator accumulator(options, libCZI::PixelType::Gray16, 2);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 3; t++) {
+    threads.emplace_back([&accumulator, &subblocks, t]() {
+      for (size_t i = t; i < subblocks.size(); i += 3)
+        accumulator.accumulate(i < 4 ? 0 : 1, subblocks[i].data(), 4 * sizeof(std::uint16_t), { 3, 2 });
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  PixelStatistics statistics;
+  accumulator.finish(statistics);
+
+  REQUIRE(statistics.numberOfGroups() == 2);
+  REQUIRE(statistics.count == std::vector<std::uint64_t>{ 24, 12 });
+  REQUIRE(statistics.min == std::vector<double>{ 0, 40 });
+  REQUIRE(statistics.max == std::vector<double>{ 35, 55 });
+  // each subblock i sums to 60 * i + 15 and its squares to 600 * i * i + 300 * i + 55
+  REQUIRE(statistics.sum == std::vector<double>{ 420, 570 });
+  REQUIRE(statistics.sumOfSquares == std::vector<double>{ 10420, 27410 });
+  // 10 values to a bin, the samples from 40 up are counted in the last
+  REQUIRE(statistics.histogram == std::vector<std::uint64_t>{ 6, 6, 6, 6, 0, 0, 0, 12 });
+  REQUIRE(statistics.low == 0);
+  REQUIRE(statistics.high == 40);
+
+  // floats have the range [0, 1) by default, a group nothing was counted in has no min or max
+  std::vector<float> gray{ -1.0f, 0.1f, 0.6f, 2.0f };
+  StatisticsOptions halves;
+  halves.bins = 2;
+  StatisticsAccumulator floats(halves, libCZI::PixelType::Gray32Float, 2);
+  floats.accumulate(1, gray.data(), gray.size() * sizeof(float), { 4, 1 });
+  floats.finish(statistics);
+  REQUIRE(statistics.high == 1);
+  REQUIRE(std::isnan(statistics.min[0]));
+  REQUIRE(statistics.min[1] == -1.0);
+  REQUIRE(statistics.max[1] == 2.0);
+  REQUIRE(statistics.histogram == std::vector<std::uint64_t>{ 0, 0, 2, 2 });
+
+  // the samples of BGR pixels are counted together
+  std::vector<std::uint8_t> bgr{ 1, 2, 3, 250, 251, 252 };
+  StatisticsAccumulator pixels(StatisticsOptions(), libCZI::PixelType::Bgr24, 1);
+  pixels.accumulate(0, bgr.data(), bgr.size(), { 2, 1 });
+  pixels.finish(statistics);
+  REQUIRE(statistics.count[0] == 6);
+  REQUIRE(statistics.histogram[2] == 1);
+  REQUIRE(statistics.histogram[252] == 1);
+
+  StatisticsOptions noBins;
+  noBins.bins = 0;
+  REQUIRE_THROWS_AS(StatisticsAccumulator(noBins, libCZI::PixelType::Gray16, 1), std::invalid_argument);
+  REQUIRE_THROWS_AS(StatisticsAccumulator(options, libCZI::PixelType::Gray64ComplexFloat, 1),
+                    pylibczi::PixelTypeException);
+  REQUIRE_THROWS_AS(accumulator.accumulate(0, subblocks[0].data(), 4, { 3, 2 }), pylibczi::StrideAssumptionException);
+}
+
+TEST_CASE("test_reader_statistics", "[PixelStatistics]")
+{
+  pylibczi::Reader czi(L"resources/s_3_t_1_c_3_z_5.czi");
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 } };
+  PixelStatistics statistics;
+  auto stack = czi.readSelected(plane, -1, 4, { 0, 0, -1, -1 }, nullptr, 0, pylibczi::PixelConversion(), &statistics);
+  const std::uint16_t* stackPixels = stack.first->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+
+  // one group per plane of the CZYX stack
+  pylibczi::Reader::Shape planes{ { 'B', 1 }, { 'S', 1 }, { 'C', 3 }, { 'Z', 5 } };
+  REQUIRE(statistics.shape == planes);
+  REQUIRE(statistics.numberOfGroups() == 15);
+  size_t planePixels = 325 * 475;
+  for (size_t p = 0; p < 15; p++) {
+    const std::uint16_t* first = stackPixels + p * planePixels;
+    REQUIRE(statistics.min[p] == *std::min_element(first, first + planePixels));
+    REQUIRE(statistics.max[p] == *std::max_element(first, first + planePixels));
+    REQUIRE(statistics.sum[p] == std::accumulate(first, first + planePixels, 0.0));
+    REQUIRE(statistics.count[p] == planePixels);
+    std::vector<std::uint64_t> histogram(256, 0);
+    for (size_t i = 0; i < planePixels; i++)
+      histogram[first[i] / 256]++;
+    REQUIRE(std::equal(histogram.begin(), histogram.end(), statistics.histogram.begin() + p * 256));
+  }
+
+  // only the statistics, by channel and of a region
+  StatisticsOptions options;
+  options.group = StatisticsOptions::Group::Channel;
+  libCZI::IntRect roi{ 10, 20, 30, 40 };
+  PixelStatistics channels = czi.readStatistics(plane, options, -1, 4, roi);
+  REQUIRE(channels.shape == pylibczi::Reader::Shape{ { 'C', 3 } });
+  for (size_t c = 0; c < 3; c++) {
+    double sum = 0;
+    for (size_t z = 0; z < 5; z++) {
+      for (size_t y = 20; y < 60; y++) {
+        const std::uint16_t* row = stackPixels + (c * 5 + z) * planePixels + y * 475;
+        sum += std::accumulate(row + 10, row + 40, 0.0);
+      }
+    }
+    REQUIRE(channels.sum[c] == sum);
+    REQUIRE(channels.count[c] == 5 * 30 * 40);
+  }
+
+  options.high = -1;
+  REQUIRE_THROWS_AS(czi.readStatistics(plane, options), std::invalid_argument);
+}
@@ -0,0 +1,99 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/PlaneIterator.h"
+#include "../_aicspylibczi/exceptions.h"
+
+using pylibczi::PlaneIterator;
+
+namespace {
+// a group without images, its shape records the group index
+PlaneIterator::Planes
+groupNumber(size_t group_)
+{
+  PlaneIterator::Planes planes;
+  planes.second.emplace_back('T', group_);
+  return planes;
+}
+}
+
+TEST_CASE("test_plane_iterator_read_ahead", "[PlaneIterator]")
+{
+  std::atomic<size_t> started{ 0 }, taken{ 0 }, furthestAhead{ 0 };
+  std::atomic<bool> inOrder{ true };
+  {
+    PlaneIterator planes(20, 3, [&](size_t group_) {
+      if (group_ != started++)
+        inOrder = false;
+      size_t ahead = started - taken;
+      if (ahead > furthestAhead)
+        furthestAhead = ahead;
+      return groupNumber(group_);
+    });
+    REQUIRE(planes.numberOfGroups() == 20);
+    for (size_t i = 0; i < 20; i++) {
+      REQUIRE(planes.hasNext());
+      if (i % 5 == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5)); // a slow consumer, the reads have to wait
+      auto group = planes.next();
+      taken++;
+      REQUIRE(group.second.front().second == i);
+    }
+    REQUIRE_FALSE(planes.hasNext());
+    REQUIRE_THROWS_AS(planes.next(), pylibczi::ImageIteratorException);
+  }
+  REQUIRE(inOrder);
+  REQUIRE(started == 20);
+  REQUIRE(furthestAhead <= 3 + 1); // the groups waiting and the one being read
+}
+
+TEST_CASE("test_plane_iterator_inline", "[PlaneIterator]")
+{
+  auto caller = std::this_thread::get_id();
+  std::atomic<bool> sameThread{ true };
+  PlaneIterator planes(4, 0, [&](size_t group_) {
+    if (std::this_thread::get_id() != caller)
+      sameThread = false;
+    return groupNumber(group_);
+  });
+  size_t count = 0;
+  while (planes.hasNext())
+    REQUIRE(planes.next().second.front().second == count++);
+  REQUIRE(count == 4);
+  REQUIRE(sameThread);
+}
+
+TEST_CASE("test_plane_iterator_errors", "[PlaneIterator]")
+{
+  for (size_t inFlight : { 0, 2 }) {
+    std::atomic<size_t> reads{ 0 };
+    PlaneIterator planes(10, inFlight, [&](size_t group_) {
+      reads++;
+      if (group_ == 2)
+        throw std::runtime_error("unreadable");
+      return groupNumber(group_);
+    });
+    planes.next();
+    planes.next();
+    REQUIRE_THROWS_AS(planes.next(), std::runtime_error);
+    REQUIRE_FALSE(planes.hasNext()); // the iteration ends at the error
+    REQUIRE(reads == 3);
+  }
+}
+
+TEST_CASE("test_plane_iterator_abandoned", "[PlaneIterator]")
+{
+  std::atomic<size_t> reads{ 0 };
+  {
+    PlaneIterator planes(1000, 4, [&](size_t group_) {
+      reads++;
+      return groupNumber(group_);
+    });
+    planes.next();
+  } // destroyed with groups left, the thread reading ahead stops
+  REQUIRE(reads <= 1 + 4 + 1);
+}
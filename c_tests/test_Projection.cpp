@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Projection.h"
+#include "../_aicspylibczi/Reader.h"
+#include "PaddedSubblocks.h"
+
+using pylibczi::Projection;
+
+TEST_CASE("test_projection_accumulate", "[Projection]")
+{
+  std::vector<std::vector<std::uint16_t>> subblocks = paddedGray16Subblocks(6);
+
+  // subblocks 0 - 3 are projected into plane 0 and 4 - 5 into plane 1, from 3 threads so there are partials
+  auto project = [&subblocks](Projection::Mode mode_) {
+    Projection projection(mode_, libCZI::PixelType::Gray16, libCZI::IntSize{ 3, 2 }, { 4, 2 });
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 3; t++) {
+      threads.emplace_back([&projection, &subblocks, t]() {
+        for (size_t i = t; i < subblocks.size(); i += 3)
+          projection.accumulate(i < 4 ? 0 : 1, subblocks[i].data(), 4 * sizeof(std::uint16_t), { 3, 2 });
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    return projection.finish(2);
+  };
+
+  auto max = project(Projection::Mode::Max);
+  REQUIRE(max->pixelType() == libCZI::PixelType::Gray16);
+  const std::uint16_t* maxPixels = max->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+  REQUIRE(std::vector<std::uint16_t>(maxPixels, maxPixels + 12) ==
+          std::vector<std::uint16_t>{ 30, 31, 32, 33, 34, 35, 50, 51, 52, 53, 54, 55 });
+
+  auto mean = project(Projection::Mode::Mean);
+  REQUIRE(mean->pixelType() == libCZI::PixelType::Gray64Float);
+  const double* meanPixels = mean->getBaseAsTyped<double>()->getPointerAtIndex(0);
+  REQUIRE(std::vector<double>(meanPixels, meanPixels + 12) ==
+          std::vector<double>{ 15, 16, 17, 18, 19, 20, 45, 46, 47, 48, 49, 50 });
+
+  auto sum = project(Projection::Mode::Sum);
+  const double* sumPixels = sum->getBaseAsTyped<double>()->getPointerAtIndex(0);
+  REQUIRE(sumPixels[0] == 60);
+  REQUIRE(sumPixels[11] == 100);
+
+  Projection projection(Projection::Mode::Max, libCZI::PixelType::Gray16, libCZI::IntSize{ 3, 2 }, { 1 });
+  REQUIRE_THROWS_AS(projection.accumulate(0, subblocks[0].data(), 8, { 4, 2 }), pylibczi::RegionSelectionException);
+  REQUIRE_THROWS_AS(projection.accumulate(0, subblocks[0].data(), 4, { 3, 2 }), pylibczi::StrideAssumptionException);
+  REQUIRE_THROWS_AS(Projection::outputType(Projection::Mode::Sum, libCZI::PixelType::Gray64ComplexFloat),
+                    pylibczi::PixelTypeException);
+  REQUIRE(Projection::outputType(Projection::Mode::Mean, libCZI::PixelType::Bgr24) ==
+          libCZI::PixelType::Gray64Float);
+}
+
+TEST_CASE("test_projection_bins", "[Projection]")
+{
+  // a 5 x 3 gray16 subblock in rows padded to 6 samples, binned 2 x 2 the last column and row are dropped
+  std::vector<std::uint16_t> gray{ 1, 2, 3, 4, 100, 0, 5, 6, 7, 8, 100, 0, 100, 100, 100, 100, 100, 0 };
+  Projection mean(Projection::Mode::Mean, libCZI::PixelType::Gray16, { 5, 3 }, { 2 }, 2, 2);
+  REQUIRE(mean.binnedSize().w == 2);
+  REQUIRE(mean.binnedSize().h == 1);
+  mean.accumulate(0, gray.data(), 6 * sizeof(std::uint16_t), { 5, 3 });
+  mean.accumulate(0, gray.data(), 6 * sizeof(std::uint16_t), { 5, 3 });
+  auto means = mean.finish(1);
+  const double* meanPixels = means->getBaseAsTyped<double>()->getPointerAtIndex(0);
+  REQUIRE(meanPixels[0] == 3.5);
+  REQUIRE(meanPixels[1] == 5.5);
+
+  // the samples of each pixel are binned apart, only rows are binned without a column factor
+  std::vector<std::uint8_t> bgr{ 1, 2, 3, 9, 8, 7, 4, 5, 6, 0, 0, 10 };
+  Projection columns(Projection::Mode::Max, libCZI::PixelType::Bgr24, { 4, 1 }, { 1 }, 2, 1);
+  columns.accumulate(0, bgr.data(), bgr.size(), { 4, 1 });
+  auto maxima = columns.finish(1);
+  const std::uint8_t* maxPixels = maxima->getBaseAsTyped<std::uint8_t>()->getPointerAtIndex(0);
+  REQUIRE(std::vector<std::uint8_t>(maxPixels, maxPixels + 6) == std::vector<std::uint8_t>{ 9, 8, 7, 4, 5, 10 });
+
+  Projection rows(Projection::Mode::Sum, libCZI::PixelType::Gray16, { 5, 3 }, { 1 }, 1, 3);
+  rows.accumulate(0, gray.data(), 6 * sizeof(std::uint16_t), { 5, 3 });
+  auto sums = rows.finish(1);
+  const double* sumPixels = sums->getBaseAsTyped<double>()->getPointerAtIndex(0);
+  REQUIRE(std::vector<double>(sumPixels, sumPixels + 5) == std::vector<double>{ 106, 108, 110, 112, 300 });
+}
+
+TEST_CASE("test_reader_projected", "[Projection]")
+{
+  pylibczi::Reader czi(L"resources/s_3_t_1_c_3_z_5.czi");
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 2 } };
+  auto stack = czi.readSelected(plane, -1, 4);
+  const std::uint16_t* stackPixels = stack.first->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+
+  auto projected = czi.readProjected(plane, 'Z', Projection::Mode::Max, -1, 4);
+  pylibczi::Reader::Shape expected{ { 'B', 1 }, { 'S', 1 }, { 'C', 3 }, { 'Y', 325 }, { 'X', 475 } };
+  REQUIRE(projected.second == expected);
+  REQUIRE(czi.projectedShape(plane, 'Z', Projection::Mode::Max).second == expected);
+
+  // the stack is CZYX, the maximum over Z of each C
+  const std::uint16_t* maxPixels = projected.first->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+  size_t planePixels = 325 * 475;
+  for (size_t c = 0; c < 3; c++) {
+    for (size_t i = 0; i < planePixels; i++) {
+      std::uint16_t value = 0;
+      for (size_t z = 0; z < 5; z++)
+        value = std::max(value, stackPixels[(c * 5 + z) * planePixels + i]);
+      REQUIRE(maxPixels[c * planePixels + i] == value);
+    }
+  }
+
+  // into caller memory, only the region
+  std::vector<double> out(3 * 40 * 30);
+  libCZI::IntRect roi{ 10, 20, 30, 40 };
+  REQUIRE_THROWS_AS(
+    czi.readProjected(plane, 'Z', Projection::Mode::Mean, -1, 2, roi, out.data(), out.size() * sizeof(double) - 1),
+    pylibczi::OutputBufferException);
+  czi.readProjected(plane, 'Z', Projection::Mode::Mean, -1, 2, roi, out.data(), out.size() * sizeof(double));
+  double sum = 0;
+  for (size_t z = 0; z < 5; z++)
+    sum += stackPixels[(1 * 5 + z) * planePixels + 25 * 475 + 12];
+  REQUIRE(out[1 * 40 * 30 + 5 * 30 + 2] == Approx(sum / 5));
+
+  REQUIRE_THROWS_AS(czi.readProjected(plane, 'T', Projection::Mode::Max),
+                    pylibczi::CDimCoordinatesOverspecifiedException);
+}
+
+TEST_CASE("test_reader_binned", "[Projection]")
+{
+  pylibczi::Reader czi(L"resources/s_3_t_1_c_3_z_5.czi");
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 0 }, { libCZI::DimensionIndex::C, 1 } };
+  auto stack = czi.readSelected(plane, -1, 4);
+  const std::uint16_t* stackPixels = stack.first->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+
+  pylibczi::Binning binning;
+  binning.mode = Projection::Mode::Max;
+  binning.x = 4;
+  binning.y = 3;
+  binning.z = 2;
+  auto binned = czi.readBinned(plane, binning, -1, 4);
+  pylibczi::Reader::Shape expected{ { 'B', 1 }, { 'S', 1 }, { 'C', 1 }, { 'Z', 3 }, { 'Y', 108 }, { 'X', 118 } };
+  REQUIRE(binned.second == expected);
+  REQUIRE(czi.binnedShape(plane, binning).second == expected);
+
+  // the last bin of Z only has the 5th plane
+  const std::uint16_t* binnedPixels = binned.first->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+  for (size_t z = 0; z < 3; z++) {
+    for (size_t y = 0; y < 108; y++) {
+      for (size_t x = 0; x < 118; x++) {
+        std::uint16_t value = 0;
+        for (size_t k = 2 * z; k < std::min<size_t>(2 * z + 2, 5); k++) {
+          for (size_t j = 3 * y; j < 3 * y + 3; j++) {
+            for (size_t i = 4 * x; i < 4 * x + 4; i++)
+              value = std::max(value, stackPixels[(k * 325 + j) * 475 + i]);
+          }
+        }
+        REQUIRE(binnedPixels[(z * 108 + y) * 118 + x] == value);
+      }
+    }
+  }
+
+  binning.x = 500;
+  REQUIRE_THROWS_AS(czi.readBinned(plane, binning), std::invalid_argument);
+}
@@ -0,0 +1,148 @@
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/ReadPipeline.h"
+#include "../_aicspylibczi/StreamImplPrefetch.h"
+
+using pylibczi::ReadPipeline;
+using pylibczi::StreamImplPrefetch;
+
+namespace {
+// a stream over a buffer where byte i has the value i % 251, it records the reads made on it
+class RecordingStream : public libCZI::IStream
+{
+  std::mutex m_mutex;
+
+public:
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> reads;
+  std::uint64_t size;
+
+  explicit RecordingStream(std::uint64_t size_)
+    : size(size_)
+  {}
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override
+  {
+    {
+      std::lock_guard<std::mutex> lck(m_mutex);
+      reads.emplace_back(offset_, size_);
+    }
+    std::uint64_t n = offset_ >= size ? 0 : std::min(size_, size - offset_);
+    auto out = static_cast<std::uint8_t*>(data_ptr_);
+    for (std::uint64_t i = 0; i < n; i++)
+      out[i] = static_cast<std::uint8_t>((offset_ + i) % 251);
+    if (bytes_read_ptr_ != nullptr)
+      *bytes_read_ptr_ = n;
+  }
+};
+}
+
+TEST_CASE("test_prefetch_stream_spans", "[StreamImplPrefetch]")
+{
+  auto inner = std::make_shared<RecordingStream>(10000);
+  StreamImplPrefetch stream(inner);
+  auto span = stream.prefetch(1000, 2000);
+  REQUIRE(inner->reads.size() == 1);
+
+  std::uint8_t byte = 0;
+  std::uint64_t bytesRead = 0;
+  stream.Read(1500, &byte, 1, &bytesRead);
+  REQUIRE(byte == 1500 % 251);
+  REQUIRE(bytesRead == 1);
+  REQUIRE(inner->reads.size() == 1); // served from the span
+
+  std::uint8_t pair[2];
+  stream.Read(2999, pair, 2, &bytesRead); // runs past the span
+  REQUIRE(inner->reads.size() == 2);
+
+  stream.removeSpan(span);
+  stream.Read(1500, &byte, 1, &bytesRead);
+  REQUIRE(inner->reads.size() == 3);
+}
+
+TEST_CASE("test_prefetch_stream_concurrent_spans", "[StreamImplPrefetch]")
+{
+  auto inner = std::make_shared<RecordingStream>(100000);
+  StreamImplPrefetch stream(inner);
+  std::atomic<bool> wrong{ false };
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&stream, &wrong, t]() {
+      std::uint8_t bytes[64];
+      for (std::uint64_t i = 0; i < 20000; i++) {
+        std::uint64_t offset = (i * 977 + t * 131) % (100000 - sizeof(bytes));
+        std::uint64_t bytesRead = 0;
+        stream.Read(offset, bytes, sizeof(bytes), &bytesRead);
+        for (std::uint64_t j = 0; j < sizeof(bytes); j++)
+          wrong = wrong || bytes[j] != (offset + j) % 251;
+      }
+    });
+  }
+  // spans come and go while the readers copy out of them
+  for (int i = 0; i < 500; i++) {
+    auto span = stream.prefetch((i * 4099) % 90000, 8192);
+    stream.removeSpan(span);
+  }
+  for (auto& reader : readers)
+    reader.join();
+  REQUIRE_FALSE(wrong);
+}
+
+TEST_CASE("test_read_pipeline_runs", "[ReadPipeline]")
+{
+  auto inner = std::make_shared<RecordingStream>(8 << 20);
+  StreamImplPrefetch stream(inner);
+  // listed out of file order, the first three segments are contiguous, the fourth is far away and the last has an
+  // unknown size so it is read by itself
+  std::vector<ReadPipeline::Job> jobs{
+    { 0, 2000, 1000 }, { 1, 0, 1000 }, { 2, 1000, 1000 }, { 3, 4000000, 1000 }, { 4, 4001000, -1 }
+  };
+  ReadPipeline pipeline(stream, jobs);
+  REQUIRE(pipeline.numberOfRuns() == 3);
+  REQUIRE(pipeline.readOrder() == std::vector<size_t>{ 1, 2, 0, 3, 4 });
+
+  std::vector<std::uint8_t> firstBytes(jobs.size(), 0);
+  std::atomic<int> calls{ 0 };
+  pipeline.run(2, [&](size_t i_) {
+    calls++;
+    std::uint64_t bytesRead = 0;
+    stream.Read(jobs[i_].filePosition, &firstBytes[i_], 1, &bytesRead);
+  });
+  REQUIRE(calls == 5);
+  for (size_t i = 0; i < jobs.size(); i++)
+    REQUIRE(firstBytes[i] == jobs[i].filePosition % 251);
+  // two prefetch reads and the direct read of the last job
+  REQUIRE(inner->reads.size() == 3);
+  REQUIRE(inner->reads[0] == std::make_pair(std::uint64_t(0), std::uint64_t(3000)));
+
+  // the spans are released once the run is done
+  std::uint8_t byte = 0;
+  stream.Read(0, &byte, 1, nullptr);
+  REQUIRE(inner->reads.size() == 4);
+}
+
+TEST_CASE("test_read_pipeline_throws", "[ReadPipeline]")
+{
+  auto inner = std::make_shared<RecordingStream>(1 << 20);
+  StreamImplPrefetch stream(inner);
+  std::vector<ReadPipeline::Job> jobs;
+  for (int i = 0; i < 20; i++)
+    jobs.push_back({ i, i * 1000, 1000 });
+  ReadPipeline pipeline(stream, jobs);
+  REQUIRE_THROWS_AS(pipeline.run(3,
+                                 [](size_t i_) {
+                                   if (i_ == 7)
+                                     throw std::runtime_error("decode failed");
+                                 }),
+                    std::runtime_error);
+
+  std::uint8_t byte = 0;
+  auto before = inner->reads.size();
+  stream.Read(500, &byte, 1, nullptr);
+  REQUIRE(inner->reads.size() == before + 1); // no span left behind
+}
@@ -1,10 +1,15 @@
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <sstream>
+#include <thread>
 
 #include "catch.hpp"
 
+#include "../_aicspylibczi/Cancellation.h"
+#include "../_aicspylibczi/ImageFactory.h"
 #include "../_aicspylibczi/Reader.h"
 #include "../_aicspylibczi/SubblockSortable.h"
 #include "../_aicspylibczi/pb_helpers.h"
@@ -258,6 +263,42 @@ TEST_CASE_METHOD(CziCreator, "test_meta_reader", "[Reader_read_meta]")
   REQUIRE(std::strncmp(ans.c_str(), xml.c_str(), ans.size()) == 0);
 }
 
+TEST_CASE_METHOD(CziCreator, "test_meta_xml", "[Reader_read_meta]")
+{
+  auto czi = get();
+  auto raw = czi->readMetaXml();
+  std::string xml(static_cast<const char*>(raw.data.get()), raw.size);
+  // the bytes as they are stored, not libCZI's serialization readMeta returns
+  std::string ans("<ImageDocument>\r\n"
+                  "  <Metadata>\r\n"
+                  "    <Experiment Version=\"1.1\">\r\n");
+  REQUIRE(xml.compare(0, ans.size(), ans) == 0);
+  REQUIRE(xml.substr(xml.size() - 16) == "</ImageDocument>");
+  // the segment is read once, every call shares it
+  REQUIRE(raw.data == czi->readMetaXml().data);
+  REQUIRE(czi->readMeta() == czi->readMeta());
+}
+
+TEST_CASE_METHOD(CziCreator, "test_meta_summary", "[Reader_read_meta]")
+{
+  auto czi = get();
+  auto summary = czi->readMetaSummary();
+  REQUIRE(summary.scaleX == Approx(1.0833333333333333e-06));
+  REQUIRE(summary.scaleY == Approx(1.0833333333333333e-06));
+  REQUIRE(std::isnan(summary.scaleZ)); // a single Z plane has no Z distance
+  REQUIRE(summary.channelNames == std::vector<std::string>{ "Bright" });
+  REQUIRE(summary.acquisitionTime == "2019-06-27T18:33:40.6193715Z");
+}
+
+TEST_CASE_METHOD(CziCreator2, "test_meta_summary_channels", "[Reader_read_meta]")
+{
+  auto czi = get();
+  auto summary = czi->readMetaSummary();
+  REQUIRE(summary.scaleZ == Approx(1e-06));
+  REQUIRE(summary.channelNames == std::vector<std::string>{ "EGFP", "TaRFP", "Bright" });
+  REQUIRE(summary.acquisitionTime == "2019-06-27T18:39:25.8078869Z");
+}
+
 TEST_CASE_METHOD(CziCreator, "test_read_selected", "[Reader_read_selected]")
 {
   auto czi = get();
@@ -282,6 +323,184 @@ TEST_CASE_METHOD(CziCreator2, "test_read_selected2", "[Reader_read_selected]")
   REQUIRE(shape[1] == 475); // width
 }
 
+TEST_CASE_METHOD(CziCreator2, "test_read_selected_into_buffer", "[Reader_read_selected]")
+{
+  auto czi = get();
+  auto cDims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::B, 0 }, { libCZI::DimensionIndex::C, 0 } };
+  auto expected = czi->readSelected(cDims, -1, CORES_FOR_THREADS);
+  auto predicted = czi->selectedShape(cDims, -1);
+  REQUIRE(predicted.first == libCZI::PixelType::Gray16);
+  REQUIRE(predicted.second == expected.second);
+
+  std::vector<uint16_t> out(15 * 325 * 475, 0);
+  auto imCont =
+    czi->readSelected(cDims, -1, CORES_FOR_THREADS, { 0, 0, -1, -1 }, out.data(), out.size() * sizeof(uint16_t));
+  REQUIRE(imCont.first->images().size() == 15);
+  REQUIRE(imCont.second == expected.second);
+  auto expectedPixels = expected.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  REQUIRE(std::equal(out.begin(), out.end(), expectedPixels));
+  REQUIRE(imCont.first->getBaseAsTyped<uint16_t>()->releaseMemory() == nullptr); // the container doesn't own out
+
+  REQUIRE_THROWS_AS(czi->readSelected(cDims, -1, CORES_FOR_THREADS, { 0, 0, -1, -1 }, out.data(), 10),
+                    pylibczi::OutputBufferException);
+}
+
+TEST_CASE_METHOD(CziCreator2, "test_read_selected_batch", "[Reader_read_selected]")
+{
+  auto czi = get();
+  std::vector<libCZI::CDimCoordinate> planes{
+    { { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 0 }, { libCZI::DimensionIndex::Z, 3 } },
+    { { libCZI::DimensionIndex::S, 1 } },
+    { { libCZI::DimensionIndex::S, 2 }, { libCZI::DimensionIndex::C, 1 } }
+  };
+  std::vector<std::pair<pylibczi::ImagesContainerBase::ImagesContainerBasePtr, pylibczi::Reader::Shape>> expected;
+  for (auto plane : planes)
+    expected.push_back(czi->readSelected(plane, -1, CORES_FOR_THREADS));
+
+  czi->setTileCacheBudget(64 << 20); // counts the subblocks looked up
+  auto batch = czi->readSelectedBatch(planes, -1, CORES_FOR_THREADS);
+  REQUIRE(batch.size() == 3);
+  for (size_t i = 0; i < batch.size(); i++) {
+    REQUIRE(batch[i].second == expected[i].second);
+    REQUIRE(batch[i].first->images().size() == expected[i].first->images().size());
+    size_t pixels = batch[i].first->images().size() * 325 * 475;
+    auto read = batch[i].first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+    REQUIRE(std::equal(read, read + pixels, expected[i].first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0)));
+  }
+  // the plane of the first selection is one of the second's, the 15 + 5 subblocks are each read once
+  REQUIRE(czi->tileCacheStatistics().misses == 20);
+  REQUIRE(czi->tileCacheStatistics().hits == 0);
+
+  planes.push_back({ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::Z, 9 } });
+  REQUIRE_THROWS_AS(czi->readSelectedBatch(planes, -1, CORES_FOR_THREADS),
+                    pylibczi::CdimSelectionZeroImagesException);
+}
+
+#ifndef PYLIBCZI_NO_PERF_COUNTERS
+TEST_CASE_METHOD(CziCreator2, "test_read_selected_stats", "[Reader_read_selected]")
+{
+  auto czi = get();
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 } };
+  czi->readSelected(plane, -1, CORES_FOR_THREADS);
+  REQUIRE_FALSE(czi->stats().enabled); // off by default
+  REQUIRE(czi->stats().readSelected.calls == 0);
+  REQUIRE(czi->stats().streamBytes == 0);
+
+  czi->enableStats(true);
+  auto read = czi->readSelected(plane, -1, CORES_FOR_THREADS);
+  auto stats = czi->stats();
+  REQUIRE(stats.enabled);
+  REQUIRE(stats.readSelected.calls == 1);
+  REQUIRE(stats.matches.calls == 1);
+  REQUIRE(stats.copy.calls == read.first->numberOfImages());
+  REQUIRE(stats.streamRead.calls > 0);
+  REQUIRE(stats.streamBytes > 0);
+  REQUIRE(stats.tileCacheHits + stats.tileCacheMisses == 0); // the cache has no budget
+  std::uint64_t busy = 0;
+  for (auto ns : stats.workerBusyNs)
+    busy += ns;
+  REQUIRE(busy > 0);
+
+  czi->setTileCacheBudget(64 << 20);
+  czi->resetStats();
+  czi->readSelected(plane, -1, CORES_FOR_THREADS);
+  czi->readSelected(plane, -1, CORES_FOR_THREADS);
+  stats = czi->stats();
+  REQUIRE(stats.readSelected.calls == 2);
+  REQUIRE(stats.tileCacheHits + stats.tileCacheMisses == 2 * read.first->numberOfImages());
+}
+#endif
+
+TEST_CASE_METHOD(CziCreator2, "test_read_selected_threads", "[Reader_read_selected]")
+{
+  auto czi = get();
+  std::vector<libCZI::CDimCoordinate> planes;
+  std::vector<std::vector<uint16_t>> expected;
+  for (int s = 0; s < 3; s++) {
+    for (int c = 0; c < 3; c++) {
+      planes.push_back({ { libCZI::DimensionIndex::S, s }, { libCZI::DimensionIndex::C, c } });
+      auto ans = czi->readSelected(planes.back(), -1, 1);
+      auto pixels = ans.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+      expected.emplace_back(pixels, pixels + 5 * 325 * 475);
+    }
+  }
+
+  // one reader shared by every thread, the reads go through the prefetched spans and the tile cache concurrently
+  czi->setTileCacheBudget(16 << 20);
+  std::vector<std::vector<uint16_t>> read(planes.size() * 4);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; t++) {
+    threads.emplace_back([&czi, &planes, &read, t]() {
+      for (size_t i = 0; i < planes.size(); i++) {
+        size_t p = (i + t * 2) % planes.size();
+        auto ans = czi->readSelected(planes[p], -1, 2);
+        auto pixels = ans.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+        read[t * planes.size() + p].assign(pixels, pixels + 5 * 325 * 475);
+        czi->pixelType();
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (size_t i = 0; i < read.size(); i++)
+    REQUIRE(read[i] == expected[i % planes.size()]);
+  REQUIRE(czi->pixelType() == "gray16");
+}
+
+TEST_CASE_METHOD(CziCreator2, "test_plane_iterator", "[Reader_read_selected]")
+{
+  auto czi = get();
+  auto cDims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::B, 0 }, { libCZI::DimensionIndex::C, 0 } };
+  auto expected = czi->readSelected(cDims, -1, CORES_FOR_THREADS);
+  auto expectedPixels = expected.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  const size_t planePixels = 325 * 475;
+
+  auto byScene = czi->planeIterator(cDims, "S", -1, 1, CORES_FOR_THREADS);
+  REQUIRE(byScene->numberOfGroups() == 3);
+  for (size_t s = 0; s < 3; s++) {
+    auto group = byScene->next();
+    REQUIRE(group.first->images().size() == 5);
+    REQUIRE(group.second[1] == std::pair<char, size_t>('S', 1));
+    auto pixels = group.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+    REQUIRE(std::equal(pixels, pixels + 5 * planePixels, expectedPixels + s * 5 * planePixels));
+  }
+  REQUIRE_FALSE(byScene->hasNext());
+
+  auto oneByOne = czi->planeIterator(cDims, "", -1, 0, CORES_FOR_THREADS);
+  REQUIRE(oneByOne->numberOfGroups() == 15);
+  for (size_t i = 0; oneByOne->hasNext(); i++) {
+    auto pixels = oneByOne->next().first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+    REQUIRE(std::equal(pixels, pixels + planePixels, expectedPixels + i * planePixels));
+  }
+
+  REQUIRE_THROWS_AS(czi->planeIterator(cDims, "M"), pylibczi::CDimCoordinatesOverspecifiedException);
+  REQUIRE_THROWS_AS(czi->planeIterator(cDims, "T"), pylibczi::CDimCoordinatesOverspecifiedException);
+}
+
+TEST_CASE_METHOD(CziCreator2, "test_read_selected_roi", "[Reader_read_selected]")
+{
+  auto czi = get();
+  auto cDims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::B, 0 }, { libCZI::DimensionIndex::C, 0 } };
+  auto full = czi->readSelected(cDims, -1, CORES_FOR_THREADS);
+  libCZI::IntRect roi{ 10, 20, 30, 40 };
+  auto cropped = czi->readSelected(cDims, -1, CORES_FOR_THREADS, roi);
+  REQUIRE(cropped.first->images().size() == 15);
+  REQUIRE(cropped.second.back() == std::pair<char, size_t>('X', 30));
+  REQUIRE(cropped.second[cropped.second.size() - 2] == std::pair<char, size_t>('Y', 40));
+  REQUIRE(czi->selectedShape(cDims, -1, roi).second == cropped.second);
+
+  auto fullPixels = full.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  auto croppedPixels = cropped.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  for (size_t i = 0; i < 15; i++)
+    for (int y = 0; y < roi.h; y++)
+      REQUIRE(std::equal(croppedPixels + (i * roi.h + y) * roi.w,
+                         croppedPixels + (i * roi.h + y + 1) * roi.w,
+                         fullPixels + (i * 325 + roi.y + y) * 475 + roi.x));
+
+  REQUIRE_THROWS_AS(czi->readSelected(cDims, -1, CORES_FOR_THREADS, { 470, 0, 10, 10 }),
+                    pylibczi::RegionSelectionException);
+}
+
 TEST_CASE_METHOD(CziCreatorIStream, "test_read_selected3", "[Reader_read_selected]")
 {
   auto czi = get();
@@ -325,6 +544,42 @@ TEST_CASE_METHOD(CziCreator2, "test_read_subblock_meta", "[Reader_read_subblock_
   int x = 10;
 }
 
+TEST_CASE_METHOD(CziCreator2, "test_read_raw_subblocks", "[Reader_read_subblock_meta]")
+{
+  auto czi = get();
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 } };
+  auto raw = czi->readRawSubblocks(plane);
+  auto images = czi->readSelected(plane, -1, 1);
+  REQUIRE(raw.size() == 5);
+  auto image = images.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  for (const auto& subblock : raw) {
+    REQUIRE(subblock.info.GetCompressionMode() == libCZI::CompressionMode::UnCompressed);
+    size_t pixels = subblock.info.physicalSize.w * subblock.info.physicalSize.h;
+    REQUIRE(subblock.size >= pixels * sizeof(uint16_t));
+    // the uncompressed payload is the pixels of the image readSelected returns for the same plane
+    REQUIRE(std::memcmp(subblock.data.get(), image, pixels * sizeof(uint16_t)) == 0);
+    image += pixels;
+  }
+}
+
+TEST_CASE_METHOD(CziCreator2, "test_read_subblock_fields", "[Reader_read_subblock_meta]")
+{
+  auto czi = get();
+  auto cDims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::B, 0 }, { libCZI::DimensionIndex::C, 0 } };
+  auto metavec = czi->readSubblockMeta(cDims);
+  auto fields = czi->readSubblockFields(cDims, -1, { "AcquisitionTime", "StageXPosition" });
+  REQUIRE(fields.subblockIndex.size() == metavec.size());
+  REQUIRE(fields.isTime == std::vector<bool>{ true, false });
+  for (size_t i = 0; i < metavec.size(); i++) {
+    // the metadata read on its own is the same as the metadata of the whole subblock
+    std::string xml = metavec[i].getString();
+    REQUIRE(xml.substr(0, 10) == "<METADATA>");
+    bool isTime = false;
+    REQUIRE(fields.values[2 * i] == pylibczi::SubblockString::fieldValue(xml, "AcquisitionTime", isTime));
+    REQUIRE(fields.values[2 * i + 1] == pylibczi::SubblockString::fieldValue(xml, "StageXPosition", isTime));
+  }
+}
+
 class CziMCreator
 {
   std::unique_ptr<pylibczi::Reader> m_czi;
@@ -402,6 +657,137 @@ TEST_CASE_METHOD(CziMCreator, "test_mosaic_readScaled", "[Reader_mosaic_readScal
   REQUIRE(imvec.size() == 1);
 }
 
+TEST_CASE_METHOD(CziMCreator, "test_mosaic_read_cores", "[Reader_mosaic_read]")
+{
+  auto czi = get();
+  auto c_dims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::C, 0 } };
+  for (float scale : { 1.0f, 0.37f }) {
+    auto shape = czi->mosaicShape(c_dims, scale);
+    size_t bytes = pylibczi::ImageFactory::sizeOfPixelType(shape.first);
+    for (const auto& dim : shape.second)
+      bytes *= dim.second;
+    std::vector<std::uint8_t> serial(bytes, 1), parallel(bytes, 2);
+    czi->readMosaic(c_dims, scale, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 1, serial.data(), bytes);
+    czi->readMosaic(c_dims, scale, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 4, parallel.data(), bytes); // the shared pool
+    REQUIRE(serial == parallel);
+  }
+}
+
+TEST_CASE_METHOD(CziCreator5, "test_mosaic_read_pyramid", "[Reader_mosaic_read]")
+{
+  auto czi = get();
+  REQUIRE(czi->pyramidLayers().size() == 2);
+  auto c_dims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::C, 0 } };
+  czi->setTileCacheBudget(64 << 20); // the misses count the decoded subblocks
+
+  auto half = czi->readMosaic(c_dims, 0.5f);
+  // scenes 0 and 1 come from their one layer 1 subblock, scene 2 has no pyramid and is read from its layer 0 tile
+  REQUIRE(czi->tileCacheStatistics().misses == 3);
+  auto shape = czi->mosaicShape(c_dims, 0.5f).second;
+  REQUIRE(half->images().front()->shape() == std::vector<size_t>{ shape[1].second, shape[2].second });
+
+  czi->setTileCacheBudget(0); // empties the cache, the counts are kept
+  czi->setTileCacheBudget(64 << 20);
+  czi->readMosaic(c_dims, 0.6f); // layer 1 is coarser than 0.6
+  REQUIRE(czi->tileCacheStatistics().misses == 3 + 29);
+}
+
+TEST_CASE_METHOD(CziCreator5, "test_mosaic_read_progressive", "[Reader_mosaic_read]")
+{
+  auto czi = get();
+  auto c_dims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::C, 0 } };
+  auto shape = czi->mosaicShape(c_dims);
+  size_t bytes = pylibczi::ImageFactory::sizeOfPixelType(shape.first);
+  for (const auto& dim : shape.second)
+    bytes *= dim.second;
+  std::vector<std::uint8_t> expected(bytes, 1), image(bytes, 2);
+  czi->readMosaic(c_dims, 1.0f, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 1, expected.data(), bytes);
+
+  czi->setTileCacheBudget(64 << 20); // the misses count the decoded subblocks
+  std::vector<std::pair<size_t, size_t>> calls;
+  auto progress = [&](const void* pixels_, size_t drawn_, size_t tiles_) {
+    REQUIRE(pixels_ != nullptr);
+    if (drawn_ == 0) // the preview is the layer 1 subblocks of scenes 0 and 1
+      REQUIRE(czi->tileCacheStatistics().misses == 2);
+    calls.emplace_back(drawn_, tiles_);
+  };
+  czi->readMosaicProgressive(c_dims, 1.0f, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 2, progress, image.data(), bytes);
+  REQUIRE(calls.size() > 2);
+  REQUIRE(calls.front() == std::make_pair(size_t(0), calls.back().second));
+  REQUIRE(calls.back().first == calls.back().second);
+  REQUIRE(std::is_sorted(calls.begin(), calls.end()));
+  REQUIRE(image == expected);
+
+  // at the scale of the coarsest layer there's no preview
+  calls.clear();
+  auto half = czi->readMosaicProgressive(c_dims, 0.5f, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 2, progress);
+  REQUIRE(calls.front().first > 0);
+  auto halfShape = czi->mosaicShape(c_dims, 0.5f).second;
+  REQUIRE(half->images().front()->shape() == std::vector<size_t>{ halfShape[1].second, halfShape[2].second });
+}
+
+TEST_CASE_METHOD(CziMCreator, "test_mosaic_prefetch", "[Reader_prefetch]")
+{
+  auto czi = get();
+  auto c_dims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::C, 0 } };
+  auto shape = czi->mosaicShape(c_dims);
+  size_t bytes = pylibczi::ImageFactory::sizeOfPixelType(shape.first);
+  for (const auto& dim : shape.second)
+    bytes *= dim.second;
+  std::vector<std::uint8_t> expected(bytes, 1), image(bytes, 2);
+  czi->readMosaic(c_dims, 1.0f, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 1, expected.data(), bytes);
+  czi->prefetchMosaic(c_dims).get(); // without a tile cache only the bytes are read
+  REQUIRE(czi->tileCacheStatistics().tiles == 0);
+
+  czi->setTileCacheBudget(64 << 20);
+  czi->prefetchMosaic(c_dims, 1.0f, { 0, 0, -1, -1 }, true, 4).get();
+  auto stats = czi->tileCacheStatistics();
+  REQUIRE(stats.tiles > 0);
+  REQUIRE(stats.misses == 0); // the prefetch doesn't count as a use
+  czi->readMosaic(c_dims, 1.0f, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 1, image.data(), bytes);
+  REQUIRE(czi->tileCacheStatistics().misses == 0);
+  REQUIRE(czi->tileCacheStatistics().hits == stats.tiles);
+  REQUIRE(image == expected);
+}
+
+TEST_CASE_METHOD(CziCreator2, "test_selected_prefetch", "[Reader_prefetch]")
+{
+  auto czi = get();
+  czi->setTileCacheBudget(64 << 20);
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 } };
+  auto pending = czi->prefetchSelected(plane);
+  czi->readSelected(plane, -1, 2); // doesn't have to wait for the prefetch
+  pending.get();
+  REQUIRE(czi->tileCacheStatistics().tiles == 5);
+
+  libCZI::CDimCoordinate badPlane{ { libCZI::DimensionIndex::C, 7 } };
+  REQUIRE_THROWS_AS(czi->prefetchSelected(badPlane), pylibczi::CDimCoordinatesOverspecifiedException);
+}
+
+TEST_CASE("test_prefetch_outlives_reader", "[Reader_prefetch]")
+{
+  std::shared_future<void> pending;
+  {
+    pylibczi::Reader czi(L"resources/s_3_t_1_c_3_z_5.czi");
+    czi.setTileCacheBudget(64 << 20);
+    libCZI::CDimCoordinate plane;
+    pending = czi.prefetchSelected(plane, -1, true, 4);
+  }
+  REQUIRE_NOTHROW(pending.get());
+}
+
+TEST_CASE_METHOD(CziMCreator, "test_subblock_directory", "[Reader_mosaic_shape]")
+{
+  auto czi = get();
+  const auto& directory = czi->subblockDirectory();
+  REQUIRE(directory.size() == 2);
+  REQUIRE(directory.hasFilePositions());
+  pylibczi::SubblockDirectory::Row first = directory.filePosition(0) < directory.filePosition(1) ? 0 : 1;
+  REQUIRE(directory.segmentExtent(first) == directory.filePosition(1 - first) - directory.filePosition(first));
+  REQUIRE(directory.segmentExtent(1 - first) == -1); // the last segment
+  REQUIRE(directory.logicalRect(0).x + directory.logicalRect(1).x == 832); // the tiles are at x 0 and 832
+}
+
 TEST_CASE_METHOD(CziMCreator, "test_mosaic_shape", "[Reader_mosaic_shape]")
 {
   auto czi = get();
@@ -637,6 +1023,121 @@ TEST_CASE_METHOD(CziCreator5, "test_multiscene_mosaic_bboxes", "[Reader_mosaic_b
   REQUIRE(ansItt->first.mIndex() == 2);
 }
 
+TEST_CASE_METHOD(CziCreator5, "test_read_scenes", "[Reader_read_selected]")
+{
+  auto czi = get();
+  libCZI::CDimCoordinate channel{ { libCZI::DimensionIndex::C, 0 } };
+  auto scenes = czi->readScenes(channel, {}, -1, 4);
+  REQUIRE(scenes.size() == 3);
+  for (int s = 0; s < 3; s++) {
+    libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::C, 0 }, { libCZI::DimensionIndex::S, s } };
+    auto expected = czi->readSelected(plane, -1, 1);
+    REQUIRE(scenes[s].second == expected.second);
+    size_t samples = 1;
+    for (const auto& dim : expected.second)
+      samples *= dim.second;
+    auto read = scenes[s].first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+    REQUIRE(std::equal(read, read + samples, expected.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0)));
+  }
+
+  auto some = czi->readScenes(channel, { 2, 0 }, -1, 4);
+  REQUIRE(some.size() == 2);
+  REQUIRE(some[0].second == scenes[2].second);
+  REQUIRE(some[1].second == scenes[0].second);
+
+  REQUIRE_THROWS_AS(czi->readScenes(channel, { 3 }), pylibczi::CDimCoordinatesOverspecifiedException);
+  libCZI::CDimCoordinate withScene{ { libCZI::DimensionIndex::S, 0 } };
+  REQUIRE_THROWS_AS(czi->readScenes(withScene), pylibczi::CDimCoordinatesOverspecifiedException);
+}
+
+TEST_CASE_METHOD(CziCreator5, "test_read_mosaic_tiles", "[Reader_mosaic_tiles]")
+{
+  auto czi = get();
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::C, 0 }, { libCZI::DimensionIndex::S, 0 } };
+  auto tiles = czi->readMosaicTiles(plane, { 2, 0, 2 }, 4);
+  REQUIRE(tiles.mIndices == std::vector<int>{ 0, 2 });
+  REQUIRE(tiles.shape == pylibczi::Reader::Shape{ { 'M', 2 }, { 'Y', 256 }, { 'X', 256 } });
+  REQUIRE(tiles.images->numberOfImages() == 2);
+  REQUIRE(tiles.boxes[1].x == 495643);
+  REQUIRE(tiles.boxes[1].y == 354924);
+  REQUIRE(tiles.boxes[1].w == 256);
+  REQUIRE(tiles.boxes[1].h == 256);
+  auto read = tiles.images->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  for (size_t i = 0; i < tiles.mIndices.size(); i++) {
+    auto expected = czi->readSelected(plane, tiles.mIndices[i], 1);
+    auto first = read + i * 256 * 256;
+    REQUIRE(std::equal(first, first + 256 * 256, expected.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0)));
+  }
+
+  auto all = czi->readMosaicTiles(plane);
+  REQUIRE(all.mIndices == std::vector<int>{ 0, 1, 2, 3 });
+  REQUIRE(all.boxes.size() == 4);
+  REQUIRE(all.boxes[0].x == 495412);
+  REQUIRE(all.boxes[0].y == 354694);
+
+  REQUIRE_THROWS_AS(czi->readMosaicTiles(plane, { 7 }), pylibczi::CDimCoordinatesOverspecifiedException);
+}
+
+TEST_CASE_METHOD(CziCreator4, "test_read_mosaic_tiles_not_mosaic", "[Reader_mosaic_tiles]")
+{
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::C, 0 } };
+  REQUIRE_THROWS_AS(get()->readMosaicTiles(plane), pylibczi::IsNotMosaicException);
+}
+
+TEST_CASE_METHOD(CziCreator5, "test_read_cancelled", "[Reader_cancellation]")
+{
+  auto czi = get();
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::C, 0 }, { libCZI::DimensionIndex::S, 0 } };
+  auto token = std::make_shared<pylibczi::CancelToken>();
+  {
+    pylibczi::ReadCancellation::Scope scope(token);
+    REQUIRE(czi->readSelected(plane, -1, 4).first->numberOfImages() == 4);
+    token->cancel();
+    REQUIRE_THROWS_AS(czi->readSelected(plane, -1, 4), pylibczi::ReadCancelledException);
+    libCZI::CDimCoordinate channel{ { libCZI::DimensionIndex::C, 0 } };
+    REQUIRE_THROWS_AS(czi->readMosaic(channel, 0.1f), pylibczi::ReadCancelledException);
+    REQUIRE_THROWS_AS(czi->readRawSubblocks(plane), pylibczi::ReadCancelledException);
+    REQUIRE_THROWS_AS(czi->readSubblockMeta(plane), pylibczi::ReadCancelledException);
+    REQUIRE_THROWS_AS(czi->readSubblockFields(plane, -1, { "AcquisitionTime" }), pylibczi::ReadCancelledException);
+  }
+  {
+    pylibczi::ReadCancellation::Scope scope(nullptr, pylibczi::ReadCancellation::Clock::now());
+    try {
+      czi->readSelected(plane, -1, 1);
+      FAIL("the read passed its deadline");
+    } catch (const pylibczi::ReadCancelledException& e) {
+      REQUIRE(e.reason() == pylibczi::ReadCancelledException::Reason::Deadline);
+    }
+  }
+  // the reader is unaffected by the reads it abandoned
+  REQUIRE(czi->readSelected(plane, -1, 4).first->numberOfImages() == 4);
+}
+
+TEST_CASE_METHOD(CziCreatorOrder, "test_read_attachments", "[Reader_attachments]")
+{
+  auto czi = get();
+  auto attachments = czi->attachments();
+  REQUIRE(attachments.size() == 3);
+  REQUIRE(attachments[2].name == "Thumbnail");
+
+  auto thumbnail = czi->readAttachment(2);
+  REQUIRE(thumbnail.size == static_cast<size_t>(attachments[2].size));
+  auto jpeg = static_cast<const std::uint8_t*>(thumbnail.data.get());
+  REQUIRE((jpeg[0] == 0xFF && jpeg[1] == 0xD8)); // a JPEG's start of image
+  REQUIRE_THROWS_AS(czi->readAttachment(3), pylibczi::AttachmentException);
+
+  // one time stamp per T
+  REQUIRE(czi->readTimeStamps() == std::vector<double>{ 360.4196148, 420.3980454, 480.4104779 });
+}
+
+TEST_CASE_METHOD(CziCreatorTiles, "test_read_attachments_order", "[Reader_attachments]")
+{
+  auto attachments = get()->attachments();
+  REQUIRE(attachments.size() == 4);
+  REQUIRE(attachments[1].contentType == "CZLUT");
+  REQUIRE(get()->readTimeStamps().size() == 1);
+}
+
 TEST_CASE_METHOD(CziCreatorOrder, "test_image_overspeced", "[Reader_image_overspeced]")
 {
   auto czi = get();
@@ -735,6 +1236,40 @@ TEST_CASE_METHOD(CziCreatorTilesTZ, "test_tile_tz_no_scene", "[Reader_tile_tz_no
   REQUIRE_NOTHROW(czi->readMosaic(dm));
 }
 
+TEST_CASE_METHOD(CziCreatorTilesTZ, "test_mosaic_read_planes", "[Reader_mosaic_read]")
+{
+  auto czi = get();
+  using DI = libCZI::DimensionIndex;
+  std::vector<libCZI::CDimCoordinate> planes;
+  for (int z : { 1, 0 }) // given out of order, they are composited in SubblockSortable order C then Z
+    for (int c : { 0, 1 })
+      planes.push_back(libCZI::CDimCoordinate{ { DI::T, 1 }, { DI::C, c }, { DI::Z, z } });
+
+  auto shape = czi->mosaicPlanesShape(planes, 0.5f);
+  auto planeShape = czi->mosaicShape(planes.front(), 0.5f).second; // T, C, Z, Y, X of a single plane
+  pylibczi::Reader::Shape expected{ { 'T', 1 }, { 'C', 2 }, { 'Z', 2 }, planeShape[3], planeShape[4] };
+  REQUIRE(shape.second == expected);
+
+  size_t planeBytes = pylibczi::ImageFactory::sizeOfPixelType(shape.first) * expected[3].second * expected[4].second;
+  std::vector<std::uint8_t> together(4 * planeBytes, 1), oneByOne(4 * planeBytes, 2);
+  czi->readMosaicPlanes(planes, 0.5f, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 4, together.data(), together.size());
+  size_t i = 0;
+  for (int c : { 0, 1 })
+    for (int z : { 0, 1 }) {
+      libCZI::CDimCoordinate plane{ { DI::T, 1 }, { DI::C, c }, { DI::Z, z } };
+      czi->readMosaic(plane, 0.5f, { 0, 0, -1, -1 }, { 0.0, 0.0, 0.0 }, 1, &oneByOne[i++ * planeBytes], planeBytes);
+    }
+  REQUIRE(together == oneByOne);
+
+  auto images = czi->readMosaicPlanes(planes, 0.5f);
+  REQUIRE(images->images().size() == 4);
+
+  planes.pop_back(); // not a full grid
+  REQUIRE_THROWS_AS(czi->readMosaicPlanes(planes), pylibczi::CDimCoordinatesUnderspecifiedException);
+  planes.push_back(planes.front()); // a repeated plane
+  REQUIRE_THROWS_AS(czi->readMosaicPlanes(planes), pylibczi::CDimCoordinatesUnderspecifiedException);
+}
+
 TEST_CASE_METHOD(CziCreatorTilesZ, "test_tile_z_no_scene", "[Reader_tile_z_no_scene]")
 {
   auto czi = get();
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/IoScheduler.h"
+#include "../_aicspylibczi/ReaderPool.h"
+
+using pylibczi::IoScheduler;
+using pylibczi::ReaderPool;
+
+namespace {
+void
+waitForWaiting(const IoScheduler& scheduler_, size_t waiting_)
+{
+  while (scheduler_.waiting() < waiting_)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+}
+
+TEST_CASE("test_io_scheduler_round_robin", "[IoScheduler]")
+{
+  IoScheduler scheduler(1);
+  size_t a = scheduler.addFile(), b = scheduler.addFile();
+  std::mutex mutex;
+  std::vector<size_t> order;
+  std::vector<std::thread> reads;
+  {
+    IoScheduler::Turn held = scheduler.turn(a); // the only slot, the reads below queue up
+    std::vector<size_t> files{ a, a, a, b };
+    for (size_t i = 0; i < files.size(); i++) {
+      size_t file = files[i];
+      reads.emplace_back([&scheduler, &mutex, &order, file]() {
+        IoScheduler::Turn turn = scheduler.turn(file);
+        std::lock_guard<std::mutex> lck(mutex);
+        order.push_back(file);
+      });
+      waitForWaiting(scheduler, i + 1); // queued in this order
+    }
+  }
+  for (auto& read : reads)
+    read.join();
+  // b's one read goes in right after a's first, it isn't queued behind all of a's
+  REQUIRE(order == std::vector<size_t>{ a, b, a, a });
+  REQUIRE(scheduler.waiting() == 0);
+}
+
+TEST_CASE("test_reader_pool_lru", "[ReaderPool]")
+{
+  ReaderPool pool(2);
+  auto first = pool.reader(L"resources/s_3_t_1_c_3_z_5.czi");
+  REQUIRE(pool.reader(L"resources/s_3_t_1_c_3_z_5.czi") == first);
+  pool.reader(L"resources/s_1_t_1_c_1_z_1.czi"); // idle as soon as it's returned
+  auto third = pool.reader(L"resources/mosaic_test.czi");
+
+  // the idle reader is closed to make room, the one still held is kept though it's the least recently used
+  auto statistics = pool.statistics();
+  REQUIRE(statistics.opens == 3);
+  REQUIRE(statistics.hits == 1);
+  REQUIRE(statistics.evictions == 1);
+  REQUIRE(statistics.open == 2);
+  REQUIRE(pool.reader(L"resources/s_3_t_1_c_3_z_5.czi") == first);
+
+  // held readers go over the limit rather than being closed
+  auto fourth = pool.reader(L"resources/s_1_t_1_c_1_z_1.czi");
+  REQUIRE(pool.statistics().open == 3);
+  fourth.reset();
+  third.reset();
+  pool.clear();
+  REQUIRE(pool.statistics().open == 1);
+  first.reset();
+  REQUIRE(pool.statistics().open == 1); // the pool still holds it
+}
+
+TEST_CASE("test_reader_pool_shared_cache", "[ReaderPool]")
+{
+  ReaderPool pool(4, 64 << 20, 2);
+  auto scenes = pool.reader(L"resources/s_3_t_1_c_3_z_5.czi");
+  auto single = pool.reader(L"resources/s_1_t_1_c_1_z_1.czi");
+  REQUIRE(scenes->tileCache() == single->tileCache());
+
+  // both files have a subblock 0, their keys don't collide in the shared cache
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 0 }, { libCZI::DimensionIndex::C, 0 },
+                                { libCZI::DimensionIndex::Z, 0 } };
+  libCZI::CDimCoordinate only{ { libCZI::DimensionIndex::C, 0 } };
+  scenes->prefetchSelected(plane, -1, true, 2).get();
+  single->prefetchSelected(only, -1, true, 2).get();
+  REQUIRE(pool.tileCache()->statistics().tiles == 2);
+
+  auto fromScenes = scenes->readSelected(plane, -1, 2);
+  auto fromSingle = single->readSelected(only, -1, 2);
+  REQUIRE(pool.tileCache()->statistics().hits == 2);
+  REQUIRE(pool.tileCache()->statistics().misses == 0);
+
+  pylibczi::Reader scenesAlone(L"resources/s_3_t_1_c_3_z_5.czi");
+  pylibczi::Reader singleAlone(L"resources/s_1_t_1_c_1_z_1.czi");
+  auto equal = [](pylibczi::ImagesContainerBase* a_, pylibczi::ImagesContainerBase* b_) {
+    auto a = a_->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+    return std::equal(a, a + 325 * 475, b_->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0));
+  };
+  REQUIRE(equal(fromScenes.first.get(), scenesAlone.readSelected(plane, -1, 2).first.get()));
+  REQUIRE(equal(fromSingle.first.get(), singleAlone.readSelected(only, -1, 2).first.get()));
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Reader.h"
+#include "../_aicspylibczi/SidecarIndex.h"
+#include "../_aicspylibczi/StreamImplPositionalRead.h"
+
+using pylibczi::SidecarIndex;
+
+namespace {
+// counts the bytes read through it
+class CountingStream : public libCZI::IStream
+{
+  std::shared_ptr<libCZI::IStream> m_stream;
+
+public:
+  std::atomic<std::uint64_t> bytesRead{ 0 };
+
+  explicit CountingStream(std::shared_ptr<libCZI::IStream> stream_)
+    : m_stream(std::move(stream_))
+  {}
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override
+  {
+    bytesRead += size_;
+    m_stream->Read(offset_, data_ptr_, size_, bytes_read_ptr_);
+  }
+};
+
+const wchar_t* s_fileName = L"resources/s_3_t_1_c_3_z_5.czi";
+const wchar_t* s_indexName = L"test_sidecar.idx";
+
+SidecarIndex
+indexOf(const wchar_t* file_name_, std::uint64_t* bytes_read_ = nullptr)
+{
+  CountingStream stream(std::make_shared<pylibczi::StreamImplPositionalRead>(file_name_));
+  SidecarIndex ans(file_name_, s_indexName, stream);
+  if (bytes_read_ != nullptr)
+    *bytes_read_ = stream.bytesRead;
+  return ans;
+}
+}
+
+TEST_CASE("test_sidecar_index_written_then_loaded", "[SidecarIndex]")
+{
+  std::remove("test_sidecar.idx");
+  SidecarIndex built = indexOf(s_fileName);
+  REQUIRE_FALSE(built.loaded());
+  REQUIRE(built.segments().size() >= 2); // the file header and the subblock directory
+  REQUIRE(built.segments().front().offset == 0);
+  REQUIRE(std::memcmp(built.segments().front().data->data(), "ZISRAWFILE", 10) == 0);
+  REQUIRE(std::memcmp(built.segments()[1].data->data(), "ZISRAWDIRECTORY", 15) == 0);
+
+  std::uint64_t bytesRead = 0;
+  SidecarIndex loaded = indexOf(s_fileName, &bytesRead);
+  REQUIRE(loaded.loaded());
+  REQUIRE(bytesRead == 32 + 512); // only the file header is read to check the index
+  REQUIRE(loaded.segments().size() == built.segments().size());
+  for (size_t i = 0; i < built.segments().size(); i++) {
+    REQUIRE(loaded.segments()[i].offset == built.segments()[i].offset);
+    REQUIRE(*loaded.segments()[i].data == *built.segments()[i].data);
+  }
+  std::remove("test_sidecar.idx");
+}
+
+TEST_CASE("test_sidecar_index_stale_or_corrupt", "[SidecarIndex]")
+{
+  std::remove("test_sidecar.idx");
+  indexOf(L"resources/s_1_t_1_c_1_z_1.czi");
+  REQUIRE_FALSE(indexOf(s_fileName).loaded()); // written for another file, it's rebuilt
+  REQUIRE(indexOf(s_fileName).loaded());
+
+  std::FILE* truncated = std::fopen("test_sidecar.idx", "wb");
+  std::fwrite("PYCZIIDX", 1, 8, truncated);
+  std::fclose(truncated);
+  REQUIRE_FALSE(indexOf(s_fileName).loaded());
+  REQUIRE(indexOf(s_fileName).loaded());
+
+  // the first segment claims a GB the index doesn't have, it's rejected before the buffer is allocated
+  std::FILE* corrupt = std::fopen("test_sidecar.idx", "r+b");
+  std::uint64_t size = std::uint64_t(1) << 30;
+  REQUIRE(std::fseek(corrupt, 32 + 8, SEEK_SET) == 0); // the header, then the offset of the first segment
+  std::fwrite(&size, sizeof(size), 1, corrupt);
+  std::fclose(corrupt);
+  REQUIRE_FALSE(indexOf(s_fileName).loaded());
+  REQUIRE(indexOf(s_fileName).loaded());
+  std::remove("test_sidecar.idx");
+}
+
+TEST_CASE("test_sidecar_index_not_a_czi", "[SidecarIndex]")
+{
+  std::remove("test_sidecar.idx");
+  REQUIRE(indexOf(L"CMakeLists.txt").segments().empty());
+  REQUIRE(std::fopen("test_sidecar.idx", "rb") == nullptr); // nothing is written
+}
+
+TEST_CASE("test_sidecar_index_reader", "[SidecarIndex]")
+{
+  std::remove("test_sidecar.idx");
+  pylibczi::Reader plain(s_fileName);
+  for (int i = 0; i < 2; i++) { // the first open writes the index, the second reads it
+    pylibczi::Reader indexed(s_fileName, false, s_indexName);
+    REQUIRE(indexed.dimsString() == plain.dimsString());
+    REQUIRE(indexed.dimSizes() == plain.dimSizes());
+    libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 } };
+    auto images = indexed.readSelected(plane, -1, 1);
+    auto expected = plain.readSelected(plane, -1, 1);
+    REQUIRE(images.second == expected.second);
+    size_t pixels = images.first->images().size() * images.first->images().front()->length();
+    auto imagePixels = images.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+    auto expectedPixels = expected.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+    REQUIRE(std::equal(imagePixels, imagePixels + pixels, expectedPixels));
+  }
+  std::remove("test_sidecar.idx");
+}
@@ -0,0 +1,184 @@
+#include <fcntl.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Reader.h"
+#include "../_aicspylibczi/StreamImplBlockCache.h"
+#include "../_aicspylibczi/StreamImplMemoryMapped.h"
+#include "../_aicspylibczi/StreamImplPositionalRead.h"
+#include "../_aicspylibczi/exceptions.h"
+
+TEST_CASE("test_positional_read_header", "[Stream_positional]")
+{
+  pylibczi::StreamImplPositionalRead stream(L"resources/s_1_t_1_c_1_z_1.czi");
+  char magic[11] = { 0 };
+  std::uint64_t bytesRead = 0;
+  stream.Read(0, magic, 10, &bytesRead);
+  REQUIRE(bytesRead == 10);
+  REQUIRE(std::string(magic) == "ZISRAWFILE");
+}
+
+TEST_CASE("test_positional_read_past_end", "[Stream_positional]")
+{
+  pylibczi::StreamImplPositionalRead stream(L"resources/s_1_t_1_c_1_z_1.czi");
+  char buffer[16];
+  std::uint64_t bytesRead = 1;
+  stream.Read(std::uint64_t(1) << 40, buffer, sizeof(buffer), &bytesRead);
+  REQUIRE(bytesRead == 0);
+}
+
+TEST_CASE("test_positional_read_bad_file", "[Stream_positional]")
+{
+  REQUIRE_THROWS_AS(pylibczi::StreamImplPositionalRead(L"resources/does_not_exist.czi"), pylibczi::FilePtrException);
+}
+
+TEST_CASE("test_positional_read_from_fd", "[Stream_positional]")
+{
+#ifdef _WIN32
+  int fd = _open("resources/s_1_t_1_c_1_z_1.czi", _O_RDONLY | _O_BINARY);
+#else
+  int fd = open("resources/s_1_t_1_c_1_z_1.czi", O_RDONLY);
+#endif
+  REQUIRE(fd != -1);
+  std::unique_ptr<pylibczi::StreamImplPositionalRead> stream(new pylibczi::StreamImplPositionalRead(fd));
+#ifdef _WIN32
+  _close(fd); // the stream has its own duplicate
+#else
+  close(fd);
+#endif
+  char magic[11] = { 0 };
+  std::uint64_t bytesRead = 0;
+  stream->Read(0, magic, 10, &bytesRead);
+  REQUIRE(std::string(magic) == "ZISRAWFILE");
+}
+
+TEST_CASE("test_positional_read_concurrent", "[Stream_positional]")
+{
+  pylibczi::StreamImplPositionalRead stream(L"resources/s_3_t_1_c_3_z_5.czi");
+  const std::uint64_t chunk = 4096;
+  std::vector<char> expected(chunk * 8);
+  stream.Read(0, expected.data(), expected.size(), nullptr);
+
+  std::vector<std::vector<char>> results(8, std::vector<char>(chunk));
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.emplace_back([&stream, &results, i, chunk]() { stream.Read(i * chunk, results[i].data(), chunk, nullptr); });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (size_t i = 0; i < results.size(); i++)
+    REQUIRE(std::equal(results[i].begin(), results[i].end(), expected.begin() + i * chunk));
+}
+
+TEST_CASE("test_memory_mapped_read", "[Stream_memory_mapped]")
+{
+  pylibczi::StreamImplMemoryMapped mapped(L"resources/s_3_t_1_c_3_z_5.czi");
+  pylibczi::StreamImplPositionalRead positional(L"resources/s_3_t_1_c_3_z_5.czi");
+  REQUIRE(mapped.size() > 0);
+  REQUIRE(std::string(reinterpret_cast<const char*>(mapped.data()), 10) == "ZISRAWFILE");
+
+  std::vector<char> expected(8192), actual(8192);
+  std::uint64_t bytesRead = 0;
+  positional.Read(1000, expected.data(), expected.size(), nullptr);
+  mapped.Read(1000, actual.data(), actual.size(), &bytesRead);
+  REQUIRE(bytesRead == actual.size());
+  REQUIRE(expected == actual);
+
+  // a read that runs off the end of the file is truncated
+  mapped.Read(mapped.size() - 10, actual.data(), actual.size(), &bytesRead);
+  REQUIRE(bytesRead == 10);
+  mapped.Read(mapped.size() + 10, actual.data(), actual.size(), &bytesRead);
+  REQUIRE(bytesRead == 0);
+}
+
+TEST_CASE("test_memory_mapped_reader", "[Stream_memory_mapped]")
+{
+  pylibczi::Reader mapped(L"resources/s_3_t_1_c_3_z_5.czi", true);
+  pylibczi::Reader positional(L"resources/s_3_t_1_c_3_z_5.czi");
+  REQUIRE(mapped.dimsString() == positional.dimsString());
+  libCZI::CDimCoordinate cDims{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 1 } };
+  auto mappedImages = mapped.readSelected(cDims).first;
+  auto positionalImages = positional.readSelected(cDims).first;
+  REQUIRE(mappedImages->images().size() == positionalImages->images().size());
+}
+
+TEST_CASE("test_block_cache_read", "[Stream_block_cache]")
+{
+  auto positional = std::make_shared<pylibczi::StreamImplPositionalRead>(L"resources/s_3_t_1_c_3_z_5.czi");
+  pylibczi::StreamImplMemoryMapped mapped(L"resources/s_3_t_1_c_3_z_5.czi");
+  pylibczi::StreamImplBlockCache cached(positional, 4096, 8 * 4096, 2);
+
+  // reads of every size at random offsets, across block boundaries and off the end of the file
+  std::mt19937 generator(3);
+  std::uniform_int_distribution<std::uint64_t> offset(0, mapped.size() + 100), size(1, 20000);
+  std::vector<char> expected, actual;
+  for (int i = 0; i < 300; i++) {
+    std::uint64_t at = i % 10 == 0 ? mapped.size() - 50 : offset(generator);
+    std::uint64_t bytes = size(generator);
+    expected.assign(bytes, 0);
+    actual.assign(bytes, 1);
+    std::uint64_t expectedRead = 0, actualRead = 0;
+    mapped.Read(at, expected.data(), bytes, &expectedRead);
+    cached.Read(at, actual.data(), bytes, &actualRead);
+    REQUIRE(actualRead == expectedRead);
+    REQUIRE(std::equal(expected.begin(), expected.begin() + expectedRead, actual.begin()));
+  }
+}
+
+TEST_CASE("test_block_cache_coalesces", "[Stream_block_cache]")
+{
+  auto positional = std::make_shared<pylibczi::StreamImplPositionalRead>(L"resources/s_3_t_1_c_3_z_5.czi");
+  pylibczi::StreamImplBlockCache cached(positional, 65536, 1 << 20, 0);
+  char buffer[16];
+  for (std::uint64_t at = 0; at < 60000; at += 100) // the small reads libCZI makes parsing a directory
+    cached.Read(at, buffer, sizeof(buffer), nullptr);
+  auto statistics = cached.statistics();
+  REQUIRE(statistics.streamReads == 1);
+  REQUIRE(statistics.misses == 1);
+  REQUIRE(statistics.hits == 599);
+
+  std::vector<char> large(3 * 65536);
+  cached.Read(65536 + 10, large.data(), large.size() - 20, nullptr); // three missing blocks are one read
+  REQUIRE(cached.statistics().streamReads == 2);
+}
+
+TEST_CASE("test_block_cache_read_ahead", "[Stream_block_cache]")
+{
+  auto positional = std::make_shared<pylibczi::StreamImplPositionalRead>(L"resources/s_3_t_1_c_3_z_5.czi");
+  pylibczi::StreamImplBlockCache cached(positional, 4096, 1 << 20, 4);
+  std::vector<char> chunk(4096);
+  for (std::uint64_t block = 0; block < 32; block++)
+    cached.Read(block * 4096, chunk.data(), chunk.size(), nullptr);
+  auto statistics = cached.statistics();
+  REQUIRE(statistics.hits + statistics.misses == 32);
+  REQUIRE(statistics.misses == 1); // every block after the first was read ahead
+  REQUIRE(statistics.readAheads >= 31);
+}
+
+TEST_CASE("test_block_cache_concurrent_reader", "[Stream_block_cache]")
+{
+  auto cached = std::make_shared<pylibczi::StreamImplBlockCache>(
+    std::make_shared<pylibczi::StreamImplPositionalRead>(L"resources/s_3_t_1_c_3_z_5.czi"), 8192, 1 << 18, 2);
+  pylibczi::Reader reader(cached);
+  pylibczi::Reader positional(L"resources/s_3_t_1_c_3_z_5.czi");
+  REQUIRE(reader.dimsString() == positional.dimsString());
+  libCZI::CDimCoordinate cDims{ { libCZI::DimensionIndex::S, 2 } };
+  auto expected = positional.readSelected(cDims, -1, 1);
+  auto actual = reader.readSelected(cDims, -1, 4);
+  REQUIRE(actual.second == expected.second);
+  size_t pixels = expected.first->images().size() * expected.first->images().front()->length();
+  auto expectedPixels = expected.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  auto actualPixels = actual.first->getBaseAsTyped<uint16_t>()->getPointerAtIndex(0);
+  REQUIRE(std::equal(expectedPixels, expectedPixels + pixels, actualPixels));
+}
@@ -0,0 +1,194 @@
+#include <cstdio>
+
+#include "catch.hpp"
+#include "inc_libCZI.h"
+
+#include "../c_benchmarks/SyntheticCzi.h"
+#include "Reader.h"
+#include "SubblockDirectory.h"
+
+using namespace pylibczi;
+
+class CziDirectoryFile
+{
+  std::unique_ptr<pylibczi::Reader> m_czi;
+
+public:
+  CziDirectoryFile()
+    : m_czi(new pylibczi::Reader(L"resources/s_3_t_1_c_3_z_5.czi"))
+  {}
+  pylibczi::Reader* get() { return m_czi.get(); }
+};
+
+class CziDirectoryMosaicFile
+{
+  std::unique_ptr<pylibczi::Reader> m_czi;
+
+public:
+  CziDirectoryMosaicFile()
+    : m_czi(new pylibczi::Reader(L"resources/mosaic_test.czi"))
+  {}
+  pylibczi::Reader* get() { return m_czi.get(); }
+};
+
+TEST_CASE_METHOD(CziDirectoryFile, "test_directory_size", "[SubblockDirectory_size]")
+{
+  const auto& directory = get()->directory();
+  REQUIRE(directory.layer0Rows().size() == 45); // 3 scenes * 3 channels * 5 z-slices
+  REQUIRE(directory.size() >= directory.layer0Rows().size());
+  REQUIRE(directory.hasDimension(libCZI::DimensionIndex::S));
+  REQUIRE(directory.hasDimension(libCZI::DimensionIndex::Z));
+  REQUIRE(!directory.hasDimension(libCZI::DimensionIndex::T));
+}
+
+TEST_CASE_METHOD(CziDirectoryFile, "test_directory_find_rows", "[SubblockDirectory_findRows]")
+{
+  const auto& directory = get()->directory();
+  libCZI::CDimCoordinate cDims{ { libCZI::DimensionIndex::C, 0 } };
+  auto rows = directory.findRows(cDims);
+  REQUIRE(rows.size() == 15);
+  for (auto row : rows)
+    REQUIRE(directory.dimValue(row, libCZI::DimensionIndex::C) == 0);
+
+  libCZI::CDimCoordinate sczDims{ { libCZI::DimensionIndex::S, 1 },
+                                  { libCZI::DimensionIndex::C, 2 },
+                                  { libCZI::DimensionIndex::Z, 3 } };
+  rows = directory.findRows(sczDims);
+  REQUIRE(rows.size() == 1);
+  auto coordinate = directory.coordinate(rows.front());
+  int value = -1;
+  REQUIRE(coordinate.TryGetPosition(libCZI::DimensionIndex::S, &value));
+  REQUIRE(value == 1);
+  REQUIRE(coordinate.TryGetPosition(libCZI::DimensionIndex::Z, &value));
+  REQUIRE(value == 3);
+
+  // T isn't defined by the file so it can't exclude any subblocks
+  libCZI::CDimCoordinate tDims{ { libCZI::DimensionIndex::T, 0 } };
+  REQUIRE(directory.findRows(tDims).size() == 45);
+
+  libCZI::CDimCoordinate badScene{ { libCZI::DimensionIndex::S, 4 } };
+  REQUIRE(directory.findRows(badScene).empty());
+}
+
+TEST_CASE_METHOD(CziDirectoryMosaicFile, "test_directory_find_m_index", "[SubblockDirectory_findRows_M]")
+{
+  const auto& directory = get()->directory();
+  libCZI::CDimCoordinate cDims{ { libCZI::DimensionIndex::C, 0 } };
+  REQUIRE(directory.findRows(cDims).size() == 2);
+  REQUIRE(directory.findRows(cDims, 1, false).size() == 2); // M ignored
+  auto rows = directory.findRows(cDims, 1, true);
+  REQUIRE(rows.size() == 1);
+  REQUIRE(directory.mIndex(rows.front()) == 1);
+  REQUIRE(directory.logicalRect(rows.front()).x == 832);
+}
+
+class CziDirectoryPyramidFile
+{
+  std::unique_ptr<pylibczi::Reader> m_czi;
+
+public:
+  CziDirectoryPyramidFile()
+    : m_czi(new pylibczi::Reader(L"resources/Multiscene_CZI_3Scenes.czi"))
+  {}
+  pylibczi::Reader* get() { return m_czi.get(); }
+};
+
+TEST_CASE_METHOD(CziDirectoryPyramidFile, "test_directory_pyramid_layers", "[SubblockDirectory_pyramid]")
+{
+  const auto& directory = get()->directory();
+  const auto& layers = directory.pyramidLayers();
+  REQUIRE(layers.size() == 2);
+  REQUIRE(layers[0].layer == 0);
+  REQUIRE(layers[0].subblocks == 29);
+  REQUIRE(layers[1].layer == 1);
+  REQUIRE(layers[1].minification == Approx(2.0));
+  REQUIRE(layers[1].subblocks == 2); // scenes 0 and 1, scene 2 has no pyramid
+
+  libCZI::CDimCoordinate sceneOne{ { libCZI::DimensionIndex::C, 0 }, { libCZI::DimensionIndex::S, 1 } };
+  auto rows = directory.findLayerRows(sceneOne, 1);
+  REQUIRE(rows.size() == 1);
+  REQUIRE(directory.pyramidLayer(rows.front()) == 1);
+  REQUIRE(directory.logicalRect(rows.front()).w == 1408);
+  REQUIRE(directory.findLayerRows(sceneOne, 0) == directory.findRows(sceneOne));
+  libCZI::CDimCoordinate sceneTwo{ { libCZI::DimensionIndex::S, 2 } };
+  REQUIRE(directory.findLayerRows(sceneTwo, 1).empty());
+  REQUIRE(directory.findLayerRows(sceneTwo, 5).empty());
+}
+
+TEST_CASE_METHOD(CziDirectoryFile, "test_directory_no_pyramid", "[SubblockDirectory_pyramid]")
+{
+  const auto& layers = get()->directory().pyramidLayers();
+  REQUIRE(layers.size() == 1);
+  REQUIRE(layers.front().subblocks == 45);
+}
+
+TEST_CASE_METHOD(CziDirectoryFile, "test_directory_sort_keys", "[SubblockDirectory_sortKeys]")
+{
+  const auto& directory = get()->directory();
+  REQUIRE(directory.sortKeyLayout() != 0);
+  // the keys order the rows as the coordinates do, S then C then Z
+  for (auto a : directory.layer0Rows()) {
+    for (auto b : directory.layer0Rows()) {
+      auto aCoordinate = directory.coordinate(a), bCoordinate = directory.coordinate(b);
+      REQUIRE((directory.sortKey(a) < directory.sortKey(b)) ==
+              SubblockSortable::aLessThanB(aCoordinate, bCoordinate));
+    }
+  }
+}
+
+TEST_CASE_METHOD(CziDirectoryMosaicFile, "test_directory_sort_keys_m_index", "[SubblockDirectory_sortKeys]")
+{
+  const auto& directory = get()->directory();
+  REQUIRE(directory.sortKeyLayout() != 0);
+  REQUIRE(directory.sortKeyLayout() != CziDirectoryFile().get()->directory().sortKeyLayout());
+  for (auto a : directory.layer0Rows()) {
+    for (auto b : directory.layer0Rows()) {
+      auto aCoordinate = directory.coordinate(a), bCoordinate = directory.coordinate(b);
+      REQUIRE((directory.sortKey(a) < directory.sortKey(b)) ==
+              SubblockSortable::aLessThanB(aCoordinate, directory.mIndex(a), bCoordinate, directory.mIndex(b)));
+    }
+  }
+
+  // a SubblockSortable with a key compares by it, one without by its coordinate
+  auto rows = directory.layer0Rows();
+  auto first = directory.coordinate(rows[0]), second = directory.coordinate(rows[1]);
+  SubblockSortable a(&first, directory.mIndex(rows[0]), true), b(&second, directory.mIndex(rows[1]), true);
+  bool byCoordinate = a < b;
+  a.setSortKey(directory.sortKeyLayout(), directory.sortKey(rows[0]));
+  REQUIRE((a < b) == byCoordinate);
+  b.setSortKey(directory.sortKeyLayout(), directory.sortKey(rows[1]));
+  REQUIRE((a < b) == byCoordinate);
+  REQUIRE((b < a) == !byCoordinate);
+}
+
+TEST_CASE("test_directory_sparse_values", "[SubblockDirectory_findRows]")
+{
+  // Z values a billion apart and m-indices 500 million apart, the buckets follow the subblocks not the spread
+  auto options = pylibczi_benchmarks::parseSyntheticCziOptions(
+    "C=2,Z=3,zstride=1000000000,M=4,mstride=500000000,tile=8,overlap=0,metadata=0");
+  pylibczi_benchmarks::writeSyntheticCzi(L"test_directory_sparse.czi", options);
+  {
+    pylibczi::Reader czi(L"test_directory_sparse.czi");
+    const auto& directory = czi.directory();
+    REQUIRE(directory.layer0Rows().size() == 24);
+
+    libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::C, 1 }, { libCZI::DimensionIndex::Z, 2000000000 } };
+    auto rows = directory.findRows(plane);
+    REQUIRE(rows.size() == 4);
+    for (auto row : rows) {
+      REQUIRE(directory.dimValue(row, libCZI::DimensionIndex::C) == 1);
+      REQUIRE(directory.dimValue(row, libCZI::DimensionIndex::Z) == 2000000000);
+    }
+    rows = directory.findRows(plane, 1500000000, true);
+    REQUIRE(rows.size() == 1);
+    REQUIRE(directory.mIndex(rows.front()) == 1500000000);
+    REQUIRE(directory.logicalRect(rows.front()).x == pylibczi_benchmarks::syntheticTileRect(options, 0, 3).x);
+
+    // values between the ones in the file match nothing
+    REQUIRE(directory.findRows(plane, 3, true).empty());
+    libCZI::CDimCoordinate between{ { libCZI::DimensionIndex::Z, 1 } };
+    REQUIRE(directory.findRows(between).empty());
+    REQUIRE(czi.readSelected(plane, 1500000000, 1).first->numberOfImages() == 1);
+  }
+  std::remove("test_directory_sparse.czi");
+}
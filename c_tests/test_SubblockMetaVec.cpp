@@ -0,0 +1,58 @@
+#include <cmath>
+#include <regex>
+#include <string>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/SubblockMetaVec.h"
+
+using pylibczi::SubblockString;
+
+namespace {
+const char s_metadata[] = "<METADATA><Tags><AcquisitionTime>2019-06-27T18:33:41.1154211Z</AcquisitionTime>"
+                          "<DetectorState>&lt;CameraState Id=\"\"&gt;\r\n  &lt;ExposureTime&gt;10004210.5"
+                          "&lt;/ExposureTime&gt;\r\n&lt;/CameraState&gt;</DetectorState>"
+                          "<StageXPositionOffset>1</StageXPositionOffset>"
+                          "<StageXPosition>+000000043427.9820</StageXPosition> <StageYPosition> -12.5 "
+                          "</StageYPosition><Empty/><Name>tile 1</Name></Tags></METADATA>\0\0\0 padding";
+
+// the regular expressions the xml used to be cleaned with
+std::string
+regexClean(const std::string& xml_)
+{
+  std::string ans = std::regex_replace(xml_, std::regex("&lt;"), "<");
+  ans = std::regex_replace(ans, std::regex("&gt;"), ">");
+  ans = std::regex_replace(ans, std::regex("\\s*\\r\\n\\s*"), "");
+  return std::regex_replace(ans, std::regex("</METADATA>.*"), "</METADATA>");
+}
+}
+
+TEST_CASE("test_clean_xml", "[SubblockMetaVec]")
+{
+  std::string raw(s_metadata, sizeof(s_metadata) - 1); // with the padding after </METADATA>
+  std::string clean = SubblockString::cleanXml(raw.data(), raw.size());
+  REQUIRE(clean == regexClean(raw));
+  REQUIRE(clean.find("<ExposureTime>10004210.5</ExposureTime></CameraState>") != std::string::npos);
+  REQUIRE(clean.substr(clean.size() - 11) == "</METADATA>");
+
+  for (std::string xml : { "a \r\n b", "a \n b", "a\r \nb", "&&lt;lt;&gt", "x &lt;/METADATA&gt; y", "" })
+    REQUIRE(SubblockString::cleanXml(xml.data(), xml.size()) == regexClean(xml));
+}
+
+TEST_CASE("test_field_value", "[SubblockMetaVec]")
+{
+  std::string xml = SubblockString::cleanXml(s_metadata, sizeof(s_metadata) - 1);
+  bool isTime = true;
+  REQUIRE(SubblockString::fieldValue(xml, "StageXPosition", isTime) == Approx(43427.982));
+  REQUIRE_FALSE(isTime);
+  REQUIRE(SubblockString::fieldValue(xml, "StageYPosition", isTime) == Approx(-12.5));
+
+  double seconds = SubblockString::fieldValue(xml, "AcquisitionTime", isTime);
+  REQUIRE(isTime);
+  REQUIRE(seconds == Approx(1561660421.1154211).epsilon(1e-12)); // date -u -d 2019-06-27T18:33:41 +%s
+  std::string zoned = "<T>2019-06-27T20:33:41+02:00</T>";
+  REQUIRE(SubblockString::fieldValue(zoned, "T", isTime) == Approx(1561660421.0).epsilon(1e-12));
+
+  for (const char* name : { "Missing", "Empty", "Name", "Stage" })
+    REQUIRE(std::isnan(SubblockString::fieldValue(xml, name, isTime)));
+}
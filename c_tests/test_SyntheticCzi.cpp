@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Reader.h"
+#include "../c_benchmarks/SyntheticCzi.h"
+
+using pylibczi_benchmarks::SyntheticCziOptions;
+
+TEST_CASE("test_synthetic_czi", "[SyntheticCzi]")
+{
+  SyntheticCziOptions options =
+    pylibczi_benchmarks::parseSyntheticCziOptions("S=2,C=2,Z=3,M=5,tile=32x16,overlap=0.25,pyramid=2");
+  REQUIRE(pylibczi_benchmarks::parseSyntheticCziOptions(pylibczi_benchmarks::syntheticCziSpec(options)).tiles == 5);
+  auto summary = pylibczi_benchmarks::writeSyntheticCzi(L"test_synthetic.czi", options);
+  // the scenes are 80 x 28, layer 1 covers each with 2 x 1 tiles and layer 2 with 1 x 1
+  REQUIRE(summary.layer0Subblocks == 60);
+  REQUIRE(summary.subblocks == 60 + 12 * 3);
+
+  {
+    pylibczi::Reader czi(L"test_synthetic.czi");
+    REQUIRE(czi.subblockDirectory().size() == summary.subblocks);
+    REQUIRE(czi.isMosaic());
+    REQUIRE(czi.pixelType() == libCZI::Utils::PixelTypeToInformalString(libCZI::PixelType::Gray16));
+    auto layers = czi.pyramidLayers();
+    REQUIRE(layers.size() == 3);
+    REQUIRE(layers[1].minification == 2.0);
+    REQUIRE(layers[2].minification == 4.0);
+
+    auto ranges = czi.readDimsRange().front();
+    REQUIRE(ranges[pylibczi::DimIndex::S] == std::make_pair(0, 2));
+    REQUIRE(ranges[pylibczi::DimIndex::C] == std::make_pair(0, 2));
+    REQUIRE(ranges[pylibczi::DimIndex::Z] == std::make_pair(0, 3));
+    REQUIRE(ranges[pylibczi::DimIndex::M] == std::make_pair(0, 5));
+
+    // the pixels of a tile are the pattern at the tile's place in the file
+    libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 },
+                                  { libCZI::DimensionIndex::C, 1 },
+                                  { libCZI::DimensionIndex::Z, 2 } };
+    libCZI::IntRect tile = pylibczi_benchmarks::syntheticTileRect(options, 1, 4);
+    REQUIRE(tile.x == 112 + 24);
+    REQUIRE(tile.y == 12);
+    auto image = czi.readSelected(plane, 4, 1);
+    const std::uint16_t* pixels = image.first->getBaseAsTyped<std::uint16_t>()->getPointerAtIndex(0);
+    bool matches = true;
+    for (int y = 0; y < tile.h; y++) {
+      for (int x = 0; x < tile.w; x++)
+        matches = matches && pixels[y * tile.w + x] == pylibczi_benchmarks::syntheticValue(tile.x + x, tile.y + y, 5);
+    }
+    REQUIRE(matches);
+    REQUIRE(czi.readSubblockMeta(plane).size() == 5);
+  }
+  std::remove("test_synthetic.czi");
+
+  REQUIRE_THROWS_AS(pylibczi_benchmarks::parseSyntheticCziOptions("M=0"), std::invalid_argument);
+  REQUIRE_THROWS_AS(pylibczi_benchmarks::parseSyntheticCziOptions("pixel=Gray64ComplexFloat"), std::invalid_argument);
+  REQUIRE_THROWS_AS(pylibczi_benchmarks::parseSyntheticCziOptions("Q=1"), std::invalid_argument);
+  REQUIRE_THROWS_AS(pylibczi_benchmarks::parseSyntheticCziOptions("zstride=0"), std::invalid_argument);
+  REQUIRE_THROWS_AS(pylibczi_benchmarks::parseSyntheticCziOptions("Z=3,zstride=2000000000"), std::invalid_argument);
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Threadpool.h"
+
+using pylibczi::ThreadPool;
+
+TEST_CASE("test_threadpool_cores", "[ThreadPool_cores]")
+{
+  REQUIRE(ThreadPool::hardwareThreads() >= 1);
+  REQUIRE(ThreadPool::coresFor(0) == 1);
+  REQUIRE(ThreadPool::coresFor(2000) == ThreadPool::hardwareThreads());
+  REQUIRE(ThreadPool::instance().size() >= 1);
+  REQUIRE(&ThreadPool::instance() == &ThreadPool::instance());
+}
+
+TEST_CASE("test_threadpool_submit", "[ThreadPool_submit]")
+{
+  ThreadPool pool(3);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; i++)
+    results.push_back(pool.submit([i]() { return i * i; }));
+  for (int i = 0; i < 100; i++)
+    REQUIRE(results[i].get() == i * i);
+
+  auto failed = pool.submit([]() -> int { throw std::runtime_error("bad task"); });
+  REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+}
+
+TEST_CASE("test_threadpool_parallel_for", "[ThreadPool_parallelFor]")
+{
+  ThreadPool pool(4);
+  std::vector<int> visits(1000, 0);
+  pool.parallelFor(visits.size(), 4, [&visits](size_t i_) { visits[i_]++; });
+  for (auto visit : visits)
+    REQUIRE(visit == 1);
+
+  // a single core runs on the calling thread
+  auto caller = std::this_thread::get_id();
+  std::atomic<int> otherThreads{ 0 };
+  pool.parallelFor(50, 1, [&](size_t) {
+    if (std::this_thread::get_id() != caller)
+      otherThreads++;
+  });
+  REQUIRE(otherThreads == 0);
+
+  pool.parallelFor(0, 4, [](size_t) { throw std::runtime_error("never called"); });
+}
+
+TEST_CASE("test_threadpool_parallel_for_throws", "[ThreadPool_parallelFor]")
+{
+  ThreadPool pool(2);
+  std::atomic<int> calls{ 0 };
+  REQUIRE_THROWS_AS(pool.parallelFor(100,
+                                     3,
+                                     [&calls](size_t i_) {
+                                       calls++;
+                                       if (i_ == 10)
+                                         throw std::runtime_error("bad index");
+                                     }),
+                    std::runtime_error);
+  REQUIRE(calls <= 100);
+}
+
+TEST_CASE("test_threadpool_nested", "[ThreadPool_parallelFor_nested]")
+{
+  // every worker blocks in an inner loop, the callers do the inner work themselves so this can't deadlock
+  ThreadPool pool(2);
+  std::atomic<int> total{ 0 };
+  pool.parallelFor(8, 3, [&](size_t) { pool.parallelFor(10, 3, [&](size_t) { total++; }); });
+  REQUIRE(total == 80);
+}
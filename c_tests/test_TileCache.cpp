@@ -0,0 +1,109 @@
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Threadpool.h"
+#include "../_aicspylibczi/TileCache.h"
+
+using pylibczi::DecodedTile;
+using pylibczi::TileCache;
+
+namespace {
+// a Gray8 bitmap of w x h pixels, every pixel has the value fill_, the rows are padded to test the stride
+class FilledBitmap : public libCZI::IBitmapData
+{
+  libCZI::IntSize m_size;
+  std::vector<std::uint8_t> m_pixels;
+
+public:
+  FilledBitmap(std::uint32_t w_, std::uint32_t h_, std::uint8_t fill_)
+    : m_size{ w_, h_ }
+    , m_pixels((w_ + 3) * h_, fill_)
+  {}
+
+  libCZI::PixelType GetPixelType() const override { return libCZI::PixelType::Gray8; }
+  libCZI::IntSize GetSize() const override { return m_size; }
+  libCZI::BitmapLockInfo Lock() override
+  {
+    libCZI::BitmapLockInfo info;
+    info.ptrData = m_pixels.data();
+    info.ptrDataRoi = m_pixels.data();
+    info.stride = m_size.w + 3;
+    info.size = m_pixels.size();
+    return info;
+  }
+  void Unlock() override {}
+};
+
+std::shared_ptr<const DecodedTile>
+makeTile(std::uint32_t w_, std::uint32_t h_, std::uint8_t fill_ = 0)
+{
+  FilledBitmap bitmap(w_, h_, fill_);
+  return std::make_shared<DecodedTile>(libCZI::SubBlockInfo(), bitmap);
+}
+}
+
+TEST_CASE("test_decoded_tile_packs_rows", "[TileCache]")
+{
+  auto tile = makeTile(4, 3, 7);
+  REQUIRE(tile->stride() == 4);
+  REQUIRE(tile->bytes() == 12);
+  for (size_t i = 0; i < tile->bytes(); i++)
+    REQUIRE(tile->data()[i] == 7);
+}
+
+TEST_CASE("test_tile_cache_lru", "[TileCache]")
+{
+  TileCache cache;
+  cache.insert(0, makeTile(10, 10));
+  REQUIRE(cache.find(0) == nullptr); // disabled by default
+  REQUIRE(cache.statistics().misses == 0);
+
+  cache.setByteBudget(300); // room for three 100 byte tiles
+  for (int i = 0; i < 3; i++)
+    cache.insert(i, makeTile(10, 10));
+  REQUIRE(cache.find(0) != nullptr); // 0 is now the most recently used
+  cache.insert(3, makeTile(10, 10));
+  REQUIRE(cache.find(1) == nullptr); // 1 was evicted
+  REQUIRE(cache.find(0) != nullptr);
+  REQUIRE(cache.find(2) != nullptr);
+  REQUIRE(cache.find(3) != nullptr);
+
+  auto stats = cache.statistics();
+  REQUIRE(stats.hits == 4);
+  REQUIRE(stats.misses == 1);
+  REQUIRE(stats.tiles == 3);
+  REQUIRE(stats.bytes == 300);
+
+  cache.insert(4, makeTile(20, 20)); // larger than the budget
+  REQUIRE(cache.find(4) == nullptr);
+  REQUIRE(cache.statistics().tiles == 3);
+
+  cache.setByteBudget(100);
+  REQUIRE(cache.statistics().tiles == 1);
+  REQUIRE(cache.find(3) != nullptr); // the most recently used tile survives
+  cache.clear();
+  REQUIRE(cache.statistics().bytes == 0);
+}
+
+TEST_CASE("test_tile_cache_threads", "[TileCache]")
+{
+  TileCache cache(50 * 100); // half of the subblocks fit
+  std::atomic<int> wrong{ 0 };
+  pylibczi::ThreadPool::instance().parallelFor(2000, 0, [&](size_t i_) {
+    int index = static_cast<int>(i_ % 100);
+    auto tile = cache.find(index);
+    if (tile == nullptr) {
+      tile = makeTile(10, 10, static_cast<std::uint8_t>(index));
+      cache.insert(index, tile);
+    }
+    if (tile->data()[99] != index)
+      wrong++;
+  });
+  REQUIRE(wrong == 0);
+  auto stats = cache.statistics();
+  REQUIRE(stats.hits + stats.misses == 2000);
+  REQUIRE(stats.bytes <= 50 * 100);
+}
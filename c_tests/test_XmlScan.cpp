@@ -0,0 +1,65 @@
+#include <string>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/XmlScan.h"
+
+using pylibczi::XmlScan;
+
+namespace {
+const std::string s_document = "<?xml version=\"1.0\"?>\r\n"
+                               "<!-- <ImageDocument><Metadata> -->\r\n"
+                               "<ImageDocument>\r\n"
+                               "  <Metadata>\r\n"
+                               "    <Information>\r\n"
+                               "      <Image>\r\n"
+                               "        <AcquisitionDateAndTime>2019-06-27T18:39:25Z</AcquisitionDateAndTime>\r\n"
+                               "        <Dimensions>\r\n"
+                               "          <Channels>\r\n"
+                               "            <Channel Id=\"Channel:0\" Name=\"EGFP\"><Fluor>EGFP</Fluor></Channel>\r\n"
+                               "            <Channel Name='a &gt; b' Id=\"Channel:1\" />\r\n"
+                               "            <Channel Id=\"Channel:2\" Note=\"x>y\"/>\r\n"
+                               "          </Channels>\r\n"
+                               "        </Dimensions>\r\n"
+                               "      </Image>\r\n"
+                               "    </Information>\r\n"
+                               "    <Scaling><Items><Distance Id=\"X\"><Value><![CDATA[<]]>1E-06</Value></Distance>"
+                               "</Items></Scaling>\r\n"
+                               "    <Channel Name=\"not in Dimensions\"/>\r\n"
+                               "  </Metadata>\r\n"
+                               "</ImageDocument>\r\n";
+}
+
+TEST_CASE("test_xml_scan_text", "[XmlScan]")
+{
+  XmlScan scan(s_document.data(), s_document.size());
+  std::string text;
+  REQUIRE(scan.text("ImageDocument/Metadata/Information/Image/AcquisitionDateAndTime", text));
+  REQUIRE(text == "2019-06-27T18:39:25Z");
+  REQUIRE(scan.text("ImageDocument/Metadata/Information/Image/Dimensions/Channels/Channel/Fluor", text));
+  REQUIRE(text == "EGFP");
+  REQUIRE(scan.text("ImageDocument/Metadata/Information/Image/Dimensions/Channels/Channel", text));
+  REQUIRE(text.empty()); // the text before the first child
+  REQUIRE_FALSE(scan.text("ImageDocument/Metadata/Image", text));
+  REQUIRE_FALSE(scan.text("Metadata", text));
+}
+
+TEST_CASE("test_xml_scan_attributes", "[XmlScan]")
+{
+  XmlScan scan(s_document.data(), s_document.size());
+  auto names = scan.attributes("ImageDocument/Metadata/Information/Image/Dimensions/Channels/Channel", "Name");
+  REQUIRE(names == std::vector<std::string>{ "EGFP", "a > b", "" });
+  auto ids = scan.attributes("ImageDocument/Metadata/Information/Image/Dimensions/Channels/Channel", "Id");
+  REQUIRE(ids == std::vector<std::string>{ "Channel:0", "Channel:1", "Channel:2" });
+  REQUIRE(scan.attributes("ImageDocument/Metadata/Scaling/Items/Distance", "Id") == std::vector<std::string>{ "X" });
+  REQUIRE(scan.attributes("ImageDocument/Metadata/Channel", "Name") ==
+          std::vector<std::string>{ "not in Dimensions" });
+}
+
+TEST_CASE("test_xml_scan_unescape", "[XmlScan]")
+{
+  auto unescape = [](const std::string& text_) { return XmlScan::unescape(text_.data(), text_.data() + text_.size()); };
+  REQUIRE(unescape("a &amp; b &lt;&gt; &quot;c&apos;") == "a & b <> \"c'");
+  REQUIRE(unescape("&#181;m &#xB5;m") == "\xC2\xB5m \xC2\xB5m");
+  REQUIRE(unescape("&unknown; & &#xZZ;") == "&unknown; & &#xZZ;");
+}
@@ -0,0 +1,164 @@
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../_aicspylibczi/Reader.h"
+#include "../_aicspylibczi/ReaderPool.h"
+#include "../_aicspylibczi/ZarrExport.h"
+#include "../_aicspylibczi/exceptions.h"
+
+using pylibczi::ZarrExport;
+
+namespace {
+std::vector<std::uint8_t>
+readFile(const std::string& name_)
+{
+  std::vector<std::uint8_t> ans;
+  std::FILE* file = std::fopen(name_.c_str(), "rb");
+  REQUIRE(file != nullptr);
+  std::uint8_t buffer[4096];
+  size_t bytes;
+  while ((bytes = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    ans.insert(ans.end(), buffer, buffer + bytes);
+  std::fclose(file);
+  return ans;
+}
+
+ZarrExport::Options
+uncompressed(int chunk_y_, int chunk_x_, int levels_)
+{
+  ZarrExport::Options options;
+  options.chunkY = chunk_y_;
+  options.chunkX = chunk_x_;
+  options.levels = levels_;
+  options.compression = ZarrExport::Compression::None;
+  options.cores = 2;
+  return options;
+}
+}
+
+TEST_CASE("test_zarr_downsample", "[ZarrExport]")
+{
+  std::vector<std::uint16_t> in{ 1, 2, 3, 4, 5, 6, 7, 8, 9 }; // 3 x 3
+  std::vector<std::uint16_t> out(4);
+  ZarrExport::downsample(libCZI::PixelType::Gray16, in.data(), 3, 3, out.data());
+  // the last row and column are repeated, integers are rounded
+  REQUIRE(out == std::vector<std::uint16_t>{ 3, 5, 8, 9 });
+
+  std::vector<float> floats{ 1.0f, 2.0f, 3.0f, 5.0f };
+  float mean = 0.0f;
+  ZarrExport::downsample(libCZI::PixelType::Gray32Float, floats.data(), 2, 2, &mean);
+  REQUIRE(mean == 2.75f);
+}
+
+TEST_CASE("test_zarr_export_chunks", "[ZarrExport]")
+{
+  pylibczi::Reader czi(L"resources/s_3_t_1_c_3_z_5.czi");
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 } };
+  ZarrExport exporter(czi, plane, uncompressed(128, 200, 2));
+  REQUIRE(exporter.shape(0) == std::vector<size_t>{ 1, 1, 5, 325, 475 });
+  REQUIRE(exporter.shape(1) == std::vector<size_t>{ 1, 1, 5, 163, 238 });
+  auto statistics = exporter.write(L"test_export.zarr");
+  REQUIRE(statistics.chunks == 5 * (3 * 3 + 2 * 2));
+  REQUIRE(statistics.bytes == statistics.pixelBytes);
+  REQUIRE(czi.tileCacheStatistics().byteBudget == 0); // the Reader's cache isn't touched
+
+  std::vector<std::uint8_t> meta = readFile("test_export.zarr/1/.zarray");
+  std::string zarray(meta.begin(), meta.end());
+  REQUIRE(zarray.find("\"shape\": [1, 1, 5, 163, 238]") != std::string::npos);
+  REQUIRE(zarray.find("\"chunks\": [1, 1, 1, 128, 200]") != std::string::npos);
+  REQUIRE(zarray.find("\"dtype\": \"<u2\"") != std::string::npos);
+
+  libCZI::CDimCoordinate z3{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 },
+                             { libCZI::DimensionIndex::Z, 3 } };
+  std::vector<std::uint16_t> expected(325 * 475);
+  czi.readSelected(z3, -1, 1, { 0, 0, -1, -1 }, expected.data(), expected.size() * sizeof(std::uint16_t));
+  // the chunk in the second row and the last column is padded with zeros
+  std::vector<std::uint8_t> bytes = readFile("test_export.zarr/0/0.0.3.1.2");
+  REQUIRE(bytes.size() == 128 * 200 * sizeof(std::uint16_t));
+  auto chunk = reinterpret_cast<const std::uint16_t*>(bytes.data());
+  for (size_t y = 0; y < 128; y++) {
+    for (size_t x = 0; x < 200; x++) {
+      std::uint16_t pixel = x < 475 - 400 ? expected[(128 + y) * 475 + 400 + x] : 0;
+      REQUIRE(chunk[y * 200 + x] == pixel);
+    }
+  }
+}
+
+TEST_CASE("test_zarr_export_pooled", "[ZarrExport]")
+{
+  // the export leaves the cache the pool's readers share alone while another reader reads through it
+  pylibczi::ReaderPool pool(4, 1 << 20, 2);
+  auto scenes = pool.reader(L"resources/s_3_t_1_c_3_z_5.czi");
+  auto single = pool.reader(L"resources/s_1_t_1_c_1_z_1.czi");
+  libCZI::CDimCoordinate only{ { libCZI::DimensionIndex::C, 0 } };
+  std::vector<std::uint16_t> expectedSingle(325 * 475);
+  pylibczi::Reader(L"resources/s_1_t_1_c_1_z_1.czi")
+    .readSelected(only, -1, 1, { 0, 0, -1, -1 }, expectedSingle.data(), expectedSingle.size() * 2);
+
+  std::atomic<bool> exporting{ true };
+  bool budgetKept = true, readsEqual = true; // Catch's REQUIRE isn't thread safe
+  std::thread reading([&]() {
+    std::vector<std::uint16_t> read(325 * 475);
+    do {
+      single->readSelected(only, -1, 1, { 0, 0, -1, -1 }, read.data(), read.size() * 2);
+      budgetKept = budgetKept && pool.tileCache()->statistics().byteBudget == 1 << 20;
+      readsEqual = readsEqual && read == expectedSingle;
+    } while (exporting);
+  });
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 } };
+  ZarrExport exporter(*scenes, plane, uncompressed(128, 200, 1));
+  auto statistics = exporter.write(L"test_export.zarr");
+  exporting = false;
+  reading.join();
+  REQUIRE(budgetKept);
+  REQUIRE(readsEqual);
+  REQUIRE(statistics.chunks == 5 * 3 * 3);
+  REQUIRE(pool.tileCache()->statistics().byteBudget == 1 << 20);
+
+  libCZI::CDimCoordinate z4{ { libCZI::DimensionIndex::S, 1 }, { libCZI::DimensionIndex::C, 2 },
+                             { libCZI::DimensionIndex::Z, 4 } };
+  std::vector<std::uint16_t> expected(325 * 475);
+  scenes->readSelected(z4, -1, 1, { 0, 0, -1, -1 }, expected.data(), expected.size() * sizeof(std::uint16_t));
+  std::vector<std::uint8_t> bytes = readFile("test_export.zarr/0/0.0.4.0.0");
+  auto chunk = reinterpret_cast<const std::uint16_t*>(bytes.data());
+  for (size_t y = 0; y < 128; y++) {
+    for (size_t x = 0; x < 200; x++)
+      REQUIRE(chunk[y * 200 + x] == expected[y * 475 + x]);
+  }
+}
+
+TEST_CASE("test_zarr_export_mosaic", "[ZarrExport]")
+{
+  pylibczi::Reader czi(L"resources/mosaic_test.czi");
+  libCZI::CDimCoordinate plane{ { libCZI::DimensionIndex::C, 0 } };
+  ZarrExport exporter(czi, plane, uncompressed(256, 1024, 1));
+  REQUIRE(exporter.shape() == std::vector<size_t>{ 1, 1, 1, 624, 924 });
+  exporter.write(L"test_export.zarr");
+
+  std::vector<std::uint16_t> expected(624 * 924);
+  czi.readMosaic(plane, 1.0, czi.mosaicBoundingBox(), { 0.0, 0.0, 0.0 }, 1, expected.data(), expected.size() * 2);
+  // the bands composited one at a time are the same as the composite of the whole mosaic
+  std::vector<std::uint16_t> chunks;
+  for (int band = 0; band < 3; band++) {
+    std::vector<std::uint8_t> bytes = readFile("test_export.zarr/0/0.0.0." + std::to_string(band) + ".0");
+    auto chunk = reinterpret_cast<const std::uint16_t*>(bytes.data());
+    for (size_t y = 0; y < 256 && band * 256 + y < 624; y++)
+      chunks.insert(chunks.end(), chunk + y * 1024, chunk + y * 1024 + 924);
+  }
+  REQUIRE(chunks == expected);
+}
+
+TEST_CASE("test_zarr_export_underspecified", "[ZarrExport]")
+{
+  pylibczi::Reader czi(L"resources/s_3_t_1_c_3_z_5.czi");
+  libCZI::CDimCoordinate plane; // the scenes of a file that isn't a mosaic aren't one image
+  REQUIRE_THROWS_AS(ZarrExport(czi, plane, uncompressed(64, 64, 1)), pylibczi::CDimCoordinatesUnderspecifiedException);
+
+  plane.Set(libCZI::DimensionIndex::S, 0); // odd chunk rows can't be halved for a pyramid
+  REQUIRE_THROWS_AS(ZarrExport(czi, plane, uncompressed(5, 64, 2)), pylibczi::ExportException);
+}
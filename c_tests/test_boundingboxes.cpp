@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "inc_libCZI.h"
+#include <atomic>
 #include <iostream>
 
 #include "Reader.h"
@@ -186,3 +187,54 @@ TEST_CASE_METHOD(CziMFile, "test_read_mosaic_tile_bbox", "[Reader_read_mosaic_ti
 
   REQUIRE_THROWS_AS(czi->mosaicTileBoundingBox(cDims, 2), CDimCoordinatesOverspecifiedException);
 }
+
+namespace {
+// counts the bytes read through it
+class CountingStream : public libCZI::IStream
+{
+  std::shared_ptr<libCZI::IStream> m_stream;
+
+public:
+  std::atomic<std::uint64_t> bytesRead{ 0 };
+
+  explicit CountingStream(std::shared_ptr<libCZI::IStream> stream_)
+    : m_stream(std::move(stream_))
+  {}
+
+  void Read(std::uint64_t offset_, void* data_ptr_, std::uint64_t size_, std::uint64_t* bytes_read_ptr_) override
+  {
+    bytesRead += size_;
+    m_stream->Read(offset_, data_ptr_, size_, bytes_read_ptr_);
+  }
+};
+}
+
+TEST_CASE("test_tile_bboxes_read_no_subblocks", "[Reader_read_mosaic_tile_bbox]")
+{
+  auto stream = std::make_shared<CountingStream>(libCZI::CreateStreamFromFile(L"resources/mosaic_test.czi"));
+  Reader czi(stream);
+  stream->bytesRead = 0;
+
+  auto cDims = libCZI::CDimCoordinate{ { libCZI::DimensionIndex::C, 0 } };
+  auto tiles = czi.mosaicTileBoundingBoxes(cDims);
+  REQUIRE(tiles.size() == 2);
+  REQUIRE(tiles.rbegin()->second.x == 832);
+  czi.tileBoundingBoxes(cDims);
+  czi.mosaicTileBoundingBox(cDims, 1);
+  REQUIRE(stream->bytesRead == 0); // everything comes from the directory read when the file was opened
+}
+
+TEST_CASE("test_scene_shapes_read_no_subblocks", "[Reader_Dims]")
+{
+  auto stream =
+    std::make_shared<CountingStream>(libCZI::CreateStreamFromFile(L"resources/Multiscene_CZI_3Scenes.czi"));
+  Reader czi(stream);
+  stream->bytesRead = 0;
+
+  auto shapes = czi.readDimsRange();
+  czi.dimsString();
+  czi.dimSizes();
+  REQUIRE(shapes.size() == (czi.shapeIsConsistent() ? 1 : 3));
+  REQUIRE(shapes.back()[DimIndex::S].second == 3);
+  REQUIRE(stream->bytesRead == 0); // the scene shapes come from the directory read when the file was opened
+}